@@ -64,7 +64,7 @@
  *
  * Create an TIFF image, containing one monochrome tile
  *
- * Usage: createNodata -n <VAL> [-c <VAL>] -p <VAL> [-t <VAL> <VAL>] -a <VAL> -s <VAL> -b <VAL> <OUTPUT FILE>
+ * Usage: createNodata -n <VAL> [-c <VAL>] -p <VAL> [-t <VAL> <VAL>] [-r <VAL>] -a <VAL> -s <VAL> -b <VAL> <OUTPUT FILE>
  *
  * Parameters:
  *      -n nodata value, one interger per sample, seperated with comma. This only value will be present in the tile.
@@ -75,11 +75,13 @@
  *              lzw     Lempel-Ziv & Welch encoding
  *              pkb     PackBits encoding
  *              zip     Deflate encoding
+ *              zstd    Zstandard encoding (only if built with zstd)
  *              png     Portable Network Graphics encoding (unofficial TIFF compression)
  *      -p photometric :
  *              gray    min is black
  *              rgb     for image with alpha too
  *      -t tile size : width and height. Sizes are tile and image ones. Default value : 256 256.
+ *      -r TIFF predictor (lzw, zip and zstd compressions) : none (default), horizontal (uint) or floatingpoint (float)
  *      -a sample format : uint (unsigned integer) or float
  *      -s samples per pixel : 1, 3 or 4
  *      -b bits per sample : 8 (for unsigned 8-bit integer) or 32 (for 32-bit float)
@@ -99,7 +101,7 @@ void usage() {
 
                   "Create an TIFF image, containing one monochrome tile\n\n" <<
 
-                  "Usage: createNodata -n <VAL> [-c <VAL>] -p <VAL> [-t <VAL> <VAL>] -a <VAL> -s <VAL> -b <VAL> <OUTPUT FILE>\n\n" <<
+                  "Usage: createNodata -n <VAL> [-c <VAL>] -p <VAL> [-t <VAL> <VAL>] [-r <VAL>] -a <VAL> -s <VAL> -b <VAL> <OUTPUT FILE>\n\n" <<
 
                   "Parameters:\n" <<
                   "     -n nodata value, one interger per sample, seperated with comma. This only value will be present in the tile.\n" <<
@@ -110,11 +112,13 @@ void usage() {
                   "             lzw     Lempel-Ziv & Welch encoding\n" <<
                   "             pkb     PackBits encoding\n" <<
                   "             zip     Deflate encoding\n" <<
+                  "             zstd    Zstandard encoding (only if built with zstd)\n" <<
                   "             png     Portable Network Graphics encoding (unofficial TIFF compression)\n" <<
                   "     -p photometric :\n" <<
                   "             gray    min is black\n" <<
                   "             rgb     for image with alpha too\n" <<
                   "     -t tile size : width and height. Sizes are tile and image ones. Default value : 256 256.\n" <<
+                  "     -r TIFF predictor (lzw, zip and zstd compressions) : none (default), horizontal (uint) or floatingpoint (float)\n" <<
                   "     -a sample format : uint (unsigned integer) or float\n" <<
                   "     -s samples per pixel : 1, 3 or 4\n" <<
                   "     -b bits per sample : 8 (for unsigned 8-bit integer) or 32 (for 32-bit float)\n" <<
@@ -170,6 +174,7 @@ int main ( int argc, char* argv[] ) {
     // Valeurs par défaut
     int width = 256, height = 256;
     Compression::eCompression compression = Compression::NONE;
+    Predictor::ePredictor predictor = Predictor::NONE;
 
     /* Initialisation des Loggers */
     Logger::setOutput ( STANDARD_OUTPUT_STREAM_FOR_ERRORS );
@@ -205,6 +210,7 @@ int main ( int argc, char* argv[] ) {
                 else if ( strncmp ( argv[i], "lzw",3 ) == 0 ) compression = Compression::LZW;
                 else if ( strncmp ( argv[i], "zip",3 ) == 0 ) compression = Compression::DEFLATE;
                 else if ( strncmp ( argv[i], "pkb",3 ) == 0 ) compression = Compression::PACKBITS;
+                else if ( strncmp ( argv[i], "zstd",4 ) == 0 ) compression = Compression::ZSTD;
                 else if ( strncmp ( argv[i], "png",3 ) == 0 ) compression = Compression::PNG;
                 else if ( strncmp ( argv[i], "jpg",3 ) == 0 ) compression = Compression::JPEG;
                 else error ( "Unknown compression : " + std::string(argv[i]), -1 );
@@ -219,6 +225,13 @@ int main ( int argc, char* argv[] ) {
                 else if ( strncmp ( argv[i], "rgb",3 ) == 0 ) photometric = Photometric::RGB;
                 else error ( "Unknown photometric : " + std::string(argv[i]), -1 );
                 break;
+            case 'r': // prédicteur
+                if ( ++i == argc ) error ( "Error in option -r",-1 );
+                if ( strncmp ( argv[i], "none",4 ) == 0 ) predictor = Predictor::NONE;
+                else if ( strncmp ( argv[i], "horizontal",10 ) == 0 ) predictor = Predictor::HORIZONTAL;
+                else if ( strncmp ( argv[i], "floatingpoint",13 ) == 0 ) predictor = Predictor::FLOATINGPOINT;
+                else error ( "Unknown predictor : " + std::string(argv[i]), -1 );
+                break;
             case 't': // dimension de la tuile de nodata
                 if ( i+2 >= argc ) error ( "Error in option -t",-1 );
                 width = atoi ( argv[++i] );
@@ -288,6 +301,14 @@ int main ( int argc, char* argv[] ) {
         width, height
     );
 
+    if ( nodataTile == NULL ) {
+        error("Cannot create the nodata tile to write", -1);
+    }
+
+    if ( ! nodataTile->setPredictor ( predictor ) ) {
+        error("Cannot use this predictor for the nodata tile", -1);
+    }
+
     LOGGER_DEBUG ( "Write" );
     if (nodataTile->writeImage(nodataImage) < 0) {
         error("Cannot write nodata tile", -1);
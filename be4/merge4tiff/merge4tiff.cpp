@@ -387,7 +387,8 @@ int checkComponents ( FileImage* image, FileImage* mask) {
             return -1;
         }
 
-        if ( ! (( bitspersample == 32 && sampleformat == SampleFormat::FLOAT ) || ( bitspersample == 8 && sampleformat == SampleFormat::UINT )) ) {
+        if ( ! (( bitspersample == 32 && sampleformat == SampleFormat::FLOAT ) || ( bitspersample == 8 && sampleformat == SampleFormat::UINT ) ||
+                ( bitspersample == 16 && sampleformat == SampleFormat::UINT )) ) {
             LOGGER_ERROR ( "Unknown sample type (sample format + bits per sample)" );
             return -1;
         }
@@ -712,6 +713,9 @@ int merge ( FileImage* BGI, FileImage* INPUTI[2][2], FileImage* OUTPUTI, FileIma
                     if ( sizeof ( T ) == 1 ) {
                         // Cas entier : utilisation d'un gamma
                         for ( int c = 0; c < samplesperpixel; c++ ) line_outI[sampleIn/2+c] = MERGE[ ( int ) pix[c]*4/nbData];
+                    } else if ( sizeof ( T ) == 2 ) {
+                        // Cas entier 16 bits : moyenne arrondie, sans gamma
+                        for ( int c = 0; c < samplesperpixel; c++ ) line_outI[sampleIn/2+c] = ( T ) ( pix[c]/ ( float ) nbData + 0.5 );
                     } else if ( sizeof ( T ) == 4 ) {
                         for ( int c = 0; c < samplesperpixel; c++ ) line_outI[sampleIn/2+c] = pix[c]/ ( float ) nbData;
                     }
@@ -736,7 +740,7 @@ int merge ( FileImage* BGI, FileImage* INPUTI[2][2], FileImage* OUTPUTI, FileIma
 /**
  ** \~french
  * \brief Fonction principale de l'outil merge4tiff
- * \details Différencie le cas de canaux flottants sur 32 bits des canaux entier non signés sur 8 bits.
+ * \details Différencie le cas de canaux flottants sur 32 bits des canaux entier non signés sur 8 ou 16 bits.
  * \param[in] argc nombre de paramètres
  * \param[in] argv tableau des paramètres
  * \return 0 en cas de succès, -1 sinon
@@ -815,6 +819,13 @@ int main ( int argc, char* argv[] ) {
         uint8_t nodata[samplesperpixel];
         for ( int i = 0; i < samplesperpixel; i++ ) nodata[i] = ( uint8_t ) nodataInt[i];
         if ( merge ( BGI, INPUTI, OUTPUTI, OUTPUTM, nodata ) < 0 ) error ( "Unable to merge integer images",-1 );
+    }
+    // Cas entiers 16 bits
+    else if ( bitspersample == 16 && sampleformat == SampleFormat::UINT ) {
+        LOGGER_DEBUG ( "Merge images (uint16_t)" );
+        uint16_t nodata[samplesperpixel];
+        for ( int i = 0; i < samplesperpixel; i++ ) nodata[i] = ( uint16_t ) nodataInt[i];
+        if ( merge ( BGI, INPUTI, OUTPUTI, OUTPUTM, nodata ) < 0 ) error ( "Unable to merge 16-bit integer images",-1 );
     } else {
         error ( "Unhandled sample's format",-1 );
     }
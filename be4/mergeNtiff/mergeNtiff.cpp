@@ -186,7 +186,7 @@ bool debugLogger=false;
  *              -99999 for DTM
  *              255,255,255 for orthophotography
  *      -s samples per pixel : 1, 3 or 4
- *      -b bits per sample : 8 (for unsigned 8-bit integer) or 32 (for 32-bit float)
+ *      -b bits per sample : 8 or 16 (for unsigned 8 or 16-bit integer) or 32 (for 32-bit float)
  *      -p photometric :
  *              gray    min is black
  *              rgb     for image with alpha too
@@ -226,7 +226,7 @@ void usage() {
                   "            -99999 for DTM\n" <<
                   "            255,255,255 for orthophotography\n" <<
                   "    -s samples per pixel : 1, 3 or 4\n" <<
-                  "    -b bits per sample : 8 (for unsigned 8-bit integer) or 32 (for 32-bit float)\n" <<
+                  "    -b bits per sample : 8 or 16 (for unsigned 8 or 16-bit integer) or 32 (for 32-bit float)\n" <<
                   "    -p photometric :\n" <<
                   "            gray    min is black\n" <<
                   "            rgb     for image with alpha too\n" <<
@@ -330,6 +330,7 @@ int parseCommandLine ( int argc, char** argv ) {
                     return -1;
                 }
                 if ( strncmp ( argv[i], "8",1 ) == 0 ) bitspersample = 8 ;
+                else if ( strncmp ( argv[i], "16",2 ) == 0 ) bitspersample = 16 ;
                 else if ( strncmp ( argv[i], "32",2 ) == 0 ) bitspersample = 32 ;
                 else {
                     LOGGER_ERROR ( "Unknown value for option -b : " << argv[i] );
@@ -422,10 +423,17 @@ int saveImage ( Image *pImage, char* pName, uint16_t bps, uint16_t sf, uint16_t
 
     // Initialisation du buffer
     unsigned char* buf_u=0;
+    uint16_t* buf_t=0;
     float* buf_f=0;
 
     // Ecriture de l'image
-    if ( sf == SAMPLEFORMAT_UINT ) {
+    if ( sf == SAMPLEFORMAT_UINT && bps == 16 ) {
+        buf_t = ( uint16_t* ) _TIFFmalloc ( pImage->getWidth() * pImage->channels * bps / 8 );
+        for ( int line = 0; line < pImage->getHeight(); line++ ) {
+            pImage->getline ( buf_t,line );
+            TIFFWriteScanline ( output, buf_t, line, 0 );
+        }
+    } else if ( sf == SAMPLEFORMAT_UINT ) {
         buf_u = ( unsigned char* ) _TIFFmalloc ( pImage->getWidth() * pImage->channels * bps / 8 );
         for ( int line = 0; line < pImage->getHeight(); line++ ) {
             pImage->getline ( buf_u,line );
@@ -441,6 +449,7 @@ int saveImage ( Image *pImage, char* pName, uint16_t bps, uint16_t sf, uint16_t
 
     // Liberation
     if ( buf_u ) _TIFFfree ( buf_u );
+    if ( buf_t ) _TIFFfree ( buf_t );
     if ( buf_f ) _TIFFfree ( buf_f );
     TIFFClose ( output );
     return 0;
@@ -48,6 +48,7 @@
  * \li Deflate
  * \li PackBits
  * \li LZW
+ * \li Zstandard (si les bibliothèques ont été compilées avec l'option ZSTD_USE)
  * \li PNG. Cette compression a la particularité de ne pas être un standard du TIFF. Une image dans ce format, propre à ROK4, contient des tuiles qui sont des images PNG indépendantes, avec les en-têtes PNG. Cela permet de renvoyer sans traitement une tuile au format PNG. Ce fonctionnement est calqué sur le format TIFF/JPEG.
  *
  * On va également définir la taille des tuiles, qui doit être cohérente avec la taille de l'image entière (on veut un nombre de tuiles entier).
@@ -83,7 +84,7 @@ int white[4] = {255,255,255,255};
  * 
  * Make image tiled and compressed, in TIFF format, respecting ROK4 specifications.
  * 
- * Usage: tiff2tile -c <VAL> -t <VAL> <VAL> <INPUT FILE> <OUTPUT FILE> [-crop]
+ * Usage: tiff2tile -c <VAL> -t <VAL> <VAL> [-e <VAL>] [-p <VAL>] [-l <VAL>] [-u] <INPUT FILE> <OUTPUT FILE> [-crop] [-dedup]
  * 
  * Parameters:
  *      -c output compression :
@@ -93,16 +94,22 @@ int white[4] = {255,255,255,255};
  *              lzw     Lempel-Ziv & Welch encoding
  *              pkb     PackBits encoding
  *              zip     Deflate encoding
+ *              zstd    Zstandard encoding (only if built with zstd)
  *              png     Non-official TIFF compression, each tile is an independant PNG image (with PNG header)
  *      -t tile size : widthwise and heightwise. Have to be a divisor of the global image's size
+ *      -e encoder profile (png, zip and jpg compressions) : fast, balanced (default) or small
+ *      -p TIFF predictor (lzw, zip and zstd compressions) : none (default), horizontal (integer samples) or floatingpoint (float samples)
+ *      -l compression level (zstd compression) : from 1 to 22, 3 by default
+ *      -u uniform tiles are indexed as constant tiles (only the pixel value is written, TIFF readers other than ROK4 see them as missing tiles)
  *      -crop : blocks (used by JPEG compression) wich contain a white pixel are filled with white
+ *      -dedup : identical encoded tiles are written once, the index of the duplicates points to the first occurrence
  *      -d debug logger activation
  * 
  * Examples
  *      - for orthophotography
  *      tiff2tile input.tif -c png -t 256 256 output.tif
  *      - for DTM
- *      tiff2tile input.tif -c zip -t 256 256 output.tif
+ *      tiff2tile input.tif -c zip -p floatingpoint -t 256 256 output.tif
  * 
  * \endcode
  */
@@ -111,7 +118,7 @@ void usage() {
 
                   "Make image tiled and compressed, in TIFF format, respecting ROK4 specifications.\n\n" <<
 
-                  "Usage: tiff2tile -c <VAL> -t <VAL> <VAL> <INPUT FILE> <OUTPUT FILE> [-crop]\n\n" <<
+                  "Usage: tiff2tile -c <VAL> -t <VAL> <VAL> [-e <VAL>] [-p <VAL>] [-l <VAL>] [-u] <INPUT FILE> <OUTPUT FILE> [-crop] [-dedup]\n\n" <<
 
                   "Parameters:\n" <<
                   "     -c output compression :\n" <<
@@ -121,16 +128,22 @@ void usage() {
                   "             lzw     Lempel-Ziv & Welch encoding\n" <<
                   "             pkb     PackBits encoding\n" <<
                   "             zip     Deflate encoding\n" <<
+                  "             zstd    Zstandard encoding (only if built with zstd)\n" <<
                   "             png     Non-official TIFF compression, each tile is an independant PNG image (with PNG header)\n" <<
                   "     -t tile size : widthwise and heightwise. Have to be a divisor of the global image's size\n" <<
+                  "     -e encoder profile (png, zip and jpg compressions) : fast, balanced (default) or small\n" <<
+                  "     -p TIFF predictor (lzw, zip and zstd compressions) : none (default), horizontal (integer samples) or floatingpoint (float samples)\n" <<
+                  "     -l compression level (zstd compression) : from 1 to 22, 3 by default\n" <<
+                  "     -u uniform tiles are indexed as constant tiles (only the pixel value is written, TIFF readers other than ROK4 see them as missing tiles)\n" <<
                   "     -crop : blocks (used by JPEG compression) wich contain a white pixel are filled with white\n" <<
+                  "     -dedup : identical encoded tiles are written once, the index of the duplicates points to the first occurrence\n" <<
                   "     -d : debug logger activation\n\n" <<
 
                   "Examples\n" <<
                   "     - for orthophotography\n" <<
                   "     tiff2tile input.tif -c png -t 256 256 output.tif\n" <<
                   "     - for DTM\n" <<
-                  "     tiff2tile input.tif -c zip -t 256 256 output.tif\n\n" );
+                  "     tiff2tile input.tif -c zip -p floatingpoint -t 256 256 output.tif\n\n" );
 }
 
 /**
@@ -167,6 +180,11 @@ int main ( int argc, char **argv ) {
     Compression::eCompression compression = Compression::NONE;
     bool crop = false;
     bool debugLogger=false;
+    const EncoderProfile* profile = EncoderProfile::getDefault();
+    Predictor::ePredictor predictor = Predictor::NONE;
+    int zstdLevel = ZSTD_DEFAULT_LEVEL;
+    bool constantTiles = false;
+    bool deduplicate = false;
 
     /* Initialisation des Loggers */
     Logger::setOutput ( STANDARD_OUTPUT_STREAM_FOR_ERRORS );
@@ -187,6 +205,10 @@ int main ( int argc, char **argv ) {
             crop = true;
             continue;
         }
+        if ( !strcmp ( argv[i],"-dedup" ) ) {
+            deduplicate = true;
+            continue;
+        }
         if ( argv[i][0] == '-' ) {
             switch ( argv[i][1] ) {
                 case 'h': // help
@@ -209,6 +231,8 @@ int main ( int argc, char **argv ) {
                         compression = Compression::DEFLATE;
                     } else if ( strncmp ( argv[i], "pkb",3 ) == 0 ) {
                         compression = Compression::PACKBITS;
+                    } else if ( strncmp ( argv[i], "zstd",4 ) == 0 ) {
+                        compression = Compression::ZSTD;
                     } else {
                         error ( "Unknown compression : " + string(argv[i]), -1 );
                     }
@@ -218,6 +242,30 @@ int main ( int argc, char **argv ) {
                     tileWidth = atoi ( argv[++i] );
                     tileHeight = atoi ( argv[++i] );
                     break;
+                case 'e': // encoder profile
+                    if ( ++i == argc ) { error ( "Error in -e option", -1 ); }
+                    profile = EncoderProfile::get ( argv[i] );
+                    if ( ! profile ) { error ( "Unknown encoder profile : " + string(argv[i]), -1 ); }
+                    break;
+                case 'p': // predictor
+                    if ( ++i == argc ) { error ( "Error in -p option", -1 ); }
+                    if ( strncmp ( argv[i], "none",4 ) == 0 ) {
+                        predictor = Predictor::NONE;
+                    } else if ( strncmp ( argv[i], "horizontal",10 ) == 0 ) {
+                        predictor = Predictor::HORIZONTAL;
+                    } else if ( strncmp ( argv[i], "floatingpoint",13 ) == 0 ) {
+                        predictor = Predictor::FLOATINGPOINT;
+                    } else {
+                        error ( "Unknown predictor : " + string(argv[i]), -1 );
+                    }
+                    break;
+                case 'l': // zstd compression level
+                    if ( ++i == argc ) { error ( "Error in -l option", -1 ); }
+                    zstdLevel = atoi ( argv[i] );
+                    break;
+                case 'u': // constant tiles
+                    constantTiles = true;
+                    break;
                 default:
                     error ( "Unknown option : " + string(argv[i]) ,-1 );
             }
@@ -285,10 +333,22 @@ int main ( int argc, char **argv ) {
     );
     
     rok4Image->setExtraSample(sourceImage->getExtraSample());
+    rok4Image->setEncoderProfile(profile);
     
     if (rok4Image == NULL) {
         error("Cannot create the ROK4 image to write", -1);
     }
+
+    if ( ! rok4Image->setPredictor ( predictor ) ) {
+        error("Cannot use this predictor for the ROK4 image to write", -1);
+    }
+
+    if ( ! rok4Image->setZstdLevel ( zstdLevel ) ) {
+        error("Cannot use this compression level for the ROK4 image to write", -1);
+    }
+
+    rok4Image->setConstantTiles ( constantTiles );
+    rok4Image->setDeduplicateTiles ( deduplicate );
     
     if (debugLogger) {
         rok4Image->print();
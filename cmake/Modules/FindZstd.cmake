@@ -0,0 +1,26 @@
+
+# CMake module to search for Zstandard library
+#
+# If it's found it sets ZSTD_FOUND to TRUE
+# and following variables are set:
+#    ZSTD_INCLUDE_DIR
+#    ZSTD_LIBRARY
+#
+# La bibliothèque n'est pas fournie dans lib/ : elle est cherchée dans ${DEP_PATH}
+# puis dans les répertoires du système
+
+FIND_PATH(ZSTD_INCLUDE_DIR NAMES zstd.h PATHS
+    ${DEP_PATH}/include
+    /usr/local/include
+    /usr/include
+    c:/msys/local/include
+    )
+FIND_LIBRARY(ZSTD_LIBRARY NAMES libzstd.a zstd PATHS
+    ${DEP_PATH}/lib
+    /usr/local/lib
+    /usr/lib
+    c:/msys/local/lib
+    )
+
+INCLUDE( "FindPackageHandleStandardArgs" )
+FIND_PACKAGE_HANDLE_STANDARD_ARGS( "Zstd" DEFAULT_MSG ZSTD_INCLUDE_DIR ZSTD_LIBRARY )
@@ -209,6 +209,20 @@ ELSE(KDU_USE)
     endif(NOT TARGET jpeg2000)
 ENDIF(KDU_USE)
 
+IF(ZSTD_USE)
+    if(NOT TARGET zstd)
+        find_package(Zstd)
+        if(ZSTD_FOUND)
+          add_library(zstd STATIC IMPORTED)
+          set_property(TARGET zstd PROPERTY IMPORTED_LOCATION ${ZSTD_LIBRARY})
+          message(STATUS "    Zstd's headers' directory : ${ZSTD_INCLUDE_DIR}")
+          message(STATUS "    'libzstd.a' : ${ZSTD_LIBRARY}")
+        else(ZSTD_FOUND)
+          message(FATAL_ERROR "Cannot find extern library zstd")
+        endif(ZSTD_FOUND)
+    endif(NOT TARGET zstd)
+ENDIF(ZSTD_USE)
+
 if(NOT TARGET image)
 find_package(Image)
 if(IMAGE_FOUND)
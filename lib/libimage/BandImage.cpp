@@ -0,0 +1,187 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file BandImage.cpp
+ * \~french
+ * \brief Implémentation de la classe BandImage, image découpée en bandes horizontales calculées en parallèle
+ * \~english
+ * \brief Implement the BandImage class, image split into horizontal bands computed in parallel
+ */
+
+#include "BandImage.h"
+#include "Logger.h"
+
+static int computeHeight ( std::vector<Image*>& bands ) {
+    int height = 0;
+    for ( int i = 0; i < bands.size(); i++ ) height += bands[i]->getHeight();
+    return height;
+}
+
+static BoundingBox<double> computeBbox ( std::vector<Image*>& bands ) {
+    return BoundingBox<double> ( bands.front()->getXmin(), bands.back()->getYmin(), bands.front()->getXmax(), bands.front()->getYmax() );
+}
+
+BandImage::BandImage ( std::vector<Image*>& bands, TaskPool* pool, TileTable* tileTable ) :
+    Image ( bands.front()->getWidth(), computeHeight ( bands ), bands.front()->channels, computeBbox ( bands ) ),
+    bands ( bands ), tileTable ( tileTable ), token ( CancellationToken::getCurrent() ),
+    sampleSize ( 0 ), pending ( 0 ), abandoned ( false ), currentBand ( 0 ) {
+
+    this->pool = ( pool && pool->getThreads() > 0 ) ? pool : NULL;
+
+    int top = 0;
+    for ( int i = 0; i < bands.size(); i++ ) {
+        tops.push_back ( top );
+        top += bands[i]->getHeight();
+        BandTask task;
+        task.image = this;
+        task.band = i;
+        tasks.push_back ( task );
+        buffers.push_back ( NULL );
+        computed.push_back ( false );
+    }
+
+    pthread_mutex_init ( &mutex, NULL );
+    pthread_cond_init ( &done, NULL );
+}
+
+BandImage::~BandImage() {
+    pthread_mutex_lock ( &mutex );
+    abandoned = true;
+    while ( pending > 0 ) {
+        pthread_cond_wait ( &done, &mutex );
+    }
+    pthread_mutex_unlock ( &mutex );
+
+    for ( int i = 0; i < bands.size(); i++ ) {
+        delete bands[i];
+        delete [] buffers[i];
+    }
+    delete tileTable;
+
+    pthread_cond_destroy ( &done );
+    pthread_mutex_destroy ( &mutex );
+}
+
+template<typename T>
+void* BandImage::computeBand ( void* arg ) {
+    BandTask* task = ( BandTask* ) arg;
+    BandImage* image = task->image;
+
+    pthread_mutex_lock ( &image->mutex );
+    bool skip = image->abandoned;
+    pthread_mutex_unlock ( &image->mutex );
+
+    if ( ! skip ) {
+        CancellationToken::setCurrent ( image->token );
+        // L'arène de la requête reste réservée au thread appelant : les bandes calculées ici allouent dans le tas
+        MemoryArena::setCurrent ( NULL );
+        Image* band = image->bands[task->band];
+        band->getBlock ( 0, 0, band->getWidth(), band->getHeight(), ( T* ) image->buffers[task->band], image->width * image->channels );
+        CancellationToken::setCurrent ( NULL );
+    }
+
+    pthread_mutex_lock ( &image->mutex );
+    image->computed[task->band] = true;
+    image->pending--;
+    pthread_cond_broadcast ( &image->done );
+    pthread_mutex_unlock ( &image->mutex );
+
+    return 0;
+}
+
+template<typename T>
+void BandImage::start() {
+    sampleSize = sizeof ( T );
+    if ( ! pool ) return;
+
+    pthread_mutex_lock ( &mutex );
+    pending = bands.size() - 1;
+    pthread_mutex_unlock ( &mutex );
+
+    for ( int i = 1; i < bands.size(); i++ ) {
+        buffers[i] = new uint8_t[ ( size_t ) bands[i]->getHeight() * width * channels * sizeof ( T )];
+        pool->submit ( BandImage::computeBand<T>, ( void* ) & ( tasks[i] ) );
+    }
+}
+
+void BandImage::waitBand ( int band ) {
+    pthread_mutex_lock ( &mutex );
+    while ( ! computed[band] ) {
+        pthread_cond_wait ( &done, &mutex );
+    }
+    pthread_mutex_unlock ( &mutex );
+}
+
+template<typename T>
+int BandImage::_getline ( T* buffer, int line ) {
+    if ( line < 0 || line >= height ) return 0;
+
+    if ( sampleSize == 0 ) start<T>();
+
+    while ( line < tops[currentBand] ) currentBand--;
+    while ( line >= tops[currentBand] + bands[currentBand]->getHeight() ) currentBand++;
+    int band = currentBand;
+
+    // Première bande, ou lecture séquentielle
+    if ( band == 0 || ! pool ) {
+        return bands[band]->getline ( buffer, line - tops[band] );
+    }
+
+    waitBand ( band );
+
+    if ( sizeof ( T ) != sampleSize ) {
+        // La bande a été calculée dans un autre type : on la relit directement
+        return bands[band]->getline ( buffer, line - tops[band] );
+    }
+
+    size_t lineSize = width * channels * sizeof ( T );
+    memcpy ( buffer, buffers[band] + ( line - tops[band] ) * lineSize, lineSize );
+    return width * channels;
+}
+
+int BandImage::getline ( uint8_t* buffer, int line ) {
+    return _getline ( buffer, line );
+}
+
+int BandImage::getline ( uint16_t* buffer, int line ) {
+    return _getline ( buffer, line );
+}
+
+int BandImage::getline ( float* buffer, int line ) {
+    return _getline ( buffer, line );
+}
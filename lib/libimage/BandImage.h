@@ -0,0 +1,220 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file BandImage.h
+ * \~french
+ * \brief Définition de la classe BandImage, image découpée en bandes horizontales calculées en parallèle
+ * \~english
+ * \brief Define the BandImage class, image split into horizontal bands computed in parallel
+ */
+
+#ifndef BAND_IMAGE_H
+#define BAND_IMAGE_H
+
+#include <pthread.h>
+#include <vector>
+#include "Image.h"
+#include "TaskPool.h"
+#include "TileTable.h"
+#include "CancellationToken.h"
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Image découpée en bandes horizontales, calculées en parallèle
+ * \details Chaque bande est une image indépendante (sa propre chaîne de traitements), de la même largeur. À la première ligne demandée, toutes les bandes sauf la première sont soumises à l'ensemble de threads, qui les calcule dans des buffers. La première bande est lue directement par le thread appelant, pendant ce temps. Les lignes des autres bandes sont ensuite copiées depuis leur buffer, dès que la bande est calculée.
+ *
+ * Le jeton d'annulation du thread construisant l'image est transmis aux threads de calcul. Son arène mémoire ne l'est pas : elle n'est pas protégée contre les accès concurrents, les threads de calcul allouent dans le tas.
+ * \~english
+ * \brief Image split into horizontal bands, computed in parallel
+ * \details Each band is an independent image (its own processing chain), with the same width. On the first asked line, all bands but the first one are submitted to the threads pool, which computes them into buffers. The first band is directly read by the calling thread, meanwhile. Lines of other bands are then copied from their buffer, as soon as the band is computed.
+ *
+ * The cancellation token of the thread building the image is given to computing threads. Its memory arena is not : it is not protected against concurrent accesses, computing threads allocate in the heap.
+ */
+class BandImage : public Image {
+
+private:
+    /**
+     * \~french \brief Tâche de calcul d'une bande
+     * \~english \brief Band computing task
+     */
+    struct BandTask {
+        BandImage* image;
+        int band;
+    };
+
+    /**
+     * \~french \brief Bandes, de haut en bas
+     * \~english \brief Bands, from top to bottom
+     */
+    std::vector<Image*> bands;
+    /**
+     * \~french \brief Première ligne de chaque bande
+     * \~english \brief First line of each band
+     */
+    std::vector<int> tops;
+    /**
+     * \~french \brief Tâches de calcul, une par bande
+     * \~english \brief Computing tasks, one per band
+     */
+    std::vector<BandTask> tasks;
+    /**
+     * \~french \brief Bandes calculées, NULL pour la première
+     * \~english \brief Computed bands, NULL for the first one
+     */
+    std::vector<uint8_t*> buffers;
+    /**
+     * \~french \brief La bande est-elle calculée ?
+     * \~english \brief Is the band computed ?
+     */
+    std::vector<bool> computed;
+
+    /**
+     * \~french \brief Threads calculant les bandes, NULL pour tout calculer dans le thread appelant
+     * \~english \brief Threads computing bands, NULL to compute everything in the calling thread
+     */
+    TaskPool* pool;
+    /**
+     * \~french \brief Table des tuiles partagées entre les bandes, possédée par l'image, NULL si aucune
+     * \~english \brief Tiles table shared between bands, owned by the image, NULL if none
+     */
+    TileTable* tileTable;
+    /**
+     * \~french \brief Jeton d'annulation de la requête
+     * \~english \brief Request's cancellation token
+     */
+    CancellationToken* token;
+
+    /**
+     * \~french \brief Taille d'un échantillon des buffers, 0 tant que le calcul n'est pas lancé
+     * \~english \brief Buffers' sample size, 0 until computation is started
+     */
+    size_t sampleSize;
+    /**
+     * \~french \brief Nombre de tâches soumises et non terminées
+     * \~english \brief Number of submitted and not finished tasks
+     */
+    int pending;
+    /**
+     * \~french \brief Les tâches pas encore commencées doivent-elles être ignorées ?
+     * \~english \brief Have not yet started tasks to be skipped ?
+     */
+    bool abandoned;
+    /**
+     * \~french \brief Bande de la dernière ligne demandée
+     * \~english \brief Band of the last asked line
+     */
+    int currentBand;
+
+    /**
+     * \~french \brief Protège l'état des tâches
+     * \~english \brief Protect tasks' state
+     */
+    pthread_mutex_t mutex;
+    /**
+     * \~french \brief Signale la fin du calcul d'une bande
+     * \~english \brief Signal a band computation end
+     */
+    pthread_cond_t done;
+
+    /**
+     * \~french \brief Calcule une bande dans son buffer, exécutée par l'ensemble de threads
+     * \~english \brief Compute a band into its buffer, run by the threads pool
+     */
+    template<typename T>
+    static void* computeBand ( void* arg );
+
+    /**
+     * \~french \brief Alloue les buffers et soumet le calcul des bandes
+     * \~english \brief Allocate buffers and submit bands computation
+     */
+    template<typename T>
+    void start();
+
+    /**
+     * \~french \brief Attend la fin du calcul d'une bande
+     * \~english \brief Wait for a band computation end
+     */
+    void waitBand ( int band );
+
+    template<typename T>
+    int _getline ( T* buffer, int line );
+
+public:
+    /**
+     * \~french
+     * \brief Crée une image à partir de ses bandes
+     * \param[in] bands bandes, de haut en bas, de même largeur et même nombre de canaux, possédées ensuite par l'image
+     * \param[in] pool threads calculant les bandes, NULL ou vide pour les lire séquentiellement
+     * \param[in] tileTable table des tuiles partagées entre les bandes, libérée avec l'image, NULL si aucune
+     * \~english
+     * \brief Create an image from its bands
+     * \param[in] bands bands, from top to bottom, with the same width and the same samples per pixel, then owned by the image
+     * \param[in] pool threads computing bands, NULL or empty to read them sequentially
+     * \param[in] tileTable tiles table shared between bands, freed with the image, NULL if none
+     */
+    BandImage ( std::vector<Image*>& bands, TaskPool* pool, TileTable* tileTable = NULL );
+
+    int getline ( uint8_t* buffer, int line );
+    int getline ( uint16_t* buffer, int line );
+    int getline ( float* buffer, int line );
+
+    /**
+     * \~french
+     * \brief Destructeur
+     * \details Les bandes en cours de calcul sont attendues, celles pas encore commencées sont abandonnées. Les bandes sont supprimées, puis la table des tuiles.
+     * \~english
+     * \brief Destructor
+     * \details Bands being computed are waited for, not yet started ones are given up. Bands are removed, then tiles table.
+     */
+    ~BandImage();
+
+    /** \~french
+     * \brief Sortie des informations sur l'image découpée en bandes
+     ** \~english
+     * \brief Band image description output
+     */
+    void print() {
+        LOGGER_INFO ( "" );
+        LOGGER_INFO ( "------ BandImage -------" );
+        Image::print();
+        LOGGER_INFO ( "\t- Number of bands = " << bands.size() );
+    }
+};
+
+#endif
@@ -39,6 +39,7 @@
 
 #include "BilEncoder.h"
 #include "Logger.h"
+#include "CancellationToken.h"
 
 size_t BilEncoder::read ( uint8_t *buffer, size_t size ) {
     size_t offset = 0;
@@ -49,6 +50,11 @@ size_t BilEncoder::read ( uint8_t *buffer, size_t size ) {
     // Hypothese 2 : le pixel de l'image source est de type float
     float* buf_f=new float[image->getWidth() *image->channels];
     for ( ; line < image->getHeight() && offset + linesize <= size; line++ ) {
+        if ( CancellationToken::currentCancelled() ) {
+            // Requête annulée : le flux est terminé
+            line = image->getHeight();
+            break;
+        }
 
         //	image->getline(buffer + offset, line);
         image->getline ( buf_f,line );
@@ -46,6 +46,7 @@
 #include "CRS.h"
 #include "Logger.h"
 #include <proj_api.h>
+#include <cmath>
 
 /**
  * \~french \brief Transforme la chaîne fournie en minuscule
@@ -387,6 +388,65 @@ bool CRS::testProj4Param ( std::string paramName ) {
 }
 
 
+bool CRS::getAffineTransform ( CRS& to, BoundingBox<double> extent, double tolerance, double& Ax, double& Bx, double& Ay, double& By ) {
+    // Nombre de points testés dans chaque direction
+    const int n = 9;
+    double X[n*n], Y[n*n], srcX[n*n], srcY[n*n];
+
+    if ( extent.xmax <= extent.xmin || extent.ymax <= extent.ymin ) return false;
+
+    for ( int j = 0; j < n; j++ ) {
+        for ( int i = 0; i < n; i++ ) {
+            srcX[n*j + i] = X[n*j + i] = extent.xmin + ( extent.xmax - extent.xmin ) * i / ( n - 1 );
+            srcY[n*j + i] = Y[n*j + i] = extent.ymin + ( extent.ymax - extent.ymin ) * j / ( n - 1 );
+        }
+    }
+
+    pthread_mutex_lock ( & mutex_proj );
+
+    projCtx ctx = pj_ctx_alloc();
+    projPJ pj_src = pj_init_plus_ctx ( ctx, ( "+init=" + getProj4Code() +" +wktext" ).c_str() );
+    projPJ pj_dst = pj_init_plus_ctx ( ctx, ( "+init=" + to.getProj4Code() +" +wktext +over" ).c_str() );
+
+    int code = -1;
+    if ( pj_src && pj_dst ) {
+        if ( pj_is_latlong ( pj_src ) )
+            for ( int i = 0; i < n*n; i++ ) {
+                X[i] *= DEG_TO_RAD;
+                Y[i] *= DEG_TO_RAD;
+            }
+        code = pj_transform ( pj_src, pj_dst, n*n, 0, X, Y, 0 );
+        if ( code == 0 && pj_is_latlong ( pj_dst ) )
+            for ( int i = 0; i < n*n; i++ ) {
+                X[i] *= RAD_TO_DEG;
+                Y[i] *= RAD_TO_DEG;
+            }
+    }
+
+    if ( pj_src ) pj_free ( pj_src );
+    if ( pj_dst ) pj_free ( pj_dst );
+    pj_ctx_free ( ctx );
+    pthread_mutex_unlock ( & mutex_proj );
+
+    if ( code != 0 ) return false;
+
+    // Transformation déduite des coins, vérifiée sur tous les points
+    Ax = ( X[n-1] - X[0] ) / ( srcX[n-1] - srcX[0] );
+    Bx = X[0] - Ax * srcX[0];
+    Ay = ( Y[n* ( n-1 )] - Y[0] ) / ( srcY[n* ( n-1 )] - srcY[0] );
+    By = Y[0] - Ay * srcY[0];
+
+    if ( ! ( Ax > 0 ) || ! ( Ay > 0 ) ) return false;
+
+    for ( int i = 0; i < n*n; i++ ) {
+        if ( X[i] == HUGE_VAL || Y[i] == HUGE_VAL ) return false;
+        if ( fabs ( X[i] - ( Ax * srcX[i] + Bx ) ) > tolerance ) return false;
+        if ( fabs ( Y[i] - ( Ay * srcY[i] + By ) ) > tolerance ) return false;
+    }
+
+    return true;
+}
+
 
 CRS::~CRS() {
 
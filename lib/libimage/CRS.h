@@ -463,6 +463,32 @@ public:
      * \return bool
      */
     bool testProj4Param( std::string paramName );
+
+    /**
+     * \~french
+     * \brief Cherche une transformation affine exacte vers un autre CRS
+     * \details On reprojette une grille de points régulièrement répartis sur l'emprise et on vérifie que les coordonnées obtenues s'écrivent X' = Ax.X + Bx et Y' = Ay.Y + By (Ax et Ay positifs), à la tolérance près. C'est le cas de deux CRS identiques à l'ordre des axes près, ou ne différant que par une fausse origine.
+     * \param[in] to CRS de destination
+     * \param[in] extent emprise à tester, dans le CRS courant
+     * \param[in] tolerance écart maximal admis, dans les unités du CRS de destination
+     * \param[out] Ax homothétie en X
+     * \param[out] Bx translation en X
+     * \param[out] Ay homothétie en Y
+     * \param[out] By translation en Y
+     * \return vrai si la transformation est affine sur l'emprise
+     * \~english
+     * \brief Look for an exact affine transformation to another CRS
+     * \details A regular points' grid over the extent is reprojected and we check that coordinates are X' = Ax.X + Bx and Y' = Ay.Y + By (positive Ax and Ay), with the tolerance. It is the case of two CRS identical up to axis order, or only differing by a false origin.
+     * \param[in] to destination CRS
+     * \param[in] extent extent to test, in the current CRS
+     * \param[in] tolerance maximal gap, in destination CRS units
+     * \param[out] Ax X scale
+     * \param[out] Bx X translation
+     * \param[out] Ay Y scale
+     * \param[out] By Y translation
+     * \return true if the transformation is affine over the extent
+     */
+    bool getAffineTransform ( CRS& to, BoundingBox<double> extent, double tolerance, double& Ax, double& Bx, double& Ay, double& By );
     
     /**
      * \~french
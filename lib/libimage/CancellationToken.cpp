@@ -0,0 +1,121 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file CancellationToken.cpp
+ * \~french
+ * \brief Implémentation de la classe CancellationToken, permettant d'interrompre le calcul d'une réponse
+ * \~english
+ * \brief Implement the CancellationToken class, used to interrupt a response computation
+ */
+
+#include "CancellationToken.h"
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include <cstddef>
+
+/**
+ * \~french \brief Intervalle minimal entre deux vérifications de la connexion, en microsecondes
+ * \~english \brief Minimal interval between two connection checks, in microseconds
+ */
+#define CONNECTION_PROBE_INTERVAL 100000
+
+static pthread_once_t token_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t token_key;
+
+static void init_token_key() {
+    pthread_key_create ( &token_key, 0 );
+}
+
+CancellationToken::CancellationToken ( int timeout, int connection ) : cancelled ( false ), timedOut ( false ),
+    hasDeadline ( timeout > 0 ), connection ( connection ) {
+    gettimeofday ( &lastProbe, NULL );
+    deadline = lastProbe;
+    if ( hasDeadline ) {
+        long usec = deadline.tv_usec + ( timeout % 1000 ) * 1000L;
+        deadline.tv_sec += timeout / 1000 + usec / 1000000L;
+        deadline.tv_usec = usec % 1000000L;
+    }
+}
+
+bool CancellationToken::isCancelled() {
+    if ( cancelled ) {
+        return true;
+    }
+    if ( !hasDeadline && connection < 0 ) {
+        return false;
+    }
+
+    struct timeval now;
+    gettimeofday ( &now, NULL );
+    if ( hasDeadline && timercmp ( &now, &deadline, >= ) ) {
+        timedOut = true;
+        cancelled = true;
+        return true;
+    }
+
+    if ( connection >= 0 && ( now.tv_sec - lastProbe.tv_sec ) * 1000000L + ( now.tv_usec - lastProbe.tv_usec ) >= CONNECTION_PROBE_INTERVAL ) {
+        lastProbe = now;
+        // Une lecture de 0 octet signifie que l'autre extrémité a fermé la connexion
+        char c;
+        ssize_t r = recv ( connection, &c, 1, MSG_PEEK | MSG_DONTWAIT );
+        if ( r == 0 || ( r < 0 && ( errno == ECONNRESET || errno == ENOTCONN || errno == EPIPE ) ) ) {
+            cancelled = true;
+        } else if ( r < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR ) {
+            // Descripteur inexploitable (pas une socket...) : la connexion n'est plus surveillée
+            connection = -1;
+        }
+    }
+    return cancelled;
+}
+
+void CancellationToken::setCurrent ( CancellationToken* token ) {
+    pthread_once ( &token_key_once, init_token_key );
+    pthread_setspecific ( token_key, token );
+}
+
+CancellationToken* CancellationToken::getCurrent() {
+    pthread_once ( &token_key_once, init_token_key );
+    return ( CancellationToken* ) pthread_getspecific ( token_key );
+}
+
+bool CancellationToken::currentCancelled() {
+    CancellationToken* token = getCurrent();
+    return ( token != NULL && token->isCancelled() );
+}
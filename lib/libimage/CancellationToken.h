@@ -0,0 +1,178 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file CancellationToken.h
+ * \~french
+ * \brief Définition de la classe CancellationToken, permettant d'interrompre le calcul d'une réponse
+ * \~english
+ * \brief Define the CancellationToken class, used to interrupt a response computation
+ */
+
+#ifndef CANCELLATION_TOKEN_H
+#define CANCELLATION_TOKEN_H
+
+#include <sys/time.h>
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Jeton d'annulation d'une requête
+ * \details Un jeton est annulé explicitement, quand son échéance est dépassée ou quand la connexion surveillée est fermée par le client. Le jeton de la requête en cours est associé au thread qui la traite : les encodeurs, les images rééchantillonnées ou reprojetées et les lectures de tuiles le consultent régulièrement via currentCancelled() et abandonnent leur travail au plus tôt. La réponse produite est alors tronquée.
+ * \~english
+ * \brief Request cancellation token
+ * \details A token is cancelled explicitly, when its deadline is exceeded or when the watched connection is closed by the client. The current request's token is bound to the thread processing it : encoders, resampled or reprojected images and tile readings regularly check it through currentCancelled() and give up as soon as possible. The produced response is then truncated.
+ */
+class CancellationToken {
+
+private:
+    /**
+     * \~french \brief Le jeton a-t-il été annulé ?
+     * \~english \brief Has the token been cancelled ?
+     */
+    volatile bool cancelled;
+    /**
+     * \~french \brief L'annulation est-elle due à l'échéance ?
+     * \~english \brief Is the cancellation due to the deadline ?
+     */
+    bool timedOut;
+    /**
+     * \~french \brief Le jeton a-t-il une échéance ?
+     * \~english \brief Has the token a deadline ?
+     */
+    bool hasDeadline;
+    /**
+     * \~french \brief Échéance
+     * \~english \brief Deadline
+     */
+    struct timeval deadline;
+    /**
+     * \~french \brief Descripteur de la connexion surveillée, -1 si aucune
+     * \~english \brief Watched connection descriptor, -1 if none
+     */
+    int connection;
+    /**
+     * \~french \brief Date de la dernière vérification de la connexion
+     * \~english \brief Last connection check date
+     */
+    struct timeval lastProbe;
+
+public:
+    /**
+     * \~french
+     * \brief Constructeur
+     * \param[in] timeout délai avant l'échéance, en millisecondes, 0 pour ne pas en avoir
+     * \param[in] connection descripteur de la connexion à surveiller, -1 pour aucune
+     * \~english
+     * \brief Constructor
+     * \param[in] timeout delay before the deadline, in milliseconds, 0 for none
+     * \param[in] connection descriptor of the connection to watch, -1 for none
+     */
+    CancellationToken ( int timeout = 0, int connection = -1 );
+
+    /**
+     * \~french
+     * \brief Annule le jeton
+     * \~english
+     * \brief Cancel the token
+     */
+    void cancel() {
+        cancelled = true;
+    }
+
+    /**
+     * \~french
+     * \brief Change la connexion surveillée
+     * \param[in] connection descripteur de la connexion, -1 pour ne plus en surveiller
+     * \~english
+     * \brief Change the watched connection
+     * \param[in] connection connection descriptor, -1 to stop watching
+     */
+    void watchConnection ( int connection ) {
+        this->connection = connection;
+    }
+
+    /**
+     * \~french
+     * \brief Le jeton est-il annulé ?
+     * \details L'échéance est vérifiée à chaque appel, la connexion au plus toutes les 100 millisecondes.
+     * \~english
+     * \brief Is the token cancelled ?
+     * \details The deadline is checked on each call, the connection every 100 milliseconds at most.
+     */
+    bool isCancelled();
+
+    /**
+     * \~french
+     * \brief L'annulation est-elle due à l'échéance ?
+     * \~english
+     * \brief Is the cancellation due to the deadline ?
+     */
+    bool isTimedOut() {
+        return timedOut;
+    }
+
+    /**
+     * \~french
+     * \brief Associe un jeton au thread courant
+     * \param[in] token jeton de la requête traitée, NULL une fois la requête terminée
+     * \~english
+     * \brief Bind a token to the current thread
+     * \param[in] token processed request token, NULL once the request is over
+     */
+    static void setCurrent ( CancellationToken* token );
+
+    /**
+     * \~french
+     * \brief Retourne le jeton associé au thread courant, NULL si aucun
+     * \~english
+     * \brief Return the token bound to the current thread, NULL if none
+     */
+    static CancellationToken* getCurrent();
+
+    /**
+     * \~french
+     * \brief Le jeton associé au thread courant est-il annulé ?
+     * \return faux si aucun jeton n'est associé au thread
+     * \~english
+     * \brief Is the token bound to the current thread cancelled ?
+     * \return false if no token is bound to the thread
+     */
+    static bool currentCancelled();
+};
+
+#endif
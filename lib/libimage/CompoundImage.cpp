@@ -89,6 +89,54 @@ int CompoundImage::getline ( float* buffer, int line ) {
     return _getline ( buffer, line );
 }
 
+template<typename T>
+inline int CompoundImage::_getBlock ( int x, int y, int w, int h, T* buffer, int stride ) {
+    if ( ! isBlockInside ( x, y, w, h ) ) return 0;
+
+    // On parcourt les sous-images par ligne puis par colonne, sans toucher à l'état utilisé par getline
+    int subTop = 0;
+    for ( int iy = 0; iy < images.size() && subTop < y + h; iy++ ) {
+        int subHeight = images[iy][0]->getHeight();
+        int y0 = __max ( y, subTop );
+        int y1 = __min ( y + h, subTop + subHeight );
+        if ( y0 < y1 ) {
+            int subLeft = 0;
+            for ( int ix = 0; ix < images[iy].size() && subLeft < x + w; ix++ ) {
+                int subWidth = images[iy][ix]->getWidth();
+                int x0 = __max ( x, subLeft );
+                int x1 = __min ( x + w, subLeft + subWidth );
+                if ( x0 < x1 ) {
+                    T* sub = buffer + ( y0 - y ) * stride + ( x0 - x ) * channels;
+                    if ( images[iy][ix]->getConstantColor() ) {
+                        // Sous-image uniforme : une seule ligne est demandée, puis recopiée
+                        if ( images[iy][ix]->getBlock ( x0 - subLeft, y0 - subTop, x1 - x0, 1, sub, stride ) == 0 ) return 0;
+                        for ( int l = 1; l < y1 - y0; l++ ) memcpy ( sub + l * stride, sub, ( x1 - x0 ) * channels * sizeof ( T ) );
+                    } else if ( images[iy][ix]->getBlock ( x0 - subLeft, y0 - subTop, x1 - x0, y1 - y0, sub, stride ) == 0 ) return 0;
+                }
+                subLeft += subWidth;
+            }
+        }
+        subTop += subHeight;
+    }
+
+    return w * h * channels;
+}
+
+/** D */
+int CompoundImage::getBlock ( int x, int y, int w, int h, uint8_t* buffer, int stride ) {
+    return _getBlock ( x, y, w, h, buffer, stride );
+}
+
+/** D */
+int CompoundImage::getBlock ( int x, int y, int w, int h, uint16_t* buffer, int stride ) {
+    return _getBlock ( x, y, w, h, buffer, stride );
+}
+
+/** D */
+int CompoundImage::getBlock ( int x, int y, int w, int h, float* buffer, int stride ) {
+    return _getBlock ( x, y, w, h, buffer, stride );
+}
+
 /** D */
 CompoundImage::CompoundImage ( std::vector< std::vector<Image*> >& images ) :
     Image ( computeWidth ( images ), computeHeight ( images ), images[0][0]->channels, images[0][0]->getResX(),images[0][0]->getResY(), computeBbox ( images ) ),
@@ -59,6 +59,9 @@ private:
     template<typename T>
     inline int _getline ( T* buffer, int line );
 
+    template<typename T>
+    inline int _getBlock ( int x, int y, int w, int h, T* buffer, int stride );
+
 public:
 
     /** D */
@@ -70,6 +73,19 @@ public:
     /** D */
     int getline ( float* buffer, int line );
 
+    /** \~french \brief Le bloc est découpé selon les sous-images, chacune fournissant directement sa partie
+     * \details Une sous-image uniforme (#getConstantColor) ne fournit qu'une ligne, recopiée sur toute la hauteur de sa partie.
+     * \~english \brief Block is split according to sub-images, each one directly providing its part
+     * \details A uniform sub-image (#getConstantColor) provides only one line, copied on its part's whole height.
+     */
+    int getBlock ( int x, int y, int w, int h, uint8_t* buffer, int stride );
+
+    /** D */
+    int getBlock ( int x, int y, int w, int h, uint16_t* buffer, int stride );
+
+    /** D */
+    int getBlock ( int x, int y, int w, int h, float* buffer, int stride );
+
     /** D */
     CompoundImage ( std::vector< std::vector<Image*> >& images );
 
@@ -41,8 +41,20 @@
 #include <stdint.h>// pour uint8_t
 #include <cstddef> // pour size_t
 #include <string>  // pour std::string
+#include <vector>
 
 #include "Logger.h"
+#include "MemoryArena.h"
+
+/**
+ * Portion contiguë des données d'une source, décrite sans copie.
+ */
+struct DataSegment {
+    const uint8_t* data;
+    size_t size;
+
+    DataSegment ( const uint8_t* data, size_t size ) : data ( data ), size ( size ) {}
+};
 
 /**
  * Interface abstraite permetant d'encapsuler une source de données.
@@ -63,6 +75,24 @@ public:
      */
     virtual const uint8_t* getData ( size_t &size ) = 0;
 
+    /**
+     * Décrit les données comme une suite de segments mis bout à bout, sans les rassembler en mémoire.
+     *
+     * Les sources qui ajoutent un en-tête ou un bloc aux données d'une autre source peuvent ainsi être
+     * envoyées sans copie. Par défaut, un unique segment : celui de getData().
+     * Les segments suivent les mêmes règles de validité que le pointeur renvoyé par getData().
+     *
+     * @param segments Liste à laquelle les segments sont ajoutés.
+     * @return false en cas d'échec
+     */
+    virtual bool getSegments ( std::vector<DataSegment>& segments ) {
+        size_t size;
+        const uint8_t* data = getData ( size );
+        if ( ! data ) return false;
+        segments.push_back ( DataSegment ( data, size ) );
+        return true;
+    }
+
     /**
      * Libère les données mémoire allouées.
      *
@@ -181,9 +211,20 @@ public:
         delete dataSource;
     }
 
+    // Allocation dans l'arène de la requête en cours, s'il y en a une
+    static void* operator new ( size_t size ) {
+        return MemoryArena::alloc ( size );
+    }
+    static void operator delete ( void* ptr ) {
+        MemoryArena::release ( ptr );
+    }
+
     inline const uint8_t* getData ( size_t &size ) {
         return getDataSource().getData ( size );
     }
+    inline bool getSegments ( std::vector<DataSegment>& segments ) {
+        return getDataSource().getSegments ( segments );
+    }
     inline bool releaseData()                   {
         return getDataSource().releaseData();
     }
@@ -45,6 +45,13 @@
 #include "byteswap.h"
 #include "lzwDecoder.h"
 #include "pkbDecoder.h"
+#include "EncoderProfile.h"
+#include "Zstd_library_config.h"
+
+#ifdef ZSTD_USE
+#include <pthread.h>
+#include <zstd.h>
+#endif
 
 /*
  * Fonctions déclarées pour la libjpeg
@@ -92,7 +99,7 @@ my_error_exit ( j_common_ptr cinfo ) {
 }
 
 
-const uint8_t* JpegDecoder::decode ( DataSource* source, size_t &size ) {
+const uint8_t* JpegDecoder::decode ( DataSource* source, size_t& size, MemoryArena* arena, int scale ) {
     size = 0;
     if ( !source ) return 0;
 
@@ -133,15 +140,20 @@ const uint8_t* JpegDecoder::decode ( DataSource* source, size_t &size ) {
     // Lecture
     if ( jpeg_read_header ( &cinfo, TRUE ) ==JPEG_HEADER_OK ) {
 
-        int linesize = cinfo.image_width * cinfo.num_components;
-        size = linesize * cinfo.image_height;
-        raw_data = new uint8_t[size];
+        // Décodage à résolution réduite dans le domaine DCT (1/2, 1/4 ou 1/8) : seuls les coefficients basses fréquences sont utilisés
+        cinfo.scale_num = 1;
+        cinfo.scale_denom = scale;
+        jpeg_calc_output_dimensions ( &cinfo );
+
+        int linesize = cinfo.output_width * cinfo.output_components;
+        size = linesize * cinfo.output_height;
+        raw_data = ( uint8_t* ) MemoryArena::alloc ( arena, size );
 
         // TODO: définir J_COLOR_SPACE out_color_space en fonction du nombre de canal ?
         // Vérifier que le jpeg monocanal marche ???
 
         jpeg_start_decompress ( &cinfo );
-        while ( cinfo.output_scanline < cinfo.image_height ) {
+        while ( cinfo.output_scanline < cinfo.output_height ) {
             uint8_t *line = raw_data + cinfo.output_scanline * linesize;
 
             if ( jpeg_read_scanlines ( &cinfo, &line, 1 ) < 1 ) {
@@ -149,7 +161,7 @@ const uint8_t* JpegDecoder::decode ( DataSource* source, size_t &size ) {
                 delete cinfo.src;
                 jpeg_destroy_decompress ( &cinfo );
                 LOGGER_ERROR ( "Probleme lecture tuile Jpeg" );
-                delete[] raw_data;
+                MemoryArena::release ( raw_data );
                 size = 0;
                 return 0;
             }
@@ -170,7 +182,7 @@ const uint8_t* JpegDecoder::decode ( DataSource* source, size_t &size ) {
 /**
  * Decodage de donnee PNG
  */
-const uint8_t* PngDecoder::decode ( DataSource* source, size_t &size ) {
+const uint8_t* PngDecoder::decode ( DataSource* source, size_t& size, MemoryArena* arena ) {
 
 //      LOGGER(DEBUG) << (intptr_t) source << std::endl;
     size = 0;
@@ -228,7 +240,7 @@ const uint8_t* PngDecoder::decode ( DataSource* source, size_t &size ) {
     default:; // TODO ERROR;
     }
 
-    uint8_t* raw_data = new uint8_t[height * width * channels];
+    uint8_t* raw_data = ( uint8_t* ) MemoryArena::alloc ( arena, height * width * channels );
     int linesize = width * channels;
 
     zstream.next_in = ( uint8_t* ) ( encData + 41 ); // 41 = 33 header + 8(chunk idat)
@@ -239,10 +251,10 @@ const uint8_t* PngDecoder::decode ( DataSource* source, size_t &size ) {
     for ( int h = 0; h < height; h++ ) {
         zstream.next_out = &tmp;
         zstream.avail_out = 1;
-        // Decompression 1er octet de la ligne (=0 dans le cache)
+        // Decompression 1er octet de la ligne : filtre PNG utilisé (0 sans filtrage)
         if ( inflate ( &zstream, Z_SYNC_FLUSH ) != Z_OK ) {
             LOGGER_ERROR ( "Decompression PNG : probleme png decompression au debut de la ligne " << h );
-            delete[] raw_data;
+            MemoryArena::release ( raw_data );
             return 0;
         }
         // Decompression des pixels de la ligne
@@ -250,17 +262,21 @@ const uint8_t* PngDecoder::decode ( DataSource* source, size_t &size ) {
         zstream.avail_out = linesize * sizeof ( uint8_t );
         if ( int err = inflate ( &zstream, Z_SYNC_FLUSH ) ) {
 
-            if ( err == Z_STREAM_END && h == height-1 ) break; // fin du fichier OK.
-
-            LOGGER_ERROR ( "Decompression PNG : probleme png decompression des pixels de la ligne " << h << " " << err );
-            delete[] raw_data;
-            return 0;
+            if ( err != Z_STREAM_END || h != height-1 ) { // sinon fin du fichier OK.
+                LOGGER_ERROR ( "Decompression PNG : probleme png decompression des pixels de la ligne " << h << " " << err );
+                MemoryArena::release ( raw_data );
+                return 0;
+            }
+        }
+        // Ligne filtrée (tuiles écrites avec un profil de compression autre que NONE)
+        if ( tmp != PngFilter::NONE ) {
+            PngFilter::revert ( ( PngFilter::ePngFilter ) tmp, raw_data + h*linesize, h ? raw_data + ( h-1 ) *linesize : NULL, linesize, channels );
         }
     }
     // Destruction du flux
     if ( inflateEnd ( &zstream ) !=Z_OK ) {
         LOGGER_ERROR ( "Decompression PNG : probleme de liberation du flux" );
-        delete[] raw_data;
+        MemoryArena::release ( raw_data );
         return 0;
     }
 
@@ -272,7 +288,7 @@ const uint8_t* PngDecoder::decode ( DataSource* source, size_t &size ) {
 /**
  * Decodage de donnee PackBits
  */
-const uint8_t* PackBitsDecoder::decode ( DataSource* source, size_t& size ) {
+const uint8_t* PackBitsDecoder::decode ( DataSource* source, size_t& size, MemoryArena* arena ) {
     size = 0;
     if ( !source ) return 0;
 
@@ -293,7 +309,7 @@ const uint8_t* PackBitsDecoder::decode ( DataSource* source, size_t& size ) {
 /**
  * Decodage de donnee LZW
  */
-const uint8_t* LzwDecoder::decode ( DataSource* source, size_t& size ) {
+const uint8_t* LzwDecoder::decode ( DataSource* source, size_t& size, MemoryArena* arena ) {
     size = 0;
     if ( !source ) return 0;
 
@@ -315,7 +331,7 @@ const uint8_t* LzwDecoder::decode ( DataSource* source, size_t& size ) {
 /**
  * Decodage de donnee DEFLATE
  */
-const uint8_t* DeflateDecoder::decode ( DataSource* source, size_t &size ) {
+const uint8_t* DeflateDecoder::decode ( DataSource* source, size_t& size, MemoryArena* arena ) {
 
     size = 0;
     if ( !source ) return 0;
@@ -345,7 +361,7 @@ const uint8_t* DeflateDecoder::decode ( DataSource* source, size_t &size ) {
     }
 
     size_t rawSize = encSize * 2;
-    uint8_t* raw_data = new uint8_t[rawSize];
+    uint8_t* raw_data = ( uint8_t* ) MemoryArena::alloc ( arena, rawSize );
 
     zstream.next_in = ( uint8_t* ) ( encData );
     zstream.avail_in = encSize;
@@ -356,9 +372,9 @@ const uint8_t* DeflateDecoder::decode ( DataSource* source, size_t &size ) {
         if ( int err = inflate ( &zstream, Z_SYNC_FLUSH ) ) {
             if ( err == Z_STREAM_END && zstream.avail_in == 0 ) break; // fin du fichier OK.
             if ( zstream.avail_out == 0 ) { // Output buffer Full
-                uint8_t* tmp = new uint8_t[rawSize *2];
+                uint8_t* tmp = ( uint8_t* ) MemoryArena::alloc ( arena, rawSize *2 );
                 memcpy ( tmp,raw_data,rawSize );
-                delete[] raw_data;
+                MemoryArena::release ( raw_data );
                 raw_data = tmp;
                 zstream.next_out = ( uint8_t* ) ( raw_data + rawSize );
                 zstream.avail_out += rawSize;
@@ -366,7 +382,7 @@ const uint8_t* DeflateDecoder::decode ( DataSource* source, size_t &size ) {
                 continue;
             }
             LOGGER_ERROR ( "Decompression DEFLATE : probleme deflate decompression " << err );
-            delete[] raw_data;
+            MemoryArena::release ( raw_data );
             size = 0;
             return 0;
         }
@@ -375,7 +391,7 @@ const uint8_t* DeflateDecoder::decode ( DataSource* source, size_t &size ) {
     // Destruction du flux
     if ( inflateEnd ( &zstream ) !=Z_OK ) {
         LOGGER_ERROR ( "Decompression DEFLATE : probleme de liberation du flux" );
-        delete[] raw_data;
+        MemoryArena::release ( raw_data );
         size = 0;
         return 0;
     }
@@ -386,32 +402,114 @@ const uint8_t* DeflateDecoder::decode ( DataSource* source, size_t &size ) {
 }
 
 
-int ImageDecoder::getDataline ( uint8_t* buffer, int line ) {
-    convert ( buffer, rawData + ( ( margin_top + line ) * source_width + margin_left ) * channels, width * channels );
-    return width * channels;
+#ifdef ZSTD_USE
+/*
+ * Un contexte de décompression par thread, réutilisé d'une tuile à l'autre
+ */
+static pthread_once_t zstd_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t zstd_key;
+
+static void free_zstd_context ( void* dctx ) {
+    ZSTD_freeDCtx ( ( ZSTD_DCtx* ) dctx );
+}
+
+static void make_zstd_key() {
+    pthread_key_create ( &zstd_key, free_zstd_context );
 }
 
-int ImageDecoder::getDataline ( uint16_t* buffer, int line ) {
+static ZSTD_DCtx* getZstdContext() {
+    pthread_once ( &zstd_key_once, make_zstd_key );
+    ZSTD_DCtx* dctx = ( ZSTD_DCtx* ) pthread_getspecific ( zstd_key );
+    if ( !dctx ) {
+        dctx = ZSTD_createDCtx();
+        pthread_setspecific ( zstd_key, dctx );
+    }
+    return dctx;
+}
+#endif
+
+const uint8_t* ZstdDecoder::decode ( DataSource* source, size_t& size, MemoryArena* arena, size_t maxSize ) {
+
+    size = 0;
+    if ( !source ) return 0;
+
+#ifdef ZSTD_USE
+    size_t encSize;
+    const uint8_t* encData = source->getData ( encSize );
+
+    if ( !encData ) return 0;
+
+    ZSTD_DCtx* dctx = getZstdContext();
+    if ( !dctx ) {
+        LOGGER_ERROR ( "Decompression ZSTD : pas assez de memoire" );
+        return 0;
+    }
+
+    // La taille décompressée est écrite dans l'en-tête de la trame par l'encodeur
+    unsigned long long rawSize = ZSTD_getFrameContentSize ( encData, encSize );
+    if ( rawSize == ZSTD_CONTENTSIZE_ERROR || rawSize == ZSTD_CONTENTSIZE_UNKNOWN || rawSize == 0 ) {
+        LOGGER_ERROR ( "Decompression ZSTD : taille des donnees decompressees inconnue" );
+        return 0;
+    }
+    // L'en-tête de trame n'est pas fiable : une tuile corrompue ne doit pas provoquer une allocation démesurée
+    if ( maxSize > 0 && rawSize > maxSize ) {
+        LOGGER_ERROR ( "Decompression ZSTD : taille des donnees decompressees (" << rawSize << ") superieure a la taille de la tuile (" << maxSize << ")" );
+        return 0;
+    }
+
+    uint8_t* raw_data = ( uint8_t* ) MemoryArena::alloc ( arena, rawSize );
+    size_t decSize = ZSTD_decompressDCtx ( dctx, raw_data, rawSize, encData, encSize );
+    if ( ZSTD_isError ( decSize ) ) {
+        LOGGER_ERROR ( "Decompression ZSTD : " << ZSTD_getErrorName ( decSize ) );
+        MemoryArena::release ( raw_data );
+        return 0;
+    }
+
+    size = decSize;
+    return raw_data;
+#else
+    LOGGER_ERROR ( "Decompression ZSTD : non disponible (compilation sans ZSTD_USE)" );
+    return 0;
+#endif
+}
+
+int ImageDecoder::getDataSegment ( uint8_t* buffer, int line, int x, int w ) {
+    if ( pixel_size==1 )
+        // Donnée demandée dans le format d'origine
+        convert ( buffer, rawData + ( ( margin_top + line ) * source_width + margin_left + x ) * channels, w * channels );
+    else if ( pixel_size==2 )
+        // Conversion uint16 -> uint8, avec saturation
+        convert ( buffer, ( const uint16_t* ) ( rawData + ( ( margin_top + line ) * source_width + margin_left + x ) * channels*sizeof ( uint16_t ) ), w * channels );
+    else if ( pixel_size==4 )
+        // Conversion float -> uint8
+        convert ( buffer, ( const float* ) ( rawData + ( ( margin_top + line ) * source_width + margin_left + x ) * channels*sizeof ( float ) ), w * channels );
+    return w * channels;
+}
+
+int ImageDecoder::getDataSegment ( uint16_t* buffer, int line, int x, int w ) {
     if ( pixel_size==1 )
         // Conversion uint8 -> uintt16
-        convert ( buffer, rawData + ( ( margin_top + line ) * source_width + margin_left ) * channels, width * channels );
+        convert ( buffer, rawData + ( ( margin_top + line ) * source_width + margin_left + x ) * channels, w * channels );
     else if ( pixel_size==2 )
         // Donnée demandée dans le format d'origine
-        memcpy ( buffer,rawData + ( ( margin_top + line ) * source_width + margin_left ) * channels*sizeof ( uint16_t ),width * channels*sizeof ( uint16_t ) );
+        memcpy ( buffer,rawData + ( ( margin_top + line ) * source_width + margin_left + x ) * channels*sizeof ( uint16_t ),w * channels*sizeof ( uint16_t ) );
+    else if ( pixel_size==4 )
+        // Conversion float -> uint16
+        convert ( buffer, ( const float* ) ( rawData + ( ( margin_top + line ) * source_width + margin_left + x ) * channels*sizeof ( float ) ), w * channels );
 
-    return width * channels;
+    return w * channels;
 }
 
-int ImageDecoder::getDataline ( float* buffer, int line ) {
+int ImageDecoder::getDataSegment ( float* buffer, int line, int x, int w ) {
     if ( pixel_size==1 )
         // Conversion uint8 -> float
-        convert ( buffer, rawData + ( ( margin_top + line ) * source_width + margin_left ) * channels, width * channels );
+        convert ( buffer, rawData + ( ( margin_top + line ) * source_width + margin_left + x ) * channels, w * channels );
     else if ( pixel_size==2 )
         // Conversion uint16 -> float
-        convert ( buffer, rawData + ( ( margin_top + line ) * source_width + margin_left ) * channels*sizeof ( uint16_t ), width * channels );
+        convert ( buffer, ( const uint16_t* ) ( rawData + ( ( margin_top + line ) * source_width + margin_left + x ) * channels*sizeof ( uint16_t ) ), w * channels );
     else if ( pixel_size==4 )
         // Donnée demandée dans le format d'origine
-        memcpy ( buffer,rawData + ( ( margin_top + line ) * source_width + margin_left ) * channels*sizeof ( float ),width * channels*sizeof ( float ) );
+        memcpy ( buffer,rawData + ( ( margin_top + line ) * source_width + margin_left + x ) * channels*sizeof ( float ),w * channels*sizeof ( float ) );
 
-    return width * channels;
+    return w * channels;
 }
@@ -45,32 +45,81 @@
 #include "Data.h"
 #include "Image.h"
 #include "Utils.h"
+#include "MemoryArena.h"
 
+/*
+ * Les décodeurs allouent la donnée décodée dans l'arène fournie (ou dans le tas si elle est nulle),
+ * la fonction release correspondante la libère.
+ */
+/*
+ * Le paramètre scale permet de décoder le JPEG à 1/2, 1/4 ou 1/8 de sa résolution
+ */
 struct JpegDecoder {
-    static const uint8_t* decode ( DataSource* encData, size_t &size );
+    static const uint8_t* decode ( DataSource* encData, size_t &size, MemoryArena* arena = NULL, int scale = 1 );
+    static void release ( const uint8_t* data ) {
+        MemoryArena::release ( ( void* ) data );
+    }
+};
+
+/*
+ * Décodeur JPEG à résolution réduite, scale vaut 2, 4 ou 8
+ */
+template <int scale>
+struct ScaledJpegDecoder {
+    static const uint8_t* decode ( DataSource* encData, size_t &size, MemoryArena* arena = NULL ) {
+        return JpegDecoder::decode ( encData, size, arena, scale );
+    }
+    static void release ( const uint8_t* data ) {
+        JpegDecoder::release ( data );
+    }
 };
 
 struct PngDecoder {
-    static const uint8_t* decode ( DataSource* encData, size_t &size );
+    static const uint8_t* decode ( DataSource* encData, size_t &size, MemoryArena* arena = NULL );
+    static void release ( const uint8_t* data ) {
+        MemoryArena::release ( ( void* ) data );
+    }
 };
 
+// Les décodeurs LZW et PackBits allouent leur sortie dans le tas, l'arène n'est pas utilisée
 struct LzwDecoder {
-    static const uint8_t* decode ( DataSource* encData, size_t &size );
+    static const uint8_t* decode ( DataSource* encData, size_t &size, MemoryArena* arena = NULL );
+    static void release ( const uint8_t* data ) {
+        delete[] data;
+    }
 };
 
 struct DeflateDecoder {
-    static const uint8_t* decode ( DataSource* encData, size_t &size );
+    static const uint8_t* decode ( DataSource* encData, size_t &size, MemoryArena* arena = NULL );
+    static void release ( const uint8_t* data ) {
+        MemoryArena::release ( ( void* ) data );
+    }
+};
+
+/*
+ * Décodeur Zstandard, disponible uniquement si la bibliothèque est compilée avec ZSTD_USE (sinon decode échoue)
+ * La taille décompressée est lue dans l'en-tête de la trame : elle est refusée si elle dépasse maxSize (0 pour ne pas borner)
+ */
+struct ZstdDecoder {
+    static const uint8_t* decode ( DataSource* encData, size_t &size, MemoryArena* arena = NULL, size_t maxSize = 0 );
+    static void release ( const uint8_t* data ) {
+        MemoryArena::release ( ( void* ) data );
+    }
 };
 
 struct PackBitsDecoder {
-    static const uint8_t* decode ( DataSource* encData, size_t &size );
+    static const uint8_t* decode ( DataSource* encData, size_t &size, MemoryArena* arena = NULL );
+    static void release ( const uint8_t* data ) {
+        delete[] data;
+    }
 };
 
 struct InvalidDecoder {
-    static const uint8_t* decode ( DataSource* encData, size_t &size ) {
+    static const uint8_t* decode ( DataSource* encData, size_t &size, MemoryArena* arena = NULL ) {
         size = 0;
         return 0;
     }
+    static void release ( const uint8_t* data ) {}
 };
 
 
@@ -85,18 +134,39 @@ private:
     DataSource* encData;
     const uint8_t* decData;
     size_t decSize;
+    // Arène active à la construction, dans laquelle est allouée la donnée décodée si elle est décodée par le même thread
+    MemoryArena* arena;
+    // Taille maximale de la donnée décodée, 0 si inconnue
+    size_t maxSize;
+
+    // Seul le décodeur ZSTD alloue selon une taille lue dans la donnée encodée : elle est bornée par maxSize
+    static const uint8_t* decode ( ZstdDecoder*, DataSource* encData, size_t &size, MemoryArena* arena, size_t maxSize ) {
+        return ZstdDecoder::decode ( encData, size, arena, maxSize );
+    }
+    template<class D>
+    static const uint8_t* decode ( D*, DataSource* encData, size_t &size, MemoryArena* arena, size_t maxSize ) {
+        return D::decode ( encData, size, arena );
+    }
 public:
-    DataSourceDecoder ( DataSource* encData ) : encData ( encData ), decData ( 0 ), decSize ( 0 ) {}
+    DataSourceDecoder ( DataSource* encData, size_t maxSize = 0 ) : encData ( encData ), decData ( 0 ), decSize ( 0 ),
+        arena ( MemoryArena::getCurrent() ), maxSize ( maxSize ) {}
 
     ~DataSourceDecoder() {
         if ( decData )
-            delete[] decData;
+            Decoder::release ( decData );
         delete encData;
     }
 
+    static void* operator new ( size_t size ) {
+        return MemoryArena::alloc ( size );
+    }
+    static void operator delete ( void* ptr ) {
+        MemoryArena::release ( ptr );
+    }
+
     const uint8_t* getData ( size_t &size ) {
         if ( !decData && encData ) {
-            decData = Decoder::decode ( encData, decSize );
+            decData = decode ( ( Decoder* ) 0, encData, decSize, MemoryArena::usable ( arena ), maxSize );
             if ( !decData ) {
                 delete encData;
                 encData = 0;
@@ -108,8 +178,9 @@ public:
 
     bool releaseData() {
         if ( encData ) encData->releaseData();
-        if ( decData ) delete[] decData;
+        if ( decData ) Decoder::release ( decData );
         decData = 0;
+        return true;
     }
 
     std::string getType() {
@@ -140,11 +211,15 @@ private:
     // La donnee brute (source) est de type uint8_t
     const uint8_t* rawData;
 
-    int getDataline ( uint8_t* buffer, int line );
+    int getDataSegment ( uint8_t* buffer, int line, int x, int w );
+
+    int getDataSegment ( uint16_t* buffer, int line, int x, int w );
 
-    int getDataline ( uint16_t* buffer, int line );
+    int getDataSegment ( float* buffer, int line, int x, int w );
 
-    int getDataline ( float* buffer, int line );
+    template<typename T> inline int getDataline ( T* buffer, int line ) {
+        return getDataSegment ( buffer, line, 0, width );
+    }
 
     template<typename T> inline int getNoDataline ( T* buffer, int line ) {
         memset ( buffer, 0, width * channels * sizeof ( T ) );
@@ -154,23 +229,44 @@ private:
     // TODO : a deplacer dans le cpp (je n'y suis pas arrive a cause d un probleme de compilation lie au template)
     template<typename T>
     inline int _getline ( T* buffer, int line ) {
-
-        if ( rawData ) { // Est ce que l'on a de la donnee
+        if ( loadData() ) {
             return getDataline ( buffer, line );
             // TODO: libérer le dataSource lorsque l'on lit la dernière ligne de l'image...
-        } else if ( dataSource ) { // Non alors on essaye de la l'initialiser depuis dataSource
-            size_t size;
-            if ( rawData = dataSource->getData ( size ) ) {
-                return getDataline ( buffer, line );
-            } else {
-                delete dataSource;
-                dataSource = 0;
-            }
         }
         //LOGGER_DEBUG("Decoding error, fill with black");
         return getNoDataline ( buffer, line );
     }
 
+    /**
+     * \~french \brief Lit les données brutes si ce n'est pas déjà fait
+     * \return Vrai si les données sont disponibles
+     * \~english \brief Read raw data if not already done
+     * \return True if data are available
+     */
+    inline bool loadData () {
+        if ( rawData ) return true;
+        if ( dataSource ) {
+            size_t size;
+            if ( rawData = dataSource->getData ( size ) ) return true;
+            delete dataSource;
+            dataSource = 0;
+        }
+        return false;
+    }
+
+    /* Les lignes du bloc sont directement converties depuis les données décodées, sans passer par une ligne entière */
+    template<typename T>
+    inline int _getBlock ( int x, int y, int w, int h, T* buffer, int stride ) {
+        if ( ! isBlockInside ( x, y, w, h ) ) return 0;
+
+        if ( loadData() ) {
+            for ( int l = 0; l < h; l++ ) getDataSegment ( buffer + l * stride, y + l, x, w );
+        } else {
+            for ( int l = 0; l < h; l++ ) memset ( buffer + l * stride, 0, w * channels * sizeof ( T ) );
+        }
+        return w * h * channels;
+    }
+
 public:
     ImageDecoder ( DataSource* dataSource, int source_width, int source_height, int channels,
                    BoundingBox<double> bbox = BoundingBox<double> ( 0.,0.,0.,0. ),
@@ -195,6 +291,16 @@ public:
         return _getline ( buffer, line );
     }
 
+    inline int getBlock ( int x, int y, int w, int h, uint8_t* buffer, int stride ) {
+        return _getBlock ( x, y, w, h, buffer, stride );
+    }
+    inline int getBlock ( int x, int y, int w, int h, uint16_t* buffer, int stride ) {
+        return _getBlock ( x, y, w, h, buffer, stride );
+    }
+    inline int getBlock ( int x, int y, int w, int h, float* buffer, int stride ) {
+        return _getBlock ( x, y, w, h, buffer, stride );
+    }
+
     ~ImageDecoder() {
         if ( dataSource ) {
             dataSource->releaseData();
@@ -64,20 +64,29 @@ class EmptyImage : public Image {
      * \details On a une valeur entière par canal. Tous les pixel de l'image auront cette valeur
      * \~english \brief Nodata value
      */
-    int *color;
+    float *color;
 
 public:
 
     /** Constructeur */
     EmptyImage ( int width, int height, int channels, int* _color ) : Image ( width, height, channels ) {
-        color = new int[channels];
+        color = new float[channels];
+        for ( int c = 0; c < channels; c++ ) color[c] = ( float ) _color[c];
+    }
+
+    /**
+     * \~french \brief Constructeur à partir de valeurs flottantes, pour les canaux non entiers
+     * \~english \brief Constructor from float values, for non-integer samples
+     */
+    EmptyImage ( int width, int height, int channels, float* _color ) : Image ( width, height, channels ) {
+        color = new float[channels];
         for ( int c = 0; c < channels; c++ ) color[c] = _color[c];
     }
 
     virtual int getline ( uint8_t *buffer, int line ) {
         for ( int i = 0; i < width; i++ )
             for ( int c = 0; c < channels; c++ )
-                buffer[channels*i + c] = ( uint8_t ) color[c];
+                buffer[channels*i + c] = ( uint8_t ) ( int ) color[c];
             
         return width * channels * sizeof(uint8_t);
     };
@@ -85,7 +94,7 @@ public:
     virtual int getline ( uint16_t *buffer, int line ) {
         for ( int i = 0; i < width; i++ )
             for ( int c = 0; c < channels; c++ )
-                buffer[channels*i + c] = ( uint16_t ) color[c];
+                buffer[channels*i + c] = ( uint16_t ) ( int ) color[c];
             
         return width * channels * sizeof(uint16_t);
     };
@@ -93,11 +102,23 @@ public:
     virtual int getline ( float *buffer, int line ) {
         for ( int i = 0; i < width; i++ )
             for ( int c = 0; c < channels; c++ )
-                buffer[channels*i + c] = ( float ) color[c];
+                buffer[channels*i + c] = color[c];
             
         return width * channels * sizeof(float);
     };
 
+    virtual const float* getConstantColor() {
+        return color;
+    }
+
+    /**
+     * \~french \brief Image constante : utilisée comme masque, elle est entièrement pleine ou entièrement vide
+     * \~english \brief Constant image : used as a mask, it is entirely full or entirely empty
+     */
+    virtual MaskCoverage::eMaskCoverage getCoverage ( int firstLine, int lastLine ) {
+        return color[0] ? MaskCoverage::FULL : MaskCoverage::EMPTY;
+    }
+
     virtual ~EmptyImage() {
         delete[] color;
     };
@@ -0,0 +1,186 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file EncoderProfile.cpp
+ * \~french
+ * \brief Implémentation de la classe EncoderProfile et du namespace PngFilter
+ * \~english
+ * \brief Implement the EncoderProfile class and the PngFilter namespace
+ */
+
+#include "EncoderProfile.h"
+#include <cstdio>
+#include <cstdlib>
+#include <zlib.h>
+#include "jpeglib.h"
+
+namespace PngFilter {
+
+const char *ePngFilter_name[] = {
+    "none",
+    "sub",
+    "up",
+    "average",
+    "paeth",
+    "adaptive"
+};
+
+ePngFilter fromString ( std::string strFilter ) {
+    int i;
+    for ( i = ADAPTIVE; i ; --i ) {
+        if ( strFilter.compare ( ePngFilter_name[i] ) == 0 )
+            break;
+    }
+    return static_cast<ePngFilter> ( i );
+}
+
+std::string toString ( ePngFilter filter ) {
+    return std::string ( ePngFilter_name[filter] );
+}
+
+static inline uint8_t paeth ( int a, int b, int c ) {
+    int p = a + b - c;
+    int pa = abs ( p - a );
+    int pb = abs ( p - b );
+    int pc = abs ( p - c );
+    if ( pa <= pb && pa <= pc ) return a;
+    if ( pb <= pc ) return b;
+    return c;
+}
+
+/**
+ * \~french \brief Prédiction d'un octet par le filtre, à partir des voisins gauche (a), haut (b) et haut gauche (c)
+ * \~english \brief Byte prediction by the filter, from left (a), up (b) and up left (c) neighbours
+ */
+static inline uint8_t predict ( int filter, int a, int b, int c ) {
+    switch ( filter ) {
+    case SUB :
+        return a;
+    case UP :
+        return b;
+    case AVERAGE :
+        return ( a + b ) >> 1;
+    case PAETH :
+        return paeth ( a, b, c );
+    default :
+        return 0;
+    }
+}
+
+static void filterLine ( int filter, const uint8_t* line, const uint8_t* previous, int length, int bpp, uint8_t* out ) {
+    for ( int i = 0; i < length; i++ ) {
+        int a = ( i >= bpp ) ? line[i - bpp] : 0;
+        int b = previous ? previous[i] : 0;
+        int c = ( previous && i >= bpp ) ? previous[i - bpp] : 0;
+        out[i] = line[i] - predict ( filter, a, b, c );
+    }
+}
+
+/**
+ * \~french \brief Coût d'un filtre : somme des résidus vus comme des entiers signés (heuristique de la spécification PNG)
+ * \~english \brief Filter cost : sum of residuals seen as signed integers (PNG specification heuristic)
+ */
+static long filterCost ( int filter, const uint8_t* line, const uint8_t* previous, int length, int bpp ) {
+    long cost = 0;
+    for ( int i = 0; i < length; i++ ) {
+        int a = ( i >= bpp ) ? line[i - bpp] : 0;
+        int b = previous ? previous[i] : 0;
+        int c = ( previous && i >= bpp ) ? previous[i - bpp] : 0;
+        cost += abs ( ( int8_t ) ( line[i] - predict ( filter, a, b, c ) ) );
+    }
+    return cost;
+}
+
+void apply ( ePngFilter filter, const uint8_t* line, const uint8_t* previous, int length, int bpp, uint8_t* out ) {
+    int chosen = filter;
+    if ( filter == ADAPTIVE ) {
+        chosen = NONE;
+        long best = filterCost ( NONE, line, previous, length, bpp );
+        for ( int f = SUB; f <= PAETH; f++ ) {
+            long cost = filterCost ( f, line, previous, length, bpp );
+            if ( cost < best ) {
+                best = cost;
+                chosen = f;
+            }
+        }
+    }
+    out[0] = chosen;
+    filterLine ( chosen, line, previous, length, bpp, out + 1 );
+}
+
+void revert ( ePngFilter filter, uint8_t* line, const uint8_t* previous, int length, int bpp ) {
+    if ( filter == NONE ) return;
+    for ( int i = 0; i < length; i++ ) {
+        int a = ( i >= bpp ) ? line[i - bpp] : 0;
+        int b = previous ? previous[i] : 0;
+        int c = ( previous && i >= bpp ) ? previous[i - bpp] : 0;
+        line[i] += predict ( filter, a, b, c );
+    }
+}
+
+}
+
+//                                        name        pngFilter             png deflate strategy            q   fastDct optimize subsampling
+static const EncoderProfile FAST     = { "fast",     PngFilter::NONE,      1,  1,      Z_RLE,              75, true,   false,   true };
+static const EncoderProfile BALANCED = { "balanced", PngFilter::NONE,      5,  6,      Z_DEFAULT_STRATEGY, 75, false,  false,   true };
+static const EncoderProfile SMALL    = { "small",    PngFilter::ADAPTIVE,  9,  9,      Z_DEFAULT_STRATEGY, 75, false,  true,    true };
+
+void EncoderProfile::applyJpeg ( jpeg_compress_struct* cinfo ) const {
+    jpeg_set_quality ( cinfo, jpegQuality, TRUE );
+    cinfo->dct_method = jpegFastDct ? JDCT_IFAST : JDCT_ISLOW;
+    cinfo->optimize_coding = jpegOptimize ? TRUE : FALSE;
+    if ( ! jpegSubsampling && cinfo->num_components > 1 ) {
+        cinfo->comp_info[0].h_samp_factor = 1;
+        cinfo->comp_info[0].v_samp_factor = 1;
+    }
+}
+
+const EncoderProfile* EncoderProfile::get ( std::string name ) {
+    if ( name == FAST.name ) return &FAST;
+    if ( name == BALANCED.name ) return &BALANCED;
+    if ( name == SMALL.name ) return &SMALL;
+    return NULL;
+}
+
+const EncoderProfile* EncoderProfile::getDefault() {
+    return &BALANCED;
+}
+
+const EncoderProfile* EncoderProfile::getFastest() {
+    return &FAST;
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file EncoderProfile.h
+ * \~french
+ * \brief Définition de la classe EncoderProfile et du namespace PngFilter
+ * \details
+ * \li EncoderProfile : réglages de compression des formats PNG, JPEG et deflate
+ * \li PngFilter : énumère et applique les filtres de ligne PNG
+ * \~english
+ * \brief Define the EncoderProfile class and the PngFilter namespace
+ * \details
+ * \li EncoderProfile : PNG, JPEG and deflate compression settings
+ * \li PngFilter : enumerate and apply PNG line filters
+ */
+
+#ifndef ENCODER_PROFILE_H
+#define ENCODER_PROFILE_H
+
+#include <string>
+#include <stdint.h>
+
+struct jpeg_compress_struct;
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french \brief Gestion des filtres de ligne PNG
+ * \~english \brief Manage PNG line filters
+ */
+namespace PngFilter {
+/**
+ * \~french \brief Énumération des filtres disponibles, ADAPTIVE choisissant le meilleur filtre pour chaque ligne
+ * \~english \brief Available filters enumeration, ADAPTIVE choosing the best filter for each line
+ */
+enum ePngFilter {
+    NONE = 0,
+    SUB = 1,
+    UP = 2,
+    AVERAGE = 3,
+    PAETH = 4,
+    ADAPTIVE = 5
+};
+
+/**
+ * \~french \brief Conversion d'une chaîne de caractères vers un filtre de l'énumération
+ * \return le filtre correspondant, NONE si la chaîne n'est pas reconnue
+ * \~english \brief Convert a string to a filters enumeration member
+ * \return the binding filter, NONE if string is not recognized
+ */
+ePngFilter fromString ( std::string strFilter );
+
+/**
+ * \~french \brief Conversion d'un filtre vers une chaîne de caractères
+ * \~english \brief Convert a filter to a string
+ */
+std::string toString ( ePngFilter filter );
+
+/**
+ * \~french
+ * \brief Filtre une ligne d'image 8 bits
+ * \details La ligne filtrée est précédée de l'octet indiquant le filtre utilisé, comme attendu dans un flux PNG.
+ * \param[in] filter filtre à appliquer
+ * \param[in] line ligne à filtrer
+ * \param[in] previous ligne précédente, NULL pour la première ligne
+ * \param[in] length taille de la ligne, en octets
+ * \param[in] bpp nombre d'octets par pixel
+ * \param[out] out ligne filtrée, de taille length + 1
+ * \~english
+ * \brief Filter a 8-bit image line
+ * \details The filtered line is preceded by the byte giving the used filter, as expected in a PNG stream.
+ * \param[in] filter filter to apply
+ * \param[in] line line to filter
+ * \param[in] previous previous line, NULL for the first line
+ * \param[in] length line size, in bytes
+ * \param[in] bpp bytes per pixel
+ * \param[out] out filtered line, length + 1 bytes long
+ */
+void apply ( ePngFilter filter, const uint8_t* line, const uint8_t* previous, int length, int bpp, uint8_t* out );
+
+/**
+ * \~french
+ * \brief Annule le filtrage d'une ligne d'image 8 bits, sur place
+ * \param[in] filter filtre utilisé (octet de début de ligne du flux PNG)
+ * \param[in,out] line ligne filtrée, sans l'octet de filtre, remplacée par la ligne d'origine
+ * \param[in] previous ligne précédente d'origine, NULL pour la première ligne
+ * \param[in] length taille de la ligne, en octets
+ * \param[in] bpp nombre d'octets par pixel
+ * \~english
+ * \brief Revert the filtering of a 8-bit image line, in place
+ * \param[in] filter used filter (PNG stream line first byte)
+ * \param[in,out] line filtered line, without the filter byte, replaced by the original line
+ * \param[in] previous original previous line, NULL for the first line
+ * \param[in] length line size, in bytes
+ * \param[in] bpp bytes per pixel
+ */
+void revert ( ePngFilter filter, uint8_t* line, const uint8_t* previous, int length, int bpp );
+}
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Réglages de compression des encodeurs PNG, JPEG et deflate
+ * \details Trois profils nommés sont prédéfinis :
+ * \li fast : compression rapide, images plus lourdes
+ * \li balanced : réglages historiques, profil par défaut
+ * \li small : images plus légères, compression plus coûteuse
+ *
+ * La qualité JPEG est la même pour les trois profils : passer d'un profil à l'autre ne change que le compromis entre temps de calcul et taille de la réponse.
+ * \~english
+ * \brief PNG, JPEG and deflate encoders compression settings
+ * \details Three named profiles are predefined :
+ * \li fast : fast compression, heavier images
+ * \li balanced : historical settings, default profile
+ * \li small : lighter images, more expensive compression
+ *
+ * JPEG quality is the same for the three profiles : switching from one profile to another only changes the trade-off between computation time and response size.
+ */
+class EncoderProfile {
+public:
+    /**
+     * \~french \brief Nom du profil
+     * \~english \brief Profile name
+     */
+    std::string name;
+    /**
+     * \~french \brief Filtre de ligne PNG
+     * \~english \brief PNG line filter
+     */
+    PngFilter::ePngFilter pngFilter;
+    /**
+     * \~french \brief Niveau de compression zlib des images PNG
+     * \~english \brief PNG images zlib compression level
+     */
+    int pngLevel;
+    /**
+     * \~french \brief Niveau de compression zlib des images TIFF deflate
+     * \~english \brief Deflate TIFF images zlib compression level
+     */
+    int deflateLevel;
+    /**
+     * \~french \brief Stratégie zlib (Z_DEFAULT_STRATEGY, Z_FILTERED, Z_RLE...)
+     * \~english \brief zlib strategy (Z_DEFAULT_STRATEGY, Z_FILTERED, Z_RLE...)
+     */
+    int zlibStrategy;
+    /**
+     * \~french \brief Qualité JPEG, de 1 à 100
+     * \~english \brief JPEG quality, from 1 to 100
+     */
+    int jpegQuality;
+    /**
+     * \~french \brief Transformée DCT rapide (entière, moins précise)
+     * \~english \brief Fast DCT (integer, less accurate)
+     */
+    bool jpegFastDct;
+    /**
+     * \~french \brief Tables de Huffman optimisées pour chaque image (deux passes)
+     * \~english \brief Huffman tables optimized for each image (two passes)
+     */
+    bool jpegOptimize;
+    /**
+     * \~french \brief Sous-échantillonnage 4:2:0 de la chrominance, 4:4:4 sinon
+     * \~english \brief 4:2:0 chroma subsampling, 4:4:4 otherwise
+     */
+    bool jpegSubsampling;
+
+    /**
+     * \~french
+     * \brief Applique les réglages JPEG à une structure de compression
+     * \details Doit être appelé après jpeg_set_defaults.
+     * \~english
+     * \brief Apply JPEG settings to a compression structure
+     * \details Has to be called after jpeg_set_defaults.
+     */
+    void applyJpeg ( jpeg_compress_struct* cinfo ) const;
+
+    /**
+     * \~french
+     * \brief Retourne le profil prédéfini de ce nom
+     * \return le profil, NULL si le nom n'est pas reconnu
+     * \~english
+     * \brief Return the predefined profile with this name
+     * \return the profile, NULL if the name is not recognized
+     */
+    static const EncoderProfile* get ( std::string name );
+
+    /**
+     * \~french \brief Retourne le profil par défaut (balanced)
+     * \~english \brief Return the default profile (balanced)
+     */
+    static const EncoderProfile* getDefault();
+
+    /**
+     * \~french \brief Retourne le profil le plus rapide, utilisé quand le serveur est chargé
+     * \~english \brief Return the fastest profile, used when the server is loaded
+     */
+    static const EncoderProfile* getFastest();
+};
+
+#endif
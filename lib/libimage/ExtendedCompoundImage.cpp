@@ -91,26 +91,36 @@ int ExtendedCompoundImage::_getline ( T* buffer, int line ) {
         // c2 : indice de de la 1ere colonne de l'ExtendedCompoundImage dans l'image courante
         int c2 = c2s[i];
 
-        T* buffer_t = new T[sourceImages[i]->getWidth() *sourceImages[i]->channels];
+        T* buffer_t = ( T* ) sourceLine;
+        uint8_t* buffer_m = sourceMaskLine;
+
+        /* Le masque est consulté avant l'image : une ligne sans donnée n'est pas lue, une ligne pleine est copiée
+         * d'un bloc. La couverture est d'abord demandée au masque, puis calculée sur la ligne lue si besoin.
+         */
+        MaskCoverage::eMaskCoverage coverage = MaskCoverage::FULL;
+        if ( getMask ( i ) != NULL ) {
+            coverage = getMask ( i )->getCoverage ( lineInSource, lineInSource );
+            if ( coverage == MaskCoverage::MIXED ) {
+                getMask ( i )->getline ( buffer_m,lineInSource );
+                coverage = MaskCoverage::fromLine ( buffer_m + c2, c1 - c0 + 1 );
+            }
+        }
+
+        if ( coverage == MaskCoverage::EMPTY ) {
+            continue;
+        }
 
         sourceImages[i]->getline ( buffer_t,lineInSource );
 
-        if ( getMask ( i ) == NULL ) {
+        if ( coverage == MaskCoverage::FULL ) {
             memcpy ( &buffer[c0*channels], &buffer_t[c2*channels], ( c1 + 1 - c0) *channels*sizeof ( T ) );
         } else {
-
-            uint8_t* buffer_m = new uint8_t[getMask ( i )->getWidth()];
-            getMask ( i )->getline ( buffer_m,lineInSource );
-
             for ( int j=0; j < c1 - c0 + 1; j++ ) {
                 if ( buffer_m[c2+j] ) {
                     memcpy ( &buffer[ ( c0 + j ) *channels],&buffer_t[ ( c2+j ) *channels],sizeof ( T ) *channels );
                 }
             }
-
-            delete [] buffer_m;
         }
-        delete [] buffer_t;
     }
     return width*channels*sizeof ( T );
 }
@@ -380,9 +390,9 @@ int ExtendedCompoundMask::_getline ( uint8_t* buffer, int line ) {
  
         if ( ECI->getMask ( i ) == NULL ) {
             memset ( &buffer[c0], 255, c1 - c0 + 1 );
-        } else {
+        } else if ( ECI->getMask ( i )->getCoverage ( lineInSource, lineInSource ) != MaskCoverage::EMPTY ) {
             // Récupération du masque de l'image courante de l'ECI.
-            uint8_t* buffer_m = new uint8_t[ECI->getMask ( i )->getWidth()];
+            uint8_t* buffer_m = sourceMaskLine;
             ECI->getMask ( i )->getline ( buffer_m,lineInSource );
             // On ajoute au masque actuel (on écrase si la valeur est différente de 0)
             for ( int j = 0; j < c1 - c0 + 1; j++ ) {
@@ -390,13 +400,48 @@ int ExtendedCompoundMask::_getline ( uint8_t* buffer, int line ) {
                     memcpy ( &buffer[c0+j],&buffer_m[c2+j],1 );
                 }
             }
-            delete [] buffer_m;
         }
     }
 
     return width;
 }
 
+MaskCoverage::eMaskCoverage ExtendedCompoundMask::getCoverage ( int firstLine, int lastLine ) {
+    bool data = false;
+
+    for ( uint i = ECI->getMirrorsNumber(); i < ECI->getImages()->size(); i++ ) {
+        Image* source = ECI->getImages()->at ( i );
+
+        int ol, c0, c1, c2;
+        ECI->getOffsets(i, &ol, &c0, &c1, &c2);
+
+        int first = __max ( firstLine - ol, 0 );
+        int last = __min ( lastLine - ol, source->getHeight() - 1 );
+        if ( first > last ) {
+            continue;
+        }
+        if ( source->getXmin() >= getXmax() || source->getXmax() <= getXmin() ) {
+            continue;
+        }
+
+        MaskCoverage::eMaskCoverage coverage = MaskCoverage::FULL;
+        if ( ECI->getMask ( i ) != NULL ) {
+            coverage = ECI->getMask ( i )->getCoverage ( first, last );
+        }
+
+        if ( coverage != MaskCoverage::EMPTY ) {
+            data = true;
+        }
+
+        // Une image source pleine qui couvre toute la zone suffit à la remplir
+        if ( coverage == MaskCoverage::FULL && first == firstLine - ol && last == lastLine - ol && c0 == 0 && c1 == width - 1 ) {
+            return MaskCoverage::FULL;
+        }
+    }
+
+    return data ? MaskCoverage::MIXED : MaskCoverage::EMPTY;
+}
+
 /* Implementation de getline pour les uint8_t */
 int ExtendedCompoundMask::getline ( uint8_t* buffer, int line ) {
     return _getline ( buffer, line );
@@ -404,18 +449,14 @@ int ExtendedCompoundMask::getline ( uint8_t* buffer, int line ) {
 
 /* Implementation de getline pour les float */
 int ExtendedCompoundMask::getline ( uint16_t* buffer, int line ) {
-    uint8_t* buffer_t = new uint8_t[width*channels];
-    getline ( buffer_t,line );
-    convert ( buffer,buffer_t,width*channels );
-    delete [] buffer_t;
+    getline ( maskLine,line );
+    convert ( buffer,maskLine,width*channels );
     return width*channels;
 }
 
 /* Implementation de getline pour les float */
 int ExtendedCompoundMask::getline ( float* buffer, int line ) {
-    uint8_t* buffer_t = new uint8_t[width*channels];
-    getline ( buffer_t,line );
-    convert ( buffer,buffer_t,width*channels );
-    delete [] buffer_t;
+    getline ( maskLine,line );
+    convert ( buffer,maskLine,width*channels );
     return width*channels;
 }
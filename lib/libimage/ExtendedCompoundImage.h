@@ -64,6 +64,7 @@
 #include "Format.h"
 #include "Image.h"
 #include "MirrorImage.h"
+#include "MemoryArena.h"
 
 /**
  * \author Institut national de l'information géographique et forestière
@@ -138,6 +139,18 @@ private:
      */
     int* nodata;
 
+    /**
+     * \~french \brief Buffer de lecture d'une ligne d'image source, dimensionné pour la plus large d'entre elles en flottant
+     * \~english \brief Buffer to read a source image line, sized for the widest one as float
+     */
+    uint8_t* sourceLine;
+
+    /**
+     * \~french \brief Buffer de lecture d'une ligne de masque source
+     * \~english \brief Buffer to read a source mask line
+     */
+    uint8_t* sourceMaskLine;
+
     /** \~french
      * \brief Retourne une ligne, flottante ou entière
      * \details Lorsque l'on veut récupérer une ligne d'une image composée, on va se reporter sur toutes les images source.
@@ -176,6 +189,17 @@ private:
             c1s.push_back(__min ( width - 1,x2c ( sourceImages[i]->getXmax() - 0.5*sourceImages[i]->getResX() ) ));
             c2s.push_back(__max ( 0, sourceImages[i]->x2c ( bbox.xmin + 0.5*resx ) ) );
         }
+
+        // Les buffers de lecture sont redimensionnés avec les images sources, et non à chaque ligne
+        int maxWidth = 0, maxSamples = 0;
+        for ( int i = 0; i < ( int ) sourceImages.size(); i++ ) {
+            maxWidth = __max ( maxWidth, sourceImages[i]->getWidth() );
+            maxSamples = __max ( maxSamples, sourceImages[i]->getWidth() * sourceImages[i]->channels );
+        }
+        MemoryArena::release ( sourceLine );
+        MemoryArena::release ( sourceMaskLine );
+        sourceLine = ( uint8_t* ) MemoryArena::alloc ( maxSamples * sizeof ( float ) );
+        sourceMaskLine = ( uint8_t* ) MemoryArena::alloc ( maxWidth );
     }
 
 protected:
@@ -208,7 +232,7 @@ protected:
                             std::vector<Image*>& images, int* nd, uint mirrors ) :
         Image ( width, height, channels, resx, resy, bbox ),
         sourceImages ( images ),
-        mirrorsNumber ( mirrors ) {
+        mirrorsNumber ( mirrors ), sourceLine ( NULL ), sourceMaskLine ( NULL ) {
 
         nodata = new int[channels];
         memcpy ( nodata,nd,channels*sizeof ( int ) );
@@ -354,6 +378,8 @@ public:
      */
     virtual ~ExtendedCompoundImage() {
         delete[] nodata;
+        MemoryArena::release ( sourceLine );
+        MemoryArena::release ( sourceMaskLine );
         if ( ! isMask ) {
             for ( uint i=0; i < sourceImages.size(); i++ ) {
                 delete sourceImages[i];
@@ -453,6 +479,18 @@ private:
      */
     ExtendedCompoundImage* ECI;
 
+    /**
+     * \~french \brief Buffer de lecture d'une ligne de masque source
+     * \~english \brief Buffer to read a source mask line
+     */
+    uint8_t* sourceMaskLine;
+
+    /**
+     * \~french \brief Buffer du masque sur 8 bits, avant conversion
+     * \~english \brief 8-bit mask buffer, before conversion
+     */
+    uint8_t* maskLine;
+
     /** \~french
      * \brief Retourne une ligne entière
      * \details Lors ce que l'on veut récupérer une ligne d'un masque composé, on va se reporter sur tous les masques des images source de l'image composée associée. Si une des images sources n'a pas de masque, on considère que celle-ci est pleine (ne contient pas de non-donnée).
@@ -474,19 +512,39 @@ public:
      */
     ExtendedCompoundMask ( ExtendedCompoundImage* ECI ) :
         Image ( ECI->getWidth(), ECI->getHeight(), 1, ECI->getResX(), ECI->getResY(),ECI->getBbox() ),
-        ECI ( ECI ) {}
+        ECI ( ECI ) {
+        int maxWidth = 0;
+        for ( uint i = 0; i < ECI->getImages()->size(); i++ ) {
+            maxWidth = __max ( maxWidth, ECI->getImages()->at ( i )->getWidth() );
+        }
+        sourceMaskLine = ( uint8_t* ) MemoryArena::alloc ( maxWidth );
+        maskLine = ( uint8_t* ) MemoryArena::alloc ( width );
+    }
 
     int getline ( uint8_t* buffer, int line );
     int getline ( float* buffer, int line );
     int getline ( uint16_t* buffer, int line );
 
+    /**
+     * \~french
+     * \brief Retourne la couverture du masque composé, déduite de celles des masques sources
+     * \details Le masque est plein si une image source pleine couvre toute la zone, vide si aucune source n'y a de donnée.
+     * \~english
+     * \brief Return compounded mask's coverage, deduced from source masks' ones
+     * \details Mask is full if a full source image covers the whole area, empty if no source has data in it.
+     */
+    MaskCoverage::eMaskCoverage getCoverage ( int firstLine, int lastLine );
+
     /**
      * \~french
      * \brief Destructeur par défaut
      * \~english
      * \brief Default destructor
      */
-    virtual ~ExtendedCompoundMask() {}
+    virtual ~ExtendedCompoundMask() {
+        MemoryArena::release ( sourceMaskLine );
+        MemoryArena::release ( maskLine );
+    }
 
     /** \~french
      * \brief Sortie des informations sur le masque composé
@@ -38,17 +38,82 @@
 #include "FileDataSource.h"
 #include <fcntl.h>
 #include "Logger.h"
+#include "CancellationToken.h"
 #include <cstdio>
 #include <errno.h>
 
 // Taille maximum d'une tuile WMTS
 #define MAX_TILE_SIZE 1048576
 
-FileDataSource::FileDataSource ( const char* filename, const uint32_t posoff, const uint32_t possize, std::string type, std::string encoding ) : filename ( filename ), posoff ( posoff ), possize ( possize ), type ( type ) , encoding( encoding ){    data=0;
+FileDataSource::FileDataSource ( const char* filename, const uint32_t posoff, const uint32_t possize, std::string type, std::string encoding ) : storage ( SlabStorage::getPosix() ), filename ( filename ), posoff ( posoff ), possize ( possize ), type ( type ) , encoding( encoding ), arena ( MemoryArena::getCurrent() ), object ( NULL ), indexed ( false ), tilePos ( 0 ), tileSize ( 0 ) {    data=0;
     size=0;
+    mapped=false;
 }
-FileDataSource::FileDataSource ( const char* filename, const uint32_t posoff, const uint32_t possize, std::string type ) : filename ( filename ), posoff ( posoff ), possize ( possize ), type ( type ) , encoding( "" ){    data=0;
+FileDataSource::FileDataSource ( const char* filename, const uint32_t posoff, const uint32_t possize, std::string type ) : storage ( SlabStorage::getPosix() ), filename ( filename ), posoff ( posoff ), possize ( possize ), type ( type ) , encoding( "" ), arena ( MemoryArena::getCurrent() ), object ( NULL ), indexed ( false ), tilePos ( 0 ), tileSize ( 0 ) {    data=0;
     size=0;
+    mapped=false;
+}
+FileDataSource::FileDataSource ( SlabStorage* storage, const char* filename, const uint32_t posoff, const uint32_t possize, std::string type, std::string encoding ) : storage ( storage ? storage : SlabStorage::getPosix() ), filename ( filename ), posoff ( posoff ), possize ( possize ), type ( type ) , encoding( encoding ), arena ( MemoryArena::getCurrent() ), object ( NULL ), indexed ( false ), tilePos ( 0 ), tileSize ( 0 ) {    data=0;
+    size=0;
+    mapped=false;
+}
+
+/*
+ * Ouverture de la dalle et lecture de la position et de la taille de la tuile
+ * La dalle reste ouverte pour la lecture de la tuile, l'index déjà lu n'est pas relu à sa réouverture
+ */
+bool FileDataSource::readIndex() {
+    if ( object ) return true;
+
+    // Ouverture de la dalle
+    object = storage->open ( filename );
+    if ( ! object ) {
+        return false;
+    }
+    if ( indexed ) {
+        object->setVersion ( version );
+        return true;
+    }
+    // Lecture de la position et de la taille de la tuile dans la dalle
+    if ( ! object->readIndex ( posoff, possize, tilePos, tileSize ) ) {
+        if ( object->isMissing() ) {
+            LOGGER_DEBUG ( "Dalle absente : " << filename );
+        } else {
+            LOGGER_ERROR ( "Erreur lors de la lecture de l'index de la tuile dans " << filename );
+        }
+        closeFile();
+        return false;
+    }
+    indexed = true;
+    version = object->getVersion();
+    return true;
+}
+
+void FileDataSource::closeFile() {
+    delete object;
+    object = NULL;
+}
+
+bool FileDataSource::getConstantValue ( uint8_t* value ) {
+    if ( data || ! readIndex() ) return false;
+    if ( tileSize != 0 || tilePos == 0 ) {
+        // La dalle reste ouverte pour la lecture de la tuile qui suit (getData), qui la ferme
+        return false;
+    }
+
+    if ( object->read ( value, CONSTANT_TILE_VALUE_SIZE, tilePos ) != CONSTANT_TILE_VALUE_SIZE ) {
+        if ( object->isStale() ) {
+            // Dalle modifiée : l'index sera relu à la lecture de la tuile
+            LOGGER_DEBUG ( "Dalle modifiee depuis la lecture de son index : " << filename );
+            indexed = false;
+        } else {
+            LOGGER_ERROR ( "Impossible de lire la valeur de la tuile constante dans le fichier " << filename );
+        }
+        closeFile();
+        return false;
+    }
+    closeFile();
+    return true;
 }
 
 /*
@@ -62,54 +127,60 @@ const uint8_t* FileDataSource::getData ( size_t &tile_size ) {
         return data;
     }
 
-    // Ouverture du fichier
-    int fildes = open ( filename.c_str(), O_RDONLY );
-    if ( fildes < 0 ) {
-        LOGGER_DEBUG ( "Can't open file " << filename );
-        return 0;
-    }
-    // Lecture de la position de la tuile dans le fichier
-    uint32_t pos;
-    size_t read_size;
-    if ( read_size=pread ( fildes, &pos, sizeof ( uint32_t ), posoff ) != 4 ) {
-        LOGGER_ERROR ( "Erreur lors de la lecture de la position de la tuile dans le fichier " << filename );
-        if ( read_size<0 )
-            LOGGER_ERROR ( "Code erreur="<<errno );
-        close ( fildes );
+    // Requête annulée : la tuile n'est pas lue
+    if ( CancellationToken::currentCancelled() ) {
         return 0;
     }
-    // Lecture de la taille de la tuile dans le fichier
-    // Ne lire que 4 octets (la taille de tile_size est plateforme-dependante)
-    uint32_t tmp;
-    if ( read_size=pread ( fildes, &tmp, sizeof ( uint32_t ), possize ) != 4 ) {
-        LOGGER_ERROR ( "Erreur lors de la lecture de la taille de la tuile dans le fichier " << filename );
-        if ( read_size<0 )
-            LOGGER_ERROR ( "Code erreur="<<errno );
-        close ( fildes );
-        return 0;
-    }
-    tile_size=tmp;
-    // La taille de la tuile ne doit pas exceder un seuil
-    // Objectif : gerer le cas de fichiers TIFF non conformes aux specs du cache
-    // (et qui pourraient indiquer des tailles de tuiles excessives)
-    if ( tile_size > MAX_TILE_SIZE ) {
-        LOGGER_ERROR ( "Tuile trop volumineuse dans le fichier " << filename ) ;
-        close ( fildes );
-        return 0;
-    }
-    // Lecture de la tuile
-    data = new uint8_t[tile_size];
-    read_size=pread ( fildes, data, tile_size, pos );
-    if ( read_size!=tile_size ) {
+
+    // Dalle modifiée depuis la lecture de son index : l'index est relu, une seule fois
+    for ( int attempt = 0; ; attempt++ ) {
+        if ( ! readIndex() ) {
+            return 0;
+        }
+        tile_size=tileSize;
+        // Une tuile constante n'a pas de données encodées (cf. getConstantValue)
+        if ( tile_size == 0 && tilePos != 0 ) {
+            LOGGER_DEBUG ( "Tuile constante dans le fichier " << filename );
+            closeFile();
+            return 0;
+        }
+        // La taille de la tuile ne doit pas exceder un seuil
+        // Objectif : gerer le cas de fichiers TIFF non conformes aux specs du cache
+        // (et qui pourraient indiquer des tailles de tuiles excessives)
+        if ( tile_size > MAX_TILE_SIZE ) {
+            LOGGER_ERROR ( "Tuile trop volumineuse dans le fichier " << filename ) ;
+            closeFile();
+            return 0;
+        }
+        // Dalle projetée en mémoire : la tuile est lue sans copie, la dalle reste ouverte
+        const uint8_t* mappedData = object->map ( tile_size, tilePos );
+        if ( mappedData ) {
+            data = const_cast<uint8_t*> ( mappedData );
+            size = tile_size;
+            mapped = true;
+            return data;
+        }
+        // Lecture de la tuile
+        data = ( uint8_t* ) MemoryArena::alloc ( MemoryArena::usable ( arena ), tile_size );
+        ssize_t read_size=object->read ( data, tile_size, tilePos );
+        if ( read_size == ( ssize_t ) tile_size ) break;
+
+        MemoryArena::release ( data );
+        data = 0;
+        if ( object->isStale() && attempt == 0 ) {
+            LOGGER_DEBUG ( "Dalle modifiee depuis la lecture de son index, relecture de l'index : " << filename );
+            indexed = false;
+            closeFile();
+            continue;
+        }
         LOGGER_ERROR ( "Impossible de lire la tuile dans le fichier " << filename );
         if ( read_size<0 )
             LOGGER_ERROR ( "Code erreur="<<errno );
-        delete[] data;
-        close ( fildes );
+        closeFile();
         return 0;
     }
     size=tile_size;
-    close ( fildes );
+    closeFile();
     return data;
 }
 
@@ -118,8 +189,11 @@ const uint8_t* FileDataSource::getData ( size_t &tile_size ) {
 * @return true en cas de succes
 */
 bool FileDataSource::releaseData() {
-    if (data)
-      delete[] data;
+    if ( mapped ) {
+        closeFile();
+        mapped = false;
+    } else if (data)
+      MemoryArena::release ( data );
     data = 0;
     return true;
 }
@@ -39,6 +39,13 @@
 #define _FILEDATASOURCE_
 
 #include "Data.h"
+#include "SlabStorage.h"
+
+/*
+ * Taille de la valeur d'une tuile constante dans une dalle (au plus 4 canaux flottants).
+ * Une tuile constante est indexée avec une taille nulle, sa position pointant vers cette valeur.
+ */
+#define CONSTANT_TILE_VALUE_SIZE 16
 
 /*
  * Classe qui lit les tuiles d'un fichier tuilé.
@@ -46,18 +53,42 @@
 
 class FileDataSource : public DataSource {
 private:
+    // Stockage de la dalle (POSIX par défaut)
+    SlabStorage* storage;
     std::string filename;
     const uint32_t posoff;		// Position dans le fichier des 4 octets indiquant la position de la tuile dans le fichier
     const uint32_t possize;		// Position dans le fichier des 4 octets indiquant la taille de la tuile dans le fichier
     uint8_t* data;
     size_t size;
+    // Vrai si data pointe dans la projection de la dalle, qui reste alors ouverte jusqu'à releaseData
+    bool mapped;
     std::string type;
     std::string encoding;
+    // Arène active à la construction, dans laquelle est allouée la tuile lue si elle est lue par le même thread
+    MemoryArena* arena;
+    // Dalle ouverte (NULL si fermée) et index de la tuile, conservé après la fermeture de la dalle avec la version de la dalle lue
+    SlabObject* object;
+    bool indexed;
+    uint32_t tilePos;
+    uint32_t tileSize;
+    std::string version;
+
+    bool readIndex();
+    void closeFile();
 public:
     FileDataSource ( const char* filename, const uint32_t posoff, const uint32_t possize, std::string type );
     FileDataSource ( const char* filename, const uint32_t posoff, const uint32_t possize, std::string type , std::string encoding );
+    FileDataSource ( SlabStorage* storage, const char* filename, const uint32_t posoff, const uint32_t possize, std::string type , std::string encoding );
     const uint8_t* getData ( size_t &tile_size );
 
+    /*
+     * Teste si la tuile est constante (taille nulle et position non nulle dans l'index) et lit alors sa valeur
+     * @param value tableau d'au moins CONSTANT_TILE_VALUE_SIZE octets, recevant la valeur du pixel tel que décodé
+     * @return vrai si la tuile est constante, getData ne renvoyant alors aucune donnée
+     * Sinon, la dalle reste ouverte jusqu'à la lecture de la tuile par getData (ou la destruction de la source)
+     */
+    bool getConstantValue ( uint8_t* value );
+
     /*
      * @ return le type MIME de la source de donnees
      */
@@ -69,6 +100,15 @@ public:
 
     ~FileDataSource() {
         releaseData();
+        closeFile();
+    }
+
+    // Allocation dans l'arène de la requête en cours, s'il y en a une
+    static void* operator new ( size_t size ) {
+        return MemoryArena::alloc ( size );
+    }
+    static void operator delete ( void* ptr ) {
+        MemoryArena::release ( ptr );
     }
 
     int getHttpStatus() {
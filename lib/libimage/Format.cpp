@@ -45,6 +45,7 @@
  * \li Format : énumère et manipule les différentes format d'image
  * \li Photometric : énumère et manipule les différentes photométries
  * \li ExtraSample : énumère et manipule les différents type de canal supplémentaire
+ * \li Predictor : énumère et manipule les différents prédicteurs TIFF
  ** \~english
  * \brief Implement the namespaces Compression, SampleFormat, Photometric, ExtraSample et Format
  * \details
@@ -53,10 +54,12 @@
  * \li Format : enumerate and managed different formats
  * \li Photometric : enumerate and managed different photometrics
  * \li ExtraSample : enumerate and managed different extra sample types
+ * \li Predictor : enumerate and managed different TIFF predictors
  */
 
 #include "Format.h"
 #include <string.h>
+#include "Zstd_library_config.h"
 
 namespace Compression {
 
@@ -68,7 +71,8 @@ const char *compression_name[] = {
     "PNG",
     "LZW",
     "PACKBITS",
-    "JPEG2000"
+    "JPEG2000",
+    "ZSTD"
 };
 
 eCompression fromString ( std::string strComp ) {
@@ -84,6 +88,13 @@ std::string toString ( eCompression comp ) {
     return std::string ( compression_name[comp] );
 }
 
+bool isAvailable ( eCompression comp ) {
+#ifndef ZSTD_USE
+    if ( comp == ZSTD ) return false;
+#endif
+    return comp != UNKNOWN;
+}
+
 }
 
 namespace Photometric {
@@ -134,6 +145,30 @@ std::string toString ( eExtraSample es ) {
 
 }
 
+namespace Predictor {
+
+const char *predictor_name[] = {
+    "UNKNOWN",
+    "NONE",
+    "HORIZONTAL",
+    "FLOATINGPOINT"
+};
+
+ePredictor fromString ( std::string strPred ) {
+    int i;
+    for ( i = predictor_size; i ; --i ) {
+        if ( strPred.compare ( predictor_name[i] ) == 0 )
+            break;
+    }
+    return static_cast<ePredictor> ( i );
+}
+
+std::string toString ( ePredictor pred ) {
+    return std::string ( predictor_name[pred] );
+}
+
+}
+
 namespace SampleFormat {
 
 const char *sampleformat_name[] = {
@@ -167,10 +202,16 @@ const char *eformat_name[] = {
     "TIFF_LZW_INT8",
     "TIFF_ZIP_INT8",
     "TIFF_PKB_INT8",
+    "TIFF_ZSTD_INT8",
+    "TIFF_RAW_UINT16",
+    "TIFF_LZW_UINT16",
+    "TIFF_ZIP_UINT16",
+    "TIFF_PKB_UINT16",
     "TIFF_RAW_FLOAT32",
     "TIFF_LZW_FLOAT32",
     "TIFF_ZIP_FLOAT32",
-    "TIFF_PKB_FLOAT32"
+    "TIFF_PKB_FLOAT32",
+    "TIFF_ZSTD_FLOAT32"
 };
 
 const char *eformat_mime[] = {
@@ -181,9 +222,15 @@ const char *eformat_mime[] = {
     "image/tiff",
     "image/tiff",
     "image/tiff",
+    "image/tiff",
+    "image/tiff",
+    "image/tiff",
+    "image/tiff",
+    "image/tiff",
     "image/x-bil;bits=32",
     "image/tiff",
     "image/x-bil;bits=32",
+    "image/tiff",
     "image/tiff"
 };
 
@@ -197,7 +244,13 @@ const char *eformat_encoding[] = {
     "",
     "",
     "",
+    "",
+    "",
+    "",
+    "",
+    "",
     "deflate",
+    "",
     ""
 };
 
@@ -222,4 +275,10 @@ std::string toEncoding ( eformat_data format ) {
     return std::string ( eformat_encoding[format] );
 }
 
+int toSampleSize ( eformat_data format ) {
+    if ( format >= eformat_float ) return 4;
+    if ( format >= TIFF_RAW_UINT16 ) return 2;
+    return 1;
+}
+
 }
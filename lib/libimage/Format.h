@@ -62,6 +62,11 @@
 #include <stdint.h>
 #include "tiff.h"
 
+// Code de compression Zstandard, absent des versions anciennes de la libtiff
+#ifndef COMPRESSION_ZSTD
+#define COMPRESSION_ZSTD 50000
+#endif
+
 /**
  * \author Institut national de l'information géographique et forestière
  * \~french \brief Gestion des informations liées au format de canal
@@ -129,14 +134,15 @@ enum eCompression {
     PNG = 4,
     LZW = 5,
     PACKBITS = 6,
-    JPEG2000 = 7
+    JPEG2000 = 7,
+    ZSTD = 8
 };
 
 /**
  * \~french \brief Nombre de compressions disponibles
  * \~english \brief Number of available compressions
  */
-const int compression_size = 7;
+const int compression_size = 8;
 
 /**
  * \~french \brief Conversion d'une chaîne de caractères vers une compression de l'énumération
@@ -158,6 +164,16 @@ eCompression fromString ( std::string strComp );
  */
 std::string toString ( eCompression comp );
 
+/**
+ * \~french \brief Précise si la compression est disponible dans cette compilation
+ * \details La compression ZSTD n'est disponible que si la bibliothèque a été compilée avec l'option ZSTD_USE.
+ * \param[in] comp compression à tester
+ * \~english \brief Tell if the compression is available in this build
+ * \details ZSTD compression is only available if the library has been built with the ZSTD_USE option.
+ * \param[in] comp compression to test
+ */
+bool isAvailable ( eCompression comp );
+
 }
 
 
@@ -259,6 +275,55 @@ std::string toString ( eExtraSample es );
 
 
 
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french \brief Gestion des prédicteurs TIFF, appliqués aux données avant une compression sans perte
+ * \~english \brief Manage TIFF predictors, applied to data before a lossless compression
+ */
+namespace Predictor {
+/**
+ * \~french \brief Énumération des prédicteurs disponibles
+ * \details Les valeurs sont celles du tag TIFF Predictor (317)
+ * \~english \brief Available predictors enumeration
+ * \details Values are the TIFF Predictor tag (317) ones
+ */
+enum ePredictor {
+    UNKNOWN = 0,
+    NONE = 1,
+    HORIZONTAL = 2,
+    FLOATINGPOINT = 3
+};
+
+/**
+ * \~french \brief Nombre de prédicteurs disponibles
+ * \~english \brief Number of available predictors
+ */
+const int predictor_size = 3;
+
+/**
+ * \~french \brief Conversion d'une chaîne de caractères vers un prédicteur de l'énumération
+ * \param[in] strPred chaîne de caractère à convertir
+ * \return le prédicteur correspondant, UNKNOWN (0) si la chaîne n'est pas reconnue
+ * \~english \brief Convert a string to a predictor enumeration member
+ * \param[in] strPred string to convert
+ * \return the binding predictor, UNKNOWN (0) if string is not recognized
+ */
+ePredictor fromString ( std::string strPred );
+
+/**
+ * \~french \brief Conversion d'un prédicteur vers une chaîne de caractères
+ * \param[in] pred prédicteur à convertir
+ * \return la chaîne de caractère nommant le prédicteur
+ * \~english \brief Convert a predictor to a string
+ * \param[in] pred predictor to convert
+ * \return string namming the predictor
+ */
+std::string toString ( ePredictor pred );
+
+}
+
+
+
 /**
  * \author Institut national de l'information géographique et forestière
  * \~french \brief Gestion des informations liées au format des données
@@ -279,24 +344,31 @@ enum eformat_data {
     TIFF_LZW_INT8 = 4,
     TIFF_ZIP_INT8 = 5,
     TIFF_PKB_INT8 = 6,
+    TIFF_ZSTD_INT8 = 7,
+    // Les entiers sur 16 bits, toujours avant les flottants
+    TIFF_RAW_UINT16 = 8,
+    TIFF_LZW_UINT16 = 9,
+    TIFF_ZIP_UINT16 = 10,
+    TIFF_PKB_UINT16 = 11,
     // Les formats flottant doivent bien être à partir d'ici (et corriger eformat_float si le nombre de format entier augmente)
-    TIFF_RAW_FLOAT32 = 7,
-    TIFF_LZW_FLOAT32 = 8,
-    TIFF_ZIP_FLOAT32 = 9,
-    TIFF_PKB_FLOAT32 = 10
+    TIFF_RAW_FLOAT32 = 12,
+    TIFF_LZW_FLOAT32 = 13,
+    TIFF_ZIP_FLOAT32 = 14,
+    TIFF_PKB_FLOAT32 = 15,
+    TIFF_ZSTD_FLOAT32 = 16
 };
 
 /**
  * \~french \brief Nombre de formats disponibles
  * \~english \brief Number of available formats
  */
-const int eformat_size = 10;
+const int eformat_size = 16;
 
 /**
  * \~french \brief Indice du premier format flottant dans l'énumération
  * \~english \brief First float format indice into enumeration
  */
-const int eformat_float = 7;
+const int eformat_float = 12;
 
 /**
  * \~french \brief Conversion d'une chaîne de caractère vers un format
@@ -330,6 +402,16 @@ std::string toMimeType ( eformat_data format );
 
 std::string toEncoding ( eformat_data format );
 
+/**
+ * \~french \brief Taille en octet d'un canal de pixel pour un format
+ * \param[in] format format de données
+ * \return 4 pour les flottants, 2 pour les entiers 16 bits, 1 sinon
+ * \~english \brief Size in byte of a pixel's sample for a format
+ * \param[in] format data format
+ * \return 4 for floats, 2 for 16-bit integers, 1 otherwise
+ */
+int toSampleSize ( eformat_data format );
+
 }
 
 #endif //FORMAT_H
@@ -50,6 +50,13 @@
 #include "Logger.h"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <list>
+#include <map>
+#include <sstream>
+#include <vector>
+#include <cstring>
 
 #ifndef __max
 #define __max(a, b)   ( ((a) > (b)) ? (a) : (b) )
@@ -61,14 +68,67 @@
 // Définit dans BoundingBox
 //static pthread_mutex_t mutex_proj = PTHREAD_MUTEX_INITIALIZER;
 
-Grid::Grid ( int width, int height, BoundingBox<double> bbox ) : width ( width ), height ( height ), bbox ( bbox ) {
+double Grid::maxError = 0.;
+int Grid::cacheSize = 0;
+
+/* Cache LRU des grilles reprojetées, commun au processus.
+ * Les grilles conservées sont des copies : elles ne sont jamais modifiées et sont libérées à leur éviction.
+ */
+typedef std::list<std::pair<std::string, Grid*> > GridLru;
+static GridLru gridLru;
+static std::map<std::string, GridLru::iterator> gridIndex;
+static pthread_mutex_t mutex_grid_cache = PTHREAD_MUTEX_INITIALIZER;
+
+void Grid::configure ( double maxError, int cacheSize ) {
+    pthread_mutex_lock ( &mutex_grid_cache );
+    Grid::maxError = maxError;
+    Grid::cacheSize = cacheSize;
+    for ( GridLru::iterator it = gridLru.begin(); it != gridLru.end(); it++ ) {
+        delete it->second;
+    }
+    gridLru.clear();
+    gridIndex.clear();
+    pthread_mutex_unlock ( &mutex_grid_cache );
+}
+
+Grid::Grid ( int width, int height, BoundingBox<double> bbox ) : gridX ( 0 ), gridY ( 0 ), width ( width ), height ( height ), bbox ( bbox ) {
 
     if (width == 0 || height == 0) {
         LOGGER_ERROR("One grid's dimension is null");
     }
 
-    nbxReg = 1 + ( width-1 ) /stepInt;
-    nbyReg = 1 + ( height-1 ) /stepInt;
+    init ( GRID_DEFAULT_STEP );
+}
+
+Grid::Grid ( const Grid& other ) : gridX ( 0 ), gridY ( 0 ), width ( other.width ), height ( other.height ), bbox ( other.bbox ) {
+    copy ( other );
+}
+
+void Grid::copy ( const Grid& other ) {
+    step = other.step;
+    deltaY = other.deltaY;
+    nbxReg = other.nbxReg;
+    nbyReg = other.nbyReg;
+    nbx = other.nbx;
+    nby = other.nby;
+    endX = other.endX;
+    endY = other.endY;
+    bbox = other.bbox;
+
+    delete[] gridX;
+    delete[] gridY;
+    gridX = new double[ nbx * nby ];
+    gridY = new double[ nbx * nby ];
+    memcpy ( gridX, other.gridX, nbx * nby * sizeof ( double ) );
+    memcpy ( gridY, other.gridY, nbx * nby * sizeof ( double ) );
+}
+
+void Grid::init ( int step ) {
+
+    this->step = step;
+
+    nbxReg = 1 + ( width-1 ) /step;
+    nbyReg = 1 + ( height-1 ) /step;
 
     nbx = nbxReg;
     nby = nbyReg;
@@ -81,8 +141,8 @@ Grid::Grid ( int width, int height, BoundingBox<double> bbox ) : width ( width )
     nbx = nbxReg + 1;
     nby = nbyReg + 1;
 
-    endX = width - 1 - ( nbxReg-1 ) * stepInt;
-    endY = height - 1 - ( nbyReg-1 ) * stepInt;
+    endX = width - 1 - ( nbxReg-1 ) * step;
+    endY = height - 1 - ( nbyReg-1 ) * step;
 
     double resX = ( bbox.xmax - bbox.xmin ) / double ( width );
     double resY = ( bbox.ymax - bbox.ymin ) / double ( height );
@@ -92,9 +152,11 @@ Grid::Grid ( int width, int height, BoundingBox<double> bbox ) : width ( width )
     double top = bbox.ymax - 0.5 * resY;
 
     // Calcul du pas en unité terrain (et non pixel)
-    double stepX = stepInt * resX;
-    double stepY = stepInt * resY;
+    double stepX = step * resX;
+    double stepY = step * resY;
 
+    delete[] gridX;
+    delete[] gridY;
     gridX = new double[ nbx * nby ];
     gridY = new double[ nbx * nby ];
 
@@ -213,9 +275,101 @@ double Grid::getRatioX()
 }
 
 
+/* Reprojette n points, en gérant les conversions degrés/radians.
+ * Les points non reprojetables valent HUGE_VAL.
+ */
+static int transformPoints ( projPJ pj_src, projPJ pj_dst, int n, double* x, double* y ) {
+    // Note that geographic locations need to be passed in radians, not decimal degrees,
+    // and will be returned similarly
+    if ( pj_is_latlong ( pj_src ) )
+        for ( int i = 0; i < n; i++ ) {
+            x[i] *= DEG_TO_RAD;
+            y[i] *= DEG_TO_RAD;
+        }
+
+    int code = pj_transform ( pj_src, pj_dst, n, 0, x, y, 0 );
+
+    if ( code == 0 && pj_is_latlong ( pj_dst ) )
+        for ( int i = 0; i < n; i++ ) {
+            if ( x[i] == HUGE_VAL || y[i] == HUGE_VAL ) continue;
+            x[i] *= RAD_TO_DEG;
+            y[i] *= RAD_TO_DEG;
+        }
+
+    return code;
+}
+
+double Grid::interpolationError ( void* pj_src, void* pj_dst ) {
+
+    double resX = ( bbox.xmax - bbox.xmin ) / double ( width );
+    double resY = ( bbox.ymax - bbox.ymin ) / double ( height );
+    double left = bbox.xmin + 0.5 * resX;
+    double top = bbox.ymax - 0.5 * resY;
+
+    // Centres des mailles non dégénérées
+    std::vector<int> cells;
+    std::vector<double> CX, CY;
+    for ( int y = 0; y < nby - 1; y++ ) {
+        if ( pixelY ( y+1 ) == pixelY ( y ) ) continue;
+        for ( int x = 0; x < nbx - 1; x++ ) {
+            if ( pixelX ( x+1 ) == pixelX ( x ) ) continue;
+            cells.push_back ( nbx*y + x );
+            CX.push_back ( left + 0.5 * ( pixelX ( x ) + pixelX ( x+1 ) ) * resX );
+            CY.push_back ( top - 0.5 * ( pixelY ( y ) + pixelY ( y+1 ) ) * resY );
+        }
+    }
+
+    if ( cells.empty() ) return 0.;
+
+    if ( transformPoints ( ( projPJ ) pj_src, ( projPJ ) pj_dst, cells.size(), &CX[0], &CY[0] ) != 0 ) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    double error = 0.;
+    for ( unsigned int c = 0; c < cells.size(); c++ ) {
+        if ( CX[c] == HUGE_VAL || CY[c] == HUGE_VAL ) {
+            return std::numeric_limits<double>::infinity();
+        }
+
+        int i = cells[c];
+        int x = i % nbx, y = i / nbx;
+        double mx = 0.25 * ( gridX[i] + gridX[i+1] + gridX[i+nbx] + gridX[i+nbx+1] );
+        double my = 0.25 * ( gridY[i] + gridY[i+1] + gridY[i+nbx] + gridY[i+nbx+1] );
+
+        // Taille locale d'un pixel, dans le système de destination
+        double px = hypot ( gridX[i+1] - gridX[i], gridY[i+1] - gridY[i] ) / ( pixelX ( x+1 ) - pixelX ( x ) );
+        double py = hypot ( gridX[i+nbx] - gridX[i], gridY[i+nbx] - gridY[i] ) / ( pixelY ( y+1 ) - pixelY ( y ) );
+        double pixel = __max ( px, py );
+        if ( pixel <= 0. ) continue;
+
+        error = __max ( error, hypot ( CX[c] - mx, CY[c] - my ) / pixel );
+    }
+
+    return error;
+}
+
 bool Grid::reproject ( std::string from_srs, std::string to_srs ) {
     LOGGER_DEBUG ( from_srs<<" -> " <<to_srs );
 
+    std::ostringstream key;
+    key.precision ( 17 );
+    key << from_srs << " " << to_srs << " " << width << " " << height << " "
+        << bbox.xmin << " " << bbox.ymin << " " << bbox.xmax << " " << bbox.ymax;
+
+    // La grille a-t-elle déjà été reprojetée ?
+    pthread_mutex_lock ( &mutex_grid_cache );
+    if ( cacheSize > 0 ) {
+        std::map<std::string, GridLru::iterator>::iterator it = gridIndex.find ( key.str() );
+        if ( it != gridIndex.end() ) {
+            gridLru.splice ( gridLru.begin(), gridLru, it->second );
+            copy ( * ( it->second->second ) );
+            pthread_mutex_unlock ( &mutex_grid_cache );
+            LOGGER_DEBUG ( "Grille reprise du cache, pas de " << step );
+            return true;
+        }
+    }
+    pthread_mutex_unlock ( &mutex_grid_cache );
+
     pthread_mutex_lock ( & mutex_proj );
 
 
@@ -242,50 +396,51 @@ bool Grid::reproject ( std::string from_srs, std::string to_srs ) {
         return false;
     }
 
-    LOGGER_DEBUG ( "Avant (centre du pixel en haut à gauche) "<< gridX[0] << " " << gridY[0] );
-    LOGGER_DEBUG ( "Avant (centre du pixel en haut à droite) "<< gridX[nbx-1] << " " << gridY[nbx-1] );
-    LOGGER_DEBUG ( "Avant (centre du pixel en bas à gauche) "<< gridX[nbx*(nby-1)] << " " << gridY[nbx*(nby-1)] );
-    LOGGER_DEBUG ( "Avant (centre du pixel en bas à droite) "<< gridX[nbx*nby-1] << " " << gridY[nbx*nby-1] );
+    /* Avec une erreur maximale configurée, on part d'un pas large que l'on divise par deux
+     * tant que l'interpolation linéaire entre les points de la grille n'est pas assez précise */
+    int newStep = ( maxError > 0. ) ? GRID_MAX_STEP : GRID_DEFAULT_STEP;
 
-    // Note that geographic locations need to be passed in radians, not decimal degrees,
-    // and will be returned similarly
+    while ( true ) {
+        if ( newStep != step ) init ( newStep );
 
-    if ( pj_is_latlong ( pj_src ) )
-        for ( int i = 0; i < nbx*nby; i++ ) {
-            gridX[i] *= DEG_TO_RAD;
-            gridY[i] *= DEG_TO_RAD;
-        }
+        LOGGER_DEBUG ( "Avant (centre du pixel en haut à gauche) "<< gridX[0] << " " << gridY[0] );
+        LOGGER_DEBUG ( "Avant (centre du pixel en haut à droite) "<< gridX[nbx-1] << " " << gridY[nbx-1] );
+        LOGGER_DEBUG ( "Avant (centre du pixel en bas à gauche) "<< gridX[nbx*(nby-1)] << " " << gridY[nbx*(nby-1)] );
+        LOGGER_DEBUG ( "Avant (centre du pixel en bas à droite) "<< gridX[nbx*nby-1] << " " << gridY[nbx*nby-1] );
 
-    // On reprojette toutes les coordonnées
-    int code = pj_transform ( pj_src, pj_dst, nbx*nby, 0, gridX, gridY, 0 );
+        // On reprojette toutes les coordonnées
+        int code = transformPoints ( pj_src, pj_dst, nbx*nby, gridX, gridY );
 
-    if ( code != 0 ) {
-        LOGGER_ERROR ( "Code erreur proj4 : " << code );
-        pj_free ( pj_src );
-        pj_free ( pj_dst );
-        pj_ctx_free ( ctx );
-        pthread_mutex_unlock ( & mutex_proj );
-        return false;
-    }
-
-    // On vérifie que le résultat renvoyé par la reprojection est valide
-    for ( int i = 0; i < nbx*nby; i++ ) {
-        if ( gridX[i] == HUGE_VAL || gridY[i] == HUGE_VAL ) {
-            LOGGER_ERROR ( "Valeurs retournees par pj_transform invalides" );
+        if ( code != 0 ) {
+            LOGGER_ERROR ( "Code erreur proj4 : " << code );
             pj_free ( pj_src );
             pj_free ( pj_dst );
             pj_ctx_free ( ctx );
             pthread_mutex_unlock ( & mutex_proj );
             return false;
         }
-    }
 
-    if ( pj_is_latlong ( pj_dst ) )
+        // On vérifie que le résultat renvoyé par la reprojection est valide
         for ( int i = 0; i < nbx*nby; i++ ) {
-            gridX[i] *= RAD_TO_DEG;
-            gridY[i] *= RAD_TO_DEG;
+            if ( gridX[i] == HUGE_VAL || gridY[i] == HUGE_VAL ) {
+                LOGGER_ERROR ( "Valeurs retournees par pj_transform invalides" );
+                pj_free ( pj_src );
+                pj_free ( pj_dst );
+                pj_ctx_free ( ctx );
+                pthread_mutex_unlock ( & mutex_proj );
+                return false;
+            }
         }
 
+        if ( maxError <= 0. || newStep <= GRID_MIN_STEP ) break;
+
+        double error = interpolationError ( pj_src, pj_dst );
+        LOGGER_DEBUG ( "Erreur d'interpolation avec un pas de " << newStep << " : " << error << " pixel" );
+        if ( error <= maxError ) break;
+
+        newStep /= 2;
+    }
+
     LOGGER_DEBUG ( "Apres (centre du pixel en haut à gauche) "<<gridX[0]<<" "<<gridY[0] );
     LOGGER_DEBUG ( "Apres (centre du pixel en haut à droite) "<<gridX[nbx-1]<<" "<<gridY[nbx-1] );
     LOGGER_DEBUG ( "Apres (centre du pixel en bas à gauche) "<<gridX[nbx*(nby-1)]<<" "<<gridY[nbx*(nby-1)] );
@@ -315,22 +470,35 @@ bool Grid::reproject ( std::string from_srs, std::string to_srs ) {
     pj_ctx_free ( ctx );
     pthread_mutex_unlock ( & mutex_proj );
 
+    // On conserve une copie de la grille reprojetée
+    pthread_mutex_lock ( &mutex_grid_cache );
+    if ( cacheSize > 0 && gridIndex.find ( key.str() ) == gridIndex.end() ) {
+        gridLru.push_front ( std::make_pair ( key.str(), new Grid ( *this ) ) );
+        gridIndex[key.str()] = gridLru.begin();
+        while ( ( int ) gridLru.size() > cacheSize ) {
+            gridIndex.erase ( gridLru.back().first );
+            delete gridLru.back().second;
+            gridLru.pop_back();
+        }
+    }
+    pthread_mutex_unlock ( &mutex_grid_cache );
+
     return true;
 }
 
 int Grid::getline ( int line, float* X, float* Y ) {
 
-    int dy = line / stepInt;
+    int dy = line / step;
     double w = 0;
 
     if ( dy == nbyReg - 1 ) {
         if ( endY == 0 ) {
             w = 0;
         } else {
-            w = ( ( line%stepInt ) ) / double ( endY );
+            w = ( ( line%step ) ) / double ( endY );
         }
     } else {
-        w = ( line%stepInt ) / double ( stepInt );
+        w = ( line%step ) / double ( step );
     }
 
     double LX[nbx], LY[nbx];
@@ -342,13 +510,13 @@ int Grid::getline ( int line, float* X, float* Y ) {
     }
 
     // Indice dans la grille du dernier pixel reprojetée car respecte le pas de base (dans le sens des x)
-    int lastRegularPixel = ( nbxReg-1 ) *stepInt;
+    int lastRegularPixel = ( nbxReg-1 ) *step;
 
     /* Interpolation dans le sens des X, sur la partie où la répartition des pixels reprojetés
-     * est régulière (tous les stepInt pixels */
+     * est régulière (tous les step pixels */
     for ( int i = 0; i <= lastRegularPixel; i++ ) {
-        int dx = i / stepInt;
-        double w = ( i%stepInt ) /double ( stepInt );
+        int dx = i / step;
+        double w = ( i%step ) /double ( step );
         X[i] = ( 1-w ) *LX[dx] + w*LX[dx+1];
         Y[i] = ( 1-w ) *LY[dx] + w*LY[dx+1];
     }
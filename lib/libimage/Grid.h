@@ -49,16 +49,32 @@
 #include "BoundingBox.h"
 #include <string>
 
+/**
+ * \~french \brief Pas (en pixel) de la grille lorsque l'erreur d'interpolation n'est pas contrôlée
+ * \~english \brief Grid's step, in pixel, when interpolation error is not controlled
+ */
+#define GRID_DEFAULT_STEP 16
+/**
+ * \~french \brief Pas maximal (en pixel) d'une grille adaptative
+ * \~english \brief Adaptive grid's maximal step, in pixel
+ */
+#define GRID_MAX_STEP 256
+/**
+ * \~french \brief Pas minimal (en pixel) d'une grille adaptative
+ * \~english \brief Adaptive grid's minimal step, in pixel
+ */
+#define GRID_MIN_STEP 4
+
 /**
  * \author Institut national de l'information géographique et forestière
  * \~french \brief Gestion d'une grille de reprojection
  * \details Une grille est un objet utilisé afin de reprojeter des images (avec ReprojectedImage). On voudra connaître les coordonnées pixel dans l'image source d'un pixel de l'image reprojetée.
  *
- * On imagine donc un quadrillage aux mêmes dimensions que l'image reprojetée (largeur, hauteur et rectangle englobant). On ne va pas convertir tous les pixels de l'image (problème de performance). On va donc en convertir un tous les #stepInt pixels : c'est ce qu'on considère comme la grille.
+ * On imagine donc un quadrillage aux mêmes dimensions que l'image reprojetée (largeur, hauteur et rectangle englobant). On ne va pas convertir tous les pixels de l'image (problème de performance). On va donc en convertir un tous les #step pixels : c'est ce qu'on considère comme la grille.
  *
  * \~ \image html grid_general.png \~french
  *
- * La grille ne sera pas composée que de ces pixels régulièrement espacés (#nbxReg sur #nbyReg). On va également ajouter les pixels du bords : on aura donc en tout (#nbxReg + 1) x (#nbyReg + 1) points dans notre grille. Les derniers points d'une ligne ou d'une colonne seront donc moins espacés. Cette distance, strictement inférieure à #stepInt, sera connue est stockée dans #endX et #endY.
+ * La grille ne sera pas composée que de ces pixels régulièrement espacés (#nbxReg sur #nbyReg). On va également ajouter les pixels du bords : on aura donc en tout (#nbxReg + 1) x (#nbyReg + 1) points dans notre grille. Les derniers points d'une ligne ou d'une colonne seront donc moins espacés. Cette distance, strictement inférieure à #step, sera connue est stockée dans #endX et #endY.
  *
  * Dans le cas où l'espacement régulier permet d'avoir le dernier point, on ajoutera tout de même un point supplémentaire. Les deux derniers points de chaque ligne et colonne seront donc identiques. Cela permet d'avoir un comportement plus général.
  *
@@ -69,6 +85,8 @@
  *
  * Cette grille peut enfin être fournie à l'objet ReprojectedImage.
  *
+ * Si une erreur maximale a été configurée (Grid#configure), le pas n'est pas fixe : on part d'un pas de #GRID_MAX_STEP pixels et on le divise par deux tant que l'erreur commise par l'interpolation linéaire, mesurée au centre des mailles, dépasse cette fraction de pixel (sans descendre sous #GRID_MIN_STEP). Les grilles reprojetées sont de plus conservées dans un cache LRU commun au processus, identifié par les systèmes spatiaux, le rectangle englobant et les dimensions : une grille déjà calculée est recopiée sans appel à PROJ.
+ *
  * \~english \brief Reprojection grid management
  */
 class Grid {
@@ -78,7 +96,19 @@ private:
      * \~french \brief Pas (en pixel) de la grille
      * \~english \brief Grid's step, in pixel
      */
-    static const int stepInt = 16;
+    int step;
+
+    /**
+     * \~french \brief Erreur d'interpolation maximale, en pixel, 0 pour un pas fixe
+     * \~english \brief Maximal interpolation error, in pixel, 0 for a fixed step
+     */
+    static double maxError;
+
+    /**
+     * \~french \brief Nombre maximal de grilles reprojetées conservées, 0 si le cache est désactivé
+     * \~english \brief Maximal number of kept reprojected grids, 0 if the cache is disabled
+     */
+    static int cacheSize;
 
     /**
      * \~french \brief Ecart maximal entre les coordonnées Y de la première ligne de la grille
@@ -145,6 +175,49 @@ private:
      */
     inline void calculateDeltaY();
 
+    /**
+     * \~french \brief Calcule les coordonnées des points de la grille, pour un pas donné
+     * \details Les coordonnées sont celles du rectangle englobant #bbox, non reprojeté.
+     * \param[in] step pas de la grille, en pixel
+     * \~english \brief Compute grid's points' coordinates, for a given step
+     * \param[in] step grid's step, in pixel
+     */
+    void init ( int step );
+
+    /**
+     * \~french \brief Indice de pixel du point de la grille de rang i, dans le sens des X
+     * \~english \brief Pixel indice of the grid's point of rank i, X wise
+     */
+    inline int pixelX ( int i ) {
+        return ( i < nbxReg ) ? i * step : width - 1;
+    }
+
+    /**
+     * \~french \brief Indice de pixel du point de la grille de rang i, dans le sens des Y
+     * \~english \brief Pixel indice of the grid's point of rank i, Y wise
+     */
+    inline int pixelY ( int i ) {
+        return ( i < nbyReg ) ? i * step : height - 1;
+    }
+
+    /**
+     * \~french \brief Recopie l'état d'une autre grille
+     * \~english \brief Copy another grid's state
+     */
+    void copy ( const Grid& other );
+
+    /**
+     * \~french \brief Mesure l'erreur commise par l'interpolation linéaire de la grille reprojetée
+     * \details Le centre de chaque maille est reprojeté et comparé à la moyenne des 4 coins de la maille. L'écart est exprimé en pixel, en le divisant par la taille locale d'un pixel dans le système de destination.
+     * \param[in] pj_src système spatial source
+     * \param[in] pj_dst système spatial de destination
+     * \return erreur maximale, en pixel, infinie si un centre n'a pu être reprojeté
+     * \~english \brief Measure the reprojected grid's linear interpolation error
+     * \details Each cell's center is reprojected and compared to the average of the cell's 4 corners. The gap is expressed in pixel, dividing it by the local pixel size in the destination spatial reference system.
+     * \return maximal error, in pixel, infinite if a center could not be reprojected
+     */
+    double interpolationError ( void* pj_src, void* pj_dst );
+
 public:
 
     /**
@@ -176,6 +249,12 @@ public:
      */
     Grid ( int width, int height, BoundingBox<double> bbox );
 
+    /**
+     * \~french \brief Constructeur de copie
+     * \~english \brief Copy constructor
+     */
+    Grid ( const Grid& other );
+
     /**
      * \~french \brief Destructeur par défaut
      * \details Suppression des tableaux #gridX et #gridY
@@ -197,6 +276,28 @@ public:
         return deltaY;
     }
 
+    /**
+     * \~french \brief Retourne le pas de la grille
+     * \return #step
+     * \~english \brief Return the grid's step
+     * \return #step
+     */
+    int getStep() {
+        return step;
+    }
+
+    /**
+     * \~french \brief Configure les grilles de tout le processus
+     * \details Vide le cache des grilles reprojetées. N'est pas destiné à être appelé pendant que des grilles sont reprojetées.
+     * \param[in] maxError erreur d'interpolation maximale, en fraction de pixel, 0 pour un pas fixe de #GRID_DEFAULT_STEP pixels
+     * \param[in] cacheSize nombre maximal de grilles reprojetées conservées, 0 pour désactiver le cache
+     * \~english \brief Configure grids of the whole process
+     * \details Empty the reprojected grids' cache. Not intended to be called while grids are reprojected.
+     * \param[in] maxError maximal interpolation error, in pixel fraction, 0 for a fixed step of #GRID_DEFAULT_STEP pixels
+     * \param[in] cacheSize maximal number of kept reprojected grids, 0 to disable the cache
+     */
+    static void configure ( double maxError, int cacheSize );
+
     /**
      * \~french \brief Retourne le ratio dans le sens des X
      * \details Le ratio dans le sens des X est une pseudo résolution : c'est la différence entre les valeurs en bout de ligne, divisée par la largeur #width. Ce calcul est effectué pour chaque ligne, et on conserve la valeur la plus grande.
@@ -218,6 +319,8 @@ public:
     /**
      * \~french \brief Reprojette les points de la grille
      * \details On fera particulièrement attentiotn à ce que les points de la grille appartiennent bien à la zone de définition du système spatial.
+     *
+     * Si une erreur maximale est configurée, le pas est affiné jusqu'à la respecter. Si la même grille a déjà été reprojetée, elle est reprise du cache.
      * \param[in] from_srs système spatial source, celui de la grille initialement
      * \param[in] to_srs système spatial de destination, celui dans lequel on veut la grille
      * \return VRAI si succès, FAUX sinon.
@@ -258,6 +361,7 @@ public:
     void print() {
         LOGGER_INFO ( "\t--------- Grid -----------" );
         LOGGER_INFO ( "\t- Size : " << width << ", " << height );
+        LOGGER_INFO ( "\t- Step : " << step );
         LOGGER_INFO ( "\t- BBOX : " << bbox.toString() );
         LOGGER_INFO ( "\t- Reprojected points number :" );
         LOGGER_INFO ( "\t\t- X wise : " << nbx );
@@ -55,6 +55,7 @@
 #include <typeinfo>
 #include "BoundingBox.h"
 #include "CRS.h"
+#include "MemoryArena.h"
 #include "math.h"
 
 #ifndef __max
@@ -64,6 +65,59 @@
 #define __min(a, b)   ( ((a) < (b)) ? (a) : (b) )
 #endif
 
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french \brief Résumé de la couverture d'un masque de donnée
+ * \details Il permet aux traitements de passer sur une version sans masque, ou de ne rien calculer, quand le masque est uniforme.
+ * \~english \brief Data mask coverage summary
+ * \details It allows processing to use the unmasked way, or to compute nothing, when the mask is uniform.
+ */
+namespace MaskCoverage {
+/**
+ * \~french \brief Couvertures possibles
+ * \li MIXED : donnée et non-donnée, ou couverture inconnue
+ * \li FULL : uniquement de la donnée (masque à 255)
+ * \li EMPTY : uniquement de la non-donnée (masque à 0)
+ * \~english \brief Available coverages
+ * \li MIXED : data and nodata, or unknown coverage
+ * \li FULL : only data (mask to 255)
+ * \li EMPTY : only nodata (mask to 0)
+ */
+enum eMaskCoverage {
+    MIXED = 0,
+    FULL = 1,
+    EMPTY = 2
+};
+
+/**
+ * \~french \brief Calcule la couverture de valeurs de masque déjà lues
+ * \details Le parcours s'arrête dès que la couverture est connue pour être mixte.
+ * \param[in] mask valeurs de masque
+ * \param[in] length nombre de valeurs
+ * \~english \brief Compute coverage of already read mask values
+ * \details Browsing stops as soon as coverage is known to be mixed.
+ * \param[in] mask mask values
+ * \param[in] length values' number
+ */
+template<typename T>
+inline eMaskCoverage fromLine ( const T* mask, int length ) {
+    if ( length <= 0 ) return MIXED;
+    bool data = ( mask[0] != 0 );
+    for ( int i = 1; i < length; i++ ) {
+        if ( ( mask[i] != 0 ) != data ) return MIXED;
+    }
+    return data ? FULL : EMPTY;
+}
+
+/**
+ * \~french \brief Couverture de la réunion de deux zones
+ * \~english \brief Coverage of two areas' union
+ */
+inline eMaskCoverage merge ( eMaskCoverage a, eMaskCoverage b ) {
+    return ( a == b ) ? a : MIXED;
+}
+}
+
 /**
  * \author Institut national de l'information géographique et forestière
  * \~french
@@ -648,6 +702,132 @@ public:
      */
     virtual int getline ( float *buffer, int line ) = 0;
 
+    /**
+     * \~french
+     * \brief Retourne la couverture d'un ensemble de lignes d'un masque, sans lire ces lignes
+     * \details Seules les images qui connaissent leur contenu à moindre coût (image constante, composition de masques...) la précisent. Par défaut, la couverture est inconnue, donc mixte.
+     * \param[in] firstLine Indice de la première ligne
+     * \param[in] lastLine Indice de la dernière ligne (incluse)
+     * \~english
+     * \brief Return coverage of mask's lines, without reading them
+     * \details Only images knowing their content cheaply (constant image, masks composition...) precise it. By default, coverage is unknown, so mixed.
+     * \param[in] firstLine First line indice
+     * \param[in] lastLine Last line indice (included)
+     */
+    virtual MaskCoverage::eMaskCoverage getCoverage ( int firstLine, int lastLine ) {
+        return MaskCoverage::MIXED;
+    }
+
+    /**
+     * \~french
+     * \brief Retourne la valeur commune à tous les pixels, pour une image uniforme
+     * \details Seules les images dont on sait sans les lire qu'elles sont uniformes (image monochrome, tuile constante) la précisent, ce qui permet aux images composées de les remplir directement.
+     * \return tableau d'une valeur par canal, NULL si l'image n'est pas uniforme ou si on ne le sait pas
+     * \~english
+     * \brief Return the value shared by all pixels, for a uniform image
+     * \details Only images known to be uniform without reading them (one-color image, constant tile) precise it, so that compound images can fill them directly.
+     * \return array with one value per channel, NULL if the image is not uniform or if we don't know
+     */
+    virtual const float* getConstantColor() {
+        return NULL;
+    }
+
+    /**
+     * \~french
+     * \brief Retourne un bloc rectangulaire en entier 8 bits
+     * \details Les canaux sont entrelacés. Les lignes du bloc sont écrites dans le buffer tous les 'stride' échantillons. Par défaut, le bloc est constitué à partir des lignes (#getline), les images capables de fournir directement une partie de ligne surchargent cette fonction.
+     * \param[in] x Indice de la première colonne du bloc
+     * \param[in] y Indice de la première ligne du bloc
+     * \param[in] w Largeur du bloc, en pixel
+     * \param[in] h Hauteur du bloc, en pixel
+     * \param[in,out] buffer Tableau contenant au moins '(h-1) * stride + w * channels' entiers sur 8 bits
+     * \param[in] stride Écart entre deux lignes du bloc dans le buffer, en nombre d'échantillons (au moins 'w * channels')
+     * \return nombre d'échantillons écrits, 0 si erreur (bloc hors de l'image)
+     * \~english
+     * \brief Return a rectangular block as 8-bit integers
+     * \details Samples are interleaved. Block's lines are written into the buffer every 'stride' samples. By default, the block is built from lines (#getline), images able to provide part of a line directly override this function.
+     * \param[in] x Block's first column
+     * \param[in] y Block's first line
+     * \param[in] w Block's width, in pixel
+     * \param[in] h Block's height, in pixel
+     * \param[in,out] buffer Array with at least '(h-1) * stride + w * channels' 8-bit integers
+     * \param[in] stride Gap between two block's lines in the buffer, in samples (at least 'w * channels')
+     * \return written samples' number, 0 if error (block out of the image)
+     */
+    virtual int getBlock ( int x, int y, int w, int h, uint8_t* buffer, int stride ) {
+        return getBlockFromLines ( x, y, w, h, buffer, stride );
+    }
+
+    /**
+     * \~french
+     * \brief Retourne un bloc rectangulaire en entier 16 bits
+     * \details Voir la version 8 bits.
+     * \~english
+     * \brief Return a rectangular block as 16-bit integers
+     * \details See 8-bit version.
+     */
+    virtual int getBlock ( int x, int y, int w, int h, uint16_t* buffer, int stride ) {
+        return getBlockFromLines ( x, y, w, h, buffer, stride );
+    }
+
+    /**
+     * \~french
+     * \brief Retourne un bloc rectangulaire en flottant 32 bits
+     * \details Voir la version 8 bits.
+     * \~english
+     * \brief Return a rectangular block as 32-bit floats
+     * \details See 8-bit version.
+     */
+    virtual int getBlock ( int x, int y, int w, int h, float* buffer, int stride ) {
+        return getBlockFromLines ( x, y, w, h, buffer, stride );
+    }
+
+    /**
+     * \~french
+     * \brief Teste qu'un bloc est entièrement contenu dans l'image
+     * \~english
+     * \brief Test that a block is fully inside the image
+     */
+    inline bool isBlockInside ( int x, int y, int w, int h ) {
+        return ( x >= 0 && y >= 0 && w > 0 && h > 0 && x + w <= width && y + h <= height );
+    }
+
+protected:
+
+    /**
+     * \~french
+     * \brief Constitue un bloc à partir des lignes de l'image
+     * \details Un bloc de toute la largeur est lu directement dans le buffer de sortie, sinon les lignes passent par un buffer temporaire dont on ne copie que les colonnes demandées.
+     * \~english
+     * \brief Build a block from image's lines
+     * \details A full width block is directly read into the output buffer, otherwise lines go through a temporary buffer, from which we only copy asked columns.
+     */
+    template<typename T>
+    int getBlockFromLines ( int x, int y, int w, int h, T* buffer, int stride ) {
+        if ( ! isBlockInside ( x, y, w, h ) ) return 0;
+
+        if ( x == 0 && w == width ) {
+            for ( int l = 0; l < h; l++ ) {
+                if ( getline ( buffer + l * stride, y + l ) == 0 ) return 0;
+            }
+            return w * h * channels;
+        }
+
+        T* line = new T[width * channels];
+        for ( int l = 0; l < h; l++ ) {
+            if ( getline ( line, y + l ) == 0 ) {
+                delete [] line;
+                return 0;
+            }
+            memcpy ( buffer + l * stride, line + x * channels, w * channels * sizeof ( T ) );
+        }
+        delete [] line;
+
+        return w * h * channels;
+    }
+
+public:
+
     /**
      * \~french
      * \brief Destructeur par défaut
@@ -658,6 +838,26 @@ public:
         if ( mask != NULL ) delete mask;
     }
 
+    /**
+     * \~french
+     * \brief Allocation dans l'arène de la requête en cours, s'il y en a une
+     * \~english
+     * \brief Allocation in the current request arena, if any
+     */
+    static void* operator new ( size_t size ) {
+        return MemoryArena::alloc ( size );
+    }
+
+    /**
+     * \~french
+     * \brief Libération, sans effet pour un objet alloué dans une arène
+     * \~english
+     * \brief Release, without effect for an object allocated in an arena
+     */
+    static void operator delete ( void* ptr ) {
+        MemoryArena::release ( ptr );
+    }
+
     /**
      * \~french
      * \brief Sortie des informations sur l'image
@@ -36,17 +36,28 @@
  */
 
 #include "JPEGEncoder.h"
+#include "CancellationToken.h"
 #include <assert.h>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
 
 /** Constructeur */
-JPEGEncoder::JPEGEncoder ( Image* image ) : image ( image ), status ( -1 ) {
+JPEGEncoder::JPEGEncoder ( Image* image, const EncoderProfile* profile ) : image ( image ), status ( -1 ), cancelled ( false ),
+    memBuffer ( NULL ), memSize ( 0 ), memLength ( 0 ), memPos ( 0 ) {
+    if ( ! profile ) profile = EncoderProfile::getDefault();
     cinfo.err = jpeg_std_error ( &jerr );
     jpeg_create_compress ( &cinfo );
+
+    /* L'optimisation des tables de Huffman nécessite une seconde passe dans jpeg_finish_compress,
+     * qui ne peut pas être suspendue : l'image est alors compressée entièrement en mémoire */
+    buffered = profile->jpegOptimize;
+    cinfo.client_data = this;
     cinfo.dest = new jpeg_destination_mgr;
 
     cinfo.dest->init_destination = init_destination;
-    cinfo.dest->empty_output_buffer = empty_output_buffer;
+    cinfo.dest->empty_output_buffer = buffered ? empty_memory_buffer : empty_output_buffer;
     cinfo.dest->term_destination = term_destination;
     cinfo.dest->next_output_byte = 0;
     cinfo.dest->free_in_buffer = 0;
@@ -61,10 +72,11 @@ JPEGEncoder::JPEGEncoder ( Image* image ) : image ( image ), status ( -1 ) {
 
 
     jpeg_set_defaults ( &cinfo );
+    profile->applyJpeg ( &cinfo );
 
     bufferLimit = std::max ( 1024, ( ( image->getWidth() * image->channels ) / 2 ) );
 
-    linebuffer = new uint8_t[image->getWidth() *image->channels];
+    linebuffer = ( uint8_t* ) MemoryArena::alloc ( image->getWidth() *image->channels );
 }
 
 /**
@@ -74,6 +86,31 @@ JPEGEncoder::JPEGEncoder ( Image* image ) : image ( image ), status ( -1 ) {
 size_t JPEGEncoder::read ( uint8_t *buffer, size_t size ) {
     assert ( size >= 1024 );
 
+    if ( buffered ) {
+        if ( status < 0 ) {
+            memSize = std::max ( ( size_t ) 4096, ( size_t ) image->getWidth() * image->getHeight() * image->channels / 4 );
+            memBuffer = ( unsigned char* ) malloc ( memSize );
+            cinfo.dest->next_output_byte = memBuffer;
+            cinfo.dest->free_in_buffer = memSize;
+            jpeg_start_compress ( &cinfo, true );
+            while ( cinfo.next_scanline < cinfo.image_height ) {
+                if ( CancellationToken::currentCancelled() ) {
+                    cancelled = true;
+                    return 0;
+                }
+                image->getline ( linebuffer, cinfo.next_scanline );
+                jpeg_write_scanlines ( &cinfo, &linebuffer, 1 );
+            }
+            jpeg_finish_compress ( &cinfo );
+            memLength = memSize - cinfo.dest->free_in_buffer;
+            status = 1;
+        }
+        size_t length = std::min ( size, memLength - memPos );
+        memcpy ( buffer, memBuffer + memPos, length );
+        memPos += length;
+        return length;
+    }
+
     // On initialise le buffer d'écriture de la libjpeg
     cinfo.dest->next_output_byte = buffer;
     cinfo.dest->free_in_buffer = size;
@@ -83,6 +120,11 @@ size_t JPEGEncoder::read ( uint8_t *buffer, size_t size ) {
         status = 0;
     }
     while ( cinfo.next_scanline < cinfo.image_height && cinfo.dest->free_in_buffer >= bufferLimit ) {
+        if ( CancellationToken::currentCancelled() ) {
+            // Requête annulée : le flux est terminé sans finaliser l'image
+            cancelled = true;
+            return ( size - cinfo.dest->free_in_buffer );
+        }
         image->getline ( linebuffer, cinfo.next_scanline );
         if ( jpeg_write_scanlines ( &cinfo, &linebuffer, 1 ) < 1 ) break;
     }
@@ -93,10 +135,22 @@ size_t JPEGEncoder::read ( uint8_t *buffer, size_t size ) {
     return ( size - cinfo.dest->free_in_buffer );
 }
 
+boolean JPEGEncoder::empty_memory_buffer ( jpeg_compress_struct *cinfo ) {
+    JPEGEncoder* encoder = ( JPEGEncoder* ) cinfo->client_data;
+    unsigned char* newBuffer = ( unsigned char* ) realloc ( encoder->memBuffer, encoder->memSize * 2 );
+    if ( ! newBuffer ) return false;
+    cinfo->dest->next_output_byte = newBuffer + encoder->memSize;
+    cinfo->dest->free_in_buffer = encoder->memSize;
+    encoder->memBuffer = newBuffer;
+    encoder->memSize *= 2;
+    return true;
+}
+
 /** Destructeur */
 JPEGEncoder::~JPEGEncoder() {
     delete cinfo.dest;
     jpeg_destroy_compress ( &cinfo );
-    delete[] linebuffer;
+    if ( memBuffer ) free ( memBuffer );
+    MemoryArena::release ( linebuffer );
     delete image;
 }
@@ -41,6 +41,7 @@
 #include "Data.h"
 #include "Image.h"
 #include "jpeglib.h"
+#include "EncoderProfile.h"
 
 /** D */
 class JPEGEncoder : public DataStream {
@@ -49,7 +50,19 @@ private:
 
     int status;
     int bufferLimit;
+    /** Vrai si la requête a été annulée en cours d'encodage */
+    bool cancelled;
     uint8_t *linebuffer;
+    /** Vrai si l'image est entièrement compressée en mémoire avant d'être lue (tables de Huffman optimisées) */
+    bool buffered;
+    /** Image compressée, en mode bufferisé */
+    unsigned char *memBuffer;
+    /** Taille allouée de memBuffer */
+    size_t memSize;
+    /** Taille de l'image compressée */
+    size_t memLength;
+    /** Position de lecture dans l'image compressée */
+    size_t memPos;
 
     struct jpeg_compress_struct cinfo;
     struct jpeg_error_mgr jerr;
@@ -63,10 +76,17 @@ private:
     static void term_destination ( jpeg_compress_struct *cinfo ) {
         return;
     }
+    /** Agrandit le tampon de l'image compressée, en mode bufferisé */
+    static boolean empty_memory_buffer ( jpeg_compress_struct *cinfo );
 
 public:
-    /** D */
-    JPEGEncoder ( Image* image );
+    /**
+     * \~french \brief Constructeur
+     * \param[in] profile réglages de compression, le profil par défaut si NULL
+     * \~english \brief Constructor
+     * \param[in] profile compression settings, the default profile if NULL
+     */
+    JPEGEncoder ( Image* image, const EncoderProfile* profile = NULL );
 
     /** D */
     ~JPEGEncoder();
@@ -77,7 +97,10 @@ public:
     size_t read ( uint8_t *buffer, size_t size );
 
     bool eof() {
-        return ( cinfo.next_scanline >= cinfo.image_height );
+        if ( buffered ) {
+            return ( cancelled || ( status == 1 && memPos >= memLength ) );
+        }
+        return ( cancelled || cinfo.next_scanline >= cinfo.image_height );
     }
 
     std::string getType() {
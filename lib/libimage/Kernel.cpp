@@ -44,9 +44,69 @@
  */
 
 #include <cmath>
+#include <cstring>
+#include <mm_malloc.h>
 #include "Kernel.h"
 #include "Logger.h"
 
+Kernel::~Kernel() {
+    for ( std::map<int, WeightTable*>::iterator it = tables.begin(); it != tables.end(); it++ ) {
+        delete it->second;
+    }
+    pthread_mutex_destroy ( &tablesMutex );
+}
+
+const WeightTable* Kernel::getWeightTable ( int length ) const {
+    pthread_mutex_lock ( &tablesMutex );
+    WeightTable*& table = tables[length];
+    if ( table == NULL ) {
+        table = new WeightTable ( *this, length );
+    }
+    pthread_mutex_unlock ( &tablesMutex );
+    return table;
+}
+
+WeightTable::WeightTable ( const Kernel& kernel, int length ) : kernel ( kernel ), length ( length ) {
+    stride = ( length + 3 ) & ~3;
+    // Mémoire globale au processus : on n'utilise pas l'arène de la requête en cours
+    weights = ( float* ) _mm_malloc ( KERNEL_PHASES * stride * sizeof ( float ), 16 );
+    memset ( weights, 0, KERNEL_PHASES * stride * sizeof ( float ) );
+
+    // On se place assez loin des bords pour qu'aucune phase ne soit tronquée
+    for ( int i = 0; i < KERNEL_PHASES; i++ ) {
+        int lg = length;
+        offsets[i] = kernel.weight ( weights + i * stride, lg, double ( i ) / KERNEL_PHASES + length, 3 * length + 2 ) - length;
+        lengths[i] = lg;
+    }
+}
+
+WeightTable::~WeightTable() {
+    _mm_free ( weights );
+}
+
+int WeightTable::weight ( float* W, int& length, double x, int max ) const {
+    if ( length != this->length ) {
+        return kernel.weight ( W, length, x, max );
+    }
+
+    double fx = floor ( x );
+    int phase = ( int ) ( ( x - fx ) * KERNEL_PHASES + 0.5 );
+    int ix = ( int ) fx;
+    if ( phase == KERNEL_PHASES ) {
+        phase = 0;
+        ix++;
+    }
+
+    int xmin = ix + offsets[phase];
+    if ( xmin < 0 || xmin + lengths[phase] > max ) {
+        return kernel.weight ( W, length, x, max );
+    }
+
+    length = lengths[phase];
+    memcpy ( W, weights + phase * stride, length * sizeof ( float ) );
+    return xmin;
+}
+
 int Kernel::weight ( float* W, int& length, double x, int max ) const {
 
     double rayon = ( double ) length/2.;
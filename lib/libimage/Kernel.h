@@ -48,6 +48,16 @@
 
 #include "Interpolation.h"
 #include <iostream>
+#include <map>
+#include <pthread.h>
+
+/**
+ * \~french \brief Nombre de phases tabulées par pixel source dans une table de poids
+ * \~english \brief Number of tabulated phases per source pixel in a weight table
+ */
+#define KERNEL_PHASES 1024
+
+class WeightTable;
 
 /**
  * \author Institut national de l'information géographique et forestière
@@ -104,6 +114,19 @@ private:
      */
     virtual double kernel_function ( double d ) = 0;
 
+    /**
+     * \~french \brief Tables de poids déjà calculées, indexées par leur nombre de poids
+     * \details Les tables sont partagées par toutes les requêtes du processus et ne sont jamais libérées avant la destruction du noyau.
+     * \~english \brief Already computed weight tables, indexed by their weights' number
+     */
+    mutable std::map<int, WeightTable*> tables;
+
+    /**
+     * \~french \brief Protège la création des tables de poids
+     * \~english \brief Protect weight tables' creation
+     */
+    mutable pthread_mutex_t tablesMutex;
+
 protected:
 
     /**
@@ -125,7 +148,15 @@ protected:
      * \param[in] kernel_size rayon de base du noyau d'interpolation
      * \param[in] const_ratio influence du rapport des résolutions sur le rayon du noyau
      */
-    Kernel ( double kernel_size, bool const_ratio = false ) : kernel_size ( kernel_size ), const_ratio ( const_ratio ) {}
+    Kernel ( double kernel_size, bool const_ratio = false ) : kernel_size ( kernel_size ), const_ratio ( const_ratio ) {
+        pthread_mutex_init ( &tablesMutex, NULL );
+    }
+
+    /**
+     * \~french \brief Destructeur, libère les tables de poids
+     * \~english \brief Destructor, free weight tables
+     */
+    virtual ~Kernel();
 
 public:
 
@@ -158,8 +189,127 @@ public:
      * \param[in] max coordonnée maximale à ne pas dépasser (largeur ou hauteur de l'image source)
      * \return indice du premier pixel source comptant dans le calcul (poids non nul)
      */
-    virtual int weight ( float* W, int& length, double x, int max ) const;
+    int weight ( float* W, int& length, double x, int max ) const;
+
+    /**
+     * \~french \brief Retourne la table des poids précalculés pour un nombre de poids donné
+     * \details Les poids ne dépendent que du nombre de poids (donc du ratio quantifié) et de la partie décimale de la coordonnée à interpoler. Ils sont calculés pour #KERNEL_PHASES phases à la première demande, puis partagés en lecture seule par tous les threads.
+     * \param[in] length nombre de poids
+     * \return table des poids, à ne pas libérer
+     * \~english \brief Return the precomputed weights' table for a given weights' number
+     * \details Weights only depend on weights' number (so on the quantized ratio) and on the fractional part of the coordinate to interpolate. They are computed for #KERNEL_PHASES phases on first request, then shared read-only between threads.
+     * \param[in] length weights' number
+     * \return weights' table, not to be freed
+     */
+    const WeightTable* getWeightTable ( int length ) const;
+
+};
 
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Table de poids précalculés d'un noyau d'interpolation
+ * \details Pour chacune des #KERNEL_PHASES phases (partie décimale de la coordonnée source), on stocke les poids, complétés par des zéros jusqu'à un multiple de 4 et alignés sur 16 octets, ainsi que le décalage du premier pixel source par rapport à la partie entière de la coordonnée.
+ *
+ * Une table est immuable une fois construite : elle peut être lue sans verrou par plusieurs threads.
+ * \~english
+ * \brief Precomputed weights' table of an interpolation kernel
+ * \details For each of the #KERNEL_PHASES phases (fractional part of the source coordinate), we store weights, padded with zeros to a multiple of 4 and aligned on 16 bytes, and the offset of the first source pixel from the integer part of the coordinate.
+ *
+ * A table is immutable once built : it can be read without lock by several threads.
+ */
+class WeightTable {
+
+    friend class Kernel;
+
+private:
+
+    /**
+     * \~french \brief Noyau ayant calculé la table
+     * \~english \brief Kernel which computed the table
+     */
+    const Kernel& kernel;
+
+    /**
+     * \~french \brief Nombre de poids demandé
+     * \~english \brief Asked weights' number
+     */
+    int length;
+
+    /**
+     * \~french \brief Nombre de flottants entre deux phases, multiple de 4
+     * \~english \brief Floats' number between two phases, multiple of 4
+     */
+    int stride;
+
+    /**
+     * \~french \brief Poids, #KERNEL_PHASES lignes de stride flottants
+     * \~english \brief Weights, #KERNEL_PHASES lines of stride floats
+     */
+    float* weights;
+
+    /**
+     * \~french \brief Décalage du premier pixel source, pour chaque phase
+     * \~english \brief First source pixel's offset, for each phase
+     */
+    int offsets[KERNEL_PHASES];
+
+    /**
+     * \~french \brief Nombre de poids effectif, pour chaque phase
+     * \~english \brief Real weights' number, for each phase
+     */
+    int lengths[KERNEL_PHASES];
+
+    /**
+     * \~french \brief Calcule la table, appelé uniquement par le noyau
+     * \~english \brief Compute the table, only called by the kernel
+     */
+    WeightTable ( const Kernel& kernel, int length );
+
+public:
+
+    /**
+     * \~french \brief Destructeur
+     * \~english \brief Destructor
+     */
+    ~WeightTable();
+
+    /**
+     * \~french \brief Retourne les poids d'une phase, complétés par des zéros jusqu'à getStride()
+     * \~english \brief Return weights of a phase, padded with zeros up to getStride()
+     */
+    inline const float* getWeights ( int phase ) const {
+        return weights + phase * stride;
+    }
+
+    /**
+     * \~french \brief Retourne le décalage du premier pixel source d'une phase
+     * \~english \brief Return the first source pixel's offset of a phase
+     */
+    inline int getOffset ( int phase ) const {
+        return offsets[phase];
+    }
+
+    /**
+     * \~french \brief Retourne le nombre de flottants entre deux phases
+     * \~english \brief Return floats' number between two phases
+     */
+    inline int getStride() const {
+        return stride;
+    }
+
+    /**
+     * \~french \brief Calcule les poids pour chaque pixel source, à partir de la table
+     * \details Même contrat que Kernel::weight. La coordonnée est arrondie à la phase la plus proche. Lorsque la fenêtre sort de l'image source, on délègue au calcul exact du noyau.
+     * \param[out] W tableau des poids à affecter aux pixels sources
+     * \param[in,out] length nombre de poids à calculer a priori, mais peut être réduit sur les bords
+     * \param[in] x coordonnée en pixel source du pixel à calculer
+     * \param[in] max coordonnée maximale à ne pas dépasser (largeur ou hauteur de l'image source)
+     * \return indice du premier pixel source comptant dans le calcul
+     * \~english \brief Compute weights for each source pixel, from the table
+     * \details Same contract as Kernel::weight. Coordinate is rounded to the nearest phase. When the window goes out of the source image, we use the kernel exact computing.
+     */
+    int weight ( float* W, int& length, double x, int max ) const;
 };
 
 #endif
@@ -42,303 +42,222 @@
 /* --------------------------------- DÉFINITION DES FONCTIONS ------------------------------------- */
 /* ------------------------------------------------------------------------------------------------ */
 
-void Line::alphaBlending ( Line* above ) {
-    // Initialisation des pointeurs courants sur les pixels et l'alpha (final et above)
-    float* pix = samples;
-    float* al = alpha;
-    float* pixAb = above->samples;
-    float* alAb = above->alpha;
-    for ( int i = 0; i < width; i++, pix += 3, pixAb += 3, al++, alAb++ ) {
-        if ( *alAb == 0. || ! above->mask[i] ) {
-            // Le pixel de la ligne du dessus est transparent, ou n'est pas de la donnée, il ne change donc pas le pixel du dessous.
-            continue;
-        }
+/* Sélection des pixels de donnée : les 4 octets de masque à partir de m sont étendus en masques de 32 bits,
+ * tous à 1 si le pixel est de la donnée, tous à 0 sinon */
+#ifdef __SSE2__
+static inline __m128 dataSelection ( const uint8_t* m ) {
+    int32_t bytes;
+    memcpy ( &bytes, m, 4 );
+    __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_unpacklo_epi16 ( _mm_unpacklo_epi8 ( _mm_cvtsi32_si128 ( bytes ), zero ), zero );
+    return _mm_castsi128_ps ( _mm_cmpgt_epi32 ( v, zero ) );
+}
 
-        if ( *al == 0. ) {
-            // Le pixel de la ligne du dessous est complètement transparent, le résultat est donc égal au pixel du dessus
-            *al = *alAb;
-            memcpy(pix, pixAb, 3*sizeof(float));
-            continue;
-        }
+static inline __m128 choose ( __m128 sel, __m128 ifData, __m128 otherwise ) {
+    return _mm_or_ps ( _mm_and_ps ( sel, ifData ), _mm_andnot_ps ( sel, otherwise ) );
+}
+#endif
 
-        float a = *alAb + *al * ( 1. - *alAb );
+void Line::premultiply() {
+    float* R = samples;
+    float* G = samples + stride;
+    float* B = samples + 2 * stride;
+#ifdef __SSE2__
+    for ( int i = 0; i < stride; i += 4 ) {
+        __m128 a = _mm_load_ps ( alpha + i );
+        _mm_store_ps ( R + i, _mm_mul_ps ( _mm_load_ps ( R + i ), a ) );
+        _mm_store_ps ( G + i, _mm_mul_ps ( _mm_load_ps ( G + i ), a ) );
+        _mm_store_ps ( B + i, _mm_mul_ps ( _mm_load_ps ( B + i ), a ) );
+    }
+#else
+    for ( int i = 0; i < width; i++ ) {
+        R[i] *= alpha[i];
+        G[i] *= alpha[i];
+        B[i] *= alpha[i];
+    }
+#endif
+}
 
-        pix[0] = ( *alAb * pixAb[0] + *al * pix[0] * ( 1 - *alAb ) ) / a;
-        pix[1] = ( *alAb * pixAb[1] + *al * pix[1] * ( 1 - *alAb ) ) / a;
-        pix[2] = ( *alAb * pixAb[2] + *al * pix[2] * ( 1 - *alAb ) ) / a;
-        *al = a;
+/* Avec l'alpha prémultiplié, la fusion par transparence se réduit à : dessous = dessus + dessous * ( 1 - alpha dessus ),
+ * pour les couleurs comme pour l'alpha. Un pixel du dessus qui n'est pas de la donnée est vu comme complètement transparent. */
+void Line::alphaBlending ( Line* above ) {
+#ifdef __SSE2__
+    __m128 one = _mm_set1_ps ( 1. );
+    for ( int i = 0; i < stride; i += 4 ) {
+        __m128 sel = dataSelection ( above->mask + i );
+        __m128 alAb = _mm_and_ps ( sel, _mm_load_ps ( above->alpha + i ) );
+        __m128 k = _mm_sub_ps ( one, alAb );
+        for ( int c = 0; c < 3; c++ ) {
+            float* pix = samples + c * stride + i;
+            __m128 pixAb = _mm_and_ps ( sel, _mm_load_ps ( above->samples + c * stride + i ) );
+            _mm_store_ps ( pix, _mm_add_ps ( pixAb, _mm_mul_ps ( _mm_load_ps ( pix ), k ) ) );
+        }
+        _mm_store_ps ( alpha + i, _mm_add_ps ( alAb, _mm_mul_ps ( _mm_load_ps ( alpha + i ), k ) ) );
+    }
+#else
+    for ( int i = 0; i < width; i++ ) {
+        if ( ! above->mask[i] ) continue;
+        float k = 1. - above->alpha[i];
+        for ( int c = 0; c < 3; c++ ) {
+            samples[c * stride + i] = above->samples[c * stride + i] + samples[c * stride + i] * k;
+        }
+        alpha[i] = above->alpha[i] + alpha[i] * k;
     }
+#endif
 }
 
 void Line::useMask ( Line* above ) {
-    float* pix = samples;
-    float* pixAb = above->samples;
-    for ( int i = 0; i < width; i++, pix += 3, pixAb += 3 ) {
-        if ( above->mask[i] ) {
-            alpha[i] = above->alpha[i];
-            memcpy(pix, pixAb, 3 * sizeof(float));
+#ifdef __SSE2__
+    for ( int i = 0; i < stride; i += 4 ) {
+        __m128 sel = dataSelection ( above->mask + i );
+        for ( int c = 0; c < 3; c++ ) {
+            float* pix = samples + c * stride + i;
+            _mm_store_ps ( pix, choose ( sel, _mm_load_ps ( above->samples + c * stride + i ), _mm_load_ps ( pix ) ) );
         }
+        _mm_store_ps ( alpha + i, choose ( sel, _mm_load_ps ( above->alpha + i ), _mm_load_ps ( alpha + i ) ) );
     }
+#else
+    for ( int i = 0; i < width; i++ ) {
+        if ( ! above->mask[i] ) continue;
+        for ( int c = 0; c < 3; c++ ) {
+            samples[c * stride + i] = above->samples[c * stride + i];
+        }
+        alpha[i] = above->alpha[i];
+    }
+#endif
 }
 
+/* Les couleurs et l'alpha étant multipliés, le produit de deux couleurs prémultipliées est la couleur prémultipliée du produit */
 void Line::multiply ( Line* above ) {
+#ifdef __SSE2__
+    __m128 inv = _mm_set1_ps ( 1. / coeff );
+    for ( int i = 0; i < stride; i += 4 ) {
+        __m128 sel = dataSelection ( above->mask + i );
+        for ( int c = 0; c < 3; c++ ) {
+            float* pix = samples + c * stride + i;
+            __m128 p = _mm_load_ps ( pix );
+            __m128 product = _mm_mul_ps ( _mm_mul_ps ( p, _mm_load_ps ( above->samples + c * stride + i ) ), inv );
+            _mm_store_ps ( pix, choose ( sel, product, p ) );
+        }
+        __m128 a = _mm_load_ps ( alpha + i );
+        _mm_store_ps ( alpha + i, choose ( sel, _mm_mul_ps ( a, _mm_load_ps ( above->alpha + i ) ), a ) );
+    }
+#else
     for ( int i = 0; i < width; i++ ) {
-        if ( ! above->mask[i] ) {
-            // Le pixel de la ligne du dessus n'est pas de la donnée, il ne change donc pas le pixel du dessous.
-            continue;
+        if ( ! above->mask[i] ) continue;
+        for ( int c = 0; c < 3; c++ ) {
+            samples[c * stride + i] = samples[c * stride + i] * above->samples[c * stride + i] / coeff;
         }
-
         alpha[i] *= above->alpha[i];
-        samples[3*i] = samples[3*i] * above->samples[3*i] / coeff;
-        samples[3*i+1] = samples[3*i+1] * above->samples[3*i+1] / coeff;
-        samples[3*i+2] = samples[3*i+2] * above->samples[3*i+2] / coeff;
     }
+#endif
 }
 
 
-/* --------------------------------- SPÉCIALISATION DE TEMPLATE ----------------------------------- */
+/* ----------------------------------- STOCKAGE PAR PLANS ----------------------------------------- */
 
-// -------------- UINT8
+/* Test de la valeur de transparence, pour une source en niveau de gris et pour une source en couleur.
+ * Pour les flottants, on tolère un écart relatif de 0.1%. */
+template<typename T>
+static inline bool isTransparentGray ( T gray, const T* transparent ) {
+    return gray == transparent[0] && gray == transparent[1] && gray == transparent[2];
+}
 
-template <>
-void Line::store ( uint8_t* imageIn, uint8_t* maskIn, int srcSpp, uint8_t* transparent ) {
+template<>
+inline bool isTransparentGray ( float gray, const float* transparent ) {
+    float pix[3] = { gray, gray, gray };
+    return ! memcmp ( pix, transparent, 3*sizeof ( float ) ) || fabsf ( ( gray - transparent[0] ) / transparent[0] ) < 0.001;
+}
+
+template<typename T>
+static inline bool isTransparentRGB ( const T* pix, const T* transparent ) {
+    return ! memcmp ( pix, transparent, 3*sizeof ( T ) );
+}
+
+template<>
+inline bool isTransparentRGB ( const float* pix, const float* transparent ) {
+    return ! memcmp ( pix, transparent, 3*sizeof ( float ) )
+           || ( fabsf ( ( pix[0] - transparent[0] ) / transparent[0] ) < 0.001
+                && fabsf ( ( pix[1] - transparent[1] ) / transparent[1] ) < 0.001
+                && fabsf ( ( pix[2] - transparent[2] ) / transparent[2] ) < 0.001 );
+}
+
+template<typename T>
+void Line::storePlanar ( T* imageIn, uint8_t* maskIn, int srcSpp, T* transparent, float alphaMax ) {
     memcpy ( mask, maskIn, width );
+    float* R = samples;
+    float* G = samples + stride;
+    float* B = samples + 2 * stride;
+
     switch ( srcSpp ) {
     case 1:
         for ( int i = 0; i < width; i++ ) {
-            if ( imageIn[i] == transparent[0] && imageIn[i] == transparent[1] && imageIn[i] == transparent[2] ) {
-                alpha[i] = 0.0;
-            } else {
-                alpha[i] = 1.0;
-            }
-            samples[3*i] = samples[3*i+1] = samples[3*i+2] = (float) imageIn[i];
+            R[i] = G[i] = B[i] = ( float ) imageIn[i];
+            alpha[i] = ( transparent && isTransparentGray ( imageIn[i], transparent ) ) ? 0. : 1.;
         }
         break;
     case 2:
         for ( int i = 0; i < width; i++ ) {
-            if ( imageIn[2*i] == transparent[0] && imageIn[2*i] == transparent[1] && imageIn[2*i] == transparent[2] ) {
-                alpha[i] = 0.0;
-            } else {
-                alpha[i] = ( float ) imageIn[2*i+1] / 255.;
-            }
-            samples[3*i] = samples[3*i+1] = samples[3*i+2] = (float) imageIn[2*i];
+            R[i] = G[i] = B[i] = ( float ) imageIn[2*i];
+            alpha[i] = ( transparent && isTransparentGray ( imageIn[2*i], transparent ) ) ? 0. : ( float ) imageIn[2*i+1] / alphaMax;
         }
         break;
     case 3:
-        convert( samples, imageIn, 3*width );
         for ( int i = 0; i < width; i++ ) {
-            if ( ! memcmp ( imageIn+3*i, transparent, 3 ) ) {
-                alpha[i] = 0.0;
-            } else {
-                alpha[i] = 1.0;
-            }
+            R[i] = ( float ) imageIn[3*i];
+            G[i] = ( float ) imageIn[3*i+1];
+            B[i] = ( float ) imageIn[3*i+2];
+            alpha[i] = ( transparent && isTransparentRGB ( imageIn+3*i, transparent ) ) ? 0. : 1.;
         }
         break;
     case 4:
         for ( int i = 0; i < width; i++ ) {
-            convert( samples+i*3, imageIn+i*4, 3 );
-            if ( ! memcmp ( imageIn+4*i, transparent, 3 ) ) {
-                alpha[i] = 0.0;
-            } else {
-                alpha[i] = ( float ) imageIn[i*4+3] / 255.;
-            }
+            R[i] = ( float ) imageIn[4*i];
+            G[i] = ( float ) imageIn[4*i+1];
+            B[i] = ( float ) imageIn[4*i+2];
+            alpha[i] = ( transparent && isTransparentRGB ( imageIn+4*i, transparent ) ) ? 0. : ( float ) imageIn[4*i+3] / alphaMax;
         }
         break;
     }
+
+    premultiply();
+}
+
+
+/* --------------------------------- SPÉCIALISATION DE TEMPLATE ----------------------------------- */
+
+// -------------- UINT8
+
+template <>
+void Line::store ( uint8_t* imageIn, uint8_t* maskIn, int srcSpp, uint8_t* transparent ) {
+    storePlanar ( imageIn, maskIn, srcSpp, transparent, 255. );
 }
 
 template <>
 void Line::store ( uint8_t* imageIn, uint8_t* maskIn, int srcSpp ) {
-    memcpy ( mask, maskIn, width );
-    switch ( srcSpp ) {
-    case 1:
-        for ( int i = 0; i < width; i++ ) {
-            alpha[i] = 1.0;
-            samples[3*i] = samples[3*i+1] = samples[3*i+2] = (float) imageIn[i];
-        }
-        break;
-    case 2:
-        for ( int i = 0; i < width; i++ ) {
-            alpha[i] = ( float ) imageIn[2*i+1] / 255.;
-            samples[3*i] = samples[3*i+1] = samples[3*i+2] = (float) imageIn[2*i];
-        }
-        break;
-    case 3:
-        convert( samples, imageIn, 3*width );
-        for ( int i = 0; i < width; i++ ) {
-            alpha[i] = 1.0;
-        }
-        break;
-    case 4:
-        for ( int i = 0; i < width; i++ ) {
-            convert( samples+i*3, imageIn+i*4, 3 );
-            alpha[i] = ( float ) imageIn[i*4+3] / 255.;
-        }
-        break;
-    }
+    storePlanar ( imageIn, maskIn, srcSpp, ( uint8_t* ) NULL, 255. );
 }
 
 // -------------- UINT16
 
 template <>
 void Line::store ( uint16_t* imageIn, uint8_t* maskIn, int srcSpp, uint16_t* transparent ) {
-    memcpy ( mask, maskIn, width );
-    switch ( srcSpp ) {
-    case 1:
-        for ( int i = 0; i < width; i++ ) {
-            if ( imageIn[i] == transparent[0] && imageIn[i] == transparent[1] && imageIn[i] == transparent[2] ) {
-                alpha[i] = 0.0;
-            } else {
-                alpha[i] = 1.0;
-            }
-            samples[3*i] = samples[3*i+1] = samples[3*i+2] = (float) imageIn[i];
-        }
-        break;
-    case 2:
-        for ( int i = 0; i < width; i++ ) {
-            if ( imageIn[2*i] == transparent[0] && imageIn[2*i] == transparent[1] && imageIn[2*i] == transparent[2] ) {
-                alpha[i] = 0.0;
-            } else {
-                alpha[i] = ( float ) imageIn[2*i+1] / 65535.;
-            }
-            samples[3*i] = samples[3*i+1] = samples[3*i+2] = (float) imageIn[2*i];
-        }
-        break;
-    case 3:
-        convert( samples, imageIn, 3*width );
-        for ( int i = 0; i < width; i++ ) {
-            if ( ! memcmp ( imageIn+3*i, transparent, 3*sizeof(uint16_t) ) ) {
-                alpha[i] = 0.0;
-            } else {
-                alpha[i] = 1.0;
-            }
-        }
-        break;
-    case 4:
-        for ( int i = 0; i < width; i++ ) {
-            convert( samples+i*3, imageIn+i*4, 3 );
-            if ( ! memcmp ( imageIn+4*i, transparent, 3*sizeof(uint16_t) ) ) {
-                alpha[i] = 0.0;
-            } else {
-                alpha[i] = ( float ) imageIn[i*4+3] / 65535.;
-            }
-        }
-        break;
-    }
+    storePlanar ( imageIn, maskIn, srcSpp, transparent, 65535. );
 }
 
-
 template <>
 void Line::store ( uint16_t* imageIn, uint8_t* maskIn, int srcSpp ) {
-    memcpy ( mask, maskIn, width );
-    switch ( srcSpp ) {
-    case 1:
-        for ( int i = 0; i < width; i++ ) {
-            alpha[i] = 1.0;
-            samples[3*i] = samples[3*i+1] = samples[3*i+2] = (float) imageIn[i];
-        }
-        break;
-    case 2:
-        for ( int i = 0; i < width; i++ ) {
-            alpha[i] = ( float ) imageIn[2*i+1] / 65535.;
-            samples[3*i] = samples[3*i+1] = samples[3*i+2] = (float) imageIn[2*i];
-        }
-        break;
-    case 3:
-        convert( samples, imageIn, 3*width );
-        for ( int i = 0; i < width; i++ ) {
-            alpha[i] = 1.0;
-        }
-        break;
-    case 4:
-        for ( int i = 0; i < width; i++ ) {
-            convert( samples+i*3, imageIn+i*4, 3 );
-            alpha[i] = ( float ) imageIn[i*4+3] / 65535.;
-        }
-        break;
-    }
+    storePlanar ( imageIn, maskIn, srcSpp, ( uint16_t* ) NULL, 65535. );
 }
 
-
 // -------------- FLOAT
 
 template <>
 void Line::store ( float* imageIn, uint8_t* maskIn, int srcSpp, float* transparent ) {
-    memcpy ( mask, maskIn, width );
-    switch ( srcSpp ) {
-    case 1:
-        for ( int i = 0; i < width; i++ ) {
-            samples[3*i] = samples[3*i+1] = samples[3*i+2] = imageIn[i];
-            //if ( ! memcmp ( samples+3*i, transparent, 3*sizeof ( float ) ) ) {
-	    if ( ! memcmp ( samples+3*i, transparent, 3*sizeof ( float ) ) || fabsf((*(samples+3*i)-*transparent)/(*transparent))<0.001 ) {
-                alpha[i] = 0.0;
-            } else {
-                alpha[i] = 1.0;
-            }
-        }
-        break;
-    case 2:
-        for ( int i = 0; i < width; i++ ) {
-            samples[3*i] = samples[3*i+1] = samples[3*i+2] = imageIn[2*i];
-            if ( ! memcmp ( samples+3*i, transparent, 3*sizeof ( float ) ) || fabsf((*(samples+3*i)-*transparent)/(*transparent))<0.001 ) {
-                alpha[i] = 0.0;
-            } else {
-                alpha[i] = imageIn[2*i+1];
-            }
-        }
-        break;
-    case 3:
-        memcpy ( samples, imageIn, sizeof ( float ) *3*width );
-        for ( int i = 0; i < width; i++ ) {
-            if ( ! memcmp ( samples+3*i, transparent, 3*sizeof ( float ) )
-	      || (fabsf((*(samples+3*i)-*transparent)/(*transparent))<0.001 && fabsf((*(samples+3*i+1)-*(transparent+1))/(*(transparent+1))<0.001) && fabsf((*(samples+3*i+2)-*(transparent+2))/(*(transparent+2)))<0.001 ) ) {
-                alpha[i] = 0.0;
-            } else {
-                alpha[i] = 1.0;
-            }
-        }
-        break;
-    case 4:
-        for ( int i = 0; i < width; i++ ) {
-            memcpy ( samples+i*3, imageIn+i*4, sizeof ( float ) *3 );
-            if ( ! memcmp ( samples+3*i, transparent, 3*sizeof ( float ) )
-	      || (fabsf((*(samples+3*i)-*transparent)/(*transparent))<0.001 && fabsf((*(samples+3*i+1)-*(transparent+1))/(*(transparent+1))<0.001) && fabsf((*(samples+3*i+2)-*(transparent+2))/(*(transparent+2)))<0.001 ) ) {
-                alpha[i] = 0.0;
-            } else {
-                alpha[i] = imageIn[i*4+3];
-            }
-        }
-        break;
-    }
+    storePlanar ( imageIn, maskIn, srcSpp, transparent, 1. );
 }
 
 template <>
 void Line::store ( float* imageIn, uint8_t* maskIn, int srcSpp ) {
-    memcpy ( mask, maskIn, width );
-    switch ( srcSpp ) {
-    case 1:
-        for ( int i = 0; i < width; i++ ) {
-            samples[3*i] = samples[3*i+1] = samples[3*i+2] = imageIn[i];
-            alpha[i] = 1.0;
-        }
-        break;
-    case 2:
-        for ( int i = 0; i < width; i++ ) {
-            samples[3*i] = samples[3*i+1] = samples[3*i+2] = imageIn[2*i];
-            alpha[i] = imageIn[2*i+1];
-        }
-        break;
-    case 3:
-        memcpy ( samples, imageIn, sizeof ( float ) *3*width );
-        for ( int i = 0; i < width; i++ ) {
-            alpha[i] = 1.0;
-        }
-        break;
-    case 4:
-        for ( int i = 0; i < width; i++ ) {
-            memcpy ( samples+i*3,imageIn+i*4,sizeof ( float ) *3 );
-            alpha[i] = imageIn[i*4+3];
-        }
-        break;
-    }
+    storePlanar ( imageIn, maskIn, srcSpp, ( float* ) NULL, 1. );
 }
@@ -50,11 +50,14 @@
 #include <stdio.h>
 #include <Logger.h>
 #include <Utils.h>
+#include <mm_malloc.h>
 
 /** \~ \author Institut national de l'information géographique et forestière
  ** \~french
  * \brief Représentation d'une ligne flottante
- * \details Cette classe stocke une ligne d'image sur 4 canaux, 3 pour la couleur et un canal alpha non-associé (pas prémultiplié aux couleurs). Ce fonctionnement est toujours le même, que les canaux sources soient entiers ou flottants. En stockant toujours les informations dans ce format de travail, on va faciliter les calculs de fusion de plusieurs lignes, dont les caractéristiques étaient différentes. Le formattage final sera également facilité.
+ * \details Cette classe stocke une ligne d'image sur 4 canaux, 3 pour la couleur et un canal alpha associé (prémultiplié aux couleurs). Ce fonctionnement est toujours le même, que les canaux sources soient entiers ou flottants. En stockant toujours les informations dans ce format de travail, on va faciliter les calculs de fusion de plusieurs lignes, dont les caractéristiques étaient différentes. Le formattage final sera également facilité.
+ *
+ * Les canaux sont stockés par plans (tous les rouges, puis tous les verts, puis tous les bleus), dont la taille est arrondie au multiple de 4 supérieur : les fusions traitent ainsi 4 pixels à la fois avec les instructions SSE, sans branchement. L'alpha prémultiplié fait de la fusion par transparence une simple multiplication-addition par canal.
  *
  * Cette classe gère les données, que ce soit comme sources ou comme sortie, sur :
  * \li 1 canal : niveau de gris
@@ -73,7 +76,6 @@
  *
  * \todo Travailler sur un nombre de canaux variable (pour l'instant, systématiquement 4, que ce soit en entier ou en flottant).
  * \todo Les modes de fusion DARKEN et LIGHTEN ne sont pas implémentés.
- * \todo Un pixel correspond toujours à 4 flottants (3 canaux + 1 alpha). Il doit être possible d'utiliser des fonctions SSE pour optimiser les calculs
  ** \~french
  * \brief Represent an image line, with float
  */
@@ -81,8 +83,8 @@ class Line {
 
 public:
     /**
-     * \~french \brief Canaux de couleur, sans tenir compte de l'alpha
-     * \~english \brief Color's samples, ignoring alpha
+     * \~french \brief Canaux de couleur, prémultipliés par l'alpha, en 3 plans de #stride valeurs
+     * \~english \brief Color's samples, premultiplied by alpha, as 3 planes of #stride values
      */
     float* samples;
     /**
@@ -116,6 +118,12 @@ public:
      */
     int width;
 
+    /**
+     * \~french \brief Taille d'un plan, largeur arrondie au multiple de 4 supérieur
+     * \~english \brief Plane size, width rounded up to a multiple of 4
+     */
+    int stride;
+
     /** \~french
      * \brief Crée un objet Line à partir de la largeur
      * \details Il n'y a pas de stockage de données, juste une allocation de la mémoire nécessaire.
@@ -130,9 +138,7 @@ public:
         else if (samplesize == 4) coeff = 1.; //cas float
         else LOGGER_ERROR("Sample size is unknown for the line");
         
-        samples = new float[3*width];
-        alpha = new float[width];
-        mask = new uint8_t[width];
+        allocate();
     }
 
     /** \~french
@@ -156,9 +162,7 @@ public:
     Line ( T* imageIn, uint8_t* maskIn, int srcSpp, int width, T* transparent ) : width ( width ) {
         if (sizeof(T) == 1) coeff = 255.; //cas uint8_t
         else coeff = 1.;
-        samples = new float[3*width];
-        alpha = new float[width];
-        mask = new uint8_t[width];
+        allocate();
         store ( imageIn, maskIn, srcSpp, transparent );
     }
 
@@ -179,9 +183,27 @@ public:
     Line ( T* imageIn, uint8_t* maskIn, int srcSpp, int width ) : width ( width ) {
         if (sizeof(T) == 1) coeff = 255.; //cas uint8_t
         else coeff = 1.;
-        samples = new float[3*width];
-        alpha = new float[width];
-        mask = new uint8_t[width];
+        allocate();
+        store ( imageIn, maskIn, srcSpp );
+    }
+
+    /** \~french
+     * \brief Réinitialise la ligne à partir de données, comme le constructeur équivalent
+     * \details Permet de réutiliser une même ligne pour plusieurs types de données, sans réallouer ses tableaux.
+     * \param[in] imageIn données en entrée
+     * \param[in] maskIn masque associé aux données en entrée
+     * \param[in] srcSpp nombre de canaux dans les données sources
+     ** \~english
+     * \brief Reset the line from data, like the equivalent constructor
+     * \details Allow to reuse a line for several data types, without reallocating its arrays.
+     * \param[in] imageIn data to store
+     * \param[in] maskIn associated mask
+     * \param[in] srcSpp number of samples per pixel in input data
+     */
+    template<typename T>
+    void reset ( T* imageIn, uint8_t* maskIn, int srcSpp ) {
+        if (sizeof(T) == 1) coeff = 255.; //cas uint8_t
+        else coeff = 1.;
         store ( imageIn, maskIn, srcSpp );
     }
 
@@ -286,41 +308,109 @@ public:
      * \details Desallocate memory used by the Line object.
      */
     virtual ~Line() {
-        delete[] alpha;
-        delete[] samples;
-        delete[] mask;
+        _mm_free ( alpha );
+        _mm_free ( samples );
+        _mm_free ( mask );
     }
+
+private:
+
+    /** \~french
+     * \brief Alloue les tableaux, alignés sur 16 octets et initialisés à zéro
+     ** \~english
+     * \brief Allocate arrays, 16-byte aligned and initialized with zeros
+     */
+    void allocate() {
+        stride = 4 * ( ( width + 3 ) / 4 );
+        samples = ( float* ) _mm_malloc ( 3 * stride * sizeof ( float ), 16 );
+        alpha = ( float* ) _mm_malloc ( stride * sizeof ( float ), 16 );
+        mask = ( uint8_t* ) _mm_malloc ( stride, 16 );
+        memset ( samples, 0, 3 * stride * sizeof ( float ) );
+        memset ( alpha, 0, stride * sizeof ( float ) );
+        memset ( mask, 0, stride );
+    }
+
+    /** \~french
+     * \brief Stockage des données, commun à tous les types de canaux
+     * \details Les canaux sont répartis en plans, puis prémultipliés par l'alpha.
+     * \param[in] imageIn données en entrée
+     * \param[in] maskIn masque associé aux données en entrée
+     * \param[in] srcSpp nombre de canaux dans les données sources
+     * \param[in] transparent valeur des pixels à considérer comme transparent, NULL si aucune
+     * \param[in] alphaMax valeur de l'alpha opaque dans les données sources
+     ** \~english
+     * \brief Data storage, common to all sample types
+     * \details Samples are split into planes, then premultiplied by alpha.
+     * \param[in] imageIn data to store
+     * \param[in] maskIn associated mask
+     * \param[in] srcSpp number of samples per pixel in input data
+     * \param[in] transparent pixel's value to consider as transparent, NULL if none
+     * \param[in] alphaMax opaque alpha value in input data
+     */
+    template<typename T>
+    void storePlanar ( T* imageIn, uint8_t* maskIn, int srcSpp, T* transparent, float alphaMax );
+
+    /** \~french
+     * \brief Prémultiplie les canaux de couleur par l'alpha
+     ** \~english
+     * \brief Premultiply color samples by alpha
+     */
+    void premultiply();
 };
 
+/** \~french
+ * \brief Conversion d'une valeur flottante de travail vers le type des canaux en sortie
+ * \details Les entiers sont arrondis au plus proche, la division par l'alpha lors du retour aux couleurs non prémultipliées pouvant donner une valeur juste inférieure à l'entier attendu.
+ ** \~english
+ * \brief Convert a float work value to the output sample type
+ * \details Integers are rounded to the nearest, because dividing by alpha to get back non premultiplied colors can give a value just below the expected integer.
+ */
+template<typename T>
+inline T toSample ( float value ) {
+    return ( T ) ( value + 0.5 );
+}
+
+template<>
+inline float toSample<float> ( float value ) {
+    return value;
+}
+
 /* -------------------------------------FONCTIONS TEMPLATE ---------------------------------------- */
 
 template<typename T>
 void Line::write ( T* buffer, int outChannels ) {
+    float* R = samples;
+    float* G = samples + stride;
+    float* B = samples + 2 * stride;
+
     switch ( outChannels ) {
     case 1:
+        // Les couleurs sont déjà prémultipliées
         for ( int i = 0; i < width; i++ ) {
-            buffer[i] = ( T ) ( 0.2125*samples[3*i] + 0.7154*samples[3*i+1] + 0.0721*samples[3*i+2] ) * alpha[i];
+            buffer[i] = toSample<T> ( 0.2125*R[i] + 0.7154*G[i] + 0.0721*B[i] );
         }
         break;
     case 2:
         for ( int i = 0; i < width; i++ ) {
-            buffer[2*i] = ( T ) ( 0.2125*samples[3*i] + 0.7154*samples[3*i+1] + 0.0721*samples[3*i+2] );
-            buffer[2*i+1] = ( T ) ( alpha[i]*coeff );
+            float inv = ( alpha[i] > 0. ) ? 1. / alpha[i] : 0.;
+            buffer[2*i] = toSample<T> ( ( 0.2125*R[i] + 0.7154*G[i] + 0.0721*B[i] ) * inv );
+            buffer[2*i+1] = toSample<T> ( alpha[i]*coeff );
         }
         break;
     case 3:
         for ( int i = 0; i < width; i++ ) {
-            buffer[3*i] =  ( T ) (alpha[i] * samples[3*i]);
-            buffer[3*i+1] = ( T ) (alpha[i] * samples[3*i+1]);
-            buffer[3*i+2] = ( T ) (alpha[i] * samples[3*i+2]);
+            buffer[3*i] = toSample<T> ( R[i] );
+            buffer[3*i+1] = toSample<T> ( G[i] );
+            buffer[3*i+2] = toSample<T> ( B[i] );
         }
         break;
     case 4:
         for ( int i = 0; i < width; i++ ) {
-            buffer[4*i] = ( T ) (samples[3*i]);
-            buffer[4*i+1] = ( T ) (samples[3*i+1]);
-            buffer[4*i+2] = ( T ) (samples[3*i+2]);
-            buffer[4*i+3] = ( T ) ( alpha[i]*coeff );
+            float inv = ( alpha[i] > 0. ) ? 1. / alpha[i] : 0.;
+            buffer[4*i] = toSample<T> ( R[i] * inv );
+            buffer[4*i+1] = toSample<T> ( G[i] * inv );
+            buffer[4*i+2] = toSample<T> ( B[i] * inv );
+            buffer[4*i+3] = toSample<T> ( alpha[i]*coeff );
         }
         break;
     }
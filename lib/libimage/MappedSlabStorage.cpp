@@ -0,0 +1,226 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file MappedSlabStorage.cpp
+ * \~french
+ * \brief Implémentation de la classe MappedSlabStorage, lecture des dalles projetées en mémoire
+ * \~english
+ * \brief Implement the MappedSlabStorage class, reading of slabs mapped in memory
+ */
+
+#include "MappedSlabStorage.h"
+#include "Logger.h"
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * \~french \brief Dalle ouverte, lue dans sa projection
+ * \~english \brief Opened slab, read in its mapping
+ */
+class MappedSlabObject : public SlabObject {
+private:
+    MappedSlabStorage* storage;
+    MappedSlabStorage::Mapping* mapping;
+public:
+    MappedSlabObject ( MappedSlabStorage* storage, MappedSlabStorage::Mapping* mapping ) : storage ( storage ), mapping ( mapping ) {}
+
+    ssize_t read ( uint8_t* buffer, size_t size, uint64_t offset ) {
+        if ( offset >= mapping->length ) return 0;
+        size = std::min ( ( uint64_t ) size, mapping->length - offset );
+        memcpy ( buffer, mapping->address + offset, size );
+        return size;
+    }
+
+    const uint8_t* map ( size_t size, uint64_t offset ) {
+        if ( offset > mapping->length || size > mapping->length - offset ) return NULL;
+        return mapping->address + offset;
+    }
+
+    ~MappedSlabObject() {
+        storage->release ( mapping );
+    }
+};
+
+MappedSlabStorage::MappedSlabStorage ( size_t maxSize ) : maxSize ( maxSize ), mappedSize ( 0 ) {
+    pthread_mutex_init ( &mutex, NULL );
+}
+
+MappedSlabStorage::~MappedSlabStorage() {
+    while ( ! mappingsOrder.empty() ) {
+        uncache ( mappingsOrder.back() );
+    }
+    pthread_mutex_destroy ( &mutex );
+}
+
+MappedSlabStorage::Mapping* MappedSlabStorage::createMapping ( const std::string& name ) {
+    int fildes = ::open ( name.c_str(), O_RDONLY );
+    if ( fildes < 0 ) {
+        return NULL;
+    }
+    struct stat status;
+    if ( fstat ( fildes, &status ) != 0 || status.st_size == 0 || ( uint64_t ) status.st_size > maxSize ) {
+        close ( fildes );
+        return NULL;
+    }
+    void* address = mmap ( NULL, status.st_size, PROT_READ, MAP_SHARED, fildes, 0 );
+    close ( fildes );
+    if ( address == MAP_FAILED ) {
+        LOGGER_ERROR ( "Impossible de projeter en memoire le fichier " << name );
+        return NULL;
+    }
+    // Accès aux tuiles dans le désordre : pas de lecture anticipée, sauf pour l'en-tête et l'index
+    madvise ( address, status.st_size, MADV_RANDOM );
+    madvise ( address, std::min ( ( size_t ) status.st_size, ( size_t ) MAPPED_SLAB_INDEX_SIZE ), MADV_WILLNEED );
+
+    Mapping* mapping = new Mapping;
+    mapping->name = name;
+    mapping->address = ( uint8_t* ) address;
+    mapping->length = status.st_size;
+    mapping->device = status.st_dev;
+    mapping->inode = status.st_ino;
+    mapping->mtime = status.st_mtime;
+    mapping->checked = time ( NULL );
+    mapping->references = 0;
+    mapping->cached = true;
+    return mapping;
+}
+
+void MappedSlabStorage::destroy ( Mapping* mapping ) {
+    munmap ( mapping->address, mapping->length );
+    delete mapping;
+}
+
+void MappedSlabStorage::uncache ( Mapping* mapping ) {
+    mappings.erase ( mapping->name );
+    mappingsOrder.erase ( mapping->position );
+    mappedSize -= mapping->length;
+    mapping->cached = false;
+    if ( mapping->references == 0 ) {
+        destroy ( mapping );
+    }
+}
+
+SlabObject* MappedSlabStorage::open ( const std::string& name ) {
+    pthread_mutex_lock ( &mutex );
+    Mapping* mapping = NULL;
+    std::map<std::string, Mapping*>::iterator it = mappings.find ( name );
+    if ( it != mappings.end() ) {
+        mapping = it->second;
+        time_t now = time ( NULL );
+        if ( now - mapping->checked >= MAPPED_SLAB_CHECK_DELAY ) {
+            // La dalle a-t-elle été remplacée depuis sa projection ?
+            struct stat status;
+            if ( stat ( name.c_str(), &status ) != 0 || status.st_ino != mapping->inode || status.st_dev != mapping->device ||
+                    status.st_mtime != mapping->mtime || ( uint64_t ) status.st_size != mapping->length ) {
+                LOGGER_DEBUG ( "Dalle remplacee depuis sa projection : " << name );
+                uncache ( mapping );
+                mapping = NULL;
+            } else {
+                mapping->checked = now;
+            }
+        }
+    }
+
+    if ( ! mapping ) {
+        // La projection est faite sous le verrou : une dalle n'est projetée qu'une fois
+        mapping = createMapping ( name );
+        if ( ! mapping ) {
+            pthread_mutex_unlock ( &mutex );
+            // Dalle absente, vide ou trop grande : lecture classique
+            return SlabStorage::getPosix()->open ( name );
+        }
+        while ( ! mappingsOrder.empty() && mappedSize + mapping->length > maxSize ) {
+            uncache ( mappingsOrder.back() );
+        }
+        mappings.insert ( std::pair<std::string, Mapping*> ( name, mapping ) );
+        mappingsOrder.push_front ( mapping );
+        mapping->position = mappingsOrder.begin();
+        mappedSize += mapping->length;
+    } else {
+        mappingsOrder.splice ( mappingsOrder.begin(), mappingsOrder, mapping->position );
+    }
+    mapping->references++;
+    pthread_mutex_unlock ( &mutex );
+
+    return new MappedSlabObject ( this, mapping );
+}
+
+void MappedSlabStorage::release ( Mapping* mapping ) {
+    pthread_mutex_lock ( &mutex );
+    mapping->references--;
+    if ( ! mapping->cached && mapping->references == 0 ) {
+        destroy ( mapping );
+    }
+    pthread_mutex_unlock ( &mutex );
+}
+
+void MappedSlabStorage::setMaxSize ( size_t size ) {
+    pthread_mutex_lock ( &mutex );
+    maxSize = size;
+    while ( ! mappingsOrder.empty() && mappedSize > maxSize ) {
+        uncache ( mappingsOrder.back() );
+    }
+    pthread_mutex_unlock ( &mutex );
+}
+
+size_t MappedSlabStorage::getMappedSize() {
+    pthread_mutex_lock ( &mutex );
+    size_t size = mappedSize;
+    pthread_mutex_unlock ( &mutex );
+    return size;
+}
+
+int MappedSlabStorage::getMappingsCount() {
+    pthread_mutex_lock ( &mutex );
+    int count = mappings.size();
+    pthread_mutex_unlock ( &mutex );
+    return count;
+}
+
+MappedSlabStorage* MappedSlabStorage::getInstance() {
+    static MappedSlabStorage instance;
+    return &instance;
+}
+
+void MappedSlabStorage::configure ( int size ) {
+    getInstance()->setMaxSize ( ( size_t ) size * 1024 * 1024 );
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file MappedSlabStorage.h
+ * \~french
+ * \brief Définition de la classe MappedSlabStorage, lecture des dalles projetées en mémoire
+ * \~english
+ * \brief Define the MappedSlabStorage class, reading of slabs mapped in memory
+ */
+
+#ifndef MAPPED_SLAB_STORAGE_H
+#define MAPPED_SLAB_STORAGE_H
+
+#include <pthread.h>
+#include <ctime>
+#include <list>
+#include <map>
+#include "SlabStorage.h"
+
+#define MAPPED_SLABS_DEFAULT_SIZE 1073741824 // en octets, taille virtuelle totale des dalles projetées
+#define MAPPED_SLAB_CHECK_DELAY 1 // en secondes, délai entre deux vérifications qu'une dalle projetée n'a pas été remplacée
+#define MAPPED_SLAB_INDEX_SIZE 65536 // en octets, début de dalle (en-tête et index) dont la lecture est anticipée
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Lecture des dalles du système de fichiers projetées en mémoire (mmap)
+ * \details Une dalle est projetée à sa première ouverture et la projection est conservée : les tuiles sont ensuite lues sans appel système ni copie (SlabObject#map). Les projections sont oubliées, de la moins récemment utilisée à la plus récente, au-delà d'une taille virtuelle totale. Une dalle plus grande que cette taille est lue avec pread.
+ *
+ * Une dalle remplacée (renommage d'un nouveau fichier, changement d'inode, de date ou de taille) est détectée à l'ouverture, au plus MAPPED_SLAB_CHECK_DELAY secondes après son remplacement : elle est alors projetée de nouveau, l'ancienne projection restant valide jusqu'à la fermeture des lectures en cours. Une dalle ne doit pas être tronquée sur place pendant sa projection.
+ * \~english
+ * \brief Reading of file system slabs mapped in memory (mmap)
+ * \details A slab is mapped when first opened and the mapping is kept : tiles are then read without system call nor copy (SlabObject#map). Mappings are forgotten, from the least recently used to the most recent, beyond a total virtual size. A slab larger than this size is read with pread.
+ *
+ * A replaced slab (renamed new file, inode, date or size change) is detected when opened, at most MAPPED_SLAB_CHECK_DELAY seconds after its replacement : it is then mapped again, the old mapping staying valid until pending reads are closed. A slab must not be truncated in place while mapped.
+ */
+class MappedSlabStorage : public SlabStorage {
+
+public:
+    /**
+     * \~french \brief Projection d'une dalle, partagée entre ses lectures
+     * \~english \brief Slab mapping, shared between its readings
+     */
+    struct Mapping {
+        std::string name;
+        uint8_t* address;
+        size_t length;
+        dev_t device;
+        ino_t inode;
+        time_t mtime;
+        // Date de la dernière vérification que le fichier n'a pas été remplacé
+        time_t checked;
+        // Nombre de dalles ouvertes utilisant la projection
+        int references;
+        // Faux une fois la projection retirée du cache : elle est libérée avec sa dernière référence
+        bool cached;
+        std::list<Mapping*>::iterator position;
+    };
+
+private:
+    size_t maxSize;
+    size_t mappedSize;
+
+    /**
+     * \~french \brief Projections conservées, par nom, et leur ordre d'utilisation (la plus récente en tête)
+     * \~english \brief Kept mappings, by name, and their use order (the most recent first)
+     */
+    std::map<std::string, Mapping*> mappings;
+    std::list<Mapping*> mappingsOrder;
+    pthread_mutex_t mutex;
+
+    /**
+     * \~french \brief Projette un fichier
+     * \return la projection, NULL si le fichier n'est pas accessible, vide ou plus grand que la taille maximale
+     * \~english \brief Map a file
+     * \return the mapping, NULL if the file is not reachable, empty or larger than the maximal size
+     */
+    Mapping* createMapping ( const std::string& name );
+
+    /**
+     * \~french \brief Retire une projection du cache (mutex verrouillé), elle est libérée si elle n'est plus utilisée
+     * \~english \brief Remove a mapping from the cache (locked mutex), it is freed if no longer used
+     */
+    void uncache ( Mapping* mapping );
+
+    /**
+     * \~french \brief Libère une projection
+     * \~english \brief Free a mapping
+     */
+    static void destroy ( Mapping* mapping );
+
+public:
+    /**
+     * \~french \brief Crée un stockage projetant au plus maxSize octets de dalles
+     * \~english \brief Create a storage mapping at most maxSize bytes of slabs
+     */
+    MappedSlabStorage ( size_t maxSize = MAPPED_SLABS_DEFAULT_SIZE );
+
+    ~MappedSlabStorage();
+
+    SlabObject* open ( const std::string& name );
+
+    std::string getType() {
+        return "MMAP";
+    }
+
+    /**
+     * \~french \brief Rend une référence sur une projection
+     * \~english \brief Give back a reference on a mapping
+     */
+    void release ( Mapping* mapping );
+
+    /**
+     * \~french \brief Change la taille virtuelle totale des projections, les moins récentes étant oubliées si besoin
+     * \~english \brief Change the total virtual size of mappings, the least recent being forgotten if needed
+     */
+    void setMaxSize ( size_t size );
+
+    /**
+     * \~french \brief Taille virtuelle totale des projections conservées, en octets
+     * \~english \brief Total virtual size of kept mappings, in bytes
+     */
+    size_t getMappedSize();
+
+    /**
+     * \~french \brief Nombre de projections conservées
+     * \~english \brief Number of kept mappings
+     */
+    int getMappingsCount();
+
+    /**
+     * \~french \brief Stockage partagé par les niveaux lus par projection
+     * \~english \brief Storage shared by levels read by mapping
+     */
+    static MappedSlabStorage* getInstance();
+
+    /**
+     * \~french \brief Configure le stockage partagé
+     * \param[in] size taille virtuelle totale des projections, en Mo, 0 pour lire les dalles avec pread
+     * \~english \brief Configure the shared storage
+     * \param[in] size total virtual size of mappings, in MB, 0 to read slabs with pread
+     */
+    static void configure ( int size );
+};
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file MemoryArena.cpp
+ * \~french
+ * \brief Implémentation de la classe MemoryArena, allocateur mémoire propre à une requête
+ * \~english
+ * \brief Implement the MemoryArena class, a request scoped memory allocator
+ */
+
+#include "MemoryArena.h"
+#include <pthread.h>
+#include <cstdlib>
+#include <new>
+
+/**
+ * \~french
+ * \brief En-tête précédant chaque allocation
+ * \details base vaut NULL pour une allocation dans une arène, l'adresse à libérer sinon.
+ * \~english
+ * \brief Header preceding each allocation
+ * \details base is NULL for an allocation in an arena, the address to free otherwise.
+ */
+struct ArenaHeader {
+    void* base;
+};
+
+static pthread_once_t arena_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t arena_key;
+
+static void init_arena_key() {
+    pthread_key_create ( &arena_key, 0 );
+}
+
+/**
+ * \~french \brief Arrondit ptr au multiple supérieur de alignment, après la place de l'en-tête
+ * \~english \brief Round ptr up to a multiple of alignment, after the header room
+ */
+static inline uint8_t* alignAfterHeader ( uint8_t* ptr, size_t alignment ) {
+    uintptr_t p = ( uintptr_t ) ptr + sizeof ( ArenaHeader );
+    return ( uint8_t* ) ( ( p + alignment - 1 ) & ~ ( ( uintptr_t ) alignment - 1 ) );
+}
+
+MemoryArena::MemoryArena ( size_t blockSize ) : blockSize ( blockSize ), firstBlockSize ( 0 ), current ( NULL ), end ( NULL ),
+    reserved ( 0 ), allocations ( 0 ) {
+}
+
+MemoryArena::~MemoryArena() {
+    for ( int i = 0; i < blocks.size(); i++ ) {
+        free ( blocks[i] );
+    }
+}
+
+void MemoryArena::addBlock ( size_t size ) {
+    size_t sz = ( size > blockSize ) ? size : blockSize;
+    uint8_t* block = ( uint8_t* ) malloc ( sz );
+    if ( !block ) {
+        throw std::bad_alloc();
+    }
+    if ( blocks.empty() ) {
+        firstBlockSize = sz;
+    }
+    blocks.push_back ( block );
+    reserved += sz;
+    current = block;
+    end = block + sz;
+}
+
+void* MemoryArena::allocate ( size_t size, size_t alignment ) {
+    if ( alignment < sizeof ( ArenaHeader ) ) {
+        alignment = sizeof ( ArenaHeader );
+    }
+    uint8_t* ptr = current ? alignAfterHeader ( current, alignment ) : NULL;
+    if ( !ptr || ptr + size > end ) {
+        // Le bloc courant est plein : les allocations suivantes se font dans un nouveau bloc
+        addBlock ( size + alignment + sizeof ( ArenaHeader ) );
+        ptr = alignAfterHeader ( current, alignment );
+    }
+    ( ( ArenaHeader* ) ptr ) [-1].base = NULL;
+    current = ptr + size;
+    allocations++;
+    return ptr;
+}
+
+void MemoryArena::reset() {
+    allocations = 0;
+    if ( blocks.empty() ) {
+        return;
+    }
+    for ( int i = 1; i < blocks.size(); i++ ) {
+        free ( blocks[i] );
+    }
+    blocks.resize ( 1 );
+    reserved = firstBlockSize;
+    current = blocks[0];
+    end = blocks[0] + firstBlockSize;
+}
+
+void MemoryArena::setCurrent ( MemoryArena* arena ) {
+    pthread_once ( &arena_key_once, init_arena_key );
+    pthread_setspecific ( arena_key, arena );
+}
+
+MemoryArena* MemoryArena::getCurrent() {
+    pthread_once ( &arena_key_once, init_arena_key );
+    return ( MemoryArena* ) pthread_getspecific ( arena_key );
+}
+
+void* MemoryArena::alloc ( MemoryArena* arena, size_t size, size_t alignment ) {
+    if ( arena ) {
+        return arena->allocate ( size, alignment );
+    }
+    if ( alignment < sizeof ( ArenaHeader ) ) {
+        alignment = sizeof ( ArenaHeader );
+    }
+    uint8_t* base = ( uint8_t* ) malloc ( size + alignment + sizeof ( ArenaHeader ) );
+    if ( !base ) {
+        throw std::bad_alloc();
+    }
+    uint8_t* ptr = alignAfterHeader ( base, alignment );
+    ( ( ArenaHeader* ) ptr ) [-1].base = base;
+    return ptr;
+}
+
+void MemoryArena::release ( void* ptr ) {
+    if ( !ptr ) {
+        return;
+    }
+    void* base = ( ( ArenaHeader* ) ptr ) [-1].base;
+    if ( base ) {
+        free ( base );
+    }
+}
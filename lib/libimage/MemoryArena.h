@@ -0,0 +1,252 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file MemoryArena.h
+ * \~french
+ * \brief Définition de la classe MemoryArena, allocateur mémoire propre à une requête
+ * \~english
+ * \brief Define the MemoryArena class, a request scoped memory allocator
+ */
+
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+/**
+ * \~french \brief Alignement par défaut des allocations, adapté aux instructions SSE
+ * \~english \brief Default allocations alignment, suitable for SSE instructions
+ */
+#define ARENA_DEFAULT_ALIGNMENT 16
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Allocateur mémoire par incrément de pointeur, libéré en une seule fois
+ * \details Les images, sources de données et tampons construits pour répondre à une requête sont alloués dans l'arène associée au thread qui la traite. Les libérations individuelles sont sans effet : toute la mémoire est récupérée par reset(), une fois la réponse envoyée. Le premier bloc est conservé d'une requête à l'autre, ce qui évite la plupart des appels à malloc et la contention associée.
+ *
+ * Chaque allocation est précédée d'un en-tête indiquant sa provenance : release() peut donc être appelée indifféremment sur de la mémoire issue d'une arène ou du tas (quand aucune arène n'est active, par exemple lors du chargement de la configuration).
+ *
+ * Un objet conservé au-delà de la requête (cache, configuration) ne doit pas être alloué dans l'arène.
+ * \~english
+ * \brief Bump pointer memory allocator, released at once
+ * \details Images, data sources and buffers built to answer a request are allocated in the arena bound to the thread processing it. Individual releases do nothing : the whole memory is reclaimed by reset(), once the response is sent. The first block is kept from one request to the next, avoiding most of malloc calls and the associated contention.
+ *
+ * Each allocation is preceded by a header giving its origin : release() can thus be called on memory coming from an arena or from the heap (when no arena is active, for example when loading the configuration).
+ *
+ * An object kept beyond the request (cache, configuration) must not be allocated in the arena.
+ */
+class MemoryArena {
+
+private:
+    /**
+     * \~french \brief Taille des blocs alloués, en octets
+     * \~english \brief Allocated blocks size, in bytes
+     */
+    size_t blockSize;
+    /**
+     * \~french \brief Blocs alloués, le premier est conservé par reset()
+     * \~english \brief Allocated blocks, the first one is kept by reset()
+     */
+    std::vector<uint8_t*> blocks;
+    /**
+     * \~french \brief Taille du premier bloc, plus grande que blockSize si la première allocation l'exige
+     * \~english \brief First block size, bigger than blockSize if the first allocation requires it
+     */
+    size_t firstBlockSize;
+    /**
+     * \~french \brief Position libre dans le bloc courant
+     * \~english \brief Free position in the current block
+     */
+    uint8_t* current;
+    /**
+     * \~french \brief Fin du bloc courant
+     * \~english \brief Current block end
+     */
+    uint8_t* end;
+    /**
+     * \~french \brief Mémoire réservée dans les blocs, en octets
+     * \~english \brief Memory reserved in blocks, in bytes
+     */
+    size_t reserved;
+    /**
+     * \~french \brief Nombre d'allocations depuis la dernière remise à zéro
+     * \~english \brief Allocations count since the last reset
+     */
+    size_t allocations;
+
+    /**
+     * \~french
+     * \brief Ajoute un bloc pouvant contenir au moins size octets
+     * \~english
+     * \brief Add a block able to hold at least size bytes
+     */
+    void addBlock ( size_t size );
+
+    /**
+     * \~french \brief Interdiction de la copie
+     * \~english \brief Copy forbidden
+     */
+    MemoryArena ( const MemoryArena& );
+    MemoryArena& operator= ( const MemoryArena& );
+
+public:
+    /**
+     * \~french
+     * \brief Constructeur
+     * \param[in] blockSize taille des blocs, en octets
+     * \~english
+     * \brief Constructor
+     * \param[in] blockSize blocks size, in bytes
+     */
+    MemoryArena ( size_t blockSize );
+
+    /**
+     * \~french
+     * \brief Destructeur, libère tous les blocs
+     * \~english
+     * \brief Destructor, free all blocks
+     */
+    ~MemoryArena();
+
+    /**
+     * \~french
+     * \brief Alloue size octets dans l'arène
+     * \param[in] size taille demandée
+     * \param[in] alignment alignement, puissance de 2 (16, 32 ou 64 pour les instructions vectorielles)
+     * \return pointeur aligné, à rendre avec release()
+     * \~english
+     * \brief Allocate size bytes in the arena
+     * \param[in] size requested size
+     * \param[in] alignment alignment, power of 2 (16, 32 or 64 for vector instructions)
+     * \return aligned pointer, to give back with release()
+     */
+    void* allocate ( size_t size, size_t alignment = ARENA_DEFAULT_ALIGNMENT );
+
+    /**
+     * \~french
+     * \brief Récupère toute la mémoire allouée, seul le premier bloc est conservé
+     * \details Aucun objet alloué dans l'arène ne doit plus être utilisé.
+     * \~english
+     * \brief Reclaim all the allocated memory, only the first block is kept
+     * \details No object allocated in the arena may be used anymore.
+     */
+    void reset();
+
+    /**
+     * \~french
+     * \brief Retourne la mémoire réservée dans les blocs, en octets
+     * \~english
+     * \brief Return the memory reserved in blocks, in bytes
+     */
+    size_t getReservedSize() {
+        return reserved;
+    }
+
+    /**
+     * \~french
+     * \brief Retourne le nombre d'allocations depuis la dernière remise à zéro
+     * \~english
+     * \brief Return the allocations count since the last reset
+     */
+    size_t getAllocations() {
+        return allocations;
+    }
+
+    /**
+     * \~french
+     * \brief Associe une arène au thread courant
+     * \param[in] arena arène utilisée par les allocations suivantes, NULL pour allouer dans le tas
+     * \~english
+     * \brief Bind an arena to the current thread
+     * \param[in] arena arena used by the next allocations, NULL to allocate in the heap
+     */
+    static void setCurrent ( MemoryArena* arena );
+
+    /**
+     * \~french
+     * \brief Retourne l'arène associée au thread courant, NULL si aucune
+     * \~english
+     * \brief Return the arena bound to the current thread, NULL if none
+     */
+    static MemoryArena* getCurrent();
+
+    /**
+     * \~french
+     * \brief Retourne l'arène fournie si elle est celle du thread courant, NULL sinon
+     * \details Une arène n'est pas protégée contre les accès concurrents : un objet qui a retenu l'arène de sa construction et qui alloue depuis un autre thread (calcul d'une bande par exemple) doit allouer dans le tas.
+     * \~english
+     * \brief Return the provided arena if it is the current thread one, NULL otherwise
+     * \details An arena is not protected against concurrent accesses : an object which kept its construction arena and which allocates from another thread (band computing for example) has to allocate in the heap.
+     */
+    static MemoryArena* usable ( MemoryArena* arena ) {
+        return ( arena && arena == getCurrent() ) ? arena : NULL;
+    }
+
+    /**
+     * \~french
+     * \brief Alloue size octets dans l'arène fournie, ou dans le tas si elle est nulle
+     * \~english
+     * \brief Allocate size bytes in the provided arena, or in the heap if null
+     */
+    static void* alloc ( MemoryArena* arena, size_t size, size_t alignment = ARENA_DEFAULT_ALIGNMENT );
+
+    /**
+     * \~french
+     * \brief Alloue size octets dans l'arène du thread courant, ou dans le tas si aucune n'est active
+     * \~english
+     * \brief Allocate size bytes in the current thread arena, or in the heap if none is active
+     */
+    static void* alloc ( size_t size, size_t alignment = ARENA_DEFAULT_ALIGNMENT ) {
+        return alloc ( getCurrent(), size, alignment );
+    }
+
+    /**
+     * \~french
+     * \brief Rend une zone obtenue avec alloc() ou allocate()
+     * \details Seule la mémoire provenant du tas est effectivement libérée.
+     * \~english
+     * \brief Give back a memory area obtained with alloc() or allocate()
+     * \details Only memory coming from the heap is actually freed.
+     */
+    static void release ( void* ptr );
+};
+
+#endif
@@ -62,20 +62,20 @@
 
 template <typename tBuf>
 int MergeImage::_getline ( tBuf* buffer, int line ) {
-    Line aboveLine ( width, sizeof(tBuf) );
-    tBuf* imageLine = new tBuf[width*4];
-    uint8_t* maskLine = new uint8_t[width];
-    memset ( maskLine, 0, width );
-
-    tBuf bg[channels*width];
-    for ( int i = 0; i < channels*width; i++ ) {
-        bg[i] = ( tBuf ) bgValue[i%channels];
+    // La ligne de fond n'est recalculée que si le type demandé change
+    tBuf* bg = ( tBuf* ) bgLine;
+    if ( bgSampleSize != sizeof ( tBuf ) ) {
+        for ( int i = 0; i < channels*width; i++ ) {
+            bg[i] = ( tBuf ) bgValue[i%channels];
+        }
+        bgSampleSize = sizeof ( tBuf );
     }
-    Line workLine ( bg, maskLine, channels, width );
 
-    tBuf* transparent;
+    memset ( maskLine, 0, width );
+    workLine->reset ( bg, maskLine, channels );
+
+    tBuf transparent[3];
     if ( transparentValue != NULL ) {
-        transparent = new tBuf[3];
         for ( int i = 0; i < 3; i++ ) {
             transparent[i] = ( tBuf ) transparentValue[i];
         }
@@ -84,50 +84,54 @@ int MergeImage::_getline ( tBuf* buffer, int line ) {
     for ( int i = 0; i < images.size(); i++ ) {
 
         int srcSpp = images[i]->channels;
-        images[i]->getline ( imageLine,line );
 
-        if ( images[i]->getMask() == NULL ) {
+        // Une image sans donnée sur cette ligne ne change rien à la fusion : on ne la lit pas
+        MaskCoverage::eMaskCoverage coverage = MaskCoverage::FULL;
+        if ( images[i]->getMask() != NULL ) {
+            coverage = images[i]->getMask()->getCoverage ( line, line );
+        }
+        if ( coverage == MaskCoverage::EMPTY ) {
+            continue;
+        }
+
+        images[i]->getline ( ( tBuf* ) imageLine,line );
+
+        if ( coverage == MaskCoverage::FULL ) {
             memset ( maskLine, 255, width );
         } else {
             images[i]->getMask()->getline ( maskLine,line );
         }
 
         if ( transparentValue == NULL ) {
-            aboveLine.store ( imageLine, maskLine, srcSpp );
+            aboveLine->store ( ( tBuf* ) imageLine, maskLine, srcSpp );
         } else {
-            aboveLine.store ( imageLine, maskLine, srcSpp, transparent );
+            aboveLine->store ( ( tBuf* ) imageLine, maskLine, srcSpp, transparent );
         }
 
         switch ( composition ) {
         case Merge::NORMAL:
-            workLine.useMask ( &aboveLine );
+            workLine->useMask ( aboveLine );
             break;
         case Merge::TOP:
-            workLine.useMask ( &aboveLine );
+            workLine->useMask ( aboveLine );
             break;
         case Merge::MULTIPLY:
-            workLine.multiply ( &aboveLine );
+            workLine->multiply ( aboveLine );
             break;
         case Merge::ALPHATOP:
-            workLine.alphaBlending ( &aboveLine );
+            workLine->alphaBlending ( aboveLine );
             break;
             //case Merge::LIGHTEN:
             //case Merge::DARKEN:
         default:
-            workLine.useMask ( &aboveLine );
+            workLine->useMask ( aboveLine );
             break;
         }
 
     }
 
     // On repasse la ligne sur le nombre de canaux voulu
-    workLine.write ( buffer, channels );
-
-    if ( transparentValue != NULL ) {
-        delete [] transparent;
-    }
-    delete [] imageLine;
-    delete [] maskLine;
+    workLine->write ( buffer, channels );
 
     return width*channels*sizeof( tBuf );
 }
@@ -178,47 +182,56 @@ MergeImage* MergeImageFactory::createMergeImage ( std::vector< Image* >& images,
 int MergeMask::getline ( uint8_t* buffer, int line ) {
     memset ( buffer,0,width );
 
-    uint8_t* buffer_m = new uint8_t[width];
-
     for ( uint i = 0; i < MI->getImages()->size(); i++ ) {
 
         if ( MI->getMask ( i ) == NULL ) {
             /* L'image n'a pas de masque, on la considère comme pleine. Ca ne sert à rien d'aller voir plus loin,
              * cette ligne du masque est déjà pleine */
             memset ( buffer, 255, width );
-            delete [] buffer_m;
             return width;
         } else {
             // Récupération du masque de l'image courante de l'MI.
-            MI->getMask ( i )->getline ( buffer_m,line );
+            MI->getMask ( i )->getline ( sourceMaskLine,line );
             // On ajoute au masque actuel (on écrase si la valeur est différente de 0)
             for ( int j = 0; j < width; j++ ) {
-                if ( buffer_m[j] ) {
-                    memcpy ( &buffer[j],&buffer_m[j],1 );
+                if ( sourceMaskLine[j] ) {
+                    buffer[j] = sourceMaskLine[j];
                 }
             }
         }
     }
 
-    delete [] buffer_m;
     return width;
 }
 
+MaskCoverage::eMaskCoverage MergeMask::getCoverage ( int firstLine, int lastLine ) {
+    bool empty = true;
+    for ( uint i = 0; i < MI->getImages()->size(); i++ ) {
+        if ( MI->getMask ( i ) == NULL ) {
+            return MaskCoverage::FULL;
+        }
+        MaskCoverage::eMaskCoverage coverage = MI->getMask ( i )->getCoverage ( firstLine, lastLine );
+        if ( coverage == MaskCoverage::FULL ) {
+            return MaskCoverage::FULL;
+        }
+        if ( coverage != MaskCoverage::EMPTY ) {
+            empty = false;
+        }
+    }
+    return empty ? MaskCoverage::EMPTY : MaskCoverage::MIXED;
+}
+
 /* Implementation de getline pour les uint16 */
 int MergeMask::getline ( uint16_t* buffer, int line ) {
-    uint8_t* buffer_t = new uint8_t[width*channels];
-    int retour = getline ( buffer_t,line );
-    convert ( buffer,buffer_t,width*channels );
-    delete [] buffer_t;
+    int retour = getline ( maskLine,line );
+    convert ( buffer,maskLine,width*channels );
     return retour;
 }
 
 /* Implementation de getline pour les float */
 int MergeMask::getline ( float* buffer, int line ) {
-    uint8_t* buffer_t = new uint8_t[width*channels];
-    int retour = getline ( buffer_t,line );
-    convert ( buffer,buffer_t,width*channels );
-    delete [] buffer_t;
+    int retour = getline ( maskLine,line );
+    convert ( buffer,maskLine,width*channels );
     return retour;
 }
 
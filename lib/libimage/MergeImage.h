@@ -59,6 +59,8 @@
 #include "Image.h"
 #include <string.h>
 #include "Format.h"
+#include "Line.h"
+#include "MemoryArena.h"
 
 /**
  * \author Institut national de l'information géographique et forestière
@@ -155,6 +157,42 @@ private:
      */
     int* transparentValue;
 
+    /**
+     * \~french \brief Ligne de travail, recevant le fond puis la fusion des images sources
+     * \~english \brief Work line, receiving background then source images' merge
+     */
+    Line* workLine;
+
+    /**
+     * \~french \brief Ligne de l'image source en cours de fusion
+     * \~english \brief Line of the source image being merged
+     */
+    Line* aboveLine;
+
+    /**
+     * \~french \brief Buffer de lecture d'une ligne d'image source (jusqu'à 4 canaux flottants)
+     * \~english \brief Buffer to read a source image line (up to 4 float samples)
+     */
+    uint8_t* imageLine;
+
+    /**
+     * \~french \brief Buffer de lecture d'une ligne de masque source
+     * \~english \brief Buffer to read a source mask line
+     */
+    uint8_t* maskLine;
+
+    /**
+     * \~french \brief Ligne de fond, convertie dans le type de la dernière ligne demandée
+     * \~english \brief Background line, converted to the last requested line type
+     */
+    uint8_t* bgLine;
+
+    /**
+     * \~french \brief Taille en octets d'un canal de #bgLine, 0 si elle n'est pas encore remplie
+     * \~english \brief #bgLine sample size, in bytes, 0 if not filled yet
+     */
+    int bgSampleSize;
+
     /** \~french
      * \brief Retourne une ligne, flottante ou entière
      * \param[in] buffer Tableau contenant au moins width*channels valeurs
@@ -194,6 +232,14 @@ protected:
 
         bgValue = new int[channels];
         memcpy ( bgValue, bg, channels*sizeof ( int ) );
+
+        // Buffers de travail alloués une fois pour toutes, réutilisés à chaque ligne
+        workLine = new Line ( width, 1 );
+        aboveLine = new Line ( width, 1 );
+        imageLine = ( uint8_t* ) MemoryArena::alloc ( width * 4 * sizeof ( float ) );
+        bgLine = ( uint8_t* ) MemoryArena::alloc ( width * channels * sizeof ( float ) );
+        maskLine = ( uint8_t* ) MemoryArena::alloc ( width );
+        bgSampleSize = 0;
     }
 
 
@@ -244,6 +290,11 @@ public:
         }
         delete [] bgValue;
         if ( transparentValue != NULL ) delete [] transparentValue;
+        delete workLine;
+        delete aboveLine;
+        MemoryArena::release ( imageLine );
+        MemoryArena::release ( bgLine );
+        MemoryArena::release ( maskLine );
     }
 
     /** \~french
@@ -307,6 +358,18 @@ private:
      */
     MergeImage* MI;
 
+    /**
+     * \~french \brief Buffer de lecture des masques sources
+     * \~english \brief Buffer to read source masks
+     */
+    uint8_t* sourceMaskLine;
+
+    /**
+     * \~french \brief Buffer du masque sur 8 bits, avant conversion
+     * \~english \brief 8-bit mask buffer, before conversion
+     */
+    uint8_t* maskLine;
+
 public:
     /** \~french
      * \brief Crée un MergeMask
@@ -319,19 +382,33 @@ public:
      */
     MergeMask ( MergeImage*& MI ) :
         Image ( MI->getWidth(), MI->getHeight(), 1,MI->getResX(), MI->getResY(),MI->getBbox() ),
-        MI ( MI ) {}
+        MI ( MI ) {
+        sourceMaskLine = ( uint8_t* ) MemoryArena::alloc ( width );
+        maskLine = ( uint8_t* ) MemoryArena::alloc ( width );
+    }
 
     int getline ( uint8_t* buffer, int line );
     int getline ( uint16_t* buffer, int line );
     int getline ( float* buffer, int line );
 
+    /**
+     * \~french
+     * \brief Retourne la couverture du masque fusionné : plein si un masque source l'est, vide si tous le sont
+     * \~english
+     * \brief Return merged mask's coverage : full if a source mask is, empty if all are
+     */
+    MaskCoverage::eMaskCoverage getCoverage ( int firstLine, int lastLine );
+
     /**
      * \~french
      * \brief Destructeur par défaut
      * \~english
      * \brief Default destructor
      */
-    virtual ~MergeMask() {}
+    virtual ~MergeMask() {
+        MemoryArena::release ( sourceMaskLine );
+        MemoryArena::release ( maskLine );
+    }
 
     /** \~french
      * \brief Sortie des informations sur le masque fusionné
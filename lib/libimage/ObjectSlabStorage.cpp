@@ -0,0 +1,467 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file ObjectSlabStorage.cpp
+ * \~french
+ * \brief Implémentation de la classe ObjectSlabStorage, stockage des dalles dans un stockage objet compatible S3
+ * \~english
+ * \brief Implement the ObjectSlabStorage class, slabs storage in a S3-compatible object store
+ */
+
+#include "ObjectSlabStorage.h"
+#include "Logger.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <strings.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/**
+ * \~french \brief Objet d'un stockage objet, lu par requêtes HTTP
+ * \~english \brief Object of an object storage, read with HTTP requests
+ */
+class ObjectSlabObject : public SlabObject {
+private:
+    ObjectSlabStorage* storage;
+    std::string key;
+    // ETag de l'objet dont l'index a été lu, vérifié à chaque lecture
+    std::string etag;
+    // Code HTTP de la dernière lecture
+    int status;
+public:
+    ObjectSlabObject ( ObjectSlabStorage* storage, const std::string& key ) : storage ( storage ), key ( key ), status ( 0 ) {}
+
+    ssize_t read ( uint8_t* buffer, size_t size, uint64_t offset ) {
+        std::string current;
+        return storage->read ( key, buffer, size, offset, etag, status, current );
+    }
+
+    bool readIndex ( uint32_t posoff, uint32_t possize, uint32_t& tilePos, uint32_t& tileSize ) {
+        return storage->readIndex ( key, posoff, possize, tilePos, tileSize, etag, status );
+    }
+
+    bool isMissing() {
+        return status == 404;
+    }
+
+    bool isStale() {
+        return status == 412;
+    }
+
+    std::string getVersion() {
+        return etag;
+    }
+
+    void setVersion ( const std::string& version ) {
+        etag = version;
+    }
+};
+
+/*
+ * Encodage d'une clé d'objet dans le chemin de la requête (les '/' sont conservés)
+ */
+static std::string encodeKey ( const std::string& key ) {
+    static const char* hex = "0123456789ABCDEF";
+    std::string encoded;
+    for ( size_t i = 0; i < key.size(); i++ ) {
+        unsigned char c = key[i];
+        if ( isalnum ( c ) || c == '/' || c == '-' || c == '_' || c == '.' || c == '~' ) {
+            encoded += c;
+        } else {
+            encoded += '%';
+            encoded += hex[c >> 4];
+            encoded += hex[c & 15];
+        }
+    }
+    return encoded;
+}
+
+ObjectSlabStorage::ObjectSlabStorage ( std::string url, std::string bucket ) : url ( url ), bucket ( bucket ), valid ( false ), connectionsCount ( 0 ), requestsCount ( 0 ) {
+    pthread_mutex_init ( &poolMutex, NULL );
+    pthread_mutex_init ( &indexMutex, NULL );
+
+    if ( url.compare ( 0, 7, "http://" ) != 0 ) {
+        LOGGER_ERROR ( "Stockage objet : seules les adresses http:// sont gerees (" << url << ")" );
+        return;
+    }
+    std::string authority = url.substr ( 7 );
+    authority = authority.substr ( 0, authority.find ( '/' ) );
+    size_t colon = authority.rfind ( ':' );
+    if ( colon == std::string::npos ) {
+        host = authority;
+        port = "80";
+    } else {
+        host = authority.substr ( 0, colon );
+        port = authority.substr ( colon + 1 );
+    }
+    if ( host.empty() || port.empty() || bucket.empty() ) {
+        LOGGER_ERROR ( "Stockage objet : adresse ou bucket invalide (" << url << ", " << bucket << ")" );
+        return;
+    }
+    valid = true;
+}
+
+ObjectSlabStorage::~ObjectSlabStorage() {
+    for ( size_t i = 0; i < idleConnections.size(); i++ ) {
+        close ( idleConnections[i] );
+    }
+    pthread_mutex_destroy ( &poolMutex );
+    pthread_mutex_destroy ( &indexMutex );
+}
+
+SlabObject* ObjectSlabStorage::open ( const std::string& name ) {
+    if ( ! valid ) return NULL;
+    // Aucune requête à l'ouverture : l'existence de l'objet est connue à la première lecture
+    return new ObjectSlabObject ( this, name );
+}
+
+int ObjectSlabStorage::getConnection ( bool& reused ) {
+    pthread_mutex_lock ( &poolMutex );
+    if ( ! idleConnections.empty() ) {
+        int sock = idleConnections.back();
+        idleConnections.pop_back();
+        pthread_mutex_unlock ( &poolMutex );
+        reused = true;
+        return sock;
+    }
+    connectionsCount++;
+    pthread_mutex_unlock ( &poolMutex );
+    reused = false;
+
+    struct addrinfo hints;
+    memset ( &hints, 0, sizeof ( hints ) );
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* addresses;
+    if ( getaddrinfo ( host.c_str(), port.c_str(), &hints, &addresses ) != 0 ) {
+        LOGGER_ERROR ( "Stockage objet : hote inconnu " << host );
+        return -1;
+    }
+
+    int sock = -1;
+    for ( struct addrinfo* a = addresses; a && sock < 0; a = a->ai_next ) {
+        sock = socket ( a->ai_family, a->ai_socktype, a->ai_protocol );
+        if ( sock < 0 ) continue;
+        if ( connect ( sock, a->ai_addr, a->ai_addrlen ) != 0 ) {
+            close ( sock );
+            sock = -1;
+        }
+    }
+    freeaddrinfo ( addresses );
+    if ( sock < 0 ) {
+        LOGGER_ERROR ( "Stockage objet : connexion impossible a " << url );
+        return -1;
+    }
+
+    struct timeval timeout;
+    timeout.tv_sec = OBJECT_STORAGE_TIMEOUT;
+    timeout.tv_usec = 0;
+    setsockopt ( sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof ( timeout ) );
+    setsockopt ( sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof ( timeout ) );
+    int one = 1;
+    setsockopt ( sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof ( one ) );
+    return sock;
+}
+
+void ObjectSlabStorage::releaseConnection ( int sock, bool keepAlive ) {
+    if ( keepAlive ) {
+        pthread_mutex_lock ( &poolMutex );
+        if ( idleConnections.size() < OBJECT_STORAGE_POOL_SIZE ) {
+            idleConnections.push_back ( sock );
+            sock = -1;
+        }
+        pthread_mutex_unlock ( &poolMutex );
+    }
+    if ( sock >= 0 ) close ( sock );
+}
+
+ssize_t ObjectSlabStorage::request ( int sock, const std::string& key, uint8_t* buffer, size_t size, uint64_t offset, const std::string& ifMatch, int& status, bool& keepAlive, std::string& etag ) {
+    status = 0;
+    keepAlive = false;
+    etag.clear();
+
+    char range[64];
+    snprintf ( range, sizeof ( range ), "bytes=%llu-%llu", ( unsigned long long ) offset, ( unsigned long long ) ( offset + size - 1 ) );
+    std::string req = "GET /" + bucket + "/" + encodeKey ( key ) + " HTTP/1.1\r\n" +
+                      "Host: " + host + ( port == "80" ? "" : ":" + port ) + "\r\n" +
+                      "Range: " + range + "\r\n" +
+                      ( ifMatch.empty() ? "" : "If-Match: " + ifMatch + "\r\n" ) +
+                      "Connection: keep-alive\r\n\r\n";
+
+    pthread_mutex_lock ( &poolMutex );
+    requestsCount++;
+    pthread_mutex_unlock ( &poolMutex );
+
+    for ( size_t sent = 0; sent < req.size(); ) {
+        ssize_t n = send ( sock, req.data() + sent, req.size() - sent, MSG_NOSIGNAL );
+        if ( n <= 0 ) return -1;
+        sent += n;
+    }
+
+    // En-têtes de la réponse
+    char header[OBJECT_STORAGE_HEADER_SIZE + 1];
+    size_t received = 0;
+    char* headerEnd = NULL;
+    while ( ! headerEnd ) {
+        if ( received == OBJECT_STORAGE_HEADER_SIZE ) {
+            LOGGER_ERROR ( "Stockage objet : en-tetes de reponse trop longs pour " << key );
+            status = -1;
+            return -1;
+        }
+        ssize_t n = recv ( sock, header + received, OBJECT_STORAGE_HEADER_SIZE - received, 0 );
+        if ( n <= 0 ) {
+            if ( received ) status = -1;
+            return -1;
+        }
+        received += n;
+        header[received] = 0;
+        headerEnd = strstr ( header, "\r\n\r\n" );
+    }
+    *headerEnd = 0;
+    size_t bodyReceived = received - ( headerEnd + 4 - header );
+
+    int minor = 0;
+    if ( sscanf ( header, "HTTP/1.%d %d", &minor, &status ) != 2 ) {
+        LOGGER_ERROR ( "Stockage objet : reponse invalide pour " << key );
+        status = -1;
+        return -1;
+    }
+
+    long long contentLength = -1;
+    bool chunked = false;
+    keepAlive = ( minor >= 1 );
+    for ( char* line = strstr ( header, "\r\n" ); line; line = strstr ( line, "\r\n" ) ) {
+        line += 2;
+        if ( ! strncasecmp ( line, "Content-Length:", 15 ) ) {
+            contentLength = atoll ( line + 15 );
+        } else if ( ! strncasecmp ( line, "Connection:", 11 ) ) {
+            const char* value = line + 11;
+            while ( *value == ' ' ) value++;
+            if ( ! strncasecmp ( value, "close", 5 ) ) keepAlive = false;
+            else if ( ! strncasecmp ( value, "keep-alive", 10 ) ) keepAlive = true;
+        } else if ( ! strncasecmp ( line, "Transfer-Encoding:", 18 ) ) {
+            chunked = true;
+        } else if ( ! strncasecmp ( line, "ETag:", 5 ) ) {
+            const char* value = line + 5;
+            while ( *value == ' ' ) value++;
+            const char* end = strstr ( value, "\r\n" );
+            etag.assign ( value, end ? end - value : strlen ( value ) );
+            while ( ! etag.empty() && etag[etag.size() - 1] == ' ' ) etag.erase ( etag.size() - 1 );
+        }
+    }
+    if ( contentLength < 0 || chunked ) {
+        LOGGER_ERROR ( "Stockage objet : reponse sans Content-Length pour " << key );
+        keepAlive = false;
+        return -1;
+    }
+
+    // Corps de la réponse : la plage demandée (206) ou l'objet entier (200), dont on extrait la plage
+    uint64_t bodyOffset = ( status == 206 ? offset : 0 );
+    bool useful = ( status == 200 || status == 206 );
+    size_t copied = 0;
+    char* chunk = headerEnd + 4;
+    char discard[16384];
+    for ( uint64_t position = 0; position < ( uint64_t ) contentLength; ) {
+        if ( bodyReceived == 0 ) {
+            uint64_t objectPos = bodyOffset + position;
+            ssize_t n;
+            if ( useful && objectPos >= offset && objectPos < offset + size ) {
+                // Réception directe dans le buffer de destination
+                size_t wanted = std::min ( ( uint64_t ) ( offset + size - objectPos ), ( uint64_t ) contentLength - position );
+                n = recv ( sock, buffer + ( objectPos - offset ), wanted, 0 );
+                if ( n > 0 ) copied += n;
+            } else {
+                size_t wanted = std::min ( ( uint64_t ) sizeof ( discard ), ( uint64_t ) contentLength - position );
+                if ( useful && objectPos < offset ) wanted = std::min ( ( uint64_t ) wanted, offset - objectPos );
+                n = recv ( sock, discard, wanted, 0 );
+            }
+            if ( n <= 0 ) {
+                LOGGER_ERROR ( "Stockage objet : reponse incomplete pour " << key );
+                keepAlive = false;
+                return -1;
+            }
+            position += n;
+        } else {
+            // Octets du corps reçus avec les en-têtes
+            size_t n = std::min ( ( uint64_t ) bodyReceived, ( uint64_t ) contentLength - position );
+            for ( size_t i = 0; i < n; i++ ) {
+                uint64_t objectPos = bodyOffset + position + i;
+                if ( useful && objectPos >= offset && objectPos < offset + size ) {
+                    buffer[objectPos - offset] = chunk[i];
+                    copied++;
+                }
+            }
+            chunk += n;
+            bodyReceived = 0;
+            position += n;
+        }
+    }
+
+    if ( ! useful ) {
+        if ( status == 404 ) {
+            LOGGER_DEBUG ( "Stockage objet : objet absent " << key );
+        } else if ( status == 412 ) {
+            LOGGER_DEBUG ( "Stockage objet : objet modifie depuis la lecture de son index " << key );
+        } else {
+            LOGGER_ERROR ( "Stockage objet : code " << status << " pour " << key );
+        }
+        return -1;
+    }
+    return copied;
+}
+
+ssize_t ObjectSlabStorage::read ( const std::string& key, uint8_t* buffer, size_t size, uint64_t offset, const std::string& ifMatch, int& status, std::string& etag ) {
+    status = 0;
+    etag.clear();
+    if ( size == 0 ) return 0;
+    for ( int attempt = 0; attempt < 2; attempt++ ) {
+        bool reused;
+        int sock = getConnection ( reused );
+        if ( sock < 0 ) return -1;
+
+        bool keepAlive;
+        ssize_t n = request ( sock, key, buffer, size, offset, ifMatch, status, keepAlive, etag );
+        releaseConnection ( sock, keepAlive );
+
+        // Connexion conservée fermée entre temps par le serveur : on recommence avec une nouvelle connexion
+        if ( status == 0 && reused ) continue;
+        if ( status == 0 ) {
+            LOGGER_ERROR ( "Stockage objet : pas de reponse de " << url << " pour " << key );
+        }
+        if ( status == 412 ) {
+            // Objet remplacé : l'index conservé, s'il correspond à l'ancien objet, est oublié
+            pthread_mutex_lock ( &indexMutex );
+            std::map<std::string, SlabIndex>::iterator it = indexes.find ( key );
+            if ( it != indexes.end() && it->second.etag == ifMatch ) {
+                indexes.erase ( it );
+                indexesOrder.remove ( key );
+            }
+            pthread_mutex_unlock ( &indexMutex );
+        }
+        return n;
+    }
+    return -1;
+}
+
+bool ObjectSlabStorage::readIndex ( const std::string& key, uint32_t posoff, uint32_t possize, uint32_t& tilePos, uint32_t& tileSize, std::string& etag, int& status ) {
+    // Index d'une dalle ROK4 : positions des tuiles à partir de OBJECT_STORAGE_INDEX_OFFSET, puis tailles
+    if ( posoff < OBJECT_STORAGE_INDEX_OFFSET || possize <= posoff || ( posoff - OBJECT_STORAGE_INDEX_OFFSET ) % 4 || ( possize - posoff ) % 4 ) {
+        std::string sizeETag;
+        return read ( key, ( uint8_t* ) &tilePos, sizeof ( uint32_t ), posoff, "", status, etag ) == 4 &&
+               read ( key, ( uint8_t* ) &tileSize, sizeof ( uint32_t ), possize, etag, status, sizeETag ) == 4;
+    }
+    size_t tile = ( posoff - OBJECT_STORAGE_INDEX_OFFSET ) / 4;
+    size_t tilesNumber = ( possize - posoff ) / 4;
+
+    pthread_mutex_lock ( &indexMutex );
+    std::map<std::string, SlabIndex>::iterator it = indexes.find ( key );
+    if ( it != indexes.end() && it->second.tiles.size() == 2 * tilesNumber ) {
+        tilePos = it->second.tiles[tile];
+        tileSize = it->second.tiles[tilesNumber + tile];
+        etag = it->second.etag;
+        status = 200;
+        pthread_mutex_unlock ( &indexMutex );
+        return true;
+    }
+    pthread_mutex_unlock ( &indexMutex );
+
+    // Lecture anticipée de tout l'index de la dalle
+    std::vector<uint32_t> index ( 2 * tilesNumber );
+    ssize_t indexSize = 2 * tilesNumber * sizeof ( uint32_t );
+    if ( read ( key, ( uint8_t* ) &index[0], indexSize, OBJECT_STORAGE_INDEX_OFFSET, "", status, etag ) != indexSize ) {
+        return false;
+    }
+    tilePos = index[tile];
+    tileSize = index[tilesNumber + tile];
+
+    pthread_mutex_lock ( &indexMutex );
+    if ( indexes.find ( key ) == indexes.end() ) {
+        if ( indexes.size() >= OBJECT_STORAGE_INDEX_CACHE_SIZE ) {
+            indexes.erase ( indexesOrder.front() );
+            indexesOrder.pop_front();
+        }
+        indexesOrder.push_back ( key );
+    }
+    SlabIndex& entry = indexes[key];
+    entry.tiles.swap ( index );
+    entry.etag = etag;
+    pthread_mutex_unlock ( &indexMutex );
+    return true;
+}
+
+int ObjectSlabStorage::getConnectionsCount() {
+    pthread_mutex_lock ( &poolMutex );
+    int count = connectionsCount;
+    pthread_mutex_unlock ( &poolMutex );
+    return count;
+}
+
+int ObjectSlabStorage::getRequestsCount() {
+    pthread_mutex_lock ( &poolMutex );
+    int count = requestsCount;
+    pthread_mutex_unlock ( &poolMutex );
+    return count;
+}
+
+ObjectSlabStorage* ObjectSlabStorage::get ( std::string url, std::string bucket ) {
+    static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    static std::map<std::string, ObjectSlabStorage*> storages;
+
+    pthread_mutex_lock ( &mutex );
+    std::string id = url + " " + bucket;
+    std::map<std::string, ObjectSlabStorage*>::iterator it = storages.find ( id );
+    ObjectSlabStorage* storage;
+    if ( it != storages.end() ) {
+        storage = it->second;
+    } else {
+        storage = new ObjectSlabStorage ( url, bucket );
+        if ( ! storage->isValid() ) {
+            delete storage;
+            storage = NULL;
+        } else {
+            storages.insert ( std::pair<std::string, ObjectSlabStorage*> ( id, storage ) );
+        }
+    }
+    pthread_mutex_unlock ( &mutex );
+    return storage;
+}
@@ -0,0 +1,224 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file ObjectSlabStorage.h
+ * \~french
+ * \brief Définition de la classe ObjectSlabStorage, stockage des dalles dans un stockage objet compatible S3
+ * \~english
+ * \brief Define the ObjectSlabStorage class, slabs storage in a S3-compatible object store
+ */
+
+#ifndef OBJECT_SLAB_STORAGE_H
+#define OBJECT_SLAB_STORAGE_H
+
+#include <pthread.h>
+#include <list>
+#include <map>
+#include <vector>
+#include "SlabStorage.h"
+
+#define OBJECT_STORAGE_POOL_SIZE 16 // en nombre de connexions inactives conservées par stockage
+#define OBJECT_STORAGE_TIMEOUT 10 // en secondes, pour l'envoi et la réception
+#define OBJECT_STORAGE_INDEX_CACHE_SIZE 4096 // en nombre d'index de dalles conservés par stockage
+#define OBJECT_STORAGE_INDEX_OFFSET 2048 // position de l'index dans une dalle ROK4
+#define OBJECT_STORAGE_HEADER_SIZE 8192 // en octets, taille maximale des en-têtes d'une réponse
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Stockage des dalles dans un stockage objet compatible S3
+ * \details Les dalles sont les objets d'un bucket, lus par des requêtes HTTP GET avec en-tête Range (adressage par chemin : /bucket/clé). Les connexions sont maintenues ouvertes et réutilisées entre les requêtes.
+ *
+ * À la première lecture d'une tuile d'une dalle, tout l'index de la dalle est lu et conservé (au plus OBJECT_STORAGE_INDEX_CACHE_SIZE index, les plus anciens étant oubliés) : les tuiles suivantes de la dalle ne demandent qu'une requête.
+ *
+ * L'index est conservé avec l'ETag de l'objet, envoyé en en-tête If-Match avec les lectures de tuiles : si l'objet a été remplacé, la réponse 412 fait oublier l'index, qui est relu.
+ *
+ * Les requêtes ne sont pas signées (bucket en lecture anonyme) et sont faites en HTTP.
+ * \~english
+ * \brief Slabs storage in a S3-compatible object store
+ * \details Slabs are the objects of a bucket, read with HTTP GET requests with a Range header (path-style addressing : /bucket/key). Connections are kept alive and reused between requests.
+ *
+ * When a tile of a slab is read for the first time, the whole slab index is read and kept (at most OBJECT_STORAGE_INDEX_CACHE_SIZE indexes, the oldest being forgotten) : following tiles of the slab need only one request.
+ *
+ * The index is kept with the object ETag, sent in an If-Match header with tiles reads : if the object has been replaced, the 412 response makes the index forgotten, and it is read again.
+ *
+ * Requests are not signed (anonymous read bucket) and use HTTP.
+ */
+class ObjectSlabStorage : public SlabStorage {
+
+private:
+    std::string url;
+    std::string host;
+    std::string port;
+    std::string bucket;
+    bool valid;
+
+    /**
+     * \~french \brief Connexions inactives, réutilisables
+     * \~english \brief Idle connections, reusable
+     */
+    std::vector<int> idleConnections;
+    pthread_mutex_t poolMutex;
+
+    /**
+     * \~french \brief Index d'une dalle (positions puis tailles des tuiles) et ETag de l'objet lu
+     * \~english \brief Slab index (tiles positions then sizes) and ETag of the read object
+     */
+    struct SlabIndex {
+        std::vector<uint32_t> tiles;
+        std::string etag;
+    };
+
+    /**
+     * \~french \brief Index des dalles déjà lus, par clé
+     * \~english \brief Already read slabs indexes, by key
+     */
+    std::map<std::string, SlabIndex> indexes;
+    std::list<std::string> indexesOrder;
+    pthread_mutex_t indexMutex;
+
+    int connectionsCount;
+    int requestsCount;
+
+    /**
+     * \~french \brief Renvoie une connexion inactive ou une nouvelle connexion
+     * \param[out] reused vrai si la connexion a déjà servi
+     * \return la socket, négative en cas d'erreur
+     * \~english \brief Return an idle connection or a new one
+     * \param[out] reused true if the connection has already been used
+     * \return the socket, negative if error
+     */
+    int getConnection ( bool& reused );
+
+    /**
+     * \~french \brief Rend la connexion au pool si elle peut être réutilisée, la ferme sinon
+     * \~english \brief Give the connection back to the pool if it can be reused, close it otherwise
+     */
+    void releaseConnection ( int sock, bool keepAlive );
+
+    /**
+     * \~french \brief Envoie une requête de lecture et reçoit la réponse sur une connexion
+     * \param[in] ifMatch ETag attendu de l'objet, vide pour ne pas le vérifier
+     * \param[out] status code HTTP de la réponse, 0 si aucune réponse n'a été reçue
+     * \param[out] keepAlive vrai si la connexion peut être réutilisée
+     * \param[out] etag ETag de l'objet, vide si la réponse n'en donne pas
+     * \return nombre d'octets lus, négatif en cas d'erreur
+     * \~english \brief Send a read request and receive the response on a connection
+     * \param[in] ifMatch expected object ETag, empty not to check it
+     * \param[out] status response HTTP code, 0 if no response was received
+     * \param[out] keepAlive true if the connection can be reused
+     * \param[out] etag object ETag, empty if the response does not give one
+     * \return read bytes count, negative if error
+     */
+    ssize_t request ( int sock, const std::string& key, uint8_t* buffer, size_t size, uint64_t offset, const std::string& ifMatch, int& status, bool& keepAlive, std::string& etag );
+
+public:
+    /**
+     * \~french \brief Crée un stockage objet
+     * \param[in] url adresse du service, http://hôte[:port]
+     * \param[in] bucket nom du bucket contenant les dalles
+     * \~english \brief Create an object storage
+     * \param[in] url service address, http://host[:port]
+     * \param[in] bucket name of the bucket containing slabs
+     */
+    ObjectSlabStorage ( std::string url, std::string bucket );
+
+    ~ObjectSlabStorage();
+
+    /**
+     * \~french \brief Indique si l'adresse du service est utilisable
+     * \~english \brief Tell if the service address is usable
+     */
+    bool isValid() {
+        return valid;
+    }
+
+    SlabObject* open ( const std::string& name );
+
+    std::string getType() {
+        return "S3";
+    }
+
+    /**
+     * \~french \brief Lit size octets de l'objet key à partir de la position offset
+     * \details Si l'objet n'a plus l'ETag ifMatch (réponse 412), son index conservé est oublié.
+     * \param[in] ifMatch ETag attendu de l'objet, vide pour ne pas le vérifier
+     * \param[out] status code HTTP de la réponse (404 : objet absent, 412 : objet modifié), 0 si aucune réponse n'a été reçue
+     * \param[out] etag ETag de l'objet, vide si la réponse n'en donne pas
+     * \return nombre d'octets lus, négatif en cas d'erreur
+     * \~english \brief Read size bytes of the key object from the offset position
+     * \details If the object has no longer the ifMatch ETag (412 response), its kept index is forgotten.
+     * \param[in] ifMatch expected object ETag, empty not to check it
+     * \param[out] status response HTTP code (404 : missing object, 412 : modified object), 0 if no response was received
+     * \param[out] etag object ETag, empty if the response does not give one
+     * \return read bytes count, negative if error
+     */
+    ssize_t read ( const std::string& key, uint8_t* buffer, size_t size, uint64_t offset, const std::string& ifMatch, int& status, std::string& etag );
+
+    /**
+     * \~french \brief Lit la position et la taille d'une tuile, à partir de l'index complet de la dalle
+     * \param[out] etag ETag de l'objet dont l'index a été lu
+     * \param[out] status code HTTP de la lecture de l'index, 200 si l'index conservé est utilisé
+     * \~english \brief Read the position and the size of a tile, from the whole slab index
+     * \param[out] etag ETag of the object whose index was read
+     * \param[out] status HTTP code of the index read, 200 if the kept index is used
+     */
+    bool readIndex ( const std::string& key, uint32_t posoff, uint32_t possize, uint32_t& tilePos, uint32_t& tileSize, std::string& etag, int& status );
+
+    /**
+     * \~french \brief Nombre de connexions ouvertes depuis la création
+     * \~english \brief Number of connections opened since creation
+     */
+    int getConnectionsCount();
+
+    /**
+     * \~french \brief Nombre de requêtes envoyées depuis la création
+     * \~english \brief Number of requests sent since creation
+     */
+    int getRequestsCount();
+
+    /**
+     * \~french \brief Stockage partagé pour une adresse et un bucket, créé au premier appel
+     * \return le stockage, NULL si l'adresse n'est pas utilisable
+     * \~english \brief Shared storage for an address and a bucket, created at the first call
+     * \return the storage, NULL if the address is not usable
+     */
+    static ObjectSlabStorage* get ( std::string url, std::string bucket );
+};
+
+#endif
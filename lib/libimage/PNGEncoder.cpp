@@ -40,7 +40,9 @@
 #include "PNGEncoder.h"
 #include "byteswap.h"
 #include "Logger.h"
+#include "CancellationToken.h"
 #include <string.h> // Pour memcpy
+#include <algorithm>
 
 
 // IEND chunck
@@ -167,9 +169,19 @@ size_t PNGEncoder::write_IDAT ( uint8_t *buffer, size_t size ) {
 
     while ( line >= 0 && line < image->getHeight() && zstream.avail_out > 0 ) { // compresser les données dans des chunck idat
         if ( zstream.avail_in == 0 ) {                                    // si plus de donnée en entrée de la zlib, on lit une nouvelle ligne
+            if ( CancellationToken::currentCancelled() ) {                // requête annulée : on termine le flux sans finaliser l'image
+                line = image->getHeight() + 2;
+                return 0;
+            }
             image->getline ( linebuffer+1, line++ );
-            zstream.next_in  = ( ( uint8_t* ) ( linebuffer+1 ) ) - 1;
             zstream.avail_in = image->getWidth() * image->channels + 1;
+            if ( filter == PngFilter::NONE ) {
+                zstream.next_in  = ( ( uint8_t* ) ( linebuffer+1 ) ) - 1;
+            } else {
+                PngFilter::apply ( filter, linebuffer+1, ( line > 1 ) ? prevbuffer+1 : NULL, image->getWidth() * image->channels, image->channels, filterbuffer );
+                zstream.next_in  = filterbuffer;
+                std::swap ( linebuffer, prevbuffer );
+            }
         }
         if ( deflate ( &zstream, Z_NO_FLUSH ) != Z_OK ) return 0;         // return 0 en cas d'erreur.
     }
@@ -207,15 +219,23 @@ bool PNGEncoder::eof() {
     return ( line > image->getHeight() +1 );
 }
 
-PNGEncoder::PNGEncoder ( Image* image,Palette* palette ) : image ( image ), line ( -1 ), palette ( palette ) , stubpalette ( NULL ) {
+PNGEncoder::PNGEncoder ( Image* image,Palette* palette, const EncoderProfile* profile ) : prevbuffer ( NULL ), filterbuffer ( NULL ),
+    image ( image ), line ( -1 ), palette ( palette ) , stubpalette ( NULL ) {
+    if ( ! profile ) profile = EncoderProfile::getDefault();
     zstream.zalloc = Z_NULL;
     zstream.zfree = Z_NULL;
     zstream.opaque = Z_NULL;
     zstream.data_type = Z_BINARY;
-    deflateInit ( &zstream, 5 ); // taux de compression zlib
+    deflateInit2 ( &zstream, profile->pngLevel, Z_DEFLATED, 15, 8, profile->zlibStrategy ); // taux de compression zlib
     zstream.avail_in = 0;
-    linebuffer = new uint8_t[image->getWidth() * image->channels + 1]; // On rajoute une valeur en plus pour l'index de debut de ligne png qui sera toujours 0 dans notre cas. TODO : essayer d'aligner en memoire pour des getline plus efficace
+    linebuffer = ( uint8_t* ) MemoryArena::alloc ( image->getWidth() * image->channels + 1 ); // On rajoute une valeur en plus pour l'index de debut de ligne png, 0 sans filtre. TODO : essayer d'aligner en memoire pour des getline plus efficace
     linebuffer[0] = 0;
+    // Les images à palette ne sont pas filtrées (recommandation de la spécification PNG)
+    filter = ( palette && palette->getPalettePNGSize() != 0 ) ? PngFilter::NONE : profile->pngFilter;
+    if ( filter != PngFilter::NONE ) {
+        prevbuffer = ( uint8_t* ) MemoryArena::alloc ( image->getWidth() * image->channels + 1 );
+        filterbuffer = ( uint8_t* ) MemoryArena::alloc ( image->getWidth() * image->channels + 1 );
+    }
     if ( ! palette ) {
         stubpalette = new Palette();
         palette = stubpalette;
@@ -224,7 +244,9 @@ PNGEncoder::PNGEncoder ( Image* image,Palette* palette ) : image ( image ), line
 
 PNGEncoder::~PNGEncoder() {
     deflateEnd ( &zstream );
-    if ( linebuffer ) delete[] linebuffer;
+    if ( linebuffer ) MemoryArena::release ( linebuffer );
+    if ( prevbuffer ) MemoryArena::release ( prevbuffer );
+    if ( filterbuffer ) MemoryArena::release ( filterbuffer );
     delete image;
     if ( stubpalette )
         delete stubpalette;
@@ -42,12 +42,18 @@
 #include "Image.h"
 #include "zlib.h"
 #include "Palette.h"
+#include "EncoderProfile.h"
 
 /** D */
 class PNGEncoder : public DataStream {
 private:
 
     uint8_t* linebuffer;
+    /** Ligne précédente non filtrée, pour les filtres PNG autres que NONE */
+    uint8_t* prevbuffer;
+    /** Ligne filtrée, précédée de l'octet de filtre */
+    uint8_t* filterbuffer;
+    PngFilter::ePngFilter filter;
 
     z_stream zstream;
 
@@ -64,7 +70,7 @@ protected:
 
 public:
     /** D */
-    PNGEncoder ( Image* image, Palette* palette=NULL );
+    PNGEncoder ( Image* image, Palette* palette=NULL, const EncoderProfile* profile=NULL );
     /** D */
     ~PNGEncoder();
 
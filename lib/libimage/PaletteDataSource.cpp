@@ -82,40 +82,59 @@ PaletteDataSource::PaletteDataSource ( DataSource *dataSource,Palette* mpalette
         fakePalette = true;
         this->palette = new Palette();
     }
+    tile = NULL;
+    tileSize = 0;
+    dataSize = 0;
+    data = NULL;
     if ( palette->getPalettePNGSize() !=0 ) {
         // On récupère le contenu du fichier
-        size_t tmp_size;
-        const uint8_t* tmp = dataSource->getData ( tmp_size );
-        dataSize = tmp_size + palette->getPalettePNGSize() +1;
-        size_t pos = 33;
-        // Taille en sortie = taille en entrée +  3*256+12 (PLTE) + 256+12 (tRNS)
-        data = new uint8_t[dataSize];
+        tile = dataSource->getData ( tileSize );
+        if ( ! tile || tileSize < 33 ) {
+            tile = NULL;
+            return;
+        }
+        // Taille en sortie = taille en entrée + taille des blocs PLTE et tRNS
+        dataSize = tileSize + palette->getPalettePNGSize();
         // Copie de l'entete
-        memcpy ( data,tmp, pos );
-        data[25] = 3; // mode palette
+        memcpy ( header, tile, 33 );
+        header[25] = 3; // mode palette
         //Mise à jour du crc du Header:
         uint32_t crch = crc32 ( 0, Z_NULL, 0 );
-        crch = crc32 ( crch, data+8+4, 13+4 );
-        * ( ( uint32_t* ) ( data+8+8+13 ) ) = bswap_32 ( crch );
+        crch = crc32 ( crch, header+8+4, 13+4 );
+        * ( ( uint32_t* ) ( header+8+8+13 ) ) = bswap_32 ( crch );
+    }
+
+}
+
+
+const uint8_t* PaletteDataSource::getData ( size_t& size ) {
+    if ( palette->getPalettePNGSize() ==0 ) {
+        return dataSource->getData ( size );
+    }
+    if ( ! tile ) return NULL;
+    if ( ! data ) {
+        data = new uint8_t[dataSize];
+        size_t pos = 33;
+        memcpy ( data, header, pos );
         //Copie de la palette
         memcpy ( data+pos,palette->getPalettePNG(),palette->getPalettePNGSize() );
         pos += palette->getPalettePNGSize();
         //Copie des données
-        memcpy ( data+pos, tmp +33, tmp_size - 33 );
-    } else {
-        dataSize=0;
-        data=NULL;
+        memcpy ( data+pos, tile +33, tileSize - 33 );
     }
-
+    size = dataSize;
+    return data;
 }
 
-
-const uint8_t* PaletteDataSource::getData ( size_t& size ) {
-    if ( palette->getPalettePNGSize() !=0 ) {
-        size = dataSize;
-        return data;
+bool PaletteDataSource::getSegments ( std::vector<DataSegment>& segments ) {
+    if ( palette->getPalettePNGSize() ==0 ) {
+        return dataSource->getSegments ( segments );
     }
-    return dataSource->getData ( size );
+    if ( ! tile ) return false;
+    segments.push_back ( DataSegment ( header, 33 ) );
+    segments.push_back ( DataSegment ( palette->getPalettePNG(), palette->getPalettePNGSize() ) );
+    segments.push_back ( DataSegment ( tile+33, tileSize-33 ) );
+    return true;
 }
 
 PaletteDataSource::~PaletteDataSource() {
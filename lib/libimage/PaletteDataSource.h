@@ -48,7 +48,13 @@ private:
     bool fakePalette;
     //bool transparent;
     //uint8_t PLTE[3*256+12];
+    /** En-tête PNG et IHDR passé en mode palette */
+    uint8_t header[33];
+    /** Contenu du PNG source, dont les 33 premiers octets sont remplacés par header */
+    const uint8_t* tile;
+    size_t tileSize;
     size_t dataSize;
+    /** PNG complet, rassemblé au premier appel de getData seulement */
     uint8_t* data;
 public:
     /**
@@ -72,6 +78,8 @@ public:
         return dataSource->getEncoding();
     }
     virtual const uint8_t* getData ( size_t& size );
+    /** L'en-tête, la palette puis les données du PNG source, sans copie */
+    virtual bool getSegments ( std::vector<DataSegment>& segments );
     virtual ~PaletteDataSource();
 };
 
@@ -0,0 +1,228 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file Predictor.cpp
+ * \~french
+ * \brief Implémentation des prédicteurs TIFF
+ * \~english
+ * \brief Implement TIFF predictors
+ */
+
+#include "Predictor.h"
+#include <string.h>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Predictor {
+
+bool isCompatible ( ePredictor pred, SampleFormat::eSampleFormat sf, int bitspersample ) {
+    switch ( pred ) {
+    case NONE :
+        return true;
+    case HORIZONTAL :
+        return sf == SampleFormat::UINT;
+    case FLOATINGPOINT :
+        return sf == SampleFormat::FLOAT && bitspersample == 32;
+    default :
+        return false;
+    }
+}
+
+/* ----- Différences et sommes horizontales, sur une ligne de n échantillons de type T ----- */
+
+template<typename T>
+static inline void differentiate ( T* line, int n, int stride ) {
+    for ( int i = n - 1; i >= stride; i-- ) line[i] -= line[i - stride];
+}
+
+template<typename T>
+static inline void accumulate ( T* line, int n, int stride ) {
+    for ( int i = stride; i < n; i++ ) line[i] += line[i - stride];
+}
+
+#ifdef __SSE2__
+/**
+ * Somme préfixe par pas de C octets, 16 octets à la fois : chaque vecteur est sommé avec lui-même décalé
+ * de C, 2C, 4C... octets, puis on ajoute la dernière valeur de chaque canal du vecteur précédent.
+ */
+template<int C>
+static inline void accumulate8_sse ( uint8_t* line, int n ) {
+    __m128i carry = _mm_setzero_si128();
+    int i = 0;
+    for ( ; i + 16 <= n; i += 16 ) {
+        __m128i x = _mm_loadu_si128 ( ( __m128i* ) ( line + i ) );
+        x = _mm_add_epi8 ( x, _mm_slli_si128 ( x, C ) );
+        x = _mm_add_epi8 ( x, _mm_slli_si128 ( x, 2*C ) );
+        if ( 4*C < 16 ) x = _mm_add_epi8 ( x, _mm_slli_si128 ( x, 4*C ) );
+        if ( 8*C < 16 ) x = _mm_add_epi8 ( x, _mm_slli_si128 ( x, 8*C ) );
+        x = _mm_add_epi8 ( x, carry );
+        _mm_storeu_si128 ( ( __m128i* ) ( line + i ), x );
+        // Diffusion des C derniers octets dans tout le vecteur
+        if ( C == 1 ) {
+            x = _mm_unpackhi_epi8 ( x, x );
+            x = _mm_shufflehi_epi16 ( x, 0xFF );
+        } else if ( C == 2 ) {
+            x = _mm_shufflehi_epi16 ( x, 0xFF );
+        }
+        carry = _mm_shuffle_epi32 ( x, 0xFF );
+    }
+    // Ligne de moins de 16 octets : les C premiers n'ont pas de prédécesseur
+    for ( i = std::max ( i, C ); i < n; i++ ) line[i] += line[i - C];
+}
+#endif
+
+static inline void accumulate8 ( uint8_t* line, int n, int stride ) {
+#ifdef __SSE2__
+    switch ( stride ) {
+    case 1 :
+        accumulate8_sse<1> ( line, n );
+        return;
+    case 2 :
+        accumulate8_sse<2> ( line, n );
+        return;
+    case 4 :
+        accumulate8_sse<4> ( line, n );
+        return;
+    }
+#endif
+    accumulate ( line, n, stride );
+}
+
+/* ----- Prédicteur flottant : octets rangés par poids, poids fort en premier ----- */
+
+static void floatingPointApply ( uint8_t* line, uint8_t* tmp, int samples, int stride ) {
+    memcpy ( tmp, line, samples * 4 );
+    for ( int k = 0; k < samples; k++ ) {
+        for ( int b = 0; b < 4; b++ ) {
+            line[b * samples + k] = tmp[4 * k + 3 - b];
+        }
+    }
+    differentiate ( line, samples * 4, stride );
+}
+
+static void floatingPointRevert ( uint8_t* line, uint8_t* tmp, int samples, int stride ) {
+    accumulate8 ( line, samples * 4, stride );
+    memcpy ( tmp, line, samples * 4 );
+    const uint8_t* p0 = tmp;
+    const uint8_t* p1 = tmp + samples;
+    const uint8_t* p2 = tmp + 2 * samples;
+    const uint8_t* p3 = tmp + 3 * samples;
+    int k = 0;
+#ifdef __SSE2__
+    // Entrelacement des 4 plans d'octets, 16 flottants à la fois
+    for ( ; k + 16 <= samples; k += 16 ) {
+        __m128i b0 = _mm_loadu_si128 ( ( __m128i* ) ( p0 + k ) );
+        __m128i b1 = _mm_loadu_si128 ( ( __m128i* ) ( p1 + k ) );
+        __m128i b2 = _mm_loadu_si128 ( ( __m128i* ) ( p2 + k ) );
+        __m128i b3 = _mm_loadu_si128 ( ( __m128i* ) ( p3 + k ) );
+        __m128i low = _mm_unpacklo_epi8 ( b3, b2 );
+        __m128i high = _mm_unpacklo_epi8 ( b1, b0 );
+        _mm_storeu_si128 ( ( __m128i* ) ( line + 4*k ), _mm_unpacklo_epi16 ( low, high ) );
+        _mm_storeu_si128 ( ( __m128i* ) ( line + 4*k + 16 ), _mm_unpackhi_epi16 ( low, high ) );
+        low = _mm_unpackhi_epi8 ( b3, b2 );
+        high = _mm_unpackhi_epi8 ( b1, b0 );
+        _mm_storeu_si128 ( ( __m128i* ) ( line + 4*k + 32 ), _mm_unpacklo_epi16 ( low, high ) );
+        _mm_storeu_si128 ( ( __m128i* ) ( line + 4*k + 48 ), _mm_unpackhi_epi16 ( low, high ) );
+    }
+#endif
+    for ( ; k < samples; k++ ) {
+        line[4*k] = p3[k];
+        line[4*k + 1] = p2[k];
+        line[4*k + 2] = p1[k];
+        line[4*k + 3] = p0[k];
+    }
+}
+
+void apply ( ePredictor pred, uint8_t* data, int width, int height, int channels, int sampleSize ) {
+    int samples = width * channels;
+    int lineSize = samples * sampleSize;
+    if ( pred == HORIZONTAL ) {
+        for ( int h = 0; h < height; h++ ) {
+            uint8_t* line = data + h * lineSize;
+            switch ( sampleSize ) {
+            case 1 :
+                differentiate ( line, samples, channels );
+                break;
+            case 2 :
+                differentiate ( ( uint16_t* ) line, samples, channels );
+                break;
+            case 4 :
+                differentiate ( ( uint32_t* ) line, samples, channels );
+                break;
+            }
+        }
+    } else if ( pred == FLOATINGPOINT && sampleSize == 4 ) {
+        uint8_t* tmp = new uint8_t[lineSize];
+        for ( int h = 0; h < height; h++ ) {
+            floatingPointApply ( data + h * lineSize, tmp, samples, channels );
+        }
+        delete[] tmp;
+    }
+}
+
+void revert ( ePredictor pred, uint8_t* data, int width, int height, int channels, int sampleSize ) {
+    int samples = width * channels;
+    int lineSize = samples * sampleSize;
+    if ( pred == HORIZONTAL ) {
+        for ( int h = 0; h < height; h++ ) {
+            uint8_t* line = data + h * lineSize;
+            switch ( sampleSize ) {
+            case 1 :
+                accumulate8 ( line, samples, channels );
+                break;
+            case 2 :
+                accumulate ( ( uint16_t* ) line, samples, channels );
+                break;
+            case 4 :
+                accumulate ( ( uint32_t* ) line, samples, channels );
+                break;
+            }
+        }
+    } else if ( pred == FLOATINGPOINT && sampleSize == 4 ) {
+        uint8_t* tmp = new uint8_t[lineSize];
+        for ( int h = 0; h < height; h++ ) {
+            floatingPointRevert ( data + h * lineSize, tmp, samples, channels );
+        }
+        delete[] tmp;
+    }
+}
+
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file Predictor.h
+ * \~french
+ * \brief Définition des prédicteurs TIFF et de la classe PredictorDecoder
+ * \details Le prédicteur horizontal (2) remplace chaque échantillon par sa différence avec l'échantillon
+ * du même canal du pixel précédent. Le prédicteur flottant (3) range d'abord les octets de la ligne par
+ * poids (tous les octets de poids fort, puis les suivants...), avant d'appliquer la même différence octet
+ * par octet. Dans les deux cas, les données deviennent bien plus compressibles par LZW ou deflate.
+ * \~english
+ * \brief Define TIFF predictors and the PredictorDecoder class
+ * \details The horizontal predictor (2) replaces each sample by its difference with the same channel
+ * sample of the previous pixel. The floating point predictor (3) first sorts the line bytes by weight
+ * (all most significant bytes, then the next ones...), before applying the same difference byte per byte.
+ * In both cases, data become far more compressible by LZW or deflate.
+ */
+
+#ifndef PREDICTOR_H
+#define PREDICTOR_H
+
+#include "Data.h"
+#include "Format.h"
+#include "MemoryArena.h"
+
+namespace Predictor {
+
+/**
+ * \~french \brief Précise si un prédicteur s'applique à un type de canal
+ * \details HORIZONTAL s'applique aux entiers, FLOATINGPOINT aux flottants sur 32 bits
+ * \~english \brief Tell if a predictor can be applied to a sample type
+ * \details HORIZONTAL applies to integers, FLOATINGPOINT to 32-bit floats
+ */
+bool isCompatible ( ePredictor pred, SampleFormat::eSampleFormat sf, int bitspersample );
+
+/**
+ * \~french
+ * \brief Applique le prédicteur à une tuile, sur place
+ * \param[in,out] data tuile brute, lignes contiguës
+ * \param[in] width largeur de la tuile, en pixel
+ * \param[in] height hauteur de la tuile, en pixel
+ * \param[in] channels nombre de canaux
+ * \param[in] sampleSize taille d'un canal, en octet
+ * \~english
+ * \brief Apply the predictor to a tile, in place
+ * \param[in,out] data raw tile, contiguous lines
+ * \param[in] width tile width, in pixel
+ * \param[in] height tile height, in pixel
+ * \param[in] channels number of samples per pixel
+ * \param[in] sampleSize sample size, in byte
+ */
+void apply ( ePredictor pred, uint8_t* data, int width, int height, int channels, int sampleSize );
+
+/**
+ * \~french \brief Annule le prédicteur sur une tuile décompressée, sur place
+ * \~english \brief Revert the predictor on a decompressed tile, in place
+ */
+void revert ( ePredictor pred, uint8_t* data, int width, int height, int channels, int sampleSize );
+
+}
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Annulation du prédicteur sur une tuile décodée
+ * \details Les données décodées appartiennent à la source décorée : le prédicteur y est annulé sur place,
+ * une seule fois, au premier appel de getData.
+ * \~english
+ * \brief Predictor reverting on a decoded tile
+ * \details Decoded data belong to the decorated source : the predictor is reverted there in place, once,
+ * on the first getData call.
+ */
+class PredictorDecoder : public DataSource {
+private:
+    DataSource* decData;
+    Predictor::ePredictor predictor;
+    int width;
+    int height;
+    int channels;
+    int sampleSize;
+    bool reverted;
+
+public:
+    PredictorDecoder ( DataSource* decData, Predictor::ePredictor predictor, int width, int height, int channels, int sampleSize ) :
+        decData ( decData ), predictor ( predictor ), width ( width ), height ( height ), channels ( channels ),
+        sampleSize ( sampleSize ), reverted ( false ) {}
+
+    ~PredictorDecoder() {
+        delete decData;
+    }
+
+    static void* operator new ( size_t size ) {
+        return MemoryArena::alloc ( size );
+    }
+    static void operator delete ( void* ptr ) {
+        MemoryArena::release ( ptr );
+    }
+
+    const uint8_t* getData ( size_t &size ) {
+        const uint8_t* data = decData->getData ( size );
+        if ( data && ! reverted ) {
+            if ( size >= ( size_t ) width * height * channels * sampleSize ) {
+                Predictor::revert ( predictor, ( uint8_t* ) data, width, height, channels, sampleSize );
+            }
+            reverted = true;
+        }
+        return data;
+    }
+    bool releaseData() {
+        // Les données relues seront à nouveau prédites
+        reverted = false;
+        return decData->releaseData();
+    }
+    std::string getType() {
+        return decData->getType();
+    }
+    int getHttpStatus() {
+        return decData->getHttpStatus();
+    }
+    std::string getEncoding() {
+        return decData->getEncoding();
+    }
+};
+
+#endif // PREDICTOR_H
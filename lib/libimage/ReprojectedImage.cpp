@@ -52,6 +52,7 @@
 #include "Kernel.h"
 
 #include "Utils.h"
+#include "CancellationToken.h"
 #include <cmath>
 
 void ReprojectedImage::initialize () {
@@ -65,6 +66,9 @@ void ReprojectedImage::initialize () {
 
     if ( ! sourceImage->getMask() ) {
         useMask = false;
+    } else if ( sourceImage->getMask()->getCoverage ( 0, sourceImage->getHeight() - 1 ) == MaskCoverage::FULL ) {
+        // Un masque entièrement plein n'apporte rien à l'interpolation
+        useMask = false;
     }
 
     memorizedLines = 2*Ky + ceil ( grid->getDeltaY() );
@@ -90,12 +94,12 @@ void ReprojectedImage::initialize () {
                      + outImgSize * 8 * sizeof ( float ) // 4 lignes reprojetées, en multiplexées et en séparées => 8
                      + gridSize * 8 * sizeof ( float ) // 4 lignes de la grille, X et Y => 8
 
-                     /*   1024 possibilités de poids
-                      * + poids pour 4 lignes, multiplexés
+                     /*   poids pour 4 lignes, multiplexés
                       * + extrait des 4 lignes sources, sur lesquelles appliquer les poids
+                      * (les KERNEL_PHASES possibilités de poids sont partagées par le noyau)
                       */
-                     + kxSize * ( 1028 + 4*channels ) * sizeof ( float )
-                     + kySize * ( 1028 + 4*channels ) * sizeof ( float );
+                     + kxSize * ( 4 + 4*channels ) * sizeof ( float )
+                     + kySize * ( 4 + 4*channels ) * sizeof ( float );
 
     if ( useMask ) {
         globalSize += srcMskSize * memorizedLines * sizeof ( float ) // place pour charger "memorizedLines" lignes du masque source
@@ -108,15 +112,15 @@ void ReprojectedImage::initialize () {
      *  - gain de temps (l'allocation est une action qui prend du temps)
      *  - tous les buffers sont côtes à côtes dans la mémoire, gain de temps lors des lectures/écritures
      */
-    __buffer = ( float* ) _mm_malloc ( globalSize, 16 ); // Allocation allignée sur 16 octets pour SSE
+    __buffer = ( float* ) MemoryArena::alloc ( globalSize, 16 ); // Allocation allignée sur 16 octets pour SSE, dans l'arène de la requête s'il y en a une
     memset ( __buffer, 0, globalSize );
 
     float* B = __buffer;
 
     /* -------------------- PARTIE IMAGE -------------------- */
 
-    src_image_buffer = new float*[memorizedLines];
-    src_line_index = new int[memorizedLines];
+    src_image_buffer = ( float** ) MemoryArena::alloc ( memorizedLines * sizeof ( float* ) );
+    src_line_index = ( int* ) MemoryArena::alloc ( memorizedLines * sizeof ( int ) );
 
     for ( int i = 0; i < memorizedLines; i++ ) {
         src_image_buffer[i] = B;
@@ -142,7 +146,7 @@ void ReprojectedImage::initialize () {
     /* -------------------- PARTIE MASQUE ------------------- */
 
     if ( useMask ) {
-        src_mask_buffer = new float*[memorizedLines];
+        src_mask_buffer = ( float** ) MemoryArena::alloc ( memorizedLines * sizeof ( float* ) );
         for ( int i = 0; i < memorizedLines; i++ ) {
             src_mask_buffer[i] = B;
             B += srcMskSize;
@@ -171,23 +175,13 @@ void ReprojectedImage::initialize () {
         B += gridSize;
     }
 
-    for ( int i = 0; i < 1024; i++ ) {
-        Wx[i] = B;
-        B += kxSize;
-        Wy[i] = B;
-        B += kySize;
-    }
     WWx = B;
     B += 4*kxSize;
     WWy = B;
     B += 4*kySize;
 
-    for ( int i = 0; i < 1024; i++ ) {
-        int lgX = Kx;
-        int lgY = Ky;
-        xmin[i] = K.weight ( Wx[i], lgX, double ( i ) /1024. + Kx, sourceImage->getWidth() ) - Kx;
-        ymin[i] = K.weight ( Wy[i], lgY, double ( i ) /1024. + Ky, sourceImage->getHeight() ) - Ky;
-    }
+    tableX = K.getWeightTable ( Kx );
+    tableY = K.getWeightTable ( Ky );
 }
 
 int ReprojectedImage::getSourceLineIndex ( int line ) {
@@ -215,6 +209,10 @@ float* ReprojectedImage::computeDestLine ( int line ) {
     if ( line/4 == dst_line_index ) {
         return dst_image_buffer[line%4];
     }
+    // Requête annulée : les lignes ne sont pas calculées
+    if ( CancellationToken::currentCancelled() ) {
+        return dst_image_buffer[line%4];
+    }
     dst_line_index = line/4;
 
     for ( int i = 0; i < 4; i++ ) {
@@ -231,21 +229,21 @@ float* ReprojectedImage::computeDestLine ( int line ) {
     for ( int x = 0; x < width; x++ ) {
 
         for ( int i = 0; i < 4; i++ ) {
-            Ix[i] = ( X[i][x] - floor ( X[i][x] ) ) * 1024;
-            Iy[i] = ( Y[i][x] - floor ( Y[i][x] ) ) * 1024;
+            Ix[i] = ( X[i][x] - floor ( X[i][x] ) ) * KERNEL_PHASES;
+            Iy[i] = ( Y[i][x] - floor ( Y[i][x] ) ) * KERNEL_PHASES;
         }
 
-        multiplex ( WWx, Wx[Ix[0]], Wx[Ix[1]], Wx[Ix[2]], Wx[Ix[3]], Kx );
-        multiplex ( WWy, Wy[Iy[0]], Wy[Iy[1]], Wy[Iy[2]], Wy[Iy[3]], Ky );
+        multiplex ( WWx, tableX->getWeights ( Ix[0] ), tableX->getWeights ( Ix[1] ), tableX->getWeights ( Ix[2] ), tableX->getWeights ( Ix[3] ), Kx );
+        multiplex ( WWy, tableY->getWeights ( Iy[0] ), tableY->getWeights ( Iy[1] ), tableY->getWeights ( Iy[2] ), tableY->getWeights ( Iy[3] ), Ky );
 
-        int y0 = ( int ) ( Y[0][x] ) + ymin[Iy[0]];
-        int y1 = ( int ) ( Y[1][x] ) + ymin[Iy[1]];
-        int y2 = ( int ) ( Y[2][x] ) + ymin[Iy[2]];
-        int y3 = ( int ) ( Y[3][x] ) + ymin[Iy[3]];
-        int dx0 = ( ( int ) ( X[0][x] ) + xmin[Ix[0]] );
-        int dx1 = ( ( int ) ( X[1][x] ) + xmin[Ix[1]] );
-        int dx2 = ( ( int ) ( X[2][x] ) + xmin[Ix[2]] );
-        int dx3 = ( ( int ) ( X[3][x] ) + xmin[Ix[3]] );
+        int y0 = ( int ) ( Y[0][x] ) + tableY->getOffset ( Iy[0] );
+        int y1 = ( int ) ( Y[1][x] ) + tableY->getOffset ( Iy[1] );
+        int y2 = ( int ) ( Y[2][x] ) + tableY->getOffset ( Iy[2] );
+        int y3 = ( int ) ( Y[3][x] ) + tableY->getOffset ( Iy[3] );
+        int dx0 = ( ( int ) ( X[0][x] ) + tableX->getOffset ( Ix[0] ) );
+        int dx1 = ( ( int ) ( X[1][x] ) + tableX->getOffset ( Ix[1] ) );
+        int dx2 = ( ( int ) ( X[2][x] ) + tableX->getOffset ( Ix[2] ) );
+        int dx3 = ( ( int ) ( X[3][x] ) + tableX->getOffset ( Ix[3] ) );
 
         for ( int j = 0; j < Ky; j++ ) {
 
@@ -322,6 +320,25 @@ int ReprojectedImage::getline ( float* buffer, int line ) {
     return width*channels;
 }
 
+template<typename T>
+int ReprojectedImage::_getBlock ( int x, int y, int w, int h, T* buffer, int stride ) {
+    if ( ! isBlockInside ( x, y, w, h ) ) return 0;
 
+    for ( int l = 0; l < h; l++ ) {
+        const float* dst_line = computeDestLine ( y + l );
+        convert ( buffer + l * stride, dst_line + x * channels, w * channels );
+    }
+    return w * h * channels;
+}
 
+int ReprojectedImage::getBlock ( int x, int y, int w, int h, uint8_t* buffer, int stride ) {
+    return _getBlock ( x, y, w, h, buffer, stride );
+}
 
+int ReprojectedImage::getBlock ( int x, int y, int w, int h, uint16_t* buffer, int stride ) {
+    return _getBlock ( x, y, w, h, buffer, stride );
+}
+
+int ReprojectedImage::getBlock ( int x, int y, int w, int h, float* buffer, int stride ) {
+    return _getBlock ( x, y, w, h, buffer, stride );
+}
@@ -50,7 +50,7 @@
 #include "Grid.h"
 #include "Kernel.h"
 #include "Interpolation.h"
-#include <mm_malloc.h>
+#include "MemoryArena.h"
 
 /**
  * \author Institut national de l'information géographique et forestière
@@ -224,18 +224,18 @@ private:
     float* Y[4];
 
     /**
-     * \~french \brief Poids pré-calculé, dans le sens des X
-     * \details Du fait de la reprojection, tous les pixels à reprojeter sont décalés en X par rapport aux pixels sources d'une manière différente. Pour des raisons de performance, on ne peut pas calculer pour chaque pixel le tableau des poids correspondant. On va donc préalablement calculer 1024 possibilités de poids, qui seront utilisés pour l'ensemble de l'image reprojetée.
-     * \~english \brief Pre-calculated weights, X wise
+     * \~french \brief Poids pré-calculés, dans le sens des X
+     * \details Du fait de la reprojection, tous les pixels à reprojeter sont décalés en X par rapport aux pixels sources d'une manière différente. Pour des raisons de performance, on ne peut pas calculer pour chaque pixel le tableau des poids correspondant. On utilise donc les #KERNEL_PHASES possibilités de poids précalculées par le noyau, partagées par toutes les images reprojetées. La table fournit aussi le premier pixel source à utiliser pour chaque possibilité.
+     * \~english \brief Pre-calculated weights, X wise, shared by all reprojected images
      */
-    float* Wx[1024];
+    const WeightTable* tableX;
 
     /**
-     * \~french \brief Poids pré-calculé, dans le sens des Y
-     * \details Du fait de la reprojection, tous les pixels à reprojeter sont décalés en Y par rapport aux pixels sources d'une manière différente. Pour des raisons de performance, on ne peut pas calculer pour chaque pixel le tableau des poids correspondant. On va donc préalablement calculer 1024 possibilités de poids, qui seront utilisés pour l'ensemble de l'image reprojetée.
-     * \~english \brief Pre-calculated weights, Y wise
+     * \~french \brief Poids pré-calculés, dans le sens des Y
+     * \details Du fait de la reprojection, tous les pixels à reprojeter sont décalés en Y par rapport aux pixels sources d'une manière différente. On utilise donc les #KERNEL_PHASES possibilités de poids précalculées par le noyau, partagées par toutes les images reprojetées.
+     * \~english \brief Pre-calculated weights, Y wise, shared by all reprojected images
      */
-    float* Wy[1024];
+    const WeightTable* tableY;
 
     /**
      * \~french \brief Poids dans le sens des X utilisés pour le calcul des 4 pixels en cours, multiplexés
@@ -248,19 +248,6 @@ private:
      */
     float* WWy;
 
-    /**
-     * \~french \brief Premiers pixels sources à utiliser, dans le sens des X, pré-calculé
-     * \details Du fait de la reprojection, tous les pixels à reprojeter sont décalés en X par rapport aux pixels sources d'une manière différente. Pour des raisons de performance, on ne peut pas calculer pour chaque pixel le premier pixel source à utiliser. On va donc préalablement calculer 1024 possibilités de premier pixel, qui seront utilisés pour l'ensemble de l'image reprojetée.
-     * \~english \brief First usefull source pixels, X wise, pre-calculated
-     */
-    int xmin[1024];
-    /**
-     * \~french \brief Premiers pixels sources à utiliser, dans le sens des Y, pré-calculé
-     * \details Du fait de la reprojection, tous les pixels à reprojeter sont décalés en Y par rapport aux pixels sources d'une manière différente. Pour des raisons de performance, on ne peut pas calculer pour chaque pixel le premier pixel source à utiliser. On va donc préalablement calculer 1024 possibilités de premier pixel, qui seront utilisés pour l'ensemble de l'image reprojetée.
-     * \~english \brief First usefull source pixels, Y wise, pre-calculated
-     */
-    int ymin[1024];
-
     /**
      * \~french \brief Pixels sources à utiliser pour les 4 pixels en cours, multiplexés
      * \~english \brief Source pixels to use to calculate the 4 pixels in progress, multiplexed
@@ -292,6 +279,9 @@ private:
      */
     float* computeDestLine ( int line );
 
+    template<typename T>
+    int _getBlock ( int x, int y, int w, int h, T* buffer, int stride );
+
     /** \~french
      * \brief Retourne l'index dans le buffer #src_image_buffer (et #src_mask_buffer) de la ligne source voulue
      * \details On ne mémorise que #memorizedLines lignes sources. Lorsque l'on a besoin d'une ligne source, on en demande l'index. Si cette ligne est déjà chargée dans le buffer, on retourne directement l'index. Sinon, on récupère la ligne de #sourceImage, on la stocke, on met à jour la table des index #src_line_index, et on retourne l'index de la ligne voulue.
@@ -355,6 +345,17 @@ public:
     int getline ( uint8_t* buffer, int line );
     int getline ( uint16_t* buffer, int line );
 
+    /** \~french
+     * \brief Retourne un bloc reprojeté
+     * \details Les lignes sont calculées par paquets de 4, comme pour #getline, mais seules les colonnes demandées sont converties, directement dans le buffer de sortie.
+     ** \~english
+     * \brief Return a reprojected block
+     * \details Lines are calculated 4 by 4, as for #getline, but only asked columns are converted, directly into the output buffer.
+     */
+    int getBlock ( int x, int y, int w, int h, uint8_t* buffer, int stride );
+    int getBlock ( int x, int y, int w, int h, uint16_t* buffer, int stride );
+    int getBlock ( int x, int y, int w, int h, float* buffer, int stride );
+
     /**
      * \~french \brief Destructeur par défaut
      * \details Désallocation de la mémoire :
@@ -373,13 +374,13 @@ public:
      * And remove #sourceImage
      */
     ~ReprojectedImage() {
-        _mm_free ( __buffer );
+        MemoryArena::release ( __buffer );
 
-        delete[] src_image_buffer;
-        delete[] src_line_index;
+        MemoryArena::release ( src_image_buffer );
+        MemoryArena::release ( src_line_index );
 
         if ( useMask ) {
-            delete[] src_mask_buffer;
+            MemoryArena::release ( src_mask_buffer );
         }
 
         if ( ! isMask ) {
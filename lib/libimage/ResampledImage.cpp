@@ -46,13 +46,14 @@
 #include "ResampledImage.h"
 #include "Logger.h"
 #include "Utils.h"
+#include "CancellationToken.h"
 #include <tiff.h>
 #include <cmath>
 #include <cstring>
 
 ResampledImage::ResampledImage ( Image* image, int width, int height,
                                  double resx, double resy, BoundingBox< double > bbox,
-                                 Interpolation::KernelType KT, bool bMask ) :
+                                 Interpolation::KernelType KT, bool bMask, bool integerSource ) :
 
     Image ( width, height, image->channels, resx, resy, bbox ), sourceImage ( image ), K ( Kernel::getInstance ( KT ) ), useMask ( bMask ) {
 
@@ -71,8 +72,11 @@ ResampledImage::ResampledImage ( Image* image, int width, int height,
     // On calcule le nombre de pixels sources à considérer dans l'interpolation, dans le sens des x et des y
     Kx = ceil ( 2 * K.size ( ratioX )-1E-7 );
     Ky = ceil ( 2 * K.size ( ratioY )-1E-7 );
+    tableY = K.getWeightTable ( Ky );
 
     if ( ! sourceImage->getMask() ) useMask = false;
+    // Un masque entièrement plein n'apporte rien à l'interpolation
+    if ( useMask && sourceImage->getMask()->getCoverage ( 0, sourceImage->getHeight() - 1 ) == MaskCoverage::FULL ) useMask = false;
 
     /* On veut mémoriser un certain nombre de lignes pour ne pas refaire un travail déjà fait.
      * On va travailler les lignes 4 par 4 (pour l'utilisation des instructions SSE). On va donc mémoriser
@@ -113,7 +117,7 @@ ResampledImage::ResampledImage ( Image* image, int width, int height,
      *  - gain de temps (l'allocation est une action qui prend du temps)
      *  - tous les buffers sont côtes à côtes dans la mémoire, gain de temps lors des lectures/écritures
      */
-    __buffer = ( float* ) _mm_malloc ( sz, 16 ); // Allocation allignée sur 16 octets pour SSE
+    __buffer = ( float* ) MemoryArena::alloc ( sz, 16 ); // Allocation allignée sur 16 octets pour SSE, dans l'arène de la requête s'il y en a une
     memset ( __buffer, 0, sz );
 
     float* B = ( float* ) __buffer;
@@ -129,8 +133,8 @@ ResampledImage::ResampledImage ( Image* image, int width, int height,
     B += 4*srcImgSize;
 
     // Ligne d'image rééchantillonnée
-    resampled_image = new float*[memorizedLines];
-    resampled_line_index = new int[memorizedLines];
+    resampled_image = ( float** ) MemoryArena::alloc ( memorizedLines * sizeof ( float* ) );
+    resampled_line_index = ( int* ) MemoryArena::alloc ( memorizedLines * sizeof ( int ) );
 
     mux_resampled_image = B;
     B += 4*outImgSize;
@@ -157,7 +161,8 @@ ResampledImage::ResampledImage ( Image* image, int width, int height,
         B += outMskSize;
 
         // Ligne de masque rééchantillonnée
-        resampled_mask = new float*[memorizedLines];
+        resampled_mask = ( float** ) MemoryArena::alloc ( memorizedLines * sizeof ( float* ) );
+        resampled_coverage = ( MaskCoverage::eMaskCoverage* ) MemoryArena::alloc ( memorizedLines * sizeof ( MaskCoverage::eMaskCoverage ) );
         mux_resampled_mask = B;
         B += 4*outMskSize;
 
@@ -176,13 +181,67 @@ ResampledImage::ResampledImage ( Image* image, int width, int height,
 
     memset ( Wx, 0, xWeightSize * sizeof ( float ) );
     float* W = Wx;
+    const WeightTable* tableX = K.getWeightTable ( Kx );
     for ( int x = 0; x < width; x++ ) {
         int lg = Kx;
-        xMin[x] = K.weight ( W, lg, left + x * ratioX, sourceImage->getWidth() );
+        xMin[x] = tableX->weight ( W, lg, left + x * ratioX, sourceImage->getWidth() );
         // On copie chaque poids en 4 exemplaires.
         for ( int i = lg-1; i >= 0; i-- ) for ( int j = 0; j < 4; j++ ) W[4*i + j] = W[i];
         W += 4*Kx;
     }
+
+    /* ----------------- PARTIE VIRGULE FIXE ---------------- */
+
+    fixedPoint = integerSource && ! useMask;
+    __fixed_buffer = NULL;
+    if ( ! fixedPoint ) return;
+
+    int srcFixedSize = 16* ( ( ( sourceImage->getWidth() + Kx ) *channels + 15 ) /16 );
+    int fixedSz = ( width*Kx + memorizedLines*outImgSize ) * sizeof ( int16_t )
+                  + outImgSize * sizeof ( int32_t )
+                  + memorizedLines * sizeof ( int )
+                  + srcFixedSize;
+
+    __fixed_buffer = ( uint8_t* ) MemoryArena::alloc ( fixedSz, 16 );
+    memset ( __fixed_buffer, 0, fixedSz );
+
+    uint8_t* F = __fixed_buffer;
+    fixed_accumulator = ( int32_t* ) F;
+    F += outImgSize * sizeof ( int32_t );
+    fixed_resampled_image = ( int16_t* ) F;
+    F += memorizedLines * outImgSize * sizeof ( int16_t );
+    fixedWx = ( int16_t* ) F;
+    F += width * Kx * sizeof ( int16_t );
+    fixed_line_index = ( int* ) F;
+    F += memorizedLines * sizeof ( int );
+    // Les Kx pixels en fin de ligne restent nuls : les poids au delà de la largeur source sont nuls
+    fixed_src_line = F;
+
+    for ( int i = 0; i < memorizedLines; i++ ) fixed_line_index[i] = -1;
+
+    // Les poids flottants sont quadruplés dans Wx : on n'en prend qu'un exemplaire
+    float weights[Kx];
+    for ( int x = 0; x < width; x++ ) {
+        for ( int i = 0; i < Kx; i++ ) weights[i] = Wx[4*Kx*x + 4*i];
+        quantize ( fixedWx + Kx*x, weights, Kx );
+    }
+}
+
+const int16_t* ResampledImage::resampleSourceLineFixed ( int line ) {
+    int16_t* resampled = fixed_resampled_image + ( line % memorizedLines ) * 4* ( ( width*channels + 3 ) /4 );
+
+    if ( fixed_line_index[line % memorizedLines] == line ) {
+        return resampled;
+    }
+
+    sourceImage->getline ( fixed_src_line, line );
+
+    for ( int x = 0; x < width; x++ ) {
+        dot_prod ( channels, Kx, resampled + x*channels, fixed_src_line + xMin[x]*channels, fixedWx + Kx*x );
+    }
+
+    fixed_line_index[line % memorizedLines] = line;
+    return resampled;
 }
 
 int ResampledImage::resampleSourceLine ( int line ) {
@@ -193,15 +252,40 @@ int ResampledImage::resampleSourceLine ( int line ) {
         return ( line % memorizedLines );
     }
 
+    int first = 4* ( line/4 );
+    int last = __min ( first + 3, sourceImage->getHeight() - 1 );
+
+    /* Avec masque, on détermine la couverture des 4 lignes : sans donnée, il n'y a rien à lire ni à calculer ;
+     * pleines, on utilise l'interpolation sans masque.
+     */
+    MaskCoverage::eMaskCoverage coverage = MaskCoverage::FULL;
+    if ( useMask ) {
+        coverage = sourceImage->getMask()->getCoverage ( first, last );
+    }
+
+    if ( coverage == MaskCoverage::EMPTY ) {
+        for ( int i = 0; i < 4; i++ ) {
+            resampled_coverage[ ( first + i ) % memorizedLines] = MaskCoverage::EMPTY;
+            resampled_line_index[ ( first + i ) % memorizedLines] = first + i;
+        }
+        return ( line % memorizedLines );
+    }
+
     /* On va réechantillonner 4 lignes d'un coup. On commence par charger les 4 lignes de l'image source concernées
      * On vérifie bien que les 4 lignes existent bel et bien (qu'on dépasse pas la hauteur de l'image source)
      */
+    if ( useMask && coverage == MaskCoverage::MIXED ) {
+        coverage = MaskCoverage::FULL;
+        for ( int i = 0; first + i <= last; i++ ) {
+            sourceImage->getMask()->getline ( src_mask_buffer[i], first + i );
+            MaskCoverage::eMaskCoverage lineCoverage = MaskCoverage::fromLine ( src_mask_buffer[i], sourceImage->getWidth() );
+            coverage = ( i == 0 ) ? lineCoverage : MaskCoverage::merge ( coverage, lineCoverage );
+        }
+    }
+
     for ( int i = 0; i < 4; i++ ) {
-        if ( 4* ( line/4 ) + i < sourceImage->getHeight() ) {
-            sourceImage->getline ( src_image_buffer[i], 4* ( line/4 ) + i );
-            if ( useMask ) {
-                sourceImage->getMask()->getline ( src_mask_buffer[i], 4* ( line/4 ) + i );
-            }
+        if ( first + i < sourceImage->getHeight() ) {
+            sourceImage->getline ( src_image_buffer[i], first + i );
         }
     }
 
@@ -222,14 +306,17 @@ int ResampledImage::resampleSourceLine ( int line ) {
                 sourceImage->getWidth() *sourceImage->channels );
 
 
-    if ( useMask ) {
+    // Des lignes pleines ou vides se réechantillonnent sans masque
+    bool maskedLines = ( useMask && coverage == MaskCoverage::MIXED );
+
+    if ( maskedLines ) {
         multiplex ( mux_src_mask_buffer,
                     src_mask_buffer[0], src_mask_buffer[1], src_mask_buffer[2], src_mask_buffer[3],
                     sourceImage->getWidth() );
     }
 
     for ( int x = 0; x < width; x++ ) {
-        if ( useMask ) {
+        if ( maskedLines ) {
             dot_prod ( channels, Kx,
                        mux_resampled_image + 4*x*channels,
                        mux_resampled_mask + 4*x,
@@ -251,7 +338,7 @@ int ResampledImage::resampleSourceLine ( int line ) {
                   mux_resampled_image, width*channels );
 
 
-    if ( useMask ) {
+    if ( maskedLines ) {
         demultiplex ( resampled_mask[ ( 4* ( line/4 ) ) % memorizedLines],
                       resampled_mask[ ( 4* ( line/4 ) +1 ) % memorizedLines],
                       resampled_mask[ ( 4* ( line/4 ) +2 ) % memorizedLines],
@@ -259,6 +346,12 @@ int ResampledImage::resampleSourceLine ( int line ) {
                       mux_resampled_mask, width );
     }
 
+    if ( useMask ) {
+        for ( int i = 0; i < 4; i++ ) {
+            resampled_coverage[ ( first + i ) % memorizedLines] = coverage;
+        }
+    }
+
     // Mise à jour des index des lignes mémorisées
     for ( int i = 0; i < 4; i++ ) {
         resampled_line_index[ ( 4* ( line/4 ) +i ) % memorizedLines] = 4* ( line/4 ) +i;
@@ -269,38 +362,118 @@ int ResampledImage::resampleSourceLine ( int line ) {
 
 int ResampledImage::getline ( float* buffer, int line ) {
 
+    // Requête annulée : la ligne n'est pas calculée
+    if ( CancellationToken::currentCancelled() ) {
+        return width*channels;
+    }
+
     float weights[Ky];
 
     // On calcule les coefficient d'interpolation
-    int ymin = K.weight ( weights, Ky, top + line * ratioY, sourceImage->getHeight() );
+    int lg = Ky;
+    int ymin = tableY->weight ( weights, lg, top + line * ratioY, sourceImage->getHeight() );
 
-    int index = resampleSourceLine ( ymin );
-    if ( useMask ) {
-        mult ( buffer, weight_buffer, resampled_image[index], resampled_mask[index], weights[0], width, channels );
-    } else {
+    if ( ! useMask ) {
+        int index = resampleSourceLine ( ymin );
         mult ( buffer, resampled_image[index], weights[0], width*channels );
+        for ( int y = 1; y < lg; y++ ) {
+            index = resampleSourceLine ( ymin+y );
+            add_mult ( buffer, resampled_image[index], weights[y], width*channels );
+        }
+        return width*channels;
     }
 
-    for ( int y = 1; y < Ky; y++ ) {
-        index = resampleSourceLine ( ymin+y );
-        if ( useMask ) {
-            add_mult ( buffer, weight_buffer, resampled_image[index], resampled_mask[index], weights[y], width, channels );
-        } else {
+    /* Avec masque, chaque ligne réechantillonnée en X est traitée selon sa couverture :
+     *  - vide : elle n'intervient pas
+     *  - pleine : elle est ajoutée sans masque, son poids est le même pour tous les pixels
+     *  - mixte : elle est ajoutée avec masque, les poids étant cumulés pixel par pixel
+     */
+    memset ( buffer, 0, width*channels*sizeof ( float ) );
+    float fullWeight = 0.;
+    bool mixed = false, skipped = false;
+
+    for ( int y = 0; y < lg; y++ ) {
+        int index = resampleSourceLine ( ymin+y );
+        switch ( resampled_coverage[index] ) {
+        case MaskCoverage::EMPTY:
+            skipped = true;
+            break;
+        case MaskCoverage::FULL:
             add_mult ( buffer, resampled_image[index], weights[y], width*channels );
+            fullWeight += weights[y];
+            break;
+        default:
+            if ( ! mixed ) {
+                memset ( weight_buffer, 0, width*sizeof ( float ) );
+                mixed = true;
+            }
+            add_mult ( buffer, weight_buffer, resampled_image[index], resampled_mask[index], weights[y], width, channels );
+            break;
         }
     }
 
-    if ( useMask ) {
+    if ( mixed ) {
+        if ( fullWeight != 0. ) {
+            for ( int x = 0; x < width; x++ ) weight_buffer[x] += fullWeight;
+        }
         normalize ( buffer, weight_buffer, width, channels );
+    } else if ( skipped && fullWeight != 0. ) {
+        mult ( buffer, buffer, 1. / fullWeight, width*channels );
     }
 
     return width*channels;
 }
 
+MaskCoverage::eMaskCoverage ResampledImage::getCoverage ( int firstLine, int lastLine ) {
+    // Lignes sources intervenant dans l'interpolation des lignes demandées, arrondies vers l'extérieur
+    int first = __max ( 0, ( int ) floor ( top + firstLine * ratioY - Ky / 2. ) );
+    int last = __min ( sourceImage->getHeight() - 1, ( int ) ceil ( top + lastLine * ratioY + Ky / 2. ) );
+    if ( first > last ) return MaskCoverage::MIXED;
+    return sourceImage->getCoverage ( first, last );
+}
+
+bool ResampledImage::computeFixedLine ( int line ) {
+    // Requête annulée : la ligne n'est pas calculée
+    if ( CancellationToken::currentCancelled() ) {
+        return false;
+    }
+
+    float weights[Ky];
+    int16_t fixedWeights[Ky + 1];
+
+    int lg = Ky;
+    int ymin = tableY->weight ( weights, lg, top + line * ratioY, sourceImage->getHeight() );
+    quantize ( fixedWeights, weights, lg );
+    fixedWeights[lg] = 0;
+
+    /* Les lignes sont combinées deux par deux, pour que les entiers 16 bits des deux lignes soient multipliés
+     * et sommés en une seule instruction. Si le nombre de lignes est impair, la dernière est associée à un poids nul.
+     */
+    int nb = width*channels;
+    for ( int y = 0; y < lg; y += 2 ) {
+        const int16_t* l1 = resampleSourceLineFixed ( ymin + y );
+        const int16_t* l2 = ( y + 1 < lg ) ? resampleSourceLineFixed ( ymin + y + 1 ) : l1;
+        if ( y == 0 ) {
+            mult ( fixed_accumulator, l1, l2, fixedWeights[y], fixedWeights[y+1], nb );
+        } else {
+            add_mult ( fixed_accumulator, l1, l2, fixedWeights[y], fixedWeights[y+1], nb );
+        }
+    }
+
+    return true;
+}
+
 int ResampledImage::getline ( uint8_t* buffer, int line ) {
-    int nb = getline ( dst_image_buffer, line );
-    convert ( buffer, dst_image_buffer, nb );
-    return nb;
+    if ( ! fixedPoint ) {
+        int nb = getline ( dst_image_buffer, line );
+        convert ( buffer, dst_image_buffer, nb );
+        return nb;
+    }
+
+    if ( computeFixedLine ( line ) ) {
+        convert ( buffer, fixed_accumulator, FIXED_WEIGHT_BITS + FIXED_LINE_BITS, width*channels );
+    }
+    return width*channels;
 }
 
 int ResampledImage::getline ( uint16_t* buffer, int line ) {
@@ -308,3 +481,37 @@ int ResampledImage::getline ( uint16_t* buffer, int line ) {
     convert ( buffer, dst_image_buffer, nb );
     return nb;
 }
+
+template<typename T>
+int ResampledImage::getBlockFromFloatLines ( int x, int y, int w, int h, T* buffer, int stride ) {
+    if ( ! isBlockInside ( x, y, w, h ) ) return 0;
+
+    for ( int l = 0; l < h; l++ ) {
+        getline ( dst_image_buffer, y + l );
+        convert ( buffer + l * stride, dst_image_buffer + x * channels, w * channels );
+    }
+    return w * h * channels;
+}
+
+int ResampledImage::getBlock ( int x, int y, int w, int h, uint8_t* buffer, int stride ) {
+    if ( ! fixedPoint ) {
+        return getBlockFromFloatLines ( x, y, w, h, buffer, stride );
+    }
+
+    if ( ! isBlockInside ( x, y, w, h ) ) return 0;
+
+    for ( int l = 0; l < h; l++ ) {
+        if ( computeFixedLine ( y + l ) ) {
+            convert ( buffer + l * stride, fixed_accumulator + x * channels, FIXED_WEIGHT_BITS + FIXED_LINE_BITS, w * channels );
+        }
+    }
+    return w * h * channels;
+}
+
+int ResampledImage::getBlock ( int x, int y, int w, int h, uint16_t* buffer, int stride ) {
+    return getBlockFromFloatLines ( x, y, w, h, buffer, stride );
+}
+
+int ResampledImage::getBlock ( int x, int y, int w, int h, float* buffer, int stride ) {
+    return getBlockFromFloatLines ( x, y, w, h, buffer, stride );
+}
@@ -49,7 +49,7 @@
 #include "Image.h"
 #include "Kernel.h"
 #include "Interpolation.h"
-#include <mm_malloc.h>
+#include "MemoryArena.h"
 
 /**
  * \author Institut national de l'information géographique et forestière
@@ -104,6 +104,12 @@ private:
      */
     int Ky;
 
+    /**
+     * \~french \brief Poids précalculés pour #Ky pixels sources, partagés entre les requêtes
+     * \~english \brief Precomputed weights for #Ky source pixels, shared between requests
+     */
+    const WeightTable* tableY;
+
     /**
      * \~french \brief Rapport des résolutions source et finale, dans le sens des X
      * \details Ratio de rééchantillonage en X = résolution X cible / résolution X source
@@ -212,6 +218,14 @@ private:
      */
     float** resampled_mask;
 
+    /**
+     * \~french \brief Couverture du masque des lignes mémorisées
+     * \details Une ligne source pleine ou vide donne une ligne réechantillonnée en X pleine ou vide : l'interpolation peut alors se passer des masques.
+     * \~english \brief Memorized lines' mask coverage
+     * \details A full or empty source line gives a full or empty widthwise resampled line : interpolation can then do without masks.
+     */
+    MaskCoverage::eMaskCoverage* resampled_coverage;
+
     /**
      * \~french \brief Ligne d'image, réechantillonnée en X, multiplexée
      * \~english \brief Image's line, widthwise resampled, multiplexed
@@ -252,6 +266,54 @@ private:
      */
     int* xMin;
 
+    /**
+     * \~french \brief Précise si le calcul des lignes 8 bits se fait en virgule fixe
+     * \details C'est le cas lorsque les canaux de l'image source sont des entiers 8 bits et que les masques n'interviennent pas dans l'interpolation.
+     * \~english \brief Precise if 8-bit lines are computed in fixed point
+     * \details It's the case when source image's channels are 8-bit integers and masks are not used by interpolation.
+     */
+    bool fixedPoint;
+
+    /**
+     * \~french \brief Buffer général du calcul en virgule fixe
+     * \~english \brief Fixed point calculation global buffer
+     */
+    uint8_t* __fixed_buffer;
+
+    /**
+     * \~french \brief Ligne de l'image source, entière sur 8 bits, complétée par #Kx pixels nuls
+     * \~english \brief Source image's line, 8-bit integer, padded with #Kx null pixels
+     */
+    uint8_t* fixed_src_line;
+
+    /**
+     * \~french \brief Poids de réechantillonnage en virgule fixe, pour le sens des X
+     * \details #Kx poids par pixel de destination, de somme 1 << FIXED_WEIGHT_BITS.
+     * \~english \brief Widthwise fixed point resampling weights
+     * \details #Kx weights per destination pixel, summing to 1 << FIXED_WEIGHT_BITS.
+     */
+    int16_t* fixedWx;
+
+    /**
+     * \~french \brief Buffer de mémorisation des lignes réechantillonnées en X, en virgule fixe
+     * \details #memorizedLines lignes de width*channels valeurs, avec FIXED_LINE_BITS bits de partie décimale.
+     * \~english \brief Buffer to memorize widthwise resampled lines, in fixed point
+     * \details #memorizedLines lines of width*channels values, with FIXED_LINE_BITS fractional bits.
+     */
+    int16_t* fixed_resampled_image;
+
+    /**
+     * \~french \brief Indexation des lignes mémorisées en virgule fixe
+     * \~english \brief Fixed point memorized lines indexing
+     */
+    int* fixed_line_index;
+
+    /**
+     * \~french \brief Accumulateur 32 bits de l'interpolation dans le sens des Y
+     * \~english \brief 32-bit accumulator for heightwise interpolation
+     */
+    int32_t* fixed_accumulator;
+
     /** \~french
      * \brief Retourne une ligne source réechantillonnée en X, entière
      * \details Lorsqu'une demande une ligne de l'image réechantillonnée, le calcul va être divisé en deux parties :
@@ -264,6 +326,38 @@ private:
      */
     int resampleSourceLine ( int line );
 
+    /** \~french
+     * \brief Retourne une ligne source réechantillonnée en X, en virgule fixe
+     * \details Équivalent entier de #resampleSourceLine : la ligne source est lue sur 8 bits et une seule ligne est calculée à la fois.
+     * \param[in] line Indice de la ligne source à réechantillonner (0 <= line < source_image.height)
+     * \return ligne mémorisée dans #fixed_resampled_image
+     ** \~english
+     * \brief Return a widthwise resampled source line, in fixed point
+     * \details Integer equivalent of #resampleSourceLine : source line is read as 8-bit integers and only one line is calculated at once.
+     * \param[in] line Source line indice (0 <= line < source_image.height)
+     * \return line memorized in #fixed_resampled_image
+     */
+    const int16_t* resampleSourceLineFixed ( int line );
+
+    /** \~french
+     * \brief Calcule une ligne entièrement réechantillonnée en virgule fixe, dans #fixed_accumulator
+     * \param[in] line Indice de la ligne à calculer (0 <= line < height)
+     * \return faux si la requête a été annulée et que la ligne n'a pas été calculée
+     ** \~english
+     * \brief Calculate a fully resampled line in fixed point, into #fixed_accumulator
+     * \param[in] line Line indice (0 <= line < height)
+     * \return false if request has been cancelled and line has not been calculated
+     */
+    bool computeFixedLine ( int line );
+
+    /** \~french
+     * \brief Constitue un bloc à partir des lignes flottantes, dont on ne convertit que les colonnes demandées
+     ** \~english
+     * \brief Build a block from float lines, converting only asked columns
+     */
+    template<typename T>
+    int getBlockFromFloatLines ( int x, int y, int w, int h, T* buffer, int stride );
+
 public:
     /** \~french
      * \brief Retourne une ligne entièrement réechantillonnée, flottante
@@ -279,7 +373,7 @@ public:
 
     /** \~french
      * \brief Retourne une ligne entièrement réechantillonnée, entière sur 8 bits
-     * \details Elle ne fait que convertir le résultat du #getline flottant en entier. On ne travaille en effet que sur des flottants, même si les canaux des images sont des entiers, et cela car les poids de l'interpolation sont toujours flottants.
+     * \details Si l'image source est entière sur 8 bits (et sans utilisation des masques), le calcul est fait en virgule fixe : poids sur 16 bits, accumulation sur 32 bits. Sinon, elle ne fait que convertir le résultat du #getline flottant en entier.
      * \param[in,out] buffer Tableau contenant au moins width*channels valeurs
      * \param[in] line Indice de la ligne à retourner (0 <= line < height)
      * \return taille utile du buffer, 0 si erreur
@@ -295,6 +389,26 @@ public:
      */
     int getline ( uint16_t* buffer, int line );
 
+    /** \~french
+     * \brief Retourne un bloc réechantillonné
+     * \details Les lignes sont calculées entièrement (elles s'appuient sur les lignes sources réechantillonnées en X et mémorisées), mais seules les colonnes demandées sont converties, directement dans le buffer de sortie.
+     ** \~english
+     * \brief Return a resampled block
+     * \details Lines are fully calculated (they rely on widthwise resampled and memorized source lines), but only asked columns are converted, directly into the output buffer.
+     */
+    int getBlock ( int x, int y, int w, int h, uint8_t* buffer, int stride );
+    int getBlock ( int x, int y, int w, int h, uint16_t* buffer, int stride );
+    int getBlock ( int x, int y, int w, int h, float* buffer, int stride );
+
+    /** \~french
+     * \brief Retourne la couverture des lignes, déduite de celle des lignes sources utilisées par l'interpolation
+     * \details Utile lorsque l'image réechantillonnée est un masque.
+     ** \~english
+     * \brief Return lines' coverage, deduced from the source lines used by interpolation
+     * \details Useful when the resampled image is a mask.
+     */
+    MaskCoverage::eMaskCoverage getCoverage ( int firstLine, int lastLine );
+
     /** \~french
      * \brief Crée un objet ResampledImage à partir de tous ses éléments constitutifs
      * \param[in] image image source
@@ -305,6 +419,7 @@ public:
      * \param[in] bbox emprise rectangulaire de l'image
      * \param[in] bUseMask précise si le réechantillonnage doit tenir compte des masques
      * \param[in] KT noyau d'interpolation à utiliser pour le réechantillonnage
+     * \param[in] integerSource précise si les canaux de l'image source sont des entiers sur 8 bits, ce qui permet le calcul en virgule fixe
      ** \~english
      * \brief Create a ResampledImage object, from all attributes
      * \param[in] image source image
@@ -315,9 +430,10 @@ public:
      * \param[in] bbox bounding box
      * \param[in] bUseMask precise if resampling use masks
      * \param[in] KT interpolation kernel to use for resampling
+     * \param[in] integerSource precise if source image's channels are 8-bit integers, allowing fixed point calculation
      */
     ResampledImage ( Image *image, int width, int height, double resx, double resy, BoundingBox<double> bbox,
-                     Interpolation::KernelType KT = Interpolation::LANCZOS_3, bool bMask = false );
+                     Interpolation::KernelType KT = Interpolation::LANCZOS_3, bool bMask = false, bool integerSource = false );
 
     /**
      * \~french \brief Destructeur par défaut
@@ -337,10 +453,12 @@ public:
      * And remove #source_image
      */
     ~ResampledImage() {
-        _mm_free ( __buffer );
-        delete[] resampled_line_index;
-        delete[] resampled_image;
-        if ( useMask ) delete[] resampled_mask;
+        MemoryArena::release ( __buffer );
+        MemoryArena::release ( resampled_line_index );
+        MemoryArena::release ( resampled_image );
+        if ( useMask ) MemoryArena::release ( resampled_mask );
+        if ( useMask ) MemoryArena::release ( resampled_coverage );
+        if ( fixedPoint ) MemoryArena::release ( __fixed_buffer );
         if ( ! isMask ) {
             delete sourceImage;
         }
@@ -362,6 +480,9 @@ public:
         } else {
             LOGGER_INFO ( "\t- Doesn't use mask in interpolation" );
         }
+        if ( fixedPoint ) {
+            LOGGER_INFO ( "\t- 8-bit lines computed in fixed point" );
+        }
         LOGGER_INFO ( "" );
     }
 };
@@ -57,9 +57,15 @@
 #include "Decoder.h"
 #include "Logger.h"
 #include "Utils.h"
+#include "Zstd_library_config.h"
 #include <iostream>
+#include <fstream>
 #include <algorithm>
 
+#ifdef ZSTD_USE
+#include <zstd.h>
+#endif
+
 /* ------------------------------------------------------------------------------------------------ */
 /* ------------------------- Fonctions pour le manager de sortie de la libjpeg -------------------- */
 
@@ -178,6 +184,8 @@ static Compression::eCompression toROK4Compression ( uint16_t comp ) {
         return Compression::LZW;
     case COMPRESSION_PACKBITS :
         return Compression::PACKBITS;
+    case COMPRESSION_ZSTD :
+        return Compression::ZSTD;
     default :
         return Compression::UNKNOWN;
     }
@@ -197,11 +205,40 @@ static uint16_t fromROK4Compression ( Compression::eCompression comp ) {
         return COMPRESSION_LZW;
     case Compression::PACKBITS :
         return COMPRESSION_PACKBITS;
+    case Compression::ZSTD :
+        return COMPRESSION_ZSTD;
     default :
         return 0;
     }
 }
 
+/**
+ * \~french \brief Lit la valeur du tag PREDICTOR dans l'IFD courant, sans passer par la libtiff
+ * \return le prédicteur, PREDICTOR_NONE si le tag est absent ou illisible
+ * \~english \brief Read the PREDICTOR tag value in the current IFD, without libtiff
+ * \return the predictor, PREDICTOR_NONE if the tag is missing or unreadable
+ */
+static uint16_t readPredictorTag ( TIFF* tif, char* filename ) {
+    std::ifstream file ( filename, std::ios::binary );
+    file.seekg ( TIFFCurrentDirOffset ( tif ) );
+    uint16_t count = 0;
+    file.read ( ( char* ) &count, 2 );
+    if ( TIFFIsByteSwapped ( tif ) ) TIFFSwabShort ( &count );
+
+    for ( int i = 0; i < count && file.good(); i++ ) {
+        uint8_t entry[12];
+        file.read ( ( char* ) entry, 12 );
+        uint16_t tag = * ( ( uint16_t* ) entry );
+        uint16_t value = * ( ( uint16_t* ) ( entry + 8 ) );
+        if ( TIFFIsByteSwapped ( tif ) ) {
+            TIFFSwabShort ( &tag );
+            TIFFSwabShort ( &value );
+        }
+        if ( tag == TIFFTAG_PREDICTOR ) return value;
+    }
+    return PREDICTOR_NONE;
+}
+
 static ExtraSample::eExtraSample toROK4ExtraSample ( uint16_t es ) {
     switch ( es ) {
     case EXTRASAMPLE_ASSOCALPHA :
@@ -296,6 +333,15 @@ Rok4Image* Rok4ImageFactory::createRok4ImageToRead ( char* filename, BoundingBox
         return NULL;
     }
 
+    // Le prédicteur est facultatif : par défaut, aucun
+    uint16_t pred = PREDICTOR_NONE;
+    if ( comp == COMPRESSION_ZSTD && ! TIFFIsCODECConfigured ( COMPRESSION_ZSTD ) ) {
+        // Sans le codec zstd, la libtiff ne connaît pas le tag PREDICTOR : on le lit directement dans l'IFD
+        pred = readPredictorTag ( tif, filename );
+    } else {
+        TIFFGetField ( tif, TIFFTAG_PREDICTOR, &pred );
+    }
+
     
     ExtraSample::eExtraSample es = ExtraSample::UNKNOWN;
     uint16_t extrasamplesCount;
@@ -332,11 +378,19 @@ Rok4Image* Rok4ImageFactory::createRok4ImageToRead ( char* filename, BoundingBox
         }
     }
 
-    return new Rok4Image (
+    Rok4Image* rok4image = new Rok4Image (
         width, height, resx, resy, channels, bbox, filename,
         toROK4SampleFormat( sf ), bitspersample, toROK4Photometric ( ph ), toROK4Compression ( comp ), es,
         tileWidth, tileHeight
     );
+
+    if ( ! rok4image->setPredictor ( static_cast<Predictor::ePredictor> ( pred ) ) ) {
+        LOGGER_ERROR ( "Not supported predictor " << pred << " for the image to read : " << filename );
+        delete rok4image;
+        return NULL;
+    }
+
+    return rok4image;
 }
 
 Rok4Image* Rok4ImageFactory::createRok4ImageToWrite (
@@ -349,6 +403,11 @@ Rok4Image* Rok4ImageFactory::createRok4ImageToWrite (
         return NULL;
     }
 
+    if ( ! Compression::isAvailable ( compression ) ) {
+        LOGGER_ERROR ( "Compression " << Compression::toString ( compression ) << " is not available in this build" );
+        return NULL;
+    }
+
     if (compression == Compression::JPEG) {
         if (photometric == Photometric::GRAY) {
             LOGGER_ERROR("Gray JPEG is not handled");
@@ -407,7 +466,9 @@ Rok4Image::Rok4Image (
     Compression::eCompression compression, ExtraSample::eExtraSample es, int tileWidth, int tileHeight ) :
 
     FileImage ( width, height, resx, resy, channels, bbox, name, sampleformat, bitspersample, photometric, compression, es ), 
-    tileWidth (tileWidth), tileHeight(tileHeight)
+    tileWidth (tileWidth), tileHeight(tileHeight), zstdContext ( NULL ), zstdLevel ( ZSTD_DEFAULT_LEVEL ),
+    profile ( EncoderProfile::getDefault() ), predictor ( Predictor::NONE ), constantTiles ( false ),
+    deduplicateTiles ( false ), writtenTilesSize ( 0 )
 {
     tileWidthwise = width/tileWidth;
     tileHeightwise = height/tileHeight;
@@ -428,6 +489,33 @@ Rok4Image::Rok4Image (
     memset ( memorizedIndex, -1, memorySize*sizeof ( int ) );
 }
 
+bool Rok4Image::setPredictor ( Predictor::ePredictor pred ) {
+    if ( pred == Predictor::NONE ) {
+        predictor = pred;
+        return true;
+    }
+    if ( compression != Compression::LZW && compression != Compression::DEFLATE && compression != Compression::ZSTD ) {
+        LOGGER_ERROR ( "Predictor " << Predictor::toString ( pred ) << " is only handled with LZW, DEFLATE and ZSTD compressions" );
+        return false;
+    }
+    if ( ! Predictor::isCompatible ( pred, sampleformat, bitspersample ) ) {
+        LOGGER_ERROR ( "Predictor " << Predictor::toString ( pred ) << " is not compatible with " << bitspersample << "-bits "
+                       << SampleFormat::toString ( sampleformat ) << " samples" );
+        return false;
+    }
+    predictor = pred;
+    return true;
+}
+
+bool Rok4Image::setZstdLevel ( int level ) {
+    if ( level < 1 || level > ZSTD_MAX_LEVEL ) {
+        LOGGER_ERROR ( "ZSTD compression level " << level << " is not between 1 and " << ZSTD_MAX_LEVEL );
+        return false;
+    }
+    zstdLevel = level;
+    return true;
+}
+
 /* ------------------------------------------------------------------------------------------------ */
 /* ------------------------------------------- LECTURE -------------------------------------------- */
 /* ------------------------------------------------------------------------------------------------ */
@@ -450,6 +538,18 @@ uint8_t* Rok4Image::memorizeRawTile ( size_t& size, int tile )
 
         FileDataSource* encData = new FileDataSource(filename, ROK4_IMAGE_HEADER_SIZE + tile*4, ROK4_IMAGE_HEADER_SIZE + tilesNumber*4 + tile*4, "");
 
+        uint8_t constantValue[CONSTANT_TILE_VALUE_SIZE];
+        if ( encData->getConstantValue ( constantValue ) ) {
+            /* Tuile constante : on la reconstitue à partir de la valeur de son pixel, sans décompression */
+            if ( ! memorizedTiles[index] ) memorizedTiles[index] = new uint8_t[rawTileSize];
+            for ( int p = 0; p < tileWidth * tileHeight; p++ ) {
+                memcpy ( memorizedTiles[index] + p * pixelSize, constantValue, pixelSize );
+            }
+            memorizedIndex[index] = tile;
+            delete encData;
+            return memorizedTiles[index];
+        }
+
         DataSource* decData;
         size_t tmpSize;
 
@@ -465,6 +565,9 @@ uint8_t* Rok4Image::memorizeRawTile ( size_t& size, int tile )
         else if ( compression == Compression::PACKBITS ) {
             decData = new DataSourceDecoder<PackBitsDecoder> ( encData );
         }
+        else if ( compression == Compression::ZSTD ) {
+            decData = new DataSourceDecoder<ZstdDecoder> ( encData, rawTileSize );
+        }
         else if ( compression == Compression::DEFLATE || compression == Compression::PNG ) {
             /* Avec une telle compression dans l'en-tête TIFF, on peut avoir :
              *       - des tuiles compressée en deflate (format "officiel")
@@ -494,6 +597,9 @@ uint8_t* Rok4Image::memorizeRawTile ( size_t& size, int tile )
 
         if ( ! memorizedTiles[index] ) memorizedTiles[index] = new uint8_t[rawTileSize];
         memcpy(memorizedTiles[index], data, rawTileSize );
+        if ( predictor != Predictor::NONE ) {
+            Predictor::revert ( predictor, memorizedTiles[index], tileWidth, tileHeight, channels, bitspersample / 8 );
+        }
         memorizedIndex[index] = tile;
 
         delete decData;
@@ -618,6 +724,58 @@ int Rok4Image::getline ( float* buffer, int line ) {
     return width * channels;
 }
 
+template <typename T>
+int Rok4Image::_getBlock ( int x, int y, int w, int h, T* buffer, int stride ) {
+    if ( ! isBlockInside ( x, y, w, h ) ) return 0;
+
+    size_t tileSize;
+
+    for ( int tileRow = y / tileHeight; tileRow <= ( y + h - 1 ) / tileHeight; tileRow++ ) {
+        int y0 = __max ( y, tileRow * tileHeight );
+        int y1 = __min ( y + h, ( tileRow + 1 ) * tileHeight );
+
+        for ( int tileCol = x / tileWidth; tileCol <= ( x + w - 1 ) / tileWidth; tileCol++ ) {
+            int x0 = __max ( x, tileCol * tileWidth );
+            int x1 = __min ( x + w, ( tileCol + 1 ) * tileWidth );
+
+            uint8_t* mem = memorizeRawTile ( tileSize, tileRow * tileWidthwise + tileCol );
+            mem += ( x0 - tileCol * tileWidth ) * pixelSize;
+
+            for ( int lig = y0; lig < y1; lig++ ) {
+                memcpy ( buffer + ( lig - y ) * stride + ( x0 - x ) * channels,
+                         mem + ( lig - tileRow * tileHeight ) * rawTileLineSize, ( x1 - x0 ) * pixelSize );
+            }
+        }
+    }
+
+    return w * h * channels;
+}
+
+int Rok4Image::getBlock ( int x, int y, int w, int h, uint8_t* buffer, int stride ) {
+    if ( bitspersample == 8 && sampleformat == SampleFormat::UINT ) {
+        return _getBlock ( x, y, w, h, buffer, stride );
+    }
+    LOGGER_ERROR ( "Cannot read a block of 8-bit integers from a ROK4 image with " << bitspersample << " bits per sample" );
+    return 0;
+}
+
+int Rok4Image::getBlock ( int x, int y, int w, int h, uint16_t* buffer, int stride ) {
+    if ( bitspersample == 16 && sampleformat == SampleFormat::UINT ) {
+        return _getBlock ( x, y, w, h, buffer, stride );
+    } else if ( bitspersample == 8 && sampleformat == SampleFormat::UINT ) {
+        return getBlockFromLines ( x, y, w, h, buffer, stride );
+    }
+    LOGGER_ERROR ( "Cannot read a block of 16-bit integers from a ROK4 image with " << bitspersample << " bits per sample" );
+    return 0;
+}
+
+int Rok4Image::getBlock ( int x, int y, int w, int h, float* buffer, int stride ) {
+    if ( bitspersample == 32 && sampleformat == SampleFormat::FLOAT ) {
+        return _getBlock ( x, y, w, h, buffer, stride );
+    }
+    return getBlockFromLines ( x, y, w, h, buffer, stride );
+}
+
 /* ------------------------------------------------------------------------------------------------ */
 /* ------------------------------------------- ECRITURE ------------------------------------------- */
 /* ------------------------------------------------------------------------------------------------ */
@@ -644,12 +802,10 @@ int Rok4Image::writeImage ( Image* pIn, bool crop )
         uint8_t* lines = new uint8_t[tileHeight*imageLineSize];
 
         for ( int y = 0; y < tileHeightwise; y++ ) {
-            // On récupère toutes les lignes pour cette ligne de tuiles
-            for (int lig = 0; lig < tileHeight; lig++) {
-                if (pIn->getline(lines + lig*imageLineSize, y*tileHeight + lig) == 0) {
-                    LOGGER_ERROR("Error reading the source image's line " << y*tileHeight + lig);
-                    return -1;                    
-                }
+            // On récupère d'un coup le bloc correspondant à cette ligne de tuiles
+            if (pIn->getBlock(0, y*tileHeight, width, tileHeight, lines, imageLineSize) == 0) {
+                LOGGER_ERROR("Error reading the source image's lines " << y*tileHeight << " to " << (y+1)*tileHeight - 1);
+                return -1;
             }
             for ( int x = 0; x < tileWidthwise; x++ ) {
                 // On constitue la tuile
@@ -670,12 +826,10 @@ int Rok4Image::writeImage ( Image* pIn, bool crop )
         uint16_t* lines = new uint16_t[tileHeight*imageLineSize];
         
         for ( int y = 0; y < tileHeightwise; y++ ) {
-            // On récupère toutes les lignes pour cette ligne de tuiles
-            for (int lig = 0; lig < tileHeight; lig++) {
-                if (pIn->getline(lines + lig*imageLineSize, y*tileHeight + lig) == 0) {
-                    LOGGER_ERROR("Error reading the source image's line " << y*tileHeight + lig);
-                    return -1;                    
-                }
+            // On récupère d'un coup le bloc correspondant à cette ligne de tuiles
+            if (pIn->getBlock(0, y*tileHeight, width, tileHeight, lines, imageLineSize) == 0) {
+                LOGGER_ERROR("Error reading the source image's lines " << y*tileHeight << " to " << (y+1)*tileHeight - 1);
+                return -1;
             }
             for ( int x = 0; x < tileWidthwise; x++ ) {
                 // On constitue la tuile
@@ -697,12 +851,10 @@ int Rok4Image::writeImage ( Image* pIn, bool crop )
         float* lines = new float[tileHeight*imageLineSize];
         
         for ( int y = 0; y < tileHeightwise; y++ ) {
-            // On récupère toutes les lignes pour cette ligne de tuiles
-            for (int lig = 0; lig < tileHeight; lig++) {
-                if (pIn->getline(lines + lig*imageLineSize, y*tileHeight + lig) == 0) {
-                    LOGGER_ERROR("Error reading the source image's line " << y*tileHeight + lig);
-                    return -1;                    
-                }
+            // On récupère d'un coup le bloc correspondant à cette ligne de tuiles
+            if (pIn->getBlock(0, y*tileHeight, width, tileHeight, lines, imageLineSize) == 0) {
+                LOGGER_ERROR("Error reading the source image's lines " << y*tileHeight << " to " << (y+1)*tileHeight - 1);
+                return -1;
             }
             for ( int x = 0; x < tileWidthwise; x++ ) {
                 // On constitue la tuile
@@ -742,9 +894,8 @@ bool Rok4Image::prepare()
     if ( !output ) LOGGER_ERROR("Unable to open output file " << filename);
 
     int quality = 0;
-    if ( compression == Compression::PNG) quality = 5;
-    if ( compression == Compression::DEFLATE ) quality = 6;
-    if ( compression == Compression::JPEG ) quality = 75;
+    if ( compression == Compression::PNG) quality = profile->pngLevel;
+    if ( compression == Compression::DEFLATE ) quality = profile->deflateLevel;
 
     char header[ROK4_IMAGE_HEADER_SIZE], *p = header;
     memset ( header, 0, sizeof ( header ) );
@@ -767,6 +918,7 @@ bool Rok4Image::prepare()
     * ( ( uint16_t* ) p ) = 11;
     if ( photometric == Photometric::YCBCR ) * ( ( uint16_t* ) p ) += 1;
     if ( channels == 4 || channels == 2 ) * ( ( uint16_t* ) p ) += 1;
+    if ( predictor != Predictor::NONE ) * ( ( uint16_t* ) p ) += 1;
     p += 2;
 
     //  Offset of the IFD is here
@@ -789,6 +941,9 @@ bool Rok4Image::prepare()
     writeTIFFTAG(&p, TIFFTAG_COMPRESSION, TIFF_SHORT, 1, fromROK4Compression(compression));
     writeTIFFTAG(&p, TIFFTAG_PHOTOMETRIC, TIFF_SHORT, 1, fromROK4Photometric(photometric));
     writeTIFFTAG(&p, TIFFTAG_SAMPLESPERPIXEL, TIFF_SHORT, 1, channels);
+    if ( predictor != Predictor::NONE ) {
+        writeTIFFTAG(&p, TIFFTAG_PREDICTOR, TIFF_SHORT, 1, predictor);
+    }
     writeTIFFTAG(&p, TIFFTAG_TILEWIDTH, TIFF_LONG, 1, tileWidth);
     writeTIFFTAG(&p, TIFFTAG_TILELENGTH, TIFF_LONG, 1, tileHeight);
     
@@ -836,6 +991,28 @@ bool Rok4Image::prepare()
     BufferSize = 2*rawTileSize;
     Buffer = new uint8_t[BufferSize];
 
+    // Avec un prédicteur, la tuile est prédite dans une copie avant la compression LZW ou ZSTD
+    if ( ( compression == Compression::LZW || compression == Compression::ZSTD ) && predictor != Predictor::NONE ) {
+        zip_buffer = new uint8_t[rawTileSize];
+    }
+
+    if ( compression == Compression::ZSTD ) {
+#ifdef ZSTD_USE
+        zstdContext = ZSTD_createCCtx();
+        if ( ! zstdContext ) {
+            LOGGER_ERROR ( "Unable to create the ZSTD compression context" );
+            return false;
+        }
+        // La taille de la tuile brute est écrite dans chaque trame, pour que le décodeur puisse allouer sa sortie en une fois
+        ZSTD_CCtx_setParameter ( zstdContext, ZSTD_c_compressionLevel, zstdLevel );
+        ZSTD_CCtx_setParameter ( zstdContext, ZSTD_c_contentSizeFlag, 1 );
+        ZSTD_CCtx_setParameter ( zstdContext, ZSTD_c_checksumFlag, 0 );
+#else
+        LOGGER_ERROR ( "ZSTD compression is not available (library built without ZSTD_USE)" );
+        return false;
+#endif
+    }
+
     //  z compression initalization
     if ( compression == Compression::PNG || compression == Compression::DEFLATE ) {
         if ( compression == Compression::PNG ) {
@@ -848,7 +1025,7 @@ bool Rok4Image::prepare()
         zstream.zfree  = Z_NULL;
         zstream.opaque = Z_NULL;
         zstream.data_type = Z_BINARY;
-        deflateInit ( &zstream, quality );
+        deflateInit2 ( &zstream, quality, Z_DEFLATED, 15, 8, profile->zlibStrategy );
     }
 
     if ( compression == Compression::JPEG ) {
@@ -866,7 +1043,7 @@ bool Rok4Image::prepare()
         cinfo.in_color_space = JCS_RGB;
 
         jpeg_set_defaults ( &cinfo );
-        jpeg_set_quality ( &cinfo, quality, true );
+        profile->applyJpeg ( &cinfo );
     }
 
     return true;
@@ -879,6 +1056,11 @@ bool Rok4Image::writeTile( int tileInd, uint8_t* data, bool crop )
         LOGGER_ERROR ( "Unvalid tile's indice to write (" << tileInd << "). Have to be between 0 and " << tilesNumber-1 );
         return false;
     }
+
+    if ( constantTiles && isConstantTile ( data ) ) {
+        return writeConstantTile ( tileInd, data );
+    }
+
     size_t size;
 
     switch ( compression ) {
@@ -900,13 +1082,28 @@ bool Rok4Image::writeTile( int tileInd, uint8_t* data, bool crop )
     case Compression::DEFLATE :
         size = computeDeflateTile ( Buffer, data );
         break;
+    case Compression::ZSTD :
+        size = computeZstdTile ( Buffer, data );
+        break;
+    default :
+        size = 0;
     }
 
     if ( size == 0 ) return false;
 
+    if ( deduplicateTiles ) {
+        int identical = findWrittenTile ( tileInd, size );
+        if ( identical >= 0 ) {
+            tilesOffset[tileInd] = tilesOffset[identical];
+            tilesByteCounts[tileInd] = size;
+            return true;
+        }
+    }
+
     if ( tilesNumber == 1 ) {
         // On écrit la taille de la tuile unique directemet dans l'en-tête, après le tag TIFFTAG_TILEBYTECOUNTS
-        output.seekp ( 134 );
+        // (décalé d'un tag quand le prédicteur est précisé)
+        output.seekp ( predictor != Predictor::NONE ? 146 : 134 );
         uint32_t Size[1];
         Size[0] = ( uint32_t ) size;
         output.write ( ( char* ) Size,4 );
@@ -922,7 +1119,74 @@ bool Rok4Image::writeTile( int tileInd, uint8_t* data, bool crop )
     return true;
 }
 
+bool Rok4Image::isConstantTile ( uint8_t* data ) {
+    if ( pixelSize > CONSTANT_TILE_VALUE_SIZE ) return false;
+    for ( int i = pixelSize; i < rawTileSize; i += pixelSize ) {
+        if ( memcmp ( data, data + i, pixelSize ) ) return false;
+    }
+    return true;
+}
+
+bool Rok4Image::writeConstantTile ( int tileInd, uint8_t* data ) {
+
+    std::string value ( ( char* ) data, pixelSize );
+    uint32_t valuePosition;
+
+    std::map<std::string, uint32_t>::iterator it = constantValues.find ( value );
+    if ( it != constantValues.end() ) {
+        valuePosition = it->second;
+    } else {
+        // Première tuile de cette valeur : on écrit le pixel, complété par des zéros
+        uint8_t padded[CONSTANT_TILE_VALUE_SIZE];
+        memset ( padded, 0, CONSTANT_TILE_VALUE_SIZE );
+        memcpy ( padded, data, pixelSize );
+
+        valuePosition = position;
+        output.seekp ( position );
+        output.write ( ( char* ) padded, CONSTANT_TILE_VALUE_SIZE );
+        if ( output.fail() ) return false;
+        position = ( position + CONSTANT_TILE_VALUE_SIZE + 15 ) & ~15;
+
+        constantValues.insert ( std::pair<std::string, uint32_t> ( value, valuePosition ) );
+    }
+
+    if ( tilesNumber == 1 ) {
+        output.seekp ( predictor != Predictor::NONE ? 146 : 134 );
+        uint32_t Size[1];
+        Size[0] = 0;
+        output.write ( ( char* ) Size,4 );
+    }
+
+    tilesOffset[tileInd] = valuePosition;
+    tilesByteCounts[tileInd] = 0;
+
+    return true;
+}
+
+int Rok4Image::findWrittenTile ( int tileInd, size_t size ) {
+    uint32_t crc = crc32 ( 0, Z_NULL, 0 );
+    crc = crc32 ( crc, Buffer, size );
+
+    std::pair<std::multimap<uint32_t, std::pair<int, std::string> >::iterator,
+        std::multimap<uint32_t, std::pair<int, std::string> >::iterator> range = writtenTiles.equal_range ( crc );
+    for ( std::multimap<uint32_t, std::pair<int, std::string> >::iterator it = range.first; it != range.second; it++ ) {
+        if ( it->second.second.size() == size && ! memcmp ( it->second.second.data(), Buffer, size ) ) {
+            return it->second.first;
+        }
+    }
+
+    if ( writtenTilesSize + size <= DEDUPLICATION_MEMORY_SIZE ) {
+        writtenTiles.insert ( std::make_pair ( crc, std::make_pair ( tileInd, std::string ( ( char* ) Buffer, size ) ) ) );
+        writtenTilesSize += size;
+    }
+
+    return -1;
+}
+
 bool Rok4Image::close() {
+    constantValues.clear();
+    writtenTiles.clear();
+    writtenTilesSize = 0;
     output.seekp ( ROK4_IMAGE_HEADER_SIZE );
     output.write ( ( char* ) tilesOffset, 4 * tilesNumber );
     output.write ( ( char* ) tilesByteCounts, 4 * tilesNumber );
@@ -933,6 +1197,15 @@ bool Rok4Image::close() {
     delete[] tilesOffset;
     delete[] tilesByteCounts;
     delete[] Buffer;
+    if ( ( compression == Compression::LZW || compression == Compression::ZSTD ) && predictor != Predictor::NONE ) {
+        delete[] zip_buffer;
+    }
+#ifdef ZSTD_USE
+    if ( compression == Compression::ZSTD ) {
+        ZSTD_freeCCtx ( zstdContext );
+        zstdContext = NULL;
+    }
+#endif
     if ( compression == Compression::PNG || compression == Compression::DEFLATE ) {
         delete[] zip_buffer;
         deflateEnd ( &zstream );
@@ -955,6 +1228,12 @@ size_t Rok4Image::computeLzwTile ( uint8_t *buffer, uint8_t *data ) {
 
     size_t outSize;
 
+    if ( predictor != Predictor::NONE ) {
+        memcpy ( zip_buffer, data, rawTileSize );
+        Predictor::apply ( predictor, zip_buffer, tileWidth, tileHeight, channels, bitspersample / 8 );
+        data = zip_buffer;
+    }
+
     lzwEncoder LZWE;
     uint8_t* temp = LZWE.encode ( data, rawTileSize, outSize );
 
@@ -996,8 +1275,14 @@ size_t Rok4Image::computePackbitsTile ( uint8_t *buffer, uint8_t *data ) {
 size_t Rok4Image::computePngTile ( uint8_t *buffer, uint8_t *data ) {
     uint8_t *B = zip_buffer;
     for ( unsigned int h = 0; h < tileHeight; h++ ) {
-        *B++ = 0; // on met un 0 devant chaque ligne (spec png -> mode de filtrage simple)
-        memcpy ( B, data + h*rawTileLineSize, rawTileLineSize );
+        if ( profile->pngFilter == PngFilter::NONE ) {
+            *B++ = 0; // on met un 0 devant chaque ligne (spec png -> mode de filtrage simple)
+            memcpy ( B, data + h*rawTileLineSize, rawTileLineSize );
+        } else {
+            // l'octet de filtre est écrit devant la ligne filtrée
+            PngFilter::apply ( profile->pngFilter, data + h*rawTileLineSize, h ? data + ( h-1 ) *rawTileLineSize : NULL, rawTileLineSize, pixelSize, B );
+            B++;
+        }
         B += rawTileLineSize;
     }
 
@@ -1044,6 +1329,9 @@ size_t Rok4Image::computeDeflateTile ( uint8_t *buffer, uint8_t *data ) {
         memcpy ( B, data + h*rawTileLineSize, rawTileLineSize );
         B += rawTileLineSize;
     }
+    if ( predictor != Predictor::NONE ) {
+        Predictor::apply ( predictor, zip_buffer, tileWidth, tileHeight, channels, bitspersample / 8 );
+    }
     zstream.next_out  = buffer;
     zstream.avail_out = 2*rawTileSize;
     zstream.next_in   = zip_buffer;
@@ -1055,6 +1343,25 @@ size_t Rok4Image::computeDeflateTile ( uint8_t *buffer, uint8_t *data ) {
     return zstream.total_out;
 }
 
+size_t Rok4Image::computeZstdTile ( uint8_t *buffer, uint8_t *data ) {
+#ifdef ZSTD_USE
+    if ( predictor != Predictor::NONE ) {
+        memcpy ( zip_buffer, data, rawTileSize );
+        Predictor::apply ( predictor, zip_buffer, tileWidth, tileHeight, channels, bitspersample / 8 );
+        data = zip_buffer;
+    }
+
+    size_t size = ZSTD_compress2 ( zstdContext, buffer, BufferSize, data, rawTileSize );
+    if ( ZSTD_isError ( size ) ) {
+        LOGGER_ERROR ( "ZSTD compression failed : " << ZSTD_getErrorName ( size ) );
+        return 0;
+    }
+    return size;
+#else
+    return 0;
+#endif
+}
+
 
 size_t Rok4Image::computeJpegTile ( uint8_t *buffer, uint8_t *data, bool crop ) {
 
@@ -59,9 +59,17 @@
 #include "zlib.h"
 #include <jpeglib.h>
 #include "FileImage.h"
+#include "EncoderProfile.h"
+#include "Predictor.h"
+#include <map>
 
 #define ROK4_IMAGE_HEADER_SIZE 2048
 #define JPEG_BLOC_SIZE 16
+#define ZSTD_DEFAULT_LEVEL 3
+#define ZSTD_MAX_LEVEL 22
+#define DEDUPLICATION_MEMORY_SIZE 67108864 // en octets, tuiles encodées mémorisées pour la déduplication
+
+struct ZSTD_CCtx_s;
 
 /**
  * \author Institut national de l'information géographique et forestière
@@ -211,6 +219,17 @@ private:
      * \~english \brief Stream used by zlib
      */
     z_stream zstream;
+    /**
+     * \~french \brief Contexte de compression zstd
+     * \details Pour la compression ZSTD uniquement
+     * \~english \brief zstd compression context
+     */
+    struct ZSTD_CCtx_s* zstdContext;
+    /**
+     * \~french \brief Niveau de compression zstd, de 1 à ZSTD_MAX_LEVEL
+     * \~english \brief zstd compression level, from 1 to ZSTD_MAX_LEVEL
+     */
+    int zstdLevel;
     
     /**
      * \~french \brief Structure d'informations, utilisée par la libjpeg
@@ -224,6 +243,43 @@ private:
      * \~english \brief Error structure used by libjpeg
      */
     struct jpeg_error_mgr jerr;
+    /**
+     * \~french \brief Réglages de compression PNG, DEFLATE et JPEG
+     * \~english \brief PNG, DEFLATE and JPEG compression settings
+     */
+    const EncoderProfile* profile;
+    /**
+     * \~french \brief Prédicteur TIFF appliqué aux tuiles avant une compression LZW, DEFLATE ou ZSTD
+     * \~english \brief TIFF predictor applied to tiles before a LZW, DEFLATE or ZSTD compression
+     */
+    Predictor::ePredictor predictor;
+    /**
+     * \~french \brief Les tuiles uniformes sont-elles indexées comme tuiles constantes
+     * \details Une tuile constante n'est pas écrite : son index pointe vers la valeur de son pixel et sa taille vaut 0.
+     * \~english \brief Are uniform tiles indexed as constant tiles
+     * \details A constant tile is not written : its index points to its pixel value and its size is 0.
+     */
+    bool constantTiles;
+    /**
+     * \~french \brief Position dans le fichier de chaque valeur de tuile constante déjà écrite
+     * \~english \brief File position of each already written constant tile value
+     */
+    std::map<std::string, uint32_t> constantValues;
+    /**
+     * \~french \brief Les tuiles encodées identiques à une tuile déjà écrite pointent-elles vers celle-ci
+     * \~english \brief Do encoded tiles identical to an already written tile point to it
+     */
+    bool deduplicateTiles;
+    /**
+     * \~french \brief Tuiles déjà écrites (indice et contenu encodé), indexées par l'empreinte CRC32 de leur contenu
+     * \~english \brief Already written tiles (indice and encoded content), indexed by their content CRC32 checksum
+     */
+    std::multimap<uint32_t, std::pair<int, std::string> > writtenTiles;
+    /**
+     * \~french \brief Taille cumulée des contenus de #writtenTiles, limitée à DEDUPLICATION_MEMORY_SIZE
+     * \~english \brief Cumulated size of #writtenTiles contents, limited to DEDUPLICATION_MEMORY_SIZE
+     */
+    size_t writtenTilesSize;
 
     /**
      * \~french \brief Écrit l'en-tête TIFF de l'image ROK4
@@ -247,6 +303,39 @@ private:
      * \return TRUE if success, FALSE otherwise
      */
     bool writeTile ( int tileInd, uint8_t *data, bool crop = false );
+    /**
+     * \~french \brief Teste si tous les pixels d'une tuile brute sont identiques
+     * \param[in] data données brutes (sans compression) de la tuile
+     * \~english \brief Test if all pixels of a raw tile are the same
+     * \param[in] data raw data (no compression) of the tile
+     */
+    bool isConstantTile ( uint8_t *data );
+    /**
+     * \~french \brief Indexe une tuile uniforme comme tuile constante
+     * \details La valeur du pixel n'est écrite qu'une fois par image, complétée à CONSTANT_TILE_VALUE_SIZE octets.
+     * \param[in] tileInd indice de la tuile
+     * \param[in] data données brutes (sans compression) de la tuile
+     * \return VRAI en cas de succès, FAUX sinon
+     * \~english \brief Index an uniform tile as a constant tile
+     * \details The pixel value is written once per image, padded to CONSTANT_TILE_VALUE_SIZE bytes.
+     * \param[in] tileInd tile indice
+     * \param[in] data raw data (no compression) of the tile
+     * \return TRUE if success, FALSE otherwise
+     */
+    bool writeConstantTile ( int tileInd, uint8_t *data );
+    /**
+     * \~french \brief Cherche une tuile déjà écrite de même contenu encodé
+     * \details La tuile est mémorisée si elle n'a pas d'équivalent et que la limite DEDUPLICATION_MEMORY_SIZE le permet.
+     * \param[in] tileInd indice de la tuile à écrire
+     * \param[in] size taille de la tuile encodée, dans #Buffer
+     * \return l'indice de la tuile identique, -1 si aucune
+     * \~english \brief Look for an already written tile with the same encoded content
+     * \details The tile is memorized if it has no equivalent and the DEDUPLICATION_MEMORY_SIZE limit allows it.
+     * \param[in] tileInd indice of the tile to write
+     * \param[in] size encoded tile size, in #Buffer
+     * \return the identical tile indice, -1 if none
+     */
+    int findWrittenTile ( int tileInd, size_t size );
     /**
      * \~french \brief Finalise l'écriture de l'image ROK4
      * \details Cela comprend l'écriture des index et tailles des tuiles, ainsi que le nettoyage des buffers utilisés
@@ -349,10 +438,26 @@ private:
      * \return data' size in buffer, 0 if failure
      */
     size_t computeDeflateTile ( uint8_t *buffer, uint8_t *data );
+    /**
+     * \~french \brief Compresse les données brutes en ZSTD
+     * \details Utilise la libzstd, la taille des données brutes est écrite dans la trame.
+     * \param[out] buffer buffer de stockage des données compressées. Doit être alloué.
+     * \param[in] data données brutes (sans compression) à compresser
+     * \return taille utile du buffer, 0 si erreur
+     * \~english \brief Compress raw data into ZSTD compression
+     * \details Use libzstd, raw data size is written in the frame.
+     * \param[out] buffer Storage buffer for compressed data. Have to be allocated.
+     * \param[in] data raw data (no compression) to write
+     * \return data' size in buffer, 0 if failure
+     */
+    size_t computeZstdTile ( uint8_t *buffer, uint8_t *data );
     
     template<typename T>
     int _getline ( T* buffer, int line );
 
+    template<typename T>
+    int _getBlock ( int x, int y, int w, int h, T* buffer, int stride );
+
 protected:
     /** \~french
      * \brief Crée un objet Rok4Image à partir de tous ses éléments constitutifs
@@ -459,6 +564,16 @@ public:
     int getline ( uint16_t* buffer, int line );
     int getline ( float* buffer, int line );
 
+    /**
+     * \~french \brief Retourne un bloc, copié directement depuis les tuiles décompressées
+     * \details Seules les tuiles recoupant le bloc sont lues. Si le type demandé n'est pas celui des canaux de l'image, on passe par les lignes converties.
+     * \~english \brief Return a block, directly copied from decompressed tiles
+     * \details Only tiles intersecting the block are read. If asked type is not the samples' one, we use converted lines.
+     */
+    int getBlock ( int x, int y, int w, int h, uint8_t* buffer, int stride );
+    int getBlock ( int x, int y, int w, int h, uint16_t* buffer, int stride );
+    int getBlock ( int x, int y, int w, int h, float* buffer, int stride );
+
     /**************************** Pour l'écriture ****************************/
 
     /**
@@ -470,6 +585,85 @@ public:
      */
     int writeImage ( Image* pIn );
 
+    /**
+     * \~french
+     * \brief Définit les réglages de compression des tuiles, à appeler avant l'écriture
+     * \param[in] encoderProfile réglages de compression, le profil par défaut si NULL
+     * \~english
+     * \brief Define the tiles compression settings, to call before writing
+     * \param[in] encoderProfile compression settings, the default profile if NULL
+     */
+    void setEncoderProfile ( const EncoderProfile* encoderProfile ) {
+        profile = encoderProfile ? encoderProfile : EncoderProfile::getDefault();
+    }
+
+    /**
+     * \~french
+     * \brief Définit le prédicteur TIFF des tuiles, à appeler avant l'écriture
+     * \details Un prédicteur autre que NONE n'est possible qu'avec les compressions LZW, DEFLATE et ZSTD, HORIZONTAL pour
+     * des entiers et FLOATINGPOINT pour des flottants.
+     * \return FAUX si le prédicteur n'est pas compatible avec l'image
+     * \~english
+     * \brief Define the tiles TIFF predictor, to call before writing
+     * \details A predictor other than NONE is only possible with LZW, DEFLATE and ZSTD compressions, HORIZONTAL for
+     * integers and FLOATINGPOINT for floats.
+     * \return FALSE if the predictor is not compatible with the image
+     */
+    bool setPredictor ( Predictor::ePredictor pred );
+
+    Predictor::ePredictor getPredictor() {
+        return predictor;
+    }
+
+    /**
+     * \~french
+     * \brief Définit le niveau de compression ZSTD des tuiles, à appeler avant l'écriture
+     * \return FAUX si le niveau n'est pas entre 1 et ZSTD_MAX_LEVEL
+     * \~english
+     * \brief Define the tiles ZSTD compression level, to call before writing
+     * \return FALSE if the level is not between 1 and ZSTD_MAX_LEVEL
+     */
+    bool setZstdLevel ( int level );
+
+    int getZstdLevel() {
+        return zstdLevel;
+    }
+
+    /**
+     * \~french
+     * \brief Active l'indexation des tuiles uniformes comme tuiles constantes, à appeler avant l'écriture
+     * \details Une tuile constante a une taille nulle dans l'index : les lecteurs TIFF autres que ROK4 la voient comme
+     * une tuile absente.
+     * \~english
+     * \brief Enable uniform tiles indexing as constant tiles, to call before writing
+     * \details A constant tile has a null size in the index : TIFF readers other than ROK4 see it as a missing tile.
+     */
+    void setConstantTiles ( bool constant ) {
+        constantTiles = constant;
+    }
+
+    bool getConstantTiles() {
+        return constantTiles;
+    }
+
+    /**
+     * \~french
+     * \brief Active la déduplication des tuiles, à appeler avant l'écriture
+     * \details Une tuile dont le contenu encodé est identique à celui d'une tuile déjà écrite n'est pas écrite à nouveau :
+     * son index pointe vers la première occurrence.
+     * \~english
+     * \brief Enable tiles deduplication, to call before writing
+     * \details A tile whose encoded content is identical to an already written tile's one is not written again : its
+     * index points to the first occurrence.
+     */
+    void setDeduplicateTiles ( bool deduplicate ) {
+        deduplicateTiles = deduplicate;
+    }
+
+    bool getDeduplicateTiles() {
+        return deduplicateTiles;
+    }
+
     /**
      * \~french
      * \brief Ecrit une image ROK4, à partir d'une image source
@@ -0,0 +1,108 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file SlabStorage.cpp
+ * \~french
+ * \brief Implémentation des classes SlabStorage et SlabObject, et du stockage POSIX
+ * \~english
+ * \brief Implement classes SlabStorage and SlabObject, and the POSIX storage
+ */
+
+#include "SlabStorage.h"
+#include "MemoryArena.h"
+#include "Logger.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+bool SlabObject::readIndex ( uint32_t posoff, uint32_t possize, uint32_t& tilePos, uint32_t& tileSize ) {
+    // Ne lire que 4 octets (la taille de tile_size est plateforme-dependante)
+    return read ( ( uint8_t* ) &tilePos, sizeof ( uint32_t ), posoff ) == 4 &&
+           read ( ( uint8_t* ) &tileSize, sizeof ( uint32_t ), possize ) == 4;
+}
+
+void* SlabObject::operator new ( size_t size ) {
+    return MemoryArena::alloc ( size );
+}
+
+void SlabObject::operator delete ( void* ptr ) {
+    MemoryArena::release ( ptr );
+}
+
+/**
+ * \~french \brief Fichier ouvert, lu avec pread
+ * \~english \brief Opened file, read with pread
+ */
+class PosixSlabObject : public SlabObject {
+private:
+    int fildes;
+public:
+    PosixSlabObject ( int fildes ) : fildes ( fildes ) {}
+
+    ssize_t read ( uint8_t* buffer, size_t size, uint64_t offset ) {
+        return pread ( fildes, buffer, size, offset );
+    }
+
+    ~PosixSlabObject() {
+        close ( fildes );
+    }
+};
+
+/**
+ * \~french \brief Stockage des dalles dans le système de fichiers
+ * \~english \brief Slabs storage in the file system
+ */
+class PosixSlabStorage : public SlabStorage {
+public:
+    SlabObject* open ( const std::string& name ) {
+        int fildes = ::open ( name.c_str(), O_RDONLY );
+        if ( fildes < 0 ) {
+            LOGGER_DEBUG ( "Can't open file " << name );
+            return NULL;
+        }
+        return new PosixSlabObject ( fildes );
+    }
+
+    std::string getType() {
+        return "FILE";
+    }
+};
+
+SlabStorage* SlabStorage::getPosix() {
+    static PosixSlabStorage posix;
+    return &posix;
+}
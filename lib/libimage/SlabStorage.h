@@ -0,0 +1,163 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file SlabStorage.h
+ * \~french
+ * \brief Définition des classes SlabStorage et SlabObject, accès aux dalles selon leur stockage
+ * \~english
+ * \brief Define classes SlabStorage and SlabObject, slabs access according to their storage
+ */
+
+#ifndef SLAB_STORAGE_H
+#define SLAB_STORAGE_H
+
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Dalle ouverte, lue par plages d'octets
+ * \~english
+ * \brief Opened slab, read by bytes ranges
+ */
+class SlabObject {
+public:
+    /**
+     * \~french \brief Lit size octets à partir de la position offset
+     * \return nombre d'octets lus, négatif en cas d'erreur
+     * \~english \brief Read size bytes from the offset position
+     * \return read bytes count, negative if error
+     */
+    virtual ssize_t read ( uint8_t* buffer, size_t size, uint64_t offset ) = 0;
+
+    /**
+     * \~french \brief Lit la position et la taille d'une tuile dans l'index de la dalle
+     * \details Par défaut, deux lectures de 4 octets.
+     * \param[in] posoff position de la position de la tuile dans l'index
+     * \param[in] possize position de la taille de la tuile dans l'index
+     * \~english \brief Read the position and the size of a tile in the slab index
+     * \details Two 4-byte reads by default.
+     * \param[in] posoff position of the tile position in the index
+     * \param[in] possize position of the tile size in the index
+     */
+    virtual bool readIndex ( uint32_t posoff, uint32_t possize, uint32_t& tilePos, uint32_t& tileSize );
+
+    /**
+     * \~french \brief Indique si la dernière lecture a échoué parce que la dalle n'existe pas
+     * \~english \brief Tell if the last read failed because the slab does not exist
+     */
+    virtual bool isMissing() {
+        return false;
+    }
+
+    /**
+     * \~french \brief Indique si la dernière lecture a échoué parce que la dalle a changé depuis la lecture de son index
+     * \details L'index doit alors être relu.
+     * \~english \brief Tell if the last read failed because the slab changed since its index was read
+     * \details The index has then to be read again.
+     */
+    virtual bool isStale() {
+        return false;
+    }
+
+    /**
+     * \~french \brief Version de la dalle dont l'index a été lu (ETag pour un stockage objet), vide si inconnue
+     * \~english \brief Version of the slab whose index was read (ETag for an object storage), empty if unknown
+     */
+    virtual std::string getVersion() {
+        return "";
+    }
+
+    /**
+     * \~french \brief Précise la version de la dalle attendue par les lectures suivantes, lorsque l'index n'est pas relu à la réouverture
+     * \~english \brief Set the slab version expected by following reads, when the index is not read again at reopening
+     */
+    virtual void setVersion ( const std::string& version ) {}
+
+    /**
+     * \~french \brief Accès direct, sans copie, à size octets à partir de la position offset
+     * \details Le pointeur reste valide tant que la dalle est ouverte.
+     * \return NULL si la dalle n'est pas projetée en mémoire (par défaut) ou si la plage la dépasse
+     * \~english \brief Direct access, without copy, to size bytes from the offset position
+     * \details The pointer is valid as long as the slab is opened.
+     * \return NULL if the slab is not mapped in memory (default) or if the range exceeds it
+     */
+    virtual const uint8_t* map ( size_t size, uint64_t offset ) {
+        return NULL;
+    }
+
+    virtual ~SlabObject() {}
+
+    // Allocation dans l'arène de la requête en cours, s'il y en a une
+    static void* operator new ( size_t size );
+    static void operator delete ( void* ptr );
+};
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Stockage des dalles d'une pyramide
+ * \details Les dalles sont désignées par un nom : chemin de fichier pour le stockage POSIX, clé d'objet pour un stockage objet.
+ * \~english
+ * \brief Slabs storage of a pyramid
+ * \details Slabs are named : file path for the POSIX storage, object key for an object storage.
+ */
+class SlabStorage {
+public:
+    /**
+     * \~french \brief Ouvre une dalle
+     * \return la dalle ouverte, à supprimer, NULL si elle n'est pas accessible
+     * \~english \brief Open a slab
+     * \return the opened slab, to delete, NULL if not reachable
+     */
+    virtual SlabObject* open ( const std::string& name ) = 0;
+
+    virtual std::string getType() = 0;
+
+    virtual ~SlabStorage() {}
+
+    /**
+     * \~french \brief Stockage POSIX (système de fichiers), partagé
+     * \~english \brief POSIX (file system) storage, shared
+     */
+    static SlabStorage* getPosix();
+};
+
+#endif
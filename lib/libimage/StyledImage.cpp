@@ -38,6 +38,7 @@
 #include "StyledImage.h"
 
 #include "Logger.h"
+#include "MemoryArena.h"
 
 int StyledImage::getline ( float* buffer, int line ) {
     //Styled image do not translate to float
@@ -63,15 +64,17 @@ StyledImage::StyledImage ( Image* image, int expectedChannels, Palette* palette
     } else {
         channels = image->channels;
     }
+    sourceLine = ( float* ) MemoryArena::alloc ( origImage->getWidth() * origImage->channels * sizeof ( float ) );
 }
 
 StyledImage::~StyledImage() {
+    MemoryArena::release ( sourceLine );
     delete origImage;
 }
 
 
 int StyledImage::_getline ( uint8_t* buffer, int line ) {
-    float* source = new float[origImage->getWidth() *origImage->channels];
+    float* source = sourceLine;
     origImage->getline ( source, line );
     //TODO Optimize It
     int i = 0;
@@ -93,7 +96,6 @@ int StyledImage::_getline ( uint8_t* buffer, int line ) {
         }
     }
 
-    delete[] source;
     return i*sizeof ( uint8_t ) *channels;
 
 }
@@ -48,6 +48,11 @@ private:
     Image* origImage;
     Palette* palette;
     int channels;
+    /**
+     * \~french \brief Ligne de l'image d'origine, en flottant, réutilisée à chaque ligne stylisée
+     * \~english \brief Original image line, as float, reused for each styled line
+     */
+    float* sourceLine;
     int _getline ( uint8_t* buffer, int line );
     int _getline ( uint16_t* buffer, int line );
     int _getline ( float* buffer, int line );
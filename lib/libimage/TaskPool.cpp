@@ -0,0 +1,119 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file TaskPool.cpp
+ * \~french
+ * \brief Implémentation de la classe TaskPool, ensemble de threads exécutant des tâches de calcul
+ * \~english
+ * \brief Implement the TaskPool class, set of threads running computing tasks
+ */
+
+#include "TaskPool.h"
+#include "Logger.h"
+
+TaskPool::TaskPool ( int nbThreads ) : idle ( 0 ), closed ( false ) {
+    pthread_mutex_init ( &mutex, NULL );
+    pthread_cond_init ( &notEmpty, NULL );
+    for ( int i = 0; i < nbThreads; i++ ) {
+        pthread_t thread;
+        if ( pthread_create ( &thread, NULL, TaskPool::loop, ( void* ) this ) == 0 ) {
+            threads.push_back ( thread );
+        } else {
+            LOGGER_ERROR ( "Cannot create a task pool thread" );
+        }
+    }
+}
+
+TaskPool::~TaskPool() {
+    pthread_mutex_lock ( &mutex );
+    closed = true;
+    pthread_cond_broadcast ( &notEmpty );
+    pthread_mutex_unlock ( &mutex );
+
+    for ( int i = 0; i < threads.size(); i++ ) {
+        pthread_join ( threads[i], NULL );
+    }
+
+    pthread_cond_destroy ( &notEmpty );
+    pthread_mutex_destroy ( &mutex );
+}
+
+void* TaskPool::loop ( void* arg ) {
+    TaskPool* pool = ( TaskPool* ) arg;
+
+    pthread_mutex_lock ( &pool->mutex );
+    while ( true ) {
+        while ( pool->tasks.empty() && ! pool->closed ) {
+            pool->idle++;
+            pthread_cond_wait ( &pool->notEmpty, &pool->mutex );
+            pool->idle--;
+        }
+        if ( pool->tasks.empty() ) {
+            break;
+        }
+        Task task = pool->tasks.front();
+        pool->tasks.pop_front();
+        pthread_mutex_unlock ( &pool->mutex );
+
+        task.function ( task.arg );
+
+        pthread_mutex_lock ( &pool->mutex );
+    }
+    pthread_mutex_unlock ( &pool->mutex );
+
+    Logger::stopLogger();
+    return 0;
+}
+
+void TaskPool::submit ( void* ( *function ) ( void* ), void* arg ) {
+    Task task;
+    task.function = function;
+    task.arg = arg;
+
+    pthread_mutex_lock ( &mutex );
+    tasks.push_back ( task );
+    pthread_cond_signal ( &notEmpty );
+    pthread_mutex_unlock ( &mutex );
+}
+
+int TaskPool::getAvailableThreads() {
+    pthread_mutex_lock ( &mutex );
+    int available = idle - ( int ) tasks.size();
+    pthread_mutex_unlock ( &mutex );
+    return available > 0 ? available : 0;
+}
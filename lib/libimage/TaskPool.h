@@ -0,0 +1,158 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file TaskPool.h
+ * \~french
+ * \brief Définition de la classe TaskPool, ensemble de threads exécutant des tâches de calcul
+ * \~english
+ * \brief Define the TaskPool class, set of threads running computing tasks
+ */
+
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Ensemble de threads partagés exécutant des tâches de calcul
+ * \details Les tâches sont exécutées dans l'ordre de soumission. Les threads n'ont ni arène mémoire ni jeton d'annulation : c'est à la tâche de positionner ce dont elle a besoin.
+ * \~english
+ * \brief Shared threads running computing tasks
+ * \details Tasks are run in submission order. Threads have neither memory arena nor cancellation token : the task has to set what it needs.
+ */
+class TaskPool {
+
+private:
+    /**
+     * \~french \brief Tâche en attente : fonction et argument
+     * \~english \brief Waiting task : function and argument
+     */
+    struct Task {
+        void* ( *function ) ( void* );
+        void* arg;
+    };
+
+    /**
+     * \~french \brief Tâches en attente
+     * \~english \brief Waiting tasks
+     */
+    std::deque<Task> tasks;
+    /**
+     * \~french \brief Threads de l'ensemble
+     * \~english \brief Pool's threads
+     */
+    std::vector<pthread_t> threads;
+    /**
+     * \~french \brief Nombre de threads en attente d'une tâche
+     * \~english \brief Number of threads waiting for a task
+     */
+    int idle;
+    /**
+     * \~french \brief L'ensemble est-il fermé ?
+     * \~english \brief Is the pool closed ?
+     */
+    bool closed;
+
+    /**
+     * \~french \brief Protège la file et les compteurs
+     * \~english \brief Protect the queue and the counters
+     */
+    pthread_mutex_t mutex;
+    /**
+     * \~french \brief Signale l'ajout d'une tâche ou la fermeture
+     * \~english \brief Signal a task addition or the closing
+     */
+    pthread_cond_t notEmpty;
+
+    /**
+     * \~french \brief Boucle exécutée par chaque thread
+     * \~english \brief Loop executed by each thread
+     */
+    static void* loop ( void* arg );
+
+public:
+    /**
+     * \~french
+     * \brief Constructeur, les threads sont créés immédiatement
+     * \param[in] nbThreads nombre de threads
+     * \~english
+     * \brief Constructor, threads are created at once
+     * \param[in] nbThreads number of threads
+     */
+    TaskPool ( int nbThreads );
+
+    /**
+     * \~french
+     * \brief Destructeur, les tâches en attente sont exécutées avant l'arrêt des threads
+     * \~english
+     * \brief Destructor, waiting tasks are run before threads stop
+     */
+    ~TaskPool();
+
+    /**
+     * \~french
+     * \brief Soumet une tâche
+     * \param[in] function fonction à exécuter
+     * \param[in] arg argument de la fonction, qui doit rester valide jusqu'à la fin de la tâche
+     * \~english
+     * \brief Submit a task
+     * \param[in] function function to run
+     * \param[in] arg function's argument, which has to remain valid until the task end
+     */
+    void submit ( void* ( *function ) ( void* ), void* arg );
+
+    /**
+     * \~french \brief Nombre de threads libres, déduction faite des tâches en attente
+     * \~english \brief Number of free threads, minus waiting tasks
+     */
+    int getAvailableThreads();
+
+    /**
+     * \~french \brief Nombre de threads
+     * \~english \brief Number of threads
+     */
+    int getThreads() {
+        return threads.size();
+    }
+};
+
+#endif
@@ -42,6 +42,7 @@
 #include "Image.h"
 #include "TiffHeader.h"
 #include "TiffEncoder.h"
+#include "EncoderProfile.h"
 #include <zlib.h>
 #include <iostream>
 #include <string.h> // Pour memcpy
@@ -51,6 +52,9 @@ template <typename T>
 class TiffDeflateEncoder : public TiffEncoder {
 protected:
     T* linebuffer;
+    /** Niveau et stratégie de compression zlib */
+    int level;
+    int strategy;
 
 
     z_stream zstream;
@@ -61,13 +65,18 @@ protected:
         zstream.zfree = Z_NULL;
         zstream.opaque = Z_NULL;
         zstream.data_type = Z_BINARY;
-        deflateInit ( &zstream, 6 ); // taux de compression zlib
+        deflateInit2 ( &zstream, level, Z_DEFLATED, 15, 8, strategy ); // taux de compression zlib
         zstream.avail_in = 0;
         zstream.next_out  = tmpBuffer;
         zstream.avail_out = tmpBufferSize;
 
         while ( rawLine >= 0 && rawLine < image->getHeight() && zstream.avail_out > 0 ) { // compresser les données dans des chunck idat
             if ( zstream.avail_in == 0 ) {                                    // si plus de donnée en entrée de la zlib, on lit une nouvelle ligne
+                if ( CancellationToken::currentCancelled() ) {                // requête annulée : aucune donnée n'est renvoyée
+                    deflateEnd ( &zstream );
+                    tmpBufferSize = 0;
+                    return true;
+                }
                 image->getline ( linebuffer, rawLine++ );
                 zstream.next_in  = ( uint8_t* ) ( linebuffer );
                 zstream.avail_in = image->getWidth() * image->channels * sizeof ( T );
@@ -129,6 +138,8 @@ protected:
 	    memcpy( header, TiffHeader::TIFF_HEADER_ZIP_INT8_RGB, sizeHeader);
 	else if ( image->channels==4 )
 	    memcpy( header, TiffHeader::TIFF_HEADER_ZIP_INT8_RGBA, sizeHeader);
+	if ( sizeof ( T ) == sizeof ( uint16_t ) )
+	    TiffHeader::setBitsPerSample ( header, 16 );
 	* ( ( uint32_t* ) ( header+18 ) )  = image->getWidth();
 	* ( ( uint32_t* ) ( header+30 ) )  = image->getHeight();
 	* ( ( uint32_t* ) ( header+102 ) ) = image->getHeight();
@@ -147,7 +158,10 @@ protected:
     }
 
 public:
-    TiffDeflateEncoder ( Image *image, bool isGeoTiff = false ) : TiffEncoder( image, -1, isGeoTiff ) {
+    TiffDeflateEncoder ( Image *image, bool isGeoTiff = false, const EncoderProfile* profile = NULL ) : TiffEncoder( image, -1, isGeoTiff ) {
+        if ( ! profile ) profile = EncoderProfile::getDefault();
+        level = profile->deflateLevel;
+        strategy = profile->zlibStrategy;
 //         zstream.zalloc = Z_NULL;
 //         zstream.zfree = Z_NULL;
 //         zstream.opaque = Z_NULL;
@@ -67,24 +67,37 @@ TiffEncoder::~TiffEncoder() {
       delete[] header;
 }
 
-DataStream* TiffEncoder::getTiffEncoder ( Image* image, Rok4Format::eformat_data format, bool isGeoTiff ) {
+DataStream* TiffEncoder::getTiffEncoder ( Image* image, Rok4Format::eformat_data format, bool isGeoTiff, const EncoderProfile* profile ) {
     switch ( format ) {
     case Rok4Format::TIFF_RAW_INT8 :
         return new TiffRawEncoder<uint8_t> ( image, isGeoTiff );
     case Rok4Format::TIFF_LZW_INT8 :
         return new TiffLZWEncoder<uint8_t> ( image, isGeoTiff );
     case Rok4Format::TIFF_ZIP_INT8 :
-        return new TiffDeflateEncoder<uint8_t> ( image, isGeoTiff );
+        return new TiffDeflateEncoder<uint8_t> ( image, isGeoTiff, profile );
     case Rok4Format::TIFF_PKB_INT8 :
         return new TiffPackBitsEncoder<uint8_t> ( image, isGeoTiff );
+    case Rok4Format::TIFF_RAW_UINT16 :
+        return new TiffRawEncoder<uint16_t> ( image, isGeoTiff );
+    case Rok4Format::TIFF_LZW_UINT16 :
+        return new TiffLZWEncoder<uint16_t> ( image, isGeoTiff );
+    case Rok4Format::TIFF_ZIP_UINT16 :
+        return new TiffDeflateEncoder<uint16_t> ( image, isGeoTiff, profile );
+    case Rok4Format::TIFF_PKB_UINT16 :
+        return new TiffPackBitsEncoder<uint16_t> ( image, isGeoTiff );
     case Rok4Format::TIFF_RAW_FLOAT32 :
         return new TiffRawEncoder<float> ( image, isGeoTiff );
     case Rok4Format::TIFF_LZW_FLOAT32 :
         return new TiffLZWEncoder<float> ( image, isGeoTiff );
     case Rok4Format::TIFF_ZIP_FLOAT32 :
-        return new TiffDeflateEncoder<float> ( image, isGeoTiff );
+        return new TiffDeflateEncoder<float> ( image, isGeoTiff, profile );
     case Rok4Format::TIFF_PKB_FLOAT32 :
         return new TiffPackBitsEncoder<float> ( image, isGeoTiff );
+    // Peu de clients lisent le TIFF zstd : les images calculées à partir d'une pyramide ZSTD sont envoyées en deflate
+    case Rok4Format::TIFF_ZSTD_INT8 :
+        return new TiffDeflateEncoder<uint8_t> ( image, isGeoTiff, profile );
+    case Rok4Format::TIFF_ZSTD_FLOAT32 :
+        return new TiffDeflateEncoder<float> ( image, isGeoTiff, profile );
     default:
         return NULL;
     }
@@ -41,6 +41,8 @@
 #include "Data.h"
 #include "Image.h"
 #include "Format.h"
+#include "CancellationToken.h"
+#include "EncoderProfile.h"
 
 class TiffEncoder : public DataStream {
   
@@ -63,7 +65,7 @@ public:
     TiffEncoder(Image *image, int line);
     ~TiffEncoder();
   
-    static DataStream* getTiffEncoder ( Image* image, Rok4Format::eformat_data format, bool isGeoTiff );
+    static DataStream* getTiffEncoder ( Image* image, Rok4Format::eformat_data format, bool isGeoTiff, const EncoderProfile* profile = NULL );
     static DataStream* getTiffEncoder ( Image* image, Rok4Format::eformat_data format );
 
     virtual size_t read ( uint8_t *buffer, size_t size );
@@ -351,6 +351,31 @@ static const uint8_t TIFF_HEADER_PKB_INT8_RGBA[162]  = {
     1, 0,   1, 0,   1, 0,   1, 0                   // 154| 4x 8 sur 16 bits (pointés par les samplesperpixels)
 };                                                 // 162
 
+/**
+ * \~french \brief Modifie le nombre de bits par canal d'un en-tête ci-dessus
+ * \details Les en-têtes entiers sont définis sur 8 bits : pour les entiers 16 bits, on réécrit la valeur du tag BITSPERSAMPLE (258), directement dans l'IFD pour une image à un canal, dans le bloc pointé sinon. À appeler avant tout ajout de tag qui décalerait les blocs pointés.
+ * \param[in,out] header en-tête à modifier
+ * \param[in] bits nombre de bits par canal
+ * \~english \brief Change the bits per sample of one of the headers above
+ * \param[in,out] header header to modify
+ * \param[in] bits bits per sample
+ */
+static void setBitsPerSample ( uint8_t* header, uint16_t bits ) {
+    uint32_t ifd = * ( ( uint32_t* ) ( header+4 ) );
+    uint16_t count = * ( ( uint16_t* ) ( header+ifd ) );
+    for ( size_t t = ifd + 2; t < ifd + 2 + 12 * count; t += 12 ) {
+        if ( * ( ( uint16_t* ) ( header+t ) ) != 258 ) continue;
+        uint32_t nb = * ( ( uint32_t* ) ( header+t+4 ) );
+        if ( nb == 1 ) {
+            * ( ( uint16_t* ) ( header+t+8 ) ) = bits;
+        } else {
+            uint16_t* values = ( uint16_t* ) ( header + * ( ( uint32_t* ) ( header+t+8 ) ) );
+            for ( uint32_t i = 0; i < nb; i++ ) values[i] = bits;
+        }
+        break;
+    }
+}
+
 static const uint8_t GEOTIFF_HEADER_PART[60]  = {
     // ..                                                     | TIFFTAG                    | DATA TYPE    | NUMBER | VALUE
     14,  131,   12, 0,   3, 0, 0, 0,   0, 0, 0, 0,      // 0  | ModelPixelScaleTag  (33550)| DOUBLE  (12) | 3      | pointeur
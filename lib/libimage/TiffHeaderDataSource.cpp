@@ -5,102 +5,171 @@
 
 TiffHeaderDataSource::TiffHeaderDataSource ( DataSource* dataSource,
         Rok4Format::eformat_data format, int channel,
-        int width, int height, size_t tileSize ) :
+        int width, int height, size_t tileSize, Predictor::ePredictor predictor ) :
     dataSource ( dataSource ),
     format ( format ), channel ( channel ),
     width ( width ), height ( height ) , tileSize ( tileSize ) {
     size_t header_size = TiffHeader::headerSize ( channel );
-    const uint8_t* tmp;
+    headerSize = header_size;
     dataSize = header_size;
+    tile = NULL;
+    data = NULL;
     if ( dataSource ) {
-        tmp = dataSource->getData ( tileSize );
+        tile = dataSource->getData ( tileSize );
+        this->tileSize = tileSize;
         dataSize+= tileSize;
     }
 
-    data = new uint8_t[dataSize];
+    header = new uint8_t[header_size];
 
     switch ( format ) {
     case Rok4Format::TIFF_RAW_INT8:
+    case Rok4Format::TIFF_RAW_UINT16:
         if ( channel == 1 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_RAW_INT8_GRAY" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_RAW_INT8_GRAY, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_RAW_INT8_GRAY, header_size );
         } else if ( channel == 3 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_RAW_INT8_RGB" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_RAW_INT8_RGB, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_RAW_INT8_RGB, header_size );
         } else if ( channel == 4 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_RAW_INT8_RGBA" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_RAW_INT8_RGBA, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_RAW_INT8_RGBA, header_size );
         }
         break;
     case Rok4Format::TIFF_LZW_INT8:
+    case Rok4Format::TIFF_LZW_UINT16:
         if ( channel == 1 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_LZW_INT8_GRAY" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_LZW_INT8_GRAY, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_LZW_INT8_GRAY, header_size );
         } else if ( channel == 3 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_LZW_INT8_RGB" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_LZW_INT8_RGB, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_LZW_INT8_RGB, header_size );
         } else if ( channel == 4 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_LZW_INT8_RGBA" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_LZW_INT8_RGBA, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_LZW_INT8_RGBA, header_size );
         }
         break;
     case Rok4Format::TIFF_ZIP_INT8:
+    case Rok4Format::TIFF_ZIP_UINT16:
         if ( channel == 1 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_ZIP_INT8_GRAY" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_ZIP_INT8_GRAY, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_ZIP_INT8_GRAY, header_size );
         } else if ( channel == 3 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_ZIP_INT8_RGB" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_ZIP_INT8_RGB, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_ZIP_INT8_RGB, header_size );
         } else if ( channel == 4 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_ZIP_INT8_RGBA" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_ZIP_INT8_RGBA, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_ZIP_INT8_RGBA, header_size );
+        }
+        break;
+    case Rok4Format::TIFF_ZSTD_INT8:
+        // En-tête deflate dont la compression est corrigée plus bas
+        if ( channel == 1 ) {
+            LOGGER_DEBUG ( "TIFF_HEADER_ZSTD_INT8_GRAY" );
+            memcpy ( header, TiffHeader::TIFF_HEADER_ZIP_INT8_GRAY, header_size );
+        } else if ( channel == 3 ) {
+            LOGGER_DEBUG ( "TIFF_HEADER_ZSTD_INT8_RGB" );
+            memcpy ( header, TiffHeader::TIFF_HEADER_ZIP_INT8_RGB, header_size );
+        } else if ( channel == 4 ) {
+            LOGGER_DEBUG ( "TIFF_HEADER_ZSTD_INT8_RGBA" );
+            memcpy ( header, TiffHeader::TIFF_HEADER_ZIP_INT8_RGBA, header_size );
         }
         break;
     case Rok4Format::TIFF_PKB_INT8:
+    case Rok4Format::TIFF_PKB_UINT16:
         if ( channel == 1 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_PKB_INT8_GRAY" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_PKB_INT8_GRAY, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_PKB_INT8_GRAY, header_size );
         } else if ( channel == 3 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_PKB_INT8_RGB" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_PKB_INT8_RGB, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_PKB_INT8_RGB, header_size );
         } else if ( channel == 4 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_PKB_INT8_RGBA" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_PKB_INT8_RGBA, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_PKB_INT8_RGBA, header_size );
         }
         break;
 
     case Rok4Format::TIFF_RAW_FLOAT32:
         if ( channel == 1 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_RAW_FLOAT32_GRAY" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_RAW_FLOAT32_GRAY, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_RAW_FLOAT32_GRAY, header_size );
         }
         break;
     case Rok4Format::TIFF_LZW_FLOAT32:
         if ( channel == 1 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_LZW_FLOAT32_GRAY" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_LZW_FLOAT32_GRAY, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_LZW_FLOAT32_GRAY, header_size );
         }
         break;
     case Rok4Format::TIFF_ZIP_FLOAT32:
         if ( channel == 1 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_ZIP_FLOAT32_GRAY" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_ZIP_FLOAT32_GRAY, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_ZIP_FLOAT32_GRAY, header_size );
         }
         break;
     case Rok4Format::TIFF_PKB_FLOAT32:
         if ( channel == 1 ) {
             LOGGER_DEBUG ( "TIFF_HEADER_PKB_FLOAT32_GRAY" );
-            memcpy ( data, TiffHeader::TIFF_HEADER_PKB_FLOAT32_GRAY, header_size );
+            memcpy ( header, TiffHeader::TIFF_HEADER_PKB_FLOAT32_GRAY, header_size );
+        }
+        break;
+    case Rok4Format::TIFF_ZSTD_FLOAT32:
+        if ( channel == 1 ) {
+            LOGGER_DEBUG ( "TIFF_HEADER_ZSTD_FLOAT32_GRAY" );
+            memcpy ( header, TiffHeader::TIFF_HEADER_ZIP_FLOAT32_GRAY, header_size );
         }
         break;
     }
-    * ( ( uint32_t* ) ( data+18 ) )  = width;
-    * ( ( uint32_t* ) ( data+30 ) )  = height;
-    * ( ( uint32_t* ) ( data+102 ) ) = height;
-    * ( ( uint32_t* ) ( data+114 ) ) = tileSize;
 
-    if ( dataSource ) {
-        memcpy ( data+header_size, tmp, tileSize );
+    if ( Rok4Format::toSampleSize ( format ) == 2 ) {
+        // En-tête entier 8 bits dont seul le nombre de bits par canal change
+        TiffHeader::setBitsPerSample ( header, 16 );
+    }
+
+    if ( format == Rok4Format::TIFF_ZSTD_INT8 || format == Rok4Format::TIFF_ZSTD_FLOAT32 ) {
+        // Seule la valeur du tag COMPRESSION (259) diffère de l'en-tête deflate
+        uint16_t count = * ( ( uint16_t* ) ( header+8 ) );
+        for ( size_t t = 10; t < 10 + 12 * count; t += 12 ) {
+            if ( * ( ( uint16_t* ) ( header+t ) ) == 259 ) {
+                * ( ( uint16_t* ) ( header+t+8 ) ) = COMPRESSION_ZSTD;
+                break;
+            }
+        }
+    }
+    * ( ( uint32_t* ) ( header+18 ) )  = width;
+    * ( ( uint32_t* ) ( header+30 ) )  = height;
+    * ( ( uint32_t* ) ( header+102 ) ) = height;
+    * ( ( uint32_t* ) ( header+114 ) ) = tileSize;
+
+    if ( predictor != Predictor::NONE ) {
+        // Ajout du tag PREDICTOR (317) à sa place dans l'IFD, les tags étant triés
+        uint16_t count = * ( ( uint16_t* ) ( header+8 ) );
+        size_t pos = 10;
+        while ( pos < 10 + 12 * count && * ( ( uint16_t* ) ( header+pos ) ) < 317 ) pos += 12;
+
+        uint8_t* extended = new uint8_t[headerSize+12];
+        memcpy ( extended, header, pos );
+        * ( ( uint16_t* ) ( extended+pos ) ) = 317;
+        * ( ( uint16_t* ) ( extended+pos+2 ) ) = 3; // SHORT
+        * ( ( uint32_t* ) ( extended+pos+4 ) ) = 1;
+        * ( ( uint32_t* ) ( extended+pos+8 ) ) = predictor;
+        memcpy ( extended+pos+12, header+pos, headerSize-pos );
+        * ( ( uint16_t* ) ( extended+8 ) ) = count+1;
+
+        // Les données pointées par l'IFD (et la tuile) sont décalées d'autant
+        for ( size_t t = 10; t < 10 + 12 * ( count+1 ); t += 12 ) {
+            uint16_t tag = * ( ( uint16_t* ) ( extended+t ) );
+            uint16_t type = * ( ( uint16_t* ) ( extended+t+2 ) );
+            uint32_t number = * ( ( uint32_t* ) ( extended+t+4 ) );
+            if ( tag == 273 || ( type == 3 && number > 2 ) ) {
+                * ( ( uint32_t* ) ( extended+t+8 ) ) += 12;
+            }
+        }
+
+        delete[] header;
+        header = extended;
+        headerSize += 12;
+        dataSize += 12;
     }
 }
 
@@ -108,15 +177,31 @@ TiffHeaderDataSource::TiffHeaderDataSource ( DataSource* dataSource,
 
 
 const uint8_t* TiffHeaderDataSource::getData ( size_t& size ) {
+    if ( ! data ) {
+        data = new uint8_t[dataSize];
+        memcpy ( data, header, headerSize );
+        if ( tile ) {
+            memcpy ( data+headerSize, tile, tileSize );
+        }
+    }
     size = dataSize;
     return data;
 }
 
+bool TiffHeaderDataSource::getSegments ( std::vector<DataSegment>& segments ) {
+    segments.push_back ( DataSegment ( header, headerSize ) );
+    if ( tile ) {
+        segments.push_back ( DataSegment ( tile, tileSize ) );
+    }
+    return true;
+}
+
 TiffHeaderDataSource::~TiffHeaderDataSource() {
     if ( dataSource ) {
         dataSource->releaseData();
         delete dataSource;
     }
+    delete[] header;
     if ( data )
         delete[] data;
 }
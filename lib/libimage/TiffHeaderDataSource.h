@@ -8,7 +8,12 @@ class TiffHeaderDataSource : public DataSource {
 private:
     DataSource* dataSource;
     size_t tileSize;
+    /** Données de la tuile, sans en-tête */
+    const uint8_t* tile;
+    size_t headerSize;
+    uint8_t* header;
     size_t dataSize;
+    /** En-tête et tuile rassemblés, au premier appel de getData seulement */
     uint8_t* data;
     Rok4Format::eformat_data format;
     int channel;
@@ -23,9 +28,11 @@ public:
      * @param width largeur de l'image
      * @param height hauteur de l'image
      * @param tileSize taille de la tuile à définir si dataSource est nulle
+     * @param predictor prédicteur TIFF appliqué aux données de la tuile, précisé dans l'en-tête
      */
     TiffHeaderDataSource ( DataSource* dataSource, Rok4Format::eformat_data format,
-                           int channel, int width, int height, size_t tileSize=0 );
+                           int channel, int width, int height, size_t tileSize=0,
+                           Predictor::ePredictor predictor = Predictor::NONE );
 
     inline bool releaseData()                   {
         return dataSource->releaseData();
@@ -40,6 +47,8 @@ public:
         return dataSource->getEncoding();
     }
     virtual const uint8_t* getData ( size_t& size );
+    /** L'en-tête puis la tuile, sans copie */
+    virtual bool getSegments ( std::vector<DataSegment>& segments );
     virtual ~TiffHeaderDataSource();
 };
 
@@ -68,6 +68,8 @@ protected:
 	    memcpy( header, TiffHeader::TIFF_HEADER_LZW_INT8_RGB, sizeHeader);
 	else if ( image->channels==4 )
 	    memcpy( header, TiffHeader::TIFF_HEADER_LZW_INT8_RGBA, sizeHeader);
+	if ( sizeof ( T ) == sizeof ( uint16_t ) )
+	    TiffHeader::setBitsPerSample ( header, 16 );
 	* ( ( uint32_t* ) ( header+18 ) )  = image->getWidth();
 	* ( ( uint32_t* ) ( header+30 ) )  = image->getHeight();
 	* ( ( uint32_t* ) ( header+102 ) ) = image->getHeight();
@@ -80,7 +82,7 @@ protected:
 	rawBuffer = new T[image->getHeight()*image->getWidth()*image->channels];
 	rawBufferSize = 0;
 	int lRead = 0;
-	for ( ; lRead < image->getHeight() ; lRead++ ) {
+	for ( ; lRead < image->getHeight() && !CancellationToken::currentCancelled() ; lRead++ ) {
 	    image->getline ( rawBuffer + rawBufferSize, lRead );
 	    rawBufferSize += linesize;
 	}
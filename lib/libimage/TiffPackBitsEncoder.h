@@ -75,6 +75,8 @@ protected:
 	    memcpy( header, TiffHeader::TIFF_HEADER_PKB_INT8_RGB, sizeHeader);
 	else if ( image->channels==4 )
 	    memcpy( header, TiffHeader::TIFF_HEADER_PKB_INT8_RGBA, sizeHeader);
+	if ( sizeof ( T ) == sizeof ( uint16_t ) )
+	    TiffHeader::setBitsPerSample ( header, 16 );
 	* ( ( uint32_t* ) ( header+18 ) )  = image->getWidth();
 	* ( ( uint32_t* ) ( header+30 ) )  = image->getHeight();
 	* ( ( uint32_t* ) ( header+102 ) ) = image->getHeight();
@@ -91,7 +93,7 @@ protected:
 	int lRead = 0;
 	pkbEncoder encoder;
 	uint8_t * pkbLine;
-	for ( ; lRead < image->getHeight() ; lRead++ ) {
+	for ( ; lRead < image->getHeight() && !CancellationToken::currentCancelled() ; lRead++ ) {
 	    image->getline ( rawBuffer, lRead );
 	    size_t pkbLineSize = 0;
 	    pkbLine =  encoder.encode ( ( uint8_t* ) rawBuffer,rawBufferSize, pkbLineSize );
@@ -104,7 +106,7 @@ protected:
     }
 
 public:
-    TiffPackBitsEncoder ( Image *image, bool isGeoTiff = false ) : TiffEncoder( image, -1, isGeoTiff ) , rawBufferSize ( 0 ), rawBuffer ( NULL ) {
+    TiffPackBitsEncoder ( Image *image, bool isGeoTiff = false ) : TiffEncoder( image, -1, isGeoTiff ) , rawBuffer ( NULL ), rawBufferSize ( 0 ) {
 
     }
     ~TiffPackBitsEncoder() {
@@ -62,6 +62,8 @@ protected:
 	    memcpy( header, TiffHeader::TIFF_HEADER_RAW_INT8_RGB, sizeHeader);
 	else if ( image->channels==4 )
 	    memcpy( header, TiffHeader::TIFF_HEADER_RAW_INT8_RGBA, sizeHeader);
+	if ( sizeof ( T ) == sizeof ( uint16_t ) )
+	    TiffHeader::setBitsPerSample ( header, 16 );
 	* ( ( uint32_t* ) ( header+18 ) )  = image->getWidth();
 	* ( ( uint32_t* ) ( header+30 ) )  = image->getHeight();
 	* ( ( uint32_t* ) ( header+102 ) ) = image->getHeight();
@@ -75,7 +77,7 @@ protected:
 	tmpBufferSize = 0;
 	int linesize = image->getWidth()*image->channels;
 	int linesizetmp = linesize * sizeof ( T );
-	for ( ; lRead < image->getHeight() ; lRead++ ) {
+	for ( ; lRead < image->getHeight() && !CancellationToken::currentCancelled() ; lRead++ ) {
 	    image->getline ( ( T* ) (tmpBuffer+tmpBufferSize), lRead );
 	    tmpBufferSize+=linesizetmp;
 	}
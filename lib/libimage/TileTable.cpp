@@ -0,0 +1,113 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file TileTable.cpp
+ * \~french
+ * \brief Implémentation de la classe TileTable, table des tuiles décodées partagées au sein d'une requête
+ * \~english
+ * \brief Implement the TileTable class, table of decoded tiles shared within a request
+ */
+
+#include "TileTable.h"
+
+static pthread_once_t table_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t table_key;
+
+static void init_table_key() {
+    pthread_key_create ( &table_key, 0 );
+}
+
+TileTable::TileTable() {
+    pthread_mutex_init ( &mutex, NULL );
+}
+
+TileTable::~TileTable() {
+    for ( std::map<TileKey, SharedTile*>::iterator it = tiles.begin(); it != tiles.end(); it++ ) {
+        SharedTile* tile = it->second;
+        tile->source->releaseData();
+        delete tile->source;
+        pthread_mutex_destroy ( &tile->mutex );
+        delete tile;
+    }
+    pthread_mutex_destroy ( &mutex );
+}
+
+DataSource* TileTable::find ( const void* owner, int x, int y, int scale ) {
+    TileKey key = { owner, x, y, scale };
+    pthread_mutex_lock ( &mutex );
+    std::map<TileKey, SharedTile*>::iterator it = tiles.find ( key );
+    SharedTile* tile = ( it == tiles.end() ) ? NULL : it->second;
+    pthread_mutex_unlock ( &mutex );
+    return tile ? new SharedTileSource ( tile ) : NULL;
+}
+
+DataSource* TileTable::insert ( const void* owner, int x, int y, int scale, DataSource* source ) {
+    TileKey key = { owner, x, y, scale };
+    pthread_mutex_lock ( &mutex );
+    std::map<TileKey, SharedTile*>::iterator it = tiles.find ( key );
+    SharedTile* tile;
+    if ( it == tiles.end() ) {
+        tile = new SharedTile;
+        tile->source = source;
+        pthread_mutex_init ( &tile->mutex, NULL );
+        tiles.insert ( std::pair<TileKey, SharedTile*> ( key, tile ) );
+    } else {
+        // Tuile ajoutée entre temps : la source fournie est inutile
+        tile = it->second;
+        delete source;
+    }
+    pthread_mutex_unlock ( &mutex );
+    return new SharedTileSource ( tile );
+}
+
+int TileTable::size() {
+    pthread_mutex_lock ( &mutex );
+    int n = tiles.size();
+    pthread_mutex_unlock ( &mutex );
+    return n;
+}
+
+void TileTable::setCurrent ( TileTable* table ) {
+    pthread_once ( &table_key_once, init_table_key );
+    pthread_setspecific ( table_key, table );
+}
+
+TileTable* TileTable::getCurrent() {
+    pthread_once ( &table_key_once, init_table_key );
+    return ( TileTable* ) pthread_getspecific ( table_key );
+}
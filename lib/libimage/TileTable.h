@@ -0,0 +1,205 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file TileTable.h
+ * \~french
+ * \brief Définition de la classe TileTable, table des tuiles décodées partagées au sein d'une requête
+ * \~english
+ * \brief Define the TileTable class, table of decoded tiles shared within a request
+ */
+
+#ifndef TILE_TABLE_H
+#define TILE_TABLE_H
+
+#include <pthread.h>
+#include <map>
+#include "Data.h"
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Table des tuiles décodées, partagées entre les images d'une même requête
+ * \details Lorsqu'une requête est calculée par plusieurs images indépendantes (bandes rendues en parallèle), les tuiles à cheval sur deux images ne sont décodées qu'une fois. Chaque image reçoit une source qui ne possède pas la tuile : le décodage est protégé par un verrou propre à la tuile, et les données restent disponibles jusqu'à la destruction de la table.
+ *
+ * La table est associée au thread qui construit les images, le temps de leur construction (voir setCurrent).
+ * \~english
+ * \brief Decoded tiles table, shared between images of a same request
+ * \details When a request is computed by several independent images (bands rendered in parallel), tiles straddling two images are decoded only once. Each image gets a source which does not own the tile : decoding is protected by a tile's own lock, and data remain available until the table destruction.
+ *
+ * The table is bound to the thread building images, during their construction (see setCurrent).
+ */
+class TileTable {
+
+private:
+    /**
+     * \~french \brief Identifiant d'une tuile : niveau, indices et facteur de réduction
+     * \~english \brief Tile identifier : level, indices and reduction factor
+     */
+    struct TileKey {
+        const void* owner;
+        int x;
+        int y;
+        int scale;
+
+        bool operator< ( const TileKey& other ) const {
+            if ( owner != other.owner ) return owner < other.owner;
+            if ( x != other.x ) return x < other.x;
+            if ( y != other.y ) return y < other.y;
+            return scale < other.scale;
+        }
+    };
+
+    /**
+     * \~french \brief Tuile partagée : source possédée par la table et son verrou
+     * \~english \brief Shared tile : source owned by the table and its lock
+     */
+    struct SharedTile {
+        DataSource* source;
+        pthread_mutex_t mutex;
+    };
+
+    /**
+     * \~french \brief Source de donnée donnant accès à une tuile partagée, sans la posséder
+     * \~english \brief Data source giving access to a shared tile, without owning it
+     */
+    class SharedTileSource : public DataSource {
+    private:
+        SharedTile* tile;
+    public:
+        SharedTileSource ( SharedTile* tile ) : tile ( tile ) {}
+
+        const uint8_t* getData ( size_t& size ) {
+            pthread_mutex_lock ( &tile->mutex );
+            const uint8_t* data = tile->source->getData ( size );
+            pthread_mutex_unlock ( &tile->mutex );
+            return data;
+        }
+        /* Les données sont libérées avec la table */
+        bool releaseData() {
+            return false;
+        }
+        std::string getType() {
+            return tile->source->getType();
+        }
+        int getHttpStatus() {
+            return tile->source->getHttpStatus();
+        }
+        std::string getEncoding() {
+            return tile->source->getEncoding();
+        }
+    };
+
+    /**
+     * \~french \brief Tuiles partagées
+     * \~english \brief Shared tiles
+     */
+    std::map<TileKey, SharedTile*> tiles;
+
+    /**
+     * \~french \brief Protège la table
+     * \~english \brief Protect the table
+     */
+    pthread_mutex_t mutex;
+
+public:
+    /**
+     * \~french \brief Constructeur d'une table vide
+     * \~english \brief Empty table constructor
+     */
+    TileTable();
+
+    /**
+     * \~french \brief Destructeur, les sources des tuiles sont libérées
+     * \~english \brief Destructor, tiles' sources are freed
+     */
+    ~TileTable();
+
+    /**
+     * \~french
+     * \brief Recherche une tuile déjà partagée
+     * \param[in] owner niveau auquel appartient la tuile
+     * \param[in] x indice de colonne
+     * \param[in] y indice de ligne
+     * \param[in] scale facteur de réduction du décodage
+     * \return une nouvelle source d'accès à la tuile, NULL si elle n'est pas dans la table
+     * \~english
+     * \brief Look for an already shared tile
+     * \param[in] owner level the tile belongs to
+     * \param[in] x column indice
+     * \param[in] y row indice
+     * \param[in] scale decoding reduction factor
+     * \return a new access source to the tile, NULL if not in the table
+     */
+    DataSource* find ( const void* owner, int x, int y, int scale );
+
+    /**
+     * \~french
+     * \brief Ajoute une tuile à la table
+     * \param[in] source source de la tuile décodée, possédée ensuite par la table
+     * \return une nouvelle source d'accès à la tuile
+     * \~english
+     * \brief Add a tile to the table
+     * \param[in] source decoded tile's source, then owned by the table
+     * \return a new access source to the tile
+     */
+    DataSource* insert ( const void* owner, int x, int y, int scale, DataSource* source );
+
+    /**
+     * \~french \brief Nombre de tuiles partagées
+     * \~english \brief Number of shared tiles
+     */
+    int size();
+
+    /**
+     * \~french
+     * \brief Associe une table au thread courant, NULL pour ne plus partager les tuiles
+     * \~english
+     * \brief Bind a table to the current thread, NULL to stop sharing tiles
+     */
+    static void setCurrent ( TileTable* table );
+
+    /**
+     * \~french
+     * \brief Table associée au thread courant, NULL si aucune
+     * \~english
+     * \brief Table bound to the current thread, NULL if none
+     */
+    static TileTable* getCurrent();
+};
+
+#endif
@@ -48,6 +48,7 @@
 #define UTILS_H
 
 #include <cstring>
+#include <cmath>
 #include <iostream>
 #include <stdint.h>
 
@@ -166,6 +167,17 @@ inline void convert ( uint16_t* to, const uint8_t* from, int length ) {
 }
 #endif
 
+/**
+ * \brief Conversion uint16 -> uint8
+ * \details Les valeurs supérieures à 255 sont saturées
+ * @param to Tableau d'entiers 8 bits destination
+ * @param from   Tableau d'entiers 16 bits source
+ * @param length Nombre d'éléments à convertir
+ */
+inline void convert ( uint8_t* to, const uint16_t* from, int length ) {
+    for ( int i = 0; i < length; ++i ) to[i] = ( from[i] > 255 ) ? 255 : ( uint8_t ) from[i];
+}
+
 
 /**
  * \brief Conversion float -> uint8
@@ -696,6 +708,157 @@ inline void dot_prod ( int C, int K, float* to, const float* from, const float*
     }
 }
 
+
+/* -------------------- VIRGULE FIXE 8 BITS -------------------- */
+
+/**
+ * \brief Nombre de bits de la partie décimale des poids en virgule fixe
+ * \details Un poids de 1 vaut 1 << FIXED_WEIGHT_BITS : il tient sur un entier 16 bits signé.
+ */
+#define FIXED_WEIGHT_BITS 14
+
+/**
+ * \brief Nombre de bits de la partie décimale des lignes intermédiaires (rééchantillonnées dans un seul sens)
+ * \details Les valeurs 8 bits, éventuellement hors de [0,255] à cause des lobes négatifs des noyaux, tiennent sur un entier 16 bits signé.
+ */
+#define FIXED_LINE_BITS 5
+
+/**
+ * \brief Conversion de poids flottants en poids en virgule fixe
+ * \details L'arrondi est corrigé sur le plus grand poids pour que leur somme vaille exactement 1 << FIXED_WEIGHT_BITS.
+ * @param to Tableau de poids entiers de destination
+ * @param from Tableau de poids flottants source, de somme 1
+ * @param length Nombre de poids
+ */
+inline void quantize ( int16_t* to, const float* from, int length ) {
+    int sum = 0, biggest = 0;
+    for ( int i = 0; i < length; i++ ) {
+        to[i] = ( int16_t ) lrintf ( from[i] * ( 1 << FIXED_WEIGHT_BITS ) );
+        sum += to[i];
+        if ( to[i] > to[biggest] ) biggest = i;
+    }
+    to[biggest] += ( 1 << FIXED_WEIGHT_BITS ) - sum;
+}
+
+/**
+ * \brief Produit scalaire en virgule fixe d'un pixel, canaux entrelacés
+ * \details Le résultat garde FIXED_LINE_BITS bits de partie décimale.
+ * @param K Nombre de poids
+ * @param to Pixel de destination (C valeurs)
+ * @param from Premier pixel source (K * C valeurs)
+ * @param W Poids en virgule fixe
+ */
+template<int C>
+inline void dot_prod ( int K, int16_t* to, const uint8_t* from, const int16_t* W ) {
+    int32_t acc[C];
+    for ( int c = 0; c < C; c++ ) acc[c] = 1 << ( FIXED_WEIGHT_BITS - FIXED_LINE_BITS - 1 );
+    for ( int k = 0; k < K; k++, from += C ) {
+        for ( int c = 0; c < C; c++ ) acc[c] += from[c] * W[k];
+    }
+    for ( int c = 0; c < C; c++ ) {
+        int32_t v = acc[c] >> ( FIXED_WEIGHT_BITS - FIXED_LINE_BITS );
+        to[c] = ( int16_t ) ( v < -32768 ? -32768 : ( v > 32767 ? 32767 : v ) );
+    }
+}
+
+inline void dot_prod ( int C, int K, int16_t* to, const uint8_t* from, const int16_t* W ) {
+    switch ( C ) {
+    case 1:
+        dot_prod<1> ( K, to, from, W );
+        break;
+    case 2:
+        dot_prod<2> ( K, to, from, W );
+        break;
+    case 3:
+        dot_prod<3> ( K, to, from, W );
+        break;
+    case 4:
+        dot_prod<4> ( K, to, from, W );
+        break;
+    }
+}
+
+/**
+ * \brief Combinaison de deux lignes intermédiaires par deux poids en virgule fixe : to = from1 * w1 + from2 * w2
+ * \details Avec SSE2, les deux lignes sont entrelacées pour utiliser pmaddwd (_mm_madd_epi16), qui multiplie et somme les paires d'entiers 16 bits sur 32 bits.
+ * @param to Tableau d'entiers 32 bits de destination
+ * @param from1 Première ligne source
+ * @param from2 Seconde ligne source
+ * @param w1 Poids de la première ligne
+ * @param w2 Poids de la seconde ligne
+ * @param length Nombre d'éléments dans les tableaux
+ */
+#ifdef __SSE2__
+
+inline void mult ( int32_t* to, const int16_t* from1, const int16_t* from2, int16_t w1, int16_t w2, int length ) {
+    __m128i W = _mm_set1_epi32 ( ( ( uint32_t ) ( uint16_t ) w2 << 16 ) | ( uint16_t ) w1 );
+    int i = 0;
+    for ( ; i + 8 <= length; i += 8 ) {
+        __m128i a = _mm_loadu_si128 ( ( const __m128i* ) ( from1 + i ) );
+        __m128i b = _mm_loadu_si128 ( ( const __m128i* ) ( from2 + i ) );
+        _mm_storeu_si128 ( ( __m128i* ) ( to + i ), _mm_madd_epi16 ( _mm_unpacklo_epi16 ( a, b ), W ) );
+        _mm_storeu_si128 ( ( __m128i* ) ( to + i + 4 ), _mm_madd_epi16 ( _mm_unpackhi_epi16 ( a, b ), W ) );
+    }
+    for ( ; i < length; i++ ) to[i] = from1[i] * w1 + from2[i] * w2;
+}
+
+inline void add_mult ( int32_t* to, const int16_t* from1, const int16_t* from2, int16_t w1, int16_t w2, int length ) {
+    __m128i W = _mm_set1_epi32 ( ( ( uint32_t ) ( uint16_t ) w2 << 16 ) | ( uint16_t ) w1 );
+    int i = 0;
+    for ( ; i + 8 <= length; i += 8 ) {
+        __m128i a = _mm_loadu_si128 ( ( const __m128i* ) ( from1 + i ) );
+        __m128i b = _mm_loadu_si128 ( ( const __m128i* ) ( from2 + i ) );
+        __m128i L = _mm_loadu_si128 ( ( __m128i* ) ( to + i ) );
+        __m128i H = _mm_loadu_si128 ( ( __m128i* ) ( to + i + 4 ) );
+        _mm_storeu_si128 ( ( __m128i* ) ( to + i ), _mm_add_epi32 ( L, _mm_madd_epi16 ( _mm_unpacklo_epi16 ( a, b ), W ) ) );
+        _mm_storeu_si128 ( ( __m128i* ) ( to + i + 4 ), _mm_add_epi32 ( H, _mm_madd_epi16 ( _mm_unpackhi_epi16 ( a, b ), W ) ) );
+    }
+    for ( ; i < length; i++ ) to[i] += from1[i] * w1 + from2[i] * w2;
+}
+
+/**
+ * \brief Conversion int32 en virgule fixe -> uint8, avec arrondi et saturation
+ * @param to Tableau d'entiers 8 bits de destination
+ * @param from Tableau d'entiers 32 bits source
+ * @param shift Nombre de bits de la partie décimale
+ * @param length Nombre d'éléments à convertir
+ */
+inline void convert ( uint8_t* to, const int32_t* from, int shift, int length ) {
+    __m128i R = _mm_set1_epi32 ( 1 << ( shift - 1 ) );
+    __m128i S = _mm_cvtsi32_si128 ( shift );
+    int i = 0;
+    for ( ; i + 16 <= length; i += 16 ) {
+        __m128i A = _mm_sra_epi32 ( _mm_add_epi32 ( _mm_loadu_si128 ( ( const __m128i* ) ( from + i ) ), R ), S );
+        __m128i B = _mm_sra_epi32 ( _mm_add_epi32 ( _mm_loadu_si128 ( ( const __m128i* ) ( from + i + 4 ) ), R ), S );
+        __m128i C = _mm_sra_epi32 ( _mm_add_epi32 ( _mm_loadu_si128 ( ( const __m128i* ) ( from + i + 8 ) ), R ), S );
+        __m128i D = _mm_sra_epi32 ( _mm_add_epi32 ( _mm_loadu_si128 ( ( const __m128i* ) ( from + i + 12 ) ), R ), S );
+        _mm_storeu_si128 ( ( __m128i* ) ( to + i ), _mm_packus_epi16 ( _mm_packs_epi32 ( A, B ), _mm_packs_epi32 ( C, D ) ) );
+    }
+    for ( ; i < length; i++ ) {
+        int32_t v = ( from[i] + ( 1 << ( shift - 1 ) ) ) >> shift;
+        to[i] = ( uint8_t ) ( v < 0 ? 0 : ( v > 255 ? 255 : v ) );
+    }
+}
+
+#else // Version non SSE
+
+inline void mult ( int32_t* to, const int16_t* from1, const int16_t* from2, int16_t w1, int16_t w2, int length ) {
+    for ( int i = 0; i < length; i++ ) to[i] = from1[i] * w1 + from2[i] * w2;
+}
+
+inline void add_mult ( int32_t* to, const int16_t* from1, const int16_t* from2, int16_t w1, int16_t w2, int length ) {
+    for ( int i = 0; i < length; i++ ) to[i] += from1[i] * w1 + from2[i] * w2;
+}
+
+inline void convert ( uint8_t* to, const int32_t* from, int shift, int length ) {
+    for ( int i = 0; i < length; i++ ) {
+        int32_t v = ( from[i] + ( 1 << ( shift - 1 ) ) ) >> shift;
+        to[i] = ( uint8_t ) ( v < 0 ? 0 : ( v > 255 ? 255 : v ) );
+    }
+}
+
+#endif
+
 #endif
 
 
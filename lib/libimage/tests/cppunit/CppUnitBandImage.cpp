@@ -0,0 +1,280 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdlib>
+#include <zlib.h>
+#include "BandImage.h"
+#include "Decoder.h"
+#include "EmptyImage.h"
+#include "JPEGEncoder.h"
+#include "MemoryArena.h"
+
+/**
+ * \~french \brief Bande dont chaque échantillon dépend de sa position dans l'image complète
+ * \~english \brief Band whose each sample depends on its position in the whole image
+ */
+class OffsetImage : public Image {
+public:
+    int offset;
+
+    OffsetImage ( int width, int height, int channels, int offset ) : Image ( width, height, channels ), offset ( offset ) {}
+
+    static int value ( int x, int line, int c ) {
+        return ( x * 3 + line * 11 + c * 41 ) % 256;
+    }
+
+    template<typename T>
+    int fill ( T* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = ( T ) value ( i / channels, offset + line, i % channels );
+        return width * channels;
+    }
+
+    int getline ( uint8_t* buffer, int line ) {
+        return fill ( buffer, line );
+    }
+    int getline ( uint16_t* buffer, int line ) {
+        return fill ( buffer, line );
+    }
+    int getline ( float* buffer, int line ) {
+        return fill ( buffer, line );
+    }
+};
+
+/**
+ * \~french \brief Source de données comptant ses lectures
+ * \~english \brief Data source counting its reads
+ */
+class CountingSource : public DataSource {
+public:
+    int* reads;
+    uint8_t data[4];
+
+    CountingSource ( int* reads ) : reads ( reads ) {
+        memset ( data, 7, 4 );
+    }
+    const uint8_t* getData ( size_t& size ) {
+        ( *reads )++;
+        size = 4;
+        return data;
+    }
+    bool releaseData() {
+        return false;
+    }
+    std::string getType() {
+        return "";
+    }
+    int getHttpStatus() {
+        return 200;
+    }
+    std::string getEncoding() {
+        return "";
+    }
+};
+
+/**
+ * \~french \brief Source de données en mémoire, possédant ses données
+ * \~english \brief Data source in memory, owning its data
+ */
+class RawSource : public DataSource {
+public:
+    uint8_t* data;
+    size_t size;
+
+    RawSource ( uint8_t* data, size_t size ) : data ( data ), size ( size ) {}
+    ~RawSource() {
+        delete [] data;
+    }
+    const uint8_t* getData ( size_t& size ) {
+        size = this->size;
+        return data;
+    }
+    bool releaseData() {
+        return false;
+    }
+    std::string getType() {
+        return "";
+    }
+    int getHttpStatus() {
+        return 200;
+    }
+    std::string getEncoding() {
+        return "";
+    }
+};
+
+class CppUnitBandImage : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitBandImage );
+    CPPUNIT_TEST ( testParallel );
+    CPPUNIT_TEST ( testSequential );
+    CPPUNIT_TEST ( testTileTable );
+    CPPUNIT_TEST ( testDecodedBands );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+
+    BandImage* createBands ( int width, int channels, int* heights, int nb, TaskPool* pool ) {
+        std::vector<Image*> bands;
+        int offset = 0;
+        for ( int i = 0; i < nb; i++ ) {
+            bands.push_back ( new OffsetImage ( width, heights[i], channels, offset ) );
+            offset += heights[i];
+        }
+        return new BandImage ( bands, pool );
+    }
+
+    template<typename T>
+    void checkLines ( BandImage* image, int width, int height, int channels ) {
+        T* buffer = new T[width * channels];
+        for ( int l = 0; l < height; l++ ) {
+            CPPUNIT_ASSERT_EQUAL ( width * channels, image->getline ( buffer, l ) );
+            for ( int i = 0; i < width * channels; i++ )
+                CPPUNIT_ASSERT_EQUAL ( OffsetImage::value ( i / channels, l, i % channels ), ( int ) buffer[i] );
+        }
+        delete [] buffer;
+    }
+
+    void testParallel() {
+        TaskPool pool ( 3 );
+        int heights[4] = { 20, 17, 20, 9 };
+        BandImage* image = createBands ( 33, 3, heights, 4, &pool );
+        CPPUNIT_ASSERT_EQUAL ( 66, image->getHeight() );
+        checkLines<uint8_t> ( image, 33, 66, 3 );
+        // Relecture dans un autre type que celui du calcul
+        checkLines<float> ( image, 33, 66, 3 );
+        delete image;
+
+        // Destruction avant toute lecture, puis avant la fin des calculs
+        delete createBands ( 33, 3, heights, 4, &pool );
+        image = createBands ( 33, 3, heights, 4, &pool );
+        uint8_t buffer[33 * 3];
+        image->getline ( buffer, 0 );
+        delete image;
+    }
+
+    void testSequential() {
+        int heights[3] = { 5, 5, 6 };
+        BandImage* image = createBands ( 10, 1, heights, 3, NULL );
+        checkLines<uint16_t> ( image, 10, 16, 1 );
+        delete image;
+    }
+
+    /* Bande décodée d'une tuile JPEG de couleur uniforme */
+    Image* jpegBand ( int width, int height ) {
+        int color[3] = { 200, 100, 50 };
+        JPEGEncoder encoder ( new EmptyImage ( width, height, 3, color ) );
+        return new ImageDecoder ( new DataSourceDecoder<JpegDecoder> ( new BufferedDataSource ( encoder ) ), width, height, 3 );
+    }
+
+    /* Bande décodée d'une tuile deflate, dont les échantillons sont ceux d'OffsetImage */
+    Image* deflateBand ( int width, int height, int offset ) {
+        size_t rawSize = width * height * 3;
+        uint8_t* raw = new uint8_t[rawSize];
+        for ( int i = 0; i < rawSize; i++ ) raw[i] = OffsetImage::value ( ( i / 3 ) % width, offset + i / 3 / width, i % 3 );
+        uLongf encSize = compressBound ( rawSize );
+        uint8_t* enc = new uint8_t[encSize];
+        compress ( enc, &encSize, raw, rawSize );
+        delete [] raw;
+        return new ImageDecoder ( new DataSourceDecoder<DeflateDecoder> ( new RawSource ( enc, encSize ) ), width, height, 3 );
+    }
+
+    /* Comme dans un GetMap, les bandes sont construites alors que l'arène de la requête est active */
+    void testDecodedBands() {
+        TaskPool pool ( 3 );
+        MemoryArena arena ( 64 * 1024 );
+        MemoryArena::setCurrent ( &arena );
+
+        std::vector<Image*> bands;
+        bands.push_back ( jpegBand ( 64, 16 ) );
+        bands.push_back ( deflateBand ( 64, 16, 16 ) );
+        bands.push_back ( jpegBand ( 64, 16 ) );
+        bands.push_back ( deflateBand ( 64, 16, 48 ) );
+        BandImage* image = new BandImage ( bands, &pool );
+        size_t allocations = arena.getAllocations();
+
+        uint8_t buffer[64 * 3];
+        for ( int l = 0; l < 64; l++ ) {
+            CPPUNIT_ASSERT_EQUAL ( 64 * 3, image->getline ( buffer, l ) );
+            if ( ( l / 16 ) % 2 == 0 ) {
+                CPPUNIT_ASSERT ( abs ( buffer[0] - 200 ) <= 3 && abs ( buffer[1] - 100 ) <= 3 && abs ( buffer[2] - 50 ) <= 3 );
+            } else {
+                for ( int i = 0; i < 64 * 3; i++ )
+                    CPPUNIT_ASSERT_EQUAL ( OffsetImage::value ( i / 3, l, i % 3 ), ( int ) buffer[i] );
+            }
+        }
+        // Seule la première bande, décodée par le thread appelant, alloue dans l'arène
+        CPPUNIT_ASSERT_EQUAL ( allocations + 1, arena.getAllocations() );
+
+        delete image;
+        MemoryArena::setCurrent ( NULL );
+    }
+
+    void testTileTable() {
+        int reads = 0;
+        TileTable* table = new TileTable();
+        int owner;
+
+        CPPUNIT_ASSERT ( table->find ( &owner, 1, 2, 1 ) == NULL );
+        DataSource* first = table->insert ( &owner, 1, 2, 1, new CountingSource ( &reads ) );
+        DataSource* second = table->find ( &owner, 1, 2, 1 );
+        CPPUNIT_ASSERT ( second != NULL );
+        CPPUNIT_ASSERT ( table->find ( &owner, 2, 1, 1 ) == NULL );
+        CPPUNIT_ASSERT_EQUAL ( 1, table->size() );
+
+        size_t size;
+        const uint8_t* d1 = first->getData ( size );
+        const uint8_t* d2 = second->getData ( size );
+        CPPUNIT_ASSERT ( d1 == d2 );
+        CPPUNIT_ASSERT_EQUAL ( ( size_t ) 4, size );
+
+        // Les sources d'accès ne possèdent pas la tuile
+        first->releaseData();
+        delete first;
+        CPPUNIT_ASSERT_EQUAL ( 7, ( int ) second->getData ( size ) [3] );
+        delete second;
+
+        TileTable::setCurrent ( table );
+        CPPUNIT_ASSERT ( TileTable::getCurrent() == table );
+        TileTable::setCurrent ( NULL );
+        delete table;
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitBandImage );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION ( CppUnitBandImage, "CppUnitBandImage" );
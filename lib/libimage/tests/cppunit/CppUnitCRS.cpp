@@ -47,6 +47,7 @@ class CppUnitCRS : public CPPUNIT_NS::TestFixture {
     CPPUNIT_TEST ( constructors );
     CPPUNIT_TEST ( getters );
     CPPUNIT_TEST ( setters );
+    CPPUNIT_TEST ( affine );
 
     CPPUNIT_TEST_SUITE_END();
 
@@ -70,6 +71,7 @@ public:
     void constructors();
     void getters();
     void setters();
+    void affine();
     //TODO BoundingBox
     //TODO MetersPerunit
     void tearDown();
@@ -165,6 +167,21 @@ void CppUnitCRS::setters() {
     CPPUNIT_ASSERT_MESSAGE ( "CRS Copy Constructor",crsempty.cmpRequestCode ( crs3->getRequestCode() ) );
 }
 
+void CppUnitCRS::affine() {
+    double Ax, Bx, Ay, By;
+    BoundingBox<double> france ( -5., 41., 10., 51. );
+
+    // Deux systèmes géographiques équivalents
+    CPPUNIT_ASSERT_MESSAGE ( "CRS affine transform", crs4->getAffineTransform ( *crs1, france, 1e-9, Ax, Bx, Ay, By ) );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL ( 1., Ax, 1e-9 );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL ( 0., Bx, 1e-9 );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL ( 1., Ay, 1e-9 );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL ( 0., By, 1e-9 );
+
+    // La projection Mercator n'est pas affine en latitude
+    BoundingBox<double> mercator = crs3->boundingBoxFromGeographic ( france );
+    CPPUNIT_ASSERT_MESSAGE ( "CRS not affine transform", !crs3->getAffineTransform ( *crs1, mercator, 1e-6, Ax, Bx, Ay, By ) );
+}
 
 void CppUnitCRS::tearDown() {
     delete crs1;
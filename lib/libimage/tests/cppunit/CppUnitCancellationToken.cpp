@@ -0,0 +1,100 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include "CancellationToken.h"
+
+class CppUnitCancellationToken : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitCancellationToken );
+    CPPUNIT_TEST ( explicitCancel );
+    CPPUNIT_TEST ( deadline );
+    CPPUNIT_TEST ( closedConnection );
+    CPPUNIT_TEST ( currentToken );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void explicitCancel();
+    void deadline();
+    void closedConnection();
+    void currentToken();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitCancellationToken );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION ( CppUnitCancellationToken, "CppUnitCancellationToken" );
+
+void CppUnitCancellationToken::explicitCancel() {
+    CancellationToken token;
+    CPPUNIT_ASSERT_MESSAGE ( "New token is not cancelled", ! token.isCancelled() );
+    token.cancel();
+    CPPUNIT_ASSERT_MESSAGE ( "Cancelled token", token.isCancelled() );
+    CPPUNIT_ASSERT_MESSAGE ( "Explicit cancellation is not a timeout", ! token.isTimedOut() );
+}
+
+void CppUnitCancellationToken::deadline() {
+    CancellationToken token ( 20 );
+    CPPUNIT_ASSERT_MESSAGE ( "Deadline not reached", ! token.isCancelled() );
+    usleep ( 40000 );
+    CPPUNIT_ASSERT_MESSAGE ( "Deadline reached", token.isCancelled() );
+    CPPUNIT_ASSERT_MESSAGE ( "Timed out", token.isTimedOut() );
+}
+
+void CppUnitCancellationToken::closedConnection() {
+    int fds[2];
+    CPPUNIT_ASSERT ( socketpair ( AF_UNIX, SOCK_STREAM, 0, fds ) == 0 );
+    CancellationToken token ( 0, fds[0] );
+    CPPUNIT_ASSERT_MESSAGE ( "Open connection", ! token.isCancelled() );
+    close ( fds[1] );
+    usleep ( 150000 );
+    CPPUNIT_ASSERT_MESSAGE ( "Closed connection", token.isCancelled() );
+    CPPUNIT_ASSERT_MESSAGE ( "Closed connection is not a timeout", ! token.isTimedOut() );
+    close ( fds[0] );
+}
+
+void CppUnitCancellationToken::currentToken() {
+    CPPUNIT_ASSERT_MESSAGE ( "No current token", ! CancellationToken::currentCancelled() );
+    CancellationToken token;
+    CancellationToken::setCurrent ( &token );
+    CPPUNIT_ASSERT ( CancellationToken::getCurrent() == &token );
+    CPPUNIT_ASSERT_MESSAGE ( "Current token not cancelled", ! CancellationToken::currentCancelled() );
+    token.cancel();
+    CPPUNIT_ASSERT_MESSAGE ( "Current token cancelled", CancellationToken::currentCancelled() );
+    CancellationToken::setCurrent ( NULL );
+    CPPUNIT_ASSERT ( CancellationToken::getCurrent() == NULL );
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <dirent.h>
+#include "Rok4Image.h"
+#include "FileDataSource.h"
+#include "CompoundImage.h"
+#include "EmptyImage.h"
+
+/**
+ * \~french \brief Image dont la moitié gauche est uniforme et la moitié droite un dégradé
+ * \~english \brief Image whose left half is uniform and right half a gradient
+ */
+class HalfUniformTestImage : public Image {
+public:
+    HalfUniformTestImage ( int width, int height, int channels ) : Image ( width, height, channels ) {}
+
+    static uint8_t value ( int x, int line, int c ) {
+        if ( x < 32 ) return ( uint8_t ) ( 10 * ( c + 1 ) );
+        return ( uint8_t ) ( x + 2 * line + 50 * c );
+    }
+
+    int getline ( uint8_t* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = value ( i / channels, line, i % channels );
+        return width * channels;
+    }
+    int getline ( uint16_t* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = value ( i / channels, line, i % channels );
+        return width * channels;
+    }
+    int getline ( float* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = value ( i / channels, line, i % channels );
+        return width * channels;
+    }
+};
+
+/**
+ * \~french \brief Stockage POSIX comptant les ouvertures de dalles
+ * \~english \brief POSIX storage counting slabs openings
+ */
+class CountingSlabStorage : public SlabStorage {
+public:
+    int opened;
+
+    CountingSlabStorage() : opened ( 0 ) {}
+
+    SlabObject* open ( const std::string& name ) {
+        opened++;
+        return SlabStorage::getPosix()->open ( name );
+    }
+
+    std::string getType() {
+        return "COUNTING";
+    }
+};
+
+class CppUnitConstantTile : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitConstantTile );
+    CPPUNIT_TEST ( testRok4Image );
+    CPPUNIT_TEST ( testCompoundImage );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    /* Nombre de descripteurs de fichier ouverts par le processus */
+    int openFiles() {
+        int count = 0;
+        DIR* dir = opendir ( "/proc/self/fd" );
+        if ( ! dir ) return -1;
+        while ( readdir ( dir ) ) count++;
+        closedir ( dir );
+        return count;
+    }
+
+public:
+    void testRok4Image() {
+        char filename[] = "CppUnitConstantTile.tif";
+        HalfUniformTestImage source ( 64, 64, 3 );
+
+        Rok4ImageFactory R4IF;
+        Rok4Image* output = R4IF.createRok4ImageToWrite ( filename, BoundingBox<double> ( 0.,0.,0.,0. ), -1, -1, 64, 64, 3,
+                            SampleFormat::UINT, 8, Photometric::RGB, Compression::DEFLATE, 32, 32 );
+        CPPUNIT_ASSERT ( output );
+        output->setConstantTiles ( true );
+        CPPUNIT_ASSERT_EQUAL ( 0, output->writeImage ( &source ) );
+        delete output;
+
+        // Les tuiles 0 et 2 sont uniformes et de même valeur : une seule valeur est écrite
+        uint32_t index[8];
+        std::ifstream file ( filename, std::ios::binary );
+        file.seekg ( ROK4_IMAGE_HEADER_SIZE );
+        file.read ( ( char* ) index, sizeof ( index ) );
+        file.close();
+        CPPUNIT_ASSERT_EQUAL ( index[0], index[2] );
+        CPPUNIT_ASSERT_EQUAL ( ( uint32_t ) 0, index[4] );
+        CPPUNIT_ASSERT_EQUAL ( ( uint32_t ) 0, index[6] );
+        CPPUNIT_ASSERT ( index[5] > 0 && index[7] > 0 );
+
+        uint8_t value[CONSTANT_TILE_VALUE_SIZE];
+        FileDataSource constant ( filename, ROK4_IMAGE_HEADER_SIZE, ROK4_IMAGE_HEADER_SIZE + 16, "" );
+        CPPUNIT_ASSERT ( constant.getConstantValue ( value ) );
+        CPPUNIT_ASSERT_EQUAL ( ( uint8_t ) 10, value[0] );
+        CPPUNIT_ASSERT_EQUAL ( ( uint8_t ) 30, value[2] );
+        size_t size;
+        CPPUNIT_ASSERT ( ! constant.getData ( size ) );
+
+        CountingSlabStorage storage;
+        FileDataSource gradient ( &storage, filename, ROK4_IMAGE_HEADER_SIZE + 4, ROK4_IMAGE_HEADER_SIZE + 20, "", "" );
+        int files = openFiles();
+        CPPUNIT_ASSERT ( ! gradient.getConstantValue ( value ) );
+        CPPUNIT_ASSERT ( gradient.getData ( size ) );
+        CPPUNIT_ASSERT_EQUAL ( ( size_t ) index[5], size );
+        // Une seule ouverture de la dalle pour le test et la lecture de la tuile, qui la ferme
+        CPPUNIT_ASSERT_EQUAL ( 1, storage.opened );
+        CPPUNIT_ASSERT_EQUAL ( files, openFiles() );
+
+        Rok4Image* input = R4IF.createRok4ImageToRead ( filename, BoundingBox<double> ( 0.,0.,0.,0. ), 0., 0. );
+        CPPUNIT_ASSERT ( input );
+        uint8_t line[64 * 3];
+        for ( int l = 0; l < 64; l += 21 ) {
+            input->getline ( line, l );
+            for ( int i = 0; i < 64 * 3; i++ ) {
+                CPPUNIT_ASSERT_EQUAL ( HalfUniformTestImage::value ( i / 3, l, i % 3 ), line[i] );
+            }
+        }
+        delete input;
+        remove ( filename );
+    }
+
+    void testCompoundImage() {
+        float left[2] = { -5.5f, 12.f };
+        float right[2] = { 3.f, 4.f };
+        std::vector<std::vector<Image*> > images ( 1, std::vector<Image*> ( 2 ) );
+        images[0][0] = new EmptyImage ( 3, 4, 2, left );
+        images[0][1] = new EmptyImage ( 2, 4, 2, right );
+        CPPUNIT_ASSERT ( images[0][0]->getConstantColor() );
+        CompoundImage compound ( images );
+        CPPUNIT_ASSERT ( ! compound.getConstantColor() );
+
+        float block[3 * 5 * 2];
+        CPPUNIT_ASSERT ( compound.getBlock ( 0, 1, 5, 3, block, 5 * 2 ) );
+        for ( int l = 0; l < 3; l++ ) {
+            for ( int x = 0; x < 5; x++ ) {
+                CPPUNIT_ASSERT_EQUAL ( x < 3 ? left[0] : right[0], block[l * 10 + x * 2] );
+                CPPUNIT_ASSERT_EQUAL ( x < 3 ? left[1] : right[1], block[l * 10 + x * 2 + 1] );
+            }
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitConstantTile );
@@ -0,0 +1,157 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdlib>
+#include "EncoderProfile.h"
+#include "PNGEncoder.h"
+#include "JPEGEncoder.h"
+#include "Decoder.h"
+
+/**
+ * \~french \brief Image en dégradé, avec un peu de bruit
+ * \~english \brief Gradient image, with some noise
+ */
+class GradientImage : public Image {
+public:
+    GradientImage ( int width, int height, int channels ) : Image ( width, height, channels ) {}
+
+    static uint8_t value ( int x, int line, int c ) {
+        return ( x * 2 + line * 3 + c * 50 + ( ( x * 7 + line * 13 ) % 5 ) ) % 256;
+    }
+
+    template<typename T>
+    int fill ( T* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = ( T ) value ( i / channels, line, i % channels );
+        return width * channels;
+    }
+
+    int getline ( uint8_t* buffer, int line ) {
+        return fill ( buffer, line );
+    }
+    int getline ( uint16_t* buffer, int line ) {
+        return fill ( buffer, line );
+    }
+    int getline ( float* buffer, int line ) {
+        return fill ( buffer, line );
+    }
+};
+
+class CppUnitEncoderProfile : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitEncoderProfile );
+    CPPUNIT_TEST ( testProfiles );
+    CPPUNIT_TEST ( testFilters );
+    CPPUNIT_TEST ( testPng );
+    CPPUNIT_TEST ( testJpeg );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testProfiles();
+    void testFilters();
+    void testPng();
+    void testJpeg();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitEncoderProfile );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION ( CppUnitEncoderProfile, "CppUnitEncoderProfile" );
+
+void CppUnitEncoderProfile::testProfiles() {
+    CPPUNIT_ASSERT ( EncoderProfile::get ( "fast" ) == EncoderProfile::getFastest() );
+    CPPUNIT_ASSERT ( EncoderProfile::get ( "balanced" ) == EncoderProfile::getDefault() );
+    CPPUNIT_ASSERT ( EncoderProfile::get ( "small" ) );
+    CPPUNIT_ASSERT ( EncoderProfile::get ( "huge" ) == NULL );
+    // Le profil par défaut conserve les réglages historiques
+    CPPUNIT_ASSERT_EQUAL ( 5, EncoderProfile::getDefault()->pngLevel );
+    CPPUNIT_ASSERT_EQUAL ( 6, EncoderProfile::getDefault()->deflateLevel );
+    CPPUNIT_ASSERT_EQUAL ( 75, EncoderProfile::getDefault()->jpegQuality );
+    CPPUNIT_ASSERT ( PngFilter::fromString ( "paeth" ) == PngFilter::PAETH );
+    CPPUNIT_ASSERT ( PngFilter::fromString ( "unknown" ) == PngFilter::NONE );
+}
+
+void CppUnitEncoderProfile::testFilters() {
+    const int length = 3 * 37;
+    uint8_t lines[3][length];
+    for ( int l = 0; l < 3; l++ )
+        for ( int i = 0; i < length; i++ ) lines[l][i] = GradientImage::value ( i / 3, l, i % 3 ) ^ ( rand() & 15 );
+
+    uint8_t filtered[length + 1];
+    for ( int f = PngFilter::NONE; f <= PngFilter::ADAPTIVE; f++ ) {
+        for ( int l = 0; l < 3; l++ ) {
+            const uint8_t* previous = l ? lines[l-1] : NULL;
+            PngFilter::apply ( ( PngFilter::ePngFilter ) f, lines[l], previous, length, 3, filtered );
+            CPPUNIT_ASSERT ( filtered[0] <= PngFilter::PAETH );
+            if ( f != PngFilter::ADAPTIVE ) CPPUNIT_ASSERT_EQUAL ( f, ( int ) filtered[0] );
+            PngFilter::revert ( ( PngFilter::ePngFilter ) filtered[0], filtered + 1, previous, length, 3 );
+            CPPUNIT_ASSERT ( memcmp ( filtered + 1, lines[l], length ) == 0 );
+        }
+    }
+}
+
+void CppUnitEncoderProfile::testPng() {
+    const char* names[3] = {"fast", "balanced", "small"};
+    for ( int p = 0; p < 3; p++ ) {
+        PNGEncoder encoder ( new GradientImage ( 48, 48, 3 ), NULL, EncoderProfile::get ( names[p] ) );
+        BufferedDataSource source ( encoder );
+        size_t size;
+        const uint8_t* data = PngDecoder::decode ( &source, size );
+        CPPUNIT_ASSERT ( data );
+        CPPUNIT_ASSERT_EQUAL ( ( size_t ) 48*48*3, size );
+        for ( int i = 0; i < 48*48*3; i++ ) {
+            CPPUNIT_ASSERT_EQUAL ( ( int ) GradientImage::value ( ( i / 3 ) % 48, i / ( 48*3 ), i % 3 ), ( int ) data[i] );
+        }
+        PngDecoder::release ( data );
+    }
+}
+
+void CppUnitEncoderProfile::testJpeg() {
+    size_t sizes[3];
+    const char* names[3] = {"fast", "balanced", "small"};
+    for ( int p = 0; p < 3; p++ ) {
+        JPEGEncoder encoder ( new GradientImage ( 64, 64, 3 ), EncoderProfile::get ( names[p] ) );
+        BufferedDataSource source ( encoder );
+        const uint8_t* encoded = source.getData ( sizes[p] );
+        CPPUNIT_ASSERT ( encoded && sizes[p] > 0 );
+        size_t size;
+        const uint8_t* data = JpegDecoder::decode ( &source, size );
+        CPPUNIT_ASSERT ( data );
+        CPPUNIT_ASSERT_EQUAL ( ( size_t ) 64*64*3, size );
+        JpegDecoder::release ( data );
+    }
+    // Tables de Huffman optimisées : même image, moins d'octets
+    CPPUNIT_ASSERT ( sizes[2] < sizes[1] );
+}
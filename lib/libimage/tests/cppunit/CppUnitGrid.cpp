@@ -0,0 +1,125 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "Grid.h"
+#include <cmath>
+
+class CppUnitGrid : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitGrid );
+    // enregistrement des methodes de tests à jouer :
+    CPPUNIT_TEST ( testFixedStep );
+    CPPUNIT_TEST ( testAdaptiveStep );
+    CPPUNIT_TEST ( testCache );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    BoundingBox<double> bbox;
+
+public:
+    CppUnitGrid() : bbox ( 500000, 6500000, 501000, 6501000 ) {}
+
+    void setUp() {};
+
+    void tearDown() {
+        Grid::configure ( 0., 0 );
+    }
+
+protected:
+
+    void testFixedStep() {
+        Grid::configure ( 0., 0 );
+        Grid grid ( 800, 600, bbox );
+        CPPUNIT_ASSERT ( grid.reproject ( "IGNF:LAMBE", "IGNF:LAMB93" ) );
+        CPPUNIT_ASSERT_EQUAL ( GRID_DEFAULT_STEP, grid.getStep() );
+    }
+
+    void testAdaptiveStep() {
+        Grid fixed ( 800, 600, bbox );
+        Grid::configure ( 0., 0 );
+        CPPUNIT_ASSERT ( fixed.reproject ( "IGNF:LAMBE", "IGNF:LAMB93" ) );
+
+        // Sur une petite emprise, la transformation est quasi affine : un pas large suffit
+        Grid::configure ( 0.1, 0 );
+        Grid adaptive ( 800, 600, bbox );
+        CPPUNIT_ASSERT ( adaptive.reproject ( "IGNF:LAMBE", "IGNF:LAMB93" ) );
+        CPPUNIT_ASSERT ( adaptive.getStep() > GRID_DEFAULT_STEP );
+
+        // Les deux grilles donnent les mêmes coordonnées, à la précision des flottants près
+        float X1[800], Y1[800], X2[800], Y2[800];
+        for ( int l = 0; l < 600; l += 7 ) {
+            fixed.getline ( l, X1, Y1 );
+            adaptive.getline ( l, X2, Y2 );
+            for ( int i = 0; i < 800; i++ ) {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL ( X1[i], X2[i], 2. );
+                CPPUNIT_ASSERT_DOUBLES_EQUAL ( Y1[i], Y2[i], 2. );
+            }
+        }
+    }
+
+    void testCache() {
+        Grid::configure ( 0.1, 2 );
+
+        Grid first ( 800, 600, bbox );
+        CPPUNIT_ASSERT ( first.reproject ( "IGNF:LAMBE", "IGNF:LAMB93" ) );
+
+        // La même grille est recopiée depuis le cache
+        Grid second ( 800, 600, bbox );
+        CPPUNIT_ASSERT ( second.reproject ( "IGNF:LAMBE", "IGNF:LAMB93" ) );
+        CPPUNIT_ASSERT_EQUAL ( first.getStep(), second.getStep() );
+        CPPUNIT_ASSERT_EQUAL ( first.bbox.xmin, second.bbox.xmin );
+        CPPUNIT_ASSERT_EQUAL ( first.bbox.ymax, second.bbox.ymax );
+
+        float X1[800], Y1[800], X2[800], Y2[800];
+        first.getline ( 300, X1, Y1 );
+        second.getline ( 300, X2, Y2 );
+        for ( int i = 0; i < 800; i++ ) {
+            CPPUNIT_ASSERT_EQUAL ( X1[i], X2[i] );
+            CPPUNIT_ASSERT_EQUAL ( Y1[i], Y2[i] );
+        }
+
+        // Une grille de dimensions différentes n'est pas confondue
+        Grid other ( 400, 300, bbox );
+        CPPUNIT_ASSERT ( other.reproject ( "IGNF:LAMBE", "IGNF:LAMB93" ) );
+        CPPUNIT_ASSERT_EQUAL ( 400, other.width );
+        other.getline ( 299, X2, Y2 );
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitGrid );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION ( CppUnitGrid, "CppUnitGrid" );
@@ -0,0 +1,184 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "CompoundImage.h"
+#include "Decoder.h"
+#include <vector>
+
+/**
+ * \~french \brief Image dont chaque échantillon dépend de sa position
+ * \~english \brief Image whose each sample depends on its position
+ */
+class PositionImage : public Image {
+public:
+    PositionImage ( int width, int height, int channels ) : Image ( width, height, channels ) {}
+
+    static int value ( int x, int line, int c ) {
+        return ( x * 7 + line * 13 + c * 29 ) % 256;
+    }
+
+    template<typename T>
+    int fill ( T* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = ( T ) value ( i / channels, line, i % channels );
+        return width * channels;
+    }
+
+    int getline ( uint8_t* buffer, int line ) {
+        return fill ( buffer, line );
+    }
+    int getline ( uint16_t* buffer, int line ) {
+        return fill ( buffer, line );
+    }
+    int getline ( float* buffer, int line ) {
+        return fill ( buffer, line );
+    }
+};
+
+/**
+ * \~french \brief Source de données brutes en mémoire
+ * \~english \brief In-memory raw data source
+ */
+class RawSource : public DataSource {
+public:
+    std::vector<uint8_t> data;
+
+    const uint8_t* getData ( size_t& size ) {
+        size = data.size();
+        return &data[0];
+    }
+    bool releaseData() {
+        return false;
+    }
+    std::string getType() {
+        return "";
+    }
+    int getHttpStatus() {
+        return 200;
+    }
+    std::string getEncoding() {
+        return "";
+    }
+};
+
+class CppUnitImageBlock : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitImageBlock );
+    CPPUNIT_TEST ( testFromLines );
+    CPPUNIT_TEST ( testCompound );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+
+    /* Image décodée de position (x0,y0) dans l'image PositionImage globale, avec une marge d'un pixel à gauche */
+    ImageDecoder* createDecoder ( int x0, int y0, int width, int height, int channels ) {
+        RawSource* source = new RawSource();
+        for ( int l = 0; l < height; l++ )
+            for ( int x = -1; x < width; x++ )
+                for ( int c = 0; c < channels; c++ )
+                    source->data.push_back ( ( uint8_t ) PositionImage::value ( x0 + x, y0 + l, c ) );
+        return new ImageDecoder ( source, width + 1, height, channels, BoundingBox<double> ( 0., 0., width, height ), 1 );
+    }
+
+    void testFromLines() {
+        PositionImage image ( 30, 20, 3 );
+        uint8_t buffer[8 * 50];
+        memset ( buffer, 0, sizeof ( buffer ) );
+
+        CPPUNIT_ASSERT_EQUAL ( 10 * 8 * 3, image.getBlock ( 5, 7, 10, 8, buffer, 50 ) );
+        for ( int l = 0; l < 8; l++ ) {
+            for ( int i = 0; i < 30; i++ )
+                CPPUNIT_ASSERT_EQUAL ( PositionImage::value ( 5 + i / 3, 7 + l, i % 3 ), ( int ) buffer[l * 50 + i] );
+            // Rien n'est écrit au delà de la largeur du bloc
+            for ( int i = 30; i < 50; i++ ) CPPUNIT_ASSERT_EQUAL ( 0, ( int ) buffer[l * 50 + i] );
+        }
+
+        float fbuffer[2 * 90];
+        CPPUNIT_ASSERT_EQUAL ( 2 * 90, image.getBlock ( 0, 18, 30, 2, fbuffer, 90 ) );
+        CPPUNIT_ASSERT_EQUAL ( ( float ) PositionImage::value ( 29, 19, 2 ), fbuffer[179] );
+
+        CPPUNIT_ASSERT_EQUAL ( 0, image.getBlock ( 25, 0, 10, 2, buffer, 50 ) );
+        CPPUNIT_ASSERT_EQUAL ( 0, image.getBlock ( 0, -1, 10, 2, buffer, 50 ) );
+    }
+
+    void testCompound() {
+        int channels = 2;
+        int widths[3] = { 12, 9, 16 };
+        int heights[2] = { 10, 7 };
+
+        std::vector<std::vector<Image*> > images;
+        int y0 = 0;
+        for ( int j = 0; j < 2; j++ ) {
+            std::vector<Image*> row;
+            int x0 = 0;
+            for ( int i = 0; i < 3; i++ ) {
+                row.push_back ( createDecoder ( x0, y0, widths[i], heights[j], channels ) );
+                x0 += widths[i];
+            }
+            images.push_back ( row );
+            y0 += heights[j];
+        }
+        CompoundImage compound ( images );
+
+        // Bloc à cheval sur les 6 sous-images
+        int x = 5, y = 4, w = 25, h = 11;
+        int stride = w * channels + 3;
+        uint8_t* block = new uint8_t[h * stride];
+        float* fblock = new float[h * stride];
+        uint8_t* line = new uint8_t[compound.getWidth() * channels];
+
+        CPPUNIT_ASSERT_EQUAL ( w * h * channels, compound.getBlock ( x, y, w, h, block, stride ) );
+        CPPUNIT_ASSERT_EQUAL ( w * h * channels, compound.getBlock ( x, y, w, h, fblock, stride ) );
+
+        for ( int l = 0; l < h; l++ ) {
+            compound.getline ( line, y + l );
+            for ( int i = 0; i < w * channels; i++ ) {
+                int expected = PositionImage::value ( x + i / channels, y + l, i % channels );
+                CPPUNIT_ASSERT_EQUAL ( expected, ( int ) line[x * channels + i] );
+                CPPUNIT_ASSERT_EQUAL ( expected, ( int ) block[l * stride + i] );
+                CPPUNIT_ASSERT_EQUAL ( ( float ) expected, fblock[l * stride + i] );
+            }
+        }
+
+        delete [] block;
+        delete [] fblock;
+        delete [] line;
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitImageBlock );
@@ -0,0 +1,95 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdlib>
+#include "Decoder.h"
+#include "EmptyImage.h"
+#include "JPEGEncoder.h"
+
+class CppUnitJpegDecoder : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitJpegDecoder );
+    CPPUNIT_TEST ( fullResolution );
+    CPPUNIT_TEST ( reducedResolution );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    DataSource* encodeTile ( int width, int height );
+
+public:
+    void fullResolution();
+    void reducedResolution();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitJpegDecoder );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION ( CppUnitJpegDecoder, "CppUnitJpegDecoder" );
+
+DataSource* CppUnitJpegDecoder::encodeTile ( int width, int height ) {
+    int color[3] = {200, 100, 50};
+    JPEGEncoder encoder ( new EmptyImage ( width, height, 3, color ) );
+    return new BufferedDataSource ( encoder );
+}
+
+void CppUnitJpegDecoder::fullResolution() {
+    DataSource* tile = encodeTile ( 64, 64 );
+    size_t size;
+    const uint8_t* data = JpegDecoder::decode ( tile, size );
+    CPPUNIT_ASSERT ( data );
+    CPPUNIT_ASSERT_EQUAL ( ( size_t ) 64*64*3, size );
+    JpegDecoder::release ( data );
+    delete tile;
+}
+
+void CppUnitJpegDecoder::reducedResolution() {
+    DataSource* tile = encodeTile ( 64, 64 );
+    int scales[3] = {2, 4, 8};
+    for ( int i = 0; i < 3; i++ ) {
+        int side = 64 / scales[i];
+        size_t size;
+        const uint8_t* data = JpegDecoder::decode ( tile, size, NULL, scales[i] );
+        CPPUNIT_ASSERT ( data );
+        CPPUNIT_ASSERT_EQUAL ( ( size_t ) side*side*3, size );
+        // La couleur uniforme est conservée aux pertes JPEG près
+        CPPUNIT_ASSERT ( abs ( data[0] - 200 ) <= 3 && abs ( data[1] - 100 ) <= 3 && abs ( data[2] - 50 ) <= 3 );
+        JpegDecoder::release ( data );
+    }
+    size_t size;
+    DataSourceDecoder<ScaledJpegDecoder<4> > decoder ( tile );
+    CPPUNIT_ASSERT ( decoder.getData ( size ) );
+    CPPUNIT_ASSERT_EQUAL ( ( size_t ) 16*16*3, size );
+}
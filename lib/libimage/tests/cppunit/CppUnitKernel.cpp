@@ -50,6 +50,7 @@ class CppUnitKernel : public CPPUNIT_NS::TestFixture {
     CPPUNIT_TEST_SUITE ( CppUnitKernel );
     // enregistrement des methodes de tests à jouer :
     CPPUNIT_TEST ( testKernel );
+    CPPUNIT_TEST ( testWeightTable );
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -95,6 +96,31 @@ protected:
         }
     }
 
+    void testWeightTable() {
+
+        float W[100], Wt[100];
+        const Kernel &K = Kernel::getInstance ( Interpolation::LANCZOS_3 );
+
+        // Une même table est partagée entre les appels
+        const WeightTable* table = K.getWeightTable ( 6 );
+        CPPUNIT_ASSERT ( table == K.getWeightTable ( 6 ) );
+        CPPUNIT_ASSERT ( table != K.getWeightTable ( 12 ) );
+        CPPUNIT_ASSERT ( table->getStride() % 4 == 0 );
+
+        for ( int i = 0; i < 1000; i++ ) {
+            // Coordonnées alignées sur une phase : les poids tabulés sont exactement ceux du noyau
+            double x = double ( rand() % ( 100 * KERNEL_PHASES ) ) / KERNEL_PHASES;
+            int l = 6, lt = 6;
+
+            int xmin = K.weight ( W, l, x, 100 );
+            int xmint = table->weight ( Wt, lt, x, 100 );
+
+            CPPUNIT_ASSERT_EQUAL ( xmin, xmint );
+            CPPUNIT_ASSERT_EQUAL ( l, lt );
+            for ( int j = 0; j < l; j++ ) CPPUNIT_ASSERT_DOUBLES_EQUAL ( W[j], Wt[j], 1e-6 );
+        }
+    }
+
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitKernel );
@@ -0,0 +1,184 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include "Rok4Image.h"
+#include "FileDataSource.h"
+#include "MappedSlabStorage.h"
+
+/**
+ * \~french \brief Image de test dont le motif dépend d'une graine
+ * \~english \brief Test image whose pattern depends on a seed
+ */
+class MappedSlabTestImage : public Image {
+private:
+    int seed;
+public:
+    MappedSlabTestImage ( int width, int height, int channels, int seed ) : Image ( width, height, channels ), seed ( seed ) {}
+
+    int getline ( uint8_t* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = ( uint8_t ) ( i * seed + line );
+        return width * channels;
+    }
+    int getline ( uint16_t* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = ( uint8_t ) ( i * seed + line );
+        return width * channels;
+    }
+    int getline ( float* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = ( uint8_t ) ( i * seed + line );
+        return width * channels;
+    }
+};
+
+class CppUnitMappedSlabStorage : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitMappedSlabStorage );
+    CPPUNIT_TEST ( testTiles );
+    CPPUNIT_TEST ( testSize );
+    CPPUNIT_TEST ( testReplacedSlab );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    // Écrit une dalle de 2x2 tuiles de 16x16 pixels
+    void writeSlab ( const char* filename, int seed ) {
+        MappedSlabTestImage source ( 32, 32, 3, seed );
+        Rok4ImageFactory R4IF;
+        Rok4Image* output = R4IF.createRok4ImageToWrite ( ( char* ) filename, BoundingBox<double> ( 0.,0.,0.,0. ), -1, -1, 32, 32, 3,
+                            SampleFormat::UINT, 8, Photometric::RGB, Compression::NONE, 16, 16 );
+        CPPUNIT_ASSERT ( output );
+        CPPUNIT_ASSERT_EQUAL ( 0, output->writeImage ( &source ) );
+        delete output;
+    }
+
+    // Vérifie que la tuile n lue dans le stockage est celle lue avec pread
+    void checkTile ( FileDataSource& source, const char* filename, int n ) {
+        FileDataSource local ( filename, 2048 + 4 * n, 2048 + 16 + 4 * n, "image/tiff", "" );
+        size_t localSize, size;
+        const uint8_t* localData = local.getData ( localSize );
+        const uint8_t* data = source.getData ( size );
+        CPPUNIT_ASSERT ( localData && data );
+        CPPUNIT_ASSERT_EQUAL ( localSize, size );
+        CPPUNIT_ASSERT ( memcmp ( localData, data, size ) == 0 );
+    }
+
+public:
+    void testTiles() {
+        const char* filename = "CppUnitMappedSlabStorage.tif";
+        writeSlab ( filename, 7 );
+        MappedSlabStorage storage;
+
+        FileDataSource tile0 ( &storage, filename, 2048, 2048 + 16, "image/tiff", "" );
+        FileDataSource tile3 ( &storage, filename, 2048 + 12, 2048 + 28, "image/tiff", "" );
+        checkTile ( tile0, filename, 0 );
+        checkTile ( tile3, filename, 3 );
+        CPPUNIT_ASSERT_EQUAL ( 1, storage.getMappingsCount() );
+
+        // Les tuiles sont lues dans la projection, sans copie
+        FileDataSource again ( &storage, filename, 2048, 2048 + 16, "image/tiff", "" );
+        size_t size;
+        CPPUNIT_ASSERT ( again.getData ( size ) == tile0.getData ( size ) );
+
+        FileDataSource missing ( &storage, "CppUnitMappedSlabStorage-missing.tif", 2048, 2048 + 16, "image/tiff", "" );
+        CPPUNIT_ASSERT ( missing.getData ( size ) == NULL );
+        remove ( filename );
+    }
+
+    void testSize() {
+        const char* filename1 = "CppUnitMappedSlabStorage1.tif";
+        const char* filename2 = "CppUnitMappedSlabStorage2.tif";
+        writeSlab ( filename1, 3 );
+        writeSlab ( filename2, 5 );
+        FILE* file = fopen ( filename1, "r" );
+        fseek ( file, 0, SEEK_END );
+        size_t slabSize = ftell ( file );
+        fclose ( file );
+
+        // Une seule dalle tient dans la taille maximale : la moins récente est oubliée
+        MappedSlabStorage storage ( slabSize + slabSize / 2 );
+        {
+            FileDataSource tile1 ( &storage, filename1, 2048, 2048 + 16, "image/tiff", "" );
+            checkTile ( tile1, filename1, 0 );
+        }
+        FileDataSource tile2 ( &storage, filename2, 2048 + 4, 2048 + 20, "image/tiff", "" );
+        checkTile ( tile2, filename2, 1 );
+        CPPUNIT_ASSERT_EQUAL ( 1, storage.getMappingsCount() );
+        CPPUNIT_ASSERT_EQUAL ( slabSize, storage.getMappedSize() );
+
+        // Dalle plus grande que la taille maximale : lecture avec pread
+        storage.setMaxSize ( slabSize / 2 );
+        CPPUNIT_ASSERT_EQUAL ( 0, storage.getMappingsCount() );
+        FileDataSource tile3 ( &storage, filename1, 2048 + 12, 2048 + 28, "image/tiff", "" );
+        checkTile ( tile3, filename1, 3 );
+        CPPUNIT_ASSERT_EQUAL ( 0, storage.getMappingsCount() );
+        checkTile ( tile2, filename2, 1 );
+
+        remove ( filename1 );
+        remove ( filename2 );
+    }
+
+    void testReplacedSlab() {
+        const char* filename = "CppUnitMappedSlabStorage.tif";
+        const char* newFilename = "CppUnitMappedSlabStorage-new.tif";
+        writeSlab ( filename, 7 );
+        MappedSlabStorage storage;
+
+        FileDataSource before ( &storage, filename, 2048, 2048 + 16, "image/tiff", "" );
+        size_t size;
+        const uint8_t* data = before.getData ( size );
+        CPPUNIT_ASSERT ( data );
+        std::string content ( ( const char* ) data, size );
+
+        // Remplacement de la dalle par renommage, détecté après MAPPED_SLAB_CHECK_DELAY
+        writeSlab ( newFilename, 11 );
+        CPPUNIT_ASSERT_EQUAL ( 0, rename ( newFilename, filename ) );
+        sleep ( MAPPED_SLAB_CHECK_DELAY + 1 );
+
+        FileDataSource after ( &storage, filename, 2048, 2048 + 16, "image/tiff", "" );
+        checkTile ( after, filename, 0 );
+        CPPUNIT_ASSERT ( memcmp ( after.getData ( size ), content.data(), size ) != 0 );
+        CPPUNIT_ASSERT_EQUAL ( 1, storage.getMappingsCount() );
+
+        // L'ancienne projection reste lisible tant que la tuile n'est pas libérée
+        CPPUNIT_ASSERT ( memcmp ( data, content.data(), content.size() ) == 0 );
+        remove ( filename );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitMappedSlabStorage );
@@ -0,0 +1,108 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <stdint.h>
+#include <cstring>
+#include "MemoryArena.h"
+
+class CppUnitMemoryArena : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitMemoryArena );
+    CPPUNIT_TEST ( alignment );
+    CPPUNIT_TEST ( largeAllocation );
+    CPPUNIT_TEST ( reset );
+    CPPUNIT_TEST ( currentArena );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void alignment();
+    void largeAllocation();
+    void reset();
+    void currentArena();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitMemoryArena );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION ( CppUnitMemoryArena, "CppUnitMemoryArena" );
+
+void CppUnitMemoryArena::alignment() {
+    MemoryArena arena ( 4096 );
+    size_t alignments[3] = {16, 32, 64};
+    for ( int i = 0; i < 30; i++ ) {
+        size_t align = alignments[i%3];
+        uint8_t* ptr = ( uint8_t* ) arena.allocate ( 1 + i * 7, align );
+        CPPUNIT_ASSERT_MESSAGE ( "Arena allocation alignment", ( ( uintptr_t ) ptr ) % align == 0 );
+        memset ( ptr, 0xFF, 1 + i * 7 );
+        MemoryArena::release ( ptr );
+    }
+    uint8_t* heap = ( uint8_t* ) MemoryArena::alloc ( NULL, 100, 64 );
+    CPPUNIT_ASSERT_MESSAGE ( "Heap allocation alignment", ( ( uintptr_t ) heap ) % 64 == 0 );
+    MemoryArena::release ( heap );
+}
+
+void CppUnitMemoryArena::largeAllocation() {
+    MemoryArena arena ( 1024 );
+    uint8_t* small = ( uint8_t* ) arena.allocate ( 100 );
+    uint8_t* large = ( uint8_t* ) arena.allocate ( 10000 );
+    memset ( large, 0, 10000 );
+    CPPUNIT_ASSERT ( small != large );
+    CPPUNIT_ASSERT_MESSAGE ( "A dedicated block is added", arena.getReservedSize() >= 1024 + 10000 );
+    CPPUNIT_ASSERT_EQUAL ( ( size_t ) 2, arena.getAllocations() );
+}
+
+void CppUnitMemoryArena::reset() {
+    MemoryArena arena ( 1024 );
+    void* first = arena.allocate ( 100 );
+    arena.allocate ( 10000 );
+    arena.reset();
+    CPPUNIT_ASSERT_EQUAL ( ( size_t ) 1024, arena.getReservedSize() );
+    CPPUNIT_ASSERT_EQUAL ( ( size_t ) 0, arena.getAllocations() );
+    CPPUNIT_ASSERT_MESSAGE ( "The first block is reused", arena.allocate ( 100 ) == first );
+}
+
+void CppUnitMemoryArena::currentArena() {
+    CPPUNIT_ASSERT ( MemoryArena::getCurrent() == NULL );
+    MemoryArena arena ( 1024 );
+    MemoryArena::setCurrent ( &arena );
+    void* ptr = MemoryArena::alloc ( 10 );
+    CPPUNIT_ASSERT_EQUAL ( ( size_t ) 1, arena.getAllocations() );
+    MemoryArena::release ( ptr );
+    MemoryArena::setCurrent ( NULL );
+    ptr = MemoryArena::alloc ( 10 );
+    CPPUNIT_ASSERT_EQUAL ( ( size_t ) 1, arena.getAllocations() );
+    MemoryArena::release ( ptr );
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "MergeImage.h"
+#include "StyledImage.h"
+#include "EmptyImage.h"
+#include <sys/time.h>
+#include <iostream>
+#include <map>
+
+using namespace std;
+
+class CppUnitMergeImage : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitMergeImage );
+    CPPUNIT_TEST ( testMerge );
+    CPPUNIT_TEST ( testAlphaTop );
+    CPPUNIT_TEST ( testMultiply );
+    CPPUNIT_TEST ( performance );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+
+    MergeImage* createMerge ( int width, int height, int layers, int channels, Merge::eMergeType composition ) {
+        std::vector<Image*> images;
+        for ( int i = 0; i < layers; i++ ) {
+            int color[4] = { 10 * i, 20 * i, 30 * i, 255 };
+            images.push_back ( new EmptyImage ( width, height, channels, color ) );
+        }
+        int bg[3] = { 255, 255, 255 };
+        MergeImageFactory MIF;
+        return MIF.createMergeImage ( images, 3, bg, NULL, composition );
+    }
+
+    void testMerge() {
+        MergeImage* M = createMerge ( 50, 10, 3, 3, Merge::NORMAL );
+        uint8_t buffer[50 * 3];
+        float fbuffer[50 * 3];
+        for ( int l = 0; l < 10; l++ ) {
+            M->getline ( buffer, l );
+            M->getline ( fbuffer, l );
+            for ( int i = 0; i < 50; i++ ) {
+                CPPUNIT_ASSERT_EQUAL ( 20, ( int ) buffer[3*i] );
+                CPPUNIT_ASSERT_EQUAL ( 40, ( int ) buffer[3*i+1] );
+                CPPUNIT_ASSERT_EQUAL ( 60, ( int ) buffer[3*i+2] );
+                CPPUNIT_ASSERT_DOUBLES_EQUAL ( 60., fbuffer[3*i+2], 1e-4 );
+            }
+        }
+        delete M;
+    }
+
+    void testAlphaTop() {
+        int colors[2][4] = { { 200, 100, 50, 128 }, { 10, 20, 30, 64 } };
+        std::vector<Image*> images;
+        for ( int i = 0; i < 2; i++ ) images.push_back ( new EmptyImage ( 37, 3, 4, colors[i] ) );
+        int bg[4] = { 255, 255, 255, 255 };
+        MergeImageFactory MIF;
+        MergeImage* M = MIF.createMergeImage ( images, 4, bg, NULL, Merge::ALPHATOP );
+
+        // Formule de l'alpha-blending, avec alpha non-associé
+        double pix[3] = { 255., 255., 255. }, al = 1.;
+        for ( int i = 0; i < 2; i++ ) {
+            double alAb = colors[i][3] / 255.;
+            double a = alAb + al * ( 1. - alAb );
+            for ( int c = 0; c < 3; c++ ) pix[c] = ( alAb * colors[i][c] + al * pix[c] * ( 1. - alAb ) ) / a;
+            al = a;
+        }
+
+        uint8_t buffer[37 * 4];
+        M->getline ( buffer, 1 );
+        for ( int i = 0; i < 37; i++ ) {
+            for ( int c = 0; c < 3; c++ ) CPPUNIT_ASSERT_DOUBLES_EQUAL ( pix[c], buffer[4*i+c], 1. );
+            CPPUNIT_ASSERT_DOUBLES_EQUAL ( al * 255., buffer[4*i+3], 1. );
+        }
+        delete M;
+    }
+
+    void testMultiply() {
+        MergeImage* M = createMerge ( 37, 3, 3, 3, Merge::MULTIPLY );
+        uint8_t buffer[37 * 3];
+        M->getline ( buffer, 2 );
+        // Fond blanc, puis (0,0,0), (10,20,30), (20,40,60) : le noir l'emporte
+        for ( int i = 0; i < 37 * 3; i++ ) CPPUNIT_ASSERT_EQUAL ( 0, ( int ) buffer[i] );
+        delete M;
+
+        int colors[2][3] = { { 200, 100, 50 }, { 128, 255, 64 } };
+        std::vector<Image*> images;
+        for ( int i = 0; i < 2; i++ ) images.push_back ( new EmptyImage ( 37, 3, 3, colors[i] ) );
+        int bg[3] = { 255, 255, 255 };
+        MergeImageFactory MIF;
+        M = MIF.createMergeImage ( images, 3, bg, NULL, Merge::MULTIPLY );
+        M->getline ( buffer, 0 );
+        for ( int i = 0; i < 37; i++ ) {
+            for ( int c = 0; c < 3; c++ ) CPPUNIT_ASSERT_DOUBLES_EQUAL ( colors[0][c] * colors[1][c] / 255., buffer[3*i+c], 1. );
+        }
+        delete M;
+    }
+
+    void performance() {
+        int width = 2048, height = 2048;
+        uint8_t buffer[width * 4];
+        timeval BEGIN, NOW;
+
+        MergeImage* M = createMerge ( width, height, 4, 4, Merge::ALPHATOP );
+        gettimeofday ( &BEGIN, NULL );
+        for ( int l = 0; l < height; l++ ) M->getline ( buffer, l );
+        gettimeofday ( &NOW, NULL );
+        double time = NOW.tv_sec - BEGIN.tv_sec + ( NOW.tv_usec - BEGIN.tv_usec ) /1000000.;
+        cerr << int ( height / time ) << " lignes/s : fusion ALPHATOP de 4 images " << width << "x" << height << endl;
+        delete M;
+
+        std::map<double, Colour> colours;
+        colours.insert ( std::pair<double, Colour> ( 0., Colour ( 0, 0, 255, 255 ) ) );
+        colours.insert ( std::pair<double, Colour> ( 1000., Colour ( 255, 0, 0, 255 ) ) );
+        Palette palette ( colours, true, false, false );
+        int altitude[1] = { 500 };
+        StyledImage* S = new StyledImage ( new EmptyImage ( width, height, 1, altitude ), 4, &palette );
+        gettimeofday ( &BEGIN, NULL );
+        for ( int l = 0; l < height; l++ ) S->getline ( buffer, l );
+        gettimeofday ( &NOW, NULL );
+        time = NOW.tv_sec - BEGIN.tv_sec + ( NOW.tv_usec - BEGIN.tv_usec ) /1000000.;
+        cerr << int ( height / time ) << " lignes/s : style par palette d'une image " << width << "x" << height << endl;
+        delete S;
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitMergeImage );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION ( CppUnitMergeImage, "CppUnitMergeImage" );
@@ -0,0 +1,263 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "Rok4Image.h"
+#include "FileDataSource.h"
+#include "ObjectSlabStorage.h"
+
+/**
+ * \~french \brief Serveur HTTP minimal servant les requêtes GET partielles (Range) d'un unique objet en mémoire
+ * \details L'objet a un ETag, vérifié si la requête a un en-tête If-Match.
+ * \~english \brief Minimal HTTP server answering partial GET requests (Range) on a single in-memory object
+ * \details The object has an ETag, checked if the request has an If-Match header.
+ */
+class ObjectStorageTestServer {
+private:
+    int listener;
+    pthread_t thread;
+    volatile bool stop;
+
+    static bool readRequest ( int sock, std::string& request ) {
+        char buffer[1024];
+        while ( request.find ( "\r\n\r\n" ) == std::string::npos ) {
+            struct pollfd pfd = { sock, POLLIN, 0 };
+            if ( poll ( &pfd, 1, 5000 ) <= 0 ) return false;
+            ssize_t n = recv ( sock, buffer, sizeof ( buffer ), 0 );
+            if ( n <= 0 ) return false;
+            request.append ( buffer, n );
+        }
+        return true;
+    }
+
+    void serve ( int sock ) {
+        std::string request;
+        while ( ! stop && readRequest ( sock, request ) ) {
+            std::string path = request.substr ( 4, request.find ( ' ', 4 ) - 4 );
+            unsigned long long first = 0, last = 0;
+            size_t range = request.find ( "Range: bytes=" );
+            size_t ifMatch = request.find ( "If-Match: " );
+            std::ostringstream response;
+            if ( ifMatch != std::string::npos && request.compare ( ifMatch + 10, request.find ( "\r\n", ifMatch ) - ifMatch - 10, etag ) != 0 ) {
+                response << "HTTP/1.1 412 Precondition Failed\r\nContent-Length: 0\r\n\r\n";
+            } else if ( path != "/" + bucket + "/" + key || range == std::string::npos ||
+                    sscanf ( request.c_str() + range + 13, "%llu-%llu", &first, &last ) != 2 || first >= object.size() ) {
+                response << "HTTP/1.1 404 Not Found\r\nContent-Length: 9\r\n\r\nNot Found";
+            } else {
+                if ( last >= object.size() ) last = object.size() - 1;
+                response << "HTTP/1.1 206 Partial Content\r\nETag: " << etag << "\r\nContent-Length: " << ( last - first + 1 ) << "\r\n\r\n";
+                response.write ( object.data() + first, last - first + 1 );
+            }
+            request.erase ( 0, request.find ( "\r\n\r\n" ) + 4 );
+            std::string data = response.str();
+            if ( send ( sock, data.data(), data.size(), MSG_NOSIGNAL ) != ( ssize_t ) data.size() ) break;
+        }
+        close ( sock );
+    }
+
+    static void* run ( void* arg ) {
+        ObjectStorageTestServer* server = ( ObjectStorageTestServer* ) arg;
+        while ( ! server->stop ) {
+            struct pollfd pfd = { server->listener, POLLIN, 0 };
+            if ( poll ( &pfd, 1, 100 ) <= 0 ) continue;
+            int sock = accept ( server->listener, NULL, NULL );
+            if ( sock >= 0 ) server->serve ( sock );
+        }
+        return NULL;
+    }
+
+public:
+    std::string bucket;
+    std::string key;
+    std::string object;
+    std::string etag;
+    int port;
+
+    ObjectStorageTestServer ( std::string bucket, std::string key, std::string object ) : stop ( false ), bucket ( bucket ), key ( key ), object ( object ), etag ( "\"1\"" ) {
+        listener = socket ( AF_INET, SOCK_STREAM, 0 );
+        struct sockaddr_in address;
+        memset ( &address, 0, sizeof ( address ) );
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl ( INADDR_LOOPBACK );
+        address.sin_port = 0;
+        bind ( listener, ( struct sockaddr* ) &address, sizeof ( address ) );
+        socklen_t length = sizeof ( address );
+        getsockname ( listener, ( struct sockaddr* ) &address, &length );
+        port = ntohs ( address.sin_port );
+        listen ( listener, 4 );
+        pthread_create ( &thread, NULL, run, this );
+    }
+
+    ~ObjectStorageTestServer() {
+        stop = true;
+        pthread_join ( thread, NULL );
+        close ( listener );
+    }
+};
+
+/**
+ * \~french \brief Image de test à motif variable
+ * \~english \brief Test image with a varying pattern
+ */
+class ObjectStorageTestImage : public Image {
+public:
+    ObjectStorageTestImage ( int width, int height, int channels ) : Image ( width, height, channels ) {}
+
+    int getline ( uint8_t* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = ( uint8_t ) ( i * 7 + line * 3 );
+        return width * channels;
+    }
+    int getline ( uint16_t* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = ( uint8_t ) ( i * 7 + line * 3 );
+        return width * channels;
+    }
+    int getline ( float* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = ( uint8_t ) ( i * 7 + line * 3 );
+        return width * channels;
+    }
+};
+
+class CppUnitObjectSlabStorage : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitObjectSlabStorage );
+    CPPUNIT_TEST ( testUrl );
+    CPPUNIT_TEST ( testTiles );
+    CPPUNIT_TEST ( testModifiedSlab );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    // Écrit une dalle de 2x2 tuiles de 16x16 pixels et renvoie son contenu
+    std::string writeSlab ( char* filename, Compression::eCompression compression = Compression::LZW ) {
+        ObjectStorageTestImage source ( 32, 32, 3 );
+        Rok4ImageFactory R4IF;
+        Rok4Image* output = R4IF.createRok4ImageToWrite ( filename, BoundingBox<double> ( 0.,0.,0.,0. ), -1, -1, 32, 32, 3,
+                            SampleFormat::UINT, 8, Photometric::RGB, compression, 16, 16 );
+        CPPUNIT_ASSERT ( output );
+        CPPUNIT_ASSERT_EQUAL ( 0, output->writeImage ( &source ) );
+        delete output;
+
+        std::ifstream file ( filename, std::ios::binary );
+        std::ostringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+    // Compare la tuile n lue dans le stockage avec celle lue dans le fichier local
+    void checkTile ( SlabStorage* storage, const char* key, const char* filename, int n ) {
+        FileDataSource local ( filename, 2048 + 4 * n, 2048 + 16 + 4 * n, "image/tiff", "lzw" );
+        FileDataSource remote ( storage, key, 2048 + 4 * n, 2048 + 16 + 4 * n, "image/tiff", "lzw" );
+        size_t localSize, remoteSize;
+        const uint8_t* localData = local.getData ( localSize );
+        const uint8_t* remoteData = remote.getData ( remoteSize );
+        CPPUNIT_ASSERT ( localData && remoteData );
+        CPPUNIT_ASSERT_EQUAL ( localSize, remoteSize );
+        CPPUNIT_ASSERT ( memcmp ( localData, remoteData, localSize ) == 0 );
+    }
+
+public:
+    void testUrl() {
+        CPPUNIT_ASSERT ( ! ObjectSlabStorage ( "https://localhost", "bucket" ).isValid() );
+        CPPUNIT_ASSERT ( ! ObjectSlabStorage ( "http://localhost:9000", "" ).isValid() );
+        CPPUNIT_ASSERT ( ObjectSlabStorage ( "http://localhost:9000", "bucket" ).isValid() );
+        CPPUNIT_ASSERT ( ObjectSlabStorage::get ( "ftp://localhost", "bucket" ) == NULL );
+    }
+
+    void testTiles() {
+        char filename[] = "CppUnitObjectSlabStorage.tif";
+        ObjectStorageTestServer server ( "pyramids", "IMAGE/12/00/00/00.tif", writeSlab ( filename ) );
+
+        std::ostringstream url;
+        url << "http://127.0.0.1:" << server.port;
+        ObjectSlabStorage storage ( url.str(), "pyramids" );
+        CPPUNIT_ASSERT ( storage.isValid() );
+        CPPUNIT_ASSERT_EQUAL ( std::string ( "S3" ), storage.getType() );
+
+        // Index lu en une fois avec la première tuile, puis une seule requête par tuile sur la même connexion
+        checkTile ( &storage, "IMAGE/12/00/00/00.tif", filename, 0 );
+        CPPUNIT_ASSERT_EQUAL ( 2, storage.getRequestsCount() );
+        checkTile ( &storage, "IMAGE/12/00/00/00.tif", filename, 3 );
+        CPPUNIT_ASSERT_EQUAL ( 3, storage.getRequestsCount() );
+        CPPUNIT_ASSERT_EQUAL ( 1, storage.getConnectionsCount() );
+
+        // Objet absent : pas de données, la connexion reste utilisable
+        FileDataSource missing ( &storage, "IMAGE/12/00/00/01.tif", 2048, 2048 + 16, "image/tiff", "lzw" );
+        size_t size;
+        CPPUNIT_ASSERT ( missing.getData ( size ) == NULL );
+        checkTile ( &storage, "IMAGE/12/00/00/00.tif", filename, 1 );
+        CPPUNIT_ASSERT_EQUAL ( 1, storage.getConnectionsCount() );
+
+        remove ( filename );
+    }
+
+    void testModifiedSlab() {
+        char filename[] = "CppUnitObjectSlabStorage.tif";
+        ObjectStorageTestServer server ( "pyramids", "IMAGE/12/00/00/00.tif", writeSlab ( filename ) );
+
+        std::ostringstream url;
+        url << "http://127.0.0.1:" << server.port;
+        ObjectSlabStorage storage ( url.str(), "pyramids" );
+        checkTile ( &storage, "IMAGE/12/00/00/00.tif", filename, 0 );
+        CPPUNIT_ASSERT_EQUAL ( 2, storage.getRequestsCount() );
+
+        // Dalle remplacée, avec des tuiles à d'autres positions : l'index conservé n'est plus valable
+        server.object = writeSlab ( filename, Compression::NONE );
+        server.etag = "\"2\"";
+
+        // Lecture refusée (412), relecture de l'index puis de la tuile
+        checkTile ( &storage, "IMAGE/12/00/00/00.tif", filename, 1 );
+        CPPUNIT_ASSERT_EQUAL ( 5, storage.getRequestsCount() );
+
+        // Le nouvel index est conservé
+        checkTile ( &storage, "IMAGE/12/00/00/00.tif", filename, 2 );
+        CPPUNIT_ASSERT_EQUAL ( 6, storage.getRequestsCount() );
+
+        remove ( filename );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitObjectSlabStorage );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION ( CppUnitObjectSlabStorage, "CppUnitObjectSlabStorage" );
@@ -0,0 +1,165 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include "Predictor.h"
+#include "Rok4Image.h"
+#include "tiffio.h"
+
+/**
+ * \~french \brief Image lisse, comme un MNT, avec un peu de bruit
+ * \~english \brief Smooth image, like a DTM, with some noise
+ */
+class SmoothTestImage : public Image {
+public:
+    SmoothTestImage ( int width, int height, int channels ) : Image ( width, height, channels ) {}
+
+    static float value ( int x, int line, int c ) {
+        return 100.f + x * 0.5f + line * 0.25f + c * 30.f + ( ( x * 7 + line * 13 ) % 5 );
+    }
+
+    template<typename T>
+    int fill ( T* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = ( T ) value ( i / channels, line, i % channels );
+        return width * channels;
+    }
+
+    int getline ( uint8_t* buffer, int line ) {
+        return fill ( buffer, line );
+    }
+    int getline ( uint16_t* buffer, int line ) {
+        return fill ( buffer, line );
+    }
+    int getline ( float* buffer, int line ) {
+        return fill ( buffer, line );
+    }
+};
+
+class CppUnitPredictor : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitPredictor );
+    CPPUNIT_TEST ( testRoundTrip );
+    CPPUNIT_TEST ( testLibtiff );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void roundTrip ( Predictor::ePredictor pred, int width, int channels, int sampleSize ) {
+        int height = 3;
+        size_t size = width * height * channels * sampleSize;
+        std::vector<uint8_t> original ( size ), data ( size );
+        for ( size_t i = 0; i < size; i++ ) original[i] = rand() % 256;
+        data = original;
+        Predictor::apply ( pred, &data[0], width, height, channels, sampleSize );
+        CPPUNIT_ASSERT ( data != original );
+        Predictor::revert ( pred, &data[0], width, height, channels, sampleSize );
+        CPPUNIT_ASSERT_MESSAGE ( Predictor::toString ( pred ), data == original );
+    }
+
+    // Écrit une image ROK4 avec prédicteur, la relit avec la libtiff puis avec Rok4Image
+    template<typename T>
+    void writeAndRead ( Compression::eCompression comp, Predictor::ePredictor pred, SampleFormat::eSampleFormat sf, int channels ) {
+        char filename[] = "CppUnitPredictor.tif";
+        int bps = sizeof ( T ) * 8;
+        SmoothTestImage source ( 64, 64, channels );
+
+        Rok4ImageFactory R4IF;
+        Rok4Image* output = R4IF.createRok4ImageToWrite ( filename, BoundingBox<double> ( 0.,0.,0.,0. ), -1, -1, 64, 64, channels,
+                            sf, bps, channels == 1 ? Photometric::GRAY : Photometric::RGB, comp, 32, 32 );
+        CPPUNIT_ASSERT ( output );
+        CPPUNIT_ASSERT ( output->setPredictor ( pred ) );
+        CPPUNIT_ASSERT_EQUAL ( 0, output->writeImage ( &source ) );
+        delete output;
+
+        TIFF* tif = TIFFOpen ( filename, "r" );
+        CPPUNIT_ASSERT ( tif );
+        uint16_t p = 0;
+        TIFFGetField ( tif, TIFFTAG_PREDICTOR, &p );
+        CPPUNIT_ASSERT_EQUAL ( ( uint16_t ) pred, p );
+        std::vector<T> tile ( 32 * 32 * channels );
+        CPPUNIT_ASSERT ( TIFFReadEncodedTile ( tif, 3, &tile[0], tile.size() * sizeof ( T ) ) > 0 );
+        for ( int i = 0; i < 32 * 32 * channels; i++ ) {
+            int x = 32 + ( i / channels ) % 32, y = 32 + i / ( channels * 32 );
+            CPPUNIT_ASSERT_EQUAL ( ( T ) SmoothTestImage::value ( x, y, i % channels ), tile[i] );
+        }
+        TIFFClose ( tif );
+
+        Rok4Image* input = R4IF.createRok4ImageToRead ( filename, BoundingBox<double> ( 0.,0.,0.,0. ), 0., 0. );
+        CPPUNIT_ASSERT ( input );
+        CPPUNIT_ASSERT_EQUAL ( pred, input->getPredictor() );
+        std::vector<T> line ( 64 * channels );
+        input->getline ( &line[0], 40 );
+        for ( int i = 0; i < 64 * channels; i++ ) {
+            CPPUNIT_ASSERT_EQUAL ( ( T ) SmoothTestImage::value ( i / channels, 40, i % channels ), line[i] );
+        }
+        delete input;
+        remove ( filename );
+    }
+
+public:
+    void testRoundTrip() {
+        // Largeurs non multiples de 16 pour passer aussi par la fin scalaire des noyaux SSE
+        for ( int channels = 1; channels <= 4; channels++ ) {
+            roundTrip ( Predictor::HORIZONTAL, 37, channels, 1 );
+            roundTrip ( Predictor::HORIZONTAL, 37, channels, 2 );
+            roundTrip ( Predictor::FLOATINGPOINT, 37, channels, 4 );
+        }
+        roundTrip ( Predictor::HORIZONTAL, 256, 3, 1 );
+        roundTrip ( Predictor::FLOATINGPOINT, 256, 1, 4 );
+        // Lignes de moins de 16 octets : seule la fin scalaire des noyaux SSE est utilisée
+        roundTrip ( Predictor::HORIZONTAL, 3, 1, 1 );
+        roundTrip ( Predictor::HORIZONTAL, 3, 2, 1 );
+        roundTrip ( Predictor::HORIZONTAL, 3, 4, 1 );
+        roundTrip ( Predictor::FLOATINGPOINT, 1, 1, 4 );
+
+        CPPUNIT_ASSERT ( Predictor::isCompatible ( Predictor::HORIZONTAL, SampleFormat::UINT, 8 ) );
+        CPPUNIT_ASSERT ( ! Predictor::isCompatible ( Predictor::HORIZONTAL, SampleFormat::FLOAT, 32 ) );
+        CPPUNIT_ASSERT ( ! Predictor::isCompatible ( Predictor::FLOATINGPOINT, SampleFormat::UINT, 8 ) );
+        CPPUNIT_ASSERT_EQUAL ( Predictor::FLOATINGPOINT, Predictor::fromString ( "FLOATINGPOINT" ) );
+    }
+
+    void testLibtiff() {
+        writeAndRead<float> ( Compression::DEFLATE, Predictor::FLOATINGPOINT, SampleFormat::FLOAT, 1 );
+        writeAndRead<float> ( Compression::LZW, Predictor::FLOATINGPOINT, SampleFormat::FLOAT, 1 );
+        writeAndRead<uint8_t> ( Compression::LZW, Predictor::HORIZONTAL, SampleFormat::UINT, 3 );
+        writeAndRead<uint8_t> ( Compression::DEFLATE, Predictor::HORIZONTAL, SampleFormat::UINT, 4 );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitPredictor );
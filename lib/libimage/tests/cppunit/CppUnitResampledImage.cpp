@@ -47,10 +47,62 @@
 
 using namespace std;
 
+/**
+ * \~french \brief Image entière aux valeurs variées, pour mettre à l'épreuve les lobes négatifs des noyaux
+ * \~english \brief Integer image with various values, to challenge kernels' negative lobes
+ */
+class PatternImage : public Image {
+public:
+    PatternImage ( int width, int height, int channels ) : Image ( width, height, channels ) {}
+
+    int value ( int x, int line, int c ) {
+        if ( ( x / 7 + line / 5 ) % 3 == 0 ) return 255 * ( ( x + c ) % 2 );
+        return ( x * 37 + line * 91 + c * 53 + x * line ) % 256;
+    }
+
+    int getline ( uint8_t* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = ( uint8_t ) value ( i / channels, line, i % channels );
+        return width * channels;
+    }
+    int getline ( uint16_t* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = ( uint16_t ) value ( i / channels, line, i % channels );
+        return width * channels;
+    }
+    int getline ( float* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = ( float ) value ( i / channels, line, i % channels );
+        return width * channels;
+    }
+};
+
+/**
+ * \~french \brief Masque plein sur les premières lignes, vide ensuite, sans résumé de couverture
+ * \~english \brief Mask full on first lines, empty then, without coverage summary
+ */
+class StripMask : public Image {
+public:
+    int limit;
+    StripMask ( int width, int height, int limit ) : Image ( width, height, 1 ), limit ( limit ) {}
+
+    int getline ( uint8_t* buffer, int line ) {
+        memset ( buffer, line < limit ? 255 : 0, width );
+        return width;
+    }
+    int getline ( uint16_t* buffer, int line ) {
+        for ( int i = 0; i < width; i++ ) buffer[i] = ( line < limit ? 255 : 0 );
+        return width;
+    }
+    int getline ( float* buffer, int line ) {
+        for ( int i = 0; i < width; i++ ) buffer[i] = ( line < limit ? 255. : 0. );
+        return width;
+    }
+};
+
 class CppUnitResampledImage : public CPPUNIT_NS::TestFixture {
     CPPUNIT_TEST_SUITE ( CppUnitResampledImage );
     // enregistrement des methodes de tests à jouer :
     CPPUNIT_TEST ( testResampled );
+    CPPUNIT_TEST ( testFixedPoint );
+    CPPUNIT_TEST ( testMaskCoverage );
     CPPUNIT_TEST ( performance );
     CPPUNIT_TEST_SUITE_END();
 
@@ -99,6 +151,79 @@ protected:
         cerr << "Test ResampledImage OK" << endl;
     }
 
+    void testFixedPoint() {
+        int kernels[4] = { Interpolation::NEAREST_NEIGHBOUR, Interpolation::LINEAR, Interpolation::CUBIC, Interpolation::LANCZOS_3 };
+        double ratios[3] = { 0.37, 1.3, 2.9 };
+
+        for ( int k = 0; k < 4; k++ ) for ( int r = 0; r < 3; r++ ) for ( int channels = 1; channels <= 4; channels++ ) {
+            int rwidth = 123, rheight = 45;
+            BoundingBox<double> bbox ( 10.3, 20.1, 10.3 + rwidth * ratios[r], 20.1 + rheight * ratios[r] );
+
+            ResampledImage* F = new ResampledImage ( new PatternImage ( 500, 300, channels ), rwidth, rheight,
+                    ratios[r], ratios[r], bbox, Interpolation::KernelType ( kernels[k] ), false, true );
+            ResampledImage* R = new ResampledImage ( new PatternImage ( 500, 300, channels ), rwidth, rheight,
+                    ratios[r], ratios[r], bbox, Interpolation::KernelType ( kernels[k] ), false, false );
+
+            uint8_t fixed[rwidth * channels];
+            uint8_t reference[rwidth * channels];
+            for ( int l = 0; l < rheight; l++ ) {
+                F->getline ( fixed, l );
+                R->getline ( reference, l );
+                for ( int i = 0; i < rwidth * channels; i++ ) {
+                    CPPUNIT_ASSERT ( abs ( int ( fixed[i] ) - int ( reference[i] ) ) <= 1 );
+                }
+            }
+
+            delete F;
+            delete R;
+        }
+    }
+
+
+    void testMaskCoverage() {
+        uint8_t line[8] = { 255, 255, 255, 255, 255, 255, 255, 255 };
+        CPPUNIT_ASSERT_EQUAL ( MaskCoverage::FULL, MaskCoverage::fromLine ( line, 8 ) );
+        line[5] = 0;
+        CPPUNIT_ASSERT_EQUAL ( MaskCoverage::MIXED, MaskCoverage::fromLine ( line, 8 ) );
+        memset ( line, 0, 8 );
+        CPPUNIT_ASSERT_EQUAL ( MaskCoverage::EMPTY, MaskCoverage::fromLine ( line, 8 ) );
+
+        int rwidth = 80, rheight = 70;
+        BoundingBox<double> bbox ( 5.2, 3.1, 5.2 + rwidth * 1.7, 3.1 + rheight * 1.7 );
+
+        // Masque plein : identique au réechantillonnage sans masque
+        PatternImage* full = new PatternImage ( 200, 150, 3 );
+        int opaque[1] = { 255 };
+        full->setMask ( new EmptyImage ( 200, 150, 1, opaque ) );
+        ResampledImage* F = new ResampledImage ( full, rwidth, rheight, 1.7, 1.7, bbox, Interpolation::LANCZOS_3, true );
+        ResampledImage* R = new ResampledImage ( new PatternImage ( 200, 150, 3 ), rwidth, rheight, 1.7, 1.7, bbox, Interpolation::LANCZOS_3, false );
+
+        // Masque en deux bandes : les lignes dont le noyau ne voit que la bande pleine ne dépendent pas du masque
+        PatternImage* strip = new PatternImage ( 200, 150, 3 );
+        strip->setMask ( new StripMask ( 200, 150, 80 ) );
+        ResampledImage* S = new ResampledImage ( strip, rwidth, rheight, 1.7, 1.7, bbox, Interpolation::LANCZOS_3, true );
+
+        float f[rwidth * 3], r[rwidth * 3], st[rwidth * 3];
+        for ( int l = 0; l < rheight; l++ ) {
+            F->getline ( f, l );
+            R->getline ( r, l );
+            S->getline ( st, l );
+            double center = ( bbox.ymax - ( l + 0.5 ) * 1.7 );
+            double sourceLine = 150 - center;
+            for ( int i = 0; i < rwidth * 3; i++ ) {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL ( r[i], f[i], 1e-3 );
+                if ( sourceLine < 80 - 6 ) {
+                    CPPUNIT_ASSERT_DOUBLES_EQUAL ( r[i], st[i], 1e-2 );
+                } else if ( sourceLine > 80 + 6 ) {
+                    CPPUNIT_ASSERT_DOUBLES_EQUAL ( 0., st[i], 1e-6 );
+                }
+            }
+        }
+
+        delete F;
+        delete R;
+        delete S;
+    }
 
     string name ( int kernel_type ) {
         switch ( kernel_type ) {
@@ -5,14 +5,55 @@
 #include "TiffEncoder.h"
 #include "RawImage.h"
 #include "TiffHeader.h"
+#include "PaletteDataSource.h"
+
+// Source de test : un tampon en mémoire, non copié
+class SegmentTestSource : public DataSource {
+    const uint8_t* buffer;
+    size_t size;
+    std::string type;
+public:
+    SegmentTestSource ( const uint8_t* buffer, size_t size, std::string type ) : buffer ( buffer ), size ( size ), type ( type ) {}
+    const uint8_t* getData ( size_t& s ) {
+        s = size;
+        return buffer;
+    }
+    bool releaseData() {
+        return true;
+    }
+    std::string getType() {
+        return type;
+    }
+    int getHttpStatus() {
+        return 200;
+    }
+    std::string getEncoding() {
+        return "";
+    }
+};
+
+// Concatène les segments d'une source
+static std::string concatSegments ( DataSource* source ) {
+    std::vector<DataSegment> segments;
+    CPPUNIT_ASSERT ( source->getSegments ( segments ) );
+    std::string result;
+    for ( size_t i = 0; i < segments.size(); i++ ) {
+        result.append ( ( const char* ) segments[i].data, segments[i].size );
+    }
+    return result;
+}
 
 class CppUnitTiffHeaderDataSource : public CPPUNIT_NS::TestFixture {
     CPPUNIT_TEST_SUITE ( CppUnitTiffHeaderDataSource );
     //CPPUNIT_TEST(rawHeaderConformity);
+    CPPUNIT_TEST ( segmentsConformity );
+    CPPUNIT_TEST ( implicitTileSize );
     CPPUNIT_TEST_SUITE_END();
 
 public:
     void rawHeaderConformity();
+    void segmentsConformity();
+    void implicitTileSize();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitTiffHeaderDataSource );
@@ -70,3 +111,58 @@ void CppUnitTiffHeaderDataSource::rawHeaderConformity() {
     //pos = TiffHeader::headerSize;
 
 }
+
+void CppUnitTiffHeaderDataSource::segmentsConformity() {
+    uint8_t tile[100];
+    for ( int i = 0; i < 100; i++ ) tile[i] = i;
+
+    // En-tête TIFF : les segments sont l'en-tête puis la tuile, sans copie de celle-ci
+    TiffHeaderDataSource tiffDS ( new SegmentTestSource ( tile, 100, "image/tiff" ), Rok4Format::TIFF_RAW_INT8, 1, 10, 10, 100 );
+    std::vector<DataSegment> segments;
+    CPPUNIT_ASSERT ( tiffDS.getSegments ( segments ) );
+    CPPUNIT_ASSERT_EQUAL ( ( size_t ) 2, segments.size() );
+    CPPUNIT_ASSERT ( segments[1].data == tile );
+    size_t size;
+    const uint8_t* data = tiffDS.getData ( size );
+    CPPUNIT_ASSERT_EQUAL ( TiffHeader::headerSize ( 1 ) + 100, size );
+    CPPUNIT_ASSERT ( concatSegments ( &tiffDS ) == std::string ( ( const char* ) data, size ) );
+
+    // Avec un prédicteur, un tag de plus et des données décalées d'autant
+    TiffHeaderDataSource predDS ( new SegmentTestSource ( tile, 100, "image/tiff" ), Rok4Format::TIFF_ZIP_INT8, 3, 10, 10, 0, Predictor::HORIZONTAL );
+    const uint8_t* predData = predDS.getData ( size );
+    CPPUNIT_ASSERT_EQUAL ( TiffHeader::headerSize ( 3 ) + 12 + 100, size );
+    CPPUNIT_ASSERT_EQUAL ( ( uint16_t ) 11, * ( ( uint16_t* ) ( predData+8 ) ) );
+    CPPUNIT_ASSERT_EQUAL ( ( uint16_t ) 317, * ( ( uint16_t* ) ( predData+10+12*9 ) ) );
+    CPPUNIT_ASSERT_EQUAL ( ( uint32_t ) ( TiffHeader::headerSize ( 3 ) + 12 ), * ( ( uint32_t* ) ( predData+70+8 ) ) );
+    CPPUNIT_ASSERT ( memcmp ( predData + TiffHeader::headerSize ( 3 ) + 12, tile, 100 ) == 0 );
+
+    // Palette PNG : en-tête modifié, palette puis données du PNG source
+    uint8_t plte[24];
+    for ( int i = 0; i < 24; i++ ) plte[i] = 200 + i;
+    Palette palette ( 24, plte );
+    PaletteDataSource pngDS ( new SegmentTestSource ( tile, 100, "image/png" ), &palette );
+    data = pngDS.getData ( size );
+    CPPUNIT_ASSERT_EQUAL ( ( size_t ) 124, size );
+    CPPUNIT_ASSERT_EQUAL ( ( uint8_t ) 3, data[25] );
+    CPPUNIT_ASSERT ( memcmp ( data+33, plte, 24 ) == 0 );
+    CPPUNIT_ASSERT ( memcmp ( data+57, tile+33, 67 ) == 0 );
+    CPPUNIT_ASSERT ( concatSegments ( &pngDS ) == std::string ( ( const char* ) data, size ) );
+}
+
+void CppUnitTiffHeaderDataSource::implicitTileSize() {
+    uint8_t tile[100];
+    for ( int i = 0; i < 100; i++ ) tile[i] = 255 - i;
+
+    // Sans taille explicite, celle de la tuile est donnée par la source
+    TiffHeaderDataSource tiffDS ( new SegmentTestSource ( tile, 100, "image/tiff" ), Rok4Format::TIFF_RAW_INT8, 1, 10, 10 );
+    std::vector<DataSegment> segments;
+    CPPUNIT_ASSERT ( tiffDS.getSegments ( segments ) );
+    CPPUNIT_ASSERT_EQUAL ( ( size_t ) 2, segments.size() );
+    CPPUNIT_ASSERT_EQUAL ( ( size_t ) 100, segments[1].size );
+
+    size_t size;
+    const uint8_t* data = tiffDS.getData ( size );
+    CPPUNIT_ASSERT_EQUAL ( TiffHeader::headerSize ( 1 ) + 100, size );
+    CPPUNIT_ASSERT_EQUAL ( ( uint32_t ) 100, * ( ( uint32_t* ) ( data+114 ) ) );
+    CPPUNIT_ASSERT ( memcmp ( data + TiffHeader::headerSize ( 1 ), tile, 100 ) == 0 );
+}
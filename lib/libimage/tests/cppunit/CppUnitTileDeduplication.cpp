@@ -0,0 +1,125 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdio>
+#include <fstream>
+#include "Rok4Image.h"
+
+/**
+ * \~french \brief Image dont les tuiles de 32x32 pixels de la première colonne sont toutes identiques
+ * \~english \brief Image whose 32x32 pixels tiles of the first column are all the same
+ */
+class RepeatedTilesTestImage : public Image {
+public:
+    RepeatedTilesTestImage ( int width, int height, int channels ) : Image ( width, height, channels ) {}
+
+    static uint8_t value ( int x, int line, int c ) {
+        if ( x < 32 ) return ( uint8_t ) ( 3 * x + 5 * ( line % 32 ) + c );
+        return ( uint8_t ) ( x * line + c );
+    }
+
+    int getline ( uint8_t* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = value ( i / channels, line, i % channels );
+        return width * channels;
+    }
+    int getline ( uint16_t* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = value ( i / channels, line, i % channels );
+        return width * channels;
+    }
+    int getline ( float* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = value ( i / channels, line, i % channels );
+        return width * channels;
+    }
+};
+
+class CppUnitTileDeduplication : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitTileDeduplication );
+    CPPUNIT_TEST ( testRok4Image );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    // Écrit l'image de test et renvoie la taille du fichier
+    long write ( char* filename, Compression::eCompression comp, bool deduplicate ) {
+        RepeatedTilesTestImage source ( 64, 96, 3 );
+        Rok4ImageFactory R4IF;
+        Rok4Image* output = R4IF.createRok4ImageToWrite ( filename, BoundingBox<double> ( 0.,0.,0.,0. ), -1, -1, 64, 96, 3,
+                            SampleFormat::UINT, 8, Photometric::RGB, comp, 32, 32 );
+        CPPUNIT_ASSERT ( output );
+        output->setDeduplicateTiles ( deduplicate );
+        CPPUNIT_ASSERT_EQUAL ( 0, output->writeImage ( &source ) );
+        delete output;
+
+        std::ifstream file ( filename, std::ios::binary | std::ios::ate );
+        return file.tellg();
+    }
+
+public:
+    void testRok4Image() {
+        char filename[] = "CppUnitTileDeduplication.tif";
+        long fullSize = write ( filename, Compression::LZW, false );
+        long dedupSize = write ( filename, Compression::LZW, true );
+
+        // Les tuiles 0, 2 et 4 sont identiques : seule la première est écrite
+        uint32_t index[12];
+        std::ifstream file ( filename, std::ios::binary );
+        file.seekg ( ROK4_IMAGE_HEADER_SIZE );
+        file.read ( ( char* ) index, sizeof ( index ) );
+        file.close();
+        CPPUNIT_ASSERT_EQUAL ( index[0], index[2] );
+        CPPUNIT_ASSERT_EQUAL ( index[0], index[4] );
+        CPPUNIT_ASSERT_EQUAL ( index[6], index[10] );
+        CPPUNIT_ASSERT ( index[1] != index[3] && index[3] != index[5] );
+        CPPUNIT_ASSERT ( dedupSize <= fullSize - 2 * ( long ) index[6] );
+
+        Rok4ImageFactory R4IF;
+        Rok4Image* input = R4IF.createRok4ImageToRead ( filename, BoundingBox<double> ( 0.,0.,0.,0. ), 0., 0. );
+        CPPUNIT_ASSERT ( input );
+        uint8_t line[64 * 3];
+        for ( int l = 0; l < 96; l += 17 ) {
+            input->getline ( line, l );
+            for ( int i = 0; i < 64 * 3; i++ ) {
+                CPPUNIT_ASSERT_EQUAL ( RepeatedTilesTestImage::value ( i / 3, l, i % 3 ), line[i] );
+            }
+        }
+        delete input;
+        remove ( filename );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitTileDeduplication );
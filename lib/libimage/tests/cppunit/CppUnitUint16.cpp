@@ -0,0 +1,160 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstring>
+#include <vector>
+#include "Decoder.h"
+#include "TiffEncoder.h"
+#include "TiffHeader.h"
+#include "TiffHeaderDataSource.h"
+
+/**
+ * \~french \brief Tuile brute d'entiers 16 bits en mémoire
+ * \~english \brief Raw 16-bit integer tile in memory
+ */
+class Uint16TileSource : public DataSource {
+    std::vector<uint16_t> samples;
+public:
+    Uint16TileSource ( const std::vector<uint16_t>& samples ) : samples ( samples ) {}
+    const uint8_t* getData ( size_t& size ) {
+        size = samples.size() * sizeof ( uint16_t );
+        return ( const uint8_t* ) &samples[0];
+    }
+    bool releaseData() {
+        return true;
+    }
+    std::string getType() {
+        return "image/tiff";
+    }
+    int getHttpStatus() {
+        return 200;
+    }
+    std::string getEncoding() {
+        return "";
+    }
+};
+
+class CppUnitUint16 : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitUint16 );
+    CPPUNIT_TEST ( testFormat );
+    CPPUNIT_TEST ( testHeader );
+    CPPUNIT_TEST ( testDecoder );
+    CPPUNIT_TEST ( testEncoder );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    // Valeur du tag BITSPERSAMPLE pour le canal c d'un en-tête little endian
+    static uint16_t bitsPerSample ( const uint8_t* header, int c ) {
+        uint16_t count = * ( ( uint16_t* ) ( header+8 ) );
+        for ( size_t t = 10; t < 10 + 12 * count; t += 12 ) {
+            if ( * ( ( uint16_t* ) ( header+t ) ) != 258 ) continue;
+            if ( * ( ( uint32_t* ) ( header+t+4 ) ) == 1 ) return * ( ( uint16_t* ) ( header+t+8 ) );
+            return * ( ( uint16_t* ) ( header + * ( ( uint32_t* ) ( header+t+8 ) ) ) + c );
+        }
+        return 0;
+    }
+
+    static std::vector<uint16_t> tile ( int width, int height, int channels ) {
+        std::vector<uint16_t> samples ( width * height * channels );
+        for ( size_t i = 0; i < samples.size(); i++ ) samples[i] = ( uint16_t ) ( i * 211 );
+        return samples;
+    }
+
+public:
+    void testFormat() {
+        CPPUNIT_ASSERT_EQUAL ( Rok4Format::TIFF_ZIP_UINT16, Rok4Format::fromString ( "TIFF_ZIP_UINT16" ) );
+        CPPUNIT_ASSERT_EQUAL ( std::string ( "TIFF_PKB_UINT16" ), Rok4Format::toString ( Rok4Format::TIFF_PKB_UINT16 ) );
+        CPPUNIT_ASSERT_EQUAL ( std::string ( "image/tiff" ), Rok4Format::toMimeType ( Rok4Format::TIFF_RAW_UINT16 ) );
+        CPPUNIT_ASSERT ( Rok4Format::TIFF_PKB_UINT16 < Rok4Format::eformat_float );
+        CPPUNIT_ASSERT_EQUAL ( 1, Rok4Format::toSampleSize ( Rok4Format::TIFF_ZSTD_INT8 ) );
+        CPPUNIT_ASSERT_EQUAL ( 2, Rok4Format::toSampleSize ( Rok4Format::TIFF_RAW_UINT16 ) );
+        CPPUNIT_ASSERT_EQUAL ( 2, Rok4Format::toSampleSize ( Rok4Format::TIFF_PKB_UINT16 ) );
+        CPPUNIT_ASSERT_EQUAL ( 4, Rok4Format::toSampleSize ( Rok4Format::TIFF_RAW_FLOAT32 ) );
+    }
+
+    void testHeader() {
+        size_t size;
+        TiffHeaderDataSource grayDS ( NULL, Rok4Format::TIFF_LZW_UINT16, 1, 256, 256, 10 );
+        CPPUNIT_ASSERT_EQUAL ( ( uint16_t ) 16, bitsPerSample ( grayDS.getData ( size ), 0 ) );
+
+        TiffHeaderDataSource rgbDS ( NULL, Rok4Format::TIFF_ZIP_UINT16, 3, 256, 256, 10, Predictor::HORIZONTAL );
+        const uint8_t* header = rgbDS.getData ( size );
+        for ( int c = 0; c < 3; c++ ) CPPUNIT_ASSERT_EQUAL ( ( uint16_t ) 16, bitsPerSample ( header, c ) );
+
+        TiffHeaderDataSource int8DS ( NULL, Rok4Format::TIFF_ZIP_INT8, 3, 256, 256, 10 );
+        CPPUNIT_ASSERT_EQUAL ( ( uint16_t ) 8, bitsPerSample ( int8DS.getData ( size ), 2 ) );
+    }
+
+    void testDecoder() {
+        std::vector<uint16_t> samples = tile ( 8, 4, 3 );
+        ImageDecoder decoder ( new Uint16TileSource ( samples ), 8, 4, 3, BoundingBox<double> ( 0.,0.,0.,0. ), 0, 0, 0, 0, 2 );
+
+        uint16_t line16[24];
+        uint8_t line8[24];
+        float linef[24];
+        CPPUNIT_ASSERT_EQUAL ( 24, decoder.getline ( line16, 2 ) );
+        decoder.getline ( line8, 2 );
+        decoder.getline ( linef, 2 );
+        for ( int i = 0; i < 24; i++ ) {
+            uint16_t expected = samples[48 + i];
+            CPPUNIT_ASSERT_EQUAL ( expected, line16[i] );
+            CPPUNIT_ASSERT_EQUAL ( ( uint8_t ) ( expected > 255 ? 255 : expected ), line8[i] );
+            CPPUNIT_ASSERT_EQUAL ( ( float ) expected, linef[i] );
+        }
+    }
+
+    void testEncoder() {
+        std::vector<uint16_t> samples = tile ( 8, 4, 1 );
+        DataStream* stream = TiffEncoder::getTiffEncoder ( new ImageDecoder ( new Uint16TileSource ( samples ), 8, 4, 1, BoundingBox<double> ( 0.,0.,0.,0. ), 0, 0, 0, 0, 2 ),
+                             Rok4Format::TIFF_RAW_UINT16 );
+        CPPUNIT_ASSERT ( stream );
+        std::vector<uint8_t> tiff;
+        uint8_t buffer[1024];
+        size_t n;
+        while ( ( n = stream->read ( buffer, sizeof ( buffer ) ) ) > 0 ) tiff.insert ( tiff.end(), buffer, buffer + n );
+        delete stream;
+
+        size_t headerSize = TiffHeader::headerSize ( 1 );
+        CPPUNIT_ASSERT_EQUAL ( headerSize + samples.size() * sizeof ( uint16_t ), tiff.size() );
+        CPPUNIT_ASSERT_EQUAL ( ( uint16_t ) 16, bitsPerSample ( &tiff[0], 0 ) );
+        CPPUNIT_ASSERT ( memcmp ( &tiff[headerSize], &samples[0], samples.size() * sizeof ( uint16_t ) ) == 0 );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitUint16 );
@@ -0,0 +1,206 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdio>
+#include <vector>
+#include "Rok4Image.h"
+#include "TiffHeaderDataSource.h"
+#include "Decoder.h"
+#include "Zstd_library_config.h"
+#ifdef ZSTD_USE
+#include <zstd.h>
+#endif
+
+/**
+ * \~french \brief Image en dégradé, pour l'écriture et la relecture de dalles ZSTD
+ * \~english \brief Gradient image, to write and read back ZSTD slabs
+ */
+class GradientZstdImage : public Image {
+public:
+    GradientZstdImage ( int width, int height, int channels ) : Image ( width, height, channels ) {}
+
+    static float value ( int x, int line, int c ) {
+        return 10.f + x * 1.5f + line * 0.75f + c * 20.f;
+    }
+
+    template<typename T>
+    int fill ( T* buffer, int line ) {
+        for ( int i = 0; i < width * channels; i++ ) buffer[i] = ( T ) value ( i / channels, line, i % channels );
+        return width * channels;
+    }
+
+    int getline ( uint8_t* buffer, int line ) {
+        return fill ( buffer, line );
+    }
+    int getline ( uint16_t* buffer, int line ) {
+        return fill ( buffer, line );
+    }
+    int getline ( float* buffer, int line ) {
+        return fill ( buffer, line );
+    }
+};
+
+/**
+ * \~french \brief Source de données en mémoire, possédant ses données
+ * \~english \brief Data source in memory, owning its data
+ */
+class ZstdFrameSource : public DataSource {
+public:
+    std::vector<uint8_t> frame;
+
+    const uint8_t* getData ( size_t& size ) {
+        size = frame.size();
+        return &frame[0];
+    }
+    bool releaseData() {
+        return false;
+    }
+    std::string getType() {
+        return "";
+    }
+    int getHttpStatus() {
+        return 200;
+    }
+    std::string getEncoding() {
+        return "";
+    }
+};
+
+class CppUnitZstd : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitZstd );
+    CPPUNIT_TEST ( testFormat );
+    CPPUNIT_TEST ( testRok4Image );
+    CPPUNIT_TEST ( testMaxSize );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    template<typename T>
+    void writeAndRead ( Predictor::ePredictor pred, SampleFormat::eSampleFormat sf, int channels ) {
+        char filename[] = "CppUnitZstd.tif";
+        GradientZstdImage source ( 64, 64, channels );
+
+        Rok4ImageFactory R4IF;
+        Rok4Image* output = R4IF.createRok4ImageToWrite ( filename, BoundingBox<double> ( 0.,0.,0.,0. ), -1, -1, 64, 64, channels,
+                            sf, sizeof ( T ) * 8, channels == 1 ? Photometric::GRAY : Photometric::RGB, Compression::ZSTD, 32, 32 );
+        CPPUNIT_ASSERT ( output );
+        CPPUNIT_ASSERT ( output->setPredictor ( pred ) );
+        CPPUNIT_ASSERT ( ! output->setZstdLevel ( 0 ) );
+        CPPUNIT_ASSERT ( output->setZstdLevel ( 9 ) );
+        CPPUNIT_ASSERT_EQUAL ( 0, output->writeImage ( &source ) );
+        delete output;
+
+        Rok4Image* input = R4IF.createRok4ImageToRead ( filename, BoundingBox<double> ( 0.,0.,0.,0. ), 0., 0. );
+        CPPUNIT_ASSERT ( input );
+        CPPUNIT_ASSERT_EQUAL ( Compression::ZSTD, input->getCompression() );
+        CPPUNIT_ASSERT_EQUAL ( pred, input->getPredictor() );
+        std::vector<T> line ( 64 * channels );
+        input->getline ( &line[0], 40 );
+        for ( int i = 0; i < 64 * channels; i++ ) {
+            CPPUNIT_ASSERT_EQUAL ( ( T ) GradientZstdImage::value ( i / channels, 40, i % channels ), line[i] );
+        }
+        delete input;
+        remove ( filename );
+    }
+
+public:
+    void testFormat() {
+        CPPUNIT_ASSERT_EQUAL ( Rok4Format::TIFF_ZSTD_FLOAT32, Rok4Format::fromString ( "TIFF_ZSTD_FLOAT32" ) );
+        CPPUNIT_ASSERT ( Rok4Format::TIFF_ZSTD_INT8 < Rok4Format::eformat_float );
+        CPPUNIT_ASSERT ( Rok4Format::TIFF_ZSTD_FLOAT32 >= Rok4Format::eformat_float );
+        CPPUNIT_ASSERT ( Rok4Format::TIFF_RAW_FLOAT32 >= Rok4Format::eformat_float );
+        CPPUNIT_ASSERT_EQUAL ( std::string ( "deflate" ), Rok4Format::toEncoding ( Rok4Format::TIFF_ZIP_FLOAT32 ) );
+
+        // En-tête TIFF d'une tuile brute : seule la compression diffère du deflate
+        TiffHeaderDataSource zstdDS ( NULL, Rok4Format::TIFF_ZSTD_INT8, 3, 256, 256, 10 );
+        TiffHeaderDataSource zipDS ( NULL, Rok4Format::TIFF_ZIP_INT8, 3, 256, 256, 10 );
+        size_t zstdSize, zipSize;
+        const uint8_t* zstdHeader = zstdDS.getData ( zstdSize );
+        const uint8_t* zipHeader = zipDS.getData ( zipSize );
+        CPPUNIT_ASSERT_EQUAL ( zipSize, zstdSize );
+        int differences = 0;
+        for ( size_t t = 10; t < 10 + 12 * * ( ( uint16_t* ) ( zstdHeader+8 ) ); t += 12 ) {
+            if ( * ( ( uint16_t* ) ( zstdHeader+t ) ) == 259 ) {
+                CPPUNIT_ASSERT_EQUAL ( ( uint16_t ) COMPRESSION_ZSTD, * ( ( uint16_t* ) ( zstdHeader+t+8 ) ) );
+            }
+        }
+        for ( size_t i = 0; i < zipSize; i++ ) {
+            if ( zstdHeader[i] != zipHeader[i] ) differences++;
+        }
+        CPPUNIT_ASSERT ( differences > 0 && differences <= 2 );
+    }
+
+    void testRok4Image() {
+#ifdef ZSTD_USE
+        CPPUNIT_ASSERT ( Compression::isAvailable ( Compression::ZSTD ) );
+        writeAndRead<uint8_t> ( Predictor::NONE, SampleFormat::UINT, 3 );
+        writeAndRead<uint8_t> ( Predictor::HORIZONTAL, SampleFormat::UINT, 4 );
+        writeAndRead<float> ( Predictor::FLOATINGPOINT, SampleFormat::FLOAT, 1 );
+#else
+        // Sans zstd, l'écriture d'une dalle ZSTD est refusée
+        char filename[] = "CppUnitZstd.tif";
+        CPPUNIT_ASSERT ( ! Compression::isAvailable ( Compression::ZSTD ) );
+        Rok4ImageFactory R4IF;
+        CPPUNIT_ASSERT ( ! R4IF.createRok4ImageToWrite ( filename, BoundingBox<double> ( 0.,0.,0.,0. ), -1, -1, 64, 64, 3,
+                         SampleFormat::UINT, 8, Photometric::RGB, Compression::ZSTD, 32, 32 ) );
+#endif
+    }
+
+    void testMaxSize() {
+#ifdef ZSTD_USE
+        // Trame dont l'en-tête annonce 64x64x3 octets
+        std::vector<uint8_t> raw ( 64 * 64 * 3, 12 );
+        ZstdFrameSource* source = new ZstdFrameSource();
+        source->frame.resize ( ZSTD_compressBound ( raw.size() ) );
+        source->frame.resize ( ZSTD_compress ( &source->frame[0], source->frame.size(), &raw[0], raw.size(), 3 ) );
+
+        size_t size;
+        const uint8_t* data = ZstdDecoder::decode ( source, size, NULL, raw.size() );
+        CPPUNIT_ASSERT ( data );
+        CPPUNIT_ASSERT_EQUAL ( raw.size(), size );
+        ZstdDecoder::release ( data );
+
+        // Taille annoncée supérieure à celle d'une tuile : refusée sans allocation
+        CPPUNIT_ASSERT ( ! ZstdDecoder::decode ( source, size, NULL, 32 * 32 * 3 ) );
+        DataSourceDecoder<ZstdDecoder> decoder ( source, 32 * 32 * 3 );
+        CPPUNIT_ASSERT ( ! decoder.getData ( size ) );
+#endif
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitZstd );
@@ -65,7 +65,11 @@
 #include "intl.h"
 #include "config.h"
 #include "Keyword.h"
+#include "EncoderProfile.h"
 #include <fcntl.h>
+#include <fstream>
+#include "ObjectSlabStorage.h"
+#include "MappedSlabStorage.h"
 
 // Load style
 Style* ConfLoader::parseStyle ( TiXmlDocument* doc,std::string fileName,bool inspire ) {
@@ -602,6 +606,10 @@ Pyramid* ConfLoader::parsePyramid ( TiXmlDocument* doc,std::string fileName, std
         LOGGER_ERROR ( fileName << _ ( "Le format [" ) << formatStr <<_ ( "] n'est pas gere." ) );
         return NULL;
     }
+    if ( ( format == Rok4Format::TIFF_ZSTD_INT8 || format == Rok4Format::TIFF_ZSTD_FLOAT32 ) && ! Compression::isAvailable ( Compression::ZSTD ) ) {
+        LOGGER_ERROR ( fileName << _ ( "Le format [" ) << formatStr <<_ ( "] n'est pas disponible (serveur compile sans zstd)." ) );
+        return NULL;
+    }
 
 
     pElem=hRoot.FirstChild ( "channels" ).Element();
@@ -614,6 +622,54 @@ Pyramid* ConfLoader::parsePyramid ( TiXmlDocument* doc,std::string fileName, std
         return NULL;
     }
 
+    // Prédicteur TIFF facultatif des tuiles LZW, deflate ou zstd
+    Predictor::ePredictor predictor = Predictor::NONE;
+    pElem=hRoot.FirstChild ( "predictor" ).Element();
+    if ( pElem && pElem->GetText() ) {
+        predictor = Predictor::fromString ( pElem->GetTextStr() );
+        if ( ! predictor ) {
+            LOGGER_ERROR ( _ ( "La pyramide [" ) << fileName <<_ ( "] : le predicteur [" ) << pElem->GetTextStr() <<_ ( "] n'est pas gere." ) );
+            return NULL;
+        }
+        if ( predictor != Predictor::NONE ) {
+            bool isFloat = ( format >= Rok4Format::eformat_float );
+            bool compressed = ( format == Rok4Format::TIFF_LZW_INT8 || format == Rok4Format::TIFF_ZIP_INT8 ||
+                                format == Rok4Format::TIFF_LZW_FLOAT32 || format == Rok4Format::TIFF_ZIP_FLOAT32 ||
+                                format == Rok4Format::TIFF_ZSTD_INT8 || format == Rok4Format::TIFF_ZSTD_FLOAT32 ||
+                                format == Rok4Format::TIFF_LZW_UINT16 || format == Rok4Format::TIFF_ZIP_UINT16 );
+            if ( ! compressed || ( predictor == Predictor::FLOATINGPOINT ) != isFloat ) {
+                LOGGER_ERROR ( _ ( "La pyramide [" ) << fileName <<_ ( "] : le predicteur [" ) << pElem->GetTextStr()
+                               <<_ ( "] n'est pas compatible avec le format " ) << formatStr );
+                return NULL;
+            }
+        }
+    }
+
+    // Stockage facultatif des dalles : fichiers locaux (FILE, par défaut) ou stockage objet compatible S3
+    SlabStorage* storage = NULL;
+    pElem=hRoot.FirstChild ( "storage" ).Element();
+    if ( pElem ) {
+        TiXmlHandle hStorage ( pElem );
+        TiXmlElement* pElemStorage = hStorage.FirstChild ( "type" ).Element();
+        std::string storageType ( ( pElemStorage && pElemStorage->GetText() ) ? pElemStorage->GetText() : "FILE" );
+        if ( storageType == "S3" ) {
+            TiXmlElement* pElemUrl = hStorage.FirstChild ( "url" ).Element();
+            TiXmlElement* pElemBucket = hStorage.FirstChild ( "bucket" ).Element();
+            if ( !pElemUrl || ! ( pElemUrl->GetText() ) || !pElemBucket || ! ( pElemBucket->GetText() ) ) {
+                LOGGER_ERROR ( _ ( "La pyramide [" ) << fileName <<_ ( "] : un stockage S3 doit preciser url et bucket." ) );
+                return NULL;
+            }
+            storage = ObjectSlabStorage::get ( pElemUrl->GetTextStr(), pElemBucket->GetTextStr() );
+            if ( ! storage ) {
+                LOGGER_ERROR ( _ ( "La pyramide [" ) << fileName <<_ ( "] : stockage S3 [" ) << pElemUrl->GetTextStr() <<_ ( "] inutilisable." ) );
+                return NULL;
+            }
+        } else if ( storageType != "FILE" ) {
+            LOGGER_ERROR ( _ ( "La pyramide [" ) << fileName <<_ ( "] : le type de stockage [" ) << storageType <<_ ( "] n'est pas gere." ) );
+            return NULL;
+        }
+    }
+
     for ( pElem=hRoot.FirstChild ( "level" ).Element(); pElem; pElem=pElem->NextSiblingElement ( "level" ) ) {
         TileMatrix *tm;
         //std::string id;
@@ -650,8 +706,11 @@ Pyramid* ConfLoader::parsePyramid ( TiXmlDocument* doc,std::string fileName, std
             return NULL;
         }
         std::string baseDir ( pElemLvl->GetText() );
+        if ( storage ) {
+            // Dans un stockage objet, baseDir est le préfixe des clés des dalles
+            while ( baseDir.compare ( 0,1,"/" ) ==0 ) baseDir.erase ( 0,1 );
         //Relative Path
-        if ( baseDir.compare ( 0,2,"./" ) ==0 ) {
+        } else if ( baseDir.compare ( 0,2,"./" ) ==0 ) {
             baseDir.replace ( 0,1,parentDir );
         } else if ( baseDir.compare ( 0,1,"/" ) !=0 ) {
             baseDir.insert ( 0,"/" );
@@ -688,6 +747,17 @@ Pyramid* ConfLoader::parsePyramid ( TiXmlDocument* doc,std::string fileName, std
             return NULL;
         }
 
+        // Dalles du niveau projetées en mémoire (niveaux les plus sollicités)
+        SlabStorage* levelStorage = storage;
+        pElemLvl = hLvl.FirstChild ( "mmap" ).Element();
+        if ( pElemLvl && pElemLvl->GetText() && pElemLvl->GetTextStr().compare ( "true" ) ==0 ) {
+            if ( storage ) {
+                LOGGER_WARN ( fileName <<_ ( " Level " ) << id <<_ ( ": projection en memoire impossible hors du systeme de fichiers, ignoree" ) );
+            } else {
+                levelStorage = MappedSlabStorage::getInstance();
+            }
+        }
+
         TiXmlElement *pElemLvlTMS =hLvl.FirstChild ( "TMSLimits" ).Element();
         if ( pElemLvlTMS ) { // le bloc TMSLimits n'est pas obligatoire, mais s'il est là, il doit y avoir tous les champs.
 
@@ -802,7 +872,7 @@ Pyramid* ConfLoader::parsePyramid ( TiXmlDocument* doc,std::string fileName, std
         }
 
         Level *TL = new Level ( *tm, channels, baseDir, tilesPerWidth, tilesPerHeight,
-                                maxTileRow,  minTileRow, maxTileCol, minTileCol, pathDepth, format, noDataFilePath );
+                                maxTileRow,  minTileRow, maxTileCol, minTileCol, pathDepth, format, noDataFilePath, predictor, levelStorage );
 
         levels.insert ( std::pair<std::string, Level *> ( id, TL ) );
     }// boucle sur les levels
@@ -812,7 +882,29 @@ Pyramid* ConfLoader::parsePyramid ( TiXmlDocument* doc,std::string fileName, std
         return NULL;
     }
 
+    // Liste facultative du contenu de la pyramide (écrite par be4), pour connaître les dalles existantes
+    std::string contentList;
+    pElem=hRoot.FirstChild ( "contentList" ).Element();
+    if ( pElem && pElem->GetText() ) {
+        contentList = pElem->GetText();
+        //Relative Path
+        if ( contentList.compare ( 0,2,"./" ) ==0 ) {
+            contentList.replace ( 0,1,parentDir );
+        } else if ( contentList.compare ( 0,1,"/" ) !=0 ) {
+            contentList.insert ( 0,"/" );
+            contentList.insert ( 0,parentDir );
+        }
+        if ( ! loadContentList ( contentList, levels ) ) {
+            LOGGER_WARN ( fileName << _ ( " : liste du contenu inutilisable, les dalles absentes seront recherchees sur le disque" ) );
+        }
+    }
+
     Pyramid *pyr = new Pyramid ( levels, *tms, format, channels );
+    // be4 réécrit ces fichiers à chaque mise à jour de la pyramide
+    pyr->addGenerationFile ( fileName );
+    if ( ! contentList.empty() ) {
+        pyr->addGenerationFile ( contentList );
+    }
     return pyr;
 
 }// buildPyramid()
@@ -858,6 +950,9 @@ Layer * ConfLoader::parseLayer ( TiXmlDocument* doc,std::string fileName, std::m
     GeographicBoundingBoxWMS geographicBoundingBox;
     BoundingBoxWMS boundingBox;
     std::vector<MetadataURL> metadataURLs;
+    int cacheTTL;
+    int requestTimeout;
+    std::string encoderProfile;
 
     TiXmlHandle hDoc ( doc );
     TiXmlElement* pElem;
@@ -1166,6 +1261,31 @@ Layer * ConfLoader::parseLayer ( TiXmlDocument* doc,std::string fileName, std::m
 
     resampling = Interpolation::fromString ( resamplingStr );
 
+    pElem=hRoot.FirstChild ( "cacheTTL" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        cacheTTL = DEFAULT_RESPONSE_CACHE_TTL;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&cacheTTL ) || cacheTTL < 0 ) {
+        LOGGER_ERROR ( _ ( "Le cacheTTL [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) );
+        return NULL;
+    }
+
+    pElem=hRoot.FirstChild ( "requestTimeout" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        requestTimeout = 0;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&requestTimeout ) || requestTimeout < 0 ) {
+        LOGGER_ERROR ( _ ( "Le requestTimeout [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) );
+        return NULL;
+    }
+
+    pElem=hRoot.FirstChild ( "encoderProfile" ).Element();
+    if ( pElem && pElem->GetText() ) {
+        encoderProfile = pElem->GetTextStr();
+        if ( ! EncoderProfile::get ( encoderProfile ) ) {
+            LOGGER_ERROR ( _ ( "Le profil de compression [" ) << encoderProfile <<_ ( "] est inconnu." ) );
+            return NULL;
+        }
+    }
+
     pElem=hRoot.FirstChild ( "pyramid" ).Element();
     if ( pElem && pElem->GetText() ) {
 
@@ -1220,10 +1340,17 @@ Layer * ConfLoader::parseLayer ( TiXmlDocument* doc,std::string fileName, std::m
         return NULL;
     }
 
+    // Les CRS ne différant de celui de la pyramide que par une transformation affine seront simplement rééchantillonnés
+    if ( reprojectionCapability ) {
+        BoundingBox<double> geographicBBox ( geographicBoundingBox.minx, geographicBoundingBox.miny, geographicBoundingBox.maxx, geographicBoundingBox.maxy );
+        pyramid->detectAffineCRS ( WMSCRSList, geographicBBox );
+        pyramid->detectAffineCRS ( *servicesConf->getGlobalCRSList(), geographicBBox );
+    }
+
     Layer *layer;
 
     layer = new Layer ( id, title, abstract, keyWords, pyramid, styles, minRes, maxRes,
-                        WMSCRSList, opaque, authority, resampling,geographicBoundingBox,boundingBox,metadataURLs );
+                        WMSCRSList, opaque, authority, resampling,geographicBoundingBox,boundingBox,metadataURLs, cacheTTL, requestTimeout, encoderProfile );
 
     return layer;
 }//buildLayer
@@ -1238,7 +1365,7 @@ Layer * ConfLoader::buildLayer ( std::string fileName, std::map<std::string, Til
 }
 
 // Load the server configuration (default is server.conf file) during server initialization
-bool ConfLoader::parseTechnicalParam ( TiXmlDocument* doc,std::string serverConfigFile, LogOutput& logOutput, std::string& logFilePrefix, int& logFilePeriod, LogLevel& logLevel, int& nbThread, bool& supportWMTS, bool& supportWMS, bool& reprojectionCapability, std::string& servicesConfigFile, std::string &layerDir, std::string &tmsDir, std::string &styleDir, std::string& socket, int& backlog ) {
+bool ConfLoader::parseTechnicalParam ( TiXmlDocument* doc,std::string serverConfigFile, LogOutput& logOutput, std::string& logFilePrefix, int& logFilePeriod, LogLevel& logLevel, int& nbThread, bool& supportWMTS, bool& supportWMS, bool& reprojectionCapability, std::string& servicesConfigFile, std::string &layerDir, std::string &tmsDir, std::string &styleDir, std::string& socket, int& backlog, bool& requestCoalescing, int& coalescingTimeout, int& responseCacheSize, int& responseCacheObjectSize, std::string& responseCacheDir, int& responseCacheDiskSize, int& tileThreads, int& mapThreads, int& otherThreads, int& queueSize, int& queueTimeout, int& retryAfter, int& getTileTimeout, int& getMapTimeout, int& arenaSize, double& gridMaxError, int& gridCacheSize, int& bandThreads, int& degradeQueueDepth, int& mappedSlabsSize ) {
     TiXmlHandle hDoc ( doc );
     TiXmlElement* pElem;
     TiXmlHandle hRoot ( 0 );
@@ -1448,6 +1575,171 @@ bool ConfLoader::parseTechnicalParam ( TiXmlDocument* doc,std::string serverConf
         backlog = 0;
     }
 
+    pElem=hRoot.FirstChild ( "requestCoalescing" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        std::clog<<_ ( "Pas d'element <requestCoalescing> valeur par defaut : false" ) <<std::endl;
+        requestCoalescing = false;
+    } else {
+        std::string strCoalescing ( pElem->GetText() );
+        if ( strCoalescing=="true" ) requestCoalescing=true;
+        else if ( strCoalescing=="false" ) requestCoalescing=false;
+        else {
+            std::cerr<<_ ( "Le requestCoalescing [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un booleen." ) <<std::endl;
+            return false;
+        }
+    }
+
+    pElem=hRoot.FirstChild ( "requestCoalescingTimeout" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        coalescingTimeout = DEFAULT_COALESCING_TIMEOUT;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&coalescingTimeout ) || coalescingTimeout < 0 ) {
+        std::cerr<<_ ( "Le requestCoalescingTimeout [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "responseCacheSize" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        responseCacheSize = DEFAULT_RESPONSE_CACHE_SIZE;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&responseCacheSize ) || responseCacheSize < 0 ) {
+        std::cerr<<_ ( "Le responseCacheSize [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "responseCacheMaxObjectSize" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        responseCacheObjectSize = DEFAULT_RESPONSE_CACHE_OBJECT_SIZE;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&responseCacheObjectSize ) || responseCacheObjectSize < 0 ) {
+        std::cerr<<_ ( "Le responseCacheMaxObjectSize [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "responseCacheDir" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        responseCacheDir = "";
+    } else {
+        responseCacheDir = pElem->GetTextStr();
+    }
+
+    pElem=hRoot.FirstChild ( "responseCacheDiskSize" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        responseCacheDiskSize = 0;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&responseCacheDiskSize ) || responseCacheDiskSize < 0 ) {
+        std::cerr<<_ ( "Le responseCacheDiskSize [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "tileThreads" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        tileThreads = 0;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&tileThreads ) || tileThreads < 0 ) {
+        std::cerr<<_ ( "Le tileThreads [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "mapThreads" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        mapThreads = 0;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&mapThreads ) || mapThreads < 0 ) {
+        std::cerr<<_ ( "Le mapThreads [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "otherThreads" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        otherThreads = 0;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&otherThreads ) || otherThreads < 0 ) {
+        std::cerr<<_ ( "Le otherThreads [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "queueSize" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        queueSize = DEFAULT_QUEUE_SIZE;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&queueSize ) || queueSize < 0 ) {
+        std::cerr<<_ ( "Le queueSize [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "queueTimeout" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        queueTimeout = DEFAULT_QUEUE_TIMEOUT;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&queueTimeout ) || queueTimeout < 0 ) {
+        std::cerr<<_ ( "Le queueTimeout [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "retryAfter" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        retryAfter = DEFAULT_RETRY_AFTER;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&retryAfter ) || retryAfter < 0 ) {
+        std::cerr<<_ ( "Le retryAfter [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "getTileTimeout" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        getTileTimeout = DEFAULT_REQUEST_TIMEOUT;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&getTileTimeout ) || getTileTimeout < 0 ) {
+        std::cerr<<_ ( "Le getTileTimeout [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "getMapTimeout" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        getMapTimeout = DEFAULT_REQUEST_TIMEOUT;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&getMapTimeout ) || getMapTimeout < 0 ) {
+        std::cerr<<_ ( "Le getMapTimeout [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "requestArenaSize" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        arenaSize = DEFAULT_REQUEST_ARENA_SIZE;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&arenaSize ) || arenaSize < 0 ) {
+        std::cerr<<_ ( "Le requestArenaSize [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "reprojectionMaxError" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        gridMaxError = DEFAULT_REPROJECTION_MAX_ERROR;
+    } else if ( !sscanf ( pElem->GetText(),"%lf",&gridMaxError ) || gridMaxError < 0 ) {
+        std::cerr<<_ ( "Le reprojectionMaxError [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un nombre positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "reprojectionGridCacheSize" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        gridCacheSize = DEFAULT_REPROJECTION_GRID_CACHE_SIZE;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&gridCacheSize ) || gridCacheSize < 0 ) {
+        std::cerr<<_ ( "Le reprojectionGridCacheSize [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "mapBandThreads" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        bandThreads = DEFAULT_MAP_BAND_THREADS;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&bandThreads ) || bandThreads < 0 ) {
+        std::cerr<<_ ( "Le mapBandThreads [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "encoderDegradeQueueDepth" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        degradeQueueDepth = DEFAULT_ENCODER_DEGRADE_QUEUE_DEPTH;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&degradeQueueDepth ) || degradeQueueDepth < 0 ) {
+        std::cerr<<_ ( "Le encoderDegradeQueueDepth [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
+    pElem=hRoot.FirstChild ( "mappedSlabsSize" ).Element();
+    if ( !pElem || ! ( pElem->GetText() ) ) {
+        mappedSlabsSize = DEFAULT_MAPPED_SLABS_SIZE;
+    } else if ( !sscanf ( pElem->GetText(),"%d",&mappedSlabsSize ) || mappedSlabsSize < 0 ) {
+        std::cerr<<_ ( "Le mappedSlabsSize [" ) << pElem->GetTextStr() <<_ ( "] n'est pas un entier positif." ) <<std::endl;
+        return false;
+    }
+
     return true;
 }//parseTechnicalParam
 
@@ -1904,6 +2196,84 @@ std::vector<std::string> ConfLoader::loadListEqualsCRS(){
 }
 
 
+bool ConfLoader::loadContentList ( std::string listFile, std::map<std::string, Level*> &levels ) {
+    std::ifstream input ( listFile.c_str() );
+    if ( ! input.is_open() ) {
+        LOGGER_ERROR ( _ ( "Ne peut pas charger le fichier " ) << listFile );
+        return false;
+    }
+
+    // Les niveaux sont identifiés par les deux derniers dossiers de leur baseDir (ex : IMAGE/12)
+    std::map<std::string, Level*> levelDirs;
+    std::map<Level*, std::vector<std::pair<uint32_t, uint32_t> > > levelSlabs;
+    for ( std::map<std::string, Level*>::iterator it = levels.begin(); it != levels.end(); it++ ) {
+        std::string dir = it->second->getBaseDir();
+        while ( dir.size() > 1 && dir[dir.size() - 1] == '/' ) dir.erase ( dir.size() - 1 );
+        size_t pos = dir.rfind ( '/' );
+        if ( pos != std::string::npos && pos > 0 ) pos = dir.rfind ( '/', pos - 1 );
+        levelDirs.insert ( std::pair<std::string, Level*> ( pos == std::string::npos ? dir : dir.substr ( pos + 1 ), it->second ) );
+        levelSlabs[it->second];
+    }
+
+    // En-tête : racines des caches ("ID=chemin") jusqu'au séparateur "#", puis une dalle par ligne : ID/dossier/niveau/chemin en base 36
+    bool header = true;
+    for ( std::string line; getline ( input, line ); ) {
+        if ( header ) {
+            if ( line == "#" ) header = false;
+            if ( line == "#" || line.find ( '=' ) != std::string::npos ) continue;
+            header = false;
+        }
+
+        size_t p0 = line.find ( '/' );
+        size_t p1 = ( p0 == std::string::npos ? p0 : line.find ( '/', p0 + 1 ) );
+        size_t p2 = ( p1 == std::string::npos ? p1 : line.find ( '/', p1 + 1 ) );
+        if ( p2 == std::string::npos ) continue;
+
+        std::map<std::string, Level*>::iterator itLevel = levelDirs.find ( line.substr ( p0 + 1, p2 - p0 - 1 ) );
+        if ( itLevel == levelDirs.end() ) continue; // nodata, masques, autre niveau
+
+        std::string path = line.substr ( p2 + 1 );
+        size_t ext = path.rfind ( '.' );
+        if ( ext != std::string::npos ) path.erase ( ext );
+
+        // Les caractères vont par paires (colonne, ligne), des poids forts aux poids faibles
+        uint32_t x = 0, y = 0;
+        int digits = 0;
+        bool valid = true;
+        for ( size_t i = 0; i < path.size() && valid; i++ ) {
+            char c = path[i];
+            if ( c == '/' ) continue;
+            int v;
+            if ( c >= '0' && c <= '9' ) v = c - '0';
+            else if ( c >= 'A' && c <= 'Z' ) v = c - 'A' + 10;
+            else valid = false;
+            if ( ! valid ) break;
+            if ( digits % 2 == 0 ) x = x * 36 + v;
+            else y = y * 36 + v;
+            digits++;
+        }
+        if ( ! valid || digits == 0 || digits % 2 ) {
+            LOGGER_WARN ( listFile << _ ( " : chemin de dalle invalide " ) << line );
+            continue;
+        }
+        levelSlabs[itLevel->second].push_back ( std::pair<uint32_t, uint32_t> ( x, y ) );
+    }
+
+    if ( header ) {
+        LOGGER_ERROR ( listFile << _ ( " : liste vide" ) );
+        return false;
+    }
+
+    for ( std::map<Level*, std::vector<std::pair<uint32_t, uint32_t> > >::iterator it = levelSlabs.begin(); it != levelSlabs.end(); it++ ) {
+        // Un niveau sans dalle listée peut avoir un dossier d'une autre forme : on ne le restreint pas
+        if ( it->second.empty() ) continue;
+        if ( it->first->setExistingSlabs ( it->second ) ) {
+            LOGGER_INFO ( _ ( "           Niveau " ) << it->first->getId() << " : " << it->second.size() << _ ( " dalles existantes" ) );
+        }
+    }
+    return true;
+}
+
 std::vector<std::string> ConfLoader::loadStringVectorFromFile(std::string file){
     std::vector<std::string> strVector;
     std::ifstream input ( file.c_str() );
@@ -1999,14 +2369,17 @@ bool ConfLoader::isCRSAllowed(std::vector<std::string> restrictedCRSList, std::s
 bool ConfLoader::getTechnicalParam ( std::string serverConfigFile, LogOutput& logOutput, std::string& logFilePrefix,
                                      int& logFilePeriod, LogLevel& logLevel, int& nbThread, bool& supportWMTS, bool& supportWMS,
                                      bool& reprojectionCapability, std::string& servicesConfigFile, std::string &layerDir,
-                                     std::string &tmsDir, std::string &styleDir, std::string& socket, int& backlog ) {
+                                     std::string &tmsDir, std::string &styleDir, std::string& socket, int& backlog,
+                                     bool& requestCoalescing, int& coalescingTimeout, int& responseCacheSize, int& responseCacheObjectSize,
+                                     std::string& responseCacheDir, int& responseCacheDiskSize, int& tileThreads, int& mapThreads,
+                                     int& otherThreads, int& queueSize, int& queueTimeout, int& retryAfter, int& getTileTimeout, int& getMapTimeout, int& arenaSize, double& gridMaxError, int& gridCacheSize, int& bandThreads, int& degradeQueueDepth, int& mappedSlabsSize ) {
     std::cout<<_ ( "Chargement des parametres techniques depuis " ) <<serverConfigFile<<std::endl;
     TiXmlDocument doc ( serverConfigFile );
     if ( !doc.LoadFile() ) {
         std::cerr<<_ ( "Ne peut pas charger le fichier " ) << serverConfigFile<<std::endl;
         return false;
     }
-    return parseTechnicalParam ( &doc,serverConfigFile,logOutput,logFilePrefix,logFilePeriod,logLevel,nbThread,supportWMTS,supportWMS,reprojectionCapability,servicesConfigFile,layerDir,tmsDir,styleDir, socket, backlog );
+    return parseTechnicalParam ( &doc,serverConfigFile,logOutput,logFilePrefix,logFilePeriod,logLevel,nbThread,supportWMTS,supportWMS,reprojectionCapability,servicesConfigFile,layerDir,tmsDir,styleDir, socket, backlog, requestCoalescing, coalescingTimeout, responseCacheSize, responseCacheObjectSize, responseCacheDir, responseCacheDiskSize, tileThreads, mapThreads, otherThreads, queueSize, queueTimeout, retryAfter, getTileTimeout, getMapTimeout, arenaSize, gridMaxError, gridCacheSize, bandThreads, degradeQueueDepth, mappedSlabsSize );
 }
 
 bool ConfLoader::buildStylesList ( std::string styleDir, std::map< std::string, Style* >& stylesList, bool inspire ) {
@@ -91,6 +91,26 @@ public:
      * \param[out] styleDir chemin du répertoire contenant les fichiers de Style
      * \param[out] socket adresse et port d'écoute du serveur, vide si définit par un appel FCGI
      * \param[out] backlog profondeur de la file d'attente
+     * \param[out] requestCoalescing regroupement des requêtes identiques simultanées
+     * \param[out] coalescingTimeout délai d'attente d'une requête regroupée, en millisecondes
+     * \param[out] responseCacheSize taille du cache des réponses GetMap en Mo, 0 s'il est désactivé
+     * \param[out] responseCacheObjectSize taille maximale d'une réponse mise en cache, en Ko
+     * \param[out] responseCacheDir répertoire du cache disque des réponses, vide s'il est désactivé
+     * \param[out] responseCacheDiskSize taille du cache disque des réponses, en Mo
+     * \param[out] tileThreads nombre de threads traitant les requêtes GetTile, 0 si les requêtes ne sont pas réparties dans des files
+     * \param[out] mapThreads nombre de threads traitant les requêtes GetMap
+     * \param[out] otherThreads nombre de threads traitant les autres requêtes
+     * \param[out] queueSize nombre maximal de requêtes en attente dans chaque file
+     * \param[out] queueTimeout délai d'attente maximal dans une file, en millisecondes
+     * \param[out] retryAfter délai indiqué aux clients dont la requête est refusée, en secondes
+     * \param[out] getTileTimeout délai maximal de calcul d'une réponse GetTile, en millisecondes, 0 pour ne pas limiter
+     * \param[out] getMapTimeout délai maximal de calcul d'une réponse GetMap, en millisecondes, 0 pour ne pas limiter
+     * \param[out] arenaSize taille des blocs de l'arène mémoire des requêtes, en kilo-octets, 0 pour allouer dans le tas
+     * \param[out] gridMaxError erreur maximale des grilles de reprojection, en pixel, 0 pour un pas fixe
+     * \param[out] gridCacheSize nombre de grilles de reprojection conservées, 0 pour désactiver le cache
+     * \param[out] bandThreads nombre de threads calculant les bandes horizontales d'un GetMap, 0 pour désactiver
+     * \param[out] degradeQueueDepth nombre de GetMap en attente à partir duquel le profil de compression le plus rapide est utilisé, 0 pour désactiver
+     * \param[out] mappedSlabsSize taille virtuelle totale des dalles projetées en mémoire, en Mo, 0 pour désactiver la projection
      * \return faux en cas d'erreur
      * \~english
      * \brief Load server parameter from a file
@@ -109,9 +129,29 @@ public:
      * \param[out] styleDir path to Style directory
      * \param[out] socket listening address and port, empty if defined by a FCGI call
      * \param[out] backlog listen queue depth
+     * \param[out] requestCoalescing merge identical concurrent requests
+     * \param[out] coalescingTimeout coalesced request wait, in milliseconds
+     * \param[out] responseCacheSize GetMap responses cache size in MB, 0 if disabled
+     * \param[out] responseCacheObjectSize maximal size of a cached response, in kB
+     * \param[out] responseCacheDir responses disk cache directory, empty if disabled
+     * \param[out] responseCacheDiskSize responses disk cache size, in MB
+     * \param[out] tileThreads number of threads processing GetTile requests, 0 if requests are not dispatched in queues
+     * \param[out] mapThreads number of threads processing GetMap requests
+     * \param[out] otherThreads number of threads processing other requests
+     * \param[out] queueSize maximal number of waiting requests in each queue
+     * \param[out] queueTimeout maximal wait in a queue, in milliseconds
+     * \param[out] retryAfter delay given to clients whose request is refused, in seconds
+     * \param[out] getTileTimeout maximal GetTile response computation delay, in milliseconds, 0 for no limit
+     * \param[out] getMapTimeout maximal GetMap response computation delay, in milliseconds, 0 for no limit
+     * \param[out] arenaSize requests memory arena blocks size, in kilobytes, 0 to allocate in the heap
+     * \param[out] gridMaxError reprojection grids maximal error, in pixel, 0 for a fixed step
+     * \param[out] gridCacheSize number of kept reprojection grids, 0 to disable the cache
+     * \param[out] bandThreads number of threads computing the horizontal bands of a GetMap, 0 to disable
+     * \param[out] degradeQueueDepth number of waiting GetMap from which the fastest compression profile is used, 0 to disable
+     * \param[out] mappedSlabsSize total virtual size of slabs mapped in memory, in MB, 0 to disable mapping
      * \return false if something went wrong
      */
-    static bool getTechnicalParam ( std::string serverConfigFile, LogOutput& logOutput, std::string& logFilePrefix, int& logFilePeriod, LogLevel& logLevel, int &nbThread, bool& supportWMTS, bool& supportWMS, bool& reprojectionCapability, std::string& servicesConfigFile, std::string &layerDir, std::string &tmsDir, std::string &styleDir, std::string& socket, int& backlog );
+    static bool getTechnicalParam ( std::string serverConfigFile, LogOutput& logOutput, std::string& logFilePrefix, int& logFilePeriod, LogLevel& logLevel, int &nbThread, bool& supportWMTS, bool& supportWMS, bool& reprojectionCapability, std::string& servicesConfigFile, std::string &layerDir, std::string &tmsDir, std::string &styleDir, std::string& socket, int& backlog, bool& requestCoalescing, int& coalescingTimeout, int& responseCacheSize, int& responseCacheObjectSize, std::string& responseCacheDir, int& responseCacheDiskSize, int& tileThreads, int& mapThreads, int& otherThreads, int& queueSize, int& queueTimeout, int& retryAfter, int& getTileTimeout, int& getMapTimeout, int& arenaSize, double& gridMaxError, int& gridCacheSize, int& bandThreads, int& degradeQueueDepth, int& mappedSlabsSize );
     /**
      * \~french
      * \brief Charges les différents Styles présent dans le répertoire styleDir
@@ -314,6 +354,26 @@ private:
      * \param[out] styleDir chemin du répertoire contenant les fichiers de Style
      * \param[out] socket adresse et port d'écoute du serveur, vide si définit par un appel FCGI
      * \param[out] backlog profondeur de la file d'attente
+     * \param[out] requestCoalescing regroupement des requêtes identiques simultanées
+     * \param[out] coalescingTimeout délai d'attente d'une requête regroupée, en millisecondes
+     * \param[out] responseCacheSize taille du cache des réponses GetMap en Mo, 0 s'il est désactivé
+     * \param[out] responseCacheObjectSize taille maximale d'une réponse mise en cache, en Ko
+     * \param[out] responseCacheDir répertoire du cache disque des réponses, vide s'il est désactivé
+     * \param[out] responseCacheDiskSize taille du cache disque des réponses, en Mo
+     * \param[out] tileThreads nombre de threads traitant les requêtes GetTile, 0 si les requêtes ne sont pas réparties dans des files
+     * \param[out] mapThreads nombre de threads traitant les requêtes GetMap
+     * \param[out] otherThreads nombre de threads traitant les autres requêtes
+     * \param[out] queueSize nombre maximal de requêtes en attente dans chaque file
+     * \param[out] queueTimeout délai d'attente maximal dans une file, en millisecondes
+     * \param[out] retryAfter délai indiqué aux clients dont la requête est refusée, en secondes
+     * \param[out] getTileTimeout délai maximal de calcul d'une réponse GetTile, en millisecondes, 0 pour ne pas limiter
+     * \param[out] getMapTimeout délai maximal de calcul d'une réponse GetMap, en millisecondes, 0 pour ne pas limiter
+     * \param[out] arenaSize taille des blocs de l'arène mémoire des requêtes, en kilo-octets, 0 pour allouer dans le tas
+     * \param[out] gridMaxError erreur maximale des grilles de reprojection, en pixel, 0 pour un pas fixe
+     * \param[out] gridCacheSize nombre de grilles de reprojection conservées, 0 pour désactiver le cache
+     * \param[out] bandThreads nombre de threads calculant les bandes horizontales d'un GetMap, 0 pour désactiver
+     * \param[out] degradeQueueDepth nombre de GetMap en attente à partir duquel le profil de compression le plus rapide est utilisé, 0 pour désactiver
+     * \param[out] mappedSlabsSize taille virtuelle totale des dalles projetées en mémoire, en Mo, 0 pour désactiver la projection
      * \return faux en cas d'erreur
      * \~english
      * \brief Load server parameter from its XML representation
@@ -333,9 +393,29 @@ private:
      * \param[out] styleDir path to Style directory
      * \param[out] socket listening address and port, empty if defined by a FCGI call
      * \param[out] backlog listen queue depth
+     * \param[out] requestCoalescing merge identical concurrent requests
+     * \param[out] coalescingTimeout coalesced request wait, in milliseconds
+     * \param[out] responseCacheSize GetMap responses cache size in MB, 0 if disabled
+     * \param[out] responseCacheObjectSize maximal size of a cached response, in kB
+     * \param[out] responseCacheDir responses disk cache directory, empty if disabled
+     * \param[out] responseCacheDiskSize responses disk cache size, in MB
+     * \param[out] tileThreads number of threads processing GetTile requests, 0 if requests are not dispatched in queues
+     * \param[out] mapThreads number of threads processing GetMap requests
+     * \param[out] otherThreads number of threads processing other requests
+     * \param[out] queueSize maximal number of waiting requests in each queue
+     * \param[out] queueTimeout maximal wait in a queue, in milliseconds
+     * \param[out] retryAfter delay given to clients whose request is refused, in seconds
+     * \param[out] getTileTimeout maximal GetTile response computation delay, in milliseconds, 0 for no limit
+     * \param[out] getMapTimeout maximal GetMap response computation delay, in milliseconds, 0 for no limit
+     * \param[out] arenaSize requests memory arena blocks size, in kilobytes, 0 to allocate in the heap
+     * \param[out] gridMaxError reprojection grids maximal error, in pixel, 0 for a fixed step
+     * \param[out] gridCacheSize number of kept reprojection grids, 0 to disable the cache
+     * \param[out] bandThreads number of threads computing the horizontal bands of a GetMap, 0 to disable
+     * \param[out] degradeQueueDepth number of waiting GetMap from which the fastest compression profile is used, 0 to disable
+     * \param[out] mappedSlabsSize total virtual size of slabs mapped in memory, in MB, 0 to disable mapping
      * \return false if something went wrong
      */
-    static bool parseTechnicalParam ( TiXmlDocument* doc,std::string serverConfigFile, LogOutput& logOutput, std::string& logFilePrefix, int& logFilePeriod, LogLevel& logLevel, int& nbThread, bool& supportWMTS, bool& supportWMS, bool& reprojectionCapability, std::string& servicesConfigFile, std::string &layerDir, std::string &tmsDir, std::string &styleDir, std::string& socket, int& backlog );
+    static bool parseTechnicalParam ( TiXmlDocument* doc,std::string serverConfigFile, LogOutput& logOutput, std::string& logFilePrefix, int& logFilePeriod, LogLevel& logLevel, int& nbThread, bool& supportWMTS, bool& supportWMS, bool& reprojectionCapability, std::string& servicesConfigFile, std::string &layerDir, std::string &tmsDir, std::string &styleDir, std::string& socket, int& backlog, bool& requestCoalescing, int& coalescingTimeout, int& responseCacheSize, int& responseCacheObjectSize, std::string& responseCacheDir, int& responseCacheDiskSize, int& tileThreads, int& mapThreads, int& otherThreads, int& queueSize, int& queueTimeout, int& retryAfter, int& getTileTimeout, int& getMapTimeout, int& arenaSize, double& gridMaxError, int& gridCacheSize, int& bandThreads, int& degradeQueueDepth, int& mappedSlabsSize );
     /**
      * \~french
      * \brief Chargement des paramètres des services à partir de leur représentation XML
@@ -365,6 +445,18 @@ private:
      * \brief Load strings list form file
      */
     static std::vector<std::string> loadStringVectorFromFile(std::string file);
+
+    /**
+     * \~french
+     * \brief Chargement de la liste du contenu d'une pyramide (fichier .list écrit par be4)
+     * \details Chaque niveau dont des dalles sont listées reçoit la carte de ses dalles existantes.
+     * \return faux si la liste ne peut être lue
+     * \~english
+     * \brief Load a pyramid's content list (.list file written by be4)
+     * \details Each level with listed slabs gets the map of its existing slabs.
+     * \return false if the list cannot be read
+     */
+    static bool loadContentList ( std::string listFile, std::map<std::string, Level*> &levels );
     
      /**
      * \~french
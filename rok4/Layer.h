@@ -48,6 +48,7 @@
 
 #include <vector>
 #include <string>
+#include "config.h"
 #include "Pyramid.h"
 #include "CRS.h"
 #include "Style.h"
@@ -265,6 +266,21 @@ private:
      * \~english \brief Linked metadata list
      */
     std::vector<MetadataURL> metadataURLs;
+    /**
+     * \~french \brief Durée de vie des réponses GetMap dans le cache, en secondes, 0 si elles ne sont pas mises en cache
+     * \~english \brief GetMap responses time to live in the cache, in seconds, 0 if they are not cached
+     */
+    int cacheTTL;
+    /**
+     * \~french \brief Délai maximal de calcul d'une réponse, en millisecondes, 0 pour utiliser celui de l'opération
+     * \~english \brief Maximal response computation delay, in milliseconds, 0 to use the operation one
+     */
+    int requestTimeout;
+    /**
+     * \~french \brief Nom du profil de compression des réponses GetMap, vide pour le profil par défaut
+     * \~english \brief GetMap responses compression profile name, empty for the default profile
+     */
+    std::string encoderProfile;
 
 public:
     /**
@@ -285,6 +301,9 @@ public:
      * \param[in] geographicBoundingBox emprise des données en coordonnées géographique (WGS84)
      * \param[in] boundingBox emprise des données dans le système de coordonnées natif
      * \param[in] metadataURLs liste des métadonnées associées
+     * \param[in] cacheTTL durée de vie des réponses GetMap dans le cache, en secondes
+     * \param[in] requestTimeout délai maximal de calcul d'une réponse, en millisecondes
+     * \param[in] encoderProfile nom du profil de compression des réponses GetMap
      * \~english
      * \brief Create a Layer
      * \param[in] id identifier
@@ -302,19 +321,23 @@ public:
      * \param[in] geographicBoundingBox data bounding box in geographic coordinates (WGS84)
      * \param[in] boundingBox data bounding box in native coordinates system
      * \param[in] metadataURLs linked metadata list
+     * \param[in] cacheTTL GetMap responses time to live in the cache, in seconds
+     * \param[in] requestTimeout maximal response computation delay, in milliseconds
+     * \param[in] encoderProfile GetMap responses compression profile name
      */
     Layer ( std::string id, std::string title, std::string abstract,
             std::vector<Keyword> & keyWords, Pyramid*& dataPyramid,
             std::vector<Style*> & styles, double minRes, double maxRes,
             std::vector<CRS> & WMSCRSList, bool opaque, std::string authority,
             Interpolation::KernelType resampling, GeographicBoundingBoxWMS geographicBoundingBox,
-            BoundingBoxWMS boundingBox, std::vector<MetadataURL>& metadataURLs )
+            BoundingBoxWMS boundingBox, std::vector<MetadataURL>& metadataURLs, int cacheTTL = DEFAULT_RESPONSE_CACHE_TTL,
+            int requestTimeout = 0, std::string encoderProfile = "" )
         :id ( id ), title ( title ), abstract ( abstract ), keyWords ( keyWords ),
-         dataPyramid ( dataPyramid ), styles ( styles ), minRes ( minRes ),
+         dataPyramid ( dataPyramid ), defaultStyle ( styles.at ( 0 )->getId() ), styles ( styles ), minRes ( minRes ),
          maxRes ( maxRes ), WMSCRSList ( WMSCRSList ), opaque ( opaque ),
          authority ( authority ),resampling ( resampling ),
          geographicBoundingBox ( geographicBoundingBox ),
-         boundingBox ( boundingBox ), metadataURLs ( metadataURLs ), defaultStyle ( styles.at ( 0 )->getId() ) {
+         boundingBox ( boundingBox ), metadataURLs ( metadataURLs ), cacheTTL ( cacheTTL ), requestTimeout ( requestTimeout ), encoderProfile ( encoderProfile ) {
     }
 
     /**
@@ -363,6 +386,7 @@ public:
      * \param [in] height hauteur de l'image demandé
      * \param [in] dst_crs système de coordonnées du rectangle englobant
      * \param [in,out] error code de retour d'erreur
+     * \param [in,out] level niveau de la pyramide à utiliser, choisi et renseigné s'il est vide (optionnel)
      * \return une image ou un poiteur nul
      * \~english
      * The resulting image is cropped on the coordinates system definition area.
@@ -373,9 +397,10 @@ public:
      * \param [in] height requested image height
      * \param [in] dst_crs bounding box coordinate system
      * \param [in,out] error error code
+     * \param [in,out] level pyramid level to use, chosen and filled in if empty (optional)
      * \return an image or a null pointer
      */
-    Image* getbbox (ServicesConf& servicesConf, BoundingBox<double> bbox, int width, int height, CRS dst_crs, int& error );
+    Image* getbbox (ServicesConf& servicesConf, BoundingBox<double> bbox, int width, int height, CRS dst_crs, int& error, std::string* level = NULL );
     /**
     * \~french
     * \brief Retourne le résumé
@@ -542,6 +567,39 @@ public:
     std::vector<MetadataURL> getMetadataURLs() const {
         return metadataURLs;
     }
+    /**
+     * \~french
+     * \brief Retourne la durée de vie des réponses GetMap dans le cache
+     * \return durée en secondes, 0 si les réponses ne sont pas mises en cache
+     * \~english
+     * \brief Return the GetMap responses time to live in the cache
+     * \return time in seconds, 0 if responses are not cached
+     */
+    int getCacheTTL() const {
+        return cacheTTL;
+    }
+    /**
+     * \~french
+     * \brief Retourne le délai maximal de calcul d'une réponse
+     * \return délai en millisecondes, 0 pour utiliser celui de l'opération
+     * \~english
+     * \brief Return the maximal response computation delay
+     * \return delay in milliseconds, 0 to use the operation one
+     */
+    int getRequestTimeout() const {
+        return requestTimeout;
+    }
+    /**
+     * \~french
+     * \brief Retourne le nom du profil de compression des réponses GetMap
+     * \return nom du profil, vide pour le profil par défaut
+     * \~english
+     * \brief Return the GetMap responses compression profile name
+     * \return profile name, empty for the default profile
+     */
+    std::string getEncoderProfile() const {
+        return encoderProfile;
+    }
     /**
      * \~french
      * \brief Destructeur par défaut
@@ -44,7 +44,13 @@
 #include "RawImage.h"
 #include "Decoder.h"
 #include "TiffEncoder.h"
+#include "JPEGEncoder.h"
+#include "PNGEncoder.h"
+#include "BilEncoder.h"
+#include "EmptyImage.h"
 #include "TiffHeaderDataSource.h"
+#include "TileTable.h"
+#include "Predictor.h"
 #include <cmath>
 #include "Logger.h"
 #include "Kernel.h"
@@ -64,13 +70,14 @@
 Level::Level ( TileMatrix tm, int channels, std::string baseDir, int tilesPerWidth,
                int tilesPerHeight, uint32_t maxTileRow, uint32_t minTileRow,
                uint32_t maxTileCol, uint32_t minTileCol, int pathDepth,
-               Rok4Format::eformat_data format, std::string noDataFile ) :
+               Rok4Format::eformat_data format, std::string noDataFile, Predictor::ePredictor predictor, SlabStorage* storage ) :
     tm ( tm ), channels ( channels ), baseDir ( baseDir ),
     tilesPerWidth ( tilesPerWidth ), tilesPerHeight ( tilesPerHeight ),
     maxTileRow ( maxTileRow ), minTileRow ( minTileRow ), maxTileCol ( maxTileCol ),
-    minTileCol ( minTileCol ), pathDepth ( pathDepth ), format ( format ),noDataFile ( noDataFile ), noDataSource ( NULL ) {
+    minTileCol ( minTileCol ), pathDepth ( pathDepth ), format ( format ), predictor ( predictor ), noDataFile ( noDataFile ), noDataSource ( NULL ), slabMap ( NULL ), storage ( storage ) {
     noDataTileSource = new FileDataSource ( noDataFile.c_str(),2048,2048+4, Rok4Format::toMimeType ( format ), Rok4Format::toEncoding ( format ) );
     noDataSourceProxy = noDataTileSource;
+    pthread_mutex_init ( &constantTilesMutex, NULL );
 }
 
 Level::~Level() {
@@ -79,6 +86,13 @@ Level::~Level() {
     if ( noDataSource )
         delete noDataSource;
 
+    std::map<std::string, DataSource*>::iterator it;
+    for ( it = constantTiles.begin(); it != constantTiles.end(); it++ ) {
+        delete it->second;
+    }
+    pthread_mutex_destroy ( &constantTilesMutex );
+    delete slabMap;
+
 }
 
 void Level::setNoData ( const std::string& file ) {
@@ -145,7 +159,9 @@ Image* Level::getnodatabbox ( ServicesConf& servicesConf, BoundingBox< double >
     }
 
     LOGGER_DEBUG ( "Top 1" );
-    return new ResampledImage ( imageout, width, height, res_x, res_y, bbox, interpolation, false );
+    // Les tuiles entières sur 8 bits sont réechantillonnées en virgule fixe
+    bool integerSource = ( format != Rok4Format::UNKNOWN && Rok4Format::toSampleSize ( format ) == 1 );
+    return new ResampledImage ( imageout, width, height, res_x, res_y, bbox, interpolation, false, integerSource );
 }
 
 
@@ -159,6 +175,7 @@ Image* Level::getbbox ( ServicesConf& servicesConf, BoundingBox< double > bbox,
 
     if ( ! ( grid->reproject ( dst_crs.getProj4Code(), src_crs.getProj4Code() ) ) ) {
         error = 1; // BBox invalid
+        delete grid;
         return 0;
     }
 
@@ -171,22 +188,30 @@ Image* Level::getbbox ( ServicesConf& servicesConf, BoundingBox< double > bbox,
     const Kernel& kk = Kernel::getInstance ( interpolation ); // Lanczos_2
     double ratio_x = ( grid->bbox.xmax - grid->bbox.xmin ) / ( tm.getRes() *double ( width ) );
     double ratio_y = ( grid->bbox.ymax - grid->bbox.ymin ) / ( tm.getRes() *double ( height ) );
+
+    // Les tuiles sont si possible décodées à résolution réduite
+    int scale = getDecodingScale ( ratio_x, ratio_y );
+    double res = tm.getRes() * scale;
+    ratio_x /= scale;
+    ratio_y /= scale;
+
     double bufx=kk.size ( ratio_x );
     double bufy=kk.size ( ratio_y );
 
     bufx<50?bufx=50:0;
     bufy<50?bufy=50:0; // Pour etre sur de ne pas regresser
-    BoundingBox<int64_t> bbox_int ( floor ( ( grid->bbox.xmin - tm.getX0() ) /tm.getRes() - bufx ),
-                                    floor ( ( tm.getY0() - grid->bbox.ymax ) /tm.getRes() - bufy ),
-                                    ceil ( ( grid->bbox.xmax - tm.getX0() ) /tm.getRes() + bufx ),
-                                    ceil ( ( tm.getY0() - grid->bbox.ymin ) /tm.getRes() + bufy ) );
+    BoundingBox<int64_t> bbox_int ( floor ( ( grid->bbox.xmin - tm.getX0() ) /res - bufx ),
+                                    floor ( ( tm.getY0() - grid->bbox.ymax ) /res - bufy ),
+                                    ceil ( ( grid->bbox.xmax - tm.getX0() ) /res + bufx ),
+                                    ceil ( ( tm.getY0() - grid->bbox.ymin ) /res + bufy ) );
 
-    Image* image = getwindow ( servicesConf, bbox_int, error );
+    Image* image = getwindow ( servicesConf, bbox_int, error, scale );
     if ( !image ) {
         LOGGER_DEBUG ( _ ( "Image invalid !" ) );
+        delete grid;
         return 0;
     }
-    image->setBbox ( BoundingBox<double> ( tm.getX0() + tm.getRes() * bbox_int.xmin, tm.getY0() - tm.getRes() * bbox_int.ymax, tm.getX0() + tm.getRes() * bbox_int.xmax, tm.getY0() - tm.getRes() * bbox_int.ymin ) );
+    image->setBbox ( BoundingBox<double> ( tm.getX0() + res * bbox_int.xmin, tm.getY0() - res * bbox_int.ymax, tm.getX0() + res * bbox_int.xmax, tm.getY0() - res * bbox_int.ymin ) );
 
     grid->affine_transform ( 1./image->getResX(), -image->getBbox().xmin/image->getResX() - 0.5,
                              -1./image->getResY(), image->getBbox().ymax/image->getResY() - 0.5 );
@@ -197,12 +222,16 @@ Image* Level::getbbox ( ServicesConf& servicesConf, BoundingBox< double > bbox,
 
 Image* Level::getbbox ( ServicesConf& servicesConf, BoundingBox< double > bbox, int width, int height, Interpolation::KernelType interpolation, int& error ) {
 
-    // On convertit les coordonnées en nombre de pixels depuis l'origine X0,Y0
-    bbox.xmin = ( bbox.xmin - tm.getX0() ) /tm.getRes();
-    bbox.xmax = ( bbox.xmax - tm.getX0() ) /tm.getRes();
+    // Les tuiles sont si possible décodées à résolution réduite
+    int scale = getDecodingScale ( ( bbox.xmax - bbox.xmin ) / ( tm.getRes() * width ), ( bbox.ymax - bbox.ymin ) / ( tm.getRes() * height ) );
+    double res = tm.getRes() * scale;
+
+    // On convertit les coordonnées en nombre de pixels (du niveau éventuellement réduit) depuis l'origine X0,Y0
+    bbox.xmin = ( bbox.xmin - tm.getX0() ) /res;
+    bbox.xmax = ( bbox.xmax - tm.getX0() ) /res;
     double tmp = bbox.ymin;
-    bbox.ymin = ( tm.getY0() - bbox.ymax ) /tm.getRes();
-    bbox.ymax = ( tm.getY0() - tmp ) /tm.getRes();
+    bbox.ymin = ( tm.getY0() - bbox.ymax ) /res;
+    bbox.ymax = ( tm.getY0() - tmp ) /res;
 
     //A VERIFIER !!!!
     BoundingBox<int64_t> bbox_int ( floor ( bbox.xmin + EPS ),
@@ -215,7 +244,7 @@ Image* Level::getbbox ( ServicesConf& servicesConf, BoundingBox< double > bbox,
             bbox.ymin - bbox_int.ymin < EPS && bbox_int.ymax - bbox.ymax < EPS ) {
         /* L'image demandée est en phase et à les mêmes résolutions que les images du niveau
          *   => pas besoin de réechantillonnage */
-        return getwindow ( servicesConf, bbox_int, error );
+        return getwindow ( servicesConf, bbox_int, error, scale );
     }
 
     // Rappel : les coordonnees de la bbox sont ici en pixels
@@ -232,7 +261,7 @@ Image* Level::getbbox ( ServicesConf& servicesConf, BoundingBox< double > bbox,
     bbox_int.ymin = floor ( bbox.ymin - kk.size ( ratio_y ) );
     bbox_int.ymax = ceil ( bbox.ymax + kk.size ( ratio_y ) );
 
-    Image* imageout = getwindow ( servicesConf, bbox_int, error );
+    Image* imageout = getwindow ( servicesConf, bbox_int, error, scale );
     if ( !imageout ) {
         LOGGER_DEBUG ( _ ( "Image invalid !" ) );
         return 0;
@@ -245,7 +274,9 @@ Image* Level::getbbox ( ServicesConf& servicesConf, BoundingBox< double > bbox,
         return 0;
     }
 
-    return new ResampledImage ( imageout, width, height, ratio_x, ratio_y, bbox, interpolation, false );
+    // Les tuiles entières sur 8 bits sont réechantillonnées en virgule fixe
+    bool integerSource = ( format != Rok4Format::UNKNOWN && Rok4Format::toSampleSize ( format ) == 1 );
+    return new ResampledImage ( imageout, width, height, ratio_x, ratio_y, bbox, interpolation, false, integerSource );
 }
 
 int euclideanDivisionQuotient ( int64_t i, int n ) {
@@ -261,17 +292,21 @@ int euclideanDivisionRemainder ( int64_t i, int n ) {
     return r;
 }
 
-Image* Level::getwindow ( ServicesConf& servicesConf, BoundingBox< int64_t > bbox, int& error ) {
-    int tile_xmin=euclideanDivisionQuotient ( bbox.xmin,tm.getTileW() );
-    int tile_xmax=euclideanDivisionQuotient ( bbox.xmax -1,tm.getTileW() );
+Image* Level::getwindow ( ServicesConf& servicesConf, BoundingBox< int64_t > bbox, int& error, int scale ) {
+    // Dimensions des tuiles décodées
+    int tileW = tm.getTileW() / scale;
+    int tileH = tm.getTileH() / scale;
+
+    int tile_xmin=euclideanDivisionQuotient ( bbox.xmin,tileW );
+    int tile_xmax=euclideanDivisionQuotient ( bbox.xmax -1,tileW );
     int nbx = tile_xmax - tile_xmin + 1;
     if ( nbx >= servicesConf.getMaxTileX() ) {
         LOGGER_INFO ( _ ( "Too Much Tile on X axis" ) );
         error=2;
         return 0;
     }
-    int tile_ymin=euclideanDivisionQuotient ( bbox.ymin,tm.getTileH() );
-    int tile_ymax = euclideanDivisionQuotient ( bbox.ymax-1,tm.getTileH() );
+    int tile_ymin=euclideanDivisionQuotient ( bbox.ymin,tileH );
+    int tile_ymax = euclideanDivisionQuotient ( bbox.ymax-1,tileH );
     int nby = tile_ymax - tile_ymin + 1;
     if ( nby >= servicesConf.getMaxTileY() ) {
         LOGGER_INFO ( _ ( "Too Much Tile on Y axis" ) );
@@ -281,21 +316,21 @@ Image* Level::getwindow ( ServicesConf& servicesConf, BoundingBox< int64_t > bbo
 
     int left[nbx];
     memset ( left,   0, nbx*sizeof ( int ) );
-    left[0]=euclideanDivisionRemainder ( bbox.xmin,tm.getTileW() );
+    left[0]=euclideanDivisionRemainder ( bbox.xmin,tileW );
     int top[nby];
     memset ( top,    0, nby*sizeof ( int ) );
-    top[0]=euclideanDivisionRemainder ( bbox.ymin,tm.getTileH() );
+    top[0]=euclideanDivisionRemainder ( bbox.ymin,tileH );
     int right[nbx];
     memset ( right,  0, nbx*sizeof ( int ) );
-    right[nbx - 1] = tm.getTileW() - euclideanDivisionRemainder ( bbox.xmax -1,tm.getTileW() ) -1;
+    right[nbx - 1] = tileW - euclideanDivisionRemainder ( bbox.xmax -1,tileW ) -1;
     int bottom[nby];
     memset ( bottom, 0, nby*sizeof ( int ) );
-    bottom[nby- 1] = tm.getTileH() - euclideanDivisionRemainder ( bbox.ymax -1,tm.getTileH() ) - 1;
+    bottom[nby- 1] = tileH - euclideanDivisionRemainder ( bbox.ymax -1,tileH ) - 1;
 
     std::vector<std::vector<Image*> > T ( nby, std::vector<Image*> ( nbx ) );
     for ( int y = 0; y < nby; y++ )
         for ( int x = 0; x < nbx; x++ ) {
-            T[y][x] = getTile ( tile_xmin + x, tile_ymin + y, left[x], top[y], right[x], bottom[y] );
+            T[y][x] = getTile ( tile_xmin + x, tile_ymin + y, left[x], top[y], right[x], bottom[y], scale );
         }
 
     if ( nbx == 1 && nby == 1 ) return T[0][0];
@@ -348,11 +383,56 @@ std::string Level::getFilePath ( int tilex, int tiley ) {
     return baseDir + ( path + pos );
 }
 
+bool Level::setExistingSlabs ( const std::vector<std::pair<uint32_t, uint32_t> >& slabs ) {
+    uint32_t minX = minTileCol / tilesPerWidth;
+    uint32_t minY = minTileRow / tilesPerHeight;
+    uint32_t width = maxTileCol / tilesPerWidth - minX + 1;
+    uint32_t height = maxTileRow / tilesPerHeight - minY + 1;
+
+    if ( ( uint64_t ) width * height > CONTENT_LIST_MAX_SLABS ) {
+        LOGGER_WARN ( _ ( "Niveau " ) << getId() << _ ( " : trop de dalles possibles pour une carte des dalles existantes" ) );
+        return false;
+    }
+
+    std::vector<bool>* map = new std::vector<bool> ( ( size_t ) width * height, false );
+    for ( size_t i = 0; i < slabs.size(); i++ ) {
+        if ( slabs[i].first < minX || slabs[i].first >= minX + width || slabs[i].second < minY || slabs[i].second >= minY + height ) {
+            LOGGER_WARN ( _ ( "Niveau " ) << getId() << _ ( " : dalle " ) << slabs[i].first << "," << slabs[i].second
+                          << _ ( " hors des TMSLimits, pas de carte des dalles existantes" ) );
+            delete map;
+            return false;
+        }
+        ( *map ) [ ( size_t ) ( slabs[i].second - minY ) * width + slabs[i].first - minX] = true;
+    }
+
+    delete slabMap;
+    slabMap = map;
+    slabMapMinX = minX;
+    slabMapMinY = minY;
+    slabMapWidth = width;
+    slabMapHeight = height;
+    return true;
+}
+
+bool Level::isSlabPresent ( int x, int y ) {
+    if ( ! slabMap ) return true;
+    if ( x < 0 || y < 0 ) return false;
+    uint32_t slabX = x / tilesPerWidth, slabY = y / tilesPerHeight;
+    if ( slabX < slabMapMinX || slabX >= slabMapMinX + slabMapWidth || slabY < slabMapMinY || slabY >= slabMapMinY + slabMapHeight ) {
+        return false;
+    }
+    return ( *slabMap ) [ ( size_t ) ( slabY - slabMapMinY ) * slabMapWidth + slabX - slabMapMinX];
+}
+
 /*
  * @return la tuile d'indice (x,y) du niveau
  */
 
-DataSource* Level::getEncodedTile ( int x, int y ) {
+FileDataSource* Level::getEncodedTile ( int x, int y ) {
+    // Dalle absente d'après la carte des dalles : pas d'accès au système de fichiers
+    if ( ! isSlabPresent ( x, y ) ) {
+        return 0;
+    }
     // TODO: return 0 sur des cas d'erreur..
     // Index de la tuile (cf. ordre de rangement des tuiles)
     int n= ( y%tilesPerHeight ) *tilesPerWidth + ( x%tilesPerWidth );
@@ -360,82 +440,226 @@ DataSource* Level::getEncodedTile ( int x, int y ) {
     uint32_t posoff=2048+4*n, possize=2048+4*n +tilesPerWidth*tilesPerHeight*4;
     std::string path=getFilePath ( x, y );
     LOGGER_DEBUG ( path );
-    return new FileDataSource ( path.c_str(),posoff,possize,Rok4Format::toMimeType ( format ), Rok4Format::toEncoding( format ) );
+    return new FileDataSource ( storage, path.c_str(),posoff,possize,Rok4Format::toMimeType ( format ), Rok4Format::toEncoding( format ) );
 }
 
-DataSource* Level::getDecodedTile ( int x, int y ) {
-    DataSource* encData = new DataSourceProxy ( getEncodedTile ( x, y ),*getEncodedNoDataTile() );
-    if ( format==Rok4Format::TIFF_RAW_INT8 || format==Rok4Format::TIFF_RAW_FLOAT32 )
+int Level::getDecodingScale ( double ratio_x, double ratio_y ) {
+    if ( format != Rok4Format::TIFF_JPG_INT8 ) {
+        return 1;
+    }
+    // Le décodage réduit ne doit pas rendre nécessaire un sur-échantillonnage
+    double ratio = std::min ( ratio_x, ratio_y );
+    for ( int scale = 8; scale > 1; scale /= 2 ) {
+        if ( ratio >= scale && tm.getTileW() % scale == 0 && tm.getTileH() % scale == 0 ) {
+            return scale;
+        }
+    }
+    return 1;
+}
+
+DataSource* Level::getDecodedTile ( int x, int y, int scale, FileDataSource* encoded ) {
+    // Si la requête est calculée par plusieurs images, elles partagent les tuiles décodées
+    TileTable* table = TileTable::getCurrent();
+    if ( table ) {
+        DataSource* shared = table->find ( this, x, y, scale );
+        if ( shared ) {
+            delete encoded;
+            return shared;
+        }
+        DataSource* decoded = createDecodedTile ( encoded ? encoded : getEncodedTile ( x, y ), scale );
+        return decoded ? table->insert ( this, x, y, scale, decoded ) : 0;
+    }
+    return createDecodedTile ( encoded ? encoded : getEncodedTile ( x, y ), scale );
+}
+
+DataSource* Level::createDecodedTile ( FileDataSource* encoded, int scale ) {
+    DataSource* encData = new DataSourceProxy ( encoded,*getEncodedNoDataTile() );
+    if ( format==Rok4Format::TIFF_RAW_INT8 || format==Rok4Format::TIFF_RAW_UINT16 || format==Rok4Format::TIFF_RAW_FLOAT32 )
         return encData;
+    else if ( format==Rok4Format::TIFF_JPG_INT8 && scale == 8 )
+        return new DataSourceDecoder<ScaledJpegDecoder<8> > ( encData );
+    else if ( format==Rok4Format::TIFF_JPG_INT8 && scale == 4 )
+        return new DataSourceDecoder<ScaledJpegDecoder<4> > ( encData );
+    else if ( format==Rok4Format::TIFF_JPG_INT8 && scale == 2 )
+        return new DataSourceDecoder<ScaledJpegDecoder<2> > ( encData );
     else if ( format==Rok4Format::TIFF_JPG_INT8 )
         return new DataSourceDecoder<JpegDecoder> ( encData );
     else if ( format==Rok4Format::TIFF_PNG_INT8 )
         return new DataSourceDecoder<PngDecoder> ( encData );
-    else if ( format==Rok4Format::TIFF_LZW_INT8 || format == Rok4Format::TIFF_LZW_FLOAT32 )
-        return new DataSourceDecoder<LzwDecoder> ( encData );
-    else if ( format==Rok4Format::TIFF_ZIP_INT8 || format == Rok4Format::TIFF_ZIP_FLOAT32 )
-        return new DataSourceDecoder<DeflateDecoder> ( encData );
-    else if ( format==Rok4Format::TIFF_PKB_INT8 || format == Rok4Format::TIFF_PKB_FLOAT32 )
+    else if ( format==Rok4Format::TIFF_LZW_INT8 || format==Rok4Format::TIFF_LZW_UINT16 || format == Rok4Format::TIFF_LZW_FLOAT32 )
+        return revertPredictor ( new DataSourceDecoder<LzwDecoder> ( encData ) );
+    else if ( format==Rok4Format::TIFF_ZIP_INT8 || format==Rok4Format::TIFF_ZIP_UINT16 || format == Rok4Format::TIFF_ZIP_FLOAT32 )
+        return revertPredictor ( new DataSourceDecoder<DeflateDecoder> ( encData ) );
+    else if ( format==Rok4Format::TIFF_PKB_INT8 || format==Rok4Format::TIFF_PKB_UINT16 || format == Rok4Format::TIFF_PKB_FLOAT32 )
         return new DataSourceDecoder<PackBitsDecoder> ( encData );
+    else if ( format==Rok4Format::TIFF_ZSTD_INT8 || format == Rok4Format::TIFF_ZSTD_FLOAT32 )
+        return revertPredictor ( new DataSourceDecoder<ZstdDecoder> ( encData, getRawTileSize() ) );
     LOGGER_ERROR ( _ ( "Type d'encodage inconnu : " ) <<format );
     return 0;
 }
 
+size_t Level::getRawTileSize() {
+    return ( size_t ) tm.getTileW() * tm.getTileH() * channels * Rok4Format::toSampleSize ( format );
+}
+
+DataSource* Level::revertPredictor ( DataSource* decData ) {
+    if ( predictor == Predictor::NONE ) return decData;
+    int sampleSize = Rok4Format::toSampleSize ( format );
+    return new PredictorDecoder ( decData, predictor, tm.getTileW(), tm.getTileH(), channels, sampleSize );
+}
+
 DataSource* Level::getDecodedNoDataTile() {
     DataSource* encData = new DataSourceProxy ( new FileDataSource ( "",0,0,"" ),*getEncodedNoDataTile() );
-    if ( format==Rok4Format::TIFF_RAW_INT8 || format==Rok4Format::TIFF_RAW_FLOAT32 )
+    if ( format==Rok4Format::TIFF_RAW_INT8 || format==Rok4Format::TIFF_RAW_UINT16 || format==Rok4Format::TIFF_RAW_FLOAT32 )
         return encData;
     else if ( format==Rok4Format::TIFF_JPG_INT8 )
         return new DataSourceDecoder<JpegDecoder> ( encData );
     else if ( format==Rok4Format::TIFF_PNG_INT8 )
         return new DataSourceDecoder<PngDecoder> ( encData );
-    else if ( format==Rok4Format::TIFF_LZW_INT8 || format == Rok4Format::TIFF_LZW_FLOAT32 )
-        return new DataSourceDecoder<LzwDecoder> ( encData );
-    else if ( format==Rok4Format::TIFF_ZIP_INT8 || format == Rok4Format::TIFF_ZIP_FLOAT32 )
-        return new DataSourceDecoder<DeflateDecoder> ( encData );
-    else if ( format==Rok4Format::TIFF_PKB_INT8 || format == Rok4Format::TIFF_PKB_FLOAT32 )
+    else if ( format==Rok4Format::TIFF_LZW_INT8 || format==Rok4Format::TIFF_LZW_UINT16 || format == Rok4Format::TIFF_LZW_FLOAT32 )
+        return revertPredictor ( new DataSourceDecoder<LzwDecoder> ( encData ) );
+    else if ( format==Rok4Format::TIFF_ZIP_INT8 || format==Rok4Format::TIFF_ZIP_UINT16 || format == Rok4Format::TIFF_ZIP_FLOAT32 )
+        return revertPredictor ( new DataSourceDecoder<DeflateDecoder> ( encData ) );
+    else if ( format==Rok4Format::TIFF_PKB_INT8 || format==Rok4Format::TIFF_PKB_UINT16 || format == Rok4Format::TIFF_PKB_FLOAT32 )
         return new DataSourceDecoder<PackBitsDecoder> ( encData );
+    else if ( format==Rok4Format::TIFF_ZSTD_INT8 || format == Rok4Format::TIFF_ZSTD_FLOAT32 )
+        return revertPredictor ( new DataSourceDecoder<ZstdDecoder> ( encData, getRawTileSize() ) );
     LOGGER_ERROR ( _ ( "Type d'encodage inconnu : " ) <<format );
     return 0;
 }
 
+DataSource* Level::encodeTile ( Image* image ) {
+    DataStream* stream;
+    if ( format==Rok4Format::TIFF_JPG_INT8 ) {
+        stream = new JPEGEncoder ( image );
+    } else if ( format==Rok4Format::TIFF_PNG_INT8 ) {
+        stream = new PNGEncoder ( image );
+    } else if ( format==Rok4Format::TIFF_RAW_FLOAT32 ) {
+        stream = new BilEncoder ( image );
+    } else {
+        stream = TiffEncoder::getTiffEncoder ( image, format );
+    }
+    if ( ! stream ) {
+        return 0;
+    }
+    DataSource* source = new BufferedDataSource ( *stream );
+    delete stream;
+    return source;
+}
+
+Image* Level::getConstantImage ( const uint8_t* value, int width, int height ) {
+    int sampleSize = Rok4Format::toSampleSize ( format );
+    float color[channels];
+    for ( int c = 0; c < channels; c++ ) {
+        if ( sampleSize == 4 ) {
+            color[c] = ( ( const float* ) value ) [c];
+        } else if ( sampleSize == 2 ) {
+            color[c] = ( ( const uint16_t* ) value ) [c];
+        } else {
+            color[c] = value[c];
+        }
+    }
+    return new EmptyImage ( width, height, channels, color );
+}
+
+DataSource* Level::getConstantTile ( const uint8_t* value ) {
+    std::string key ( ( const char* ) value, channels * Rok4Format::toSampleSize ( format ) );
+
+    pthread_mutex_lock ( &constantTilesMutex );
+    std::map<std::string, DataSource*>::iterator it = constantTiles.find ( key );
+    DataSource* tile = ( it != constantTiles.end() ? it->second : 0 );
+    pthread_mutex_unlock ( &constantTilesMutex );
+
+    if ( tile ) {
+        return new DataSourceProxy ( 0, *tile );
+    }
+
+    tile = encodeTile ( getConstantImage ( value, tm.getTileW(), tm.getTileH() ) );
+    if ( ! tile ) {
+        return 0;
+    }
+
+    pthread_mutex_lock ( &constantTilesMutex );
+    it = constantTiles.find ( key );
+    if ( it != constantTiles.end() ) {
+        // Encodée entre temps par un autre thread
+        delete tile;
+        tile = it->second;
+    } else if ( constantTiles.size() < CONSTANT_TILE_CACHE_SIZE ) {
+        constantTiles.insert ( std::pair<std::string, DataSource*> ( key, tile ) );
+    } else {
+        // Trop de valeurs différentes : la tuile n'est pas conservée
+        pthread_mutex_unlock ( &constantTilesMutex );
+        return tile;
+    }
+    pthread_mutex_unlock ( &constantTilesMutex );
+
+    return new DataSourceProxy ( 0, *tile );
+}
+
 DataSource* Level::getEncodedNoDataTile() {
     LOGGER_DEBUG ( _ ( "Tile : " ) << noDataFile );
     return noDataSourceProxy;
 }
 
 DataSource* Level::getTile ( int x, int y , DataSource* errorDataSource ) {
-    DataSource* source=getEncodedTile ( x, y );
+    FileDataSource* source=getEncodedTile ( x, y );
     DataSource* ndSource = ( errorDataSource?errorDataSource:noDataSourceProxy );
     size_t size;
 
-    if ( ( format==Rok4Format::TIFF_RAW_INT8 || format == Rok4Format::TIFF_LZW_INT8 || format==Rok4Format::TIFF_LZW_FLOAT32 || format==Rok4Format::TIFF_ZIP_INT8 || format == Rok4Format::TIFF_ZIP_FLOAT32 || format==Rok4Format::TIFF_PKB_FLOAT32 || format==Rok4Format::TIFF_PKB_INT8 ) && source!=0 && source->getData ( size ) !=0 ) {
+    if ( ! source ) {
+        return new DataSourceProxy ( 0, *ndSource );
+    }
+
+    uint8_t value[CONSTANT_TILE_VALUE_SIZE];
+    if ( source->getConstantValue ( value ) ) {
+        // Tuile constante : on renvoie la tuile encodée partagée, sans lecture
+        DataSource* constant = getConstantTile ( value );
+        if ( constant ) {
+            delete source;
+            return constant;
+        }
+    }
+
+    if ( ( format==Rok4Format::TIFF_RAW_INT8 || format == Rok4Format::TIFF_LZW_INT8 || format==Rok4Format::TIFF_LZW_FLOAT32 || format==Rok4Format::TIFF_ZIP_INT8 || format == Rok4Format::TIFF_ZIP_FLOAT32 || format==Rok4Format::TIFF_PKB_FLOAT32 || format==Rok4Format::TIFF_PKB_INT8 || format==Rok4Format::TIFF_ZSTD_INT8 || format==Rok4Format::TIFF_ZSTD_FLOAT32 ||
+            format==Rok4Format::TIFF_RAW_UINT16 || format==Rok4Format::TIFF_LZW_UINT16 || format==Rok4Format::TIFF_ZIP_UINT16 || format==Rok4Format::TIFF_PKB_UINT16 ) && source!=0 && source->getData ( size ) !=0 ) {
         LOGGER_DEBUG ( _ ( "GetTile Tiff" ) );
-        TiffHeaderDataSource* fullTiffDS = new TiffHeaderDataSource ( source,format,channels,tm.getTileW(), tm.getTileH() );
+        TiffHeaderDataSource* fullTiffDS = new TiffHeaderDataSource ( source,format,channels,tm.getTileW(), tm.getTileH(), 0, predictor );
         return new DataSourceProxy ( fullTiffDS,*ndSource );
     }
 
     return new DataSourceProxy ( source, *ndSource );
 }
 
-Image* Level::getTile ( int x, int y, int left, int top, int right, int bottom ) {
-    int pixel_size=1;
+Image* Level::getTile ( int x, int y, int left, int top, int right, int bottom, int scale ) {
+    int pixel_size = Rok4Format::toSampleSize ( format );
     LOGGER_DEBUG ( _ ( "GetTile Image" ) );
-    if ( format==Rok4Format::TIFF_RAW_FLOAT32 || format == Rok4Format::TIFF_LZW_FLOAT32 || format == Rok4Format::TIFF_ZIP_FLOAT32 || format == Rok4Format::TIFF_PKB_FLOAT32 )
-        pixel_size=4;
-    return new ImageDecoder ( getDecodedTile ( x,y ), tm.getTileW(), tm.getTileH(), channels,
-                              BoundingBox<double> ( tm.getX0() + x * tm.getTileW() * tm.getRes() + left * tm.getRes(),
-                                      tm.getY0() - ( y+1 ) * tm.getTileH() * tm.getRes() + bottom * tm.getRes(),
-                                      tm.getX0() + ( x+1 ) * tm.getTileW() * tm.getRes() - right * tm.getRes(),
-                                      tm.getY0() - y * tm.getTileH() * tm.getRes() - top * tm.getRes() ),
+    // Dimensions et résolution de la tuile décodée, éventuellement réduite
+    int tileW = tm.getTileW() / scale;
+    int tileH = tm.getTileH() / scale;
+    double res = tm.getRes() * scale;
+    BoundingBox<double> bbox ( tm.getX0() + x * tileW * res + left * res,
+                               tm.getY0() - ( y+1 ) * tileH * res + bottom * res,
+                               tm.getX0() + ( x+1 ) * tileW * res - right * res,
+                               tm.getY0() - y * tileH * res - top * res );
+
+    FileDataSource* encoded = getEncodedTile ( x, y );
+    uint8_t value[CONSTANT_TILE_VALUE_SIZE];
+    if ( encoded && encoded->getConstantValue ( value ) ) {
+        // Tuile constante : les pixels sont synthétisés, sans lecture ni décodage
+        delete encoded;
+        Image* image = getConstantImage ( value, tileW - left - right, tileH - top - bottom );
+        image->setBbox ( bbox );
+        return image;
+    }
+
+    return new ImageDecoder ( getDecodedTile ( x,y,scale,encoded ), tileW, tileH, channels, bbox,
                               left, top, right, bottom, pixel_size );
 }
 
 Image* Level::getNoDataTile ( BoundingBox<double> bbox ) {
-    int pixel_size=1;
+    int pixel_size = Rok4Format::toSampleSize ( format );
     LOGGER_DEBUG ( _ ( "GetTile Image" ) );
-    if ( format==Rok4Format::TIFF_RAW_FLOAT32 || format == Rok4Format::TIFF_LZW_FLOAT32 || format == Rok4Format::TIFF_ZIP_FLOAT32 || format == Rok4Format::TIFF_PKB_FLOAT32 )
-        pixel_size=4;
     return new ImageDecoder ( getDecodedNoDataTile() , tm.getTileW(), tm.getTileH(), channels,
                               bbox, 0, 0, 0, 0, pixel_size );
 }
@@ -446,11 +670,16 @@ int* Level::getNoDataValue ( int* nodatavalue ) {
     size_t size;
     const uint8_t * buffer = nd->getData ( size );
     if ( buffer ) {
-        if ( format == Rok4Format::TIFF_RAW_FLOAT32 || format == Rok4Format::TIFF_LZW_FLOAT32 || format == Rok4Format::TIFF_ZIP_FLOAT32 || format == Rok4Format::TIFF_PKB_FLOAT32 ) {
+        if ( format >= Rok4Format::eformat_float ) {
             const float* fbuf = ( const float* ) buffer;
             for ( int pixel = 0; pixel < this->channels; pixel++ ) {
                 * ( nodatavalue + pixel )  = ( int ) * ( fbuf + pixel );
             }
+        } else if ( Rok4Format::toSampleSize ( format ) == 2 ) {
+            const uint16_t* sbuf = ( const uint16_t* ) buffer;
+            for ( int pixel = 0; pixel < this->channels; pixel++ ) {
+                * ( nodatavalue + pixel )  = * ( sbuf + pixel );
+            }
         } else {
             for ( int pixel = 0; pixel < this->channels; pixel++ ) {
                 * ( nodatavalue + pixel )  = * ( buffer + pixel );
@@ -43,10 +43,14 @@
 #include "TileMatrix.h"
 #include "Data.h"
 #include "FileDataSource.h"
+#include "SlabStorage.h"
 #include "CRS.h"
 #include "Format.h"
 #include "ServicesConf.h"
 #include "Interpolation.h"
+#include <map>
+#include <vector>
+#include <pthread.h>
 
 /**
  */
@@ -58,6 +62,7 @@ private:
     int           pathDepth;
     TileMatrix    tm;         // FIXME j'ai des problème de compil que je ne comprends pas si je mets un const ?!
     const Rok4Format::eformat_data format; //format d'image des tuiles
+    const Predictor::ePredictor predictor; //prédicteur TIFF appliqué aux tuiles LZW ou deflate
     const int     channels;
     const uint32_t maxTileRow;
     const uint32_t minTileRow;
@@ -70,8 +75,64 @@ private:
     DataSource* noDataTileSource;
     DataSource* noDataSourceProxy;
 
-    DataSource* getEncodedTile ( int x, int y );
-    DataSource* getDecodedTile ( int x, int y );
+    /**
+     * Tuiles constantes déjà encodées, partagées par toutes les requêtes, indexées par la valeur de leur pixel
+     */
+    std::map<std::string, DataSource*> constantTiles;
+    pthread_mutex_t constantTilesMutex;
+
+    /**
+     * Carte des dalles existantes du niveau, dans l'emprise des TMSLimits (NULL si inconnue)
+     */
+    std::vector<bool>* slabMap;
+    uint32_t slabMapMinX;
+    uint32_t slabMapMinY;
+    uint32_t slabMapWidth;
+    uint32_t slabMapHeight;
+
+    /**
+     * Stockage des dalles du niveau (fichiers locaux si NULL)
+     */
+    SlabStorage* storage;
+
+    /**
+     * Renvoie la source de la tuile encodée, NULL si la carte des dalles indique que sa dalle n'existe pas
+     */
+    FileDataSource* getEncodedTile ( int x, int y );
+    /**
+     * Renvoie la tuile décodée, réduite d'un facteur scale (1, 2, 4 ou 8, réduction possible pour le JPEG uniquement)
+     * La source encodée, si elle est fournie, est utilisée pour lire la tuile (et supprimée si elle n'est pas nécessaire)
+     */
+    DataSource* getDecodedTile ( int x, int y, int scale = 1, FileDataSource* encoded = NULL );
+    /**
+     * Crée la source de la tuile décodée, sans passer par la table des tuiles partagées de la requête
+     */
+    DataSource* createDecodedTile ( FileDataSource* encoded, int scale );
+    /**
+     * Renvoie la tuile encodée dont tous les pixels valent value (CONSTANT_TILE_VALUE_SIZE octets)
+     * Les tuiles sont encodées une fois puis conservées, dans la limite de CONSTANT_TILE_CACHE_SIZE valeurs
+     */
+    DataSource* getConstantTile ( const uint8_t* value );
+    /**
+     * Renvoie l'image de largeur width et de hauteur height dont tous les pixels valent value
+     */
+    Image* getConstantImage ( const uint8_t* value, int width, int height );
+    /**
+     * Annule le prédicteur des tuiles sur la tuile décodée, s'il y en a un
+     */
+    DataSource* revertPredictor ( DataSource* decData );
+    /**
+     * Renvoie la taille en octets d'une tuile décodée
+     */
+    size_t getRawTileSize();
+
+    /**
+     * Renvoie le facteur de réduction (1, 2, 4 ou 8) auquel les tuiles peuvent être décodées
+     * pour une image dont un pixel couvre ratio_x * ratio_y pixels du niveau.
+     * Seules les tuiles JPEG peuvent être décodées à résolution réduite, l'image étant ensuite
+     * toujours sous-échantillonnée.
+     */
+    int getDecodingScale ( double ratio_x, double ratio_y );
 
 
 
@@ -81,8 +142,10 @@ protected:
      *
      * le coin haut gauche de cette image est le pixel offsetx, offsety de la tuile tilex, tilex.
      * Toutes les coordonnées sont entière depuis le coin haut gauche.
+     * Si scale est supérieur à 1, les coordonnées sont exprimées dans le niveau réduit d'autant
+     * (tuiles de tileW/scale par tileH/scale pixels).
      */
-    Image* getwindow ( ServicesConf& servicesConf, BoundingBox<int64_t> src_bbox, int& error );
+    Image* getwindow ( ServicesConf& servicesConf, BoundingBox<int64_t> src_bbox, int& error, int scale = 1 );
 
 public:
     TileMatrix getTm() {
@@ -91,6 +154,9 @@ public:
     Rok4Format::eformat_data getFormat() {
         return format;
     }
+    Predictor::ePredictor getPredictor() {
+        return predictor;
+    }
     int     getChannels() {
         return channels;
     }
@@ -119,11 +185,37 @@ public:
         return tilesPerHeight;
     }
 
+    std::string getBaseDir() {
+        return baseDir;
+    }
+
+    SlabStorage* getStorage() {
+        return storage;
+    }
+
     std::string getFilePath ( int tilex, int tiley );
+
+    /**
+     * Définit les dalles existantes du niveau (indices de dalle, colonne et ligne), toute autre dalle est considérée
+     * absente sans accès au système de fichiers.
+     * Renvoie faux, sans définir la carte, si une dalle est hors des TMSLimits ou si la carte est trop grande
+     * (CONTENT_LIST_MAX_SLABS)
+     */
+    bool setExistingSlabs ( const std::vector<std::pair<uint32_t, uint32_t> >& slabs );
+
+    /**
+     * Indique si la dalle contenant la tuile x, y peut exister (toujours vrai sans carte des dalles)
+     */
+    bool isSlabPresent ( int x, int y );
     std::string getNoDataFilePath() {
         return noDataFile;
     }
 
+    /**
+     * Encode une tuile dans le format du niveau, l'image est supprimée
+     */
+    DataSource* encodeTile ( Image* image );
+
     DataSource* getEncodedNoDataTile();
     DataSource* getDecodedNoDataTile();
 
@@ -145,7 +237,7 @@ public:
 
     DataSource* getTile ( int x, int y, DataSource* errorDataSource = NULL );
 
-    Image* getTile ( int x, int y, int left, int top, int right, int bottom );
+    Image* getTile ( int x, int y, int left, int top, int right, int bottom, int scale = 1 );
 
     Image* getNoDataTile ( BoundingBox<double> bbox );
 
@@ -158,7 +250,8 @@ public:
     Level ( TileMatrix tm, int channels, std::string baseDir,
             int tilesPerWidth, int tilesPerHeight,
             uint32_t maxTileRow, uint32_t minTileRow, uint32_t maxTileCol, uint32_t minTileCol,
-            int pathDepth, Rok4Format::eformat_data format, std::string noDataFile );
+            int pathDepth, Rok4Format::eformat_data format, std::string noDataFile,
+            Predictor::ePredictor predictor = Predictor::NONE, SlabStorage* storage = NULL );
 
     /*
      * Destructeur
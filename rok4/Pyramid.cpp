@@ -36,6 +36,7 @@
  */
 
 #include <cmath>
+#include <sys/stat.h>
 #include "Pyramid.h"
 #include "Logger.h"
 #include "Message.h"
@@ -61,23 +62,8 @@ Pyramid::Pyramid ( std::map<std::string, Level*> &levels, TileMatrixSet tms, Rok
     double maxRes= DBL_MIN;
     for ( itLevel=levels.begin(); itLevel!=levels.end(); itLevel++ ) {
         //Empty Source as fallback
-        DataSource* noDataSource;
-        DataStream* nodatastream;
-
-        if ( format==Rok4Format::TIFF_JPG_INT8 ) {
-            nodatastream = new JPEGEncoder ( new ImageDecoder ( 0, itLevel->second->getTm().getTileW(), itLevel->second->getTm().getTileH(), channels ) );
-        } else if ( format==Rok4Format::TIFF_PNG_INT8 ) {
-            nodatastream = new PNGEncoder ( new ImageDecoder ( 0, itLevel->second->getTm().getTileW(), itLevel->second->getTm().getTileH(), channels ) );
-        } else if ( format==Rok4Format::TIFF_RAW_FLOAT32 ) {
-            nodatastream = new BilEncoder ( new ImageDecoder ( 0, itLevel->second->getTm().getTileW(), itLevel->second->getTm().getTileH(), channels ) );
-        } else {
-            nodatastream = TiffEncoder::getTiffEncoder ( new ImageDecoder ( 0, itLevel->second->getTm().getTileW(), itLevel->second->getTm().getTileH(), channels ), format );
-        }
-        if ( nodatastream ) {
-            noDataSource = new BufferedDataSource ( *nodatastream );
-            delete nodatastream;
-            nodatastream = NULL;
-        } else {
+        DataSource* noDataSource = itLevel->second->encodeTile ( new ImageDecoder ( 0, itLevel->second->getTm().getTileW(), itLevel->second->getTm().getTileH(), channels ) );
+        if ( ! noDataSource ) {
             LOGGER_ERROR ( "Format non pris en charge : "<< Rok4Format::toString ( format ) );
         }
         itLevel->second->setNoDataSource ( noDataSource );
@@ -144,6 +130,17 @@ std::string Pyramid::best_level ( double resolution_x, double resolution_y ) {
 }
 
 
+time_t Pyramid::getGeneration() {
+    time_t generation = 0;
+    struct stat st;
+    for ( int i = 0; i < generationFiles.size(); i++ ) {
+        if ( stat ( generationFiles.at ( i ).c_str(), &st ) == 0 && st.st_mtime > generation ) {
+            generation = st.st_mtime;
+        }
+    }
+    return generation;
+}
+
 Level * Pyramid::getFirstLevel() {
     std::map<std::string, Level*>::iterator it ( levels.begin() );
     return it->second;
@@ -154,11 +151,63 @@ TileMatrixSet Pyramid::getTms() {
 }
 
 
-Image* Pyramid::getbbox ( ServicesConf& servicesConf, BoundingBox<double> bbox, int width, int height, CRS dst_crs, Interpolation::KernelType interpolation, int& error ) {
+void Pyramid::detectAffineCRS ( std::vector<CRS> crsList, BoundingBox<double> geographicBBox ) {
+    CRS pyrCrs = tms.getCrs();
+
+    // Tolérance : un millième de pixel du niveau le plus précis
+    double tolerance = DBL_MAX;
+    for ( std::map<std::string, Level*>::iterator it = levels.begin(); it != levels.end(); it++ ) {
+        tolerance = std::min ( tolerance, it->second->getRes() / 1000. );
+    }
+
+    for ( unsigned int i = 0; i < crsList.size(); i++ ) {
+        CRS crs = crsList.at ( i );
+        if ( crs == pyrCrs || affineCRS.count ( crs.getProj4Code() ) ) continue;
+
+        AffineCRSTransform t;
+        BoundingBox<double> extent = crs.boundingBoxFromGeographic ( geographicBBox );
+        if ( crs.getAffineTransform ( pyrCrs, extent, tolerance, t.Ax, t.Bx, t.Ay, t.By ) ) {
+            LOGGER_INFO ( _ ( "         Transformation affine de " ) << crs.getRequestCode() << _ ( " vers " ) << pyrCrs.getRequestCode()
+                          << " : X' = " << t.Ax << ".X + " << t.Bx << ", Y' = " << t.Ay << ".Y + " << t.By );
+            affineCRS.insert ( std::pair<std::string, AffineCRSTransform> ( crs.getProj4Code(), t ) );
+        }
+    }
+}
+
+Image* Pyramid::getbbox ( ServicesConf& servicesConf, BoundingBox<double> bbox, int width, int height, CRS dst_crs, Interpolation::KernelType interpolation, int& error, std::string* level ) {
     // On calcule la résolution de la requete dans le crs source selon une diagonale de l'image
     double resolution_x, resolution_y;
     LOGGER_DEBUG ( "source tms.getCRS() is " << tms.getCrs().getProj4Code() << " and destination dst_crs is " << dst_crs.getProj4Code() );
-    if ( (tms.getCrs() == dst_crs) || (are_the_two_CRS_equal( tms.getCrs().getProj4Code(), dst_crs.getProj4Code(), servicesConf.getListOfEqualsCRS() ) ) ) {
+
+    /* Le CRS de la requête ne diffère de celui de la pyramide que par une transformation affine :
+     * on rééchantillonne la bbox transformée au lieu de reprojeter */
+    std::map<std::string, AffineCRSTransform>::iterator affine = affineCRS.find ( dst_crs.getProj4Code() );
+    if ( affine != affineCRS.end() && dst_crs.validateBBox ( bbox ) ) {
+        AffineCRSTransform& t = affine->second;
+        BoundingBox<double> pyrBBox ( t.Ax * bbox.xmin + t.Bx, t.Ay * bbox.ymin + t.By,
+                                      t.Ax * bbox.xmax + t.Bx, t.Ay * bbox.ymax + t.By );
+        std::string l;
+        if ( level && ! level->empty() ) {
+            l = *level;
+        } else {
+            l = best_level ( ( pyrBBox.xmax - pyrBBox.xmin ) / width, ( pyrBBox.ymax - pyrBBox.ymin ) / height );
+            if ( level ) *level = l;
+        }
+        LOGGER_DEBUG ( _ ( "Transformation affine, best_level=" ) << l );
+
+        Image* image = levels[l]->getbbox ( servicesConf, pyrBBox, width, height, interpolation, error );
+        if ( image ) {
+            image->setBbox ( bbox );
+            image->setCRS ( dst_crs );
+        }
+        return image;
+    }
+    std::string l;
+    if ( level && ! level->empty() ) {
+        // Niveau imposé : inutile d'estimer la résolution
+        l = *level;
+        resolution_x = resolution_y = levels[l]->getRes();
+    } else if ( (tms.getCrs() == dst_crs) || (are_the_two_CRS_equal( tms.getCrs().getProj4Code(), dst_crs.getProj4Code(), servicesConf.getListOfEqualsCRS() ) ) ) {
         resolution_x = ( bbox.xmax - bbox.xmin ) / width;
         resolution_y = ( bbox.ymax - bbox.ymin ) / height;
     } else {
@@ -177,7 +226,10 @@ Image* Pyramid::getbbox ( ServicesConf& servicesConf, BoundingBox<double> bbox,
         resolution_y = ( grid->bbox.ymax - grid->bbox.ymin ) / height;
         delete grid;
     }
-    std::string l = best_level ( resolution_x, resolution_y );
+    if ( l.empty() ) {
+        l = best_level ( resolution_x, resolution_y );
+        if ( level ) *level = l;
+    }
     LOGGER_DEBUG ( _ ( "best_level=" ) << l << _ ( " resolution requete=" ) << resolution_x << " " << resolution_y );
     if ( (tms.getCrs() == dst_crs) || (are_the_two_CRS_equal( tms.getCrs().getProj4Code(), dst_crs.getProj4Code(), servicesConf.getListOfEqualsCRS() ) ) ) {
         return levels[l]->getbbox ( servicesConf, bbox, width, height, interpolation, error );
@@ -39,6 +39,8 @@
 #define PYRAMID_H
 #include <string>
 #include <map>
+#include <vector>
+#include <ctime>
 #include "Level.h"
 #include "TileMatrixSet.h"
 #include "CRS.h"
@@ -48,6 +50,14 @@
 
 //std::string getMimeType(std::string format);
 
+/**
+* @struct AffineCRSTransform
+* @brief Transformation affine X' = Ax.X + Bx, Y' = Ay.Y + By d'un CRS de requete vers le CRS de la pyramide
+*/
+struct AffineCRSTransform {
+    double Ax, Bx, Ay, By;
+};
+
 /**
 * @class Pyramid
 * @brief Implementation des pyramides
@@ -66,8 +76,37 @@ private:
     Level* highestLevel;
     Level* lowestLevel;
     bool are_the_two_CRS_equal( std::string crs1, std::string crs2, std::vector<std::string> listofequalsCRS );
+    // CRS de requete dont la transformation vers le CRS de la pyramide est affine, par code proj4
+    std::map<std::string, AffineCRSTransform> affineCRS;
+    // Fichiers réécrits à chaque mise à jour de la pyramide (descripteur, liste du contenu)
+    std::vector<std::string> generationFiles;
 public:
 
+    /**
+     * \~french \brief Détecte les CRS dont la transformation vers celui de la pyramide est affine sur l'emprise
+     * \details Les requêtes dans ces CRS sont alors simplement rééchantillonnées, sans reprojection.
+     * \param[in] crsList CRS de requête à tester
+     * \param[in] geographicBBox emprise des données, en WGS84
+     * \~english \brief Detect CRS whose transformation to the pyramid's one is affine over the extent
+     * \details Requests in these CRS are then only resampled, without reprojection.
+     */
+    void detectAffineCRS ( std::vector<CRS> crsList, BoundingBox<double> geographicBBox );
+
+    /**
+     * \~french \brief Ajoute un fichier réécrit à chaque mise à jour de la pyramide
+     * \~english \brief Add a file rewritten each time the pyramid is updated
+     */
+    void addGenerationFile ( std::string file ) {
+        generationFiles.push_back ( file );
+    }
+    /**
+     * \~french \brief Génération de la pyramide : date de modification la plus récente de ses fichiers de description
+     * \details Elle change lorsque la pyramide est mise à jour, ce qui invalide les réponses calculées à partir de ses dalles.
+     * \~english \brief Pyramid generation : latest modification time of its description files
+     * \details It changes when the pyramid is updated, which invalidates the responses computed from its slabs.
+     */
+    time_t getGeneration();
+
     Level* getFirstLevel();
     Level* getHighestLevel() {
         return highestLevel;
@@ -88,7 +127,11 @@ public:
     }
 
     DataSource* getTile ( int x, int y, std::string tmId, DataSource* errorDataSource = NULL );
-    Image* getbbox (ServicesConf& servicesConf, BoundingBox<double> bbox, int width, int height, CRS dst_crs, Interpolation::KernelType interpolation, int& error );
+    /**
+     * \~french \param[in,out] level niveau imposé, ou choisi et renseigné s'il est vide : les bandes d'une même requête utilisent ainsi le même niveau
+     * \~english \param[in,out] level forced level, or chosen and filled in if empty : bands of one request thus use the same level
+     */
+    Image* getbbox (ServicesConf& servicesConf, BoundingBox<double> bbox, int width, int height, CRS dst_crs, Interpolation::KernelType interpolation, int& error, std::string* level = NULL );
 
     Pyramid ( std::map<std::string, Level*> &levels, TileMatrixSet tms, Rok4Format::eformat_data format, int channels );
     ~Pyramid();
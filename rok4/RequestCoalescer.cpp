@@ -0,0 +1,310 @@
+/*
+ * Copyright © (2011-2013) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file RequestCoalescer.cpp
+ * \~french
+ * \brief Implémentation de la classe RequestCoalescer, regroupant les requêtes identiques simultanées
+ * \~english
+ * \brief Implement the RequestCoalescer class, merging identical concurrent requests
+ */
+
+#include "RequestCoalescer.h"
+#include <sys/time.h>
+#include <errno.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include "Logger.h"
+#include "CancellationToken.h"
+#include "intl.h"
+
+/**
+ * \~french
+ * \brief Source de données lisant une réponse partagée
+ * \details La réponse partagée a déjà été lue une première fois par le meneur : les appels à getData ne modifient plus la source d'origine.
+ * \~english
+ * \brief Data source reading a shared response
+ * \details The shared response has already been read once by the leader : getData calls do not modify the original source anymore.
+ */
+class CoalescedDataSource : public DataSource {
+private:
+    RequestCoalescer& coalescer;
+    CoalescedResponse* entry;
+public:
+    CoalescedDataSource ( RequestCoalescer& coalescer, CoalescedResponse* entry ) : coalescer ( coalescer ), entry ( entry ) {}
+    ~CoalescedDataSource() {
+        coalescer.release ( entry );
+    }
+    const uint8_t* getData ( size_t& size ) {
+        return entry->response->getData ( size );
+    }
+    bool releaseData() {
+        return false;
+    }
+    std::string getType() {
+        return entry->response->getType();
+    }
+    int getHttpStatus() {
+        return entry->response->getHttpStatus();
+    }
+    std::string getEncoding() {
+        return entry->response->getEncoding();
+    }
+};
+
+/**
+ * \~french
+ * \brief Ajoute un paramètre de la requête à la signature
+ * \details Les valeurs entières sont normalisées, les paramètres absents sont distingués des paramètres vides.
+ * \~english
+ * \brief Add a request parameter to the signature
+ * \details Integer values are normalized, missing parameters are distinguished from empty ones.
+ */
+static void appendParam ( std::string& key, Request* request, const char* name, bool integer = false ) {
+    std::map<std::string, std::string>::iterator it = request->params.find ( name );
+    key.append ( name );
+    if ( it == request->params.end() ) {
+        key.append ( "!;" );
+        return;
+    }
+    key.append ( "=" );
+    if ( integer ) {
+        char* end;
+        long value = strtol ( it->second.c_str(), &end, 10 );
+        if ( *end == '\0' && !it->second.empty() ) {
+            char buf[32];
+            snprintf ( buf, sizeof ( buf ), "%ld", value );
+            key.append ( buf );
+            key.append ( ";" );
+            return;
+        }
+    }
+    key.append ( it->second );
+    key.append ( ";" );
+}
+
+/**
+ * \~french
+ * \brief Ajoute la bbox de la requête à la signature, sous une forme numérique normalisée
+ * \details Avec pixelPrecision, les coordonnées sont arrondies à la plus grande puissance de 10 inférieure à la taille du pixel de sortie : deux bbox ne différant que d'une fraction de pixel ont la même signature.
+ * \~english
+ * \brief Add the request bbox to the signature, in a normalized numerical form
+ * \details With pixelPrecision, coordinates are rounded to the greatest power of 10 below the output pixel size : two bboxes differing only by a fraction of pixel share the same signature.
+ */
+static void appendBbox ( std::string& key, Request* request, bool pixelPrecision ) {
+    std::map<std::string, std::string>::iterator it = request->params.find ( "bbox" );
+    double xmin, ymin, xmax, ymax;
+    if ( it != request->params.end() && sscanf ( it->second.c_str(), "%lf,%lf,%lf,%lf", &xmin, &ymin, &xmax, &ymax ) == 4 ) {
+        char buf[128];
+        std::map<std::string, std::string>::iterator itw = request->params.find ( "width" );
+        std::map<std::string, std::string>::iterator ith = request->params.find ( "height" );
+        int width = ( itw == request->params.end() ) ? 0 : atoi ( itw->second.c_str() );
+        int height = ( ith == request->params.end() ) ? 0 : atoi ( ith->second.c_str() );
+        // Plus petite des tailles de pixel selon chaque axe, pour les deux ordres d'axes de la bbox
+        double pixel = ( width > 0 && height > 0 ) ? std::min ( fabs ( xmax - xmin ) / width, fabs ( ymax - ymin ) / height ) : 0;
+        if ( pixelPrecision && pixel > 0 ) {
+            double quantum = pow ( 10.0, floor ( log10 ( pixel ) ) );
+            snprintf ( buf, sizeof ( buf ), "bbox=%g:%lld,%lld,%lld,%lld;", quantum,
+                       llround ( xmin / quantum ), llround ( ymin / quantum ), llround ( xmax / quantum ), llround ( ymax / quantum ) );
+        } else {
+            snprintf ( buf, sizeof ( buf ), "bbox=%.12g,%.12g,%.12g,%.12g;", xmin, ymin, xmax, ymax );
+        }
+        key.append ( buf );
+    } else {
+        appendParam ( key, request, "bbox" );
+    }
+}
+
+RequestCoalescer::RequestCoalescer ( bool enabled, int timeout ) : enabled ( enabled ), timeout ( timeout ),
+    leaders ( 0 ), followers ( 0 ), fallbacks ( 0 ) {
+    pthread_mutex_init ( &mutex, NULL );
+    pthread_cond_init ( &published, NULL );
+}
+
+RequestCoalescer::~RequestCoalescer() {
+    if ( enabled ) {
+        LOGGER_INFO ( _ ( "Regroupement des requetes : " ) << leaders << _ ( " calculees, " ) << followers << _ ( " regroupees, " ) << fallbacks << _ ( " attentes abandonnees" ) );
+    }
+    pthread_cond_destroy ( &published );
+    pthread_mutex_destroy ( &mutex );
+}
+
+bool RequestCoalescer::buildKey ( Request* request, std::string& key, bool pixelPrecision ) {
+    key.clear();
+    if ( request->service == "wmts" && request->request == "gettile" ) {
+        key.append ( "wmts:gettile;" );
+        appendParam ( key, request, "version" );
+        appendParam ( key, request, "layer" );
+        appendParam ( key, request, "style" );
+        appendParam ( key, request, "tilematrixset" );
+        appendParam ( key, request, "tilematrix" );
+        appendParam ( key, request, "tilerow", true );
+        appendParam ( key, request, "tilecol", true );
+        appendParam ( key, request, "format" );
+        appendParam ( key, request, "nodataashttpstatus" );
+        return true;
+    }
+    if ( request->request == "getmap" || request->request == "map" ) {
+        key.append ( "wms:getmap;" );
+        appendParam ( key, request, "version" );
+        appendParam ( key, request, "wmtver" );
+        appendParam ( key, request, "layers" );
+        appendParam ( key, request, "styles" );
+        appendParam ( key, request, "crs" );
+        appendParam ( key, request, "srs" );
+        appendBbox ( key, request, pixelPrecision );
+        appendParam ( key, request, "width", true );
+        appendParam ( key, request, "height", true );
+        appendParam ( key, request, "format" );
+        appendParam ( key, request, "exception" );
+        appendParam ( key, request, "format_options" );
+        return true;
+    }
+    return false;
+}
+
+CoalescedResponse* RequestCoalescer::join ( const std::string& key, bool& leader ) {
+    pthread_mutex_lock ( &mutex );
+    CoalescedResponse* entry;
+    std::map<std::string, CoalescedResponse*>::iterator it = inflight.find ( key );
+    if ( it == inflight.end() ) {
+        entry = new CoalescedResponse;
+        entry->key = key;
+        entry->response = NULL;
+        entry->ready = false;
+        entry->failed = false;
+        entry->users = 1;
+        inflight.insert ( std::pair<std::string, CoalescedResponse*> ( key, entry ) );
+        leader = true;
+        leaders++;
+    } else {
+        entry = it->second;
+        entry->users++;
+        leader = false;
+    }
+    pthread_mutex_unlock ( &mutex );
+    return entry;
+}
+
+bool RequestCoalescer::publish ( CoalescedResponse* entry, DataSource* response ) {
+    // Première lecture par le meneur : les lectures suivantes ne modifient plus la source
+    size_t size;
+    response->getData ( size );
+    // Une réponse dont le calcul a été interrompu est incomplète
+    bool failed = CancellationToken::currentCancelled();
+
+    pthread_mutex_lock ( &mutex );
+    if ( ! failed ) {
+        entry->response = response;
+    }
+    entry->ready = true;
+    entry->failed = failed;
+    // Les requêtes suivantes ne sont plus regroupées avec celle-ci
+    inflight.erase ( entry->key );
+    pthread_cond_broadcast ( &published );
+    pthread_mutex_unlock ( &mutex );
+    return ! failed;
+}
+
+bool RequestCoalescer::wait ( CoalescedResponse* entry ) {
+    struct timeval now;
+    struct timespec deadline;
+    gettimeofday ( &now, NULL );
+    long nsec = now.tv_usec * 1000L + ( timeout % 1000 ) * 1000000L;
+    deadline.tv_sec = now.tv_sec + timeout / 1000 + nsec / 1000000000L;
+    deadline.tv_nsec = nsec % 1000000000L;
+
+    pthread_mutex_lock ( &mutex );
+    int rc = 0;
+    while ( !entry->ready && rc != ETIMEDOUT ) {
+        rc = pthread_cond_timedwait ( &published, &mutex, &deadline );
+    }
+    if ( entry->ready && ! entry->failed ) {
+        followers++;
+        pthread_mutex_unlock ( &mutex );
+        return true;
+    }
+    fallbacks++;
+    bool failed = entry->failed;
+    pthread_mutex_unlock ( &mutex );
+    if ( failed ) {
+        LOGGER_DEBUG ( _ ( "Calcul de la requete identique interrompu : " ) << entry->key );
+    } else {
+        LOGGER_DEBUG ( _ ( "Delai d'attente de la requete identique depasse : " ) << entry->key );
+    }
+    release ( entry );
+    return false;
+}
+
+void RequestCoalescer::release ( CoalescedResponse* entry ) {
+    pthread_mutex_lock ( &mutex );
+    entry->users--;
+    bool last = ( entry->users == 0 );
+    pthread_mutex_unlock ( &mutex );
+    if ( last ) {
+        // Le dernier utilisateur suit la publication : la réponse est partagée, ou NULL si le meneur a échoué
+        delete entry->response;
+        delete entry;
+    }
+}
+
+DataSource* RequestCoalescer::share ( CoalescedResponse* entry ) {
+    return new CoalescedDataSource ( *this, entry );
+}
+
+unsigned long RequestCoalescer::getLeaders() {
+    pthread_mutex_lock ( &mutex );
+    unsigned long n = leaders;
+    pthread_mutex_unlock ( &mutex );
+    return n;
+}
+
+unsigned long RequestCoalescer::getFollowers() {
+    pthread_mutex_lock ( &mutex );
+    unsigned long n = followers;
+    pthread_mutex_unlock ( &mutex );
+    return n;
+}
+
+unsigned long RequestCoalescer::getFallbacks() {
+    pthread_mutex_lock ( &mutex );
+    unsigned long n = fallbacks;
+    pthread_mutex_unlock ( &mutex );
+    return n;
+}
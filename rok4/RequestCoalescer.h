@@ -0,0 +1,275 @@
+/*
+ * Copyright © (2011-2013) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file RequestCoalescer.h
+ * \~french
+ * \brief Définition de la classe RequestCoalescer, regroupant les requêtes identiques simultanées
+ * \~english
+ * \brief Define the RequestCoalescer class, merging identical concurrent requests
+ */
+
+#ifndef REQUEST_COALESCER_H
+#define REQUEST_COALESCER_H
+
+#include <pthread.h>
+#include <map>
+#include <string>
+#include "Data.h"
+#include "Request.h"
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Réponse partagée entre des requêtes identiques
+ * \details La réponse est calculée une seule fois par le premier thread (le meneur), puis lue par les autres (les suiveurs). Une fois publiée, elle n'est plus modifiée et peut être lue simultanément par plusieurs threads.
+ * \~english
+ * \brief Response shared between identical requests
+ * \details The response is computed once by the first thread (the leader), and then read by the others (the followers). Once published, it is never modified and can be read concurrently.
+ */
+struct CoalescedResponse {
+    /**
+     * \~french \brief Signature normalisée de la requête
+     * \~english \brief Normalized request signature
+     */
+    std::string key;
+    /**
+     * \~french \brief Réponse encodée, NULL tant qu'elle n'est pas publiée
+     * \~english \brief Encoded response, NULL until published
+     */
+    DataSource* response;
+    /**
+     * \~french \brief La réponse est-elle disponible ?
+     * \~english \brief Is the response available ?
+     */
+    bool ready;
+    /**
+     * \~french \brief Le calcul du meneur a-t-il été interrompu ? La réponse n'est alors pas partagée
+     * \~english \brief Has the leader's computation been interrupted ? The response is then not shared
+     */
+    bool failed;
+    /**
+     * \~french \brief Nombre de requêtes utilisant cette réponse
+     * \~english \brief Number of requests using this response
+     */
+    int users;
+};
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Regroupement des requêtes GetMap et GetTile identiques et simultanées
+ * \details Lorsque plusieurs clients demandent exactement la même image en même temps, seule la première requête est calculée. Les suivantes attendent (dans la limite d'un délai) et renvoient la même réponse encodée. Si le délai est dépassé, la requête est calculée de manière indépendante.
+ *
+ * Les requêtes sont identifiées par une signature normalisée, construite à partir des seuls paramètres influant sur la réponse.
+ * \~english
+ * \brief Merge identical and concurrent GetMap and GetTile requests
+ * \details When several clients ask for exactly the same image at the same time, only the first request is processed. The next ones wait (with a bounded delay) and send the same encoded response. When the delay is exceeded, the request is processed independently.
+ *
+ * Requests are identified by a normalized signature, built from the parameters which have an effect on the response only.
+ */
+class RequestCoalescer {
+private:
+    /**
+     * \~french \brief Le regroupement est-il actif ?
+     * \~english \brief Is coalescing enabled ?
+     */
+    bool enabled;
+    /**
+     * \~french \brief Délai d'attente maximal d'un suiveur, en millisecondes
+     * \~english \brief Maximal follower wait, in milliseconds
+     */
+    int timeout;
+    /**
+     * \~french \brief Réponses en cours de calcul, indexées par signature
+     * \~english \brief Responses being computed, indexed by signature
+     */
+    std::map<std::string, CoalescedResponse*> inflight;
+    /**
+     * \~french \brief Protection des réponses en cours et des compteurs
+     * \~english \brief Lock on responses being computed and counters
+     */
+    pthread_mutex_t mutex;
+    /**
+     * \~french \brief Signalement des réponses publiées
+     * \~english \brief Published responses signal
+     */
+    pthread_cond_t published;
+
+    /**
+     * \~french \brief Nombre de requêtes calculées en tant que meneur
+     * \~english \brief Number of requests processed as leader
+     */
+    unsigned long leaders;
+    /**
+     * \~french \brief Nombre de requêtes ayant réutilisé la réponse d'un meneur
+     * \~english \brief Number of requests which reused a leader's response
+     */
+    unsigned long followers;
+    /**
+     * \~french \brief Nombre de suiveurs ayant abandonné l'attente
+     * \~english \brief Number of followers which gave up waiting
+     */
+    unsigned long fallbacks;
+
+public:
+    /**
+     * \~french
+     * \brief Crée un RequestCoalescer
+     * \param[in] enabled active le regroupement
+     * \param[in] timeout délai d'attente maximal d'un suiveur, en millisecondes
+     * \~english
+     * \brief Create a RequestCoalescer
+     * \param[in] enabled enable coalescing
+     * \param[in] timeout maximal follower wait, in milliseconds
+     */
+    RequestCoalescer ( bool enabled, int timeout );
+
+    /**
+     * \~french
+     * \brief Destructeur, affiche les statistiques de regroupement
+     * \~english
+     * \brief Destructor, log coalescing statistics
+     */
+    ~RequestCoalescer();
+
+    /**
+     * \~french \brief Le regroupement est-il actif ?
+     * \~english \brief Is coalescing enabled ?
+     */
+    bool isEnabled() {
+        return enabled;
+    }
+
+    /**
+     * \~french
+     * \brief Calcule la signature normalisée d'une requête GetMap ou GetTile
+     * \param[in] request requête à identifier
+     * \param[out] key signature
+     * \param[in] pixelPrecision la bbox est arrondie à la précision du pixel de sortie
+     * \return faux si la requête ne peut pas être regroupée
+     * \~english
+     * \brief Compute the normalized signature of a GetMap or GetTile request
+     * \param[in] request request to identify
+     * \param[out] key signature
+     * \param[in] pixelPrecision the bbox is rounded to the output pixel precision
+     * \return false if the request cannot be coalesced
+     */
+    static bool buildKey ( Request* request, std::string& key, bool pixelPrecision = false );
+
+    /**
+     * \~french
+     * \brief Rejoint le calcul d'une réponse
+     * \details Si aucune requête identique n'est en cours, l'appelant devient meneur et doit publier la réponse avec #publish.
+     * \param[in] key signature de la requête
+     * \param[out] leader vrai si l'appelant doit calculer la réponse
+     * \return la réponse partagée
+     * \~english
+     * \brief Join a response computation
+     * \details If no identical request is in progress, the caller becomes leader and has to publish the response with #publish.
+     * \param[in] key request signature
+     * \param[out] leader true if the caller has to compute the response
+     * \return the shared response
+     */
+    CoalescedResponse* join ( const std::string& key, bool& leader );
+
+    /**
+     * \~french
+     * \brief Publie la réponse calculée par le meneur et réveille les suiveurs
+     * \details Si le calcul du meneur a été annulé (CancellationToken du thread), la réponse est incomplète : elle n'est pas partagée, et les suiveurs calculent la leur.
+     * \param[in] entry réponse partagée
+     * \param[in] response réponse calculée, dont la propriété est transférée si elle est partagée
+     * \return faux si la réponse n'est pas partagée : le meneur en reste propriétaire et doit libérer sa référence avec #release
+     * \~english
+     * \brief Publish the response computed by the leader and wake up followers
+     * \details If the leader's computation has been cancelled (thread's CancellationToken), the response is incomplete : it is not shared, and followers compute their own.
+     * \param[in] entry shared response
+     * \param[in] response computed response, ownership is transferred if it is shared
+     * \return false if the response is not shared : the leader keeps its ownership and has to release its reference with #release
+     */
+    bool publish ( CoalescedResponse* entry, DataSource* response );
+
+    /**
+     * \~french
+     * \brief Attend la publication de la réponse
+     * \details En cas de dépassement du délai ou d'échec du meneur, l'appelant ne référence plus la réponse partagée.
+     * \param[in] entry réponse partagée
+     * \return faux si le délai est dépassé ou si le calcul du meneur a été interrompu
+     * \~english
+     * \brief Wait for the response publication
+     * \details When the delay is exceeded or the leader failed, the caller does not reference the shared response anymore.
+     * \param[in] entry shared response
+     * \return false if the delay is exceeded or if the leader's computation has been interrupted
+     */
+    bool wait ( CoalescedResponse* entry );
+
+    /**
+     * \~french
+     * \brief Libère une référence sur la réponse partagée
+     * \~english
+     * \brief Release a reference on the shared response
+     */
+    void release ( CoalescedResponse* entry );
+
+    /**
+     * \~french
+     * \brief Construit une source de données lisant la réponse partagée
+     * \details La référence est libérée à la destruction de la source de données.
+     * \~english
+     * \brief Build a data source reading the shared response
+     * \details The reference is released when the data source is destroyed.
+     */
+    DataSource* share ( CoalescedResponse* entry );
+
+    /**
+     * \~french \brief Retourne le nombre de requêtes calculées en tant que meneur
+     * \~english \brief Return the number of requests processed as leader
+     */
+    unsigned long getLeaders();
+    /**
+     * \~french \brief Retourne le nombre de requêtes ayant réutilisé une réponse
+     * \~english \brief Return the number of requests which reused a response
+     */
+    unsigned long getFollowers();
+    /**
+     * \~french \brief Retourne le nombre de suiveurs ayant abandonné l'attente
+     * \~english \brief Return the number of followers which gave up waiting
+     */
+    unsigned long getFallbacks();
+};
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * Copyright © (2011-2013) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file RequestQueue.cpp
+ * \~french
+ * \brief Implémentation de la classe RequestQueue, file d'attente bornée des requêtes acceptées
+ * \~english
+ * \brief Implement the RequestQueue class, bounded queue of accepted requests
+ */
+
+#include "RequestQueue.h"
+#include "Logger.h"
+#include "intl.h"
+
+/**
+ * \~french \brief Poids d'une nouvelle mesure dans la durée moyenne de traitement
+ * \~english \brief Weight of a new measure in the mean processing time
+ */
+#define SERVICE_TIME_WEIGHT 0.1
+
+RequestQueue::RequestQueue ( std::string name, size_t capacity, int threads, int timeout ) : name ( name ), capacity ( capacity ),
+    threads ( threads ), timeout ( timeout ), serviceTime ( 0 ), closed ( false ), accepted ( 0 ), rejected ( 0 ), expired ( 0 ) {
+    pthread_mutex_init ( &mutex, NULL );
+    pthread_cond_init ( &notEmpty, NULL );
+}
+
+RequestQueue::~RequestQueue() {
+    LOGGER_INFO ( _ ( "File des requetes " ) << name << " : " << accepted << _ ( " acceptees, " ) << rejected << _ ( " refusees, " ) << expired << _ ( " expirees" ) );
+    pthread_cond_destroy ( &notEmpty );
+    pthread_mutex_destroy ( &mutex );
+}
+
+bool RequestQueue::push ( QueuedRequest& item ) {
+    gettimeofday ( &item.queued, NULL );
+    pthread_mutex_lock ( &mutex );
+    // Attente estimée : les requêtes déjà en file, puis celle-ci, réparties sur les threads
+    double estimated = serviceTime * ( queue.size() / threads + 1 );
+    if ( closed || queue.size() >= capacity || ( timeout > 0 && estimated > timeout ) ) {
+        rejected++;
+        pthread_mutex_unlock ( &mutex );
+        LOGGER_DEBUG ( _ ( "Requete refusee par la file " ) << name << _ ( ", attente estimee : " ) << estimated << " ms" );
+        return false;
+    }
+    queue.push_back ( item );
+    accepted++;
+    pthread_cond_signal ( &notEmpty );
+    pthread_mutex_unlock ( &mutex );
+    return true;
+}
+
+bool RequestQueue::pop ( QueuedRequest& item, bool& late ) {
+    pthread_mutex_lock ( &mutex );
+    while ( queue.empty() && !closed ) {
+        pthread_cond_wait ( &notEmpty, &mutex );
+    }
+    if ( queue.empty() ) {
+        pthread_mutex_unlock ( &mutex );
+        return false;
+    }
+    item = queue.front();
+    queue.pop_front();
+
+    struct timeval now;
+    gettimeofday ( &now, NULL );
+    double waited = ( now.tv_sec - item.queued.tv_sec ) * 1000.0 + ( now.tv_usec - item.queued.tv_usec ) / 1000.0;
+    late = ( timeout > 0 && waited > timeout );
+    if ( late ) {
+        expired++;
+    }
+    pthread_mutex_unlock ( &mutex );
+    return true;
+}
+
+void RequestQueue::served ( double ms ) {
+    pthread_mutex_lock ( &mutex );
+    if ( serviceTime == 0 ) {
+        serviceTime = ms;
+    } else {
+        serviceTime += SERVICE_TIME_WEIGHT * ( ms - serviceTime );
+    }
+    pthread_mutex_unlock ( &mutex );
+}
+
+void RequestQueue::close() {
+    pthread_mutex_lock ( &mutex );
+    closed = true;
+    pthread_cond_broadcast ( &notEmpty );
+    pthread_mutex_unlock ( &mutex );
+}
+
+size_t RequestQueue::size() {
+    pthread_mutex_lock ( &mutex );
+    size_t n = queue.size();
+    pthread_mutex_unlock ( &mutex );
+    return n;
+}
+
+unsigned long RequestQueue::getAccepted() {
+    pthread_mutex_lock ( &mutex );
+    unsigned long n = accepted;
+    pthread_mutex_unlock ( &mutex );
+    return n;
+}
+
+unsigned long RequestQueue::getRejected() {
+    pthread_mutex_lock ( &mutex );
+    unsigned long n = rejected;
+    pthread_mutex_unlock ( &mutex );
+    return n;
+}
+
+unsigned long RequestQueue::getExpired() {
+    pthread_mutex_lock ( &mutex );
+    unsigned long n = expired;
+    pthread_mutex_unlock ( &mutex );
+    return n;
+}
+
+RequestCost RequestQueue::getCost ( Request* request ) {
+    if ( request->service == "wmts" && request->request == "gettile" ) {
+        return COST_TILE;
+    }
+    if ( request->request == "getmap" || request->request == "map" ) {
+        return COST_MAP;
+    }
+    return COST_OTHER;
+}
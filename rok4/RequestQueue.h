@@ -0,0 +1,299 @@
+/*
+ * Copyright © (2011-2013) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file RequestQueue.h
+ * \~french
+ * \brief Définition de la classe RequestQueue, file d'attente bornée des requêtes acceptées
+ * \~english
+ * \brief Define the RequestQueue class, bounded queue of accepted requests
+ */
+
+#ifndef REQUEST_QUEUE_H
+#define REQUEST_QUEUE_H
+
+#include <pthread.h>
+#include <sys/time.h>
+#include <deque>
+#include <string>
+#include "Request.h"
+#include "fcgiapp.h"
+
+/**
+ * \~french
+ * \brief Classes de coût des requêtes, chacune ayant sa file et ses threads
+ * \~english
+ * \brief Request cost classes, each with its own queue and threads
+ */
+enum RequestCost {
+    /**
+     * \~french \brief Requêtes GetTile
+     * \~english \brief GetTile requests
+     */
+    COST_TILE = 0,
+    /**
+     * \~french \brief Requêtes GetMap
+     * \~english \brief GetMap requests
+     */
+    COST_MAP = 1,
+    /**
+     * \~french \brief Capacités et autres requêtes
+     * \~english \brief Capabilities and other requests
+     */
+    COST_OTHER = 2
+};
+
+/**
+ * \~french \brief Nombre de classes de coût
+ * \~english \brief Number of cost classes
+ */
+#define REQUEST_COST_CLASSES 3
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Requête acceptée, en attente de traitement
+ * \~english
+ * \brief Accepted request, waiting to be processed
+ */
+struct QueuedRequest {
+    /**
+     * \~french \brief Requête FCGI, à terminer et libérer après l'envoi de la réponse
+     * \~english \brief FCGI request, to finish and free once the response is sent
+     */
+    FCGX_Request* fcgxRequest;
+    /**
+     * \~french \brief Requête analysée
+     * \~english \brief Parsed request
+     */
+    Request* request;
+    /**
+     * \~french \brief Date de mise en file
+     * \~english \brief Enqueue date
+     */
+    struct timeval queued;
+};
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief File d'attente bornée des requêtes d'une classe de coût
+ * \details Les requêtes sont refusées à l'entrée si la file est pleine, ou si le temps d'attente estimé (nombre de requêtes par thread multiplié par la durée moyenne de traitement) dépasse le délai maximal. Une requête restée trop longtemps dans la file est également refusée par le thread qui la retire.
+ * \~english
+ * \brief Bounded queue of the requests of a cost class
+ * \details Requests are refused on entry if the queue is full, or if the estimated wait (requests per thread multiplied by the mean processing time) exceeds the maximal delay. A request which stayed too long in the queue is also refused by the thread removing it.
+ */
+class RequestQueue {
+
+private:
+    /**
+     * \~french \brief Nom de la classe de coût, pour les logs
+     * \~english \brief Cost class name, for logs
+     */
+    std::string name;
+    /**
+     * \~french \brief Requêtes en attente
+     * \~english \brief Waiting requests
+     */
+    std::deque<QueuedRequest> queue;
+    /**
+     * \~french \brief Nombre maximal de requêtes en attente
+     * \~english \brief Maximal number of waiting requests
+     */
+    size_t capacity;
+    /**
+     * \~french \brief Nombre de threads traitant la file
+     * \~english \brief Number of threads processing the queue
+     */
+    int threads;
+    /**
+     * \~french \brief Délai d'attente maximal, en millisecondes, 0 pour ne pas limiter
+     * \~english \brief Maximal wait, in milliseconds, 0 for no limit
+     */
+    int timeout;
+    /**
+     * \~french \brief Durée moyenne de traitement d'une requête, en millisecondes
+     * \~english \brief Mean processing time of a request, in milliseconds
+     */
+    double serviceTime;
+    /**
+     * \~french \brief La file est-elle fermée ?
+     * \~english \brief Is the queue closed ?
+     */
+    bool closed;
+
+    /**
+     * \~french \brief Protège la file et les compteurs
+     * \~english \brief Protect the queue and the counters
+     */
+    pthread_mutex_t mutex;
+    /**
+     * \~french \brief Signale l'ajout d'une requête ou la fermeture de la file
+     * \~english \brief Signal a request addition or the queue closing
+     */
+    pthread_cond_t notEmpty;
+
+    /**
+     * \~french \brief Nombre de requêtes mises en file
+     * \~english \brief Number of enqueued requests
+     */
+    unsigned long accepted;
+    /**
+     * \~french \brief Nombre de requêtes refusées à l'entrée
+     * \~english \brief Number of requests refused on entry
+     */
+    unsigned long rejected;
+    /**
+     * \~french \brief Nombre de requêtes refusées après une attente trop longue
+     * \~english \brief Number of requests refused after a too long wait
+     */
+    unsigned long expired;
+
+public:
+    /**
+     * \~french
+     * \brief Constructeur
+     * \param[in] name nom de la classe de coût
+     * \param[in] capacity nombre maximal de requêtes en attente
+     * \param[in] threads nombre de threads traitant la file
+     * \param[in] timeout délai d'attente maximal, en millisecondes, 0 pour ne pas limiter
+     * \~english
+     * \brief Constructor
+     * \param[in] name cost class name
+     * \param[in] capacity maximal number of waiting requests
+     * \param[in] threads number of threads processing the queue
+     * \param[in] timeout maximal wait, in milliseconds, 0 for no limit
+     */
+    RequestQueue ( std::string name, size_t capacity, int threads, int timeout );
+
+    /**
+     * \~french
+     * \brief Destructeur, les statistiques sont enregistrées dans les logs
+     * \~english
+     * \brief Destructor, statistics are logged
+     */
+    ~RequestQueue();
+
+    /**
+     * \~french
+     * \brief Ajoute une requête dans la file
+     * \param[in] item requête acceptée, la date de mise en file est renseignée
+     * \return faux si la requête est refusée
+     * \~english
+     * \brief Add a request in the queue
+     * \param[in] item accepted request, the enqueue date is filled
+     * \return false if the request is refused
+     */
+    bool push ( QueuedRequest& item );
+
+    /**
+     * \~french
+     * \brief Retire la plus ancienne requête de la file, en attendant si elle est vide
+     * \param[out] item requête retirée
+     * \param[out] late vrai si la requête a attendu plus que le délai maximal
+     * \return faux si la file est fermée et vide
+     * \~english
+     * \brief Remove the oldest request from the queue, waiting if it is empty
+     * \param[out] item removed request
+     * \param[out] late true if the request waited longer than the maximal delay
+     * \return false if the queue is closed and empty
+     */
+    bool pop ( QueuedRequest& item, bool& late );
+
+    /**
+     * \~french
+     * \brief Prend en compte la durée de traitement d'une requête dans la moyenne
+     * \param[in] ms durée en millisecondes
+     * \~english
+     * \brief Take into account a request processing time in the mean
+     * \param[in] ms time in milliseconds
+     */
+    void served ( double ms );
+
+    /**
+     * \~french
+     * \brief Ferme la file : les requêtes restantes sont traitées, puis pop retourne faux
+     * \~english
+     * \brief Close the queue : remaining requests are processed, then pop returns false
+     */
+    void close();
+
+    /**
+     * \~french \brief Nombre de requêtes en attente
+     * \~english \brief Number of waiting requests
+     */
+    size_t size();
+    /**
+     * \~french \brief Nombre de threads traitant la file
+     * \~english \brief Number of threads processing the queue
+     */
+    int getThreads() {
+        return threads;
+    }
+    /**
+     * \~french \brief Nom de la classe de coût
+     * \~english \brief Cost class name
+     */
+    std::string getName() {
+        return name;
+    }
+    /**
+     * \~french \brief Nombre de requêtes mises en file
+     * \~english \brief Number of enqueued requests
+     */
+    unsigned long getAccepted();
+    /**
+     * \~french \brief Nombre de requêtes refusées à l'entrée
+     * \~english \brief Number of requests refused on entry
+     */
+    unsigned long getRejected();
+    /**
+     * \~french \brief Nombre de requêtes refusées après une attente trop longue
+     * \~english \brief Number of requests refused after a too long wait
+     */
+    unsigned long getExpired();
+
+    /**
+     * \~french
+     * \brief Classe de coût d'une requête
+     * \~english
+     * \brief Cost class of a request
+     */
+    static RequestCost getCost ( Request* request );
+};
+
+#endif
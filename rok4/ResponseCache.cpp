@@ -0,0 +1,415 @@
+/*
+ * Copyright © (2011-2013) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file ResponseCache.cpp
+ * \~french
+ * \brief Implémentation de la classe ResponseCache, cache des réponses GetMap encodées
+ * \~english
+ * \brief Implement the ResponseCache class, cache of encoded GetMap responses
+ */
+
+#include "ResponseCache.h"
+#include "RequestCoalescer.h"
+#include <dirent.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include "Logger.h"
+#include "intl.h"
+
+/**
+ * \~french \brief Extension des fichiers du cache disque
+ * \~english \brief Disk cache files extension
+ */
+#define RESPONSE_CACHE_EXTENSION ".rok4cache"
+
+/**
+ * \~french
+ * \brief Source de données lisant une réponse du cache
+ * \~english
+ * \brief Data source reading a cached response
+ */
+class CachedDataSource : public DataSource {
+private:
+    ResponseCache& cache;
+    CachedResponse* entry;
+public:
+    CachedDataSource ( ResponseCache& cache, CachedResponse* entry ) : cache ( cache ), entry ( entry ) {}
+    ~CachedDataSource() {
+        cache.release ( entry );
+    }
+    const uint8_t* getData ( size_t& size ) {
+        size = entry->size;
+        return entry->data;
+    }
+    bool releaseData() {
+        return false;
+    }
+    std::string getType() {
+        return entry->type;
+    }
+    int getHttpStatus() {
+        return 200;
+    }
+    std::string getEncoding() {
+        return entry->encoding;
+    }
+};
+
+/**
+ * \~french
+ * \brief Libère une réponse qui n'a plus d'utilisateur
+ * \~english
+ * \brief Free a response without any user left
+ */
+static void freeResponse ( CachedResponse* entry ) {
+    delete[] entry->data;
+    delete entry;
+}
+
+ResponseCache::ResponseCache ( size_t maxSize, size_t maxObjectSize, std::string directory, size_t maxDiskSize ) :
+    maxSize ( maxSize ), maxObjectSize ( maxObjectSize ), directory ( directory ), maxDiskSize ( maxDiskSize ),
+    memorySize ( 0 ), diskSize ( 0 ), fileCounter ( 0 ), hits ( 0 ), diskHits ( 0 ), misses ( 0 ) {
+    pthread_mutex_init ( &mutex, NULL );
+    if ( maxDiskSize == 0 ) {
+        this->directory.clear();
+    }
+    // Les fichiers d'une exécution précédente ne sont pas référencés
+    purgeDirectory();
+}
+
+ResponseCache::~ResponseCache() {
+    if ( isEnabled() ) {
+        LOGGER_INFO ( _ ( "Cache des reponses : " ) << hits << _ ( " trouvees en memoire, " ) << diskHits << _ ( " trouvees sur disque, " ) << misses << _ ( " absentes" ) );
+    }
+    clear();
+    pthread_mutex_destroy ( &mutex );
+}
+
+void ResponseCache::purgeDirectory() {
+    if ( directory.empty() ) {
+        return;
+    }
+    DIR* dir = opendir ( directory.c_str() );
+    if ( dir == NULL ) {
+        LOGGER_ERROR ( _ ( "Impossible d'ouvrir le repertoire du cache des reponses " ) << directory );
+        return;
+    }
+    size_t extLength = strlen ( RESPONSE_CACHE_EXTENSION );
+    struct dirent* file;
+    while ( ( file = readdir ( dir ) ) ) {
+        std::string name ( file->d_name );
+        if ( name.size() > extLength && name.compare ( name.size() - extLength, extLength, RESPONSE_CACHE_EXTENSION ) == 0 ) {
+            unlink ( ( directory + "/" + name ).c_str() );
+        }
+    }
+    closedir ( dir );
+}
+
+bool ResponseCache::buildKey ( Request* request, std::string& key ) {
+    if ( request->request != "getmap" && request->request != "map" ) {
+        return false;
+    }
+    return RequestCoalescer::buildKey ( request, key, true );
+}
+
+bool ResponseCache::removeFromMemory ( CachedResponse* entry ) {
+    memory.erase ( entry->key );
+    memoryLru.erase ( entry->lru );
+    memorySize -= entry->size;
+    entry->users--;
+    return ( entry->users == 0 );
+}
+
+void ResponseCache::removeFromDisk ( std::map<std::string, StoredResponse>::iterator it ) {
+    unlink ( it->second.path.c_str() );
+    diskLru.erase ( it->second.lru );
+    diskSize -= it->second.size;
+    disk.erase ( it );
+}
+
+void ResponseCache::insertInMemory ( CachedResponse* entry, std::vector<CachedResponse*>& evicted ) {
+    entry->lru = memoryLru.insert ( memoryLru.begin(), entry );
+    memory.insert ( std::pair<std::string, CachedResponse*> ( entry->key, entry ) );
+    memorySize += entry->size;
+    while ( memorySize > maxSize && memoryLru.size() > 1 ) {
+        // La référence du cache est transmise à demote
+        CachedResponse* victim = memoryLru.back();
+        memory.erase ( victim->key );
+        memoryLru.pop_back();
+        memorySize -= victim->size;
+        evicted.push_back ( victim );
+    }
+}
+
+void ResponseCache::demote ( std::vector<CachedResponse*>& evicted ) {
+    time_t now = time ( NULL );
+    for ( int i = 0; i < evicted.size(); i++ ) {
+        CachedResponse* entry = evicted.at ( i );
+        if ( !directory.empty() && entry->expiry > now && entry->size <= maxDiskSize ) {
+            pthread_mutex_lock ( &mutex );
+            char name[64];
+            snprintf ( name, sizeof ( name ), "/%lu" RESPONSE_CACHE_EXTENSION, fileCounter++ );
+            pthread_mutex_unlock ( &mutex );
+            std::string path = directory + name;
+
+            FILE* file = fopen ( path.c_str(), "wb" );
+            bool written = ( file != NULL && fwrite ( entry->data, 1, entry->size, file ) == entry->size );
+            if ( file != NULL && fclose ( file ) != 0 ) {
+                written = false;
+            }
+
+            pthread_mutex_lock ( &mutex );
+            if ( written && memory.find ( entry->key ) == memory.end() && disk.find ( entry->key ) == disk.end() ) {
+                StoredResponse stored;
+                stored.path = path;
+                stored.size = entry->size;
+                stored.type = entry->type;
+                stored.encoding = entry->encoding;
+                stored.expiry = entry->expiry;
+                stored.generation = entry->generation;
+                diskLru.push_front ( entry->key );
+                stored.lru = diskLru.begin();
+                disk.insert ( std::pair<std::string, StoredResponse> ( entry->key, stored ) );
+                diskSize += entry->size;
+                while ( diskSize > maxDiskSize ) {
+                    removeFromDisk ( disk.find ( diskLru.back() ) );
+                }
+            } else {
+                if ( !written ) {
+                    LOGGER_ERROR ( _ ( "Impossible d'ecrire le fichier du cache des reponses " ) << path );
+                }
+                unlink ( path.c_str() );
+            }
+            pthread_mutex_unlock ( &mutex );
+        }
+        release ( entry );
+    }
+}
+
+DataSource* ResponseCache::get ( const std::string& key, time_t generation ) {
+    time_t now = time ( NULL );
+    CachedResponse* expired = NULL;
+
+    pthread_mutex_lock ( &mutex );
+    std::map<std::string, CachedResponse*>::iterator it = memory.find ( key );
+    if ( it != memory.end() ) {
+        CachedResponse* entry = it->second;
+        if ( entry->expiry > now && entry->generation == generation ) {
+            entry->users++;
+            memoryLru.splice ( memoryLru.begin(), memoryLru, entry->lru );
+            hits++;
+            pthread_mutex_unlock ( &mutex );
+            return new CachedDataSource ( *this, entry );
+        }
+        if ( removeFromMemory ( entry ) ) {
+            expired = entry;
+        }
+    }
+
+    std::map<std::string, StoredResponse>::iterator dit = disk.find ( key );
+    if ( dit == disk.end() || dit->second.expiry <= now || dit->second.generation != generation ) {
+        if ( dit != disk.end() ) {
+            removeFromDisk ( dit );
+        }
+        misses++;
+        pthread_mutex_unlock ( &mutex );
+        if ( expired ) {
+            freeResponse ( expired );
+        }
+        return NULL;
+    }
+
+    // Le fichier est retiré de l'index : il n'appartient plus qu'à ce thread
+    StoredResponse stored = dit->second;
+    diskLru.erase ( dit->second.lru );
+    diskSize -= stored.size;
+    disk.erase ( dit );
+    pthread_mutex_unlock ( &mutex );
+    if ( expired ) {
+        freeResponse ( expired );
+    }
+
+    CachedResponse* entry = new CachedResponse;
+    entry->key = key;
+    entry->data = new uint8_t[stored.size];
+    entry->size = stored.size;
+    entry->type = stored.type;
+    entry->encoding = stored.encoding;
+    entry->expiry = stored.expiry;
+    entry->generation = stored.generation;
+    // Le cache et l'appelant
+    entry->users = 2;
+
+    FILE* file = fopen ( stored.path.c_str(), "rb" );
+    bool read = ( file != NULL && fread ( entry->data, 1, stored.size, file ) == stored.size );
+    if ( file != NULL ) {
+        fclose ( file );
+    }
+    unlink ( stored.path.c_str() );
+    if ( !read ) {
+        LOGGER_ERROR ( _ ( "Impossible de lire le fichier du cache des reponses " ) << stored.path );
+        freeResponse ( entry );
+        pthread_mutex_lock ( &mutex );
+        misses++;
+        pthread_mutex_unlock ( &mutex );
+        return NULL;
+    }
+
+    std::vector<CachedResponse*> evicted;
+    pthread_mutex_lock ( &mutex );
+    diskHits++;
+    if ( memory.find ( key ) == memory.end() ) {
+        insertInMemory ( entry, evicted );
+    } else {
+        // Une réponse plus récente a été ajoutée entre temps
+        entry->users--;
+    }
+    pthread_mutex_unlock ( &mutex );
+    demote ( evicted );
+
+    return new CachedDataSource ( *this, entry );
+}
+
+bool ResponseCache::add ( const std::string& key, DataSource* response, int ttl, time_t generation ) {
+    if ( !isEnabled() || ttl <= 0 || response->getHttpStatus() != 200 ) {
+        return false;
+    }
+    size_t size;
+    const uint8_t* data = response->getData ( size );
+    if ( data == NULL || size == 0 || size > maxSize || ( maxObjectSize > 0 && size > maxObjectSize ) ) {
+        return false;
+    }
+
+    CachedResponse* entry = new CachedResponse;
+    entry->key = key;
+    entry->data = new uint8_t[size];
+    memcpy ( entry->data, data, size );
+    entry->size = size;
+    entry->type = response->getType();
+    entry->encoding = response->getEncoding();
+    entry->expiry = time ( NULL ) + ttl;
+    entry->generation = generation;
+    entry->users = 1;
+
+    CachedResponse* replaced = NULL;
+    std::vector<CachedResponse*> evicted;
+    pthread_mutex_lock ( &mutex );
+    std::map<std::string, CachedResponse*>::iterator it = memory.find ( key );
+    if ( it != memory.end() ) {
+        CachedResponse* old = it->second;
+        if ( removeFromMemory ( old ) ) {
+            replaced = old;
+        }
+    }
+    std::map<std::string, StoredResponse>::iterator dit = disk.find ( key );
+    if ( dit != disk.end() ) {
+        removeFromDisk ( dit );
+    }
+    insertInMemory ( entry, evicted );
+    pthread_mutex_unlock ( &mutex );
+
+    if ( replaced ) {
+        freeResponse ( replaced );
+    }
+    demote ( evicted );
+    return true;
+}
+
+void ResponseCache::release ( CachedResponse* entry ) {
+    pthread_mutex_lock ( &mutex );
+    entry->users--;
+    bool last = ( entry->users == 0 );
+    pthread_mutex_unlock ( &mutex );
+    if ( last ) {
+        freeResponse ( entry );
+    }
+}
+
+void ResponseCache::clear() {
+    std::vector<CachedResponse*> freed;
+    pthread_mutex_lock ( &mutex );
+    while ( !memoryLru.empty() ) {
+        CachedResponse* entry = memoryLru.front();
+        if ( removeFromMemory ( entry ) ) {
+            freed.push_back ( entry );
+        }
+    }
+    while ( !disk.empty() ) {
+        removeFromDisk ( disk.begin() );
+    }
+    pthread_mutex_unlock ( &mutex );
+    for ( int i = 0; i < freed.size(); i++ ) {
+        freeResponse ( freed.at ( i ) );
+    }
+}
+
+size_t ResponseCache::getMemorySize() {
+    pthread_mutex_lock ( &mutex );
+    size_t size = memorySize;
+    pthread_mutex_unlock ( &mutex );
+    return size;
+}
+
+size_t ResponseCache::getDiskSize() {
+    pthread_mutex_lock ( &mutex );
+    size_t size = diskSize;
+    pthread_mutex_unlock ( &mutex );
+    return size;
+}
+
+unsigned long ResponseCache::getHits() {
+    pthread_mutex_lock ( &mutex );
+    unsigned long n = hits;
+    pthread_mutex_unlock ( &mutex );
+    return n;
+}
+
+unsigned long ResponseCache::getDiskHits() {
+    pthread_mutex_lock ( &mutex );
+    unsigned long n = diskHits;
+    pthread_mutex_unlock ( &mutex );
+    return n;
+}
+
+unsigned long ResponseCache::getMisses() {
+    pthread_mutex_lock ( &mutex );
+    unsigned long n = misses;
+    pthread_mutex_unlock ( &mutex );
+    return n;
+}
@@ -0,0 +1,423 @@
+/*
+ * Copyright © (2011-2013) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/**
+ * \file ResponseCache.h
+ * \~french
+ * \brief Définition de la classe ResponseCache, cache des réponses GetMap encodées
+ * \~english
+ * \brief Define the ResponseCache class, cache of encoded GetMap responses
+ */
+
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <pthread.h>
+#include <ctime>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+#include "Data.h"
+#include "Request.h"
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Réponse encodée conservée en mémoire
+ * \details Une réponse peut être lue par plusieurs requêtes pendant qu'elle est évincée : elle n'est libérée qu'après sa dernière lecture.
+ * \~english
+ * \brief Encoded response kept in memory
+ * \details A response can be read by several requests while it is evicted : it is freed after its last reading.
+ */
+struct CachedResponse {
+    /**
+     * \~french \brief Signature normalisée de la requête
+     * \~english \brief Normalized request signature
+     */
+    std::string key;
+    /**
+     * \~french \brief Réponse encodée
+     * \~english \brief Encoded response
+     */
+    uint8_t* data;
+    /**
+     * \~french \brief Taille de la réponse en octets
+     * \~english \brief Response size in bytes
+     */
+    size_t size;
+    /**
+     * \~french \brief Type MIME de la réponse
+     * \~english \brief Response MIME type
+     */
+    std::string type;
+    /**
+     * \~french \brief Encodage de la réponse
+     * \~english \brief Response encoding
+     */
+    std::string encoding;
+    /**
+     * \~french \brief Date d'expiration
+     * \~english \brief Expiry date
+     */
+    time_t expiry;
+    /**
+     * \~french \brief Génération des pyramides utilisées pour calculer la réponse
+     * \~english \brief Generation of the pyramids used to compute the response
+     */
+    time_t generation;
+    /**
+     * \~french \brief Nombre d'utilisateurs, le cache compris
+     * \~english \brief Users count, cache included
+     */
+    int users;
+    /**
+     * \~french \brief Position dans la liste LRU
+     * \~english \brief Position in the LRU list
+     */
+    std::list<CachedResponse*>::iterator lru;
+};
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Réponse encodée conservée sur disque
+ * \~english
+ * \brief Encoded response kept on disk
+ */
+struct StoredResponse {
+    /**
+     * \~french \brief Fichier contenant la réponse
+     * \~english \brief File containing the response
+     */
+    std::string path;
+    /**
+     * \~french \brief Taille de la réponse en octets
+     * \~english \brief Response size in bytes
+     */
+    size_t size;
+    /**
+     * \~french \brief Type MIME de la réponse
+     * \~english \brief Response MIME type
+     */
+    std::string type;
+    /**
+     * \~french \brief Encodage de la réponse
+     * \~english \brief Response encoding
+     */
+    std::string encoding;
+    /**
+     * \~french \brief Date d'expiration
+     * \~english \brief Expiry date
+     */
+    time_t expiry;
+    /**
+     * \~french \brief Génération des pyramides utilisées pour calculer la réponse
+     * \~english \brief Generation of the pyramids used to compute the response
+     */
+    time_t generation;
+    /**
+     * \~french \brief Position dans la liste LRU
+     * \~english \brief Position in the LRU list
+     */
+    std::list<std::string>::iterator lru;
+};
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Cache des réponses GetMap encodées
+ * \details Les réponses sont identifiées par la signature normalisée de la requête, la bbox étant arrondie à la précision du pixel de sortie. Le cache mémoire est borné en octets et évince les réponses les moins récemment utilisées. Si un répertoire est configuré, les réponses évincées de la mémoire sont conservées sur disque, dans une limite de taille distincte.
+ *
+ * Seules les réponses HTTP 200 de taille inférieure à maxObjectSize sont admises. Chaque réponse expire après la durée de vie de la couche demandée (la plus courte pour une requête multi-couches). Elle est aussi invalidée dès que la génération des pyramides demandées change, c'est-à-dire lorsque l'une d'elles est mise à jour. Le cache est vidé à chaque chargement de la configuration, y compris les fichiers sur disque.
+ * \~english
+ * \brief Cache of encoded GetMap responses
+ * \details Responses are identified by the normalized request signature, the bbox being rounded to the output pixel precision. The memory cache is bounded in bytes and evicts the least recently used responses. If a directory is configured, responses evicted from memory are kept on disk, within a distinct size limit.
+ *
+ * Only HTTP 200 responses smaller than maxObjectSize are admitted. Each response expires after the requested layer's time to live (the shortest one for a multi-layer request). It is also invalidated as soon as the requested pyramids' generation changes, that is to say when one of them is updated. The cache is emptied each time the configuration is loaded, files on disk included.
+ */
+class ResponseCache {
+
+private:
+    /**
+     * \~french \brief Taille maximale du cache mémoire, en octets, 0 si le cache est désactivé
+     * \~english \brief Memory cache maximal size, in bytes, 0 if the cache is disabled
+     */
+    size_t maxSize;
+    /**
+     * \~french \brief Taille maximale d'une réponse admise dans le cache, en octets
+     * \~english \brief Maximal size of a response admitted in the cache, in bytes
+     */
+    size_t maxObjectSize;
+    /**
+     * \~french \brief Répertoire du cache disque, vide si le cache disque est désactivé
+     * \~english \brief Disk cache directory, empty if the disk cache is disabled
+     */
+    std::string directory;
+    /**
+     * \~french \brief Taille maximale du cache disque, en octets
+     * \~english \brief Disk cache maximal size, in bytes
+     */
+    size_t maxDiskSize;
+
+    /**
+     * \~french \brief Réponses en mémoire, par signature
+     * \~english \brief In memory responses, by signature
+     */
+    std::map<std::string, CachedResponse*> memory;
+    /**
+     * \~french \brief Réponses en mémoire, de la plus récemment utilisée à la plus ancienne
+     * \~english \brief In memory responses, from the most recently used to the oldest
+     */
+    std::list<CachedResponse*> memoryLru;
+    /**
+     * \~french \brief Taille des réponses en mémoire
+     * \~english \brief In memory responses size
+     */
+    size_t memorySize;
+    /**
+     * \~french \brief Réponses sur disque, par signature
+     * \~english \brief On disk responses, by signature
+     */
+    std::map<std::string, StoredResponse> disk;
+    /**
+     * \~french \brief Signatures des réponses sur disque, de la plus récemment utilisée à la plus ancienne
+     * \~english \brief On disk responses signatures, from the most recently used to the oldest
+     */
+    std::list<std::string> diskLru;
+    /**
+     * \~french \brief Taille des réponses sur disque
+     * \~english \brief On disk responses size
+     */
+    size_t diskSize;
+    /**
+     * \~french \brief Compteur utilisé pour nommer les fichiers
+     * \~english \brief Counter used to name files
+     */
+    unsigned long fileCounter;
+
+    /**
+     * \~french \brief Protège l'ensemble des structures du cache
+     * \~english \brief Protect all the cache structures
+     */
+    pthread_mutex_t mutex;
+
+    /**
+     * \~french \brief Nombre de réponses trouvées en mémoire
+     * \~english \brief Number of responses found in memory
+     */
+    unsigned long hits;
+    /**
+     * \~french \brief Nombre de réponses trouvées sur disque
+     * \~english \brief Number of responses found on disk
+     */
+    unsigned long diskHits;
+    /**
+     * \~french \brief Nombre de réponses absentes
+     * \~english \brief Number of missing responses
+     */
+    unsigned long misses;
+
+    /**
+     * \~french
+     * \brief Retire une réponse du cache mémoire, le mutex doit être verrouillé
+     * \return vrai si la réponse n'a plus d'utilisateur et doit être libérée
+     * \~english
+     * \brief Remove a response from the memory cache, the mutex has to be locked
+     * \return true if the response has no user left and has to be freed
+     */
+    bool removeFromMemory ( CachedResponse* entry );
+    /**
+     * \~french
+     * \brief Retire une réponse du cache disque et supprime son fichier, le mutex doit être verrouillé
+     * \~english
+     * \brief Remove a response from the disk cache and delete its file, the mutex has to be locked
+     */
+    void removeFromDisk ( std::map<std::string, StoredResponse>::iterator it );
+    /**
+     * \~french
+     * \brief Insère une réponse dans le cache mémoire, le mutex doit être verrouillé
+     * \param[out] evicted réponses évincées pour faire de la place
+     * \~english
+     * \brief Insert a response in the memory cache, the mutex has to be locked
+     * \param[out] evicted responses evicted to make room
+     */
+    void insertInMemory ( CachedResponse* entry, std::vector<CachedResponse*>& evicted );
+    /**
+     * \~french
+     * \brief Écrit sur disque les réponses évincées de la mémoire, puis les libère
+     * \~english
+     * \brief Write on disk the responses evicted from memory, then free them
+     */
+    void demote ( std::vector<CachedResponse*>& evicted );
+    /**
+     * \~french
+     * \brief Supprime les fichiers du cache disque présents dans le répertoire
+     * \~english
+     * \brief Delete the disk cache files present in the directory
+     */
+    void purgeDirectory();
+
+public:
+    /**
+     * \~french
+     * \brief Constructeur
+     * \param[in] maxSize taille maximale du cache mémoire en octets, 0 pour désactiver le cache
+     * \param[in] maxObjectSize taille maximale d'une réponse admise, en octets
+     * \param[in] directory répertoire du cache disque, vide pour le désactiver
+     * \param[in] maxDiskSize taille maximale du cache disque, en octets
+     * \~english
+     * \brief Constructor
+     * \param[in] maxSize memory cache maximal size in bytes, 0 to disable the cache
+     * \param[in] maxObjectSize maximal size of an admitted response, in bytes
+     * \param[in] directory disk cache directory, empty to disable it
+     * \param[in] maxDiskSize disk cache maximal size, in bytes
+     */
+    ResponseCache ( size_t maxSize, size_t maxObjectSize, std::string directory = "", size_t maxDiskSize = 0 );
+
+    /**
+     * \~french
+     * \brief Destructeur, les fichiers du cache disque sont supprimés
+     * \~english
+     * \brief Destructor, disk cache files are deleted
+     */
+    ~ResponseCache();
+
+    /**
+     * \~french
+     * \brief Le cache est-il actif ?
+     * \~english
+     * \brief Is the cache enabled ?
+     */
+    inline bool isEnabled() {
+        return maxSize > 0;
+    }
+
+    /**
+     * \~french
+     * \brief Calcule la signature normalisée d'une requête GetMap
+     * \param[in] request requête à identifier
+     * \param[out] key signature
+     * \return faux si la requête ne peut pas être mise en cache
+     * \~english
+     * \brief Compute the normalized signature of a GetMap request
+     * \param[in] request request to identify
+     * \param[out] key signature
+     * \return false if the request cannot be cached
+     */
+    static bool buildKey ( Request* request, std::string& key );
+
+    /**
+     * \~french
+     * \brief Recherche une réponse dans le cache
+     * \details Une réponse trouvée sur disque est remontée en mémoire.
+     * \param[in] key signature de la requête
+     * \param[in] generation génération actuelle des pyramides demandées, une réponse d'une autre génération est périmée
+     * \return la réponse, à libérer par l'appelant, ou NULL si elle est absente ou périmée
+     * \~english
+     * \brief Look for a response in the cache
+     * \details A response found on disk is moved back in memory.
+     * \param[in] key request signature
+     * \param[in] generation current generation of the requested pyramids, a response of another generation is stale
+     * \return the response, to be freed by the caller, or NULL if missing or stale
+     */
+    DataSource* get ( const std::string& key, time_t generation = 0 );
+
+    /**
+     * \~french
+     * \brief Ajoute une réponse dans le cache, si elle est admissible
+     * \details La réponse est copiée, elle reste la propriété de l'appelant.
+     * \param[in] key signature de la requête
+     * \param[in] response réponse encodée
+     * \param[in] ttl durée de vie en secondes
+     * \param[in] generation génération des pyramides utilisées pour calculer la réponse
+     * \return vrai si la réponse a été admise
+     * \~english
+     * \brief Add a response in the cache, if admissible
+     * \details The response is copied, the caller keeps its ownership.
+     * \param[in] key request signature
+     * \param[in] response encoded response
+     * \param[in] ttl time to live in seconds
+     * \param[in] generation generation of the pyramids used to compute the response
+     * \return true if the response has been admitted
+     */
+    bool add ( const std::string& key, DataSource* response, int ttl, time_t generation = 0 );
+
+    /**
+     * \~french
+     * \brief Libère une réponse lue
+     * \~english
+     * \brief Release a read response
+     */
+    void release ( CachedResponse* entry );
+
+    /**
+     * \~french
+     * \brief Vide le cache
+     * \~english
+     * \brief Empty the cache
+     */
+    void clear();
+
+    /**
+     * \~french \brief Taille des réponses en mémoire
+     * \~english \brief In memory responses size
+     */
+    size_t getMemorySize();
+    /**
+     * \~french \brief Taille des réponses sur disque
+     * \~english \brief On disk responses size
+     */
+    size_t getDiskSize();
+    /**
+     * \~french \brief Nombre de réponses trouvées en mémoire
+     * \~english \brief Responses found in memory count
+     */
+    unsigned long getHits();
+    /**
+     * \~french \brief Nombre de réponses trouvées sur disque
+     * \~english \brief Responses found on disk count
+     */
+    unsigned long getDiskHits();
+    /**
+     * \~french \brief Nombre de réponses absentes
+     * \~english \brief Missing responses count
+     */
+    unsigned long getMisses();
+};
+
+#endif
@@ -48,9 +48,11 @@
 #include "Message.h"
 #include <iostream>
 #include "Logger.h"
+#include "CancellationToken.h"
 #include <stdio.h>
 #include <string.h> // pour strlen
 #include <sstream> // pour les stringstream
+#include <pthread.h>
 #include "intl.h"
 #include "config.h"
 /**
@@ -120,98 +122,201 @@ void displayFCGIError ( int error ) {
         LOGGER_ERROR ( _ ( "Erreur inconnue" ) );
 }
 
-int ResponseSender::sendresponse ( DataSource* source, FCGX_Request* request ) {
-    // Creation de l'en-tete
-    std::string statusHeader= genStatusHeader ( source->getHttpStatus() );
-    std::string filename = genFileName ( source->getType() );
-    LOGGER_DEBUG ( filename );
-    FCGX_PutStr ( statusHeader.data(),statusHeader.size(),request->out );
-    FCGX_PutStr ( "Content-Type: ",14,request->out );
-    FCGX_PutStr ( source->getType().c_str(), strlen ( source->getType().c_str() ),request->out );
-    if ( !source->getEncoding().empty() ){
-        FCGX_PutStr ( "\r\nContent-Encoding: ",20,request->out );
-        FCGX_PutStr ( source->getEncoding().c_str(), strlen ( source->getEncoding().c_str() ),request->out );
+static pthread_once_t buffer_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t buffer_key;
+
+static void delete_buffer ( void* buffer ) {
+    delete[] ( uint8_t* ) buffer;
+}
+
+static void init_buffer_key() {
+    pthread_key_create ( &buffer_key, delete_buffer );
+}
+
+ResponseWriter::ResponseWriter ( FCGX_Request* request ) : request ( request ), used ( 0 ), sent ( false ), failed ( false ) {
+    pthread_once ( &buffer_key_once, init_buffer_key );
+    buffer = ( uint8_t* ) pthread_getspecific ( buffer_key );
+    if ( ! buffer ) {
+        buffer = new uint8_t[RESPONSE_BUFFER_SIZE];
+        pthread_setspecific ( buffer_key, buffer );
     }
-    FCGX_PutStr ( "\r\nContent-Disposition: filename=\"",33,request->out );
-    FCGX_PutStr ( filename.data(),filename.size(), request->out );
-    FCGX_PutStr ( "\"",1,request->out );
-    FCGX_PutStr ( "\r\n\r\n",4,request->out );
-
-    // Copie dans le flux de sortie
-    size_t buffer_size;
-    const uint8_t *buffer = source->getData ( buffer_size );
-    int wr = 0;
-    // Ecriture iterative de la source de donnees dans le flux de sortie
-    while ( wr < buffer_size ) {
-        // Taille ecrite dans le flux de sortie
-        int w = FCGX_PutStr ( ( char* ) ( buffer + wr ), buffer_size,request->out );
+}
+
+bool ResponseWriter::put ( const uint8_t* data, size_t size ) {
+    if ( failed ) return false;
+    sent = true;
+    size_t wr = 0;
+    // Ecriture iterative dans le flux de sortie
+    while ( wr < size ) {
+        int w = FCGX_PutStr ( ( const char* ) ( data + wr ), size - wr, request->out );
         if ( w < 0 ) {
             LOGGER_ERROR ( _ ( "Echec d'ecriture dans le flux de sortie de la requete FCGI " ) << request->requestId );
             displayFCGIError ( FCGX_GetError ( request->out ) );
-            delete source;
-            //delete[] buffer;
-            return -1;
+            // Le client n'attend plus la réponse : le calcul est abandonné
+            if ( CancellationToken::getCurrent() ) {
+                CancellationToken::getCurrent()->cancel();
+            }
+            failed = true;
+            return false;
         }
         wr += w;
     }
+    return true;
+}
+
+bool ResponseWriter::flush() {
+    if ( used == 0 ) return ! failed;
+    size_t size = used;
+    used = 0;
+    return put ( buffer, size );
+}
+
+bool ResponseWriter::write ( const uint8_t* data, size_t size ) {
+    if ( size >= RESPONSE_DIRECT_WRITE_SIZE ) {
+        // Gros segment : écrit tel quel, après ce qui est en attente
+        return flush() && put ( data, size );
+    }
+    if ( used + size > RESPONSE_BUFFER_SIZE && ! flush() ) return false;
+    memcpy ( buffer + used, data, size );
+    used += size;
+    return ! failed;
+}
+
+bool ResponseWriter::write ( const std::vector<DataSegment>& segments ) {
+    for ( size_t i = 0; i < segments.size(); i++ ) {
+        if ( ! write ( segments[i].data, segments[i].size ) ) return false;
+    }
+    return true;
+}
+
+void ResponseWriter::abort() {
+    LOGGER_ERROR ( _ ( "Calcul interrompu, abandon de la requete FCGI " ) << request->requestId );
+    if ( CancellationToken::getCurrent() ) {
+        CancellationToken::getCurrent()->watchConnection ( -1 );
+    }
+    // Libère les flux sans les vider et ferme la connexion : FCGX_Finish_r n'a plus d'effet
+    FCGX_Free ( request, 1 );
+    used = 0;
+    failed = true;
+}
+
+uint8_t* ResponseWriter::reserve ( size_t& size ) {
+    if ( RESPONSE_BUFFER_SIZE - used < RESPONSE_DIRECT_WRITE_SIZE ) flush();
+    size = RESPONSE_BUFFER_SIZE - used;
+    return buffer + used;
+}
+
+/**
+ * \~french
+ * \brief Méthode commune pour générer l'ensemble des en-têtes HTTP
+ * \~english
+ * \brief Common function to generate the whole HTTP headers
+ */
+std::string genHeaders ( int statusCode, std::string type, std::string encoding, int retryAfter ) {
+    std::stringstream out;
+    out << genStatusHeader ( statusCode );
+    if ( retryAfter > 0 ) {
+        out << "Retry-After: " << retryAfter << "\r\n";
+    }
+    out << "Content-Type: " << type;
+    if ( !encoding.empty() ) {
+        out << "\r\nContent-Encoding: " << encoding;
+    }
+    out << "\r\nContent-Disposition: filename=\"" << genFileName ( type ) << "\"\r\n\r\n";
+    return out.str();
+}
+
+/**
+ * \~french
+ * \brief Réponse d'erreur remplaçant une réponse dont le calcul a été annulé
+ * \~english
+ * \brief Error response replacing a response whose computation has been cancelled
+ */
+static DataSource* genCancelledResponse() {
+    CancellationToken* token = CancellationToken::getCurrent();
+    if ( token && token->isTimedOut() ) {
+        return new SERDataSource ( new ServiceException ( "",HTTP_GATEWAY_TIMEOUT,_ ( "Le delai de traitement de la requete est depasse." ),"ows" ) );
+    }
+    return new SERDataSource ( new ServiceException ( "",HTTP_SERVICE_UNAVAILABLE,_ ( "Le traitement de la requete a ete interrompu." ),"ows" ) );
+}
+
+/**
+ * \~french
+ * \brief Copie d'une source de données dans le flux de sortie
+ * \param[in] cancellable la source est remplacée par une erreur si le calcul a été annulé
+ * \~english
+ * \brief Copy a data source in the output stream
+ * \param[in] cancellable the source is replaced by an error if the computation has been cancelled
+ */
+static int sendSource ( DataSource* source, FCGX_Request* request, int retryAfter, bool cancellable ) {
+    LOGGER_DEBUG ( genFileName ( source->getType() ) );
+    // Les segments sont lus (et une tuile éventuellement décodée) avant d'écrire quoi que ce soit
+    std::vector<DataSegment> segments;
+    bool hasSegments = source->getSegments ( segments );
+    if ( cancellable && CancellationToken::currentCancelled() ) {
+        delete source;
+        return sendSource ( genCancelledResponse(), request, 0, false );
+    }
+
+    ResponseWriter writer ( request );
+    // En-têtes, puis segments de la source (en-tête d'image, palette, tuile) sans les rassembler
+    writer.write ( genHeaders ( source->getHttpStatus(), source->getType(), source->getEncoding(), retryAfter ) );
+    if ( hasSegments ) {
+        writer.write ( segments );
+    }
+    writer.flush();
     delete source;
+    if ( writer.hasFailed() ) {
+        return -1;
+    }
     LOGGER_DEBUG ( _ ( "End of Response" ) );
     return 0;
 }
 
+int ResponseSender::sendresponse ( DataSource* source, FCGX_Request* request, int retryAfter ) {
+    return sendSource ( source, request, retryAfter, true );
+}
+
 int ResponseSender::sendresponse ( DataStream* stream, FCGX_Request* request ) {
-    // Creation de l'en-tete
-    std::string statusHeader= genStatusHeader ( stream->getHttpStatus() );
-    std::string filename = genFileName ( stream->getType() );
-    LOGGER_DEBUG ( filename );
-    FCGX_PutStr ( statusHeader.data(),statusHeader.size(),request->out );
-    FCGX_PutStr ( "Content-Type: ",14,request->out );
-    FCGX_PutStr ( stream->getType().c_str(), strlen ( stream->getType().c_str() ),request->out );
-    FCGX_PutStr ( "\r\nContent-Disposition: filename=\"",33,request->out );
-    FCGX_PutStr ( filename.data(),filename.size(), request->out );
-    FCGX_PutStr ( "\"",1,request->out );
-    FCGX_PutStr ( "\r\n\r\n",4,request->out );
-    // Copie dans le flux de sortie
-    uint8_t *buffer = new uint8_t[2 << 20];
-    size_t size_to_read = 2 << 20;
-    int pos = 0;
-
-    // Ecriture progressive du flux d'entree dans le flux de sortie
-    while ( true ) {
-        // Recuperation d'une portion du flux d'entree
+    LOGGER_DEBUG ( genFileName ( stream->getType() ) );
+    ResponseWriter writer ( request );
+    writer.write ( genHeaders ( stream->getHttpStatus(), stream->getType(), "", 0 ) );
 
+    // Lecture progressive du flux d'entree directement dans le tampon de sortie
+    while ( ! writer.hasFailed() ) {
+        size_t size_to_read;
+        uint8_t* buffer = writer.reserve ( size_to_read );
         size_t read_size = stream->read ( buffer, size_to_read );
-        if ( read_size==0 )
-            break;
-        int wr = 0;
-        // Ecriture iterative de la portion du flux d'entree dans le flux de sortie
-        while ( wr < read_size ) {
-            // Taille ecrite dans le flux de sortie
-            int w = FCGX_PutStr ( ( char* ) ( buffer + wr ), read_size,request->out );
-            if ( w < 0 ) {
-                LOGGER_ERROR ( _ ( "Echec d'ecriture dans le flux de sortie de la requete FCGI " ) << request->requestId );
-                displayFCGIError ( FCGX_GetError ( request->out ) );
-                delete stream;
-                delete[] buffer;
+        if ( CancellationToken::currentCancelled() ) {
+            // Image tronquée : jamais transmise comme une réponse complète
+            delete stream;
+            if ( writer.hasSent() ) {
+                writer.abort();
                 return -1;
             }
-            wr += w;
+            writer.discard();
+            return sendSource ( genCancelledResponse(), request, 0, false );
         }
-        if ( wr != read_size ) {
-            LOGGER_DEBUG ( _ ( "Nombre incorrect d'octets ecrits dans le flux de sortie" ) );
-            delete stream;
-            stream = 0;
-            delete[] buffer;
-            buffer = 0;
-            break;
+        if ( read_size==0 ) {
+            if ( stream->eof() )
+                break;
+            if ( ! writer.hasPending() ) {
+                // Le flux ne progresse pas, même avec un tampon entier
+                LOGGER_ERROR ( _ ( "Le flux de la reponse ne peut etre lu dans le tampon d'ecriture" ) );
+                delete stream;
+                writer.abort();
+                return -1;
+            }
+            // Le flux attend plus de place (une ligne entière d'image BIL) : le tampon est vidé avant de réessayer
+            writer.flush();
+            continue;
         }
-        pos += read_size;
-    }
-    if ( stream ) {
-        delete stream;
+        writer.commit ( read_size );
     }
-    if ( buffer ) {
-        delete[] buffer;
+    writer.flush();
+    delete stream;
+    if ( writer.hasFailed() ) {
+        return -1;
     }
     LOGGER_DEBUG ( _ ( "End of Response" ) );
     return 0;
@@ -48,25 +48,134 @@
 
 #include "Data.h"
 #include "fcgiapp.h"
+#include <string>
+#include <vector>
+
+/**
+ * \author Institut national de l'information géographique et forestière
+ * \~french
+ * \brief Écriture regroupée dans le flux de sortie FCGI
+ * \details Les petits segments (en-têtes HTTP, en-tête TIFF, palette PNG) sont regroupés dans un tampon
+ * propre au thread, alloué une seule fois et réutilisé d'une requête à l'autre. Les gros segments sont
+ * écrits directement, sans copie intermédiaire. En cas d'échec d'écriture, le calcul en cours est abandonné.
+ * \~english
+ * \brief Coalescing writer for the FCGI output stream
+ * \details Small segments (HTTP headers, TIFF header, PNG palette) are gathered in a per-thread buffer,
+ * allocated once and reused across requests. Large segments are written directly, without intermediate
+ * copy. On write failure, the current computation is cancelled.
+ */
+class ResponseWriter {
+private:
+    FCGX_Request* request;
+    /** \~french Tampon du thread, de taille RESPONSE_BUFFER_SIZE \~english Thread buffer, RESPONSE_BUFFER_SIZE long */
+    uint8_t* buffer;
+    /** \~french Nombre d'octets en attente dans le tampon \~english Pending bytes in the buffer */
+    size_t used;
+    /** \~french Des octets ont-ils été transmis au flux FCGI ? \~english Have bytes been passed to the FCGI stream ? */
+    bool sent;
+    bool failed;
+
+    bool put ( const uint8_t* data, size_t size );
+
+public:
+    ResponseWriter ( FCGX_Request* request );
+
+    /**
+     * \~french \brief Ajoute des octets à la réponse, copiés dans le tampon s'ils sont peu nombreux
+     * \~english \brief Append bytes to the response, copied in the buffer if they are few
+     */
+    bool write ( const uint8_t* data, size_t size );
+    bool write ( const std::string& data ) {
+        return write ( ( const uint8_t* ) data.data(), data.size() );
+    }
+    /**
+     * \~french \brief Ajoute une suite de segments à la réponse
+     * \~english \brief Append a segment chain to the response
+     */
+    bool write ( const std::vector<DataSegment>& segments );
+
+    /**
+     * \~french
+     * \brief Espace libre du tampon, pour y lire directement des données
+     * \details Le tampon est vidé s'il reste peu de place. Les octets lus sont validés par commit.
+     * \param[out] size taille disponible
+     * \~english
+     * \brief Free buffer space, to read data directly into it
+     * \details The buffer is flushed if little space is left. Read bytes are validated with commit.
+     * \param[out] size available size
+     */
+    uint8_t* reserve ( size_t& size );
+    void commit ( size_t size ) {
+        used += size;
+    }
+
+    /**
+     * \~french \brief Envoie le contenu du tampon dans le flux FCGI
+     * \~english \brief Send the buffer content to the FCGI stream
+     */
+    bool flush();
+
+    bool hasFailed() {
+        return failed;
+    }
+
+    /**
+     * \~french \brief Le tampon contient-il des octets en attente ?
+     * \~english \brief Does the buffer hold pending bytes ?
+     */
+    bool hasPending() {
+        return used > 0;
+    }
+
+    /**
+     * \~french \brief Des octets ont-ils déjà été transmis au flux FCGI ?
+     * \~english \brief Have bytes already been passed to the FCGI stream ?
+     */
+    bool hasSent() {
+        return sent;
+    }
+
+    /**
+     * \~french \brief Oublie les octets en attente, qui n'ont pas encore été transmis
+     * \~english \brief Forget pending bytes, which have not been passed yet
+     */
+    void discard() {
+        used = 0;
+    }
+
+    /**
+     * \~french
+     * \brief Abandonne la requête FCGI sans la terminer
+     * \details La connexion est fermée sans fin de requête FCGI : le serveur web signale au client une réponse incomplète, au lieu de la transmettre comme une réponse valide.
+     * \~english
+     * \brief Abort the FCGI request without ending it
+     * \details The connection is closed without FCGI end of request : the web server reports an incomplete response to the client, instead of passing it as a valid one.
+     */
+    void abort();
+};
 
 /**
  * \author Institut national de l'information géographique et forestière
  * \~french
  * \brief Gestions de l'envoie des réponses dans le flux FCGI
+ * \details Une réponse dont le calcul a été annulé (échéance dépassée) est incomplète : elle n'est jamais envoyée avec le statut HTTP 200. Si rien n'a encore été transmis, une erreur 504 (échéance) ou 503 (autre annulation) est envoyée à la place, sinon la requête FCGI est abandonnée.
  * \~english
  * \brief FCGI response handler
+ * \details A response whose computation has been cancelled (deadline exceeded) is incomplete : it is never sent with the HTTP 200 status. If nothing has been passed yet, a 504 (deadline) or 503 (other cancellation) error is sent instead, otherwise the FCGI request is aborted.
  */
 class ResponseSender {
 public:
     /**
      * \~french
      * \brief Copie d'une source de données dans le flux de sortie de l'objet request de type FCGX_Request
+     * \param[in] retryAfter délai en secondes de l'en-tête Retry-After, absent si 0
      * \return -1 en cas de problème, 0 sinon
      * \~english
      * \brief Copy a data source in the FCGX_Request output stream
+     * \param[in] retryAfter Retry-After header delay in seconds, missing if 0
      * \return -1 if error, else 0
      */
-    int sendresponse ( DataSource* response, FCGX_Request* request );
+    int sendresponse ( DataSource* response, FCGX_Request* request, int retryAfter = 0 );
     /**
      * \~french
      * \brief Copie d'un flux d'entree dans le flux de sortie de l'objet request de type FCGX_Request
@@ -54,6 +54,8 @@
 #include "PNGEncoder.h"
 #include "Decoder.h"
 #include "Pyramid.h"
+#include "Grid.h"
+#include "MappedSlabStorage.h"
 #include "TileMatrixSet.h"
 #include "TileMatrix.h"
 #include "intl.h"
@@ -94,9 +96,13 @@ Rok4Server* rok4InitServer ( const char* serverConfigFile ) {
     LogOutput logOutput;
     int nbThread,logFilePeriod,backlog;
     LogLevel logLevel;
-    bool supportWMTS,supportWMS,reprojectionCapability;
-    std::string strServerConfigFile=serverConfigFile,strLogFileprefix,strServicesConfigFile,strLayerDir,strTmsDir,strStyleDir,socket;
-    if ( !ConfLoader::getTechnicalParam ( strServerConfigFile, logOutput, strLogFileprefix, logFilePeriod, logLevel, nbThread, supportWMTS, supportWMS, reprojectionCapability, strServicesConfigFile, strLayerDir, strTmsDir, strStyleDir, socket, backlog ) ) {
+    bool supportWMTS,supportWMS,reprojectionCapability,requestCoalescing;
+    int coalescingTimeout,responseCacheSize,responseCacheObjectSize,responseCacheDiskSize;
+    int tileThreads,mapThreads,otherThreads,queueSize,queueTimeout,retryAfter;
+    int getTileTimeout,getMapTimeout,arenaSize,gridCacheSize,bandThreads,degradeQueueDepth,mappedSlabsSize;
+    double gridMaxError;
+    std::string strServerConfigFile=serverConfigFile,strLogFileprefix,strServicesConfigFile,strLayerDir,strTmsDir,strStyleDir,socket,responseCacheDir;
+    if ( !ConfLoader::getTechnicalParam ( strServerConfigFile, logOutput, strLogFileprefix, logFilePeriod, logLevel, nbThread, supportWMTS, supportWMS, reprojectionCapability, strServicesConfigFile, strLayerDir, strTmsDir, strStyleDir, socket, backlog, requestCoalescing, coalescingTimeout, responseCacheSize, responseCacheObjectSize, responseCacheDir, responseCacheDiskSize, tileThreads, mapThreads, otherThreads, queueSize, queueTimeout, retryAfter, getTileTimeout, getMapTimeout, arenaSize, gridMaxError, gridCacheSize, bandThreads, degradeQueueDepth, mappedSlabsSize ) ) {
         std::cerr<<_ ( "ERREUR FATALE : Impossible d'interpreter le fichier de configuration du serveur " ) <<strServerConfigFile<<std::endl;
         return NULL;
     }
@@ -154,6 +160,9 @@ Rok4Server* rok4InitServer ( const char* serverConfigFile ) {
         return NULL;
     }
 
+    // Projection en mémoire des dalles des niveaux qui la demandent
+    MappedSlabStorage::configure ( mappedSlabsSize );
+
     // Chargement des layers
     std::map<std::string, Layer*> layerList;
     if ( !ConfLoader::buildLayersList ( strLayerDir,tmsList, styleList,layerList,reprojectionCapability,sc ) ) {
@@ -163,9 +172,15 @@ Rok4Server* rok4InitServer ( const char* serverConfigFile ) {
         return NULL;
     }
 
+    // Grilles de reprojection
+    Grid::configure ( gridMaxError, gridCacheSize );
+
     // Instanciation du serveur
     Logger::stopLogger();
-    return new Rok4Server ( nbThread, *sc, layerList, tmsList, styleList, socket, backlog, supportWMTS, supportWMS );
+    return new Rok4Server ( nbThread, *sc, layerList, tmsList, styleList, socket, backlog, supportWMTS, supportWMS, requestCoalescing, coalescingTimeout,
+                            responseCacheSize, responseCacheObjectSize, responseCacheDir, responseCacheDiskSize,
+                            tileThreads, mapThreads, otherThreads, queueSize, queueTimeout, retryAfter,
+                            getTileTimeout, getMapTimeout, arenaSize, bandThreads, degradeQueueDepth );
 }
 
 /**
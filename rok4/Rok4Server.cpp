@@ -73,6 +73,53 @@
 #include "PaletteDataSource.h"
 #include "EstompageImage.h"
 #include "MergeImage.h"
+#include "CancellationToken.h"
+#include "MemoryArena.h"
+#include "BandImage.h"
+#include "TaskPool.h"
+#include "TileTable.h"
+
+Request* Rok4Server::readRequest ( FCGX_Request& fcgxRequest ) {
+    //DEBUG: La boucle suivante permet de lister les valeurs dans fcgxRequest.envp
+    /*char **p;
+    for (p = fcgxRequest.envp; *p; ++p) {
+        LOGGER_DEBUG((char*)*p);
+    }*/
+
+    Request* request;
+    std::string content;
+    bool postRequest = ( servicesConf.isPostEnabled() ?strcmp ( FCGX_GetParam ( "REQUEST_METHOD",fcgxRequest.envp ),"POST" ) ==0:false );
+
+    if ( postRequest ) { // Post Request
+        char* contentBuffer = ( char* ) malloc ( sizeof ( char ) *200 );
+        while ( FCGX_GetLine ( contentBuffer,200,fcgxRequest.in ) ) {
+            content.append ( contentBuffer );
+        }
+        free ( contentBuffer );
+        contentBuffer= NULL;
+        LOGGER_DEBUG ( _ ( "Request Content :" ) << std::endl << content );
+        request = new Request ( FCGX_GetParam ( "QUERY_STRING", fcgxRequest.envp ),
+                                FCGX_GetParam ( "HTTP_HOST", fcgxRequest.envp ),
+                                FCGX_GetParam ( "SCRIPT_NAME", fcgxRequest.envp ),
+                                FCGX_GetParam ( "HTTPS", fcgxRequest.envp ),
+                                content );
+
+
+
+    } else { // Get Request
+
+        /* On espère récupérer le nom du host tel qu'il est exprimé dans la requete avec HTTP_HOST.
+         * De même, on espère récupérer le path tel qu'exprimé dans la requête avec SCRIPT_NAME.
+         */
+
+        request = new Request ( FCGX_GetParam ( "QUERY_STRING", fcgxRequest.envp ),
+                                FCGX_GetParam ( "HTTP_HOST", fcgxRequest.envp ),
+                                FCGX_GetParam ( "SCRIPT_NAME", fcgxRequest.envp ),
+                                FCGX_GetParam ( "HTTPS", fcgxRequest.envp )
+                              );
+    }
+    return request;
+}
 
 void* Rok4Server::thread_loop ( void* arg ) {
     Rok4Server* server = ( Rok4Server* ) ( arg );
@@ -80,11 +127,9 @@ void* Rok4Server::thread_loop ( void* arg ) {
     if ( FCGX_InitRequest ( &fcgxRequest, server->sock, FCGI_FAIL_ACCEPT_ON_INTR ) !=0 ) {
         LOGGER_FATAL ( _ ( "Le listener FCGI ne peut etre initialise" ) );
     }
+    MemoryArena* arena = server->createArena();
 
     while ( server->isRunning() ) {
-        std::string content;
-        bool postRequest;
-
         int rc;
         if ( ( rc=FCGX_Accept_r ( &fcgxRequest ) ) < 0 ) {
             if ( rc != -4 ) { // Cas différent du redémarrage
@@ -93,63 +138,131 @@ void* Rok4Server::thread_loop ( void* arg ) {
             //std::cerr <<"FCGX_InitRequest renvoie le code d'erreur" << rc << std::endl;
             break;
         }
-        //DEBUG: La boucle suivante permet de lister les valeurs dans fcgxRequest.envp
-        /*char **p;
-        for (p = fcgxRequest.envp; *p; ++p) {
-            LOGGER_DEBUG((char*)*p);
-        }*/
-
-        Request* request;
 
+        Request* request = server->readRequest ( fcgxRequest );
+        server->processRequest ( request, fcgxRequest );
+        delete request;
 
+        FCGX_Finish_r ( &fcgxRequest );
+        FCGX_Free ( &fcgxRequest,1 );
+    }
+    MemoryArena::setCurrent ( NULL );
+    delete arena;
+    LOGGER_DEBUG ( _ ( "Extinction du thread" ) );
+    Logger::stopLogger();
+    return 0;
+}
 
-        postRequest = ( server->servicesConf.isPostEnabled() ?strcmp ( FCGX_GetParam ( "REQUEST_METHOD",fcgxRequest.envp ),"POST" ) ==0:false );
+void* Rok4Server::accept_loop ( void* arg ) {
+    Rok4Server* server = ( Rok4Server* ) ( arg );
 
-        if ( postRequest ) { // Post Request
-            char* contentBuffer = ( char* ) malloc ( sizeof ( char ) *200 );
-            while ( FCGX_GetLine ( contentBuffer,200,fcgxRequest.in ) ) {
-                content.append ( contentBuffer );
+    while ( server->isRunning() ) {
+        // La requête FCGI est transmise à un autre thread : elle est allouée pour chaque connexion
+        FCGX_Request* fcgxRequest = new FCGX_Request;
+        if ( FCGX_InitRequest ( fcgxRequest, server->sock, FCGI_FAIL_ACCEPT_ON_INTR ) !=0 ) {
+            LOGGER_FATAL ( _ ( "Le listener FCGI ne peut etre initialise" ) );
+        }
+        int rc;
+        if ( ( rc=FCGX_Accept_r ( fcgxRequest ) ) < 0 ) {
+            if ( rc != -4 ) { // Cas différent du redémarrage
+                LOGGER_ERROR ( _ ( "FCGX_InitRequest renvoie le code d'erreur" ) << rc );
             }
-            free ( contentBuffer );
-            contentBuffer= NULL;
-            LOGGER_DEBUG ( _ ( "Request Content :" ) << std::endl << content );
-            request = new Request ( FCGX_GetParam ( "QUERY_STRING", fcgxRequest.envp ),
-                                    FCGX_GetParam ( "HTTP_HOST", fcgxRequest.envp ),
-                                    FCGX_GetParam ( "SCRIPT_NAME", fcgxRequest.envp ),
-                                    FCGX_GetParam ( "HTTPS", fcgxRequest.envp ),
-                                    content );
-
-
-
-        } else { // Get Request
-
-            /* On espère récupérer le nom du host tel qu'il est exprimé dans la requete avec HTTP_HOST.
-             * De même, on espère récupérer le path tel qu'exprimé dans la requête avec SCRIPT_NAME.
-             */
+            delete fcgxRequest;
+            break;
+        }
 
-            request = new Request ( FCGX_GetParam ( "QUERY_STRING", fcgxRequest.envp ),
-                                    FCGX_GetParam ( "HTTP_HOST", fcgxRequest.envp ),
-                                    FCGX_GetParam ( "SCRIPT_NAME", fcgxRequest.envp ),
-                                    FCGX_GetParam ( "HTTPS", fcgxRequest.envp )
-                                  );
+        QueuedRequest item;
+        item.fcgxRequest = fcgxRequest;
+        item.request = server->readRequest ( *fcgxRequest );
+        RequestQueue* queue = server->queues.at ( RequestQueue::getCost ( item.request ) );
+        if ( !queue->push ( item ) ) {
+            server->rejectRequest ( item );
         }
-        server->processRequest ( request, fcgxRequest );
-        delete request;
+    }
+    LOGGER_DEBUG ( _ ( "Extinction du thread" ) );
+    Logger::stopLogger();
+    return 0;
+}
 
-        FCGX_Finish_r ( &fcgxRequest );
-        FCGX_Free ( &fcgxRequest,1 );
+void* Rok4Server::worker_loop ( void* arg ) {
+    WorkerContext* context = ( WorkerContext* ) ( arg );
+    QueuedRequest item;
+    bool late;
+    MemoryArena* arena = context->server->createArena();
+
+    while ( context->queue->pop ( item, late ) ) {
+        if ( late ) {
+            // La réponse arriverait trop tard : le client est invité à réessayer
+            context->server->rejectRequest ( item );
+            continue;
+        }
+        struct timeval start, end;
+        gettimeofday ( &start, NULL );
+        context->server->processRequest ( item.request, *item.fcgxRequest );
+        gettimeofday ( &end, NULL );
+        context->queue->served ( ( end.tv_sec - start.tv_sec ) * 1000.0 + ( end.tv_usec - start.tv_usec ) / 1000.0 );
+        context->server->finishRequest ( item );
     }
+    MemoryArena::setCurrent ( NULL );
+    delete arena;
     LOGGER_DEBUG ( _ ( "Extinction du thread" ) );
     Logger::stopLogger();
     return 0;
 }
 
+MemoryArena* Rok4Server::createArena() {
+    MemoryArena* arena = NULL;
+    if ( arenaSize > 0 ) {
+        arena = new MemoryArena ( arenaSize );
+    }
+    MemoryArena::setCurrent ( arena );
+    return arena;
+}
+
+void Rok4Server::rejectRequest ( QueuedRequest& item ) {
+    std::string service = item.request->service.empty() ? "wms" : item.request->service;
+    S.sendresponse ( new SERDataSource ( new ServiceException ( "",HTTP_SERVICE_UNAVAILABLE,_ ( "Le serveur est surcharge, la requete doit etre renouvelee ulterieurement." ),service ) ),
+                     item.fcgxRequest, retryAfter );
+    finishRequest ( item );
+}
+
+void Rok4Server::finishRequest ( QueuedRequest& item ) {
+    delete item.request;
+    FCGX_Finish_r ( item.fcgxRequest );
+    FCGX_Free ( item.fcgxRequest,1 );
+    delete item.fcgxRequest;
+}
+
 Rok4Server::Rok4Server ( int nbThread, ServicesConf& servicesConf, std::map<std::string,Layer*> &layerList,
                          std::map<std::string,TileMatrixSet*> &tmsList, std::map<std::string,Style*> &styleList,
-                         std::string socket, int backlog, bool supportWMTS, bool supportWMS ) :
+                         std::string socket, int backlog, bool supportWMTS, bool supportWMS,
+                         bool requestCoalescing, int coalescingTimeout, int responseCacheSize, int responseCacheObjectSize,
+                         std::string responseCacheDir, int responseCacheDiskSize, int tileThreads, int mapThreads,
+                         int otherThreads, int queueSize, int queueTimeout, int retryAfter,
+                         int getTileTimeout, int getMapTimeout, int arenaSize, int bandThreads,
+                         int degradeQueueDepth ) :
     sock ( 0 ), servicesConf ( servicesConf ), layerList ( layerList ), tmsList ( tmsList ),
     styleList ( styleList ), threads ( nbThread ), socket ( socket ), backlog ( backlog ),
-    running ( false ), notFoundError ( NULL ), supportWMTS ( supportWMTS ), supportWMS ( supportWMS ) {
+    running ( false ), notFoundError ( NULL ), supportWMTS ( supportWMTS ), supportWMS ( supportWMS ),
+    coalescer ( requestCoalescing, coalescingTimeout ),
+    responseCache ( ( size_t ) responseCacheSize * 1024 * 1024, ( size_t ) responseCacheObjectSize * 1024,
+                    responseCacheDir, ( size_t ) responseCacheDiskSize * 1024 * 1024 ),
+    retryAfter ( retryAfter ), getTileTimeout ( getTileTimeout ), getMapTimeout ( getMapTimeout ),
+    cancelledRequests ( 0 ), timedOutRequests ( 0 ), arenaSize ( ( size_t ) arenaSize * 1024 ),
+    bandPool ( NULL ), degradeQueueDepth ( degradeQueueDepth ) {
+
+    pthread_mutex_init ( &cancellationMutex, NULL );
+
+    if ( tileThreads > 0 || mapThreads > 0 || otherThreads > 0 ) {
+        // Chaque classe de coût doit être servie par au moins un thread
+        queues.push_back ( new RequestQueue ( "GetTile", queueSize, std::max ( tileThreads, 1 ), queueTimeout ) );
+        queues.push_back ( new RequestQueue ( "GetMap", queueSize, std::max ( mapThreads, 1 ), queueTimeout ) );
+        queues.push_back ( new RequestQueue ( "Other", queueSize, std::max ( otherThreads, 1 ), queueTimeout ) );
+    }
+
+    if ( bandThreads > 0 ) {
+        bandPool = new TaskPool ( bandThreads );
+    }
 
     if ( supportWMS ) {
         LOGGER_DEBUG ( _ ( "Build WMS Capabilities 1.3.0" ) );
@@ -170,6 +283,16 @@ Rok4Server::~Rok4Server() {
         delete notFoundError;
         notFoundError = NULL;
     }
+    for ( int i = 0; i < queues.size(); i++ ) {
+        delete queues[i];
+    }
+    if ( bandPool ) {
+        delete bandPool;
+    }
+    if ( cancelledRequests > 0 || timedOutRequests > 0 ) {
+        LOGGER_INFO ( _ ( "Requetes abandonnees : " ) << cancelledRequests << _ ( " connexions fermees, " ) << timedOutRequests << _ ( " delais depasses" ) );
+    }
+    pthread_mutex_destroy ( &cancellationMutex );
 }
 
 void Rok4Server::initFCGI() {
@@ -188,8 +311,23 @@ void Rok4Server::killFCGI() {
 void Rok4Server::run(sig_atomic_t signal_pending) {
     running = true;
 
+    // Threads de traitement des files, si les requêtes sont réparties par classe de coût
+    for ( int i = 0; i < queues.size(); i++ ) {
+        WorkerContext context;
+        context.server = this;
+        context.queue = queues[i];
+        workerContexts.push_back ( context );
+    }
+    for ( int i = 0; i < workerContexts.size(); i++ ) {
+        for ( int j = 0; j < workerContexts[i].queue->getThreads(); j++ ) {
+            pthread_t worker;
+            pthread_create ( &worker, NULL, Rok4Server::worker_loop, ( void* ) & ( workerContexts[i] ) );
+            workers.push_back ( worker );
+        }
+    }
+
     for ( int i = 0; i < threads.size(); i++ ) {
-        pthread_create ( & ( threads[i] ), NULL, Rok4Server::thread_loop, ( void* ) this );
+        pthread_create ( & ( threads[i] ), NULL, queues.empty() ? Rok4Server::thread_loop : Rok4Server::accept_loop, ( void* ) this );
     }
     
     if (signal_pending != 0 ) {
@@ -198,6 +336,12 @@ void Rok4Server::run(sig_atomic_t signal_pending) {
     
     for ( int i = 0; i < threads.size(); i++ )
         pthread_join ( threads[i], NULL );
+
+    // Plus aucune requête n'est acceptée : les files sont vidées puis les threads s'arrêtent
+    for ( int i = 0; i < queues.size(); i++ )
+        queues[i]->close();
+    for ( int i = 0; i < workers.size(); i++ )
+        pthread_join ( workers[i], NULL );
 }
 
 void Rok4Server::terminate() {
@@ -275,42 +419,34 @@ DataStream* Rok4Server::WMTSGetCapabilities ( Request* request ) {
     return new MessageDataStream ( capa,"application/xml" );
 }
 
-DataStream* Rok4Server::getMap ( Request* request ) {
-    std::vector<Layer*> layers;
-    BoundingBox<double> bbox ( 0.0, 0.0, 0.0, 0.0 );
-    int width, height;
-    CRS crs;
-    std::string format;
-    std::vector<Style*> styles;
-    std::map <std::string, std::string > format_option;
+Image* Rok4Server::buildMapImage ( std::vector<Layer*>& layers, std::vector<Style*>& styles, BoundingBox<double> bbox,
+                                   int width, int height, CRS& crs, std::string& format, std::vector<std::string>& levels,
+                                   Rok4Format::eformat_data& pyrType, DataStream*& errorResp ) {
     std::vector<Image*> images;
-
-
-    // Récupération des paramètres
-    DataStream* errorResp = request->getMapParam ( servicesConf, layerList, layers, bbox, width, height, crs, format ,styles, format_option );
-    if ( errorResp ) {
-        LOGGER_ERROR ( _ ( "Probleme dans les parametres de la requete getMap" ) );
-        return errorResp;
-    }
-
     int error;
     Image* image;
     for ( int i = 0 ; i < layers.size(); i ++ ) {
-        Image* curImage = layers.at ( i )->getbbox ( servicesConf, bbox, width, height, crs, error );
+        Image* curImage = layers.at ( i )->getbbox ( servicesConf, bbox, width, height, crs, error, &levels.at ( i ) );
 
         LOGGER_DEBUG ( _ ( "GetMap de Style : " ) << styles.at ( i )->getId() << _ ( " pal size : " ) <<styles.at ( i )->getPalette()->getPalettePNGSize() );
 
         if ( curImage == 0 ) {
+            for ( int j = 0; j < images.size(); j++ ) {
+                delete images.at ( j );
+            }
             switch ( error ) {
 
             case 1: {
-                return new SERDataStream ( new ServiceException ( "",OWS_INVALID_PARAMETER_VALUE,_ ( "bbox invalide" ),"wms" ) );
+                errorResp = new SERDataStream ( new ServiceException ( "",OWS_INVALID_PARAMETER_VALUE,_ ( "bbox invalide" ),"wms" ) );
+                return NULL;
             }
             case 2: {
-                return new SERDataStream ( new ServiceException ( "",OWS_INVALID_PARAMETER_VALUE,_ ( "bbox trop grande" ),"wms" ) );
+                errorResp = new SERDataStream ( new ServiceException ( "",OWS_INVALID_PARAMETER_VALUE,_ ( "bbox trop grande" ),"wms" ) );
+                return NULL;
             }
             default : {
-                return new SERDataStream ( new ServiceException ( "",OWS_NOAPPLICABLE_CODE,_ ( "Impossible de repondre a la requete" ),"wms" ) );
+                errorResp = new SERDataStream ( new ServiceException ( "",OWS_NOAPPLICABLE_CODE,_ ( "Impossible de repondre a la requete" ),"wms" ) );
+                return NULL;
             }
             }
         }
@@ -335,6 +471,21 @@ DataStream* Rok4Server::getMap ( Request* request ) {
                 case Rok4Format::TIFF_PKB_FLOAT32 :
                     pyrType = Rok4Format::TIFF_PKB_INT8;
                     break;
+                case Rok4Format::TIFF_ZSTD_FLOAT32 :
+                    pyrType = Rok4Format::TIFF_ZSTD_INT8;
+                    break;
+                case Rok4Format::TIFF_RAW_UINT16 :
+                    pyrType = Rok4Format::TIFF_RAW_INT8;
+                    break;
+                case Rok4Format::TIFF_ZIP_UINT16 :
+                    pyrType = Rok4Format::TIFF_ZIP_INT8;
+                    break;
+                case Rok4Format::TIFF_LZW_UINT16 :
+                    pyrType = Rok4Format::TIFF_LZW_INT8;
+                    break;
+                case Rok4Format::TIFF_PKB_UINT16 :
+                    pyrType = Rok4Format::TIFF_PKB_INT8;
+                    break;
                 default:
                     break;
                 }
@@ -348,6 +499,11 @@ DataStream* Rok4Server::getMap ( Request* request ) {
                     case Rok4Format::TIFF_ZIP_FLOAT32 :
                     case Rok4Format::TIFF_LZW_FLOAT32 :
                     case Rok4Format::TIFF_PKB_FLOAT32 :
+                    case Rok4Format::TIFF_ZSTD_FLOAT32 :
+                    case Rok4Format::TIFF_RAW_UINT16 :
+                    case Rok4Format::TIFF_ZIP_UINT16 :
+                    case Rok4Format::TIFF_LZW_UINT16 :
+                    case Rok4Format::TIFF_PKB_UINT16 :
                         curImage = new StyledImage ( curImage, styles.at ( i )->getPalette()->isNoAlpha()?3:4 , styles.at ( i )->getPalette() );
                     default:
                         break;
@@ -363,7 +519,7 @@ DataStream* Rok4Server::getMap ( Request* request ) {
     }
 
     //Use background image format.
-    Rok4Format::eformat_data pyrType = layers.at ( 0 )->getDataPyramid()->getFormat();
+    pyrType = layers.at ( 0 )->getDataPyramid()->getFormat();
     image = images.at ( 0 );
     //if ( images.size() > 1  || (styles.at( 0 ) && (styles.at( 0 )->isEstompage() || !styles.at( 0 )->getPalette()->getColoursMap()->empty()) ) ) {
     if ( (styles.at( 0 ) && (styles.at( 0 )->isEstompage() || !styles.at( 0 )->getPalette()->getColoursMap()->empty()) ) ) {
@@ -382,6 +538,21 @@ DataStream* Rok4Server::getMap ( Request* request ) {
         case Rok4Format::TIFF_PKB_FLOAT32 :
             pyrType = Rok4Format::TIFF_PKB_INT8;
             break;
+        case Rok4Format::TIFF_ZSTD_FLOAT32 :
+            pyrType = Rok4Format::TIFF_ZSTD_INT8;
+            break;
+        case Rok4Format::TIFF_RAW_UINT16 :
+            pyrType = Rok4Format::TIFF_RAW_INT8;
+            break;
+        case Rok4Format::TIFF_ZIP_UINT16 :
+            pyrType = Rok4Format::TIFF_ZIP_INT8;
+            break;
+        case Rok4Format::TIFF_LZW_UINT16 :
+            pyrType = Rok4Format::TIFF_LZW_INT8;
+            break;
+        case Rok4Format::TIFF_PKB_UINT16 :
+            pyrType = Rok4Format::TIFF_PKB_INT8;
+            break;
         default:
             break;
         }
@@ -398,6 +569,7 @@ DataStream* Rok4Server::getMap ( Request* request ) {
 	  case Rok4Format::TIFF_ZIP_FLOAT32 :
 	  case Rok4Format::TIFF_LZW_FLOAT32 :
 	  case Rok4Format::TIFF_PKB_FLOAT32 :
+	  case Rok4Format::TIFF_ZSTD_FLOAT32 :
 	    switch(spp) {
 	      case 1:
 		  bg[0] = -99999.0;
@@ -421,6 +593,7 @@ DataStream* Rok4Server::getMap ( Request* request ) {
 	  case Rok4Format::TIFF_ZIP_INT8 :
 	  case Rok4Format::TIFF_LZW_INT8 :
 	  case Rok4Format::TIFF_PKB_INT8 :
+	  case Rok4Format::TIFF_ZSTD_INT8 :
 	  default :
 	    switch(spp) {
 	      case 1:
@@ -446,18 +619,119 @@ DataStream* Rok4Server::getMap ( Request* request ) {
 
         if ( image == NULL ) {
             LOGGER_ERROR ( "Impossible de fusionner les images des differentes couches" );
-            return new SERDataStream ( new ServiceException ( "",OWS_NOAPPLICABLE_CODE,_ ( "Impossible de repondre a la requete" ),"wms" ) );
+            errorResp = new SERDataStream ( new ServiceException ( "",OWS_NOAPPLICABLE_CODE,_ ( "Impossible de repondre a la requete" ),"wms" ) );
+            return NULL;
         }
     }
+
+    return image;
+}
+
+int Rok4Server::getBandCount ( int width, int height ) {
+    if ( bandPool == NULL ) {
+        return 1;
+    }
+    // Des GetMap attendent déjà : le parallélisme entre requêtes suffit
+    if ( ! queues.empty() && queues[COST_MAP]->size() > 0 ) {
+        return 1;
+    }
+    long bands = std::min ( ( long ) height / BAND_MIN_HEIGHT, ( long ) width * height / BAND_MIN_PIXELS );
+    bands = std::min ( bands, ( long ) ( 1 + bandPool->getAvailableThreads() ) );
+    return std::max ( ( int ) bands, 1 );
+}
+
+const EncoderProfile* Rok4Server::getEncoderProfile ( std::string profileName, Layer* layer, bool& degraded ) {
+    degraded = false;
+    const EncoderProfile* profile = EncoderProfile::getDefault();
+    if ( ! profileName.empty() ) {
+        profile = EncoderProfile::get ( profileName );
+        if ( ! profile ) return NULL;
+    } else if ( ! layer->getEncoderProfile().empty() ) {
+        profile = EncoderProfile::get ( layer->getEncoderProfile() );
+    }
+    // Pic de charge : on échange du volume contre du temps de calcul
+    if ( degradeQueueDepth > 0 && ! queues.empty() && queues[COST_MAP]->size() >= ( size_t ) degradeQueueDepth ) {
+        LOGGER_DEBUG ( _ ( "Serveur charge : profil de compression " ) << EncoderProfile::getFastest()->name );
+        degraded = true;
+        return EncoderProfile::getFastest();
+    }
+    return profile;
+}
+
+DataStream* Rok4Server::getMap ( Request* request, bool* degraded ) {
+    std::vector<Layer*> layers;
+    BoundingBox<double> bbox ( 0.0, 0.0, 0.0, 0.0 );
+    int width, height;
+    CRS crs;
+    std::string format;
+    std::vector<Style*> styles;
+    std::map <std::string, std::string > format_option;
+
+    // Récupération des paramètres
+    DataStream* errorResp = request->getMapParam ( servicesConf, layerList, layers, bbox, width, height, crs, format ,styles, format_option );
+    if ( errorResp ) {
+        LOGGER_ERROR ( _ ( "Probleme dans les parametres de la requete getMap" ) );
+        return errorResp;
+    }
+
+    bool forced;
+    const EncoderProfile* profile = getEncoderProfile ( getParam ( format_option,"profile" ), layers.at ( 0 ), forced );
+    if ( ! profile ) {
+        return new SERDataStream ( new ServiceException ( "",OWS_INVALID_PARAMETER_VALUE,_ ( "Profil de compression " ) + getParam ( format_option,"profile" ) + _ ( " inconnu" ),"wms" ) );
+    }
+    if ( degraded ) {
+        *degraded = forced;
+    }
+
+    Rok4Format::eformat_data pyrType;
+    Image* image;
+    // Niveau de pyramide retenu pour chaque couche, commun à toutes les bandes
+    std::vector<std::string> levels ( layers.size() );
+    int bands = getBandCount ( width, height );
+
+    if ( bands <= 1 ) {
+        image = buildMapImage ( layers, styles, bbox, width, height, crs, format, levels, pyrType, errorResp );
+        if ( image == NULL ) {
+            return errorResp;
+        }
+    } else {
+        /* Chaque bande horizontale est une image indépendante, calculée par le pool de threads ;
+         * les tuiles décodées à la jonction de deux bandes sont partagées via la table de la requête */
+        TileTable* table = new TileTable();
+        TileTable::setCurrent ( table );
+
+        double resy = ( bbox.ymax - bbox.ymin ) / height;
+        std::vector<Image*> bandImages;
+        for ( int b = 0; b < bands; b++ ) {
+            int top = ( int ) ( ( long ) height * b / bands );
+            int bottom = ( int ) ( ( long ) height * ( b + 1 ) / bands );
+            BoundingBox<double> bandBBox ( bbox.xmin, ( b == bands - 1 ) ? bbox.ymin : bbox.ymax - bottom * resy,
+                                           bbox.xmax, bbox.ymax - top * resy );
+            Image* bandImage = buildMapImage ( layers, styles, bandBBox, width, bottom - top, crs, format, levels, pyrType, errorResp );
+            if ( bandImage == NULL ) {
+                for ( int j = 0; j < bandImages.size(); j++ ) {
+                    delete bandImages.at ( j );
+                }
+                TileTable::setCurrent ( NULL );
+                delete table;
+                return errorResp;
+            }
+            bandImages.push_back ( bandImage );
+        }
+        TileTable::setCurrent ( NULL );
+
+        LOGGER_DEBUG ( _ ( "GetMap calcule en " ) << bands << _ ( " bandes" ) );
+        image = new BandImage ( bandImages, bandPool, table );
+    }
     
     image->setCRS(crs);
     image->setBbox(bbox);
 
     if ( format=="image/png" ) {
         if ( layers.size() == 1 ) {
-            return new PNGEncoder ( image,styles.at ( 0 )->getPalette() );
+            return new PNGEncoder ( image,styles.at ( 0 )->getPalette(), profile );
         } else {
-            return new PNGEncoder ( image,NULL );
+            return new PNGEncoder ( image,NULL, profile );
         }
 
     } else if ( format == "image/tiff" || format == "image/geotiff" ) { // Handle compression option
@@ -469,50 +743,69 @@ DataStream* Rok4Server::getMap ( Request* request ) {
         case Rok4Format::TIFF_ZIP_FLOAT32 :
         case Rok4Format::TIFF_LZW_FLOAT32 :
         case Rok4Format::TIFF_PKB_FLOAT32 :
+        case Rok4Format::TIFF_ZSTD_FLOAT32 :
             if ( getParam ( format_option,"compression" ).compare ( "lzw" ) ==0 ) {
-                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_LZW_FLOAT32, isGeoTiff );
+                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_LZW_FLOAT32, isGeoTiff, profile );
             }
             if ( getParam ( format_option,"compression" ).compare ( "deflate" ) ==0 ) {
-                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_ZIP_FLOAT32, isGeoTiff );
+                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_ZIP_FLOAT32, isGeoTiff, profile );
             }
             if ( getParam ( format_option,"compression" ).compare ( "raw" ) ==0 ) {
-                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_RAW_FLOAT32, isGeoTiff );
+                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_RAW_FLOAT32, isGeoTiff, profile );
             }
             if ( getParam ( format_option,"compression" ).compare ( "packbits" ) ==0 ) {
-                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_PKB_FLOAT32, isGeoTiff );
+                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_PKB_FLOAT32, isGeoTiff, profile );
+            }
+            return TiffEncoder::getTiffEncoder ( image, pyrType, isGeoTiff, profile );
+        case Rok4Format::TIFF_RAW_UINT16 :
+        case Rok4Format::TIFF_ZIP_UINT16 :
+        case Rok4Format::TIFF_LZW_UINT16 :
+        case Rok4Format::TIFF_PKB_UINT16 :
+            if ( getParam ( format_option,"compression" ).compare ( "lzw" ) ==0 ) {
+                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_LZW_UINT16, isGeoTiff, profile );
+            }
+            if ( getParam ( format_option,"compression" ).compare ( "deflate" ) ==0 ) {
+                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_ZIP_UINT16, isGeoTiff, profile );
             }
-            return TiffEncoder::getTiffEncoder ( image, pyrType, isGeoTiff );
+            if ( getParam ( format_option,"compression" ).compare ( "raw" ) ==0 ) {
+                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_RAW_UINT16, isGeoTiff, profile );
+            }
+            if ( getParam ( format_option,"compression" ).compare ( "packbits" ) ==0 ) {
+                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_PKB_UINT16, isGeoTiff, profile );
+            }
+            return TiffEncoder::getTiffEncoder ( image, pyrType, isGeoTiff, profile );
         case Rok4Format::TIFF_RAW_INT8 :
         case Rok4Format::TIFF_ZIP_INT8 :
         case Rok4Format::TIFF_LZW_INT8 :
         case Rok4Format::TIFF_PKB_INT8 :
+        case Rok4Format::TIFF_ZSTD_INT8 :
             if ( getParam ( format_option,"compression" ).compare ( "lzw" ) ==0 ) {
-                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_LZW_INT8, isGeoTiff );
+                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_LZW_INT8, isGeoTiff, profile );
             }
             if ( getParam ( format_option,"compression" ).compare ( "deflate" ) ==0 ) {
-                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_ZIP_INT8, isGeoTiff );
+                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_ZIP_INT8, isGeoTiff, profile );
             }
             if ( getParam ( format_option,"compression" ).compare ( "raw" ) ==0 ) {
-                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_RAW_INT8, isGeoTiff );
+                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_RAW_INT8, isGeoTiff, profile );
             }
             if ( getParam ( format_option,"compression" ).compare ( "packbits" ) ==0 ) {
-                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_PKB_INT8, isGeoTiff );
+                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_PKB_INT8, isGeoTiff, profile );
             }
-            return TiffEncoder::getTiffEncoder ( image, pyrType, isGeoTiff );
+            return TiffEncoder::getTiffEncoder ( image, pyrType, isGeoTiff, profile );
         default:
             if ( getParam ( format_option,"compression" ).compare ( "lzw" ) ==0 ) {
-                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_LZW_INT8, isGeoTiff );
+                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_LZW_INT8, isGeoTiff, profile );
             }
             if ( getParam ( format_option,"compression" ).compare ( "deflate" ) ==0 ) {
-                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_ZIP_INT8, isGeoTiff );
+                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_ZIP_INT8, isGeoTiff, profile );
             }
             if ( getParam ( format_option,"compression" ).compare ( "packbits" ) ==0 ) {
-                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_PKB_INT8, isGeoTiff );
+                return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_PKB_INT8, isGeoTiff, profile );
             }
-            return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_RAW_INT8, isGeoTiff );
+            return TiffEncoder::getTiffEncoder ( image, Rok4Format::TIFF_RAW_INT8, isGeoTiff, profile );
         }
     } else if ( format == "image/jpeg" ) {
-        return new JPEGEncoder ( image );
+        return new JPEGEncoder ( image, profile );
     } else if ( format == "image/x-bil;bits=32" ) {
         return new BilEncoder ( image );
     }
@@ -560,7 +853,11 @@ void Rok4Server::processWMTS ( Request* request, FCGX_Request&  fcgxRequest ) {
     if ( request->request == "getcapabilities" ) {
         S.sendresponse ( WMTSGetCapabilities ( request ),&fcgxRequest );
     } else if ( request->request == "gettile" ) {
-        S.sendresponse ( getTile ( request ), &fcgxRequest );
+        if ( coalescer.isEnabled() ) {
+            processCoalesced ( request, fcgxRequest );
+        } else {
+            S.sendresponse ( getTile ( request ), &fcgxRequest );
+        }
     } else if ( request->request == "getversion" ) {
         S.sendresponse ( new SERDataStream ( new ServiceException ( "",OWS_OPERATION_NOT_SUPORTED, ( "L'operation " ) +request->request+_ ( " n'est pas prise en charge par ce serveur." ) + ROK4_INFO,"wmts" ) ),&fcgxRequest );
     } else if ( request->request == "" ) {
@@ -576,7 +873,18 @@ void Rok4Server::processWMS ( Request* request, FCGX_Request&  fcgxRequest ) {
         S.sendresponse ( WMSGetCapabilities ( request ),&fcgxRequest );
         //le map est présent pour une compatibilité avec le WMS 1.1.1
     } else if ( request->request == "getmap" || request->request == "map") {
-        S.sendresponse ( getMap ( request ), &fcgxRequest );
+        DataSource* cached = getCachedMap ( request );
+        if ( cached ) {
+            S.sendresponse ( cached, &fcgxRequest );
+        } else if ( coalescer.isEnabled() ) {
+            processCoalesced ( request, fcgxRequest );
+        } else if ( responseCache.isEnabled() ) {
+            bool degraded = false;
+            DataStream* stream = getMap ( request, &degraded );
+            S.sendresponse ( cacheMap ( request, stream, degraded ), &fcgxRequest );
+        } else {
+            S.sendresponse ( getMap ( request ), &fcgxRequest );
+        }
     } else if ( request->request == "getversion" ) {
         S.sendresponse ( new SERDataStream ( new ServiceException ( "",OWS_OPERATION_NOT_SUPORTED, ( "L'operation " ) +request->request+_ ( " n'est pas prise en charge par ce serveur." ) + ROK4_INFO,"wms" ) ),&fcgxRequest );
     } else if ( request->request == "" ) {
@@ -586,7 +894,178 @@ void Rok4Server::processWMS ( Request* request, FCGX_Request&  fcgxRequest ) {
     }
 }
 
+void Rok4Server::processCoalesced ( Request* request, FCGX_Request&  fcgxRequest ) {
+    std::string key;
+    RequestCoalescer::buildKey ( request, key );
+
+    bool leader;
+    CoalescedResponse* entry = coalescer.join ( key, leader );
+    if ( !leader && !coalescer.wait ( entry ) ) {
+        // Attente abandonnée : la requête est traitée indépendamment
+        if ( request->request == "gettile" ) {
+            S.sendresponse ( getTile ( request ), &fcgxRequest );
+        } else {
+            S.sendresponse ( getMap ( request ), &fcgxRequest );
+        }
+        return;
+    }
+
+    if ( leader ) {
+        // La réponse est partagée : la fermeture de la connexion du premier client ne doit pas l'interrompre
+        CancellationToken* token = CancellationToken::getCurrent();
+        if ( token ) {
+            token->watchConnection ( -1 );
+        }
+        // La réponse est utilisée par les autres threads après la fin de cette requête : elle est allouée dans le tas
+        MemoryArena* arena = MemoryArena::getCurrent();
+        MemoryArena::setCurrent ( NULL );
+        DataSource* response;
+        if ( request->request == "gettile" ) {
+            response = getTile ( request );
+        } else {
+            // La réponse doit être entièrement encodée pour être partagée
+            bool degraded = false;
+            DataStream* stream = getMap ( request, &degraded );
+            response = cacheMap ( request, stream, degraded );
+        }
+        bool shared = coalescer.publish ( entry, response );
+        MemoryArena::setCurrent ( arena );
+        if ( token ) {
+            token->watchConnection ( fcgxRequest.ipcFd );
+        }
+        if ( ! shared ) {
+            // Calcul interrompu : les suiveurs calculent leur propre réponse, celle-ci est remplacée par une erreur
+            coalescer.release ( entry );
+            S.sendresponse ( response, &fcgxRequest );
+            return;
+        }
+    }
+    S.sendresponse ( coalescer.share ( entry ), &fcgxRequest );
+}
+
+int Rok4Server::getMapCacheTTL ( Request* request, time_t& generation ) {
+    generation = 0;
+    std::map<std::string, std::string>::iterator itParam = request->params.find ( "layers" );
+    if ( itParam == request->params.end() || itParam->second.empty() ) {
+        return 0;
+    }
+    // Durée de vie la plus courte des couches demandées
+    int ttl = -1;
+    std::string layers = itParam->second;
+    size_t start = 0;
+    while ( start <= layers.size() ) {
+        size_t end = layers.find ( ',', start );
+        if ( end == std::string::npos ) {
+            end = layers.size();
+        }
+        std::map<std::string, Layer*>::iterator itLayer = layerList.find ( layers.substr ( start, end - start ) );
+        if ( itLayer == layerList.end() ) {
+            return 0;
+        }
+        int layerTTL = itLayer->second->getCacheTTL();
+        if ( ttl < 0 || layerTTL < ttl ) {
+            ttl = layerTTL;
+        }
+        // Génération la plus récente des pyramides demandées
+        time_t layerGeneration = itLayer->second->getDataPyramid()->getGeneration();
+        if ( layerGeneration > generation ) {
+            generation = layerGeneration;
+        }
+        start = end + 1;
+    }
+    return ttl;
+}
+
+DataSource* Rok4Server::getCachedMap ( Request* request ) {
+    std::string key;
+    time_t generation;
+    if ( !responseCache.isEnabled() || getMapCacheTTL ( request, generation ) <= 0 || !ResponseCache::buildKey ( request, key ) ) {
+        return NULL;
+    }
+    return responseCache.get ( key, generation );
+}
+
+DataSource* Rok4Server::cacheMap ( Request* request, DataStream* stream, bool degraded ) {
+    DataSource* response = new BufferedDataSource ( *stream );
+    delete stream;
+    std::string key;
+    int ttl;
+    time_t generation;
+    // Une réponse dont le calcul a été interrompu est incomplète, une réponse dégradée n'a pas le profil demandé
+    if ( responseCache.isEnabled() && !degraded && !CancellationToken::currentCancelled() && ( ttl = getMapCacheTTL ( request, generation ) ) > 0
+            && ResponseCache::buildKey ( request, key ) ) {
+        responseCache.add ( key, response, ttl, generation );
+    }
+    return response;
+}
+
+int Rok4Server::getRequestTimeout ( Request* request ) {
+    int timeout;
+    std::map<std::string, std::string>::iterator itParam;
+    if ( request->request == "gettile" ) {
+        timeout = getTileTimeout;
+        itParam = request->params.find ( "layer" );
+    } else if ( request->request == "getmap" || request->request == "map" ) {
+        timeout = getMapTimeout;
+        itParam = request->params.find ( "layers" );
+    } else {
+        return 0;
+    }
+    if ( itParam == request->params.end() ) {
+        return timeout;
+    }
+    // Délai le plus court des couches demandées qui en définissent un
+    int layersTimeout = 0;
+    std::string layers = itParam->second;
+    size_t start = 0;
+    while ( start < layers.size() ) {
+        size_t end = layers.find ( ',', start );
+        if ( end == std::string::npos ) {
+            end = layers.size();
+        }
+        std::map<std::string, Layer*>::iterator itLayer = layerList.find ( layers.substr ( start, end - start ) );
+        if ( itLayer != layerList.end() ) {
+            int layerTimeout = itLayer->second->getRequestTimeout();
+            if ( layerTimeout > 0 && ( layersTimeout == 0 || layerTimeout < layersTimeout ) ) {
+                layersTimeout = layerTimeout;
+            }
+        }
+        start = end + 1;
+    }
+    // Une couche ne peut que raccourcir le délai de l'opération
+    if ( layersTimeout > 0 && ( timeout == 0 || layersTimeout < timeout ) ) {
+        return layersTimeout;
+    }
+    return timeout;
+}
+
 void Rok4Server::processRequest ( Request * request, FCGX_Request&  fcgxRequest ) {
+    // Le jeton est consulté par la chaîne de traitement des images pour abandonner le calcul au plus tôt
+    CancellationToken token ( getRequestTimeout ( request ), fcgxRequest.ipcFd );
+    CancellationToken::setCurrent ( &token );
+    route ( request, fcgxRequest );
+    CancellationToken::setCurrent ( NULL );
+
+    // La réponse est envoyée et détruite : la mémoire de la requête est récupérée en une fois
+    MemoryArena* arena = MemoryArena::getCurrent();
+    if ( arena ) {
+        arena->reset();
+    }
+
+    if ( token.isCancelled() ) {
+        pthread_mutex_lock ( &cancellationMutex );
+        if ( token.isTimedOut() ) {
+            timedOutRequests++;
+            LOGGER_INFO ( _ ( "Delai de calcul depasse pour la requete " ) << request->request );
+        } else {
+            cancelledRequests++;
+            LOGGER_DEBUG ( _ ( "Connexion fermee par le client pendant la requete " ) << request->request );
+        }
+        pthread_mutex_unlock ( &cancellationMutex );
+    }
+}
+
+void Rok4Server::route ( Request * request, FCGX_Request&  fcgxRequest ) {
     if ( supportWMTS && request->service == "wmts" ) {
         processWMTS ( request, fcgxRequest );
         //Service is not mandatory in GetMap request in WMS 1.3.0 and GetFeatureInfo
@@ -57,8 +57,35 @@
 #include "Layer.h"
 #include "TileMatrixSet.h"
 #include "fcgiapp.h"
+#include "RequestCoalescer.h"
+#include "ResponseCache.h"
+#include "RequestQueue.h"
+#include "MemoryArena.h"
+#include "TaskPool.h"
+#include "EncoderProfile.h"
 #include <csignal>
 
+class Rok4Server;
+
+/**
+ * \~french
+ * \brief Contexte d'un thread de traitement d'une file de requêtes
+ * \~english
+ * \brief Context of a thread processing a requests queue
+ */
+struct WorkerContext {
+    /**
+     * \~french \brief Serveur traitant les requêtes
+     * \~english \brief Server processing the requests
+     */
+    Rok4Server* server;
+    /**
+     * \~french \brief File traitée
+     * \~english \brief Processed queue
+     */
+    RequestQueue* queue;
+};
+
 /**
  * \author Institut national de l'information géographique et forestière
  * \~french
@@ -148,6 +175,76 @@ private:
      * \~english \brief Error response in case data tiel is not found (http 404)
      */
     DataSource* notFoundError;
+    /**
+     * \~french \brief Regroupement des requêtes identiques simultanées
+     * \~english \brief Identical concurrent requests coalescing
+     */
+    RequestCoalescer coalescer;
+    /**
+     * \~french \brief Cache des réponses GetMap encodées
+     * \~english \brief Encoded GetMap responses cache
+     */
+    ResponseCache responseCache;
+    /**
+     * \~french \brief Files des requêtes acceptées, une par classe de coût, vide si les threads traitent directement les requêtes qu'ils acceptent
+     * \~english \brief Accepted requests queues, one per cost class, empty if threads directly process the requests they accept
+     */
+    std::vector<RequestQueue*> queues;
+    /**
+     * \~french \brief Contextes des threads de traitement, un par file
+     * \~english \brief Processing threads contexts, one per queue
+     */
+    std::vector<WorkerContext> workerContexts;
+    /**
+     * \~french \brief Threads de traitement des files
+     * \~english \brief Queues processing threads
+     */
+    std::vector<pthread_t> workers;
+    /**
+     * \~french \brief Délai en secondes indiqué aux clients dont la requête est refusée
+     * \~english \brief Delay in seconds given to clients whose request is refused
+     */
+    int retryAfter;
+    /**
+     * \~french \brief Délai maximal de calcul d'une réponse GetTile, en millisecondes, 0 pour ne pas limiter
+     * \~english \brief Maximal GetTile response computation delay, in milliseconds, 0 for no limit
+     */
+    int getTileTimeout;
+    /**
+     * \~french \brief Délai maximal de calcul d'une réponse GetMap, en millisecondes, 0 pour ne pas limiter
+     * \~english \brief Maximal GetMap response computation delay, in milliseconds, 0 for no limit
+     */
+    int getMapTimeout;
+    /**
+     * \~french \brief Nombre de requêtes abandonnées suite à la fermeture de la connexion
+     * \~english \brief Number of requests given up because the connection was closed
+     */
+    int cancelledRequests;
+    /**
+     * \~french \brief Nombre de requêtes abandonnées suite au dépassement de leur délai
+     * \~english \brief Number of requests given up because their delay was exceeded
+     */
+    int timedOutRequests;
+    /**
+     * \~french \brief Protection des compteurs de requêtes abandonnées
+     * \~english \brief Given up requests counters protection
+     */
+    pthread_mutex_t cancellationMutex;
+    /**
+     * \~french \brief Taille des blocs de l'arène mémoire de chaque thread, en octets, 0 pour allouer dans le tas
+     * \~english \brief Memory arena blocks size of each thread, in bytes, 0 to allocate in the heap
+     */
+    size_t arenaSize;
+    /**
+     * \~french \brief Threads de calcul des bandes horizontales d'un GetMap, NULL si un GetMap est calculé par un seul thread
+     * \~english \brief Threads computing the horizontal bands of a GetMap, NULL if a GetMap is computed by a single thread
+     */
+    TaskPool* bandPool;
+    /**
+     * \~french \brief Nombre de GetMap en attente à partir duquel le profil de compression le plus rapide est utilisé, 0 pour désactiver
+     * \~english \brief Number of waiting GetMap from which the fastest compression profile is used, 0 to disable
+     */
+    int degradeQueueDepth;
 
     /**
      * \~french
@@ -160,6 +257,49 @@ private:
      * \return true if present
      */
     static void* thread_loop ( void* arg );
+    /**
+     * \~french
+     * \brief Boucle exécutée par chaque thread d'écoute quand les requêtes sont réparties dans des files
+     * \details Les requêtes acceptées sont placées dans la file de leur classe de coût, ou refusées avec un code HTTP 503 si la file est saturée.
+     * \param[in] arg pointeur vers l'instance de Rok4Server
+     * \~english
+     * \brief Loop executed by each listening thread when requests are dispatched in queues
+     * \details Accepted requests are put in their cost class queue, or refused with a HTTP 503 code if the queue is saturated.
+     * \param[in] arg pointer to the Rok4Server instance
+     */
+    static void* accept_loop ( void* arg );
+    /**
+     * \~french
+     * \brief Boucle exécutée par chaque thread de traitement d'une file
+     * \param[in] arg pointeur vers le WorkerContext du thread
+     * \~english
+     * \brief Loop executed by each thread processing a queue
+     * \param[in] arg pointer to the thread's WorkerContext
+     */
+    static void* worker_loop ( void* arg );
+    /**
+     * \~french
+     * \brief Lit et analyse une requête FCGI acceptée
+     * \return la requête, à libérer par l'appelant
+     * \~english
+     * \brief Read and parse an accepted FCGI request
+     * \return the request, to be freed by the caller
+     */
+    Request* readRequest ( FCGX_Request& fcgxRequest );
+    /**
+     * \~french
+     * \brief Refuse une requête avec un code HTTP 503 et un en-tête Retry-After, puis la termine
+     * \~english
+     * \brief Refuse a request with a HTTP 503 code and a Retry-After header, then finish it
+     */
+    void rejectRequest ( QueuedRequest& item );
+    /**
+     * \~french
+     * \brief Termine une requête mise en file et libère ses ressources
+     * \~english
+     * \brief Finish a queued request and free its resources
+     */
+    void finishRequest ( QueuedRequest& item );
     /**
      * \~french
      * \brief Donne le nombre de chiffres après la virgule
@@ -227,13 +367,58 @@ private:
      * \~french
      * \brief Traitement d'une requête GetMap
      * \param[in] request représentation de la requête
+     * \param[out] degraded vrai si l'image est encodée avec le profil imposé en cas de surcharge, peut être NULL
      * \return image demandé ou un message d'erreur
      * \~english
      * \brief Process a GetMap request
      * \param[in] request request representation
+     * \param[out] degraded true if the image is encoded with the profile forced under overload, can be NULL
      * \return requested image or an error message
      */
-    DataStream* getMap ( Request* request );
+    DataStream* getMap ( Request* request, bool* degraded = NULL );
+    /**
+     * \~french
+     * \brief Construit l'image fusionnée et stylée des couches d'un GetMap sur une emprise
+     * \param[in,out] levels niveau de pyramide de chaque couche, choisi à la première construction puis réutilisé
+     * \param[out] pyrType format de sortie déduit de la couche de fond
+     * \param[out] errorResp message d'erreur si l'image n'a pu être construite
+     * \return l'image, NULL en cas d'erreur
+     * \~english
+     * \brief Build the merged and styled image of the GetMap layers over an extent
+     * \param[in,out] levels pyramid level of each layer, chosen on the first build then reused
+     * \param[out] pyrType output format deduced from the background layer
+     * \param[out] errorResp error message if the image could not be built
+     * \return the image, NULL on error
+     */
+    Image* buildMapImage ( std::vector<Layer*>& layers, std::vector<Style*>& styles, BoundingBox<double> bbox,
+                           int width, int height, CRS& crs, std::string& format, std::vector<std::string>& levels,
+                           Rok4Format::eformat_data& pyrType, DataStream*& errorResp );
+    /**
+     * \~french
+     * \brief Nombre de bandes horizontales pour calculer un GetMap
+     * \details Dépend de la taille de l'image demandée, des threads de bande libres et des GetMap en attente.
+     * \~english
+     * \brief Number of horizontal bands used to compute a GetMap
+     * \details Depends on the requested image size, the idle band threads and the waiting GetMap.
+     */
+    int getBandCount ( int width, int height );
+    /**
+     * \~french
+     * \brief Profil de compression d'une réponse GetMap
+     * \details Par ordre de priorité : l'option de format "profile", le profil de la première couche, le profil par défaut. Le profil le plus rapide est imposé quand trop de GetMap sont en attente.
+     * \param[in] profileName profil demandé (option de format), vide si absent
+     * \param[in] layer première couche demandée
+     * \param[out] degraded vrai si le profil le plus rapide est imposé
+     * \return le profil, NULL si le profil demandé est inconnu
+     * \~english
+     * \brief Compression profile of a GetMap response
+     * \details By priority order : the "profile" format option, the first layer profile, the default profile. The fastest profile is forced when too many GetMap are waiting.
+     * \param[in] profileName requested profile (format option), empty if missing
+     * \param[in] layer first requested layer
+     * \param[out] degraded true if the fastest profile is forced
+     * \return the profile, NULL if the requested profile is unknown
+     */
+    const EncoderProfile* getEncoderProfile ( std::string profileName, Layer* layer, bool& degraded );
     /**
      * \~french
      * \brief Traitement d'une requête GetCapabilities WMS
@@ -257,10 +442,79 @@ private:
      */
     void        processWMTS ( Request *request, FCGX_Request&  fcgxRequest );
     /**
-     * \~french Sépare les requêtes de type WMS et WMTS
-     * \~english Route WMS and WMTS request
+     * \~french Traite une requête en limitant son délai de calcul et en l'abandonnant si le client ferme la connexion
+     * \~english Process a request, limiting its computation delay and giving it up if the client closes the connection
      */
     void        processRequest ( Request *request, FCGX_Request&  fcgxRequest );
+    /**
+     * \~french Sépare les requêtes de type WMS et WMTS, sans contrôle de leur délai
+     * \~english Route WMS and WMTS request, without checking their delay
+     */
+    void        route ( Request *request, FCGX_Request&  fcgxRequest );
+    /**
+     * \~french
+     * \brief Crée l'arène mémoire du thread courant et l'y associe
+     * \return l'arène, NULL si les requêtes sont allouées dans le tas
+     * \~english
+     * \brief Create the current thread memory arena and bind it
+     * \return the arena, NULL if requests are allocated in the heap
+     */
+    MemoryArena* createArena();
+    /**
+     * \~french
+     * \brief Traite une requête GetMap ou GetTile en la regroupant avec les requêtes identiques simultanées
+     * \details Seule la première requête est calculée, les suivantes renvoient sa réponse encodée.
+     * \~english
+     * \brief Process a GetMap or GetTile request, merging it with identical concurrent requests
+     * \details Only the first request is processed, the next ones send its encoded response.
+     */
+    void        processCoalesced ( Request *request, FCGX_Request&  fcgxRequest );
+    /**
+     * \~french
+     * \brief Durée de vie dans le cache de la réponse à une requête GetMap
+     * \param[out] generation génération la plus récente des pyramides demandées
+     * \return durée en secondes, la plus courte des couches demandées, 0 si la réponse ne doit pas être mise en cache
+     * \~english
+     * \brief Time to live in the cache of a GetMap response
+     * \param[out] generation latest generation of the requested pyramids
+     * \return time in seconds, the shortest of the requested layers, 0 if the response must not be cached
+     */
+    int         getMapCacheTTL ( Request *request, time_t& generation );
+    /**
+     * \~french
+     * \brief Recherche la réponse à une requête GetMap dans le cache
+     * \return la réponse, NULL si elle n'est pas dans le cache
+     * \~english
+     * \brief Look for a GetMap response in the cache
+     * \return the response, NULL if not in the cache
+     */
+    DataSource* getCachedMap ( Request *request );
+    /**
+     * \~french
+     * \brief Encode entièrement une réponse GetMap et l'ajoute au cache si elle est admissible
+     * \details Une réponse encodée avec le profil imposé en cas de surcharge n'est pas mise en cache : elle ne correspond pas au profil demandé.
+     * \param[in] stream réponse à encoder, libérée par la fonction
+     * \param[in] degraded vrai si la réponse est encodée avec le profil imposé en cas de surcharge
+     * \return la réponse encodée
+     * \~english
+     * \brief Fully encode a GetMap response and add it in the cache if admissible
+     * \details A response encoded with the profile forced under overload is not cached : it does not match the requested profile.
+     * \param[in] stream response to encode, freed by the function
+     * \param[in] degraded true if the response is encoded with the profile forced under overload
+     * \return the encoded response
+     */
+    DataSource* cacheMap ( Request *request, DataStream* stream, bool degraded );
+    /**
+     * \~french
+     * \brief Délai maximal de calcul de la réponse à une requête
+     * \details Le délai le plus court défini par les couches demandées remplace celui de l'opération s'il est plus court.
+     * \return délai en millisecondes, 0 pour ne pas limiter
+     * \~english
+     * \brief Maximal computation delay of a request response
+     * \details The shortest delay defined by the requested layers replaces the operation one if it is shorter.
+     * \return delay in milliseconds, 0 for no limit
+     */
+    int         getRequestTimeout ( Request *request );
 
 public:
     /**
@@ -417,11 +671,38 @@ public:
             return supportWMS ;
     }
 
+    /**
+     * \~french
+     * \brief Retourne le gestionnaire de regroupement des requêtes
+     * \~english
+     * \brief Return the requests coalescing manager
+     */
+    RequestCoalescer& getCoalescer() {
+        return coalescer;
+    }
+
+    /**
+     * \~french
+     * \brief Retourne le cache des réponses GetMap
+     * \~english
+     * \brief Return the GetMap responses cache
+     */
+    ResponseCache& getResponseCache() {
+        return responseCache;
+    }
+
     /**
      * \brief Construction du serveur
      */
     Rok4Server ( int nbThread, ServicesConf& servicesConf, std::map<std::string,Layer*> &layerList,
-                 std::map<std::string,TileMatrixSet*> &tmsList, std::map<std::string,Style*> &styleList, std::string socket, int backlog, bool supportWMTS = true, bool supportWMS = true );
+                 std::map<std::string,TileMatrixSet*> &tmsList, std::map<std::string,Style*> &styleList, std::string socket, int backlog, bool supportWMTS = true, bool supportWMS = true,
+                 bool requestCoalescing = false, int coalescingTimeout = 0, int responseCacheSize = 0,
+                 int responseCacheObjectSize = 0, std::string responseCacheDir = "", int responseCacheDiskSize = 0,
+                 int tileThreads = 0, int mapThreads = 0, int otherThreads = 0, int queueSize = DEFAULT_QUEUE_SIZE,
+                 int queueTimeout = DEFAULT_QUEUE_TIMEOUT, int retryAfter = DEFAULT_RETRY_AFTER,
+                 int getTileTimeout = DEFAULT_REQUEST_TIMEOUT, int getMapTimeout = DEFAULT_REQUEST_TIMEOUT,
+                 int arenaSize = 0, int bandThreads = DEFAULT_MAP_BAND_THREADS,
+                 int degradeQueueDepth = DEFAULT_ENCODER_DEGRADE_QUEUE_DEPTH );
     /**
      * \~french
      * \brief Destructeur par défaut
@@ -85,6 +85,10 @@ std::string ServiceException::getCodeAsString ( ExceptionCode code ) {
         return "TileOutOfRange" ;
     case HTTP_NOT_FOUND:
         return "Not Found" ;
+    case HTTP_SERVICE_UNAVAILABLE:
+        return "ServiceUnavailable" ;
+    case HTTP_GATEWAY_TIMEOUT:
+        return "GatewayTimeout" ;
     default:
         return "" ;
     }
@@ -113,6 +117,10 @@ int ServiceException::getCodeAsStatusCode ( ExceptionCode code ) {
         return 501 ;
     case HTTP_NOT_FOUND:
         return 404 ;
+    case HTTP_SERVICE_UNAVAILABLE:
+        return 503 ;
+    case HTTP_GATEWAY_TIMEOUT:
+        return 504 ;
     default:
         return 200 ;
     }
@@ -130,8 +138,12 @@ std::string ServiceException::getStatusCodeAsReasonPhrase ( int statusCode ) {
         return "Internal server error" ;
     case 501 :
         return "Not implemented" ;
-    default : "No reason"
-        ;
+    case 503 :
+        return "Service Unavailable" ;
+    case 504 :
+        return "Gateway Timeout" ;
+    default :
+        return "No reason" ;
     }
 }
 
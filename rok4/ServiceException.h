@@ -141,7 +141,17 @@ typedef enum {
      * \~french Implémentation de l'erreur HTTP 404
      * \~english HTTP 404 implementation
      */
-    HTTP_NOT_FOUND = 16
+    HTTP_NOT_FOUND = 16,
+    /**
+     * \~french Implémentation de l'erreur HTTP 503, le serveur est surchargé
+     * \~english HTTP 503 implementation, the server is overloaded
+     */
+    HTTP_SERVICE_UNAVAILABLE = 17,
+    /**
+     * \~french Implémentation de l'erreur HTTP 504, le délai de traitement de la requête est dépassé
+     * \~english HTTP 504 implementation, the request processing delay is exceeded
+     */
+    HTTP_GATEWAY_TIMEOUT = 18
 
 } ExceptionCode;
 
@@ -0,0 +1,109 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include "ConfLoader.h"
+#include "Level.h"
+
+class CppUnitConfLoaderPyramid : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE ( CppUnitConfLoaderPyramid );
+    CPPUNIT_TEST ( contentList );
+    CPPUNIT_TEST ( contentListOutOfLimits );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    static Level* createLevel ( std::string id, uint32_t maxTile ) {
+        TileMatrix tm ( id, 1., 0., 0., 256, 256, 1000, 1000 );
+        return new Level ( tm, 3, "/data/PYR/IMAGE/" + id, 16, 16, maxTile, 0, maxTile, 0, 2, Rok4Format::TIFF_JPG_INT8, "" );
+    }
+
+    static void writeList ( const char* filename ) {
+        std::ofstream list ( filename );
+        list << "0=/data/PYR\n1=/data/OLD\n#\n";
+        list << "0/IMAGE/12/00/01/23.tif\n";
+        list << "1/IMAGE/12/00/00/00.tif\n";
+        list << "0/NODATA/12/nd.tif\n";
+        list << "0/IMAGE/14/00/00/11.tif\n";
+        list.close();
+    }
+
+public:
+    void contentList() {
+        char filename[] = "CppUnitConfLoaderPyramid.list";
+        writeList ( filename );
+
+        std::map<std::string, Level*> levels;
+        levels["12"] = createLevel ( "12", 999 );
+        levels["13"] = createLevel ( "13", 999 );
+        CPPUNIT_ASSERT ( ConfLoader::loadContentList ( filename, levels ) );
+        remove ( filename );
+
+        // La dalle 00/01/23 est la dalle (2, 39)
+        CPPUNIT_ASSERT_EQUAL ( std::string ( "/data/PYR/IMAGE/12/00/01/23.tif" ), levels["12"]->getFilePath ( 2 * 16, 39 * 16 ) );
+        CPPUNIT_ASSERT ( levels["12"]->isSlabPresent ( 2 * 16 + 5, 39 * 16 + 15 ) );
+        CPPUNIT_ASSERT ( levels["12"]->isSlabPresent ( 3, 4 ) );
+        CPPUNIT_ASSERT ( ! levels["12"]->isSlabPresent ( 16, 0 ) );
+        CPPUNIT_ASSERT ( ! levels["12"]->isSlabPresent ( 2 * 16, 40 * 16 ) );
+
+        // Aucune dalle listée pour le niveau 13 : pas de carte
+        CPPUNIT_ASSERT ( levels["13"]->isSlabPresent ( 16, 0 ) );
+
+        delete levels["12"];
+        delete levels["13"];
+    }
+
+    void contentListOutOfLimits() {
+        char filename[] = "CppUnitConfLoaderPyramid.list";
+        writeList ( filename );
+
+        // La dalle (2, 39) est hors des TMSLimits : la carte n'est pas utilisée
+        std::map<std::string, Level*> levels;
+        levels["12"] = createLevel ( "12", 100 );
+        CPPUNIT_ASSERT ( ConfLoader::loadContentList ( filename, levels ) );
+        remove ( filename );
+        CPPUNIT_ASSERT ( levels["12"]->isSlabPresent ( 16, 0 ) );
+
+        delete levels["12"];
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitConfLoaderPyramid );
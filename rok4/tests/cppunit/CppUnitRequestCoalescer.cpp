@@ -0,0 +1,193 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <cstring>
+
+#include "RequestCoalescer.h"
+#include "Message.h"
+#include "CancellationToken.h"
+
+class CppUnitRequestCoalescer : public CPPUNIT_NS::TestFixture {
+
+    CPPUNIT_TEST_SUITE ( CppUnitRequestCoalescer );
+
+    CPPUNIT_TEST ( keys );
+    CPPUNIT_TEST ( shareResponse );
+    CPPUNIT_TEST ( waitTimeout );
+    CPPUNIT_TEST ( cancelledLeader );
+
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    Request* buildRequest ( std::string query );
+
+public:
+    void setUp();
+    void keys();
+    void shareResponse();
+    void waitTimeout();
+    void cancelledLeader();
+    void tearDown();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitRequestCoalescer );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION ( CppUnitRequestCoalescer, "CppUnitRequestCoalescer" );
+
+void CppUnitRequestCoalescer::setUp() {
+
+}
+
+Request* CppUnitRequestCoalescer::buildRequest ( std::string query ) {
+    char strquery[1024];
+    char hostName[] = "localhost";
+    char path[] = "/rok4";
+    strncpy ( strquery, query.c_str(), sizeof ( strquery ) );
+    return new Request ( strquery, hostName, path, NULL );
+}
+
+void CppUnitRequestCoalescer::keys() {
+    std::string key1, key2, key3;
+
+    Request* r1 = buildRequest ( "SERVICE=WMS&REQUEST=GetMap&VERSION=1.3.0&LAYERS=ORTHO&STYLES=&CRS=EPSG:2154&BBOX=600000,6800000,601000,6801000&WIDTH=256&HEIGHT=256&FORMAT=image/png" );
+    Request* r2 = buildRequest ( "request=getmap&width=0256&format=image/png&service=wms&version=1.3.0&layers=ORTHO&styles=&crs=EPSG:2154&height=256&bbox=600000.0,6800000.00,601000,6801000" );
+    Request* r3 = buildRequest ( "SERVICE=WMS&REQUEST=GetMap&VERSION=1.3.0&LAYERS=ORTHO&STYLES=&CRS=EPSG:2154&BBOX=600000,6800000,601000,6801000&WIDTH=256&HEIGHT=256&FORMAT=image/jpeg" );
+    CPPUNIT_ASSERT_MESSAGE ( "GetMap key", RequestCoalescer::buildKey ( r1, key1 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "GetMap key", RequestCoalescer::buildKey ( r2, key2 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "GetMap key", RequestCoalescer::buildKey ( r3, key3 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "Normalized GetMap keys", key1 == key2 );
+    CPPUNIT_ASSERT_MESSAGE ( "Different formats", key1 != key3 );
+    delete r1;
+    delete r2;
+    delete r3;
+
+    r1 = buildRequest ( "SERVICE=WMTS&REQUEST=GetTile&VERSION=1.0.0&LAYER=ORTHO&STYLE=normal&TILEMATRIXSET=PM&TILEMATRIX=12&TILEROW=1500&TILECOL=2000&FORMAT=image/jpeg" );
+    r2 = buildRequest ( "SERVICE=WMTS&REQUEST=GetTile&VERSION=1.0.0&LAYER=ORTHO&STYLE=normal&TILEMATRIXSET=PM&TILEMATRIX=12&TILEROW=1500&TILECOL=2001&FORMAT=image/jpeg" );
+    r3 = buildRequest ( "SERVICE=WMTS&REQUEST=GetTile&VERSION=1.0.0&LAYER=ORTHO&STYLE=normal&TILEMATRIXSET=PM&TILEMATRIX=12&TILEROW=1500&TILECOL=2000&FORMAT=image/jpeg&NODATAASHTTPSTATUS=1" );
+    CPPUNIT_ASSERT_MESSAGE ( "GetTile key", RequestCoalescer::buildKey ( r1, key1 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "GetTile key", RequestCoalescer::buildKey ( r2, key2 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "GetTile key", RequestCoalescer::buildKey ( r3, key3 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "Different tiles", key1 != key2 );
+    CPPUNIT_ASSERT_MESSAGE ( "Different nodata behaviour", key1 != key3 );
+    delete r1;
+    delete r2;
+    delete r3;
+
+    r1 = buildRequest ( "SERVICE=WMTS&REQUEST=GetCapabilities" );
+    CPPUNIT_ASSERT_MESSAGE ( "GetCapabilities is not coalesced", !RequestCoalescer::buildKey ( r1, key1 ) );
+    delete r1;
+}
+
+void CppUnitRequestCoalescer::shareResponse() {
+    RequestCoalescer coalescer ( true, 1000 );
+    bool leader1, leader2;
+
+    CoalescedResponse* e1 = coalescer.join ( "key", leader1 );
+    CoalescedResponse* e2 = coalescer.join ( "key", leader2 );
+    CPPUNIT_ASSERT_MESSAGE ( "First request is leader", leader1 );
+    CPPUNIT_ASSERT_MESSAGE ( "Second request is follower", !leader2 );
+    CPPUNIT_ASSERT_MESSAGE ( "Same shared response", e1 == e2 );
+
+    coalescer.publish ( e1, new MessageDataSource ( "response", "text/plain" ) );
+    CPPUNIT_ASSERT_MESSAGE ( "Published response", coalescer.wait ( e2 ) );
+
+    DataSource* s1 = coalescer.share ( e1 );
+    DataSource* s2 = coalescer.share ( e2 );
+    size_t size1, size2;
+    const uint8_t* d1 = s1->getData ( size1 );
+    const uint8_t* d2 = s2->getData ( size2 );
+    CPPUNIT_ASSERT_MESSAGE ( "Same data", d1 == d2 && size1 == 8 && size2 == 8 );
+    CPPUNIT_ASSERT_MESSAGE ( "Same type", s2->getType() == "text/plain" );
+    delete s1;
+    delete s2;
+
+    // La réponse publiée n'est plus regroupée
+    CoalescedResponse* e3 = coalescer.join ( "key", leader1 );
+    CPPUNIT_ASSERT_MESSAGE ( "New leader after publication", leader1 );
+    coalescer.publish ( e3, new MessageDataSource ( "response", "text/plain" ) );
+    coalescer.release ( e3 );
+
+    CPPUNIT_ASSERT_MESSAGE ( "Leaders count", coalescer.getLeaders() == 2 );
+    CPPUNIT_ASSERT_MESSAGE ( "Followers count", coalescer.getFollowers() == 1 );
+    CPPUNIT_ASSERT_MESSAGE ( "Fallbacks count", coalescer.getFallbacks() == 0 );
+}
+
+void CppUnitRequestCoalescer::waitTimeout() {
+    RequestCoalescer coalescer ( true, 10 );
+    bool leader1, leader2;
+
+    CoalescedResponse* e1 = coalescer.join ( "key", leader1 );
+    CoalescedResponse* e2 = coalescer.join ( "key", leader2 );
+    CPPUNIT_ASSERT_MESSAGE ( "Wait timeout", !coalescer.wait ( e2 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "Fallbacks count", coalescer.getFallbacks() == 1 );
+
+    coalescer.publish ( e1, new MessageDataSource ( "response", "text/plain" ) );
+    coalescer.release ( e1 );
+}
+
+void CppUnitRequestCoalescer::cancelledLeader() {
+    RequestCoalescer coalescer ( true, 1000 );
+    bool leader1, leader2;
+
+    CoalescedResponse* e1 = coalescer.join ( "key", leader1 );
+    CoalescedResponse* e2 = coalescer.join ( "key", leader2 );
+
+    // Le meneur a dépassé son échéance : sa réponse tronquée n'est pas partagée
+    CancellationToken token;
+    token.cancel();
+    CancellationToken::setCurrent ( &token );
+    DataSource* response = new MessageDataSource ( "truncated", "text/plain" );
+    CPPUNIT_ASSERT_MESSAGE ( "Cancelled response not published", !coalescer.publish ( e1, response ) );
+    CancellationToken::setCurrent ( NULL );
+    coalescer.release ( e1 );
+    delete response;
+
+    CPPUNIT_ASSERT_MESSAGE ( "Follower falls back", !coalescer.wait ( e2 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "Fallbacks count", coalescer.getFallbacks() == 1 && coalescer.getFollowers() == 0 );
+
+    // Les requêtes suivantes ne rejoignent pas le calcul interrompu
+    CoalescedResponse* e3 = coalescer.join ( "key", leader1 );
+    CPPUNIT_ASSERT_MESSAGE ( "New leader after failure", leader1 );
+    coalescer.publish ( e3, new MessageDataSource ( "response", "text/plain" ) );
+    coalescer.release ( e3 );
+}
+
+void CppUnitRequestCoalescer::tearDown() {
+
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <cstring>
+#include <unistd.h>
+
+#include "RequestQueue.h"
+
+class CppUnitRequestQueue : public CPPUNIT_NS::TestFixture {
+
+    CPPUNIT_TEST_SUITE ( CppUnitRequestQueue );
+
+    CPPUNIT_TEST ( costs );
+    CPPUNIT_TEST ( capacity );
+    CPPUNIT_TEST ( deadline );
+    CPPUNIT_TEST ( closing );
+
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    Request* buildRequest ( std::string query );
+    QueuedRequest item;
+
+public:
+    void setUp();
+    void costs();
+    void capacity();
+    void deadline();
+    void closing();
+    void tearDown();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitRequestQueue );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION ( CppUnitRequestQueue, "CppUnitRequestQueue" );
+
+void CppUnitRequestQueue::setUp() {
+    item.fcgxRequest = NULL;
+    item.request = NULL;
+}
+
+Request* CppUnitRequestQueue::buildRequest ( std::string query ) {
+    char strquery[1024];
+    char hostName[] = "localhost";
+    char path[] = "/rok4";
+    strncpy ( strquery, query.c_str(), sizeof ( strquery ) );
+    return new Request ( strquery, hostName, path, NULL );
+}
+
+void CppUnitRequestQueue::costs() {
+    Request* request = buildRequest ( "SERVICE=WMTS&REQUEST=GetTile&LAYER=ORTHO" );
+    CPPUNIT_ASSERT_MESSAGE ( "GetTile", RequestQueue::getCost ( request ) == COST_TILE );
+    delete request;
+    request = buildRequest ( "SERVICE=WMS&REQUEST=GetMap&LAYERS=ORTHO" );
+    CPPUNIT_ASSERT_MESSAGE ( "GetMap", RequestQueue::getCost ( request ) == COST_MAP );
+    delete request;
+    request = buildRequest ( "SERVICE=WMS&REQUEST=GetCapabilities" );
+    CPPUNIT_ASSERT_MESSAGE ( "GetCapabilities", RequestQueue::getCost ( request ) == COST_OTHER );
+    delete request;
+}
+
+void CppUnitRequestQueue::capacity() {
+    RequestQueue queue ( "test", 2, 1, 0 );
+    Request* first = buildRequest ( "REQUEST=first" );
+    Request* second = buildRequest ( "REQUEST=second" );
+
+    item.request = first;
+    CPPUNIT_ASSERT_MESSAGE ( "First accepted", queue.push ( item ) );
+    item.request = second;
+    CPPUNIT_ASSERT_MESSAGE ( "Second accepted", queue.push ( item ) );
+    CPPUNIT_ASSERT_MESSAGE ( "Queue full", !queue.push ( item ) );
+    CPPUNIT_ASSERT_MESSAGE ( "Size", queue.size() == 2 );
+
+    bool late;
+    CPPUNIT_ASSERT_MESSAGE ( "Pop", queue.pop ( item, late ) && !late );
+    CPPUNIT_ASSERT_MESSAGE ( "FIFO", item.request == first );
+    CPPUNIT_ASSERT_MESSAGE ( "Room again", queue.push ( item ) );
+    CPPUNIT_ASSERT_MESSAGE ( "Counters", queue.getAccepted() == 3 && queue.getRejected() == 1 );
+
+    delete first;
+    delete second;
+}
+
+void CppUnitRequestQueue::deadline() {
+    RequestQueue queue ( "test", 10, 2, 50 );
+    bool late;
+
+    // Attente estimée : 2 requêtes par thread de 20 ms, puis celle-ci
+    queue.served ( 20 );
+    CPPUNIT_ASSERT_MESSAGE ( "1", queue.push ( item ) );
+    CPPUNIT_ASSERT_MESSAGE ( "2", queue.push ( item ) );
+    CPPUNIT_ASSERT_MESSAGE ( "3", queue.push ( item ) );
+    CPPUNIT_ASSERT_MESSAGE ( "4", queue.push ( item ) );
+    CPPUNIT_ASSERT_MESSAGE ( "Estimated wait too long", !queue.push ( item ) );
+
+    usleep ( 60000 );
+    CPPUNIT_ASSERT_MESSAGE ( "Late request", queue.pop ( item, late ) && late );
+    CPPUNIT_ASSERT_MESSAGE ( "Expired counter", queue.getExpired() == 1 );
+}
+
+void CppUnitRequestQueue::closing() {
+    RequestQueue queue ( "test", 10, 1, 0 );
+    bool late;
+
+    queue.push ( item );
+    queue.close();
+    CPPUNIT_ASSERT_MESSAGE ( "Closed queue refuses", !queue.push ( item ) );
+    CPPUNIT_ASSERT_MESSAGE ( "Remaining request processed", queue.pop ( item, late ) );
+    CPPUNIT_ASSERT_MESSAGE ( "Closed and empty", !queue.pop ( item, late ) );
+}
+
+void CppUnitRequestQueue::tearDown() {
+
+}
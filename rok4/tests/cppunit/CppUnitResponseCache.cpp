@@ -0,0 +1,224 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "ResponseCache.h"
+#include "Message.h"
+#include "ServiceException.h"
+
+class CppUnitResponseCache : public CPPUNIT_NS::TestFixture {
+
+    CPPUNIT_TEST_SUITE ( CppUnitResponseCache );
+
+    CPPUNIT_TEST ( keys );
+    CPPUNIT_TEST ( admission );
+    CPPUNIT_TEST ( eviction );
+    CPPUNIT_TEST ( diskTier );
+    CPPUNIT_TEST ( generation );
+
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    Request* buildRequest ( std::string query );
+    std::string readResponse ( DataSource* response );
+
+public:
+    void setUp();
+    void keys();
+    void admission();
+    void eviction();
+    void diskTier();
+    void generation();
+    void tearDown();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitResponseCache );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION ( CppUnitResponseCache, "CppUnitResponseCache" );
+
+void CppUnitResponseCache::setUp() {
+
+}
+
+Request* CppUnitResponseCache::buildRequest ( std::string query ) {
+    char strquery[1024];
+    char hostName[] = "localhost";
+    char path[] = "/rok4";
+    strncpy ( strquery, query.c_str(), sizeof ( strquery ) );
+    return new Request ( strquery, hostName, path, NULL );
+}
+
+std::string CppUnitResponseCache::readResponse ( DataSource* response ) {
+    size_t size;
+    const uint8_t* data = response->getData ( size );
+    std::string content ( ( const char* ) data, size );
+    delete response;
+    return content;
+}
+
+void CppUnitResponseCache::keys() {
+    std::string key1, key2, key3;
+
+    // Pixel de 3.90625 m : les bbox décalées de moins d'un dixième de pixel sont confondues
+    Request* r1 = buildRequest ( "SERVICE=WMS&REQUEST=GetMap&VERSION=1.3.0&LAYERS=ORTHO&STYLES=&CRS=EPSG:2154&BBOX=600000,6800000,601000,6801000&WIDTH=256&HEIGHT=256&FORMAT=image/png" );
+    Request* r2 = buildRequest ( "SERVICE=WMS&REQUEST=GetMap&VERSION=1.3.0&LAYERS=ORTHO&STYLES=&CRS=EPSG:2154&BBOX=600000.2,6799999.9,601000.1,6801000.3&WIDTH=256&HEIGHT=256&FORMAT=image/png" );
+    Request* r3 = buildRequest ( "SERVICE=WMS&REQUEST=GetMap&VERSION=1.3.0&LAYERS=ORTHO&STYLES=&CRS=EPSG:2154&BBOX=600008,6800000,601008,6801000&WIDTH=256&HEIGHT=256&FORMAT=image/png" );
+    CPPUNIT_ASSERT_MESSAGE ( "GetMap key", ResponseCache::buildKey ( r1, key1 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "GetMap key", ResponseCache::buildKey ( r2, key2 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "GetMap key", ResponseCache::buildKey ( r3, key3 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "Sub-pixel differences are ignored", key1 == key2 );
+    CPPUNIT_ASSERT_MESSAGE ( "Two pixels shift", key1 != key3 );
+    delete r1;
+    delete r2;
+    delete r3;
+
+    // Image allongée, pixel de 10 m : un décalage de 3 m reste inférieur au pixel
+    r1 = buildRequest ( "SERVICE=WMS&REQUEST=GetMap&VERSION=1.3.0&LAYERS=ORTHO&STYLES=&CRS=EPSG:2154&BBOX=600000,6800000,610000,6801000&WIDTH=1000&HEIGHT=100&FORMAT=image/png" );
+    r2 = buildRequest ( "SERVICE=WMS&REQUEST=GetMap&VERSION=1.3.0&LAYERS=ORTHO&STYLES=&CRS=EPSG:2154&BBOX=600003,6800002,610003,6801002&WIDTH=1000&HEIGHT=100&FORMAT=image/png" );
+    CPPUNIT_ASSERT_MESSAGE ( "GetMap key", ResponseCache::buildKey ( r1, key1 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "GetMap key", ResponseCache::buildKey ( r2, key2 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "Output pixel size with distinct aspect ratios", key1 == key2 );
+    delete r1;
+    delete r2;
+
+    r1 = buildRequest ( "SERVICE=WMTS&REQUEST=GetTile&VERSION=1.0.0&LAYER=ORTHO&STYLE=normal&TILEMATRIXSET=PM&TILEMATRIX=12&TILEROW=1500&TILECOL=2000&FORMAT=image/jpeg" );
+    CPPUNIT_ASSERT_MESSAGE ( "GetTile is not cached", !ResponseCache::buildKey ( r1, key1 ) );
+    delete r1;
+}
+
+void CppUnitResponseCache::admission() {
+    ResponseCache cache ( 1024, 16 );
+    CPPUNIT_ASSERT_MESSAGE ( "Cache enabled", cache.isEnabled() );
+
+    MessageDataSource small ( "small", "text/plain" );
+    MessageDataSource big ( "response bigger than 16 bytes", "text/plain" );
+    SERDataSource error ( new ServiceException ( "", OWS_INVALID_PARAMETER_VALUE, "error", "wms" ) );
+
+    CPPUNIT_ASSERT_MESSAGE ( "Admitted", cache.add ( "small", &small, 60 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "Too big", !cache.add ( "big", &big, 60 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "No TTL", !cache.add ( "nottl", &small, 0 ) );
+    CPPUNIT_ASSERT_MESSAGE ( "Not a HTTP 200", !cache.add ( "error", &error, 60 ) );
+
+    DataSource* cached = cache.get ( "small" );
+    CPPUNIT_ASSERT_MESSAGE ( "Hit", cached != NULL );
+    CPPUNIT_ASSERT_MESSAGE ( "Type", cached->getType() == "text/plain" );
+    CPPUNIT_ASSERT_MESSAGE ( "Content", readResponse ( cached ) == "small" );
+    CPPUNIT_ASSERT_MESSAGE ( "Miss", cache.get ( "big" ) == NULL );
+    CPPUNIT_ASSERT_MESSAGE ( "Counters", cache.getHits() == 1 && cache.getMisses() == 1 );
+
+    cache.clear();
+    CPPUNIT_ASSERT_MESSAGE ( "Cleared", cache.get ( "small" ) == NULL && cache.getMemorySize() == 0 );
+
+    ResponseCache disabled ( 0, 0 );
+    CPPUNIT_ASSERT_MESSAGE ( "Cache disabled", !disabled.isEnabled() && !disabled.add ( "small", &small, 60 ) );
+}
+
+void CppUnitResponseCache::eviction() {
+    ResponseCache cache ( 10, 0 );
+    MessageDataSource first ( "first", "text/plain" );
+    MessageDataSource second ( "secnd", "text/plain" );
+    MessageDataSource third ( "third", "text/plain" );
+
+    cache.add ( "first", &first, 60 );
+    cache.add ( "second", &second, 60 );
+    // first devient la plus récemment utilisée
+    DataSource* reading = cache.get ( "first" );
+    cache.add ( "third", &third, 60 );
+
+    CPPUNIT_ASSERT_MESSAGE ( "Memory bound", cache.getMemorySize() == 10 );
+    CPPUNIT_ASSERT_MESSAGE ( "Least recently used evicted", cache.get ( "second" ) == NULL );
+    CPPUNIT_ASSERT_MESSAGE ( "Read response still valid", readResponse ( reading ) == "first" );
+    DataSource* cached = cache.get ( "third" );
+    CPPUNIT_ASSERT_MESSAGE ( "Most recent kept", cached != NULL && readResponse ( cached ) == "third" );
+}
+
+void CppUnitResponseCache::diskTier() {
+    char directory[] = "/tmp/rok4cacheXXXXXX";
+    CPPUNIT_ASSERT_MESSAGE ( "Temporary directory", mkdtemp ( directory ) != NULL );
+    {
+        ResponseCache cache ( 10, 0, directory, 1024 );
+        MessageDataSource first ( "first", "text/plain" );
+        MessageDataSource second ( "secnd", "text/plain" );
+        MessageDataSource third ( "third", "text/plain" );
+
+        cache.add ( "first", &first, 60 );
+        cache.add ( "second", &second, 60 );
+        cache.add ( "third", &third, 60 );
+        CPPUNIT_ASSERT_MESSAGE ( "Evicted on disk", cache.getDiskSize() == 5 );
+
+        DataSource* cached = cache.get ( "first" );
+        CPPUNIT_ASSERT_MESSAGE ( "Disk hit", cached != NULL && cache.getDiskHits() == 1 );
+        CPPUNIT_ASSERT_MESSAGE ( "Disk content", readResponse ( cached ) == "first" );
+        // La remontée en mémoire a évincé second sur le disque
+        CPPUNIT_ASSERT_MESSAGE ( "Swapped on disk", cache.getDiskSize() == 5 && cache.getMemorySize() == 10 );
+    }
+    CPPUNIT_ASSERT_MESSAGE ( "Files deleted", rmdir ( directory ) == 0 );
+}
+
+void CppUnitResponseCache::generation() {
+    char directory[] = "/tmp/rok4cacheXXXXXX";
+    CPPUNIT_ASSERT_MESSAGE ( "Temporary directory", mkdtemp ( directory ) != NULL );
+    {
+        ResponseCache cache ( 5, 0, directory, 1024 );
+        MessageDataSource first ( "first", "text/plain" );
+        MessageDataSource second ( "secnd", "text/plain" );
+
+        cache.add ( "first", &first, 60, 100 );
+        DataSource* cached = cache.get ( "first", 100 );
+        CPPUNIT_ASSERT_MESSAGE ( "Same generation", cached != NULL && readResponse ( cached ) == "first" );
+        // La pyramide a été mise à jour depuis le calcul de la réponse
+        CPPUNIT_ASSERT_MESSAGE ( "Newer generation", cache.get ( "first", 101 ) == NULL );
+        CPPUNIT_ASSERT_MESSAGE ( "Stale response removed", cache.getMemorySize() == 0 );
+
+        // Réponse évincée sur le disque
+        cache.add ( "first", &first, 60, 100 );
+        cache.add ( "second", &second, 60, 100 );
+        CPPUNIT_ASSERT_MESSAGE ( "Evicted on disk", cache.getDiskSize() == 5 );
+        CPPUNIT_ASSERT_MESSAGE ( "Stale on disk", cache.get ( "first", 101 ) == NULL );
+        CPPUNIT_ASSERT_MESSAGE ( "Stale file removed", cache.getDiskSize() == 0 );
+    }
+    CPPUNIT_ASSERT_MESSAGE ( "Files deleted", rmdir ( directory ) == 0 );
+}
+
+void CppUnitResponseCache::tearDown() {
+
+}
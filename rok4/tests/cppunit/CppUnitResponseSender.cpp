@@ -0,0 +1,250 @@
+/*
+ * Copyright © (2011) Institut national de l'information
+ *                    géographique et forestière
+ *
+ * Géoportail SAV <geop_services@geoportail.fr>
+ *
+ * This software is a computer program whose purpose is to publish geographic
+ * data using OGC WMS and WMTS protocol.
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ *
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <cstring>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "ResponseSender.h"
+#include "fastcgi.h"
+#include "Message.h"
+#include "CancellationToken.h"
+#include "BilEncoder.h"
+#include "EmptyImage.h"
+#include "config.h"
+
+/**
+ * Flux annulant le jeton courant après avoir fourni une quantité donnée de données
+ */
+class CancellingDataStream : public DataStream {
+private:
+    size_t total;
+    size_t cancelAfter;
+    size_t pos;
+public:
+    CancellingDataStream ( size_t total, size_t cancelAfter ) : total ( total ), cancelAfter ( cancelAfter ), pos ( 0 ) {}
+    size_t read ( uint8_t *buffer, size_t size ) {
+        if ( size > total - pos ) size = total - pos;
+        memset ( buffer, 'x', size );
+        pos += size;
+        if ( pos >= cancelAfter && CancellationToken::getCurrent() ) {
+            CancellationToken::getCurrent()->cancel();
+        }
+        return size;
+    }
+    bool eof() {
+        return pos == total;
+    }
+    std::string getType() {
+        return "image/png";
+    }
+    std::string getEncoding() {
+        return "";
+    }
+    int getHttpStatus() {
+        return 200;
+    }
+};
+
+/**
+ * Extrémité cliente de la connexion FCGI : rassemble le contenu des enregistrements STDOUT
+ */
+struct FcgiClient {
+    int fd;
+    std::string body;
+    bool ended;
+};
+
+static void* readRecords ( void* arg ) {
+    FcgiClient* client = ( FcgiClient* ) arg;
+    unsigned char header[8];
+    char content[65536 + 256];
+    for ( ;; ) {
+        size_t got = 0;
+        while ( got < 8 ) {
+            ssize_t r = read ( client->fd, header + got, 8 - got );
+            if ( r <= 0 ) break;
+            got += r;
+        }
+        if ( got < 8 ) break;
+        size_t length = ( header[4] << 8 ) + header[5] + header[6];
+        got = 0;
+        while ( got < length ) {
+            ssize_t r = read ( client->fd, content + got, length - got );
+            if ( r <= 0 ) break;
+            got += r;
+        }
+        if ( got < length ) break;
+        if ( header[1] == FCGI_STDOUT ) {
+            size_t contentLength = ( header[4] << 8 ) + header[5];
+            if ( contentLength == 0 ) client->ended = true;
+            client->body.append ( content, contentLength );
+        }
+    }
+    close ( client->fd );
+    return NULL;
+}
+
+class CppUnitResponseSender : public CPPUNIT_NS::TestFixture {
+
+    CPPUNIT_TEST_SUITE ( CppUnitResponseSender );
+
+    CPPUNIT_TEST ( completeStream );
+    CPPUNIT_TEST ( bilStream );
+    CPPUNIT_TEST ( cancelledSource );
+    CPPUNIT_TEST ( cancelledStream );
+    CPPUNIT_TEST ( abortedStream );
+
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    FCGX_Request request;
+    FcgiClient client;
+    pthread_t reader;
+
+    void open();
+    void close ( bool finish );
+
+public:
+    void setUp();
+    void completeStream();
+    void bilStream();
+    void cancelledSource();
+    void cancelledStream();
+    void abortedStream();
+    void tearDown();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( CppUnitResponseSender );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION ( CppUnitResponseSender, "CppUnitResponseSender" );
+
+void CppUnitResponseSender::setUp() {
+
+}
+
+void CppUnitResponseSender::open() {
+    int sv[2];
+    CPPUNIT_ASSERT ( socketpair ( AF_UNIX, SOCK_STREAM, 0, sv ) == 0 );
+    memset ( &request, 0, sizeof ( request ) );
+    request.requestId = 1;
+    request.ipcFd = sv[0];
+    request.out = FCGX_CreateWriter ( sv[0], 1, 8192, FCGI_STDOUT );
+    client.fd = sv[1];
+    client.body.clear();
+    client.ended = false;
+    pthread_create ( &reader, NULL, readRecords, &client );
+}
+
+void CppUnitResponseSender::close ( bool finish ) {
+    if ( finish ) {
+        FCGX_FClose ( request.out );
+    }
+    FCGX_Free ( &request, 1 );
+    pthread_join ( reader, NULL );
+}
+
+void CppUnitResponseSender::completeStream() {
+    ResponseSender sender;
+    open();
+    CPPUNIT_ASSERT ( sender.sendresponse ( new CancellingDataStream ( 3 * RESPONSE_BUFFER_SIZE, 4 * RESPONSE_BUFFER_SIZE ), &request ) == 0 );
+    close ( true );
+    CPPUNIT_ASSERT_MESSAGE ( "Status 200", client.body.find ( "Status: 200" ) == 0 );
+    CPPUNIT_ASSERT_MESSAGE ( "Flux complet", client.body.size() - client.body.find ( "\r\n\r\n" ) - 4 == 3 * RESPONSE_BUFFER_SIZE );
+    CPPUNIT_ASSERT ( client.ended );
+}
+
+void CppUnitResponseSender::bilStream() {
+    ResponseSender sender;
+    // Lignes de 20000 octets, plus longues que la place libre laissée en fin de tampon
+    float color = 1.5;
+    CPPUNIT_ASSERT ( RESPONSE_BUFFER_SIZE % ( 5000 * sizeof ( float ) ) > RESPONSE_DIRECT_WRITE_SIZE );
+    open();
+    CPPUNIT_ASSERT ( sender.sendresponse ( new BilEncoder ( new EmptyImage ( 5000, 300, 1, &color ) ), &request ) == 0 );
+    close ( true );
+    CPPUNIT_ASSERT_MESSAGE ( "Status 200", client.body.find ( "Status: 200" ) == 0 );
+    CPPUNIT_ASSERT_MESSAGE ( "Image BIL complete", client.body.size() - client.body.find ( "\r\n\r\n" ) - 4 == 5000 * 300 * sizeof ( float ) );
+    CPPUNIT_ASSERT ( client.ended );
+}
+
+void CppUnitResponseSender::cancelledSource() {
+    ResponseSender sender;
+    CancellationToken token ( 1 );
+    usleep ( 5000 );
+    CPPUNIT_ASSERT ( token.isCancelled() );
+    CancellationToken::setCurrent ( &token );
+    open();
+    sender.sendresponse ( new MessageDataSource ( "image", "image/png" ), &request );
+    close ( true );
+    CancellationToken::setCurrent ( NULL );
+    CPPUNIT_ASSERT_MESSAGE ( "Status 504", client.body.find ( "Status: 504" ) == 0 );
+    CPPUNIT_ASSERT ( client.ended );
+}
+
+void CppUnitResponseSender::cancelledStream() {
+    ResponseSender sender;
+    CancellationToken token;
+    CancellationToken::setCurrent ( &token );
+    open();
+    sender.sendresponse ( new CancellingDataStream ( 100000, 1000 ), &request );
+    close ( true );
+    CancellationToken::setCurrent ( NULL );
+    CPPUNIT_ASSERT_MESSAGE ( "Status 503", client.body.find ( "Status: 503" ) == 0 );
+    CPPUNIT_ASSERT_MESSAGE ( "Image tronquee non transmise", client.body.find ( "xxxx" ) == std::string::npos );
+    CPPUNIT_ASSERT ( client.ended );
+}
+
+void CppUnitResponseSender::abortedStream() {
+    ResponseSender sender;
+    CancellationToken token;
+    CancellationToken::setCurrent ( &token );
+    open();
+    CPPUNIT_ASSERT ( sender.sendresponse ( new CancellingDataStream ( 3 * RESPONSE_BUFFER_SIZE, 2 * RESPONSE_BUFFER_SIZE ), &request ) == -1 );
+    // Flux déjà libérés par l'abandon de la requête
+    CPPUNIT_ASSERT ( request.out == NULL );
+    close ( false );
+    CancellationToken::setCurrent ( NULL );
+    CPPUNIT_ASSERT_MESSAGE ( "Status 200 deja envoye", client.body.find ( "Status: 200" ) == 0 );
+    CPPUNIT_ASSERT_MESSAGE ( "Reponse non terminee", ! client.ended );
+}
+
+void CppUnitResponseSender::tearDown() {
+
+}